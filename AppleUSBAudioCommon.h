@@ -125,6 +125,10 @@
 // RESETAFTERSLEEP causes a device reset to be issued after waking from sleep for all devices.
 #define	RESETAFTERSLEEP				TRUE
 
+// LIGHTWEIGHTWAKE limits the RESETAFTERSLEEP reset to devices that need it. Other devices are resumed in place, and reset only if the first
+// start of one of their engines after waking fails or streams nothing. A device that fails that way is reset on every wake from then on.
+#define	LIGHTWEIGHTWAKE				TRUE
+
 // DEBUGANCHORS prints out the last kAnchorsToAccumulate anchors whenever the list fills; used to check anchor accuracy.
 #define	DEBUGANCHORS				FALSE
 #define	kAnchorsToAccumulate		10
@@ -151,6 +155,24 @@
 // <rdar://5811247> Poll for the clock status.
 #define POLLCLOCKSTATUS				TRUE
 
+// EVENTDRIVENCLOCKSTATUS polls the clock status of devices with a status interrupt endpoint only while that endpoint is failing, and
+// backs the polling off while the clock isn't changing.
+#define EVENTDRIVENCLOCKSTATUS		TRUE
+
+// CONDITIONFEEDBACK passes asynchronous feedback endpoint values through a median filter and a PI loop before they are used to size output packets.
+#define CONDITIONFEEDBACK			TRUE
+
+// STREAMTRACE records streaming path events into a fixed-size binary ring per stream. Recording an event is a few stores, so unlike
+// debugIOLog it can stay on in release builds without disturbing timing. Tools/auatrace.c decodes a dumped ring.
+#define STREAMTRACE					TRUE
+
+// ADAPTIVESAMPLEOFFSET measures how late USB completions run while streaming and sets the safety offset from a high percentile of that lateness.
+#define ADAPTIVESAMPLEOFFSET		TRUE
+
+// ANCHORWARMUP fills the anchor regression with a fast burst of the best of several back-to-back anchors, then backs the sampling off
+// as the fit starts predicting new anchors well, instead of sampling every kAnchorSamplingFreq1 ms until MAX_ANCHOR_ENTRIES are taken.
+#define ANCHORWARMUP				TRUE
+
 #define DEBUGZEROTIME				FALSE
 #define DEBUGUSB					FALSE
 #define DEBUGLOADING				FALSE
@@ -162,6 +184,9 @@
 //  Default length of AppleUSBAudioDevice timer interval in milliseconds
 #define kRefreshInterval			128
 
+// Milliseconds between registry updates of the stream statistics and clock status polling counters; a multiple of kRefreshInterval.
+#define kStatisticsPublishInterval	1024
+
 // The following return codes are used by AppleUSBAudioDevice to detail the status of a format change.
 enum 
 {
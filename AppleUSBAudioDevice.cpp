@@ -83,6 +83,15 @@ void AppleUSBAudioDevice::free () {
         IORecursiveLockFree (mInterfaceLock);
         mInterfaceLock = NULL;
     }
+
+    if (mCoalescedControlsLock) 
+	{
+        IOLockFree (mCoalescedControlsLock);
+        mCoalescedControlsLock = NULL;
+    }
+
+	freeControlBuffers ();
+	freeUnitControlIndex ();
 	
 	//  <rdar://problem/6369110>
 	if (mRegisteredEnginesMutex) 
@@ -98,6 +107,9 @@ void AppleUSBAudioDevice::free () {
         mRegisteredStreamsMutex = NULL;
     }
 
+	freeClockGraphIndex ();
+	freeStreamCapabilities ();
+
 	if (mConfigDictionary)
 	{
         mConfigDictionary->release ();
@@ -280,9 +292,13 @@ IOReturn AppleUSBAudioDevice::protectedInitHardware (IOService * provider) {
 	debugIOLog ("? AppleUSBAudioDevice[%p]::protectedInitHardware () - %d configuration(s) on this device. This control interface number is %d", this, mControlInterface->GetDevice()->GetNumConfigurations (), mControlInterface->GetInterfaceNumber ());
 		
 	debugIOLog ("? AppleUSBAudioDevice[%p]::protectedInitHardware () - Attempting to create configuration dictionary...", this);
-	mConfigDictionary = AUAConfigurationDictionary::create (getConfigurationDescriptor(), mControlInterface->GetInterfaceNumber());	// rdar://5495653
+	// rdar://5495653 Identical devices that re-enumerate reuse the configuration parsed the last time round.
+	mConfigDictionary = AUAConfigurationDictionary::createCached (getConfigurationDescriptor(), mControlInterface->GetInterfaceNumber(), 
+																  getVendorID (), getProductID (), mControlInterface->GetDevice()->GetDeviceRelease ());
 	FailIf (NULL == mConfigDictionary, Exit);
 	debugIOLog ("? AppleUSBAudioDevice[%p]::protectedInitHardware () - Successfully created configuration dictionary.", this);
+	publishConfigurationCacheStatistics ();
+	allocateControlBuffers ();
 
 	if ( !mConfigDictionary->hasAudioStreamingInterfaces () )
 	{
@@ -316,6 +332,9 @@ IOReturn AppleUSBAudioDevice::protectedInitHardware (IOService * provider) {
 		FailIf ( NULL == ( mClockGraph = buildClockGraph ( mControlInterface->GetInterfaceNumber () ) ), Exit );
 		// From this moment forward, we may assume that a device is attempting to be USB 2.0 audio class-compliant by the presence of mClockGraph
 		
+		// The clock graph index is an accelerator only; every query falls back to walking mClockGraph without it.
+		FailMessage ( kIOReturnSuccess != buildClockGraphIndex () );
+		
 		// Since supported sample rates are no longer listed explicitly in the USB 2.0 audio specification, we must discover them through device
 		// request inquiries.
 		
@@ -493,6 +512,11 @@ IOReturn AppleUSBAudioDevice::protectedInitHardware (IOService * provider) {
 	// <rdar://problem/6021475> AppleUSBAudio: Status Interrupt Endpoint support
 	mProcessStatusInterruptThread = thread_call_allocate ( ( thread_call_func_t )processStatusInterrupt, ( thread_call_param_t )this );
 	FailIf ( NULL == mProcessStatusInterruptThread, Exit );
+
+	mCoalescedControlsLock = IOLockAlloc ();
+	FailIf ( NULL == mCoalescedControlsLock, Exit );
+	mFlushControlChangesThread = thread_call_allocate ( ( thread_call_func_t )flushControlChangesThread, ( thread_call_param_t )this );
+	FailIf ( NULL == mFlushControlChangesThread, Exit );
 	checkForStatusInterruptEndpoint ();
 	
 	// Added for rdar://3993906 . This forces matchPropertyTable () to run again.
@@ -557,7 +581,9 @@ void AppleUSBAudioDevice::checkForStatusInterruptEndpoint( void )
 
 		mInterruptPipe->retain ();
 
-		FailMessage ( kIOReturnSuccess != mInterruptPipe->Read ( mInterruptEndpointMemoryDescriptor, 0, 0, mInterruptEndpointMemoryDescriptor->getLength(), &mStatusInterruptCompletion ) );
+		// Devices with a status interrupt endpoint have never had their clock status polled, so trust the endpoint until it fails.
+		mClockStatusInterruptsConfirmed = ( kIOReturnSuccess == mInterruptPipe->Read ( mInterruptEndpointMemoryDescriptor, 0, 0, mInterruptEndpointMemoryDescriptor->getLength(), &mStatusInterruptCompletion ) );
+		FailMessage ( !mClockStatusInterruptsConfirmed );
 	}
 	
 Exit:
@@ -579,6 +605,7 @@ void AppleUSBAudioDevice::statusInterruptHandler( void * target, void * paramete
 	
 	if ( kIOReturnAborted == status || self->isInactive () )
 	{
+		self->mClockStatusInterruptsConfirmed = false;
 		debugIOLog ("! AppleUSBAudioDevice[%p]::statusInterruptHandler () error from USB: 0x%X or IOService inactive: %u, NOT reposting read to interrupt pipe", self, status, self->isInactive ());
 	}
 	else
@@ -588,10 +615,17 @@ void AppleUSBAudioDevice::statusInterruptHandler( void * target, void * paramete
 			debugIOLog ("! AppleUSBAudioDevice[%p]::statusInterruptHandler () error from USB: kIOUSBPipeStalled, reposting read to interrupt pipe", self);
 			// <rdar://7865729> Defer the ClearPipeStall() to our own thread.
 			self->mInterruptPipeStalled = true;
+			self->mClockStatusInterruptsConfirmed = false;
 		}
 		else if ( kIOReturnSuccess != status )
 		{
 			debugIOLog ("! AppleUSBAudioDevice[%p]::statusInterruptHandler () error from USB: 0x%X, reposting read to interrupt pipe", self, status);
+			self->mClockStatusInterruptsConfirmed = false;
+		}
+		else
+		{
+			// Any interrupt that arrives intact shows the endpoint is working again, so the engines can stop polling the clock.
+			self->mClockStatusInterruptsConfirmed = true;
 		}
 	
 		self->retain ();
@@ -693,19 +727,23 @@ void AppleUSBAudioDevice::handleStatusInterrupt ( void )
 			//  if this is a feature unit, dispatch to engines
 			if ( ( FEATURE_UNIT == subType ) || ( SELECTOR_UNIT == subType ) )	//	<rdar://6523676>
 			{
-				FailIf ( NULL == mRegisteredEngines, Exit );
-				for ( UInt8 engineIndex = 0; engineIndex < mRegisteredEngines->getCount (); engineIndex++ )
+				// Without the unit control index, fall back to scanning every engine's default controls.
+				if ( kIOReturnSuccess != refreshUnitControls ( bOriginator ) )
 				{
-					currentEngineInfo = OSDynamicCast ( OSDictionary, mRegisteredEngines->getObject ( engineIndex ) );
-					FailIf ( NULL == currentEngineInfo, Exit );
-					currentEngine = OSDynamicCast ( AppleUSBAudioEngine, currentEngineInfo->getObject ( kEngine ) );
-					FailIf ( NULL == currentEngine, Exit );
-					defaultAudioControls =  currentEngine->copyDefaultAudioControls ();
-					if ( 0 != defaultAudioControls ) // <rdar://7695055>
+					FailIf ( NULL == mRegisteredEngines, Exit );
+					for ( UInt8 engineIndex = 0; engineIndex < mRegisteredEngines->getCount (); engineIndex++ )
 					{
-						controlHasChangedOnDevice ( bOriginator, defaultAudioControls );
-						defaultAudioControls->release ();
-						defaultAudioControls = NULL;
+						currentEngineInfo = OSDynamicCast ( OSDictionary, mRegisteredEngines->getObject ( engineIndex ) );
+						FailIf ( NULL == currentEngineInfo, Exit );
+						currentEngine = OSDynamicCast ( AppleUSBAudioEngine, currentEngineInfo->getObject ( kEngine ) );
+						FailIf ( NULL == currentEngine, Exit );
+						defaultAudioControls =  currentEngine->copyDefaultAudioControls ();
+						if ( 0 != defaultAudioControls ) // <rdar://7695055>
+						{
+							controlHasChangedOnDevice ( bOriginator, defaultAudioControls );
+							defaultAudioControls->release ();
+							defaultAudioControls = NULL;
+						}
 					}
 				}
 			}
@@ -861,42 +899,8 @@ void AppleUSBAudioDevice::controlHasChangedOnDevice ( UInt8 controlID, OSSet * d
 						
 						if ( kIOAudioControlTypeSelector == controlObject->getType() )
 						{
-							UInt8		oldSelectorPosition;
-							UInt8		newSelectorPosition;
-							
 							FailIf ( NULL == mControlInterface, Exit );
-							
-							oldSelectorPosition = controlObject->getIntValue () & 0x000000FF;
-							newSelectorPosition = getSelectorSetting ( controlID );
-							
-							if ( oldSelectorPosition != newSelectorPosition )
-							{
-								// The current selected input is no longer valid. Switch over to the new input source.
-								OSArray * availableSelections = OSDynamicCast ( OSArray, controlObject->getProperty ( kIOAudioSelectorControlAvailableSelectionsKey ) );
-								
-								if ( NULL != availableSelections )
-								{
-									for ( UInt32 index = 0; index < availableSelections->getCount (); index++ )
-									{
-										OSDictionary * selectionDictionary = OSDynamicCast ( OSDictionary, availableSelections->getObject ( index ) );
-										if ( NULL != selectionDictionary )
-										{
-											OSNumber * selectionNumber = OSDynamicCast ( OSNumber, selectionDictionary->getObject ( kIOAudioSelectorControlSelectionValueKey ) );
-											if ( NULL != selectionNumber )
-											{
-												SInt32 selection = (SInt32)selectionNumber->unsigned32BitValue ();
-												if ( ( selection & 0x000000FF ) == newSelectorPosition )
-												{
-													// Found the input source. Switch over to it.
-													debugIOLog ( "? AppleUSBAudioDevice[%p]::controlHasChangedOnDevice () - Switch input selector over to selection = 0x%x", this, selection );
-													controlObject->setValue ( selection );
-													break;
-												}
-											}
-										}
-									}
-								}
-							}
+							updateInputSelectorControl ( controlObject, getSelectorSetting ( controlID ) );
 						}
 						break;
 
@@ -911,6 +915,351 @@ Exit:
 
 }
 
+//	<rdar://6523676> Moves an input selector control over to the source the device now reports as selected.
+void AppleUSBAudioDevice::updateInputSelectorControl ( IOAudioControl * controlObject, UInt8 newSelectorPosition )
+{
+	OSArray *				availableSelections;
+	OSDictionary *			selectionDictionary;
+	OSNumber *				selectionNumber;
+	SInt32					selection;
+	UInt8					oldSelectorPosition;
+
+	FailIf ( NULL == controlObject, Exit );
+	oldSelectorPosition = controlObject->getIntValue () & 0x000000FF;
+	if ( oldSelectorPosition != newSelectorPosition )
+	{
+		// The current selected input is no longer valid. Switch over to the new input source.
+		availableSelections = OSDynamicCast ( OSArray, controlObject->getProperty ( kIOAudioSelectorControlAvailableSelectionsKey ) );
+		FailIf ( NULL == availableSelections, Exit );
+		for ( UInt32 index = 0; index < availableSelections->getCount (); index++ )
+		{
+			selectionDictionary = OSDynamicCast ( OSDictionary, availableSelections->getObject ( index ) );
+			if ( NULL != selectionDictionary )
+			{
+				selectionNumber = OSDynamicCast ( OSNumber, selectionDictionary->getObject ( kIOAudioSelectorControlSelectionValueKey ) );
+				if ( NULL != selectionNumber )
+				{
+					selection = (SInt32)selectionNumber->unsigned32BitValue ();
+					if ( ( selection & 0x000000FF ) == newSelectorPosition )
+					{
+						// Found the input source. Switch over to it.
+						debugIOLog ( "? AppleUSBAudioDevice[%p]::updateInputSelectorControl () - Switch input selector over to selection = 0x%x", this, selection );
+						controlObject->setValue ( selection );
+						break;
+					}
+				}
+			}
+		}
+	}
+
+Exit:
+	return;
+}
+
+// True while the status interrupt pipe is working: from the first read being queued, and again after any successful interrupt, until the
+// pipe next reports an error.
+bool AppleUSBAudioDevice::clockStatusInterruptsConfirmed ( void )
+{
+	return mClockStatusInterruptsConfirmed;
+}
+
+// Called whenever an engine's default controls, or the set of registered engines, change.
+void AppleUSBAudioDevice::audioControlsChanged ( void )
+{
+	OSIncrementAtomic ( &mAudioControlsGeneration );
+}
+
+// Collects the volume, mute and input selector controls of every registered engine into mUnitControlIndex, keeping only the
+// channels controlHasChangedOnDevice () would update.
+IOReturn AppleUSBAudioDevice::buildUnitControlIndex ( void )
+{
+	AUAUnitControlIndex *	index = &mUnitControlIndex;
+	OSArray *				controlSets = NULL;
+	OSSet *					defaultAudioControls;
+	OSCollectionIterator *	controlsIterator;
+	OSDictionary *			engineInfo;
+	AppleUSBAudioEngine *	engine;
+	IOAudioControl *		controlObject;
+	AUAUnitControl			insertControl;
+	SInt32					generation;
+	UInt32					capacity = 0;
+	UInt32					setIndex;
+	UInt32					controlIndex;
+	UInt32					sortIndex;
+	UInt8					interfaceNum;
+	UInt8					numControls;
+	IOReturn				result = kIOReturnError;
+
+	generation = mAudioControlsGeneration;
+	freeUnitControlIndex ();
+	FailIf ( NULL == mControlInterface, Exit );
+	FailIf ( NULL == mConfigDictionary, Exit );
+	interfaceNum = mControlInterface->GetInterfaceNumber ();
+
+	FailIf ( NULL == ( controlSets = OSArray::withCapacity ( 2 ) ), Exit );
+	if ( mRegisteredEnginesMutex )
+	{
+		IORecursiveLockLock ( mRegisteredEnginesMutex );
+	}
+	for ( UInt32 engineIndex = 0; ( NULL != mRegisteredEngines ) && ( engineIndex < mRegisteredEngines->getCount () ); engineIndex++ )
+	{
+		engineInfo = OSDynamicCast ( OSDictionary, mRegisteredEngines->getObject ( engineIndex ) );
+		engine = ( NULL == engineInfo ) ? NULL : OSDynamicCast ( AppleUSBAudioEngine, engineInfo->getObject ( kEngine ) );
+		if ( NULL != engine && NULL != ( defaultAudioControls = engine->copyDefaultAudioControls () ) )
+		{
+			capacity += defaultAudioControls->getCount ();
+			controlSets->setObject ( defaultAudioControls );
+			defaultAudioControls->release ();
+		}
+	}
+	if ( mRegisteredEnginesMutex )
+	{
+		IORecursiveLockUnlock ( mRegisteredEnginesMutex );
+	}
+
+	if ( 0 != capacity )
+	{
+		FailIf ( NULL == ( index->controls = ( AUAUnitControl * ) IOMalloc ( capacity * sizeof ( AUAUnitControl ) ) ), Exit );
+		index->capacity = capacity;
+	}
+	index->numControls = 0;
+	for ( setIndex = 0; setIndex < controlSets->getCount (); setIndex++ )
+	{
+		FailIf ( NULL == ( controlsIterator = OSCollectionIterator::withCollection ( OSDynamicCast ( OSSet, controlSets->getObject ( setIndex ) ) ) ), Exit );
+		while ( ( index->numControls < capacity ) && ( NULL != ( controlObject = OSDynamicCast ( IOAudioControl, controlsIterator->getNextObject () ) ) ) )
+		{
+			insertControl.control = controlObject;
+			insertControl.reply = NULL;
+			insertControl.unitID = controlObject->getControlID () & 0xFF;	//	<rdar://6413207>
+			insertControl.channelNum = controlObject->getChannelID ();
+			switch ( controlObject->getSubType () )
+			{
+				case kIOAudioLevelControlSubTypeVolume:
+					insertControl.controlSelector = VOLUME_CONTROL;
+					break;
+				case kIOAudioToggleControlSubTypeMute:
+					insertControl.controlSelector = MUTE_CONTROL;
+					break;
+				case kIOAudioSelectorControlSubTypeInput:
+					insertControl.controlSelector = ( kIOAudioControlTypeSelector == controlObject->getType () ) ? 0 : 0xFF;
+					break;
+				default:
+					insertControl.controlSelector = 0xFF;
+					break;
+			}
+			if ( 0xFF == insertControl.controlSelector )
+			{
+				continue;
+			}
+			//	<rdar://6497818> Only channels that have the control present.
+			if ( 0 != insertControl.controlSelector )
+			{
+				if	(		( kIOReturnSuccess != mConfigDictionary->getNumControls ( &numControls, interfaceNum, 0, insertControl.unitID ) )
+						||	( insertControl.channelNum > numControls ) )
+				{
+					continue;
+				}
+				if	(		( ( VOLUME_CONTROL == insertControl.controlSelector ) && !mConfigDictionary->channelHasVolumeControl ( interfaceNum, 0, insertControl.unitID, insertControl.channelNum ) )
+						||	( ( MUTE_CONTROL == insertControl.controlSelector ) && !mConfigDictionary->channelHasMuteControl ( interfaceNum, 0, insertControl.unitID, insertControl.channelNum ) ) )
+				{
+					continue;
+				}
+			}
+
+			// Insertion sort on the unit ID, which keeps each unit's controls in the order they were found.
+			for ( sortIndex = index->numControls; ( sortIndex > 0 ) && ( index->controls[sortIndex - 1].unitID > insertControl.unitID ); sortIndex-- )
+			{
+				index->controls[sortIndex] = index->controls[sortIndex - 1];
+			}
+			controlObject->retain ();
+			index->controls[sortIndex] = insertControl;
+			index->numControls++;
+		}
+		controlsIterator->release ();
+	}
+
+	if ( 0 != index->numControls )
+	{
+		FailIf ( NULL == ( index->replies = IOBufferMemoryDescriptor::withOptions ( kIODirectionIn, index->numControls * 2 ) ), Exit );
+	}
+	for ( controlIndex = 0; controlIndex < index->numControls; controlIndex++ )
+	{
+		index->controls[controlIndex].reply = IOSubMemoryDescriptor::withSubRange ( index->replies, controlIndex * 2, ( VOLUME_CONTROL == index->controls[controlIndex].controlSelector ) ? 2 : 1, kIODirectionIn );
+		FailIf ( NULL == index->controls[controlIndex].reply, Exit );
+		if ( kAUANoUnitControl == index->firstControl[index->controls[controlIndex].unitID] )
+		{
+			index->firstControl[index->controls[controlIndex].unitID] = controlIndex;
+		}
+	}
+	index->generation = generation;
+	index->built = true;
+	debugIOLog ( "? AppleUSBAudioDevice[%p]::buildUnitControlIndex () - %lu control(s) indexed", this, index->numControls );
+	result = kIOReturnSuccess;
+
+Exit:
+	if ( NULL != controlSets )
+	{
+		controlSets->release ();
+	}
+	if ( kIOReturnSuccess != result )
+	{
+		freeUnitControlIndex ();
+	}
+	return result;
+}
+
+void AppleUSBAudioDevice::freeUnitControlIndex ( void )
+{
+	AUAUnitControlIndex *	index = &mUnitControlIndex;
+
+	for ( UInt32 controlIndex = 0; ( NULL != index->controls ) && ( controlIndex < index->numControls ); controlIndex++ )
+	{
+		if ( NULL != index->controls[controlIndex].reply )
+		{
+			index->controls[controlIndex].reply->release ();
+		}
+		index->controls[controlIndex].control->release ();
+	}
+	if ( NULL != index->controls )
+	{
+		IOFree ( index->controls, index->capacity * sizeof ( AUAUnitControl ) );
+		index->controls = NULL;
+	}
+	if ( NULL != index->replies )
+	{
+		index->replies->release ();
+		index->replies = NULL;
+	}
+	index->numControls = 0;
+	index->capacity = 0;
+	index->built = false;
+	for ( UInt32 unitID = 0; unitID < 256; unitID++ )
+	{
+		index->firstControl[unitID] = kAUANoUnitControl;
+	}
+}
+
+IOReturn AppleUSBAudioDevice::freeUnitControlIndexAction ( OSObject * target, void * arg0, void * arg1, void * arg2, void * arg3 )
+{
+	AppleUSBAudioDevice *	self;
+
+	FailIf ( NULL == ( self = OSDynamicCast ( AppleUSBAudioDevice, target ) ), Exit );
+	self->freeUnitControlIndex ();
+
+Exit:
+	return kIOReturnSuccess;
+}
+
+// Re-reads every indexed control of one unit with a single batch of GET_CUR requests and pushes the values to the controls. The
+// volume bounds come from the control range cache, so on a warm device nothing but the current values crosses the bus.
+IOReturn AppleUSBAudioDevice::refreshUnitControls ( UInt8 unitID )
+{
+	AUAUnitControlIndex *	index = &mUnitControlIndex;
+	AUAUnitControl *		unitControl;
+	IOUSBDevRequestDesc		devReqs[kAUAMaxBatchedControlRequests];
+	IOReturn				results[kAUAMaxBatchedControlRequests];
+	OSNumber *				settingNumber;
+	UInt8 *					replyBytes;
+	UInt16					setting;
+	SInt16					deviceCur;
+	SInt16					deviceMin;
+	UInt16					volRes;
+	SInt32					controlCur;
+	UInt32					firstControl;
+	UInt32					numBatchControls;
+	UInt32					batchIndex;
+	bool					isUAC2;
+	IOReturn				result = kIOReturnError;
+
+	FailIf ( NULL == mControlInterface, Exit );
+	if ( !index->built || ( index->generation != mAudioControlsGeneration ) )
+	{
+		FailIf ( kIOReturnSuccess != ( result = buildUnitControlIndex () ), Exit );
+	}
+	result = kIOReturnSuccess;
+	if ( kAUANoUnitControl == index->firstControl[unitID] )
+	{
+		goto Exit;
+	}
+	isUAC2 = ( IP_VERSION_02_00 == mControlInterface->GetInterfaceProtocol () );
+	replyBytes = ( UInt8 * ) index->replies->getBytesNoCopy ();
+
+	for ( firstControl = index->firstControl[unitID]; ( firstControl < index->numControls ) && ( unitID == index->controls[firstControl].unitID ); firstControl += numBatchControls )
+	{
+		for	(	numBatchControls = 0;
+				( numBatchControls < kAUAMaxBatchedControlRequests ) && ( firstControl + numBatchControls < index->numControls ) && ( unitID == index->controls[firstControl + numBatchControls].unitID );
+				numBatchControls++ )
+		{
+			unitControl = &index->controls[firstControl + numBatchControls];
+			devReqs[numBatchControls].bmRequestType = USBmakebmRequestType ( kUSBIn, kUSBClass, kUSBInterface );
+			devReqs[numBatchControls].bRequest = isUAC2 ? ( UInt8 ) USBAUDIO_0200::CUR : GET_CUR;
+			if ( 0 == unitControl->controlSelector )
+			{
+				devReqs[numBatchControls].wValue = isUAC2 ? ( ( UInt16 ) USBAUDIO_0200::SU_SELECTOR_CONTROL ) << 8 : 0;	// <rdar://problem/6001162>
+			}
+			else
+			{
+				devReqs[numBatchControls].wValue = ( unitControl->controlSelector << 8 ) | unitControl->channelNum;
+			}
+			devReqs[numBatchControls].wIndex = ( 0xFF00 & ( unitID << 8 ) ) | ( 0x00FF & mControlInterface->GetInterfaceNumber () );
+			devReqs[numBatchControls].wLength = ( VOLUME_CONTROL == unitControl->controlSelector ) ? 2 : 1;
+			devReqs[numBatchControls].pData = unitControl->reply;
+		}
+		bzero ( replyBytes + firstControl * 2, numBatchControls * 2 );
+		FailIf ( kIOReturnSuccess != ( result = deviceRequestBatch ( devReqs, results, numBatchControls ) ), Exit );
+
+		for ( batchIndex = 0; batchIndex < numBatchControls; batchIndex++ )
+		{
+			unitControl = &index->controls[firstControl + batchIndex];
+			if ( kIOReturnSuccess != results[batchIndex] )
+			{
+				debugIOLog ( "! AppleUSBAudioDevice[%p]::refreshUnitControls (%d) - GET_CUR on channel %d failed 0x%x", this, unitID, unitControl->channelNum, results[batchIndex] );
+				continue;
+			}
+			switch ( unitControl->controlSelector )
+			{
+				case VOLUME_CONTROL:
+					memcpy ( &setting, replyBytes + ( firstControl + batchIndex ) * 2, 2 );
+					deviceCur = USBToHostWord ( setting );
+					if	(		( kIOReturnSuccess != getMinVolume ( unitID, unitControl->channelNum, &deviceMin ) )
+							||	( kIOReturnSuccess != getVolumeResolution ( unitID, unitControl->channelNum, &volRes ) )
+							||	( 0 == volRes ) )		// [rdar://4511427]
+					{
+						continue;
+					}
+					// Same rules as controlHasChangedOnDevice () for devices that report negative infinity or the minimum.
+					if ( ( (SInt16) kNegativeInfinity == deviceCur ) || ( deviceCur == deviceMin ) )
+					{
+						controlCur = 0;
+					}
+					else
+					{
+						controlCur = ( ( deviceCur - deviceMin ) / volRes );
+					}
+					if ( NULL != ( settingNumber = OSNumber::withNumber ( controlCur, SIZEINBITS(SInt32) ) ) )
+					{
+						unitControl->control->hardwareValueChanged ( settingNumber );
+						settingNumber->release ();
+					}
+					break;
+				case MUTE_CONTROL:
+					if ( NULL != ( settingNumber = OSNumber::withNumber ( replyBytes[( firstControl + batchIndex ) * 2], SIZEINBITS(SInt16) ) ) )
+					{
+						unitControl->control->hardwareValueChanged ( settingNumber );
+						settingNumber->release ();
+					}
+					break;
+				default:
+					updateInputSelectorControl ( unitControl->control, replyBytes[( firstControl + batchIndex ) * 2] );
+					break;
+			}
+		}
+	}
+
+Exit:
+	return result;
+}
+
 IOReturn AppleUSBAudioDevice::performPowerStateChange (IOAudioDevicePowerState oldPowerState, IOAudioDevicePowerState newPowerState, UInt32 *microSecsUntilComplete) {
 	IOReturn						result;
 	bool							performDeviceResetOnWake = false;
@@ -940,6 +1289,10 @@ IOReturn AppleUSBAudioDevice::performPowerStateChange (IOAudioDevicePowerState o
 		resetRateTimer();
 		// We should get a new anchor immediately.
 		updateUSBCycleTime ();							// <rdar://problem/7378275>, <rdar://problem/7666699>
+#if ANCHORWARMUP
+		// The regression was just emptied, so warm it up again rather than refilling it at the steady-state rate.
+		mRampUpdateCounter = 0;
+#endif
 		
 #if RESETAFTERSLEEP
 		// [rdar://4234453] Reset the device after waking from sleep just to be safe.		
@@ -952,6 +1305,26 @@ IOReturn AppleUSBAudioDevice::performPowerStateChange (IOAudioDevicePowerState o
 		usbDevice = mControlInterface->GetDevice ();
 		FailIf (NULL == usbDevice, Exit);
 			
+#if LIGHTWEIGHTWAKE
+		// Devices that haven't shown that they need it are resumed in place. The alternate settings are selected again when the streams start,
+		// the anchor is restarted above and the cached control values are flushed below. Every engine watches its first start from here on,
+		// and startFailedAfterWake () resets the device if any of them fails or streams nothing.
+		if ( performDeviceResetOnWake && !shouldResetOnWake ( usbDevice ) )
+		{
+			debugIOLog ("? AppleUSBAudioDevice[%p]::performPowerStateChange () - Resuming without a reset after wake from sleep ...", this);
+			performDeviceResetOnWake = false;
+			for ( UInt32 engineIndex = 0; ( NULL != mEngineArray ) && ( engineIndex < mEngineArray->getCount () ); engineIndex++ )
+			{
+				AppleUSBAudioEngine * engine = OSDynamicCast ( AppleUSBAudioEngine, mEngineArray->getObject ( engineIndex ) );
+				if ( NULL != engine )
+				{
+					engine->mWakeStartDeadline = 0;
+					engine->mVerifyStartAfterWake = true;
+				}
+			}
+		}
+#endif /* LIGHTWEIGHTWAKE */
+
 		// <rdar://problem/6392504> Make sure that the device is connected before resetting it
 		if ( kIOReturnSuccess == usbDevice->message( kIOUSBMessageHubIsDeviceConnected, NULL, 0 ) )	// <rdar://7499125>
 		{
@@ -994,6 +1367,8 @@ void AppleUSBAudioDevice::stop (IOService *provider) {
 		thread_call_free ( mProcessStatusInterruptThread );
 		mProcessStatusInterruptThread = NULL;
 	}
+
+	cancelControlChanges ();
 	
 	if (mUpdateTimer)
 	{
@@ -1008,6 +1383,7 @@ void AppleUSBAudioDevice::stop (IOService *provider) {
 	{
 		mRegisteredEngines->release ();
 		mRegisteredEngines = NULL;
+		audioControlsChanged ();
 	}
 	
 	//  <rdar://7295322>
@@ -1017,6 +1393,17 @@ void AppleUSBAudioDevice::stop (IOService *provider) {
 		mRegisteredStreams = NULL;
 	}
 	
+	// The index retains the engines' controls and each control retains this device as its value change target, so the index has to
+	// go before free () could ever be reached. Do it under the command gate in case a status interrupt task was already running.
+	if ( NULL != getCommandGate () )
+	{
+		getCommandGate ()->runAction ( freeUnitControlIndexAction );
+	}
+	else
+	{
+		freeUnitControlIndex ();
+	}
+	
 	if ( 0 != mEngineArray )
 	{
 		for ( UInt32 engineIndex = 0; engineIndex < mEngineArray->getCount (); engineIndex++ )
@@ -1160,6 +1547,9 @@ bool AppleUSBAudioDevice::createAudioEngines (void) {
 			OSArray * availableStreamsList = OSArray::withArray ( streamNumberArray );
 			FailIf ( 0 == availableStreamsList, Exit );
 			
+			// The partitioning below still works without the capabilities, only more slowly.
+			FailMessage ( kIOReturnSuccess != buildStreamCapabilities ( streamNumberArray ) );
+			
 			// Find all streams with common sample rates.
 			while ( NULL != ( commonSampleRatesStreamList = findStreamsWithCommonSampleRates ( availableStreamsList ) ) )
 			{
@@ -1202,6 +1592,7 @@ bool AppleUSBAudioDevice::createAudioEngines (void) {
 	}
 
 Exit:
+	freeStreamCapabilities ();
 	
 	//  <rdar://problem/6892754> 10.5.7 Regression: Devices with unsupported formats stopped working
 	//  If all the streams have unsupported formats and no engines are created, then return an error.
@@ -1610,6 +2001,36 @@ Exit:
 }
 
 // added for rdar://5495653. Returns the current configuration descriptor.
+void AppleUSBAudioDevice::publishConfigurationCacheStatistics (void)
+{
+	OSDictionary *			cacheStatistics = NULL;
+	OSNumber *				number = NULL;
+	UInt32					hits;
+	UInt32					misses;
+	UInt32					entries;
+
+	AUAConfigurationDictionary::getCacheStatistics (&hits, &misses, &entries);
+	debugIOLog ("? AppleUSBAudioDevice[%p]::publishConfigurationCacheStatistics () - %lu hit(s), %lu miss(es), %lu entries", this, hits, misses, entries);
+
+	FailIf (NULL == (cacheStatistics = OSDictionary::withCapacity (3)), Exit);
+	FailIf (NULL == (number = OSNumber::withNumber (hits, 32)), Exit);
+	cacheStatistics->setObject (kConfigurationCacheHitsKey, number);
+	number->release ();
+	FailIf (NULL == (number = OSNumber::withNumber (misses, 32)), Exit);
+	cacheStatistics->setObject (kConfigurationCacheMissesKey, number);
+	number->release ();
+	FailIf (NULL == (number = OSNumber::withNumber (entries, 32)), Exit);
+	cacheStatistics->setObject (kConfigurationCacheEntriesKey, number);
+	number->release ();
+	setProperty (kConfigurationCacheKey, cacheStatistics);
+
+Exit:
+	if (NULL != cacheStatistics)
+	{
+		cacheStatistics->release ();
+	}
+}
+
 const IOUSBConfigurationDescriptor * AppleUSBAudioDevice::getConfigurationDescriptor () {
 	IOUSBDevice *							usbDevice;
 	const IOUSBConfigurationDescriptor *	configDescriptor = NULL;
@@ -1684,6 +2105,8 @@ Exit:
 	return speed;
 }
 
+// The only place the driver reads the bus frame number; the streams and the anchor sampling all come through here, so a stand-in bus
+// supplies one frame timeline to all of them.
 UInt64 AppleUSBAudioDevice::getUSBFrameNumber () {
 	IOUSBDevice *			usbDevice;
 	UInt64					frameNumber = 0;
@@ -1916,6 +2339,7 @@ IOReturn AppleUSBAudioDevice::registerEngineInfo (AppleUSBAudioEngine * usbAudio
 	{
 		mRegisteredEngines->setObject (engineInfo);
 	}
+	audioControlsChanged ();
 	
 	if ( mRegisteredEnginesMutex )
 	{
@@ -3046,6 +3470,15 @@ void AppleUSBAudioDevice::addVolumeControls (AppleUSBAudioEngine * usbAudioEngin
 	UInt8								controlInterfaceNum;
 	UInt8								numControls;
 	bool								extraStep = false;
+	UInt8								volumeChannels[256];
+	AUAVolumeSettings *					volumeSettings = NULL;
+	UInt32								numVolumeChannels = 0;
+	UInt32								volumeChannelIndex;
+	#if DEBUGLOGGING
+	AbsoluteTime						discoveryStartTime;
+	AbsoluteTime						discoveryEndTime;
+	UInt64								discoveryNanos;
+	#endif
 
 	debugIOLog ("+ AppleUSBAudioDevice::addVolumeControls (0x%x, %d, %d, %d, %d, %u)", usbAudioEngine, featureUnitID, terminalID, interfaceNum, altSettingNum, usage);
 	FailIf (NULL == mControlInterface, Exit);
@@ -3078,35 +3511,77 @@ void AppleUSBAudioDevice::addVolumeControls (AppleUSBAudioEngine * usbAudioEngin
 
 	controlInterfaceNum = mControlInterface->GetInterfaceNumber ();
 	FailIf (kIOReturnSuccess != mConfigDictionary->getNumControls (&numControls, controlInterfaceNum, 0, featureUnitID), Exit);
+
+	// Plan the queries for every channel of the unit first, so that they can be issued as pipelined batches rather than as
+	// one round trip after another, then build the controls from the answers.
 	for (channelNum = 0; channelNum <= numControls; channelNum++) 
 	{
-		extraStep = false;
 		if (mConfigDictionary->channelHasVolumeControl (controlInterfaceNum, 0, featureUnitID, channelNum))
 		{
+			volumeChannels[numVolumeChannels++] = channelNum;
+		}
+		if (0xFF == channelNum)
+		{
+			break;
+		}
+	}
+	if (0 != numVolumeChannels)
+	{
+		#if DEBUGLOGGING
+		clock_get_uptime (&discoveryStartTime);
+		#endif
+		FailIf (NULL == (volumeSettings = (AUAVolumeSettings *)IOMalloc (numVolumeChannels * sizeof (AUAVolumeSettings))), Exit);
+		FailIf (kIOReturnSuccess != getVolumeSettingsForChannels (featureUnitID, numVolumeChannels, volumeChannels, volumeSettings), Exit);
+		for (volumeChannelIndex = 0; volumeChannelIndex < numVolumeChannels; volumeChannelIndex++)
+		{
+			AUAVolumeSettings *		settings = &volumeSettings[volumeChannelIndex];
+
+			// [rdar://4228556] Unless the current volume is negative infinity, we should try to flush the volume out to the device.
+			settings->setCur = (		( kIOReturnSuccess == settings->result )
+									&&	( 0 != settings->resolution )
+									&&	( ( SInt16 ) kNegativeInfinity != settings->cur ) );
+			// [rdar://5292769] If deviceCur lies outside the accepted range, flush out the deviceMin value.
+			if	(		settings->setCur
+					&&	(		( settings->cur < settings->min )
+							||	( settings->cur > settings->max ) ) )
+			{
+				debugIOLog ( "! AppleUSBAudioDevice::addVolumeControls () - deviceCur is not in volume range on channel %d! Setting to deviceMin ...", volumeChannels[volumeChannelIndex] );
+				settings->cur = settings->min;
+			}
+		}
+		FailIf (kIOReturnSuccess != setVolumeForChannels (featureUnitID, numVolumeChannels, volumeChannels, volumeSettings), Exit);
+		#if DEBUGLOGGING
+		clock_get_uptime (&discoveryEndTime);
+		SUB_ABSOLUTETIME (&discoveryEndTime, &discoveryStartTime);
+		absolutetime_to_nanoseconds (discoveryEndTime, &discoveryNanos);
+		debugIOLog ("? AppleUSBAudioDevice[%p]::addVolumeControls () - queried %lu channel(s) of unit %d in %llu ns", this, numVolumeChannels, featureUnitID, discoveryNanos);
+		#endif
+	}
+
+	volumeChannelIndex = 0;
+	for (channelNum = 0; channelNum <= numControls; channelNum++) 
+	{
+		extraStep = false;
+		if (volumeChannelIndex < numVolumeChannels && volumeChannels[volumeChannelIndex] == channelNum)
+		{
+			AUAVolumeSettings *		settings = &volumeSettings[volumeChannelIndex++];
+
 			debugIOLog ("? AppleUSBAudioDevice[%p]::addVolumeControls () - Creating volume controls for channel %d", this, channelNum);
-			FailIf (kIOReturnSuccess != getCurVolume (featureUnitID, channelNum, &deviceCur), Error);
+			FailIf (kIOReturnSuccess != settings->result, Error);
+			deviceCur = settings->cur;
+			deviceMin = settings->min;
+			deviceMax = settings->max;
+			volRes = settings->resolution;
 			debugIOLog ("? AppleUSBAudioDevice[%p]::addVolumeControls () - deviceCur = 0x%04x", this, deviceCur);
-			FailIf (kIOReturnSuccess != getMinVolume (featureUnitID, channelNum, &deviceMin), Error);
 			debugIOLog ("? AppleUSBAudioDevice[%p]::addVolumeControls () - deviceMin = 0x%04x", this, deviceMin);
-			FailIf (kIOReturnSuccess != getMaxVolume (featureUnitID, channelNum, &deviceMax), Error);
 			debugIOLog ("? AppleUSBAudioDevice[%p]::addVolumeControls () - deviceMax = 0x%04x", this, deviceMax);
-			getVolumeResolution (featureUnitID, channelNum, &volRes);
 			debugIOLog ("? AppleUSBAudioDevice[%p]::addVolumeControls () - volRes = 0x%04x", this, volRes);
 			// [rdar://4511427] Need to check volRes for class compliance (Audio Spec 5.2.2.4.3.2).
 			FailIf (0 == volRes, Error);
 			
-			// [rdar://4228556] Unless the current volume is negative infinity, we should try to flush the volume out to the device.
-			if ( ( SInt16 ) kNegativeInfinity != deviceCur )
+			if ( settings->setCur )
 			{
-				// [rdar://5292769] If deviceCur lies outside the accepted range, flush out the deviceMin value.
-				if (		( deviceCur < deviceMin )
-						||	( deviceCur > deviceMax ) )
-				{
-					debugIOLog ( "! AppleUSBAudioDevice::addVolumeControls () - deviceCur is not in volume range! Setting to deviceMin ..." );
-					deviceCur = deviceMin;
-				}
-				debugIOLog ("? AppleUSBAudioDevice[%p]::addVolumeControls () - Attempting to set volume to current volume ...", this);
-				FailIf (kIOReturnSuccess != setCurVolume (featureUnitID, channelNum, HostToUSBWord(deviceCur)), Error);
+				FailIf (kIOReturnSuccess != settings->setResult, Error);
 				debugIOLog ("? AppleUSBAudioDevice[%p]::addVolumeControls () - Volume was set successfully.", this);
 			}
 
@@ -3235,6 +3710,10 @@ NoError:
 	}
 
 Exit:
+	if (NULL != volumeSettings)
+	{
+		IOFree (volumeSettings, numVolumeChannels * sizeof (AUAVolumeSettings));
+	}
 	debugIOLog ("- AppleUSBAudioDevice::addVolumeControls (0x%x, %d, %d, %d, %d, %u)", usbAudioEngine, featureUnitID, terminalID, interfaceNum, altSettingNum, usage);
 	return;
 }
@@ -3400,7 +3879,7 @@ IOReturn AppleUSBAudioDevice::getFeatureUnitRange (UInt8 controlSelector, UInt8
 	FailIf (NULL == target, Exit);
 	FailIf (NULL == mControlInterface, Exit);
 
-	theSettingDesc = IOBufferMemoryDescriptor::withOptions (kIODirectionIn, length);
+	theSettingDesc = acquireControlBuffer (kIODirectionIn, length);
 	FailIf (NULL == theSettingDesc, Exit);
 
     devReq.bmRequestType = USBmakebmRequestType (kUSBIn, kUSBClass, kUSBInterface);
@@ -3417,7 +3896,7 @@ IOReturn AppleUSBAudioDevice::getFeatureUnitRange (UInt8 controlSelector, UInt8
 Exit:
 	if (NULL != theSettingDesc) 
 	{
-		theSettingDesc->release ();
+		releaseControlBuffer (theSettingDesc);
 	}
 	if (NULL != target) 
 	{
@@ -3455,7 +3934,7 @@ IOReturn AppleUSBAudioDevice::getFeatureUnitSetting (UInt8 controlSelector, UInt
 		default:
 			length = 0;
 	}
-	theSettingDesc = IOBufferMemoryDescriptor::withOptions (kIODirectionIn, length);
+	theSettingDesc = acquireControlBuffer (kIODirectionIn, length);
 	FailIf (NULL == theSettingDesc, Exit);
 
     devReq.bmRequestType = USBmakebmRequestType (kUSBIn, kUSBClass, kUSBInterface);
@@ -3472,7 +3951,7 @@ IOReturn AppleUSBAudioDevice::getFeatureUnitSetting (UInt8 controlSelector, UInt
 Exit:
 	if (NULL != theSettingDesc) 
 	{
-		theSettingDesc->release ();
+		releaseControlBuffer (theSettingDesc);
 	}
 	if (NULL != target) 
 	{
@@ -3489,8 +3968,9 @@ IOReturn AppleUSBAudioDevice::setFeatureUnitSetting (UInt8 controlSelector, UInt
 	result = kIOReturnError;
 	FailIf (NULL == mControlInterface, Exit);
 
-	theSettingDesc = IOBufferMemoryDescriptor::withBytes (&newValue, newValueLen, kIODirectionOut);
+	theSettingDesc = acquireControlBuffer (kIODirectionOut, newValueLen);
 	FailIf (NULL == theSettingDesc, Exit);
+	memcpy (theSettingDesc->getBytesNoCopy (), &newValue, newValueLen);
 
     devReq.bmRequestType = USBmakebmRequestType (kUSBOut, kUSBClass, kUSBInterface);
     devReq.bRequest = requestType;
@@ -3505,7 +3985,7 @@ IOReturn AppleUSBAudioDevice::setFeatureUnitSetting (UInt8 controlSelector, UInt
 Exit:
 	if (NULL != theSettingDesc) 
 	{
-		theSettingDesc->release ();
+		releaseControlBuffer (theSettingDesc);
 	}
 	return result;
 	
@@ -3559,6 +4039,13 @@ IOReturn AppleUSBAudioDevice::getMaxVolume (UInt8 unitID, UInt8 channelNumber, S
 
 	result = kIOReturnError;
 	FailIf (NULL == mControlInterface, Exit);
+
+	// Bounds read earlier for this configuration, already checked against the control's current value.
+	if ( ( NULL != mConfigDictionary ) && mConfigDictionary->getCachedControlRange ( VOLUME_CONTROL, unitID, channelNumber, NULL, target, NULL ) )
+	{
+		result = kIOReturnSuccess;
+		goto Exit;
+	}
 	
 	if ( IP_VERSION_02_00 == mControlInterface->GetInterfaceProtocol() )
 	{
@@ -3586,6 +4073,13 @@ IOReturn AppleUSBAudioDevice::getMinVolume (UInt8 unitID, UInt8 channelNumber, S
 	result = kIOReturnError;
 	FailIf (NULL == mControlInterface, Exit);
 
+	// Bounds read earlier for this configuration, already checked against the control's current value.
+	if ( ( NULL != mConfigDictionary ) && mConfigDictionary->getCachedControlRange ( VOLUME_CONTROL, unitID, channelNumber, target, NULL, NULL ) )
+	{
+		result = kIOReturnSuccess;
+		goto Exit;
+	}
+
 	if ( IP_VERSION_02_00 == mControlInterface->GetInterfaceProtocol() )
 	{
 		SubRange16 subRange;
@@ -3612,6 +4106,13 @@ IOReturn AppleUSBAudioDevice::getVolumeResolution (UInt8 unitID, UInt8 channelNu
 	result = kIOReturnError;
 	FailIf (NULL == mControlInterface, Exit);
 
+	// Bounds read earlier for this configuration, already checked against the control's current value.
+	if ( ( NULL != mConfigDictionary ) && mConfigDictionary->getCachedControlRange ( VOLUME_CONTROL, unitID, channelNumber, NULL, NULL, target ) )
+	{
+		result = kIOReturnSuccess;
+		goto Exit;
+	}
+
 	if ( IP_VERSION_02_00 == mControlInterface->GetInterfaceProtocol() )
 	{
 		SubRange16 subRange;
@@ -3632,8 +4133,384 @@ Exit:
 	return result;
 }
 
-IOReturn AppleUSBAudioDevice::setCurVolume (UInt8 unitID, UInt8 channelNumber, SInt16 volume) {
-	return setFeatureUnitSetting (VOLUME_CONTROL, unitID, channelNumber, SET_CUR, volume, 2);
+// Fetches the current value, bounds and resolution of the volume control on each of the given channels. Bounds already read for this
+// configuration come from mConfigDictionary, and only the current value is read for those channels. A current value that is neither
+// negative infinity nor within the cached bounds means the cache is stale, so that channel is dropped from it and queried in full.
+// A channel's outcome is in its settings[].result; the resolution is left at 0 if only GET_RES failed, for the caller to judge.
+IOReturn AppleUSBAudioDevice::getVolumeSettingsForChannels (UInt8 unitID, UInt32 numChannels, const UInt8 * channels, AUAVolumeSettings * settings) {
+	UInt8 *								queryChannels = NULL;
+	UInt32 *							queryIndices = NULL;
+	AUAVolumeSettings *					querySettings = NULL;
+	UInt32								numQueryChannels;
+	UInt32								channelIndex;
+	UInt32								queryIndex;
+	bool								fullQuery;
+	IOReturn							result;
+
+	result = kIOReturnError;
+	FailIf (NULL == channels, Exit);
+	FailIf (NULL == settings, Exit);
+	if (NULL == mConfigDictionary)
+	{
+		result = queryVolumeSettings (unitID, numChannels, channels, settings, false);
+		goto Exit;
+	}
+	for (channelIndex = 0; channelIndex < numChannels; channelIndex++)
+	{
+		settings[channelIndex].result = kIOReturnError;
+		settings[channelIndex].setResult = kIOReturnError;
+		settings[channelIndex].resolution = 0;
+	}
+	if (0 == numChannels)
+	{
+		result = kIOReturnSuccess;
+		goto Exit;
+	}
+
+	FailIf (NULL == (queryChannels = (UInt8 *)IOMalloc (numChannels * sizeof (UInt8))), Exit);
+	FailIf (NULL == (queryIndices = (UInt32 *)IOMalloc (numChannels * sizeof (UInt32))), Exit);
+	FailIf (NULL == (querySettings = (AUAVolumeSettings *)IOMalloc (numChannels * sizeof (AUAVolumeSettings))), Exit);
+
+	// The first pass reads the current value of the channels with cached bounds, the second queries whatever is left in full.
+	for (fullQuery = false; ; fullQuery = true)
+	{
+		numQueryChannels = 0;
+		for (channelIndex = 0; channelIndex < numChannels; channelIndex++)
+		{
+			if (kIOReturnSuccess == settings[channelIndex].result)
+			{
+				continue;
+			}
+			if	(		fullQuery
+					||	mConfigDictionary->getCachedControlRange (VOLUME_CONTROL, unitID, channels[channelIndex], &settings[channelIndex].min, &settings[channelIndex].max, &settings[channelIndex].resolution, true))
+			{
+				queryChannels[numQueryChannels] = channels[channelIndex];
+				queryIndices[numQueryChannels] = channelIndex;
+				numQueryChannels++;
+			}
+		}
+		if (0 != numQueryChannels)
+		{
+			FailIf (kIOReturnSuccess != (result = queryVolumeSettings (unitID, numQueryChannels, queryChannels, querySettings, !fullQuery)), Exit);
+		}
+		for (queryIndex = 0; queryIndex < numQueryChannels; queryIndex++)
+		{
+			AUAVolumeSettings *		channelSettings = &settings[queryIndices[queryIndex]];
+
+			if (kIOReturnSuccess != querySettings[queryIndex].result)
+			{
+				continue;
+			}
+			channelSettings->cur = querySettings[queryIndex].cur;
+			if (fullQuery)
+			{
+				channelSettings->min = querySettings[queryIndex].min;
+				channelSettings->max = querySettings[queryIndex].max;
+				channelSettings->resolution = querySettings[queryIndex].resolution;
+				channelSettings->result = kIOReturnSuccess;
+				if (0 != channelSettings->resolution)
+				{
+					mConfigDictionary->setCachedControlRange (VOLUME_CONTROL, unitID, queryChannels[queryIndex], channelSettings->min, channelSettings->max, channelSettings->resolution);
+				}
+			}
+			else if (		((SInt16) kNegativeInfinity == channelSettings->cur)
+						||	((channelSettings->cur >= channelSettings->min) && (channelSettings->cur <= channelSettings->max)))
+			{
+				channelSettings->result = kIOReturnSuccess;
+				mConfigDictionary->setCachedControlRangeChecked (VOLUME_CONTROL, unitID, queryChannels[queryIndex]);
+			}
+			else
+			{
+				mConfigDictionary->invalidateCachedControlRange (VOLUME_CONTROL, unitID, queryChannels[queryIndex]);
+				channelSettings->resolution = 0;
+			}
+		}
+		if (fullQuery)
+		{
+			break;
+		}
+	}
+	result = kIOReturnSuccess;
+
+Exit:
+	if (NULL != querySettings)
+	{
+		IOFree (querySettings, numChannels * sizeof (AUAVolumeSettings));
+	}
+	if (NULL != queryIndices)
+	{
+		IOFree (queryIndices, numChannels * sizeof (UInt32));
+	}
+	if (NULL != queryChannels)
+	{
+		IOFree (queryChannels, numChannels * sizeof (UInt8));
+	}
+	return result;
+}
+
+// Reads the volume control on each of the given channels, keeping up to kAUAMaxBatchedControlRequests requests in flight at a time.
+// That is GET_CUR, GET_MIN, GET_MAX and GET_RES per channel on a USB-Audio 1.0 device and CUR and RANGE on a USB-Audio 2.0 device,
+// or just the current value if currentOnly is set. Every batch lands in the same reply buffer, which is carved into per-request views
+// once up front.
+IOReturn AppleUSBAudioDevice::queryVolumeSettings (UInt8 unitID, UInt32 numChannels, const UInt8 * channels, AUAVolumeSettings * settings, bool currentOnly) {
+	IOUSBDevRequestDesc					devReqs[kAUAMaxBatchedControlRequests];
+	IOReturn							results[kAUAMaxBatchedControlRequests];
+	IOSubMemoryDescriptor *				replyDescs[kAUAMaxBatchedControlRequests];
+	IOBufferMemoryDescriptor *			replyBuffer = NULL;
+	UInt8 *								replyBytes;
+	UInt8								requestTypes[4];
+	UInt16								replyOffsets[4];
+	UInt16								replyLengths[4];
+	UInt16								setting;
+	struct {
+	UInt16								wNumSubRanges;
+	SubRange16							subRanges[1];
+	}									rangeSetting;
+	UInt32								requestsPerChannel;
+	UInt32								replyBytesPerChannel;
+	UInt32								channelsPerBatch;
+	UInt32								firstChannel;
+	UInt32								numBatchChannels;
+	UInt32								channelIndex;
+	UInt32								requestIndex;
+	UInt32								descIndex;
+	bool								isUAC2;
+	IOReturn							result;
+
+	result = kIOReturnError;
+	bzero (replyDescs, sizeof (replyDescs));
+	FailIf (NULL == channels, Exit);
+	FailIf (NULL == settings, Exit);
+	FailIf (NULL == mControlInterface, Exit);
+	for (channelIndex = 0; channelIndex < numChannels; channelIndex++)
+	{
+		settings[channelIndex].result = kIOReturnError;
+		settings[channelIndex].setResult = kIOReturnError;
+		settings[channelIndex].resolution = 0;
+	}
+	if (0 == numChannels)
+	{
+		result = kIOReturnSuccess;
+		goto Exit;
+	}
+
+	isUAC2 = ( IP_VERSION_02_00 == mControlInterface->GetInterfaceProtocol() );
+	if (isUAC2)
+	{
+		requestsPerChannel = 2;
+		requestTypes[0] = USBAUDIO_0200::CUR;
+		replyOffsets[0] = 0;
+		replyLengths[0] = 2;
+		requestTypes[1] = USBAUDIO_0200::RANGE;
+		replyOffsets[1] = 2;
+		replyLengths[1] = sizeof (rangeSetting);
+	}
+	else
+	{
+		requestsPerChannel = 4;
+		requestTypes[0] = GET_CUR;
+		requestTypes[1] = GET_MIN;
+		requestTypes[2] = GET_MAX;
+		requestTypes[3] = GET_RES;
+		for (requestIndex = 0; requestIndex < 4; requestIndex++)
+		{
+			replyOffsets[requestIndex] = requestIndex * 2;
+			replyLengths[requestIndex] = 2;
+		}
+	}
+	if (currentOnly)
+	{
+		requestsPerChannel = 1;
+	}
+	replyBytesPerChannel = replyOffsets[requestsPerChannel - 1] + replyLengths[requestsPerChannel - 1];
+	channelsPerBatch = kAUAMaxBatchedControlRequests / requestsPerChannel;
+	if (channelsPerBatch > numChannels)
+	{
+		channelsPerBatch = numChannels;
+	}
+
+	FailIf (NULL == (replyBuffer = IOBufferMemoryDescriptor::withOptions (kIODirectionIn, channelsPerBatch * replyBytesPerChannel)), Exit);
+	for (channelIndex = 0; channelIndex < channelsPerBatch; channelIndex++)
+	{
+		for (requestIndex = 0; requestIndex < requestsPerChannel; requestIndex++)
+		{
+			descIndex = channelIndex * requestsPerChannel + requestIndex;
+			replyDescs[descIndex] = IOSubMemoryDescriptor::withSubRange (replyBuffer, channelIndex * replyBytesPerChannel + replyOffsets[requestIndex], replyLengths[requestIndex], kIODirectionIn);
+			FailIf (NULL == replyDescs[descIndex], Exit);
+		}
+	}
+	replyBytes = (UInt8 *)replyBuffer->getBytesNoCopy ();
+
+	for (firstChannel = 0; firstChannel < numChannels; firstChannel += numBatchChannels)
+	{
+		numBatchChannels = numChannels - firstChannel;
+		if (numBatchChannels > channelsPerBatch)
+		{
+			numBatchChannels = channelsPerBatch;
+		}
+		bzero (replyBytes, channelsPerBatch * replyBytesPerChannel);
+		for (channelIndex = 0; channelIndex < numBatchChannels; channelIndex++)
+		{
+			for (requestIndex = 0; requestIndex < requestsPerChannel; requestIndex++)
+			{
+				descIndex = channelIndex * requestsPerChannel + requestIndex;
+				devReqs[descIndex].bmRequestType = USBmakebmRequestType (kUSBIn, kUSBClass, kUSBInterface);
+				devReqs[descIndex].bRequest = requestTypes[requestIndex];
+				devReqs[descIndex].wValue = (VOLUME_CONTROL << 8) | channels[firstChannel + channelIndex];
+				devReqs[descIndex].wIndex = (0xFF00 & (unitID << 8)) | (0x00FF & mControlInterface->GetInterfaceNumber ());
+				devReqs[descIndex].wLength = replyLengths[requestIndex];
+				devReqs[descIndex].pData = replyDescs[descIndex];
+			}
+		}
+
+		FailIf (kIOReturnSuccess != (result = deviceRequestBatch (devReqs, results, numBatchChannels * requestsPerChannel)), Exit);
+
+		for (channelIndex = 0; channelIndex < numBatchChannels; channelIndex++)
+		{
+			AUAVolumeSettings *		channelSettings = &settings[firstChannel + channelIndex];
+			IOReturn *				channelResults = &results[channelIndex * requestsPerChannel];
+			UInt8 *					channelReply = replyBytes + channelIndex * replyBytesPerChannel;
+
+			// Only the current value and the bounds have to be there.
+			if (kIOReturnSuccess != (channelSettings->result = channelResults[0]))
+			{
+				continue;
+			}
+			memcpy (&setting, channelReply + replyOffsets[0], 2);
+			channelSettings->cur = USBToHostWord (setting);
+			if (currentOnly)
+			{
+				continue;
+			}
+			if (kIOReturnSuccess != (channelSettings->result = channelResults[1]))
+			{
+				continue;
+			}
+			if (isUAC2)
+			{
+				memcpy (&rangeSetting, channelReply + replyOffsets[1], sizeof (rangeSetting));
+				if (0 == USBToHostWord (rangeSetting.wNumSubRanges))
+				{
+					channelSettings->result = kIOReturnError;
+					continue;
+				}
+				channelSettings->min = USBToHostWord (rangeSetting.subRanges[0].wMIN);
+				channelSettings->max = USBToHostWord (rangeSetting.subRanges[0].wMAX);
+				channelSettings->resolution = USBToHostWord (rangeSetting.subRanges[0].wRES);
+			}
+			else
+			{
+				if (kIOReturnSuccess != (channelSettings->result = channelResults[2]))
+				{
+					continue;
+				}
+				memcpy (&setting, channelReply + replyOffsets[1], 2);
+				channelSettings->min = USBToHostWord (setting);
+				memcpy (&setting, channelReply + replyOffsets[2], 2);
+				channelSettings->max = USBToHostWord (setting);
+				if (kIOReturnSuccess == channelResults[3])
+				{
+					memcpy (&setting, channelReply + replyOffsets[3], 2);
+					channelSettings->resolution = USBToHostWord (setting);
+				}
+			}
+		}
+	}
+	result = kIOReturnSuccess;
+
+Exit:
+	for (descIndex = 0; descIndex < kAUAMaxBatchedControlRequests; descIndex++)
+	{
+		if (NULL != replyDescs[descIndex])
+		{
+			replyDescs[descIndex]->release ();
+		}
+	}
+	if (NULL != replyBuffer)
+	{
+		replyBuffer->release ();
+	}
+	return result;
+}
+
+// Writes settings[].cur to every channel whose settings[].setCur is true, pipelined the same way as the queries above, and leaves
+// the outcome in settings[].setResult.
+IOReturn AppleUSBAudioDevice::setVolumeForChannels (UInt8 unitID, UInt32 numChannels, const UInt8 * channels, AUAVolumeSettings * settings) {
+	IOUSBDevRequestDesc					devReqs[kAUAMaxBatchedControlRequests];
+	IOReturn							results[kAUAMaxBatchedControlRequests];
+	UInt32								channelIndices[kAUAMaxBatchedControlRequests];
+	IOSubMemoryDescriptor *				valueDescs[kAUAMaxBatchedControlRequests];
+	IOBufferMemoryDescriptor *			valueBuffer = NULL;
+	UInt8 *								valueBytes;
+	UInt16								value;
+	UInt32								channelIndex;
+	UInt32								numRequests;
+	UInt32								descIndex;
+	IOReturn							result;
+
+	result = kIOReturnError;
+	bzero (valueDescs, sizeof (valueDescs));
+	FailIf (NULL == channels, Exit);
+	FailIf (NULL == settings, Exit);
+	FailIf (NULL == mControlInterface, Exit);
+	FailIf (TRUE == isInactive (), Exit);		// In case we've been unplugged during sleep
+
+	FailIf (NULL == (valueBuffer = IOBufferMemoryDescriptor::withOptions (kIODirectionOut, kAUAMaxBatchedControlRequests * 2)), Exit);
+	for (descIndex = 0; descIndex < kAUAMaxBatchedControlRequests; descIndex++)
+	{
+		FailIf (NULL == (valueDescs[descIndex] = IOSubMemoryDescriptor::withSubRange (valueBuffer, descIndex * 2, 2, kIODirectionOut)), Exit);
+	}
+	valueBytes = (UInt8 *)valueBuffer->getBytesNoCopy ();
+
+	channelIndex = 0;
+	while (channelIndex < numChannels)
+	{
+		for (numRequests = 0; channelIndex < numChannels && numRequests < kAUAMaxBatchedControlRequests; channelIndex++)
+		{
+			if (!settings[channelIndex].setCur)
+			{
+				continue;
+			}
+			value = HostToUSBWord (settings[channelIndex].cur);
+			memcpy (valueBytes + numRequests * 2, &value, 2);
+			devReqs[numRequests].bmRequestType = USBmakebmRequestType (kUSBOut, kUSBClass, kUSBInterface);
+			devReqs[numRequests].bRequest = SET_CUR;
+			devReqs[numRequests].wValue = (VOLUME_CONTROL << 8) | channels[channelIndex];
+			devReqs[numRequests].wIndex = (0xFF00 & (unitID << 8)) | (0x00FF & mControlInterface->GetInterfaceNumber ());
+			devReqs[numRequests].wLength = 2;
+			devReqs[numRequests].pData = valueDescs[numRequests];
+			channelIndices[numRequests] = channelIndex;
+			numRequests++;
+		}
+		if (0 == numRequests)
+		{
+			break;
+		}
+		FailIf (kIOReturnSuccess != (result = deviceRequestBatch (devReqs, results, numRequests)), Exit);
+		for (descIndex = 0; descIndex < numRequests; descIndex++)
+		{
+			settings[channelIndices[descIndex]].setResult = results[descIndex];
+		}
+	}
+	result = kIOReturnSuccess;
+
+Exit:
+	for (descIndex = 0; descIndex < kAUAMaxBatchedControlRequests; descIndex++)
+	{
+		if (NULL != valueDescs[descIndex])
+		{
+			valueDescs[descIndex]->release ();
+		}
+	}
+	if (NULL != valueBuffer)
+	{
+		valueBuffer->release ();
+	}
+	return result;
+}
+
+IOReturn AppleUSBAudioDevice::setCurVolume (UInt8 unitID, UInt8 channelNumber, SInt16 volume) {
+	return setFeatureUnitSetting (VOLUME_CONTROL, unitID, channelNumber, SET_CUR, volume, 2);
 }
 
 IOReturn AppleUSBAudioDevice::setCurMute (UInt8 unitID, UInt8 channelNumber, SInt16 mute) {
@@ -3696,10 +4573,6 @@ IOReturn AppleUSBAudioDevice::doSelectorControlChange (IOAudioControl * audioCon
 
 IOReturn AppleUSBAudioDevice::doVolumeControlChange (IOAudioControl * audioControl, SInt32 oldValue, SInt32 newValue) {
 	IOReturn							result;
-	SInt16								newVolume;
-	SInt16								deviceMin;
-	SInt16								offset;
-	UInt16								volRes;
 	UInt8								unitID;
 	UInt8								channelNum;
 
@@ -3711,22 +4584,10 @@ IOReturn AppleUSBAudioDevice::doVolumeControlChange (IOAudioControl * audioContr
 	if (    (kIOAudioControlUsageInput == audioControl->getUsage())
 	     || (FALSE == mDeviceIsInMonoMode))
 	{
-		getMinVolume (unitID, channelNum, &deviceMin);
-		offset = -deviceMin;
-
-		if (newValue < 0) 
+		if (kIOReturnSuccess != (result = queueControlChange (VOLUME_CONTROL, unitID, channelNum, newValue)))
 		{
-			newVolume = 0x8000;
-		} 
-		else 
-		{
-			getVolumeResolution (unitID, channelNum, &volRes);
-			newVolume = (newValue * volRes) - offset;						//	<rdar://6377425>
+			result = sendVolumeChange (unitID, channelNum, newValue);
 		}
-
-		debugIOLog ("? AppleUSBAudioDevice[%p]::doVolumeControlChange () - Setting channel %d (unit %d) volume to 0x%x", this, channelNum, unitID, newVolume);
-		result = setCurVolume (unitID, channelNum, HostToUSBWord (newVolume));
-	
 	}
 	else
 	{	// mono output case
@@ -3736,21 +4597,10 @@ IOReturn AppleUSBAudioDevice::doVolumeControlChange (IOAudioControl * audioContr
 		for (i = 0; i < mMonoControlsArray->getCount (); i++)
 		{
 			channelNum = ((OSNumber *) mMonoControlsArray->getObject(i))->unsigned8BitValue ();
-			getMinVolume (unitID, channelNum, &deviceMin);
-			offset = -deviceMin;
-		
-			if (newValue < 0) 
-			{
-				newVolume = 0x8000;
-			} 
-			else 
+			if (kIOReturnSuccess != (result = queueControlChange (VOLUME_CONTROL, unitID, channelNum, newValue)))
 			{
-				getVolumeResolution (unitID, channelNum, &volRes);
-				newVolume = (newValue * volRes) - offset;						//	<rdar://6377425>
+				result = sendVolumeChange (unitID, channelNum, newValue);
 			}
-		
-			result = setCurVolume (unitID, channelNum, HostToUSBWord (newVolume));
-			debugIOLog ("? AppleUSBAudioDevice[%p]::doVolumeControlChange () - Set volume for channel %d to 0x%x = %d", this, channelNum, newVolume, result);
 		}
 	}
 	
@@ -3759,6 +4609,32 @@ Exit:
 	return result;
 }
 
+// Converts a volume control value to the device's units and writes it to the device.
+IOReturn AppleUSBAudioDevice::sendVolumeChange (UInt8 unitID, UInt8 channelNum, SInt32 newValue) {
+	IOReturn							result;
+	SInt16								newVolume;
+	SInt16								deviceMin;
+	SInt16								offset;
+	UInt16								volRes;
+
+	getMinVolume (unitID, channelNum, &deviceMin);
+	offset = -deviceMin;
+
+	if (newValue < 0) 
+	{
+		newVolume = 0x8000;
+	} 
+	else 
+	{
+		getVolumeResolution (unitID, channelNum, &volRes);
+		newVolume = (newValue * volRes) - offset;						//	<rdar://6377425>
+	}
+
+	debugIOLog ("? AppleUSBAudioDevice[%p]::sendVolumeChange () - Setting channel %d (unit %d) volume to 0x%x", this, channelNum, unitID, newVolume);
+	result = setCurVolume (unitID, channelNum, HostToUSBWord (newVolume));
+	return result;
+}
+
 IOReturn AppleUSBAudioDevice::doToggleControlChange (IOAudioControl * audioControl, SInt32 oldValue, SInt32 newValue) {
 	IOReturn							result;
 	UInt8								unitID;
@@ -3771,13 +4647,303 @@ IOReturn AppleUSBAudioDevice::doToggleControlChange (IOAudioControl * audioContr
 
 	debugIOLog ("? AppleUSBAudioDevice[%p]::doToggleControlChange( %p, 0x%x, 0x%x ) - unitID = %d, channelNum = %d", this, audioControl, oldValue, newValue, unitID, channelNum);
 
-	result = setCurMute (unitID, channelNum, HostToUSBWord (newValue));
+	if (kIOReturnSuccess != (result = queueControlChange (MUTE_CONTROL, unitID, channelNum, newValue)))
+	{
+		result = setCurMute (unitID, channelNum, HostToUSBWord (newValue));
+	}
 
 	debugIOLog ("- AppleUSBAudioDevice[%p]::doToggleControlChange( %p, 0x%x, 0x%x ) = 0x%x", this, audioControl, oldValue, newValue, kIOReturnSuccess);
 
 	return result;
 }
 
+// Records the latest value for a control and makes sure a flush is on its way. A value that replaces one still waiting to be
+// sent is a request saved. Returns an error if the change can't be held, in which case the caller sends it itself. A request that an
+// earlier flush failed to send is reported this way too: the change after it isn't held, so the caller writes it directly and returns
+// the device's answer to IOAudioFamily rather than a success for a control that may have stopped responding.
+IOReturn AppleUSBAudioDevice::queueControlChange (UInt8 controlSelector, UInt8 unitID, UInt8 channelNum, SInt32 newValue) {
+	AUACoalescedControl *				control = NULL;
+	AbsoluteTime						deadline;
+	UInt32								controlIndex;
+	IOReturn							result = kIOReturnError;
+
+	FailIf (NULL == mCoalescedControlsLock, Exit);
+
+	IOLockLock (mCoalescedControlsLock);
+	if (kIOReturnSuccess != mControlFlushError)
+	{
+		debugIOLog ("! AppleUSBAudioDevice[%p]::queueControlChange () - Sending directly after a flush failed with 0x%x", this, mControlFlushError);
+		result = mControlFlushError;
+		mControlFlushError = kIOReturnSuccess;
+		IOLockUnlock (mCoalescedControlsLock);
+		goto Exit;
+	}
+	for (controlIndex = 0; NULL != mFlushControlChangesThread && controlIndex < mNumCoalescedControls; controlIndex++)
+	{
+		if	(		(mCoalescedControls[controlIndex].unitID == unitID)
+				&&	(mCoalescedControls[controlIndex].channelNum == channelNum)
+				&&	(mCoalescedControls[controlIndex].controlSelector == controlSelector))
+		{
+			control = &mCoalescedControls[controlIndex];
+			break;
+		}
+	}
+	if (NULL == control && NULL != mFlushControlChangesThread && mNumCoalescedControls < kAUAMaxCoalescedControls)
+	{
+		control = &mCoalescedControls[mNumCoalescedControls++];
+		control->unitID = unitID;
+		control->channelNum = channelNum;
+		control->controlSelector = controlSelector;
+		control->pending = false;
+	}
+	if (NULL != control)
+	{
+		if (control->pending)
+		{
+			mControlRequestsSaved++;
+		}
+		control->value = newValue;
+		control->pending = true;
+		if (!mControlFlushScheduled)
+		{
+			mControlFlushScheduled = true;
+			clock_interval_to_deadline (kAUAControlFlushInterval, kMillisecondScale, &deadline);
+			retain ();
+			if (TRUE == thread_call_enter_delayed (mFlushControlChangesThread, deadline))
+			{
+				release ();
+			}
+		}
+		result = kIOReturnSuccess;
+	}
+	IOLockUnlock (mCoalescedControlsLock);
+
+Exit:
+	return result;
+}
+
+void AppleUSBAudioDevice::flushControlChangesThread (void * arg) {
+	AppleUSBAudioDevice *				self;
+
+	FailIf (NULL == arg, Exit);
+	self = (AppleUSBAudioDevice *)arg;
+	self->flushControlChanges ();
+	self->release ();
+
+Exit:
+	return;
+}
+
+// Sends the latest value of every pending control. Changes that arrive while the requests are in flight are picked up by the next
+// pass instead of scheduling a flush of their own, so the pipe sees back-to-back requests only while there is something new to say.
+void AppleUSBAudioDevice::flushControlChanges (void) {
+	AUACoalescedControl					pendingControls[kAUAMaxCoalescedControls];
+	UInt32								numPending;
+	UInt32								controlIndex;
+	UInt32								numIssued = 0;
+	UInt32								numFailed = 0;
+	IOReturn							result;
+	IOReturn							lastFailure = kIOReturnSuccess;
+
+	FailIf (NULL == mCoalescedControlsLock, Exit);
+
+	do
+	{
+		numPending = 0;
+		IOLockLock (mCoalescedControlsLock);
+		for (controlIndex = 0; controlIndex < mNumCoalescedControls; controlIndex++)
+		{
+			if (mCoalescedControls[controlIndex].pending)
+			{
+				pendingControls[numPending++] = mCoalescedControls[controlIndex];
+				mCoalescedControls[controlIndex].pending = false;
+			}
+		}
+		if (0 == numPending)
+		{
+			mControlFlushScheduled = false;
+		}
+		IOLockUnlock (mCoalescedControlsLock);
+
+		for (controlIndex = 0; controlIndex < numPending && !mTerminatingDriver; controlIndex++)
+		{
+			if (VOLUME_CONTROL == pendingControls[controlIndex].controlSelector)
+			{
+				result = sendVolumeChange (pendingControls[controlIndex].unitID, pendingControls[controlIndex].channelNum, pendingControls[controlIndex].value);
+			}
+			else
+			{
+				result = setCurMute (pendingControls[controlIndex].unitID, pendingControls[controlIndex].channelNum, HostToUSBWord (pendingControls[controlIndex].value));
+			}
+			if (kIOReturnSuccess != result)
+			{
+				debugIOLog ("! AppleUSBAudioDevice[%p]::flushControlChanges () - Control 0x%x on unit %d channel %d failed to take value 0x%x: 0x%x", this, pendingControls[controlIndex].controlSelector, pendingControls[controlIndex].unitID, pendingControls[controlIndex].channelNum, pendingControls[controlIndex].value, result);
+				lastFailure = result;
+				numFailed++;
+			}
+			numIssued++;
+		}
+	} while (0 != numPending);
+
+	IOLockLock (mCoalescedControlsLock);
+	mControlRequestsIssued += numIssued;
+	if (0 != numFailed)
+	{
+		mControlRequestsFailed += numFailed;
+		mControlLastFailure = lastFailure;
+		mControlFlushError = lastFailure;
+	}
+	IOLockUnlock (mCoalescedControlsLock);
+	if (0 != numIssued)
+	{
+		publishControlCoalescingStatistics ();
+	}
+
+Exit:
+	return;
+}
+
+void AppleUSBAudioDevice::cancelControlChanges (void) {
+	thread_call_t						flushThread = NULL;
+
+	// Once the thread is gone queueControlChange () stops holding changes and its callers send them directly.
+	if (NULL != mCoalescedControlsLock)
+	{
+		IOLockLock (mCoalescedControlsLock);
+		flushThread = mFlushControlChangesThread;
+		mFlushControlChangesThread = NULL;
+		IOLockUnlock (mCoalescedControlsLock);
+	}
+	if (NULL != flushThread)
+	{
+		// A flush that was still waiting to run holds a reference that it will now never drop itself.
+		if (TRUE == thread_call_cancel (flushThread))
+		{
+			release ();
+		}
+		thread_call_free (flushThread);
+	}
+}
+
+void AppleUSBAudioDevice::publishControlCoalescingStatistics (void) {
+	OSDictionary *						statistics = NULL;
+	OSNumber *							number = NULL;
+	UInt32								issued;
+	UInt32								saved;
+	UInt32								failed;
+	IOReturn							lastFailure;
+
+	FailIf (NULL == mCoalescedControlsLock, Exit);
+	IOLockLock (mCoalescedControlsLock);
+	issued = mControlRequestsIssued;
+	saved = mControlRequestsSaved;
+	failed = mControlRequestsFailed;
+	lastFailure = mControlLastFailure;
+	IOLockUnlock (mCoalescedControlsLock);
+
+	FailIf (NULL == (statistics = OSDictionary::withCapacity (4)), Exit);
+	FailIf (NULL == (number = OSNumber::withNumber (issued, 32)), Exit);
+	statistics->setObject (kControlRequestsIssuedKey, number);
+	number->release ();
+	FailIf (NULL == (number = OSNumber::withNumber (saved, 32)), Exit);
+	statistics->setObject (kControlRequestsSavedKey, number);
+	number->release ();
+	FailIf (NULL == (number = OSNumber::withNumber (failed, 32)), Exit);
+	statistics->setObject (kControlRequestsFailedKey, number);
+	number->release ();
+	FailIf (NULL == (number = OSNumber::withNumber ((UInt32)lastFailure, 32)), Exit);
+	statistics->setObject (kControlLastFailureKey, number);
+	number->release ();
+	setProperty (kControlCoalescingKey, statistics);
+
+Exit:
+	if (NULL != statistics)
+	{
+		statistics->release ();
+	}
+}
+
+// Fills the control buffer pool. A buffer that can't be allocated is left out of the pool, and transfers simply allocate their own.
+void AppleUSBAudioDevice::allocateControlBuffers (void) {
+	UInt32								bufferIndex;
+	UInt32								freeBuffers = 0;
+
+	for (bufferIndex = 0; bufferIndex < kAUAControlBufferPoolSize; bufferIndex++)
+	{
+		if (NULL == mControlBuffers[bufferIndex])
+		{
+			mControlBuffers[bufferIndex] = IOBufferMemoryDescriptor::withOptions (kIODirectionInOut, kAUAControlBufferSize);
+		}
+		if (NULL != mControlBuffers[bufferIndex])
+		{
+			freeBuffers |= (1 << bufferIndex);
+		}
+	}
+	mFreeControlBuffers = freeBuffers;
+}
+
+// Must not be called while control transfers can still be made.
+void AppleUSBAudioDevice::freeControlBuffers (void) {
+	UInt32								bufferIndex;
+
+	mFreeControlBuffers = 0;
+	for (bufferIndex = 0; bufferIndex < kAUAControlBufferPoolSize; bufferIndex++)
+	{
+		if (NULL != mControlBuffers[bufferIndex])
+		{
+			mControlBuffers[bufferIndex]->release ();
+			mControlBuffers[bufferIndex] = NULL;
+		}
+	}
+}
+
+// Hands out a buffer of length bytes for one control transfer, taking a free pool buffer when there is one. Claiming a buffer is a
+// single compare and swap on the free mask, so this is safe to call from any thread without a lock. Give the buffer back with
+// releaseControlBuffer () once the transfer has completed.
+IOBufferMemoryDescriptor * AppleUSBAudioDevice::acquireControlBuffer (IODirection direction, UInt16 length) {
+	IOBufferMemoryDescriptor *			buffer = NULL;
+	UInt32								freeBuffers;
+	UInt32								bufferIndex;
+
+	if (length <= kAUAControlBufferSize)
+	{
+		while (0 != (freeBuffers = mFreeControlBuffers))
+		{
+			for (bufferIndex = 0; 0 == (freeBuffers & (1 << bufferIndex)); bufferIndex++)
+			{
+			}
+			if (OSCompareAndSwap (freeBuffers, freeBuffers & ~(1 << bufferIndex), &mFreeControlBuffers))
+			{
+				buffer = mControlBuffers[bufferIndex];
+				buffer->setLength (length);
+				break;
+			}
+		}
+	}
+	if (NULL == buffer)
+	{
+		buffer = IOBufferMemoryDescriptor::withOptions (direction, length);
+	}
+	return buffer;
+}
+
+void AppleUSBAudioDevice::releaseControlBuffer (IOBufferMemoryDescriptor * buffer) {
+	UInt32								bufferIndex;
+
+	if (NULL != buffer)
+	{
+		for (bufferIndex = 0; bufferIndex < kAUAControlBufferPoolSize; bufferIndex++)
+		{
+			if (buffer == mControlBuffers[bufferIndex])
+			{
+				OSBitOrAtomic ((1 << bufferIndex), &mFreeControlBuffers);
+				return;
+			}
+		}
+		buffer->release ();
+	}
+}
+
 IOReturn AppleUSBAudioDevice::doPassThruSelectorChange (IOAudioControl * audioControl, SInt32 oldValue, SInt32 newValue) {
 	AppleUSBAudioEngine *				usbAudioEngine;
 	OSArray *							playThroughPaths;
@@ -4636,7 +5802,7 @@ UInt8 AppleUSBAudioDevice::getSelectorSetting (UInt8 selectorID) {
 	setting = 0;
 	FailIf (NULL == mControlInterface, Exit);
 
-	settingDesc = IOBufferMemoryDescriptor::withOptions (kIODirectionIn, 1);
+	settingDesc = acquireControlBuffer (kIODirectionIn, 1);
 	FailIf (NULL == settingDesc, Exit);
 
     devReq.bmRequestType = USBmakebmRequestType (kUSBIn, kUSBClass, kUSBInterface);
@@ -4653,7 +5819,7 @@ UInt8 AppleUSBAudioDevice::getSelectorSetting (UInt8 selectorID) {
 Exit:
 	if (NULL != settingDesc) 
 	{
-		settingDesc->release ();
+		releaseControlBuffer (settingDesc);
 	}
 	return setting;
 }
@@ -4666,8 +5832,9 @@ IOReturn AppleUSBAudioDevice::setSelectorSetting (UInt8 selectorID, UInt8 settin
 	result = kIOReturnError;
 	FailIf (NULL == mControlInterface, Exit);
 
-	settingDesc = IOBufferMemoryDescriptor::withBytes (&setting, 1, kIODirectionIn);
+	settingDesc = acquireControlBuffer (kIODirectionOut, 1);
 	FailIf (NULL == settingDesc, Exit);
+	memcpy (settingDesc->getBytesNoCopy (), &setting, 1);
 
     devReq.bmRequestType = USBmakebmRequestType (kUSBOut, kUSBClass, kUSBInterface);
     devReq.bRequest = SET_CUR;
@@ -4681,7 +5848,7 @@ IOReturn AppleUSBAudioDevice::setSelectorSetting (UInt8 selectorID, UInt8 settin
 Exit:
 	if (NULL != settingDesc) 
 	{
-		settingDesc->release ();
+		releaseControlBuffer (settingDesc);
 	}
 	return result;
 }
@@ -4711,7 +5878,6 @@ Exit:
 // [rdar://4867843]
 OSArray * AppleUSBAudioDevice::getOptimalClockPath ( AppleUSBAudioEngine * thisEngine, UInt8 streamInterface, UInt8 altSetting, UInt32 sampleRate, Boolean * otherEngineNeedSampleRateChange, UInt8 * clockPathGroupIndex )	//	<rdar://5811247>
 {
-	OSNumber *						clockSourceIDNumber = NULL;
 	OSArray *						pathGroupArray = NULL;
 	OSArray *						pathArray = NULL;
 	OSArray *						optimalPathArray = NULL;
@@ -4730,27 +5896,7 @@ OSArray * AppleUSBAudioDevice::getOptimalClockPath ( AppleUSBAudioEngine * thisE
 	debugIOLog (" ? AppleUSBAudioDevice::getOptimalClockPath () - interface %d, alt setting %d, clock source ID %d", streamInterface, altSetting, clockSourceID );
 	
 	// Find the path group that begins with the clockSourceID.
-	for ( UInt8 pathGroupIndex = 0; pathGroupIndex < mClockGraph->getCount (); pathGroupIndex++ )
-	{
-		FailIf ( NULL == ( pathGroupArray = OSDynamicCast ( OSArray, mClockGraph->getObject ( pathGroupIndex ) ) ), Exit );
-		FailIf ( NULL == ( pathArray = OSDynamicCast ( OSArray, pathGroupArray->getObject ( 0 ) ) ), Exit );
-		FailIf ( NULL == ( clockSourceIDNumber = OSDynamicCast ( OSNumber, pathArray->getObject ( 0 ) ) ), Exit );
-		if ( clockSourceID == clockSourceIDNumber->unsigned8BitValue () )
-		{
-			// We have found the path group in which we are interested.
-			//	<rdar://5811247>
-			if ( NULL != clockPathGroupIndex )
-			{
-				*clockPathGroupIndex = pathGroupIndex;
-			}
-			break;
-		}
-		else
-		{
-			pathGroupArray = NULL;
-		}
-	}
-	FailIf ( NULL == pathGroupArray, Exit );
+	FailIf ( NULL == ( pathGroupArray = findClockPathGroup ( clockSourceID, clockPathGroupIndex ) ), Exit );	//	<rdar://5811247>
 
 	// For each path in the path group, determine if it supported the requested sample rate.
 	for ( pathIndex = 0; pathIndex < pathGroupArray->getCount (); pathIndex++ )
@@ -4789,9 +5935,7 @@ Exit:
 
 OSArray * AppleUSBAudioDevice::getClockPathGroup ( UInt8 streamInterface, UInt8 altSetting, UInt8 * clockPathGroupIndex )	//	<rdar://5811247>
 {
-	OSNumber *						clockSourceIDNumber = NULL;
 	OSArray *						pathGroupArray = NULL;
-	OSArray *						pathArray = NULL;
 	UInt8							terminalID;
 	UInt8							clockSourceID;
 	
@@ -4805,27 +5949,7 @@ OSArray * AppleUSBAudioDevice::getClockPathGroup ( UInt8 streamInterface, UInt8
 	debugIOLog (" ? AppleUSBAudioDevice::getClockPathGroup () - interface %d, alt setting %d, clock source ID %d", streamInterface, altSetting, clockSourceID );
 	
 	// Find the path group that begins with the clockSourceID.
-	for ( UInt8 pathGroupIndex = 0; pathGroupIndex < mClockGraph->getCount (); pathGroupIndex++ )
-	{
-		FailIf ( NULL == ( pathGroupArray = OSDynamicCast ( OSArray, mClockGraph->getObject ( pathGroupIndex ) ) ), Exit );
-		FailIf ( NULL == ( pathArray = OSDynamicCast ( OSArray, pathGroupArray->getObject ( 0 ) ) ), Exit );
-		FailIf ( NULL == ( clockSourceIDNumber = OSDynamicCast ( OSNumber, pathArray->getObject ( 0 ) ) ), Exit );
-		if ( clockSourceID == clockSourceIDNumber->unsigned8BitValue () )
-		{
-			// We have found the path group in which we are interested.
-			//	<rdar://5811247>
-			if ( NULL != clockPathGroupIndex )
-			{
-				*clockPathGroupIndex = pathGroupIndex;
-			}
-			break;
-		}
-		else
-		{
-			pathGroupArray = NULL;
-		}
-	}
-	FailIf ( NULL == pathGroupArray, Exit );
+	FailIf ( NULL == ( pathGroupArray = findClockPathGroup ( clockSourceID, clockPathGroupIndex ) ), Exit );	//	<rdar://5811247>
 
 Exit:
 
@@ -4850,6 +5974,203 @@ Exit:
 	return pathGroupArray;
 }
 
+//	Returns the path group of mClockGraph whose paths begin with the given terminal clock entity.
+OSArray * AppleUSBAudioDevice::findClockPathGroup ( UInt8 clockEntityID, UInt8 * clockPathGroupIndex )
+{
+	OSNumber *						clockSourceIDNumber = NULL;
+	OSArray *						pathGroupArray = NULL;
+	OSArray *						pathArray = NULL;
+	UInt8							pathGroupIndex = 0;
+
+	FailIf ( NULL == mClockGraph, Exit );
+	if ( NULL != mClockGraphIndex )
+	{
+		pathGroupIndex = mClockGraphIndex->groupForClockEntity[clockEntityID];
+		if ( kAUANoGraphNode != pathGroupIndex )
+		{
+			pathGroupArray = OSDynamicCast ( OSArray, mClockGraph->getObject ( pathGroupIndex ) );
+		}
+	}
+	else
+	{
+		for ( pathGroupIndex = 0; pathGroupIndex < mClockGraph->getCount (); pathGroupIndex++ )
+		{
+			FailIf ( NULL == ( pathGroupArray = OSDynamicCast ( OSArray, mClockGraph->getObject ( pathGroupIndex ) ) ), Exit );
+			FailIf ( NULL == ( pathArray = OSDynamicCast ( OSArray, pathGroupArray->getObject ( 0 ) ) ), Exit );
+			FailIf ( NULL == ( clockSourceIDNumber = OSDynamicCast ( OSNumber, pathArray->getObject ( 0 ) ) ), Exit );
+			if ( clockEntityID == clockSourceIDNumber->unsigned8BitValue () )
+			{
+				// We have found the path group in which we are interested.
+				break;
+			}
+			else
+			{
+				pathGroupArray = NULL;
+			}
+		}
+	}
+
+	if ( ( NULL != pathGroupArray ) && ( NULL != clockPathGroupIndex ) )
+	{
+		*clockPathGroupIndex = pathGroupIndex;
+	}
+
+Exit:
+	return pathGroupArray;
+}
+
+static void releaseClockGraph ( AUAClockGraph * clockGraph )
+{
+	if ( NULL != clockGraph )
+	{
+		if ( NULL != clockGraph->paths )
+		{
+			IOFree ( clockGraph->paths, ( ( 0 == clockGraph->numPaths ) ? 1 : clockGraph->numPaths ) * sizeof ( OSArray * ) );
+		}
+		if ( NULL != clockGraph->pathMasks )
+		{
+			IOFree ( clockGraph->pathMasks, ( ( 0 == clockGraph->numPaths ) ? 1 : clockGraph->numPaths ) * kAUAGraphMaskWords * sizeof ( UInt32 ) );
+		}
+		if ( NULL != clockGraph->groupMasks )
+		{
+			IOFree ( clockGraph->groupMasks, ( ( 0 == clockGraph->numGroups ) ? 1 : clockGraph->numGroups ) * kAUAGraphMaskWords * sizeof ( UInt32 ) );
+		}
+		IOFree ( clockGraph, sizeof ( AUAClockGraph ) );
+	}
+}
+
+//	Reduces mClockGraph to bitmasks once, so that later clock path queries do not have to walk the OSArray paths element by element.
+IOReturn AppleUSBAudioDevice::buildClockGraphIndex ( void )
+{
+	AUAClockGraph *					clockGraph = NULL;
+	OSArray *						pathGroupArray;
+	OSArray *						pathArray;
+	OSNumber *						clockIDNumber;
+	UInt32 *						pathMask;
+	UInt32 *						groupMask;
+	UInt32							groupIndex;
+	UInt32							pathIndex;
+	UInt32							numPaths;
+	UInt8							clockID;
+	IOReturn						result = kIOReturnError;
+
+	debugIOLog ( "+ AppleUSBAudioDevice[%p]::buildClockGraphIndex ()", this );
+	FailIf ( NULL == mClockGraph, Exit );
+	freeClockGraphIndex ();
+
+	FailIf ( kAUANoGraphNode <= mClockGraph->getCount (), Exit );
+	numPaths = 0;
+	for ( groupIndex = 0; groupIndex < mClockGraph->getCount (); groupIndex++ )
+	{
+		FailIf ( NULL == ( pathGroupArray = OSDynamicCast ( OSArray, mClockGraph->getObject ( groupIndex ) ) ), Exit );
+		numPaths += pathGroupArray->getCount ();
+	}
+
+	FailIf ( NULL == ( clockGraph = ( AUAClockGraph * ) IOMalloc ( sizeof ( AUAClockGraph ) ) ), Exit );
+	bzero ( clockGraph, sizeof ( AUAClockGraph ) );
+	memset ( clockGraph->nodeForClock, kAUANoGraphNode, sizeof ( clockGraph->nodeForClock ) );
+	memset ( clockGraph->groupForClockEntity, kAUANoGraphNode, sizeof ( clockGraph->groupForClockEntity ) );
+	clockGraph->numGroups = mClockGraph->getCount ();
+	clockGraph->numPaths = numPaths;
+	FailIf ( NULL == ( clockGraph->paths = ( OSArray ** ) IOMalloc ( ( ( 0 == numPaths ) ? 1 : numPaths ) * sizeof ( OSArray * ) ) ), Exit );
+	FailIf ( NULL == ( clockGraph->pathMasks = ( UInt32 * ) IOMalloc ( ( ( 0 == numPaths ) ? 1 : numPaths ) * kAUAGraphMaskWords * sizeof ( UInt32 ) ) ), Exit );
+	bzero ( clockGraph->pathMasks, ( ( 0 == numPaths ) ? 1 : numPaths ) * kAUAGraphMaskWords * sizeof ( UInt32 ) );
+	FailIf ( NULL == ( clockGraph->groupMasks = ( UInt32 * ) IOMalloc ( ( ( 0 == clockGraph->numGroups ) ? 1 : clockGraph->numGroups ) * kAUAGraphMaskWords * sizeof ( UInt32 ) ) ), Exit );
+	bzero ( clockGraph->groupMasks, ( ( 0 == clockGraph->numGroups ) ? 1 : clockGraph->numGroups ) * kAUAGraphMaskWords * sizeof ( UInt32 ) );
+
+	pathIndex = 0;
+	for ( groupIndex = 0; groupIndex < clockGraph->numGroups; groupIndex++ )
+	{
+		FailIf ( NULL == ( pathGroupArray = OSDynamicCast ( OSArray, mClockGraph->getObject ( groupIndex ) ) ), Exit );
+		groupMask = &clockGraph->groupMasks[groupIndex * kAUAGraphMaskWords];
+		for ( UInt32 groupPathIndex = 0; groupPathIndex < pathGroupArray->getCount (); groupPathIndex++ )
+		{
+			FailIf ( NULL == ( pathArray = OSDynamicCast ( OSArray, pathGroupArray->getObject ( groupPathIndex ) ) ), Exit );
+			pathMask = &clockGraph->pathMasks[pathIndex * kAUAGraphMaskWords];
+			for ( UInt32 pathItem = 0; pathItem < pathArray->getCount (); pathItem++ )
+			{
+				FailIf ( NULL == ( clockIDNumber = OSDynamicCast ( OSNumber, pathArray->getObject ( pathItem ) ) ), Exit );
+				clockID = clockIDNumber->unsigned8BitValue ();
+				if ( kAUANoGraphNode == clockGraph->nodeForClock[clockID] )
+				{
+					FailIf ( kAUANoGraphNode <= clockGraph->numNodes, Exit );
+					clockGraph->nodeForClock[clockID] = clockGraph->numNodes++;
+				}
+				AUAGraphMaskSet ( pathMask, clockGraph->nodeForClock[clockID] );
+				AUAGraphMaskSet ( groupMask, clockGraph->nodeForClock[clockID] );
+				if ( ( 0 == pathItem ) && ( kAUANoGraphNode == clockGraph->groupForClockEntity[clockID] ) )
+				{
+					clockGraph->groupForClockEntity[clockID] = groupIndex;
+				}
+			}
+			clockGraph->paths[pathIndex++] = pathArray;
+		}
+	}
+
+	debugIOLog ( "? AppleUSBAudioDevice[%p]::buildClockGraphIndex () - %lu clock entities, %lu groups, %lu paths", this, clockGraph->numNodes, clockGraph->numGroups, clockGraph->numPaths );
+	mClockGraphIndex = clockGraph;
+	clockGraph = NULL;
+	result = kIOReturnSuccess;
+
+Exit:
+	releaseClockGraph ( clockGraph );
+	debugIOLog ( "- AppleUSBAudioDevice[%p]::buildClockGraphIndex () = 0x%x", this, result );
+	return result;
+}
+
+void AppleUSBAudioDevice::freeClockGraphIndex ( void )
+{
+	releaseClockGraph ( mClockGraphIndex );
+	mClockGraphIndex = NULL;
+}
+
+//	Returns the index of a path of mClockGraph in the clock graph index, or -1 if the path is not indexed.
+SInt32 AppleUSBAudioDevice::getClockPathIndex ( OSArray * clockPath )
+{
+	if ( ( NULL != mClockGraphIndex ) && ( NULL != clockPath ) )
+	{
+		for ( UInt32 pathIndex = 0; pathIndex < mClockGraphIndex->numPaths; pathIndex++ )
+		{
+			if ( clockPath == mClockGraphIndex->paths[pathIndex] )
+			{
+				return pathIndex;
+			}
+		}
+	}
+	return -1;
+}
+
+//	Collects every clock entity that can clock the stream interface in any of its alternate settings.
+bool AppleUSBAudioDevice::getStreamClockMask ( UInt8 interfaceNum, UInt32 * clockMask )
+{
+	UInt8							numAltSettings = 0;
+	UInt8							pathGroupIndex;
+	bool							startAtZero;
+	bool							result = false;
+
+	FailIf ( NULL == mClockGraphIndex, Exit );
+	FailIf ( NULL == mConfigDictionary, Exit );
+	FailIf ( NULL == clockMask, Exit );
+	bzero ( clockMask, kAUAGraphMaskWords * sizeof ( UInt32 ) );
+	FailIf ( kIOReturnSuccess != mConfigDictionary->getNumAltSettings ( &numAltSettings, interfaceNum ), Exit );
+	startAtZero = mConfigDictionary->alternateSettingZeroCanStream ( interfaceNum );
+
+	for ( UInt8 altSetting = ( startAtZero ? 0 : 1 ); altSetting < numAltSettings; altSetting++ )
+	{
+		if ( ( NULL != getClockPathGroup ( interfaceNum, altSetting, &pathGroupIndex ) ) && ( pathGroupIndex < mClockGraphIndex->numGroups ) )
+		{
+			for ( UInt32 word = 0; word < kAUAGraphMaskWords; word++ )
+			{
+				clockMask[word] |= mClockGraphIndex->groupMasks[pathGroupIndex * kAUAGraphMaskWords + word];
+			}
+		}
+	}
+	result = true;
+
+Exit:
+	return result;
+}
+
 //	<rdar://5811247>
 IOReturn AppleUSBAudioDevice::getClockSelectorIDAndPathIndex (UInt8 * selectorID, UInt8 * pathIndex, OSArray * clockPath) {
 	IOReturn				result;
@@ -4907,49 +6228,16 @@ Exit:
 Boolean AppleUSBAudioDevice::supportSampleRateInClockPath ( OSArray * pathArray, UInt32 sampleRate )
 {
 	Boolean							sampleRateSupported = false;
-	UInt8							numRange;
-	UInt8							rangeIndex;
-	SubRange32						subRange;
+	AUASampleRateRanges				sampleRateRanges = { 0, 0, NULL, NULL };
 	
 	debugIOLog ( "+ AppleUSBAudioDevice[%p]::supportSampleRateInClockPath ()", this );
 
-	FailIf ( kIOReturnSuccess != getNumSampleRatesForClockPath ( &numRange, pathArray ), Exit );
-	
-	for ( rangeIndex = 0; rangeIndex < numRange; rangeIndex++ )
-	{
-		if ( kIOReturnSuccess == getIndexedSampleRatesForClockPath ( &subRange, pathArray, rangeIndex ) )
-		{		
-			// If dRES is not zero, there should be a total of 1 + ( ( dMAX - dMIN ) / dRES ) sample rates including dMIN and dMAX.
-			if ( 0 != subRange.dRES )
-			{
-				// [rdar://5614104] Correct the boundary condition below. 
-				// sampleRateIndex should iterate from 0 to one less than the total number of sample rates.
-				for ( UInt16 sampleRateIndex = 0; sampleRateIndex <= ( ( subRange.dMAX - subRange.dMIN) / subRange.dRES ); sampleRateIndex++ )		// <rdar://7446555>
-				{
-					// [rdar://5614104] Correct the conditional below based on the above change.
-					if ( sampleRate == ( subRange.dMIN + sampleRateIndex * subRange.dRES ) )
-					{
-						sampleRateSupported = true;				
-						break;
-					}
-				}
-			}
-			else
-			{
-				if ( ( sampleRate == subRange.dMIN ) || ( sampleRate == subRange.dMAX ) )
-				{
-					sampleRateSupported = true;				
-				}
-			}
-		}
-		
-		if ( sampleRateSupported )
-		{
-			break;
-		}
-	}
+	// Test the rate against the path's ranges directly rather than stepping through every rate in each range.
+	FailIf ( kIOReturnSuccess != getSampleRateRangesForClockPath ( &sampleRateRanges, pathArray ), Exit );
+	sampleRateSupported = AUASampleRateRangesContain ( &sampleRateRanges, sampleRate );
 	
 Exit:
+	AUASampleRateRangesFree ( &sampleRateRanges );
 	debugIOLog ( "- AppleUSBAudioDevice[%p]::supportSampleRateInClockPath () = %d", this, sampleRateSupported );
 	return sampleRateSupported;
 }
@@ -5006,8 +6294,19 @@ Boolean AppleUSBAudioDevice::clockPathCrossed ( OSArray * clockPathA, OSArray *
 {
 	OSNumber *						clockIDNumberA = NULL;
 	OSNumber *						clockIDNumberB = NULL;
+	SInt32							pathIndexA;
+	SInt32							pathIndexB;
 	Boolean							pathCrossed = false;
 	
+	// Paths taken from mClockGraph are answered from their clock entity masks.
+	pathIndexA = getClockPathIndex ( clockPathA );
+	pathIndexB = ( pathIndexA < 0 ) ? -1 : getClockPathIndex ( clockPathB );
+	if ( pathIndexB >= 0 )
+	{
+		pathCrossed = AUAGraphMaskIntersects ( &mClockGraphIndex->pathMasks[pathIndexA * kAUAGraphMaskWords], &mClockGraphIndex->pathMasks[pathIndexB * kAUAGraphMaskWords] );
+		goto Exit;
+	}
+
 	// Determine it the 2 paths crossed.
 	for ( UInt8 pathItemA = 0; pathItemA < clockPathA->getCount(); pathItemA++ )
 	{
@@ -5038,7 +6337,6 @@ Exit:
 IOReturn AppleUSBAudioDevice::addSampleRatesFromClockSpace ()
 {
 	IOReturn						result = kIOReturnError;
-	OSNumber *						clockSourceIDNumber = NULL;
 	OSNumber *						streamInterfaceNumber = NULL;
 	OSArray *						streamInterfaceNumbers = NULL;
 	OSArray *						pathGroupArray = NULL;
@@ -5074,22 +6372,7 @@ IOReturn AppleUSBAudioDevice::addSampleRatesFromClockSpace ()
 			
 			debugIOLog (" ? AppleUSBAudioDevice::addSampleRatesFromClockSpace () - interface %d, alt setting %d, clock source ID %d", streamInterface, altSettingIndex, clockSourceID );
 			// Find the path group that begins with the clockSourceID.
-			for ( UInt8 pathGroupIndex = 0; pathGroupIndex < mClockGraph->getCount (); pathGroupIndex++ )
-			{
-				FailIf ( NULL == ( pathGroupArray = OSDynamicCast ( OSArray, mClockGraph->getObject ( pathGroupIndex ) ) ), Exit );
-				FailIf ( NULL == ( pathArray = OSDynamicCast ( OSArray, pathGroupArray->getObject ( 0 ) ) ), Exit );
-				FailIf ( NULL == ( clockSourceIDNumber = OSDynamicCast ( OSNumber, pathArray->getObject ( 0 ) ) ), Exit );
-				if ( clockSourceID == clockSourceIDNumber->unsigned8BitValue () )
-				{
-					// We have found the path group in which we are interested.
-					break;
-				}
-				else
-				{
-					pathGroupArray = NULL;
-				}
-			}
-			FailIf ( NULL == pathGroupArray, Exit );
+			FailIf ( NULL == ( pathGroupArray = findClockPathGroup ( clockSourceID ) ), Exit );
 			
 			// For each path in the path group, add the available sample rates.
 			for ( UInt8 pathIndex = 0; pathIndex < pathGroupArray->getCount (); pathIndex++ )
@@ -5110,171 +6393,144 @@ Exit:
 IOReturn AppleUSBAudioDevice::addSampleRatesFromClockPath ( OSArray * path, UInt8 streamInterface, UInt8 altSetting )
 {
 	IOReturn						result = kIOReturnError;
-	OSNumber *						clockSourceNumber;
-	OSObject *						arrayObject = NULL;
-	OSNumber *						arrayNumber = NULL;
-	UInt32							clockIndex;
-	UInt8							clockID;
-	UInt8							subType;
-	UInt16							numerator;
-	UInt16							denominator;
-	UInt32							rateIndex;
-	OSNumber *						rateNumber;
-	OSArray *						rates;
-	OSNumber *						sampleRateNumber;
-	OSArray *						sampleRates;
+	AUASampleRateRanges				sampleRateRanges = { 0, 0, NULL, NULL };
 	
 	debugIOLog ( "+ AppleUSBAudioDevice[%p]::addSampleRatesFromClockPath ( %p, %d, %d )", this, path, streamInterface, altSetting );
 	FailIf ( NULL == path, Exit );
 	FailIf ( NULL == mConfigDictionary, Exit );
 	
-	// First get the samples rates on the clock source, which will be the last element of the path.
-	FailIf ( NULL == ( clockSourceNumber = OSDynamicCast ( OSNumber, path->getLastObject () ) ), Exit );
-	FailIf ( kIOReturnSuccess != getClockSourceSampleRates ( &sampleRates, clockSourceNumber->unsigned8BitValue () ), Exit );
-	
-	// Clock multipliers will modify the available sample rates, so search for them in the path.
-	// [rdar://5600081] Add sample rates via clock multipliers
-	for (clockIndex = path->getCount (); clockIndex > 0 ; clockIndex--) 
-	{
-		FailIf (NULL == (arrayObject = path->getObject (clockIndex - 1)), Exit);
-		FailIf (NULL == (arrayNumber = OSDynamicCast (OSNumber, arrayObject)), Exit);
-		clockID = arrayNumber->unsigned8BitValue();
-		
-		FailIf (kIOReturnSuccess != (result = mConfigDictionary->getSubType (&subType, mControlInterface->GetInterfaceNumber(), 0, clockID)), Exit);
-		
-		if (USBAUDIO_0200::CLOCK_MULTIPLIER == subType)
-		{
-			FailIf (kIOReturnSuccess !=  (result = getCurClockMultiplier (clockID, &numerator, &denominator)), Exit);
-			
-			rates = OSArray::withCapacity ( sampleRates->getCount () );
-			FailIf ( NULL == rates, Exit );
-			
-			for ( rateIndex = 0; rateIndex < sampleRates->getCount (); rateIndex ++ )
-			{
-				sampleRateNumber = OSDynamicCast ( OSNumber, sampleRates->getObject ( rateIndex ) );
-				FailIf ( NULL == sampleRateNumber, Exit );
-				
-				rateNumber = OSNumber::withNumber ( sampleRateNumber->unsigned32BitValue () * numerator / denominator, 32 );
-				FailIf ( NULL == rateNumber, Exit );		
-				
-				rates->setObject ( rateNumber );
-				rates->release ();
-			}
-			
-			if ( NULL != sampleRates )
-			{
-				sampleRates->release ();
-			}
-			sampleRates = rates;
-		}
-	}
+	// [rdar://5600081] The ranges come back with the path's clock multipliers already applied.
+	FailIf ( kIOReturnSuccess != ( result = getSampleRateRangesForClockPath ( &sampleRateRanges, path ) ), Exit );
 		
-	// Add the list of discrete sample rates to the stream dictionary
-	FailIf ( kIOReturnSuccess != ( result = mConfigDictionary->addSampleRatesToStreamDictionary ( sampleRates, streamInterface, altSetting ) ), Exit ); 
+	// The stream dictionary expands only the rates that this alternate setting can carry.
+	FailIf ( kIOReturnSuccess != ( result = mConfigDictionary->addSampleRatesToStreamDictionary ( &sampleRateRanges, streamInterface, altSetting ) ), Exit ); 
 	
 Exit:
-	if ( NULL != sampleRates )
-	{
-		sampleRates->release ();
-	}
+	AUASampleRateRangesFree ( &sampleRateRanges );
 	debugIOLog ( "- AppleUSBAudioDevice[%p]::addSampleRatesFromClockPath ( %p, %d, %d ) = 0x%x", this, path, streamInterface, altSetting, result );
 	return result;
 }
 
-IOReturn AppleUSBAudioDevice::getClockSourceSampleRates ( OSArray ** sampleRates, UInt8 clockSource )
+// A clock source's frequency ranges are read once per configuration and kept in mConfigDictionary. On later calls a single read of the
+// current frequency stands in for the RANGE request: while the clock is valid its rate has to be one of the cached rates, otherwise
+// the cached ranges are dropped and read again.
+IOReturn AppleUSBAudioDevice::getClockSourceSampleRates ( AUASampleRateRanges * sampleRateRanges, UInt8 clockSource )
 {
+	AUASampleRateRanges				clockRanges;
 	IOReturn						result = kIOReturnError;
-	OSNumber *						sampleRateNumber = NULL;
-	SubRange32						subRange;
 	UInt32							sampleRate;
-	UInt16							numSampleRanges;
+	UInt32							rangeIndex;
 	bool							clockIsValid;
-	bool							subRangeIsValid;
 
-	debugIOLog ( "+ AppleUSBAudioDevice[%p]::getClockSourceSampleRates ( %p, %d )", this, sampleRates, clockSource );
+	debugIOLog ( "+ AppleUSBAudioDevice[%p]::getClockSourceSampleRates ( %p, %d )", this, sampleRateRanges, clockSource );
+	bzero ( &clockRanges, sizeof ( AUASampleRateRanges ) );
 	FailIf ( NULL == mConfigDictionary, Exit );
-	FailIf ( NULL == sampleRates, Exit );
+	FailIf ( NULL == sampleRateRanges, Exit );
 	FailIf ( 0 == clockSource, Exit );
 	FailIf ( NULL == mControlInterface, Exit );
-	* sampleRates = NULL;
 	
 	if ( mConfigDictionary->clockSourceHasFrequencyControl ( mControlInterface->GetInterfaceNumber (), 0, clockSource, true ) ||
 		 mConfigDictionary->clockSourceHasFrequencyControl ( mControlInterface->GetInterfaceNumber (), 0, clockSource, false ) )
 	{
-		// Get the number of sample ranges.
-		FailIf ( kIOReturnSuccess != ( result = getNumClockSourceSamplingFrequencySubRanges ( clockSource, &numSampleRanges ) ), Exit ) ;
-		
-		for ( UInt8 sampleRangeIndex = 0; sampleRangeIndex < numSampleRanges; sampleRangeIndex++ )
+		if ( kIOReturnSuccess == mConfigDictionary->getCachedClockSourceRanges ( &clockRanges, clockSource ) )
 		{
-			FailIf ( kIOReturnSuccess != ( result = getIndexedClockSourceSamplingFrequencySubRange ( clockSource, &subRange, sampleRangeIndex ) ), Exit );
-			
-			// [rdar://4952486] Make sure that the device isn't just spewing garbage before trying to add these values.
-			subRangeIsValid = (			( subRange.dMIN <= subRange.dMAX )
-									&&	(		( 0 == subRange.dRES )
-											||	( 0 == ( subRange.dMAX - subRange.dMIN ) % subRange.dRES ) ) );		
-			if ( ! subRangeIsValid )
-			{
-				debugIOLog ( "! AppleUSBAudioDevice[%p]::getClockSourceSampleRates () - invalid subrange, skipping ...", this );
-				debugIOLog ( "    subRange.dMIN = %lu", subRange.dMIN );
-				debugIOLog ( "    subRange.dMAX = %lu", subRange.dMAX );
-				debugIOLog ( "    subRange.dRES = %lu", subRange.dRES );
-				continue;				
-			}
-			
-			// Add the minimum sample rate no matter what.
-			FailWithAction ( NULL == ( sampleRateNumber = OSNumber::withNumber ( subRange.dMIN, SIZEINBITS( sizeof ( UInt32 ) ) ) ), result = kIOReturnError, Exit );
-			if ( * sampleRates )
-			{
-				(* sampleRates)->setObject ( sampleRateNumber );
-			}
-			else
-			{
-				* sampleRates = OSArray::withObjects ( ( const OSObject ** ) &sampleRateNumber, 1 );
-			}
-			
-			sampleRateNumber->release ();
-			sampleRateNumber = NULL;
-			
-			// Add the "middle" sample rates if necessary.
-			// If dRES is not zero, there should be a total of 1 + ( ( dMAX - dMIN ) / dRES ) sample rates including dMIN and dMAX.
-			if ( 0 != subRange.dRES )
-			{
-				for ( UInt16 sampleRateIndex = 0; sampleRateIndex <  ( ( subRange.dMAX - subRange.dMIN) / subRange.dRES ) - 1; sampleRateIndex++ )
-				{
-					sampleRate = subRange.dMIN + ( 1 + sampleRateIndex ) * subRange.dRES;
-					FailWithAction ( NULL == ( sampleRateNumber = OSNumber::withNumber ( sampleRate, SIZEINBITS( sizeof ( UInt32 ) ) ) ), result = kIOReturnError, Exit );
-					(* sampleRates)->setObject ( sampleRateNumber );
-					sampleRateNumber->release ();
-					sampleRateNumber = NULL;
-				}
-			}
-
-			// Add the maximum sample rate if necessary.
-			if	( subRange.dMAX != subRange.dMIN )
+			if	(		( kIOReturnSuccess != getCurClockSourceSamplingFrequency ( clockSource, &sampleRate, &clockIsValid ) )
+					||	( clockIsValid && !AUASampleRateRangesContain ( &clockRanges, sampleRate ) ) )
 			{
-				FailWithAction ( NULL == ( sampleRateNumber = OSNumber::withNumber ( subRange.dMAX, SIZEINBITS( sizeof ( UInt32 ) ) ) ), result = kIOReturnError, Exit );
-				(* sampleRates)->setObject ( sampleRateNumber );
-				sampleRateNumber->release ();
-				sampleRateNumber = NULL;
+				mConfigDictionary->invalidateCachedClockSourceRanges ( clockSource );
+				AUASampleRateRangesFree ( &clockRanges );
 			}
-		}		
+		}
+		if ( 0 == clockRanges.numRanges )
+		{
+			FailIf ( kIOReturnSuccess != ( result = getClockSourceSamplingFrequencySubRanges ( clockSource, &clockRanges ) ), Exit );
+			mConfigDictionary->setCachedClockSourceRanges ( &clockRanges, clockSource );
+		}
+		for ( rangeIndex = 0; rangeIndex < clockRanges.numRanges; rangeIndex++ )
+		{
+			FailIf ( kIOReturnSuccess != ( result = AUASampleRateRangesAdd ( sampleRateRanges, clockRanges.ranges[rangeIndex].dMIN, clockRanges.ranges[rangeIndex].dMAX, clockRanges.ranges[rangeIndex].dRES ) ), Exit );
+		}
 	}
 	else
 	{
 		// There is no frequency control. Get the current sample rate only.
 		FailIf ( kIOReturnSuccess != ( result = getCurClockSourceSamplingFrequency ( clockSource, &sampleRate, &clockIsValid ) ), Exit );
-		FailWithAction ( NULL == ( sampleRateNumber = OSNumber::withNumber ( sampleRate, SIZEINBITS( sizeof ( UInt32 ) ) ) ), result = kIOReturnError, Exit );
-		* sampleRates = OSArray::withObjects ( ( const OSObject ** ) &sampleRateNumber, 1 );
-		sampleRateNumber->release ();
-		sampleRateNumber = NULL;
+		FailIf ( kIOReturnSuccess != ( result = AUASampleRateRangesAdd ( sampleRateRanges, sampleRate, sampleRate, 0 ) ), Exit );
 	}
 	
-	// All sample rates have been added to the array. We are done.
-	
 	result = kIOReturnSuccess;
 	
 Exit:
-	debugIOLog ( "- AppleUSBAudioDevice[%p]::getClockSourceSampleRates ( %p, %d ) = 0x%x", this, sampleRates, clockSource, result );
+	AUASampleRateRangesFree ( &clockRanges );
+	debugIOLog ( "- AppleUSBAudioDevice[%p]::getClockSourceSampleRates ( %p, %d ) = 0x%x", this, sampleRateRanges, clockSource, result );
+	return result;
+}
+
+// Applies a clock multiplier to every range. A range that scales onto an exact grid stays a range; otherwise its rates are scaled
+// one by one, falling back to scaling the bounds as getIndexedSampleRatesForClockPath () does when there are too many to list.
+static IOReturn scaleSampleRateRanges ( AUASampleRateRanges * sampleRateRanges, UInt16 numerator, UInt16 denominator )
+{
+	AUASampleRateRanges				scaledRanges = { 0, 0, NULL, NULL };
+	const SubRange32 *				range;
+	UInt64							numSteps;
+	UInt64							scaledRate;
+	IOReturn						result = kIOReturnError;
+
+	FailIf ( NULL == sampleRateRanges, Exit );
+	FailIf ( 0 == denominator, Exit );
+	
+	for ( UInt32 rangeIndex = 0; rangeIndex < sampleRateRanges->numRanges; rangeIndex++ )
+	{
+		range = &sampleRateRanges->ranges[rangeIndex];
+		if ( ( (UInt64)range->dMAX * numerator / denominator ) > 0xFFFFFFFFULL )
+		{
+			debugIOLog ( "! scaleSampleRateRanges () - range [%lu, %lu] overflows when scaled by %u/%u, skipping ...", range->dMIN, range->dMAX, numerator, denominator );
+			continue;
+		}
+		
+		if ( 0 == range->dRES )
+		{
+			FailIf ( kIOReturnSuccess != AUASampleRateRangesAdd ( &scaledRanges, (UInt32)( (UInt64)range->dMIN * numerator / denominator ), (UInt32)( (UInt64)range->dMIN * numerator / denominator ), 0 ), Exit );
+			FailIf ( kIOReturnSuccess != AUASampleRateRangesAdd ( &scaledRanges, (UInt32)( (UInt64)range->dMAX * numerator / denominator ), (UInt32)( (UInt64)range->dMAX * numerator / denominator ), 0 ), Exit );
+			continue;
+		}
+		
+		numSteps = ( range->dMAX - range->dMIN ) / range->dRES;
+		if (	( 0 == ( (UInt64)range->dMIN * numerator ) % denominator )
+			&&	( 0 == ( (UInt64)range->dRES * numerator ) % denominator ) )
+		{
+			FailIf ( kIOReturnSuccess != AUASampleRateRangesAdd (	&scaledRanges,
+																	(UInt32)( (UInt64)range->dMIN * numerator / denominator ),
+																	(UInt32)( (UInt64)range->dMAX * numerator / denominator ),
+																	(UInt32)( (UInt64)range->dRES * numerator / denominator ) ), Exit );
+		}
+		else if ( numSteps < kAUAMaxRateTableEntries )
+		{
+			for ( UInt64 step = 0; step <= numSteps; step++ )
+			{
+				scaledRate = ( range->dMIN + step * range->dRES ) * numerator / denominator;
+				FailIf ( kIOReturnSuccess != AUASampleRateRangesAdd ( &scaledRanges, (UInt32)scaledRate, (UInt32)scaledRate, 0 ), Exit );
+			}
+		}
+		else
+		{
+			FailIf ( kIOReturnSuccess != AUASampleRateRangesAdd (	&scaledRanges,
+																	(UInt32)( (UInt64)range->dMIN * numerator / denominator ),
+																	(UInt32)( (UInt64)range->dMAX * numerator / denominator ),
+																	(UInt32)( (UInt64)range->dRES * numerator / denominator ) ), Exit );
+		}
+	}
+	
+	AUASampleRateRangesFree ( sampleRateRanges );
+	* sampleRateRanges = scaledRanges;
+	scaledRanges.numRanges = 0;
+	scaledRanges.capacity = 0;
+	scaledRanges.ranges = NULL;
+	scaledRanges.coverMax = NULL;
+	result = kIOReturnSuccess;
+
+Exit:
+	AUASampleRateRangesFree ( &scaledRanges );
 	return result;
 }
 
@@ -5371,201 +6627,412 @@ OSArray * AppleUSBAudioDevice::buildClockPath ( UInt8 controlInterfaceNum, UInt8
 	thisUnitIDNum->release ();
 	thisUnitIDNum = NULL;
 
-	FailIf ( kIOReturnSuccess != mConfigDictionary->getSubType ( &subType, controlInterfaceNum, 0, thisUnitID ), Exit );
+	FailIf ( kIOReturnSuccess != mConfigDictionary->getSubType ( &subType, controlInterfaceNum, 0, thisUnitID ), Exit );
+
+	while	(		( 0 != subType )
+				&&  ( curPath )
+				&&	( USBAUDIO_0200::CLOCK_SOURCE != subType ) )
+	{
+		if ( USBAUDIO_0200::CLOCK_SELECTOR == subType )						 
+		{
+			debugIOLog ( "    found clock selector @ ID %d", thisUnitID ); 
+			FailIf ( kIOReturnSuccess != mConfigDictionary->getNumSources ( &numSources, controlInterfaceNum, 0, thisUnitID ), Exit );
+			debugIOLog ( "    found clock selector %d has %d sources", thisUnitID, numSources ); 			
+			FailIf ( kIOReturnSuccess != mConfigDictionary->getSourceIDs ( &sourceArray, controlInterfaceNum, 0, thisUnitID ), Exit );			
+			for ( UInt8 sourceIndex = 0; sourceIndex < numSources; sourceIndex++ ) 
+			{
+				FailIf ( NULL == sourceArray, Exit );
+				FailIf ( NULL == ( arrayNumber = OSDynamicCast ( OSNumber, sourceArray->getObject ( sourceIndex ) ) ), Exit);
+				buildClockPath ( controlInterfaceNum, arrayNumber->unsigned8BitValue(), allPaths, curPath );
+			}
+			subType = 0;
+		}
+		else
+		{
+			// USBAUDIO_0200::CLOCK_MULTIPLIER:
+			debugIOLog ( "    found clock multiplier @ ID %d", thisUnitID );
+			if ( 1 != curPath->getCount () )
+			{
+				// We haven't added this yet. We should do so.
+				thisUnitIDNum = OSNumber::withNumber ( thisUnitID, 8 );
+				if ( NULL != thisUnitIDNum ) 
+				{
+					curPath->setObject ( thisUnitIDNum );
+					thisUnitIDNum->release ();
+					thisUnitIDNum = NULL;
+				}
+			}
+			
+			// Continue down the path.
+			FailIf (kIOReturnSuccess != mConfigDictionary->getSourceID ( &sourceID, controlInterfaceNum, 0, thisUnitID ), Exit );
+			thisUnitID = sourceID;
+			FailIf ( kIOReturnSuccess != mConfigDictionary->getSubType ( &subType, controlInterfaceNum, 0, thisUnitID ), Exit );
+		}
+	} // while ( subType != 0 )
+
+	if ( USBAUDIO_0200::CLOCK_SOURCE == subType )
+	{
+		debugIOLog ( "    found clock source @ ID %d", thisUnitID );
+		// [rdar://4952145] This is the end of a clock path. We should set it now.
+		debugIOLog (  "    adding path..." );
+		allPaths->setObject ( curPath );
+	}
+
+Exit:
+	if ( curPath )
+	{
+		curPath->release ();
+		curPath = NULL;
+	}
+	debugIOLog ( "- AppleUSBAudioDevice[%p]::buildClockPath () = %p", curPath );
+	return curPath;
+}
+
+OSArray * AppleUSBAudioDevice::BuildConnectionGraph (UInt8 controlInterfaceNum) 
+{
+	AUAUnitGraph *					graph = NULL;
+	OSArray *						allOutputTerminalPaths = NULL;
+	OSArray *						pathsFromOutputTerminalN = NULL;
+	UInt8							terminalIndex;
+	UInt8							numTerminals;
+	UInt8							terminalID;
+
+	debugIOLog ("+ AppleUSBAudioDevice[%p]::BuildConnectionGraph (%d)", this, controlInterfaceNum);
+	allOutputTerminalPaths = OSArray::withCapacity (1);
+	FailIf (NULL == allOutputTerminalPaths, Exit);
+	graph = (AUAUnitGraph *)IOMalloc (sizeof (AUAUnitGraph));
+	FailIf (NULL == graph, Exit);
+	bzero (graph, sizeof (AUAUnitGraph));
+	FailIf (kIOReturnSuccess != buildUnitGraph (graph, controlInterfaceNum), Exit);
+	FailIf (kIOReturnSuccess != mConfigDictionary->getNumOutputTerminals (&numTerminals, controlInterfaceNum, 0), Exit);
+	for (terminalIndex = 0; terminalIndex < numTerminals; terminalIndex++) 
+	{
+		FailIf (kIOReturnSuccess != mConfigDictionary->getIndexedOutputTerminalID (&terminalID, controlInterfaceNum, 0, terminalIndex), Exit);
+		FailIf (kIOReturnSuccess != enumerateUnitGraphPaths (graph, terminalID), Exit);
+		pathsFromOutputTerminalN = createPathArrayFromUnitGraph (graph);
+		FailIf (NULL == pathsFromOutputTerminalN, Exit);
+		allOutputTerminalPaths->setObject (pathsFromOutputTerminalN);
+		pathsFromOutputTerminalN->release ();
+		pathsFromOutputTerminalN = NULL;
+	}
+	
+Exit:
+	if (NULL != graph)
+	{
+		freeUnitGraph (graph);
+		IOFree (graph, sizeof (AUAUnitGraph));
+	}
+	
+	debugIOLog ("- AppleUSBAudioDevice[%p]::BuildConnectionGraph (%d) = %p", this, controlInterfaceNum, allOutputTerminalPaths);
+	return allOutputTerminalPaths;
+}
+
+// Grows a unit graph buffer geometrically so that it can hold at least neededCount elements.
+static bool growUnitGraphBuffer (void ** buffer, UInt32 * capacity, UInt32 neededCount, UInt32 elementSize)
+{
+	void *							newBuffer;
+	UInt32							newCapacity;
+
+	if (neededCount <= *capacity)
+	{
+		return true;
+	}
+	newCapacity = (0 == *capacity) ? 64 : *capacity;
+	while (newCapacity < neededCount)
+	{
+		newCapacity *= 2;
+	}
+	newBuffer = IOMalloc (newCapacity * elementSize);
+	if (NULL == newBuffer)
+	{
+		return false;
+	}
+	if (NULL != *buffer)
+	{
+		bcopy (*buffer, newBuffer, *capacity * elementSize);
+		IOFree (*buffer, *capacity * elementSize);
+	}
+	*buffer = newBuffer;
+	*capacity = newCapacity;
+	return true;
+}
+
+static UInt8 addUnitGraphNode (AUAUnitGraph * graph, UInt8 unitID)
+{
+	if (kAUANoGraphNode == graph->nodeForUnit[unitID])
+	{
+		graph->nodeForUnit[unitID] = graph->numNodes;
+		graph->unitID[graph->numNodes] = unitID;
+		graph->numNodes++;
+	}
+	return graph->nodeForUnit[unitID];
+}
+
+// Discovers every unit reachable from the output terminals, records its sources as node indices and as a bitmask, and
+// computes the set of nodes that lead to an input terminal so that dead-end branches are never walked during enumeration.
+IOReturn AppleUSBAudioDevice::buildUnitGraph (AUAUnitGraph * graph, UInt8 controlInterfaceNum)
+{
+	OSArray *						sourceArray = NULL;
+	OSNumber *						sourceNumber;
+	UInt32							nodeIndex;
+	UInt32							sourceIndex;
+	UInt32							numSourcesForNode;
+	UInt8							sourceNode;
+	UInt8							numTerminals;
+	UInt8							terminalIndex;
+	UInt8							terminalID;
+	UInt8							unitID;
+	UInt8							sourceID = 0;
+	UInt8							numSources;
+	UInt8							subType;
+	UInt16							adcVersion;
+	bool							multipleSources;
+	bool							changed;
+	IOReturn						result = kIOReturnError;
+
+	FailIf (NULL == graph, Exit);
+	FailIf (kIOReturnSuccess != mConfigDictionary->getADCVersion (&adcVersion), Exit);
+	memset (graph->nodeForUnit, kAUANoGraphNode, sizeof (graph->nodeForUnit));
+	graph->numNodes = 0;
+	graph->sourcesCount = 0;
+
+	// The output terminals are the roots; the node list doubles as the breadth-first work queue.
+	FailIf (kIOReturnSuccess != mConfigDictionary->getNumOutputTerminals (&numTerminals, controlInterfaceNum, 0), Exit);
+	for (terminalIndex = 0; terminalIndex < numTerminals; terminalIndex++) 
+	{
+		FailIf (kIOReturnSuccess != mConfigDictionary->getIndexedOutputTerminalID (&terminalID, controlInterfaceNum, 0, terminalIndex), Exit);
+		if (0 != terminalID)
+		{
+			addUnitGraphNode (graph, terminalID);
+		}
+	}
+
+	for (nodeIndex = 0; nodeIndex < graph->numNodes; nodeIndex++)
+	{
+		unitID = graph->unitID[nodeIndex];
+		graph->firstSource[nodeIndex] = graph->sourcesCount;
+		graph->numSources[nodeIndex] = 0;
+		if (kIOReturnSuccess != mConfigDictionary->getSubType (&subType, controlInterfaceNum, 0, unitID))
+		{
+			subType = 0;
+		}
+		graph->subType[nodeIndex] = subType;
+		if (INPUT_TERMINAL == subType)
+		{
+			AUAGraphMaskSet (graph->inputTerminalMask, nodeIndex);
+			continue;
+		}
+		if (0 == subType)
+		{
+			continue;
+		}
+
+		multipleSources = (((kAUAUSBSpec1_0 == adcVersion) && ((MIXER_UNIT == subType) || (SELECTOR_UNIT == subType) || (EXTENSION_UNIT == subType) || (PROCESSING_UNIT == subType))) ||
+						   ((kAUAUSBSpec2_0 == adcVersion) && ((USBAUDIO_0200::MIXER_UNIT == subType) || (USBAUDIO_0200::SELECTOR_UNIT == subType) || (USBAUDIO_0200::EXTENSION_UNIT == subType) || (USBAUDIO_0200::PROCESSING_UNIT == subType))));
+		if (multipleSources)
+		{
+			if (	(kIOReturnSuccess != mConfigDictionary->getNumSources (&numSources, controlInterfaceNum, 0, unitID))
+				||	(kIOReturnSuccess != mConfigDictionary->getSourceIDs (&sourceArray, controlInterfaceNum, 0, unitID))
+				||	(NULL == sourceArray))
+			{
+				continue;
+			}
+			numSourcesForNode = (numSources < sourceArray->getCount ()) ? numSources : sourceArray->getCount ();
+		}
+		else
+		{
+			// OUTPUT_TERMINAL, FEATURE_UNIT, EFFECT_UNIT:
+			if (kIOReturnSuccess != mConfigDictionary->getSourceID (&sourceID, controlInterfaceNum, 0, unitID))
+			{
+				continue;
+			}
+			numSourcesForNode = 1;
+		}
+
+		FailIf (!growUnitGraphBuffer ((void **)&graph->sources, &graph->sourcesCapacity, graph->sourcesCount + numSourcesForNode, sizeof (UInt8)), Exit);
+		for (sourceIndex = 0; sourceIndex < numSourcesForNode; sourceIndex++)
+		{
+			if (multipleSources)
+			{
+				sourceNumber = OSDynamicCast (OSNumber, sourceArray->getObject (sourceIndex));
+				if (NULL == sourceNumber)
+				{
+					break;
+				}
+				sourceID = sourceNumber->unsigned8BitValue ();
+			}
+			if (0 == sourceID)
+			{
+				continue;
+			}
+			sourceNode = addUnitGraphNode (graph, sourceID);
+			graph->sources[graph->sourcesCount++] = sourceNode;
+			graph->numSources[nodeIndex]++;
+			AUAGraphMaskSet (graph->sourceMask[nodeIndex], sourceNode);
+		}
+	}
+
+	// Sources are discovered after the units they feed, so walking the nodes backwards settles an acyclic graph in one pass; only
+	// looped descriptors take more.
+	bcopy (graph->inputTerminalMask, graph->reachesInputMask, sizeof (graph->reachesInputMask));
+	do
+	{
+		changed = false;
+		for (nodeIndex = graph->numNodes; nodeIndex-- > 0; )
+		{
+			if (!AUAGraphMaskTest (graph->reachesInputMask, nodeIndex) && AUAGraphMaskIntersects (graph->sourceMask[nodeIndex], graph->reachesInputMask))
+			{
+				AUAGraphMaskSet (graph->reachesInputMask, nodeIndex);
+				changed = true;
+			}
+		}
+	} while (changed);
+
+	debugIOLog ("? AppleUSBAudioDevice[%p]::buildUnitGraph (%p, %d) - %lu nodes, %lu source links", this, graph, controlInterfaceNum, graph->numNodes, graph->sourcesCount);
+	result = kIOReturnSuccess;
+
+Exit:
+	return result;
+}
+
+// Collects every path from outputTerminalID back to an input terminal into the graph's path arena, replacing the previous
+// contents. Paths come out in the same order the recursive walk produced them: depth first, sources in descriptor order.
+// A unit that is already on the current path is not entered again, so looped topologies cannot recurse forever.
+IOReturn AppleUSBAudioDevice::enumerateUnitGraphPaths (AUAUnitGraph * graph, UInt8 outputTerminalID)
+{
+	UInt32							depth;
+	UInt32							pathIndex;
+	UInt8							node;
+	UInt8							sourceNode;
+	IOReturn						result = kIOReturnError;
+
+	FailIf (NULL == graph, Exit);
+	FailIf (!growUnitGraphBuffer ((void **)&graph->pathStart, &graph->pathStartCapacity, 1, sizeof (UInt32)), Exit);
+	graph->numPaths = 0;
+	graph->pathArenaCount = 0;
+	graph->pathStart[0] = 0;
+
+	node = graph->nodeForUnit[outputTerminalID];
+	if ((kAUANoGraphNode == node) || !AUAGraphMaskTest (graph->reachesInputMask, node))
+	{
+		result = kIOReturnSuccess;
+		goto Exit;
+	}
+
+	bzero (graph->onPathMask, sizeof (graph->onPathMask));
+	graph->stackNode[0] = node;
+	graph->stackNextSource[0] = 0;
+	AUAGraphMaskSet (graph->onPathMask, node);
+	depth = 1;
 
-	while	(		( 0 != subType )
-				&&  ( curPath )
-				&&	( USBAUDIO_0200::CLOCK_SOURCE != subType ) )
+	while (0 != depth)
 	{
-		if ( USBAUDIO_0200::CLOCK_SELECTOR == subType )						 
+		node = graph->stackNode[depth - 1];
+		if ((depth > 1) && AUAGraphMaskTest (graph->inputTerminalMask, node))
 		{
-			debugIOLog ( "    found clock selector @ ID %d", thisUnitID ); 
-			FailIf ( kIOReturnSuccess != mConfigDictionary->getNumSources ( &numSources, controlInterfaceNum, 0, thisUnitID ), Exit );
-			debugIOLog ( "    found clock selector %d has %d sources", thisUnitID, numSources ); 			
-			FailIf ( kIOReturnSuccess != mConfigDictionary->getSourceIDs ( &sourceArray, controlInterfaceNum, 0, thisUnitID ), Exit );			
-			for ( UInt8 sourceIndex = 0; sourceIndex < numSources; sourceIndex++ ) 
+			FailIf (!growUnitGraphBuffer ((void **)&graph->pathArena, &graph->pathArenaCapacity, graph->pathArenaCount + depth, sizeof (UInt8)), Exit);
+			FailIf (!growUnitGraphBuffer ((void **)&graph->pathStart, &graph->pathStartCapacity, graph->numPaths + 2, sizeof (UInt32)), Exit);
+			for (pathIndex = 0; pathIndex < depth; pathIndex++)
 			{
-				FailIf ( NULL == sourceArray, Exit );
-				FailIf ( NULL == ( arrayNumber = OSDynamicCast ( OSNumber, sourceArray->getObject ( sourceIndex ) ) ), Exit);
-				buildClockPath ( controlInterfaceNum, arrayNumber->unsigned8BitValue(), allPaths, curPath );
+				graph->pathArena[graph->pathArenaCount++] = graph->stackNode[pathIndex];
 			}
-			subType = 0;
+			graph->numPaths++;
+			graph->pathStart[graph->numPaths] = graph->pathArenaCount;
 		}
-		else
+		else if (graph->stackNextSource[depth - 1] < graph->numSources[node])
 		{
-			// USBAUDIO_0200::CLOCK_MULTIPLIER:
-			debugIOLog ( "    found clock multiplier @ ID %d", thisUnitID );
-			if ( 1 != curPath->getCount () )
+			sourceNode = graph->sources[graph->firstSource[node] + graph->stackNextSource[depth - 1]];
+			graph->stackNextSource[depth - 1]++;
+			if (AUAGraphMaskTest (graph->reachesInputMask, sourceNode) && !AUAGraphMaskTest (graph->onPathMask, sourceNode))
 			{
-				// We haven't added this yet. We should do so.
-				thisUnitIDNum = OSNumber::withNumber ( thisUnitID, 8 );
-				if ( NULL != thisUnitIDNum ) 
-				{
-					curPath->setObject ( thisUnitIDNum );
-					thisUnitIDNum->release ();
-					thisUnitIDNum = NULL;
-				}
+				graph->stackNode[depth] = sourceNode;
+				graph->stackNextSource[depth] = 0;
+				AUAGraphMaskSet (graph->onPathMask, sourceNode);
+				depth++;
 			}
-			
-			// Continue down the path.
-			FailIf (kIOReturnSuccess != mConfigDictionary->getSourceID ( &sourceID, controlInterfaceNum, 0, thisUnitID ), Exit );
-			thisUnitID = sourceID;
-			FailIf ( kIOReturnSuccess != mConfigDictionary->getSubType ( &subType, controlInterfaceNum, 0, thisUnitID ), Exit );
+			continue;
 		}
-	} // while ( subType != 0 )
-
-	if ( USBAUDIO_0200::CLOCK_SOURCE == subType )
-	{
-		debugIOLog ( "    found clock source @ ID %d", thisUnitID );
-		// [rdar://4952145] This is the end of a clock path. We should set it now.
-		debugIOLog (  "    adding path..." );
-		allPaths->setObject ( curPath );
+		AUAGraphMaskClear (graph->onPathMask, node);
+		depth--;
 	}
+	result = kIOReturnSuccess;
 
 Exit:
-	if ( curPath )
-	{
-		curPath->release ();
-		curPath = NULL;
-	}
-	debugIOLog ( "- AppleUSBAudioDevice[%p]::buildClockPath () = %p", curPath );
-	return curPath;
+	return result;
 }
 
-OSArray * AppleUSBAudioDevice::BuildConnectionGraph (UInt8 controlInterfaceNum) 
+// Converts the paths currently in the arena to the OSArray of OSArrays of unit ID OSNumbers that mControlGraph is made of.
+OSArray * AppleUSBAudioDevice::createPathArrayFromUnitGraph (AUAUnitGraph * graph)
 {
-	OSArray *						allOutputTerminalPaths = NULL;
-	OSArray *						pathsFromOutputTerminalN = NULL;
+	OSArray *						paths = NULL;
 	OSArray *						thisPath = NULL;
-	UInt8							terminalIndex;
-	UInt8							numTerminals;
-	UInt8							terminalID;
+	UInt32							pathIndex;
+	UInt32							arenaIndex;
+	UInt8							node;
 
-	debugIOLog ("+ AppleUSBAudioDevice[%p]::BuildConnectionGraph (%d)", this, controlInterfaceNum);
-	allOutputTerminalPaths = OSArray::withCapacity (1);
-	FailIf (NULL == allOutputTerminalPaths, Exit);
-	pathsFromOutputTerminalN = OSArray::withCapacity (1);
-	FailIf (NULL == pathsFromOutputTerminalN, Exit);
-	FailIf (kIOReturnSuccess != mConfigDictionary->getNumOutputTerminals (&numTerminals, controlInterfaceNum, 0), Exit);
-	for (terminalIndex = 0; terminalIndex < numTerminals; terminalIndex++) 
+	FailIf (NULL == graph, Exit);
+	paths = OSArray::withCapacity ((0 == graph->numPaths) ? 1 : graph->numPaths);
+	FailIf (NULL == paths, Exit);
+	for (pathIndex = 0; pathIndex < graph->numPaths; pathIndex++)
 	{
-		FailIf (kIOReturnSuccess != mConfigDictionary->getIndexedOutputTerminalID (&terminalID, controlInterfaceNum, 0, terminalIndex), Exit);
-		BuildPath (controlInterfaceNum, terminalID, pathsFromOutputTerminalN, thisPath);
-		allOutputTerminalPaths->setObject (pathsFromOutputTerminalN);
-		pathsFromOutputTerminalN->release ();
-		pathsFromOutputTerminalN = OSArray::withCapacity (1);
-		FailIf (NULL == pathsFromOutputTerminalN, Exit);
+		thisPath = OSArray::withCapacity (graph->pathStart[pathIndex + 1] - graph->pathStart[pathIndex]);
+		FailIf (NULL == thisPath, Error);
+		for (arenaIndex = graph->pathStart[pathIndex]; arenaIndex < graph->pathStart[pathIndex + 1]; arenaIndex++)
+		{
+			node = graph->pathArena[arenaIndex];
+			if (NULL == graph->unitNumber[node])
+			{
+				graph->unitNumber[node] = OSNumber::withNumber (graph->unitID[node], 8);
+				FailIf (NULL == graph->unitNumber[node], Error);
+			}
+			thisPath->setObject (graph->unitNumber[node]);
+		}
+		paths->setObject (thisPath);
+		thisPath->release ();
+		thisPath = NULL;
 	}
-	
+
 Exit:
-	if (NULL != pathsFromOutputTerminalN)
+	return paths;
+Error:
+	if (NULL != thisPath)
 	{
-		pathsFromOutputTerminalN->release();
+		thisPath->release ();
 	}
-	
-	debugIOLog ("- AppleUSBAudioDevice[%p]::BuildConnectionGraph (%d) = %p", this, controlInterfaceNum, allOutputTerminalPaths);
-	return allOutputTerminalPaths;
+	paths->release ();
+	return NULL;
 }
 
-OSArray * AppleUSBAudioDevice::BuildPath (UInt8 controlInterfaceNum, UInt8 startingUnitID, OSArray * allPaths, OSArray * startingPath) {
-	OSArray *						curPath = NULL;
-	OSArray *						tempPath = NULL;
-	OSArray *						sourceArray = NULL;
-	OSObject *						arrayObject = NULL;
-	OSNumber *						arrayNumber = NULL;
-	OSNumber *						thisUnitIDNum;
-	UInt8							unitID;	
-	// UInt8 *							sourceIDs = NULL;
-	UInt32							i;
-	UInt8							thisUnitID;
-	UInt8							numSources;
-	UInt8							sourceID;
-	UInt8							startingSubType;
-	UInt8							subType;
-	UInt16							adcVersion;
-
-	FailIf (kIOReturnSuccess != mConfigDictionary->getADCVersion (&adcVersion), Exit);
-	
-	thisUnitID = startingUnitID;
-	FailIf (NULL == (thisUnitIDNum = OSNumber::withNumber (thisUnitID, 8)), Exit);
-	if (NULL != startingPath) 
-	{
-		curPath = OSArray::withArray (startingPath);
-	}
-	if (NULL == curPath) 
-	{
-		curPath = OSArray::withObjects ((const OSObject **)&thisUnitIDNum, 1);
-	} 
-	else 
-	{
-		curPath->setObject (thisUnitIDNum);
-	}
-	thisUnitIDNum->release ();
-	thisUnitIDNum = NULL;
-
-	FailIf (kIOReturnSuccess != mConfigDictionary->getSubType (&subType, controlInterfaceNum, 0, thisUnitID), Exit);
+void AppleUSBAudioDevice::freeUnitGraph (AUAUnitGraph * graph)
+{
+	UInt32							nodeIndex;
 
-	while (INPUT_TERMINAL != subType && subType != 0) 
+	if (NULL != graph)
 	{
-		if (((kAUAUSBSpec1_0 == adcVersion) && ((MIXER_UNIT == subType) || (SELECTOR_UNIT == subType) || (EXTENSION_UNIT == subType) || (PROCESSING_UNIT == subType))) ||
-			((kAUAUSBSpec2_0 == adcVersion) && ((USBAUDIO_0200::MIXER_UNIT == subType) || (USBAUDIO_0200::SELECTOR_UNIT == subType) || (USBAUDIO_0200::EXTENSION_UNIT == subType) || (USBAUDIO_0200::PROCESSING_UNIT == subType))))						 
+		for (nodeIndex = 0; nodeIndex < kAUAMaxGraphNodes; nodeIndex++)
 		{
-			FailIf (kIOReturnSuccess != mConfigDictionary->getNumSources (&numSources, controlInterfaceNum, 0, thisUnitID), Exit);
-			FailIf (kIOReturnSuccess != mConfigDictionary->getSourceIDs (&sourceArray, controlInterfaceNum, 0, thisUnitID), Exit);
-			tempPath = OSArray::withArray (curPath);
-			for (i = 0; i < numSources; i++) 
+			if (NULL != graph->unitNumber[nodeIndex])
 			{
-				if (NULL == curPath) 
-				{
-					curPath = OSArray::withCapacity (1);
-				}
-				FailIf (NULL == curPath, Exit);
-				FailIf (NULL == (arrayObject = sourceArray->getObject (i)), Exit);
-				FailIf (NULL == (arrayNumber = OSDynamicCast (OSNumber, arrayObject)), Exit);
-				curPath = BuildPath (controlInterfaceNum, arrayNumber->unsigned8BitValue(), allPaths, tempPath);
-				if (curPath && curPath->getCount ()) 
-				{
-					thisUnitIDNum = OSDynamicCast (OSNumber, curPath->getLastObject ());
-					FailIf (NULL == thisUnitIDNum, Exit);
-					unitID = thisUnitIDNum->unsigned8BitValue ();
-					FailIf (kIOReturnSuccess != mConfigDictionary->getSubType (&subType, controlInterfaceNum, 0, unitID), Exit);
-					if (unitID && subType == INPUT_TERMINAL) 
-					{
-						allPaths->setObject (curPath);
-					}
-				}
-				if (curPath) 
-				{
-					curPath->release ();
-					curPath = NULL;
-				}
+				graph->unitNumber[nodeIndex]->release ();
+				graph->unitNumber[nodeIndex] = NULL;
 			}
-			tempPath->release ();
-			subType = 0;
 		}
-		else
+		if (NULL != graph->sources)
 		{
-			// OUTPUT_TERMINAL, FEATURE_UNIT, EFFECT_UNIT:
-			FailIf (kIOReturnSuccess != mConfigDictionary->getSourceID (&sourceID, controlInterfaceNum, 0, thisUnitID), Exit);
-			thisUnitID = sourceID;
-			thisUnitIDNum = OSNumber::withNumber (thisUnitID, 8);
-			if (NULL != thisUnitIDNum) 
-			{
-				curPath->setObject (thisUnitIDNum);
-				thisUnitIDNum->release ();
-				thisUnitIDNum = NULL;
-			}
-			FailIf (kIOReturnSuccess != mConfigDictionary->getSubType (&subType, controlInterfaceNum, 0, thisUnitID), Exit);
-			FailIf (kIOReturnSuccess != mConfigDictionary->getSubType (&startingSubType, controlInterfaceNum, 0, startingUnitID), Exit);
-			if (subType == INPUT_TERMINAL && startingSubType == OUTPUT_TERMINAL) 
-			{
-				allPaths->setObject (curPath);
-			}
+			IOFree (graph->sources, graph->sourcesCapacity * sizeof (UInt8));
+			graph->sources = NULL;
 		}
-	} // while (INPUT_TERMINAL != subType && subType != 0)
-
-Exit:
-	return curPath;
+		if (NULL != graph->pathArena)
+		{
+			IOFree (graph->pathArena, graph->pathArenaCapacity * sizeof (UInt8));
+			graph->pathArena = NULL;
+		}
+		if (NULL != graph->pathStart)
+		{
+			IOFree (graph->pathStart, graph->pathStartCapacity * sizeof (UInt32));
+			graph->pathStart = NULL;
+		}
+	}
 }
 
 char * AppleUSBAudioDevice::TerminalTypeString (UInt16 terminalType) 
@@ -5716,34 +7183,56 @@ char * AppleUSBAudioDevice::ClockTypeString (UInt8 clockType)
 	return clockTypeString;
 }
 
+// A stall is the device refusing the request, so it is tried only once more in case the device was merely busy. Anything else
+// is retried up to kAUAControlRequestAttempts times unless the device has gone away.
+static bool controlRequestShouldRetry (IOReturn result, UInt32 attempt)
+{
+	if (kIOReturnSuccess == result || kIOReturnNoDevice == result || kIOReturnAborted == result)
+	{
+		return false;
+	}
+	if (kIOUSBPipeStalled == result)
+	{
+		return (attempt < 1);
+	}
+	return (attempt + 1 < kAUAControlRequestAttempts);
+}
+
+static UInt32 controlRequestBackoff (UInt32 attempt)
+{
+	UInt32		delay = 1 << (attempt - 1);
+
+	return (delay > kAUAControlRequestMaxBackoff) ? kAUAControlRequestMaxBackoff : delay;
+}
+
+// Only the transfer itself is issued under the interface lock; the backoff between attempts is not, so a device that is slow to
+// answer one request doesn't hold up every other control request behind it.
 IOReturn AppleUSBAudioDevice::deviceRequest (IOUSBDevRequestDesc * request, IOUSBCompletion * completion) {
 	IOReturn						result;
-	UInt32							timeout;
-	Boolean							done;
+	UInt32							attempt;
 
 	result = kIOReturnSuccess;
 	FailIf (NULL == mInterfaceLock, Exit);
-	IORecursiveLockLock (mInterfaceLock);
 
-	if (FALSE == mTerminatingDriver) 
+	for (attempt = 0; attempt < kAUAControlRequestAttempts; attempt++)
 	{
-		done = FALSE;
-		timeout = 5;
-		while (!done && timeout && mControlInterface) 
+		if (0 != attempt)
 		{
-			result = mControlInterface->DeviceRequest (request, completion);
-			if (result != kIOReturnSuccess) 
-			{
-				timeout--;
-				IOSleep (1);
-			} 
-			else 
-			{
-				done = TRUE;
-			}
+			IOSleep (controlRequestBackoff (attempt));
 		}
-    }
-	IORecursiveLockUnlock (mInterfaceLock);
+		IORecursiveLockLock (mInterfaceLock);
+		if (mTerminatingDriver || NULL == mControlInterface)
+		{
+			IORecursiveLockUnlock (mInterfaceLock);
+			break;
+		}
+		result = mControlInterface->DeviceRequest (request, completion);
+		IORecursiveLockUnlock (mInterfaceLock);
+		if (!controlRequestShouldRetry (result, attempt))
+		{
+			break;
+		}
+	}
 	#if LOGDEVICEREQUESTS
 	debugIOLog ("? AppleUSBAudioDevice[%p]::deviceRequest (%p, %p) = %lx", this, request, completion, result);
 	#endif
@@ -5753,32 +7242,30 @@ Exit:
 
 IOReturn AppleUSBAudioDevice::deviceRequest (IOUSBDevRequest * request, IOUSBCompletion * completion) {
 	IOReturn						result;
-	UInt32							timeout;
-	Boolean							done;
+	UInt32							attempt;
 
 	result = kIOReturnSuccess;
 	FailIf (NULL == mInterfaceLock, Exit);
-	IORecursiveLockLock (mInterfaceLock);
 
-	if (FALSE == mTerminatingDriver) 
+	for (attempt = 0; attempt < kAUAControlRequestAttempts; attempt++)
 	{
-		done = FALSE;
-		timeout = 5;
-		while (!done && timeout && mControlInterface) 
+		if (0 != attempt)
 		{
-			result = mControlInterface->DeviceRequest (request, completion);
-			if (result != kIOReturnSuccess) 
-			{
-				timeout--;
-				IOSleep (1);
-			} 
-			else 
-			{
-				done = TRUE;
-			}
+			IOSleep (controlRequestBackoff (attempt));
 		}
-    }
-	IORecursiveLockUnlock (mInterfaceLock);
+		IORecursiveLockLock (mInterfaceLock);
+		if (mTerminatingDriver || NULL == mControlInterface)
+		{
+			IORecursiveLockUnlock (mInterfaceLock);
+			break;
+		}
+		result = mControlInterface->DeviceRequest (request, completion);
+		IORecursiveLockUnlock (mInterfaceLock);
+		if (!controlRequestShouldRetry (result, attempt))
+		{
+			break;
+		}
+	}
 	#if LOGDEVICEREQUESTS
 	debugIOLog ("? AppleUSBAudioDevice[%p]::deviceRequest (%p, %p) = %lx", this, request, completion, result);
 	#endif
@@ -5788,36 +7275,151 @@ Exit:
 
 IOReturn AppleUSBAudioDevice::deviceRequest (IOUSBDevRequest *request, AppleUSBAudioDevice * self, IOUSBCompletion *completion) {
 	IOReturn						result;
-	UInt32							timeout;
-	Boolean							done;
 
 	result = kIOReturnSuccess;
-	FailIf (NULL == self->mInterfaceLock, Exit);
-	IORecursiveLockLock (self->mInterfaceLock);
+	FailIf (NULL == self, Exit);
+	result = self->deviceRequest (request, completion);
+Exit:
+	return result;
+}
+
+// State shared between deviceRequestBatch () and the completions of the requests it has in flight.
+typedef struct {
+	IOLock *						lock;
+	UInt32							numPending;
+	IOReturn *						results;
+} AUAControlRequestBatchState;
+
+static void deviceRequestBatchHandler (void * target, void * parameter, IOReturn status, UInt32 bufferSizeRemaining)
+{
+	AUAControlRequestBatchState *	batch = (AUAControlRequestBatchState *)target;
+	UInt32							requestIndex = (UInt32)(uintptr_t)parameter;
+
+	IOLockLock (batch->lock);
+	batch->results[requestIndex] = status;
+	batch->numPending--;
+	if (0 == batch->numPending)
+	{
+		IOLockWakeup (batch->lock, &batch->numPending, true);
+	}
+	IOLockUnlock (batch->lock);
+}
+
+// Issues independent control requests back to back without waiting for each to complete, then waits for all of them. Failed
+// requests are resubmitted together after a backoff that is taken without the interface lock held. The per-request outcome is
+// left in results; the return value only reports whether the batch could be run at all.
+IOReturn AppleUSBAudioDevice::deviceRequestBatch (IOUSBDevRequestDesc * requests, IOReturn * results, UInt32 numRequests) {
+	AUAControlRequestBatchState		batch;
+	IOUSBCompletion *				completions = NULL;
+	bool *							needsSubmit = NULL;
+	UInt32							numToSubmit;
+	UInt32							requestIndex;
+	UInt32							attempt;
+	IOReturn						submitResult;
+	IOReturn						result = kIOReturnError;
+
+	batch.lock = NULL;
+	FailIf (NULL == requests, Exit);
+	FailIf (NULL == results, Exit);
+	FailIf (0 == numRequests, Exit);
+	FailIf (NULL == mInterfaceLock, Exit);
+	FailIf (NULL == (batch.lock = IOLockAlloc ()), Exit);
+	FailIf (NULL == (completions = (IOUSBCompletion *)IOMalloc (numRequests * sizeof (IOUSBCompletion))), Exit);
+	FailIf (NULL == (needsSubmit = (bool *)IOMalloc (numRequests * sizeof (bool))), Exit);
+	batch.numPending = 0;
+	batch.results = results;
+
+	for (requestIndex = 0; requestIndex < numRequests; requestIndex++)
+	{
+		completions[requestIndex].target = &batch;
+		completions[requestIndex].action = deviceRequestBatchHandler;
+		completions[requestIndex].parameter = (void *)(uintptr_t)requestIndex;
+		results[requestIndex] = kIOReturnNotReady;
+		needsSubmit[requestIndex] = true;
+	}
 
-	if (FALSE == self->mTerminatingDriver) 
+	for (attempt = 0; attempt < kAUAControlRequestAttempts; attempt++)
 	{
-		done = FALSE;
-		timeout = 5;
-		while (!done && timeout && self->mControlInterface) 
+		numToSubmit = 0;
+		for (requestIndex = 0; requestIndex < numRequests; requestIndex++)
 		{
-			result = self->mControlInterface->DeviceRequest (request, completion);
-			if (result != kIOReturnSuccess) 
+			if (0 != attempt)
 			{
-				timeout--;
-				IOSleep (1);
-			} 
-			else 
+				needsSubmit[requestIndex] = controlRequestShouldRetry (results[requestIndex], attempt - 1);
+			}
+			if (needsSubmit[requestIndex])
 			{
-				done = TRUE;
+				numToSubmit++;
+			}
+		}
+		if (0 == numToSubmit)
+		{
+			break;
+		}
+		if (0 != attempt)
+		{
+			IOSleep (controlRequestBackoff (attempt));
+		}
+
+		IORecursiveLockLock (mInterfaceLock);
+		if (mTerminatingDriver || NULL == mControlInterface)
+		{
+			IORecursiveLockUnlock (mInterfaceLock);
+			for (requestIndex = 0; requestIndex < numRequests; requestIndex++)
+			{
+				if (needsSubmit[requestIndex])
+				{
+					results[requestIndex] = kIOReturnNoDevice;
+				}
+			}
+			break;
+		}
+		for (requestIndex = 0; requestIndex < numRequests; requestIndex++)
+		{
+			if (!needsSubmit[requestIndex])
+			{
+				continue;
+			}
+			IOLockLock (batch.lock);
+			batch.numPending++;
+			IOLockUnlock (batch.lock);
+			submitResult = mControlInterface->DeviceRequest (&requests[requestIndex], &completions[requestIndex]);
+			if (kIOReturnSuccess != submitResult)
+			{
+				// The completion will never be called for a request that wasn't queued.
+				IOLockLock (batch.lock);
+				batch.numPending--;
+				results[requestIndex] = submitResult;
+				IOLockUnlock (batch.lock);
 			}
 		}
+		IORecursiveLockUnlock (mInterfaceLock);
+
+		IOLockLock (batch.lock);
+		while (0 != batch.numPending)
+		{
+			IOLockSleep (batch.lock, &batch.numPending, THREAD_UNINT);
+		}
+		IOLockUnlock (batch.lock);
 	}
-	IORecursiveLockUnlock (self->mInterfaceLock);
 	#if LOGDEVICEREQUESTS
-	debugIOLog ("? AppleUSBAudioDevice[%p]::deviceRequest (%p, %p) = %lx", self, request, completion, result);
+	debugIOLog ("? AppleUSBAudioDevice[%p]::deviceRequestBatch (%p, %p, %lu) - %lu attempt(s)", this, requests, results, numRequests, attempt);
 	#endif
+	result = kIOReturnSuccess;
+
 Exit:
+	if (NULL != needsSubmit)
+	{
+		IOFree (needsSubmit, numRequests * sizeof (bool));
+	}
+	if (NULL != completions)
+	{
+		IOFree (completions, numRequests * sizeof (IOUSBCompletion));
+	}
+	if (NULL != batch.lock)
+	{
+		IOLockFree (batch.lock);
+	}
 	return result;
 }
 
@@ -5844,6 +7446,8 @@ bool AppleUSBAudioDevice::willTerminate (IOService * provider, IOOptionBits opti
 		mProcessStatusInterruptThread = NULL;
 	}
 
+	cancelControlChanges ();
+
 	debugIOLog ("- AppleUSBAudioDevice[%p]::willTerminate ()", this);
 
 	return super::willTerminate (provider, options);
@@ -5949,7 +7553,8 @@ void AppleUSBAudioDevice::accumulateAnchor (UInt64 anchorFrame, AbsoluteTime tim
 #endif
 
 // <rdar://problem/7378275> Improved timestamp generation accuracy
-IOReturn AppleUSBAudioDevice::getAnchorFrameAndTimeStamp (UInt64 *frame, AbsoluteTime *time) {
+// edgeUncertainty, if supplied, receives how many ns the frame edge could lie on either side of the returned time.
+IOReturn AppleUSBAudioDevice::getAnchorFrameAndTimeStamp (UInt64 *frame, AbsoluteTime *time, UInt64 *edgeUncertainty) {
 	AbsoluteTime	finishTime;
 	AbsoluteTime	offset;
 	AbsoluteTime	curTime;
@@ -5958,6 +7563,7 @@ IOReturn AppleUSBAudioDevice::getAnchorFrameAndTimeStamp (UInt64 *frame, Absolut
 	UInt64			thisFrame;
 	AbsoluteTime	diffAbs;
 	UInt64			diffNanos;
+	UInt64			windowNanos;
 	IOReturn		result = kIOReturnError;
 	
 	FailIf (NULL == mControlInterface, Exit);
@@ -5968,14 +7574,14 @@ IOReturn AppleUSBAudioDevice::getAnchorFrameAndTimeStamp (UInt64 *frame, Absolut
 	clock_get_uptime ( &curTime );
 	FailIf (NULL == mControlInterface->GetDevice(), Exit);
 	FailIf (NULL == mControlInterface->GetDevice()->GetBus(), Exit);
-	thisFrame = mControlInterface->GetDevice()->GetBus()->GetFrameNumber ();
+	thisFrame = getUSBFrameNumber ();
 	// spin until the frame changes
 	do
 	{
 		prevTime = curTime;
 		clock_get_uptime (&curTime);
 	} while (	!mTerminatingDriver && (mControlInterface)		// <rdar://problem/7800198>
-				&&	(thisFrame == mControlInterface->GetDevice()->GetBus()->GetFrameNumber ()) 
+				&&	(thisFrame == getUSBFrameNumber ()) 
 				&&	(CMP_ABSOLUTETIME (&finishTime, &curTime) > 0));
 
 	clock_get_uptime (&thisTime);
@@ -5987,6 +7593,7 @@ IOReturn AppleUSBAudioDevice::getAnchorFrameAndTimeStamp (UInt64 *frame, Absolut
 	{
 		goto Exit;
 	}
+	windowNanos = diffNanos;
 	
 	diffAbs = thisTime;
 	SUB_ABSOLUTETIME ( &diffAbs, &curTime );
@@ -5995,11 +7602,16 @@ IOReturn AppleUSBAudioDevice::getAnchorFrameAndTimeStamp (UInt64 *frame, Absolut
 	{
 		goto Exit;
 	}
+	windowNanos += diffNanos;
 	ADD_ABSOLUTETIME ( &thisTime, &curTime );
 	AbsoluteTime_to_scalar ( &thisTime ) /= 2;
 	
 	*frame = ++thisFrame;
 	*time = thisTime;	
+	if ( NULL != edgeUncertainty )
+	{
+		*edgeUncertainty = windowNanos / 2;
+	}
 	result = kIOReturnSuccess;
 Exit:
 	return result;
@@ -6274,25 +7886,142 @@ void AppleUSBAudioDevice::calculateOffset ( void )
 		mRampUpdateCounter = 0;	// increase cycle time update frequency
 		if ( mTimeLock && ( mAnchorTime.n >= MIN_ENTRIES_APPLY_OFFSET ) )
 		{
-			applyOffsetAmountToFilter ();
+			applyOffsetAmountToFilter ();
+		}
+	}
+	debugIOLog ( "- AppleUSBAudioDevice::calculateOffset (%p)", this );
+}
+
+// [rdar://5165798] At initHardware() time and if anything goes wrong, this is how we reset the timer code.
+void AppleUSBAudioDevice::resetRateTimer ()
+{
+	mWallTimePerUSBCycle = 1000000ull * kWallTimeExtraPrecision;
+	bzero ( &mAnchorTime, sizeof ( ANCHORTIME ) );		// <rdar://problem/7378275>
+	mAnchorTime.deviceStart = TRUE;						// <rdar://problem/7666699>
+}
+
+// <rdar://problem/7666699>
+UInt64 AppleUSBAudioDevice::lastAnchorFrame ( void )
+{
+	return ( mAnchorTime.index ? mAnchorTime.X[mAnchorTime.index - 1] : mAnchorTime.X[MAX_ANCHOR_ENTRIES - 1] );
+}
+
+#if ANCHORWARMUP
+void AppleUSBAudioDevice::startAnchorWarmUp ( void )
+{
+	mAnchorWarmUpInterval = kAnchorWarmUpMinInterval;
+	mAnchorWarmUpStreak = 0;
+	mAnchorWarmUpAnchors = 0;
+	mAnchorWarmUpResidual = 0ull;
+	mAnchorWarmUpStart_nanos = getWallTimeInNanos ();
+	removeProperty (kAnchorWarmUpKey);
+}
+
+// Takes an anchor into the regression and adjusts the warm-up interval from how well the fit predicted it. Returns false if no anchor
+// could be taken.
+bool AppleUSBAudioDevice::sampleWarmUpAnchor ( void )
+{
+	AbsoluteTime	timeStamp;
+	AbsoluteTime	candidateTime;
+	UInt64			frameNumber = 0ull;
+	UInt64			candidateFrame;
+	UInt64			uncertainty = 0xFFFFFFFFFFFFFFFFull;
+	UInt64			candidateUncertainty;
+	UInt64			timeStamp_nanos;
+	UInt64			predicted_nanos;
+	UInt64			residual;
+	UInt32			candidate;
+	UInt32			candidates;
+	bool			sampled = false;
+
+	FailIf ( NULL == mTimeLock, Exit );
+	
+	// The anchor whose frame edge was bracketed most tightly is the one least disturbed by interrupts or preemption. Picking one costs up
+	// to a frame of busy-waiting per candidate, which is only worth it once ticks are far enough apart.
+	candidates = ( mAnchorWarmUpInterval >= kAnchorWarmUpBestOfInterval ) ? kAnchorWarmUpCandidates : 1;
+	for ( candidate = 0; candidate < candidates; candidate++ )
+	{
+		if	(		( kIOReturnSuccess == getAnchorFrameAndTimeStamp ( &candidateFrame, &candidateTime, &candidateUncertainty ) )
+				&&	( candidateUncertainty < uncertainty ) )
+		{
+			uncertainty = candidateUncertainty;
+			frameNumber = candidateFrame;
+			timeStamp = candidateTime;
+		}
+	}
+	FailIf ( 0xFFFFFFFFFFFFFFFFull == uncertainty, Exit );
+	absolutetime_to_nanoseconds ( timeStamp, &timeStamp_nanos );
+	
+	IOLockLock ( mTimeLock );
+	residual = 0ull;
+	if ( mAnchorTime.n > 1 )
+	{
+		predicted_nanos = getTimeForFrameNumber ( frameNumber );
+		residual = ( predicted_nanos > timeStamp_nanos ) ? ( predicted_nanos - timeStamp_nanos ) : ( timeStamp_nanos - predicted_nanos );
+	}
+	updateAnchorTime ( &mAnchorTime, frameNumber, timeStamp_nanos );
+	mWallTimePerUSBCycle = ( mAnchorTime.n > 1 ) ? getUSBCycleTime ( &mAnchorTime ) : 1000000ull * kWallTimeExtraPrecision;
+	IOLockUnlock ( mTimeLock );
+	
+	sampled = true;
+	mAnchorWarmUpAnchors++;
+	mAnchorWarmUpResidual = ( 3 * mAnchorWarmUpResidual + residual ) / 4;
+	FailIf ( mAnchorWarmUpAnchors < kAnchorWarmUpMinAnchors, Exit );
+	
+	if ( mAnchorWarmUpResidual <= kAnchorWarmUpMaxResidual )
+	{
+		if ( ++mAnchorWarmUpStreak >= kAnchorWarmUpStreak )
+		{
+			mAnchorWarmUpStreak = 0;
+			if ( mAnchorWarmUpInterval < kRefreshInterval )
+			{
+				mAnchorWarmUpInterval *= 2;
+			}
+			else
+			{
+				// The fit predicts anchors kRefreshInterval ms out, so the normal rate is enough from here on.
+				mRampUpdateCounter = MAX_ANCHOR_ENTRIES;
+				publishAnchorWarmUp ( getWallTimeInNanos () - mAnchorWarmUpStart_nanos, true );
+			}
+		}
+	}
+	else
+	{
+		mAnchorWarmUpStreak = 0;
+		if ( mAnchorWarmUpInterval > kAnchorWarmUpMinInterval )
+		{
+			mAnchorWarmUpInterval /= 2;
 		}
 	}
-	debugIOLog ( "- AppleUSBAudioDevice::calculateOffset (%p)", this );
+	
+Exit:
+	return sampled;
 }
 
-// [rdar://5165798] At initHardware() time and if anything goes wrong, this is how we reset the timer code.
-void AppleUSBAudioDevice::resetRateTimer ()
+void AppleUSBAudioDevice::publishAnchorWarmUp ( UInt64 warmUp_nanos, bool converged )
 {
-	mWallTimePerUSBCycle = 1000000ull * kWallTimeExtraPrecision;
-	bzero ( &mAnchorTime, sizeof ( ANCHORTIME ) );		// <rdar://problem/7378275>
-	mAnchorTime.deviceStart = TRUE;						// <rdar://problem/7666699>
-}
+	OSDictionary *			warmUpStatistics = NULL;
+	OSNumber *				number = NULL;
 
-// <rdar://problem/7666699>
-UInt64 AppleUSBAudioDevice::lastAnchorFrame ( void )
-{
-	return ( mAnchorTime.index ? mAnchorTime.X[mAnchorTime.index - 1] : mAnchorTime.X[MAX_ANCHOR_ENTRIES - 1] );
+	debugIOLog ("? AppleUSBAudioDevice[%p]::publishAnchorWarmUp () - %s in %llu ms after %lu anchors", this, converged ? "converged" : "did not converge", warmUp_nanos / 1000000ull, mAnchorWarmUpAnchors);
+
+	FailIf (NULL == (warmUpStatistics = OSDictionary::withCapacity (3)), Exit);
+	warmUpStatistics->setObject (kAnchorWarmUpConvergedKey, converged ? kOSBooleanTrue : kOSBooleanFalse);
+	FailIf (NULL == (number = OSNumber::withNumber (warmUp_nanos / 1000000ull, 32)), Exit);
+	warmUpStatistics->setObject (kAnchorWarmUpDurationKey, number);
+	number->release ();
+	FailIf (NULL == (number = OSNumber::withNumber (mAnchorWarmUpAnchors, 32)), Exit);
+	warmUpStatistics->setObject (kAnchorWarmUpAnchorsKey, number);
+	number->release ();
+	setProperty (kAnchorWarmUpKey, warmUpStatistics);
+
+Exit:
+	if (NULL != warmUpStatistics)
+	{
+		warmUpStatistics->release ();
+	}
 }
+#endif
 
 void AppleUSBAudioDevice::TimerAction (OSObject * owner, IOTimerEventSource * sender) 
 {
@@ -6318,16 +8047,37 @@ void AppleUSBAudioDevice::doTimerAction (IOTimerEventSource * timer)
 	// This timer thread is also used to perform routine watchdog-type events.
 	
 	UInt32 curRefreshInterval = kRefreshInterval;	// <rdar://problem/7378275>
+	#if ANCHORWARMUP
+	bool warmingUp = false;
+	bool sampled = false;
+	#endif
 	
 	#if DEBUGTIMER
 		debugIOLog ("+ AppleUSBAudioDevice::doTimerAction (%p)", timer);
 	#endif
 	FailIf (NULL == timer, Exit);
 	
+	#if ANCHORWARMUP
+	if ( 0 == mRampUpdateCounter )
+	{
+		startAnchorWarmUp ();
+	}
+	#endif
+	
 	// <rdar://problem/7666699>
 	if ( mAnchorTime.deviceStart || !allEnginesStopped () )
 	{
-		updateUSBCycleTime ();							// <rdar://problem/7378275>
+		#if ANCHORWARMUP
+		if ( mRampUpdateCounter < MAX_ANCHOR_ENTRIES )
+		{
+			warmingUp = true;
+			sampled = sampleWarmUpAnchor ();
+		}
+		else
+		#endif
+		{
+			updateUSBCycleTime ();							// <rdar://problem/7378275>
+		}
 	}
 	
 	// <rdar://problem/7378275>, <rdar://problem/7666699> Determine the next timer firing time.  When the device first 
@@ -6335,14 +8085,33 @@ void AppleUSBAudioDevice::doTimerAction (IOTimerEventSource * timer)
 	//  data array fills up.  Once it is full, we reduce to approximately 8 times per second.
 	if ( mRampUpdateCounter < MAX_ANCHOR_ENTRIES )
 	{
+		#if ANCHORWARMUP
+		// The warm-up sets its own pace, and there is no point in ticking fast while no anchors are being taken.
+		curRefreshInterval = warmingUp ? mAnchorWarmUpInterval : kRefreshInterval;
+		#else
 		curRefreshInterval = kAnchorSamplingFreq1;
+		#endif
 	}
 	else
 	{
 		curRefreshInterval = kRefreshInterval;
 	}
 	
-	mRampUpdateCounter++;		// <rdar://problem/7666699>
+	#if ANCHORWARMUP
+	// During warm-up the counter counts anchors taken, so ticks that found no anchor don't bring the end of it closer.
+	if ( sampled || ( mRampUpdateCounter >= MAX_ANCHOR_ENTRIES ) )
+	#endif
+	{
+		mRampUpdateCounter++;		// <rdar://problem/7666699>
+	}
+	
+	#if ANCHORWARMUP
+	// A warm-up that converged has already moved the counter past the end, so landing on it means the regression filled up first.
+	if ( sampled && ( MAX_ANCHOR_ENTRIES == mRampUpdateCounter ) )
+	{
+		publishAnchorWarmUp ( getWallTimeInNanos () - mAnchorWarmUpStart_nanos, false );
+	}
+	#endif
 	
 	if ( ++mTimerCallCount >= ( kRefreshInterval / curRefreshInterval ) )		// Always perform these items at kRefreshInterval
 	{
@@ -6752,9 +8521,27 @@ Exit:
 
 void AppleUSBAudioDevice::attemptDeviceRecovery ()
 {
+	#if LIGHTWEIGHTWAKE
+	IOUSBDevice *					usbDevice;
+	#endif
+	
 	debugIOLog ("+ AppleUSBAudioDevice[%p]::attemptDeviceRecovery ()", this);
 	
 	FailIf (NULL == mControlInterface, Exit);
+	#if LIGHTWEIGHTWAKE
+	if (mResetAfterFailedResume)
+	{
+		// This is the reset that was skipped on wake.
+		mResetAfterFailedResume = false;
+		FailIf (NULL == (usbDevice = mControlInterface->GetDevice ()), Exit);
+		if ( kIOReturnSuccess == usbDevice->message( kIOUSBMessageHubIsDeviceConnected, NULL, 0 ) )
+		{
+			debugIOLog ("? AppleUSBAudioDevice[%p]::attemptDeviceRecovery () - Issuing the device reset skipped on wake.", this);
+			usbDevice->ResetDevice ();
+			IOSleep (10);
+		}
+	}
+	#endif
 	/*
 	debugIOLog ("? AppleUSBAudioDevice[%p]::attemptDeviceRecovery () - Issuing device reset.", this);
 	mControlInterface->GetDevice()->ResetDevice();
@@ -6768,6 +8555,56 @@ Exit:
 	
 }
 
+#if LIGHTWEIGHTWAKE
+// An override kext may set kResetOnWakeKey on the control interface. Otherwise the value learned by startFailedAfterWake () is used, which is
+// kept on the USB device so that it outlasts the driver instance the reset replaces.
+bool AppleUSBAudioDevice::shouldResetOnWake (IOUSBDevice * usbDevice)
+{
+	OSBoolean *						resetOnWake = NULL;
+
+	if (NULL != mControlInterface)
+	{
+		resetOnWake = OSDynamicCast (OSBoolean, mControlInterface->getProperty (kResetOnWakeKey));
+	}
+	if	(		(NULL == resetOnWake)
+			&&	(NULL != usbDevice))
+	{
+		resetOnWake = OSDynamicCast (OSBoolean, usbDevice->getProperty (kResetOnWakeKey));
+	}
+	
+	return (NULL != resetOnWake) ? resetOnWake->isTrue () : false;
+}
+
+// Called by an engine whose first start after a wake without a reset failed, either in performAudioEngineStart () or by streaming nothing in
+// time. One reset covers every engine, so the others stop watching their starts.
+void AppleUSBAudioDevice::startFailedAfterWake (AppleUSBAudioEngine * engine, IOReturn result)
+{
+	IOUSBDevice *					usbDevice;
+
+	FailIf (mResetAfterFailedResume, Exit);
+	
+	debugIOLog ("! AppleUSBAudioDevice[%p]::startFailedAfterWake (%p, 0x%x) - First start after waking without a reset failed. Resetting.", this, engine, result);
+	if	(		(NULL != mControlInterface)
+			&&	(NULL != (usbDevice = mControlInterface->GetDevice ())))
+	{
+		usbDevice->setProperty (kResetOnWakeKey, kOSBooleanTrue);
+	}
+	for (UInt32 engineIndex = 0; (NULL != mEngineArray) && (engineIndex < mEngineArray->getCount ()); engineIndex++)
+	{
+		AppleUSBAudioEngine * otherEngine = OSDynamicCast (AppleUSBAudioEngine, mEngineArray->getObject (engineIndex));
+		if (NULL != otherEngine)
+		{
+			otherEngine->mVerifyStartAfterWake = false;
+		}
+	}
+	mResetAfterFailedResume = true;
+	requestDeviceRecovery ();
+	
+Exit:
+	return;
+}
+#endif
+
 #pragma mark Clock Entity Requests
 
 IOReturn AppleUSBAudioDevice::getClockSetting (UInt8 controlSelector, UInt8 unitID, UInt8 requestType, void * target, UInt16 length) {
@@ -6782,7 +8619,7 @@ IOReturn AppleUSBAudioDevice::getClockSetting (UInt8 controlSelector, UInt8 unit
 	FailIf (NULL == target, Exit);
 	FailIf (NULL == mControlInterface, Exit);
 
-	theSettingDesc = IOBufferMemoryDescriptor::withOptions (kIODirectionIn, length);
+	theSettingDesc = acquireControlBuffer (kIODirectionIn, length);
 	FailIf (NULL == theSettingDesc, Exit);
 
     devReq.bmRequestType = USBmakebmRequestType (kUSBIn, kUSBClass, kUSBInterface);
@@ -6803,7 +8640,7 @@ IOReturn AppleUSBAudioDevice::getClockSetting (UInt8 controlSelector, UInt8 unit
 Exit:
 	if (NULL != theSettingDesc) 
 	{
-		theSettingDesc->release ();
+		releaseControlBuffer (theSettingDesc);
 	}
 	return result;
 }
@@ -6816,8 +8653,10 @@ IOReturn AppleUSBAudioDevice::setClockSetting (UInt8 controlSelector, UInt8 unit
 	result = kIOReturnError;
 	FailIf (NULL == mControlInterface, Exit);
 
-	theSettingDesc = IOBufferMemoryDescriptor::withBytes (target, length, kIODirectionOut);
+	FailIf (NULL == target, Exit);
+	theSettingDesc = acquireControlBuffer (kIODirectionOut, length);
 	FailIf (NULL == theSettingDesc, Exit);
+	memcpy (theSettingDesc->getBytesNoCopy (), target, length);
 
     devReq.bmRequestType = USBmakebmRequestType (kUSBOut, kUSBClass, kUSBInterface);
     devReq.bRequest = requestType;
@@ -6832,7 +8671,7 @@ IOReturn AppleUSBAudioDevice::setClockSetting (UInt8 controlSelector, UInt8 unit
 Exit:
 	if (NULL != theSettingDesc) 
 	{
-		theSettingDesc->release ();
+		releaseControlBuffer (theSettingDesc);
 	}
 	return result;
 	
@@ -6911,6 +8750,78 @@ Exit:
 	return result;
 }
 
+// Reads the whole RANGE parameter block once, instead of once per subrange as getIndexedClockSourceSamplingFrequencySubRange () does.
+IOReturn AppleUSBAudioDevice::getClockSourceSamplingFrequencySubRanges (UInt8 unitID, AUASampleRateRanges * sampleRateRanges) {
+	struct {
+	UInt16								wNumSubRanges;
+	SubRange32							SubRanges[1];
+	}									rangeParameterBlock;
+	void *								theRangeParameterBlock;
+	UInt32								theRangeParameterBlockLength;
+	SubRange32 *						theSubRanges;
+	SubRange32							subRange;
+	bool								subRangeIsValid;
+	IOReturn							result;
+
+	rangeParameterBlock.wNumSubRanges = 0;
+	theRangeParameterBlock = NULL;
+	theRangeParameterBlockLength = 0;
+
+	result = kIOReturnError;
+	FailIf (NULL == sampleRateRanges, Exit);
+	
+	result = getClockSetting (USBAUDIO_0200::CS_SAM_FREQ_CONTROL, unitID, USBAUDIO_0200::RANGE, &rangeParameterBlock, sizeof(rangeParameterBlock));
+	FailIf (kIOReturnSuccess != result, Exit);
+	
+	rangeParameterBlock.wNumSubRanges = USBToHostWord (rangeParameterBlock.wNumSubRanges);
+	if (0 == rangeParameterBlock.wNumSubRanges)
+	{
+		goto Exit;
+	}
+
+	result = kIOReturnError;
+	theRangeParameterBlockLength = 2 + (rangeParameterBlock.wNumSubRanges * sizeof(SubRange32));
+	// wLength is 16 bits wide.
+	FailIf (theRangeParameterBlockLength > 0xFFFF, Exit);
+	theRangeParameterBlock = IOMalloc(theRangeParameterBlockLength);
+	FailIf (NULL == theRangeParameterBlock, Exit);
+	
+	result = getClockSetting (USBAUDIO_0200::CS_SAM_FREQ_CONTROL, unitID, USBAUDIO_0200::RANGE, theRangeParameterBlock, theRangeParameterBlockLength);
+	FailIf (kIOReturnSuccess != result, Exit);
+	
+	theSubRanges = (SubRange32 *)(((UInt8 *) theRangeParameterBlock) + 2);
+	
+	for (UInt16 subRangeIndex = 0; subRangeIndex < rangeParameterBlock.wNumSubRanges; subRangeIndex++)
+	{
+		subRange.dMIN = USBToHostLong (theSubRanges[subRangeIndex].dMIN);
+		subRange.dMAX = USBToHostLong (theSubRanges[subRangeIndex].dMAX);
+		subRange.dRES = USBToHostLong (theSubRanges[subRangeIndex].dRES);
+		
+		// [rdar://4952486] Make sure that the device isn't just spewing garbage before trying to add these values.
+		subRangeIsValid = (			( subRange.dMIN <= subRange.dMAX )
+								&&	(		( 0 == subRange.dRES )
+										||	( 0 == ( subRange.dMAX - subRange.dMIN ) % subRange.dRES ) ) );		
+		if (!subRangeIsValid)
+		{
+			debugIOLog ("! AppleUSBAudioDevice[%p]::getClockSourceSamplingFrequencySubRanges () - invalid subrange, skipping ...", this);
+			debugIOLog ("    subRange.dMIN = %lu", subRange.dMIN);
+			debugIOLog ("    subRange.dMAX = %lu", subRange.dMAX);
+			debugIOLog ("    subRange.dRES = %lu", subRange.dRES);
+			continue;
+		}
+		
+		FailIf (kIOReturnSuccess != (result = AUASampleRateRangesAdd (sampleRateRanges, subRange.dMIN, subRange.dMAX, subRange.dRES)), Exit);
+	}
+	
+Exit:
+	if (NULL != theRangeParameterBlock) 
+	{
+		IOFree (theRangeParameterBlock, theRangeParameterBlockLength);
+	}	
+
+	return result;
+}
+
 IOReturn AppleUSBAudioDevice::getCurClockSourceSamplingFrequency (UInt8 unitID, UInt32 * samplingFrequency, bool * validity) {
 	UInt32								clockFrequency;
 	Boolean								clockValidity;
@@ -7080,6 +8991,48 @@ Exit:
 	return result;
 }
 
+IOReturn AppleUSBAudioDevice::getSampleRateRangesForClockPath (AUASampleRateRanges * sampleRateRanges, OSArray * clockPath) {
+	OSObject *							arrayObject = NULL;
+	OSNumber *							arrayNumber = NULL;
+	UInt32								clockIndex;
+	UInt8								clockID;
+	UInt8								subType;
+	UInt16								numerator;
+	UInt16								denominator;
+	IOReturn							result;
+
+	result = kIOReturnError;
+	FailIf (NULL == sampleRateRanges, Exit);
+	FailIf (NULL == clockPath, Exit);
+	FailIf (NULL == mControlInterface, Exit);
+	FailIf (NULL == mConfigDictionary, Exit);
+	
+	// Walk from the clock source at the end of the path towards the terminal, scaling at each multiplier.
+	for (clockIndex = clockPath->getCount (); clockIndex > 0 ; clockIndex--) 
+	{
+		FailIf (NULL == (arrayObject = clockPath->getObject (clockIndex - 1)), Exit);
+		FailIf (NULL == (arrayNumber = OSDynamicCast (OSNumber, arrayObject)), Exit);
+		clockID = arrayNumber->unsigned8BitValue();
+		
+		FailIf (kIOReturnSuccess != (result = mConfigDictionary->getSubType (&subType, mControlInterface->GetInterfaceNumber(), 0, clockID)), Exit);
+		
+		if (USBAUDIO_0200::CLOCK_SOURCE == subType)
+		{
+			FailIf (kIOReturnSuccess !=  (result = getClockSourceSampleRates (sampleRateRanges, clockID)), Exit);
+		}
+		else if (USBAUDIO_0200::CLOCK_MULTIPLIER == subType)
+		{
+			FailIf (kIOReturnSuccess !=  (result = getCurClockMultiplier (clockID, &numerator, &denominator)), Exit);
+			FailIf (kIOReturnSuccess !=  (result = scaleSampleRateRanges (sampleRateRanges, numerator, denominator)), Exit);
+		}
+	}	
+	
+	result = kIOReturnSuccess;
+	
+Exit:
+	return result;
+}
+
 IOReturn AppleUSBAudioDevice::getClockPathCurSampleRate (UInt32 * sampleRate, Boolean * validity, Boolean * isReadOnly, OSArray * clockPath) {		//	<rdar://6945472>
 	OSObject *							arrayObject = NULL;
 	OSNumber *							arrayNumber = NULL;
@@ -7234,6 +9187,165 @@ Exit:
 
 #pragma mark Single Audio Engine Capability
 
+// Binary search of the ascending rate table. Returns true if the rate is present; index receives its position, or the
+// position at which it would have to be inserted.
+static bool findRateInTable (const UInt32 * rates, UInt32 numRates, UInt32 rate, UInt32 * index)
+{
+	UInt32		low = 0;
+	UInt32		high = numRates;
+	UInt32		middle;
+
+	while (low < high)
+	{
+		middle = low + ((high - low) / 2);
+		if (rates[middle] < rate)
+		{
+			low = middle + 1;
+		}
+		else
+		{
+			high = middle;
+		}
+	}
+	*index = low;
+	return ((low < numRates) && (rates[low] == rate));
+}
+
+//	Gathers the direction, sync type, sample rates and clock entities of every stream interface into bitmasks.
+IOReturn AppleUSBAudioDevice::buildStreamCapabilities (OSArray * streamInterfaceNumbers) {
+
+	AUAStreamCapabilities *	capabilities = NULL;
+	OSNumber *				streamInterfaceNumber;
+	OSArray *				rates;
+	OSNumber *				rate;
+	UInt32					rateIndex;
+	UInt8					interfaceNum;
+	UInt8					numAltSettings;
+	IOReturn				result = kIOReturnError;
+
+	debugIOLog ("+ AppleUSBAudioDevice[%p]::buildStreamCapabilities (%p)", this, streamInterfaceNumbers);
+
+	FailIf ( NULL == streamInterfaceNumbers, Exit );
+	FailIf ( NULL == mConfigDictionary, Exit );
+	freeStreamCapabilities ();
+
+	FailIf ( NULL == ( capabilities = (AUAStreamCapabilities *)IOMalloc ( sizeof ( AUAStreamCapabilities ) ) ), Exit );
+	bzero ( capabilities, sizeof ( AUAStreamCapabilities ) );
+	capabilities->ratesIndexed = true;
+
+	// First pass: the endpoint summary of each stream and the table of all distinct sample rates.
+	for ( UInt32 streamIndex = 0; streamIndex < streamInterfaceNumbers->getCount (); streamIndex++ )
+	{
+		FailIf ( NULL == ( streamInterfaceNumber = OSDynamicCast ( OSNumber, streamInterfaceNumbers->getObject ( streamIndex ) ) ), Exit );
+		interfaceNum = streamInterfaceNumber->unsigned8BitValue ();
+		if ( kIOReturnSuccess != mConfigDictionary->getNumAltSettings ( &numAltSettings, interfaceNum ) )
+		{
+			// Left invalid, so the stream is answered the slow way.
+			continue;
+		}
+		capabilities->flags[interfaceNum] |= kAUAStreamCapabilityValid;
+
+		// Same alternate settings and endpoint lookups as streamEndpointsHaveSpecifiedDirectionAndSyncType ().
+		for ( UInt8 altSetting = ( mConfigDictionary->alternateSettingZeroCanStream ( interfaceNum ) ? 0 : 1 ); altSetting < numAltSettings; altSetting++ )
+		{
+			UInt8	direction = 0;
+			UInt8	address = 0;
+			UInt8	syncType = 0;
+			if ( ( kIOReturnSuccess == mConfigDictionary->getIsocEndpointDirection (&direction, interfaceNum, altSetting) ) && 
+				 ( kIOReturnSuccess == mConfigDictionary->getIsocEndpointAddress (&address, interfaceNum, altSetting, direction) ) &&
+				 ( kIOReturnSuccess == mConfigDictionary->getIsocEndpointSyncType (&syncType, interfaceNum, altSetting, address) ) )
+			{
+				capabilities->directionMask[interfaceNum] |= ( 1 << ( direction & 7 ) );
+				capabilities->syncTypeMask[interfaceNum] |= ( 1 << ( syncType & 7 ) );
+			}
+		}
+
+		// Same alternate settings as getSampleRatesFromStreamInterface (): each one's discrete rates, then the bounds of its continuous ranges.
+		for ( UInt32 rateList = 0; rateList < 2 * (UInt32)numAltSettings; rateList++ )
+		{
+			UInt8	altSetting = rateList >> 1;
+			rates = ( 0 == ( rateList & 1 ) ) ? mConfigDictionary->getSampleRates ( interfaceNum, altSetting ) : mConfigDictionary->getSampleRateRanges ( interfaceNum, altSetting );
+			if ( NULL == rates )
+			{
+				continue;
+			}
+			capabilities->flags[interfaceNum] |= kAUAStreamCapabilityHasRates;
+			for ( UInt32 index = 0; ( index < rates->getCount () ) && capabilities->ratesIndexed; index++ )
+			{
+				if (	( NULL != ( rate = OSDynamicCast ( OSNumber, rates->getObject ( index ) ) ) )
+					&&	!findRateInTable ( capabilities->rates, capabilities->numRates, rate->unsigned32BitValue (), &rateIndex ) )
+				{
+					if ( kAUAMaxRateTableEntries == capabilities->numRates )
+					{
+						capabilities->ratesIndexed = false;
+						break;
+					}
+					memmove ( &capabilities->rates[rateIndex + 1], &capabilities->rates[rateIndex], ( capabilities->numRates - rateIndex ) * sizeof ( UInt32 ) );
+					capabilities->rates[rateIndex] = rate->unsigned32BitValue ();
+					capabilities->numRates++;
+				}
+			}
+		}
+
+		if ( getStreamClockMask ( interfaceNum, capabilities->clockMask[interfaceNum] ) )
+		{
+			capabilities->flags[interfaceNum] |= kAUAStreamCapabilityHasClockMask;
+		}
+	}
+
+	// Second pass: now that the table is complete, turn each stream's rates into a bitmask over it.
+	for ( UInt32 streamIndex = 0; ( streamIndex < streamInterfaceNumbers->getCount () ) && capabilities->ratesIndexed; streamIndex++ )
+	{
+		FailIf ( NULL == ( streamInterfaceNumber = OSDynamicCast ( OSNumber, streamInterfaceNumbers->getObject ( streamIndex ) ) ), Exit );
+		interfaceNum = streamInterfaceNumber->unsigned8BitValue ();
+		if ( 0 == ( capabilities->flags[interfaceNum] & kAUAStreamCapabilityHasRates ) )
+		{
+			continue;
+		}
+		FailIf ( kIOReturnSuccess != mConfigDictionary->getNumAltSettings ( &numAltSettings, interfaceNum ), Exit );
+		for ( UInt32 rateList = 0; rateList < 2 * (UInt32)numAltSettings; rateList++ )
+		{
+			UInt8	altSetting = rateList >> 1;
+			rates = ( 0 == ( rateList & 1 ) ) ? mConfigDictionary->getSampleRates ( interfaceNum, altSetting ) : mConfigDictionary->getSampleRateRanges ( interfaceNum, altSetting );
+			if ( NULL == rates )
+			{
+				continue;
+			}
+			for ( UInt32 index = 0; index < rates->getCount (); index++ )
+			{
+				if (	( NULL != ( rate = OSDynamicCast ( OSNumber, rates->getObject ( index ) ) ) )
+					&&	findRateInTable ( capabilities->rates, capabilities->numRates, rate->unsigned32BitValue (), &rateIndex ) )
+				{
+					capabilities->rateMask[interfaceNum][rateIndex >> 5] |= ( 1U << ( rateIndex & 31 ) );
+				}
+			}
+		}
+	}
+
+	debugIOLog ("? AppleUSBAudioDevice[%p]::buildStreamCapabilities () - %lu distinct sample rates, indexed = %d", this, capabilities->numRates, capabilities->ratesIndexed);
+	mStreamCapabilities = capabilities;
+	capabilities = NULL;
+	result = kIOReturnSuccess;
+
+Exit:
+	if ( NULL != capabilities )
+	{
+		IOFree ( capabilities, sizeof ( AUAStreamCapabilities ) );
+	}
+
+	debugIOLog ("- AppleUSBAudioDevice[%p]::buildStreamCapabilities (%p) = 0x%x", this, streamInterfaceNumbers, result);
+	return result;
+}
+
+void AppleUSBAudioDevice::freeStreamCapabilities (void) {
+
+	if ( NULL != mStreamCapabilities )
+	{
+		IOFree ( mStreamCapabilities, sizeof ( AUAStreamCapabilities ) );
+		mStreamCapabilities = NULL;
+	}
+}
+
 //	<rdar://5131786>	Find streams that has common sample rates, and return an array of the streams.
 //	The caller is responsible to release the returned stream array.
 OSArray * AppleUSBAudioDevice::findStreamsWithCommonSampleRates (OSArray * availableStreamList) {
@@ -7423,6 +9535,21 @@ bool AppleUSBAudioDevice::streamsHaveCommonSampleRates (OSNumber * streamInterfa
 
 	debugIOLog ("? AppleUSBAudioDevice[%p]::streamsHaveCommonSampleRates (%d, %d)", this, streamInterfaceNumberA->unsigned8BitValue (), streamInterfaceNumberB->unsigned8BitValue ());
 
+	if ( ( NULL != mStreamCapabilities ) && mStreamCapabilities->ratesIndexed )
+	{
+		UInt8	flagsA = mStreamCapabilities->flags[streamInterfaceNumberA->unsigned8BitValue ()];
+		UInt8	flagsB = mStreamCapabilities->flags[streamInterfaceNumberB->unsigned8BitValue ()];
+		
+		if ( ( flagsA & kAUAStreamCapabilityValid ) && ( flagsB & kAUAStreamCapabilityValid ) )
+		{
+			// Both streams must offer rates, and exactly the same ones.
+			result =	( flagsA & kAUAStreamCapabilityHasRates )
+					&&	( flagsB & kAUAStreamCapabilityHasRates )
+					&&	( 0 == memcmp ( mStreamCapabilities->rateMask[streamInterfaceNumberA->unsigned8BitValue ()], mStreamCapabilities->rateMask[streamInterfaceNumberB->unsigned8BitValue ()], sizeof ( mStreamCapabilities->rateMask[0] ) ) );
+			goto Exit;
+		}
+	}
+
 	sampleRatesA = getSampleRatesFromStreamInterface ( streamInterfaceNumberA );
 	sampleRatesB = getSampleRatesFromStreamInterface ( streamInterfaceNumberB );
 	
@@ -7464,6 +9591,14 @@ bool AppleUSBAudioDevice::streamsHaveCommonSampleRates (OSNumber * streamInterfa
 	}
 	
 Exit:
+	if ( NULL != sampleRatesA )
+	{
+		sampleRatesA->release ();
+	}
+	if ( NULL != sampleRatesB )
+	{
+		sampleRatesB->release ();
+	}
 	debugIOLog ("+ AppleUSBAudioDevice[%p]::streamsHaveCommonClocks (%p, %p) - result = %d", this, streamInterfaceNumberA, streamInterfaceNumberB, result);
 
 	return result;
@@ -7482,9 +9617,11 @@ OSArray * AppleUSBAudioDevice::getSampleRatesFromStreamInterface (OSNumber * str
 	
 	if ( kIOReturnSuccess == mConfigDictionary->getNumAltSettings ( &numAltSettings, interfaceNum ) )
 	{
-		for ( UInt8 altSetting = 0; altSetting < numAltSettings; altSetting++ )
+		// The bounds of a continuous range stand in for the range.
+		for ( UInt32 rateList = 0; rateList < 2 * (UInt32)numAltSettings; rateList++ )
 		{
-			OSArray *	rates = mConfigDictionary->getSampleRates ( interfaceNum, altSetting );
+			UInt8		altSetting = rateList >> 1;
+			OSArray *	rates = ( 0 == ( rateList & 1 ) ) ? mConfigDictionary->getSampleRates ( interfaceNum, altSetting ) : mConfigDictionary->getSampleRateRanges ( interfaceNum, altSetting );
 			
 			if ( NULL != rates )
 			{
@@ -8004,6 +10141,30 @@ bool AppleUSBAudioDevice::streamEndpointsHaveSpecifiedDirectionAndSyncType ( OSN
 	
 	debugIOLog ("? AppleUSBAudioDevice[%p]::streamEndpointsHaveSpecifiedDirectionAndSyncType (%d, %d, %d)", this, interfaceNum, endpointDirection, endpointSyncType);
 
+	if ( ( NULL != mStreamCapabilities ) && ( mStreamCapabilities->flags[interfaceNum] & kAUAStreamCapabilityValid ) )
+	{
+		UInt8	syncTypeMask = mStreamCapabilities->syncTypeMask[interfaceNum];
+		
+		// Every endpoint must point the specified way.
+		hasSpecifiedDirection = ( 0 == ( mStreamCapabilities->directionMask[interfaceNum] & ~( 1 << ( endpointDirection & 7 ) ) ) );
+		switch ( endpointSyncType )
+		{
+			case kUnknownSyncType:
+				// The alternate settings disagree about the sync type.
+				hasSpecifiedSyncType = ( 0 != ( syncTypeMask & ( syncTypeMask - 1 ) ) );
+				break;
+			case kNoneSyncType:
+			case kSynchronousSyncType:
+				hasSpecifiedSyncType = ( 0 == ( syncTypeMask & ~( ( 1 << kNoneSyncType ) | ( 1 << kSynchronousSyncType ) ) ) );
+				break;
+			default:
+				hasSpecifiedSyncType = ( 0 == ( syncTypeMask & ~( 1 << ( endpointSyncType & 7 ) ) ) );
+				break;
+		}
+		result = hasSpecifiedDirection && hasSpecifiedSyncType;
+		goto Exit;
+	}
+
 	if ( kIOReturnSuccess == mConfigDictionary->getNumAltSettings ( &numAltSettings, interfaceNum ) )
 	{
 		bool	startAtZero = mConfigDictionary->alternateSettingZeroCanStream ( interfaceNum );
@@ -8285,6 +10446,8 @@ bool AppleUSBAudioDevice::streamsHaveCommonClocks (OSNumber * streamInterfaceNum
 	UInt32		numClockPathCrossed = 0;
 	UInt8		interfaceNum;
 	UInt8		numAltSettings = 0;
+	UInt32		clockMaskA[kAUAGraphMaskWords];
+	UInt32		clockMaskB[kAUAGraphMaskWords];
 	bool		result = false;
 	 
 	debugIOLog ("+ AppleUSBAudioDevice[%p]::streamsHaveCommonClocks (%p, %p)", this, streamInterfaceNumberA, streamInterfaceNumberB);
@@ -8292,6 +10455,23 @@ bool AppleUSBAudioDevice::streamsHaveCommonClocks (OSNumber * streamInterfaceNum
 	FailIf ( NULL == streamInterfaceNumberA, Exit );
 	FailIf ( NULL == streamInterfaceNumberB, Exit );
 	
+	// Streams whose clock domains do not share a single clock entity can not have a common clock at any sample rate.
+	if (	( NULL != mStreamCapabilities )
+		&&	( mStreamCapabilities->flags[streamInterfaceNumberA->unsigned8BitValue ()] & kAUAStreamCapabilityHasClockMask )
+		&&	( mStreamCapabilities->flags[streamInterfaceNumberB->unsigned8BitValue ()] & kAUAStreamCapabilityHasClockMask ) )
+	{
+		if ( !AUAGraphMaskIntersects ( mStreamCapabilities->clockMask[streamInterfaceNumberA->unsigned8BitValue ()], mStreamCapabilities->clockMask[streamInterfaceNumberB->unsigned8BitValue ()] ) )
+		{
+			goto Exit;
+		}
+	}
+	else if (	getStreamClockMask ( streamInterfaceNumberA->unsigned8BitValue (), clockMaskA )
+			&&	getStreamClockMask ( streamInterfaceNumberB->unsigned8BitValue (), clockMaskB )
+			&&	!AUAGraphMaskIntersects ( clockMaskA, clockMaskB ) )
+	{
+		goto Exit;
+	}
+	
 	debugIOLog ("? AppleUSBAudioDevice[%p]::streamsHaveCommonClocks (%d, %d)", this, streamInterfaceNumberA->unsigned8BitValue (), streamInterfaceNumberB->unsigned8BitValue ());
 
 	interfaceNum = streamInterfaceNumberB->unsigned8BitValue ();
@@ -8300,9 +10480,11 @@ bool AppleUSBAudioDevice::streamsHaveCommonClocks (OSNumber * streamInterfaceNum
 	{
 		bool	startAtZero = mConfigDictionary->alternateSettingZeroCanStream ( interfaceNum );
 		
-		for ( UInt8 altSetting = (startAtZero ? 0 : 1); altSetting < numAltSettings; altSetting++ )
+		// Discrete rates, then the bounds of any continuous ranges, for each alternate setting.
+		for ( UInt32 rateList = (startAtZero ? 0 : 2); rateList < 2 * (UInt32)numAltSettings; rateList++ )
 		{
-			OSArray *	rates = mConfigDictionary->getSampleRates ( interfaceNum, altSetting );
+			UInt8		altSetting = rateList >> 1;
+			OSArray *	rates = ( 0 == ( rateList & 1 ) ) ? mConfigDictionary->getSampleRates ( interfaceNum, altSetting ) : mConfigDictionary->getSampleRateRanges ( interfaceNum, altSetting );
 			if (NULL != rates)
 			{
 				clockPathGroup = getClockPathGroup ( interfaceNum, altSetting );
@@ -38,6 +38,8 @@
 
 #include <IOKit/IOLocks.h>
 #include <IOKit/IOLib.h>
+#include <libkern/OSAtomic.h>
+#include <IOKit/IOSubMemoryDescriptor.h>
 #include <IOKit/IOKitKeys.h>
 #include <IOKit/IORegistryEntry.h>
 #include <IOKit/IOMessage.h>
@@ -120,6 +122,93 @@ typedef struct
 
 } ANCHORTIME;
 
+// Unit graph of the control interface. Units are numbered densely in the order they are discovered from the output terminals,
+// node sets are kept as bitmasks and terminal-to-terminal paths are enumerated into a flat arena of node indices.
+
+#define kAUAMaxGraphNodes				256
+#define kAUAGraphMaskWords				( kAUAMaxGraphNodes / 32 )
+#define kAUANoGraphNode					0xFF
+
+typedef struct
+{
+	UInt32		numNodes;
+	UInt8		nodeForUnit[kAUAMaxGraphNodes];						// unitID -> node index, kAUANoGraphNode if the unit is not in the graph
+	UInt8		unitID[kAUAMaxGraphNodes];
+	UInt8		subType[kAUAMaxGraphNodes];
+	UInt8		numSources[kAUAMaxGraphNodes];
+	UInt16		firstSource[kAUAMaxGraphNodes];						// index of the node's first entry in sources
+	UInt32		sourceMask[kAUAMaxGraphNodes][kAUAGraphMaskWords];
+	UInt32		inputTerminalMask[kAUAGraphMaskWords];
+	UInt32		reachesInputMask[kAUAGraphMaskWords];				// nodes from which at least one input terminal can be reached
+	UInt8 *		sources;											// source node indices of every node, in descriptor order
+	UInt32		sourcesCapacity;
+	UInt32		sourcesCount;
+	UInt8		stackNode[kAUAMaxGraphNodes];						// depth-first search stack, reused for every output terminal
+	UInt8		stackNextSource[kAUAMaxGraphNodes];
+	UInt32		onPathMask[kAUAGraphMaskWords];
+	UInt8 *		pathArena;											// node indices of the enumerated paths, back to back
+	UInt32		pathArenaCapacity;
+	UInt32		pathArenaCount;
+	UInt32 *	pathStart;											// numPaths + 1 offsets into pathArena
+	UInt32		pathStartCapacity;
+	UInt32		numPaths;
+	OSNumber *	unitNumber[kAUAMaxGraphNodes];						// shared by every path array that contains the node
+} AUAUnitGraph;
+
+static inline void AUAGraphMaskSet (UInt32 * mask, UInt32 node) { mask[node >> 5] |= ( 1U << ( node & 31 ) ); }
+static inline void AUAGraphMaskClear (UInt32 * mask, UInt32 node) { mask[node >> 5] &= ~( 1U << ( node & 31 ) ); }
+static inline bool AUAGraphMaskTest (const UInt32 * mask, UInt32 node) { return 0 != ( mask[node >> 5] & ( 1U << ( node & 31 ) ) ); }
+static inline bool AUAGraphMaskIntersects (const UInt32 * maskA, const UInt32 * maskB)
+{
+	for ( UInt32 word = 0; word < kAUAGraphMaskWords; word++ )
+	{
+		if ( maskA[word] & maskB[word] )
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+// Bitmask view of mClockGraph. Every clock path is reduced to the set of clock entities on it, and every path group to the set
+// of clock entities that can drive the terminals it clocks, so that path crossing and common clock checks are mask intersections.
+
+typedef struct
+{
+	UInt32		numNodes;
+	UInt8		nodeForClock[kAUAMaxGraphNodes];					// clock entity ID -> node index, kAUANoGraphNode if not on any path
+	UInt8		groupForClockEntity[kAUAMaxGraphNodes];				// terminal clock entity ID -> index of its path group in mClockGraph
+	UInt32		numGroups;
+	UInt32		numPaths;
+	OSArray **	paths;												// path arrays owned by mClockGraph, not retained
+	UInt32 *	pathMasks;											// kAUAGraphMaskWords per path
+	UInt32 *	groupMasks;											// kAUAGraphMaskWords per path group
+} AUAClockGraph;
+
+// Capabilities of every stream interface, gathered once while the audio engines are being created so that the stream
+// partitioning predicates compare bitmasks instead of re-reading the configuration dictionary for every pair of streams.
+
+#define kAUAMaxRateTableEntries			256
+#define kAUARateMaskWords				( kAUAMaxRateTableEntries / 32 )
+
+enum {
+	kAUAStreamCapabilityValid			= ( 1 << 0 ),
+	kAUAStreamCapabilityHasRates		= ( 1 << 1 ),
+	kAUAStreamCapabilityHasClockMask	= ( 1 << 2 )
+};
+
+typedef struct
+{
+	bool		ratesIndexed;										// false if the streams offer more distinct rates than the table holds
+	UInt32		numRates;
+	UInt32		rates[kAUAMaxRateTableEntries];						// every sample rate offered by any stream interface, ascending
+	UInt8		flags[256];											// indexed by stream interface number
+	UInt8		directionMask[256];									// ( 1 << direction ) for the endpoint of every streaming alternate setting
+	UInt8		syncTypeMask[256];									// ( 1 << sync type ) for the endpoint of every streaming alternate setting
+	UInt32		rateMask[256][kAUARateMaskWords];					// bits index rates
+	UInt32		clockMask[256][kAUAGraphMaskWords];					// clock entities that can clock the stream, see getStreamClockMask
+} AUAStreamCapabilities;
+
 class IOUSBInterface;
 class AppleUSBAudioEngine;
 
@@ -147,8 +236,94 @@ class AppleUSBAudioEngine;
 
 #define kMaxTimestampJitter				10000ull						// <rdar://7378275>
 
+// Anchor warm-up. Each tick takes one anchor; once ticks are kAnchorWarmUpBestOfInterval ms or more apart it keeps the best of
+// kAnchorWarmUpCandidates back-to-back anchors instead, since each can busy-wait for most of a frame. Ticks start kAnchorWarmUpMinInterval
+// ms apart, and the interval doubles after kAnchorWarmUpStreak anchors in a row fall within kAnchorWarmUpMaxResidual ns of the fit's
+// prediction. A miss halves it again. Warm-up is over once the interval reaches kRefreshInterval, or once the regression is full.
+#define kAnchorWarmUpCandidates			3
+#define kAnchorWarmUpBestOfInterval		8								// ms
+#define kAnchorWarmUpMinInterval		2								// ms
+#define kAnchorWarmUpMinAnchors			16
+#define kAnchorWarmUpStreak				4
+#define kAnchorWarmUpMaxResidual		4000ull							// ns
+
+#define kAUAControlRequestAttempts		5								// tries per control request
+#define kAUAControlRequestMaxBackoff	4								// ms between tries, doubling from 1
+#define kAUAMaxBatchedControlRequests	32								// control requests kept in flight at once
+
+// Single control transfers borrow one of these preallocated buffers rather than allocating a descriptor each time. The size covers a
+// clock source RANGE block with a few subranges; longer transfers, or any made while every buffer is out, allocate their own.
+#define kAUAControlBufferPoolSize		4
+#define kAUAControlBufferSize			64
+
+typedef struct {
+	IOReturn	result;												// of the queries; the values below are only valid on success
+	IOReturn	setResult;
+	bool		setCur;												// write cur back to the device
+	SInt16		cur;
+	SInt16		min;
+	SInt16		max;
+	UInt16		resolution;
+} AUAVolumeSettings;
+
 #define kDisplayRoutingPropertyKey		"DisplayRouting"				// <rdar://problem/7349398>
 
+// Per-device wake policy. An override kext can set it on the control interface; otherwise it is learned and kept on the USB device.
+#define kResetOnWakeKey					"ResetOnWake"
+
+#define kConfigurationCacheKey			"ConfigurationCache"
+#define kConfigurationCacheHitsKey		"Hits"
+#define kConfigurationCacheMissesKey	"Misses"
+#define kConfigurationCacheEntriesKey	"Entries"
+
+#define kAnchorWarmUpKey				"AnchorWarmUp"					// published when warm-up ends, removed when it starts
+#define kAnchorWarmUpConvergedKey		"Converged"						// false if the regression filled up first
+#define kAnchorWarmUpDurationKey		"Duration"						// ms
+#define kAnchorWarmUpAnchorsKey			"Anchors"
+
+#define kControlCoalescingKey			"ControlCoalescing"
+#define kControlRequestsIssuedKey		"RequestsIssued"
+#define kControlRequestsSavedKey		"RequestsSaved"
+#define kControlRequestsFailedKey		"RequestsFailed"
+#define kControlLastFailureKey			"LastFailure"					// IOReturn of the last request a flush couldn't send
+
+// Volume and mute changes are held per (unit, channel, selector). The first change waits kAUAControlFlushInterval ms for others to
+// join it; the flush then sends the latest value of each and keeps making passes while new changes arrive during the requests, so a
+// dragged slider sends its latest value rather than every value it passed through, at the pace the device answers.
+#define kAUAMaxCoalescedControls		64
+#define kAUAControlFlushInterval		5								// ms
+
+typedef struct {
+	UInt8		unitID;
+	UInt8		channelNum;
+	UInt8		controlSelector;
+	bool		pending;
+	SInt32		value;												// IOAudioControl value, converted to device units when flushed
+} AUACoalescedControl;
+
+// Index of the engines' default volume, mute and input selector controls by the unit they belong to, so that a status interrupt
+// refreshes just that unit's controls with one batch of GET_CUR requests. Every entry owns a view of a shared reply buffer, which is
+// made when the index is built, not per interrupt. The index is rebuilt once mAudioControlsGeneration has moved on.
+#define kAUANoUnitControl				0xFFFF
+
+typedef struct {
+	IOAudioControl *			control;							// retained
+	IOSubMemoryDescriptor *		reply;								// 2 bytes of the index's reply buffer
+	UInt8						unitID;
+	UInt8						channelNum;
+	UInt8						controlSelector;					// VOLUME_CONTROL, MUTE_CONTROL or 0 for a selector unit
+} AUAUnitControl;
+
+typedef struct {
+	AUAUnitControl *			controls;							// sorted by unitID
+	UInt32						numControls;
+	UInt32						capacity;
+	IOBufferMemoryDescriptor *	replies;
+	SInt32						generation;							// mAudioControlsGeneration when built
+	bool						built;
+	UInt16						firstControl[256];					// unit ID -> index of its first control, or kAUANoUnitControl
+} AUAUnitControlIndex;
+
 class AppleUSBAudioDevice : public IOAudioDevice {
     OSDeclareDefaultStructors (AppleUSBAudioDevice);
 
@@ -168,6 +343,13 @@ public:
 	ANCHORTIME							mAnchorTime;					// <rdar://7378275>
 	IOLock *							mTimeLock;						// <rdar://7378275>
 	UInt64								mRampUpdateCounter;				// <rdar://problem/7666699>
+	#if ANCHORWARMUP
+	UInt32								mAnchorWarmUpInterval;			// ms between warm-up ticks
+	UInt32								mAnchorWarmUpStreak;			// anchors in a row within kAnchorWarmUpMaxResidual
+	UInt32								mAnchorWarmUpAnchors;
+	UInt64								mAnchorWarmUpResidual;			// smoothed |predicted - actual| in ns
+	UInt64								mAnchorWarmUpStart_nanos;
+	#endif
 	UInt64								Xcopy[MAX_ANCHOR_ENTRIES];		// <rdar://problem/7666699>
 	UInt64								Ycopy[MAX_ANCHOR_ENTRIES];		// <rdar://problem/7666699>
 
@@ -175,6 +357,8 @@ protected:
 	AUAConfigurationDictionary *		mConfigDictionary;
 	OSArray *							mControlGraph;
 	OSArray *							mClockGraph;
+	AUAClockGraph *						mClockGraphIndex;
+	AUAStreamCapabilities *				mStreamCapabilities;			// only while createAudioEngines partitions the streams
     IORecursiveLock *					mInterfaceLock;
 	IORecursiveLock *					mRegisteredEnginesMutex;	//  <rdar://problem/6369110>
 	IORecursiveLock *					mRegisteredStreamsMutex;	//  <rdar://problem/6420832>
@@ -182,6 +366,20 @@ protected:
 	thread_call_t						mInitHardwareThread;		//  <rdar://problem/6686515>
 	thread_call_t						mRetryEQDownloadThread;
 	thread_call_t						mProcessStatusInterruptThread;	// <rdar://problem/6021475>
+	thread_call_t						mFlushControlChangesThread;
+	IOLock *							mCoalescedControlsLock;
+	AUACoalescedControl					mCoalescedControls[kAUAMaxCoalescedControls];
+	UInt32								mNumCoalescedControls;
+	bool								mControlFlushScheduled;			// also true while a flush is sending, see flushControlChanges
+	UInt32								mControlRequestsIssued;
+	UInt32								mControlRequestsSaved;
+	UInt32								mControlRequestsFailed;
+	IOReturn							mControlLastFailure;
+	IOReturn							mControlFlushError;				// failure not yet reported to a control change, see queueControlChange
+	AUAUnitControlIndex					mUnitControlIndex;				// only touched by the status interrupt thread, stop () and free ()
+	volatile SInt32						mAudioControlsGeneration;
+	IOBufferMemoryDescriptor *			mControlBuffers[kAUAControlBufferPoolSize];
+	volatile UInt32						mFreeControlBuffers;			// bit n is set while mControlBuffers[n] is free
 	Boolean								mDeviceIsInMonoMode;
 	OSArray *							mMonoControlsArray;		// this flag is set by AppleUSBAudioEngine::performFormatChange
 	OSArray *							mRegisteredEngines;
@@ -198,6 +396,9 @@ protected:
 	
 	// This is for emergency device recovery
 	bool								mShouldAttemptDeviceRecovery;
+	#if LIGHTWEIGHTWAKE
+	bool								mResetAfterFailedResume;
+	#endif
 
 	OSArray *							mEngineArray;
 	
@@ -208,6 +409,7 @@ protected:
 	IOUSBPipe *							mInterruptPipe;
 	IOBufferMemoryDescriptor *			mInterruptEndpointMemoryDescriptor;	// <rdar://7000283>
 	bool								mInterruptPipeStalled;				// <rdar://7865729>
+	bool								mClockStatusInterruptsConfirmed;	// the status interrupt pipe is set up and hasn't failed since its last success
 	void *								mStatusInterruptBuffer;
 	UInt32								mStatusInterruptBufferType;		//	<rdar://5811247>
 	IOUSBCompletion						mStatusInterruptCompletion;
@@ -234,15 +436,23 @@ public:
 	virtual	IOReturn		performPowerStateChange (IOAudioDevicePowerState oldPowerState, IOAudioDevicePowerState newPowerState, UInt32 *microSecsUntilComplete);
 	virtual	bool			willTerminate (IOService * provider, IOOptionBits options);
 	virtual	OSArray * 		BuildConnectionGraph (UInt8 controlInterfaceNum);
-	virtual	OSArray * 		BuildPath (UInt8 controlInterfaceNum, UInt8 startingUnitID, OSArray *allPaths, OSArray * thisPath);	
+	virtual	IOReturn		buildUnitGraph (AUAUnitGraph * graph, UInt8 controlInterfaceNum);
+	virtual	IOReturn		enumerateUnitGraphPaths (AUAUnitGraph * graph, UInt8 outputTerminalID);
+	virtual	OSArray *		createPathArrayFromUnitGraph (AUAUnitGraph * graph);
+	virtual	void			freeUnitGraph (AUAUnitGraph * graph);
 	virtual OSArray *		buildClockGraph (UInt8 controlInterfaceNum);																// [rdar://4801032]
 	virtual OSArray *		buildClockPath (UInt8 controlInterfaceNum, UInt8 startingUnitID, OSArray *allPaths, OSArray * thisPath);	// [rdar://4801032]
 	virtual IOReturn		addSampleRatesFromClockSpace ( void );																// [rdar://4867779]
 	virtual IOReturn		addSampleRatesFromClockPath ( OSArray * path, UInt8 streamInterface, UInt8 altSetting );			// [rdar://4867779]
-	virtual IOReturn		getClockSourceSampleRates ( OSArray ** sampleRates, UInt8 clockSource );							// [rdar://4867779]
+	virtual IOReturn		getClockSourceSampleRates ( AUASampleRateRanges * sampleRateRanges, UInt8 clockSource );			// [rdar://4867779]
 	virtual OSArray *		getOptimalClockPath ( AppleUSBAudioEngine * thisEngine, UInt8 streamInterface, UInt8 altSetting, UInt32 sampleRate, Boolean * otherEngineNeedSampleRateChange, UInt8 * clockPathGroupIndex = NULL );	// [rdar://4867843], <rdar://5811247>
 	virtual	OSArray *		getClockPathGroup ( UInt8 streamInterface, UInt8 altSetting, UInt8 * clockPathGroupIndex = NULL );		//	<rdar://5811247>
 	virtual	OSArray *		getClockPathGroup ( UInt8  pathGroupIndex );														//	<rdar://5811247>
+	virtual	OSArray *		findClockPathGroup ( UInt8 clockEntityID, UInt8 * clockPathGroupIndex = NULL );
+	virtual	IOReturn		buildClockGraphIndex ( void );
+	virtual	void			freeClockGraphIndex ( void );
+	virtual	SInt32			getClockPathIndex ( OSArray * clockPath );
+	virtual	bool			getStreamClockMask ( UInt8 interfaceNum, UInt32 * clockMask );
 	virtual	IOReturn		getClockSelectorIDAndPathIndex (UInt8 * selectorID, UInt8 * pathIndex, OSArray * clockPath);		//	<rdar://5811247>
 	virtual Boolean			supportSampleRateInClockPath ( OSArray * pathArray, UInt32 sampleRate );																							// [rdar://4867843]
 	virtual UInt32			determineClockPathUnitUsage ( AppleUSBAudioEngine * thisEngine, OSArray * thisClockPath );																			// [rdar://4867843]
@@ -281,12 +491,25 @@ public:
 	virtual	IOReturn		getMaxVolume (UInt8 unitID, UInt8 channelNumber, SInt16 * target);
 	virtual	IOReturn		getMinVolume (UInt8 unitID, UInt8 channelNumber, SInt16 * target);
 	virtual	IOReturn		getVolumeResolution (UInt8 unitID, UInt8 channelNumber, UInt16 * target);
+	virtual	IOReturn		getVolumeSettingsForChannels (UInt8 unitID, UInt32 numChannels, const UInt8 * channels, AUAVolumeSettings * settings);
+	virtual	IOReturn		queryVolumeSettings (UInt8 unitID, UInt32 numChannels, const UInt8 * channels, AUAVolumeSettings * settings, bool currentOnly);
+	virtual	IOReturn		setVolumeForChannels (UInt8 unitID, UInt32 numChannels, const UInt8 * channels, AUAVolumeSettings * settings);
 	virtual	IOReturn		setCurVolume (UInt8 unitID, UInt8 channelNumber, SInt16 volume);
 	virtual	IOReturn		setCurMute (UInt8 unitID, UInt8 channelNumber, SInt16 mute);
 	virtual	IOReturn		doInputSelectorChange (IOAudioControl *audioControl, SInt32 oldValue, SInt32 newValue);
 	virtual	IOReturn		doOutputSelectorChange (IOAudioControl *audioControl, SInt32 oldValue, SInt32 newValue);		//	<rdar://6413207>
 	virtual	IOReturn		doVolumeControlChange (IOAudioControl *audioControl, SInt32 oldValue, SInt32 newValue);
 	virtual	IOReturn		doToggleControlChange (IOAudioControl *audioControl, SInt32 oldValue, SInt32 newValue);
+	virtual	IOReturn		sendVolumeChange (UInt8 unitID, UInt8 channelNum, SInt32 newValue);
+	virtual	IOReturn		queueControlChange (UInt8 controlSelector, UInt8 unitID, UInt8 channelNum, SInt32 newValue);
+	static	void			flushControlChangesThread (void * arg);
+	virtual	void			flushControlChanges (void);
+	void					cancelControlChanges (void);
+	void					publishControlCoalescingStatistics (void);
+	void					allocateControlBuffers (void);
+	void					freeControlBuffers (void);
+	IOBufferMemoryDescriptor *	acquireControlBuffer (IODirection direction, UInt16 length);
+	void					releaseControlBuffer (IOBufferMemoryDescriptor * buffer);
 	virtual IOReturn		doPassThruSelectorChange (IOAudioControl * audioControl, SInt32 oldValue, SInt32 newValue);
 	virtual	IOFixed			ConvertUSBVolumeTodB (SInt16 volume);
 	virtual void			setMonoState (Boolean state);
@@ -306,10 +529,12 @@ public:
 	virtual	const IOUSBConfigurationDescriptor *	getConfigurationDescriptor (); // added for rdar://5495653
 	
 	virtual AUAConfigurationDictionary *	getConfigDictionary (void) {return mConfigDictionary;}
+	void					publishConfigurationCacheStatistics (void);
 
 	virtual	IOReturn		deviceRequest (IOUSBDevRequest * request, IOUSBCompletion * completion = NULL);			// Depricated, don't use
 	virtual	IOReturn		deviceRequest (IOUSBDevRequestDesc * request, IOUSBCompletion * completion = NULL);
 	static	IOReturn		deviceRequest (IOUSBDevRequest * request, AppleUSBAudioDevice * self, IOUSBCompletion * completion = 0);
+	virtual	IOReturn		deviceRequestBatch (IOUSBDevRequestDesc * requests, IOReturn * results, UInt32 numRequests);
 
 	#ifdef DEBUG
     virtual void			retain() const;
@@ -318,7 +543,7 @@ public:
 	virtual bool			matchPropertyTable (OSDictionary * table, SInt32 *score);
 
 	// The following methods are for the anchored time stamp algorithm
-	virtual IOReturn		getAnchorFrameAndTimeStamp (UInt64 *frame, AbsoluteTime *time);
+	virtual IOReturn		getAnchorFrameAndTimeStamp (UInt64 *frame, AbsoluteTime *time, UInt64 *edgeUncertainty = NULL);
 	virtual UInt64			getWallTimeInNanos (void);
 	
 	// The following method is for regulating format changes
@@ -342,12 +567,17 @@ public:
 	virtual void			attemptDeviceRecovery (void);
 	virtual void			requestDeviceRecovery (void) {mShouldAttemptDeviceRecovery = true;};
 	virtual bool			recoveryRequested (void) {return mShouldAttemptDeviceRecovery;};
+	#if LIGHTWEIGHTWAKE
+	virtual bool			shouldResetOnWake (IOUSBDevice * usbDevice);
+	virtual void			startFailedAfterWake (AppleUSBAudioEngine * engine, IOReturn result);
+	#endif
 	
 	// The following methods are for clock entities requests.
 	virtual IOReturn		getClockSetting (UInt8 controlSelector, UInt8 unitID, UInt8 requestType, void * target, UInt16 length);
 	virtual IOReturn		setClockSetting (UInt8 controlSelector, UInt8 unitID, UInt8 requestType, void * target, UInt16 length);
 	virtual	IOReturn		getNumClockSourceSamplingFrequencySubRanges (UInt8 unitID, UInt16 * numSubRanges);
 	virtual IOReturn		getIndexedClockSourceSamplingFrequencySubRange (UInt8 unitID, SubRange32 * subRange, UInt16 subRangeIndex);
+	virtual IOReturn		getClockSourceSamplingFrequencySubRanges (UInt8 unitID, AUASampleRateRanges * sampleRateRanges);
 	virtual IOReturn		getCurClockSourceSamplingFrequency (UInt8 unitID, UInt32 * samplingFrequency, bool * validity);
 	virtual IOReturn		setCurClockSourceSamplingFrequency (UInt8 unitID, UInt32 samplingFrequency);
 	virtual IOReturn		getCurClockSelector (UInt8 unitID, UInt8 * selector);
@@ -357,6 +587,7 @@ public:
 	// The following methods are for discovering & manipulate the sample rates for a clock path.
 	virtual IOReturn		getNumSampleRatesForClockPath (UInt8 * numSampleRates, OSArray * clockPath);
 	virtual IOReturn		getIndexedSampleRatesForClockPath (SubRange32 * sampleRates, OSArray * clockPath, UInt32 rangeIndex);
+	virtual IOReturn		getSampleRateRangesForClockPath (AUASampleRateRanges * sampleRateRanges, OSArray * clockPath);
 	virtual IOReturn		getClockPathCurSampleRate (UInt32 * sampleRate, Boolean * validity, Boolean * isReadOnly, OSArray * clockPath);		//	<rdar://6945472>
 	virtual IOReturn		setClockPathCurSampleRate (UInt32 sampleRate, OSArray * clockPath, bool failIfReadOnly = false);					//	<rdar://6945472>
 	
@@ -365,6 +596,8 @@ public:
 	virtual bool			isSampleRateCommonWithAtLeastOneStreamsInList (OSNumber * refStreamInterfaceNumber, OSArray * streamInterfaceNumberList);
 	virtual bool			isSampleRateCommonWithAllStreamsInList (OSNumber * refStreamInterfaceNumber, OSArray * streamInterfaceNumberList);
 	virtual bool			streamsHaveCommonSampleRates (OSNumber * streamInterfaceNumberA, OSNumber * streamInterfaceNumberB);
+	virtual IOReturn		buildStreamCapabilities (OSArray * streamInterfaceNumbers);
+	virtual void			freeStreamCapabilities (void);
 	virtual OSArray *		getSampleRatesFromStreamInterface (OSNumber * streamInterfaceNumber);
 	virtual void			mergeSampleRates (OSArray * thisArray, OSArray * otherArray);
 	virtual bool			compareSampleRates (OSArray * sampleRatesA, OSArray * sampleRatesB);
@@ -381,11 +614,18 @@ public:
 	void					checkForStatusInterruptEndpoint ( void );
 	static void				statusInterruptHandler ( void * target, void * parameter, IOReturn status, UInt32 bufferSizeRemaining );
 	void					controlHasChangedOnDevice ( UInt8 controlID, OSSet * defaultAudioControls );
+	IOReturn				buildUnitControlIndex ( void );
+	void					freeUnitControlIndex ( void );
+	static IOReturn			freeUnitControlIndexAction ( OSObject * target, void * arg0, void * arg1, void * arg2, void * arg3 );
+	IOReturn				refreshUnitControls ( UInt8 unitID );
+	void					updateInputSelectorControl ( IOAudioControl * controlObject, UInt8 newSelectorPosition );
 	static void				processStatusInterrupt ( void * arg );
 	static IOReturn			runStatusInterruptTask ( OSObject * target, void * arg0, void * arg1, void * arg2, void * arg3 );	
 	void					handleStatusInterrupt ( void );
 	
 	UInt64					getTimeForFrameNumber ( UInt64 frameNumber );					// <rdar://7378275>
+	void					audioControlsChanged ( void );
+	bool					clockStatusInterruptsConfirmed ( void );
 	virtual void			updateUSBCycleTime ( void );									// <rdar://7378275>
 	virtual void			calculateOffset ( void );										// <rdar://problem/7666699>
 	virtual void			applyOffsetAmountToFilter ( void );								// <rdar://problem/7666699>
@@ -393,6 +633,11 @@ public:
 private:
 	virtual void			resetRateTimer ();	// [rdar://5165798]
 	virtual UInt64			lastAnchorFrame ( void );										// <rdar://problem/7666699>
+	#if ANCHORWARMUP
+	void					startAnchorWarmUp ( void );
+	bool					sampleWarmUpAnchor ( void );
+	void					publishAnchorWarmUp ( UInt64 warmUp_nanos, bool converged );
+	#endif
 	static	void			TimerAction (OSObject * owner, IOTimerEventSource * sender);
 	virtual	void			doTimerAction (IOTimerEventSource * timer);
 	#if DEBUGANCHORS
@@ -50,6 +50,7 @@
 */
 
 #include <libkern/c++/OSArray.h>
+#include <mach/kmod.h>
 #include <IOKit/audio/IOAudioTypes.h>
 #include "AppleUSBAudioDictionary.h"
 #include "AppleUSBAudioCommon.h"
@@ -166,7 +167,7 @@ void AppleUSBAudioDictionary::logDescriptor (UInt8 * descriptor, UInt8 length)
 {
 	char *		descriptorString = NULL;
 	char		byteAndSpace[4];
-	UInt8		stringSize;
+	UInt32		stringSize;		// three characters a byte overflows a UInt8 from an 85 byte descriptor up
 	
 	FailIf (NULL == descriptor, Exit);
 	FailIf (descriptor[0] != length, Exit);
@@ -275,6 +276,187 @@ Exit:
 
 }
 
+#pragma mark Sample Rate Ranges
+
+static bool sampleRateRangeContains (const SubRange32 * range, UInt32 sampleRate)
+{
+	if ( ( sampleRate < range->dMIN ) || ( sampleRate > range->dMAX ) )
+	{
+		return false;
+	}
+	if ( 0 == range->dRES )
+	{
+		return ( ( sampleRate == range->dMIN ) || ( sampleRate == range->dMAX ) );
+	}
+	return ( 0 == ( sampleRate - range->dMIN ) % range->dRES );
+}
+
+static void sampleRateRangesUpdateCoverMax (AUASampleRateRanges * list, UInt32 firstIndex)
+{
+	for ( UInt32 rangeIndex = firstIndex; rangeIndex < list->numRanges; rangeIndex++ )
+	{
+		list->coverMax[rangeIndex] = list->ranges[rangeIndex].dMAX;
+		if ( ( 0 != rangeIndex ) && ( list->coverMax[rangeIndex - 1] > list->coverMax[rangeIndex] ) )
+		{
+			list->coverMax[rangeIndex] = list->coverMax[rangeIndex - 1];
+		}
+	}
+}
+
+// Index of the first range whose dMIN is above the rate.
+static UInt32 sampleRateRangesUpperBound (const AUASampleRateRanges * list, UInt32 sampleRate)
+{
+	UInt32		low = 0;
+	UInt32		high = list->numRanges;
+	UInt32		middle;
+
+	while ( low < high )
+	{
+		middle = low + ( ( high - low ) / 2 );
+		if ( list->ranges[middle].dMIN <= sampleRate )
+		{
+			low = middle + 1;
+		}
+		else
+		{
+			high = middle;
+		}
+	}
+	return low;
+}
+
+// Adds a range, folding it into an existing range on the same grid when the two overlap or touch. Only ranges that can reach the new one
+// are looked at, and the running maximum is patched from the insertion point rather than rebuilt, so adding rates in ascending order
+// costs a binary search each.
+IOReturn AUASampleRateRangesAdd (AUASampleRateRanges * list, UInt32 minRate, UInt32 maxRate, UInt32 resolution)
+{
+	SubRange32		range;
+	SubRange32 *	newRanges;
+	UInt32 *		newCoverMax;
+	UInt32			newCapacity;
+	UInt32			insertIndex;
+	UInt32			rangeIndex;
+	UInt32			firstRemoved;
+	bool			folded;
+	IOReturn		result = kIOReturnError;
+
+	FailIf ( NULL == list, Exit );
+	FailIf ( minRate > maxRate, Exit );
+	range.dMIN = minRate;
+	range.dMAX = maxRate;
+	range.dRES = ( minRate == maxRate ) ? 0 : resolution;
+
+	if ( ( range.dMIN == range.dMAX ) && AUASampleRateRangesContain ( list, range.dMIN ) )
+	{
+		result = kIOReturnSuccess;
+		goto Exit;
+	}
+
+	if ( 0 != range.dRES )
+	{
+		firstRemoved = list->numRanges;
+		do
+		{
+			// Candidates start no later than a step past the new range and, by coverMax, end no earlier than a step before it.
+			folded = false;
+			rangeIndex = sampleRateRangesUpperBound ( list, ( range.dMAX > 0xFFFFFFFF - range.dRES ) ? 0xFFFFFFFF : range.dMAX + range.dRES );
+			for ( ; ( rangeIndex > 0 ) && ( (UInt64)list->coverMax[rangeIndex - 1] + range.dRES >= range.dMIN ); rangeIndex-- )
+			{
+				SubRange32 *	other = &list->ranges[rangeIndex - 1];
+				UInt32			offset = ( other->dMIN > range.dMIN ) ? ( other->dMIN - range.dMIN ) : ( range.dMIN - other->dMIN );
+
+				if (	( range.dRES == other->dRES )
+					&&	( 0 == offset % range.dRES )
+					&&	( (UInt64)range.dMIN <= (UInt64)other->dMAX + range.dRES )
+					&&	( (UInt64)other->dMIN <= (UInt64)range.dMAX + range.dRES ) )
+				{
+					// Take the union out of the list and look again, it may now reach further ranges.
+					range.dMIN = ( other->dMIN < range.dMIN ) ? other->dMIN : range.dMIN;
+					range.dMAX = ( other->dMAX > range.dMAX ) ? other->dMAX : range.dMAX;
+					memmove ( &list->ranges[rangeIndex - 1], &list->ranges[rangeIndex], ( list->numRanges - rangeIndex ) * sizeof ( SubRange32 ) );
+					list->numRanges--;
+					if ( rangeIndex - 1 < firstRemoved )
+					{
+						firstRemoved = rangeIndex - 1;
+					}
+					// coverMax is stale past the removal until it is rebuilt below, so start the search over on a consistent list.
+					sampleRateRangesUpdateCoverMax ( list, firstRemoved );
+					folded = true;
+					break;
+				}
+			}
+		} while ( folded );
+	}
+
+	if ( list->numRanges == list->capacity )
+	{
+		newCapacity = ( 0 == list->capacity ) ? 8 : ( list->capacity * 2 );
+		FailIf ( NULL == ( newRanges = (SubRange32 *)IOMalloc ( newCapacity * sizeof ( SubRange32 ) ) ), Exit );
+		newCoverMax = (UInt32 *)IOMalloc ( newCapacity * sizeof ( UInt32 ) );
+		FailWithAction ( NULL == newCoverMax, IOFree ( newRanges, newCapacity * sizeof ( SubRange32 ) ), Exit );
+		if ( NULL != list->ranges )
+		{
+			bcopy ( list->ranges, newRanges, list->numRanges * sizeof ( SubRange32 ) );
+			bcopy ( list->coverMax, newCoverMax, list->numRanges * sizeof ( UInt32 ) );
+			IOFree ( list->ranges, list->capacity * sizeof ( SubRange32 ) );
+			IOFree ( list->coverMax, list->capacity * sizeof ( UInt32 ) );
+		}
+		list->ranges = newRanges;
+		list->coverMax = newCoverMax;
+		list->capacity = newCapacity;
+	}
+
+	insertIndex = sampleRateRangesUpperBound ( list, range.dMIN );
+	memmove ( &list->ranges[insertIndex + 1], &list->ranges[insertIndex], ( list->numRanges - insertIndex ) * sizeof ( SubRange32 ) );
+	memmove ( &list->coverMax[insertIndex + 1], &list->coverMax[insertIndex], ( list->numRanges - insertIndex ) * sizeof ( UInt32 ) );
+	list->ranges[insertIndex] = range;
+	list->numRanges++;
+
+	// The running maximum only changes from the new range onwards, and only until it meets an entry that already covers the new dMAX.
+	list->coverMax[insertIndex] = ( ( 0 != insertIndex ) && ( list->coverMax[insertIndex - 1] > range.dMAX ) ) ? list->coverMax[insertIndex - 1] : range.dMAX;
+	for ( rangeIndex = insertIndex + 1; ( rangeIndex < list->numRanges ) && ( list->coverMax[rangeIndex] < range.dMAX ); rangeIndex++ )
+	{
+		list->coverMax[rangeIndex] = range.dMAX;
+	}
+	result = kIOReturnSuccess;
+
+Exit:
+	return result;
+}
+
+// Binary search for the last range starting at or below the rate, then back up only as far as earlier ranges can still reach it.
+bool AUASampleRateRangesContain (const AUASampleRateRanges * list, UInt32 sampleRate)
+{
+	UInt32		low;
+
+	if ( ( NULL == list ) || ( 0 == list->numRanges ) )
+	{
+		return false;
+	}
+	low = sampleRateRangesUpperBound ( list, sampleRate );
+	for ( ; ( low > 0 ) && ( list->coverMax[low - 1] >= sampleRate ); low-- )
+	{
+		if ( sampleRateRangeContains ( &list->ranges[low - 1], sampleRate ) )
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void AUASampleRateRangesFree (AUASampleRateRanges * list)
+{
+	if ( ( NULL != list ) && ( NULL != list->ranges ) )
+	{
+		IOFree ( list->ranges, list->capacity * sizeof ( SubRange32 ) );
+		IOFree ( list->coverMax, list->capacity * sizeof ( UInt32 ) );
+		list->ranges = NULL;
+		list->coverMax = NULL;
+		list->capacity = 0;
+		list->numRanges = 0;
+	}
+}
+
 #pragma mark AUAConfigurationDictionary
 /* ------------------------------------------------------
     AUAConfigurationDictionary
@@ -282,13 +464,13 @@ Exit:
 OSDefineMetaClassAndStructors (AUAConfigurationDictionary, AppleUSBAudioDictionary);
 
 // [rdar://4867779]
-IOReturn AUAConfigurationDictionary::addSampleRatesToStreamDictionary ( OSArray * sampleRates, UInt8 streamInterface, UInt8 altSetting )
+IOReturn AUAConfigurationDictionary::addSampleRatesToStreamDictionary ( const AUASampleRateRanges * sampleRateRanges, UInt8 streamInterface, UInt8 altSetting )
 {
 	IOReturn						result = kIOReturnError;
 	AUAStreamDictionary *			thisStream = NULL;
 	
 	FailIf ( NULL == (thisStream = getStreamDictionary ( streamInterface, altSetting ) ), Exit );
-	result = thisStream->addSampleRatesToStreamDictionary ( sampleRates );
+	result = thisStream->addSampleRatesToStreamDictionary ( sampleRateRanges );
 
 Exit:
 	return result;
@@ -515,6 +697,160 @@ Exit:
     return configDictionary;
 }
 
+static IOLock *		sConfigurationCacheLock = NULL;
+static OSArray *	sConfigurationCache = NULL;			// oldest first
+static UInt32		sConfigurationCacheHits = 0;
+static UInt32		sConfigurationCacheMisses = 0;
+
+// Module stop routine (MODULE_STOP in the project). The kext is only unloaded once every device is gone, so nothing can be using the cache.
+extern "C" kern_return_t AppleUSBAudioModuleStop (kmod_info_t * ki, void * data)
+{
+	AUAConfigurationDictionary::flushCache ();
+	return KERN_SUCCESS;
+}
+
+// Returns a parsed configuration for this device, reusing one already parsed for an identical device if no one else is using it. A cached
+// dictionary is never shared between two live devices, since the clock path code adds sample rates to it, and a reused one has those
+// rates taken out first, so it looks as it did straight after parsing apart from the ranges read from the device.
+AUAConfigurationDictionary * AUAConfigurationDictionary::createCached (const IOUSBConfigurationDescriptor * newConfigurationDescriptor, UInt8 controlInterfaceNum, UInt16 vendorID, UInt16 productID, UInt16 deviceRelease)
+{
+	AUAConfigurationDictionary *		configDictionary = NULL;
+	AUAConfigurationDictionary *		thisEntry = NULL;
+	IOLock *							newLock = NULL;
+	UInt32								hash;
+	UInt16								length;
+
+	FailIf (NULL == newConfigurationDescriptor, Exit);
+	length = USBToHostWord (newConfigurationDescriptor->wTotalLength);
+	hash = hashDescriptor ((const UInt8 *)newConfigurationDescriptor, length);
+
+	if (NULL == sConfigurationCacheLock)
+	{
+		FailIf (NULL == (newLock = IOLockAlloc ()), Exit);
+		if (!OSCompareAndSwapPtr (NULL, newLock, (void * volatile *)&sConfigurationCacheLock))
+		{
+			IOLockFree (newLock);
+		}
+	}
+
+	IOLockLock (sConfigurationCacheLock);
+	if (NULL != sConfigurationCache)
+	{
+		for (UInt32 entryIndex = sConfigurationCache->getCount (); entryIndex > 0 && NULL == configDictionary; entryIndex--)
+		{
+			thisEntry = OSDynamicCast (AUAConfigurationDictionary, sConfigurationCache->getObject (entryIndex - 1));
+			if	(		(NULL != thisEntry)
+					&&	(1 == thisEntry->getRetainCount ())
+					&&	(thisEntry->matchesCacheKey ((const UInt8 *)newConfigurationDescriptor, length, hash, controlInterfaceNum, vendorID, productID, deviceRelease)))
+			{
+				// Hand it out and move it to the most recently used end.
+				configDictionary = thisEntry;
+				configDictionary->retain ();
+				sConfigurationCache->removeObject (entryIndex - 1);
+				sConfigurationCache->setObject (configDictionary);
+				sConfigurationCacheHits++;
+			}
+		}
+	}
+	IOLockUnlock (sConfigurationCacheLock);
+
+	if (NULL != configDictionary)
+	{
+		debugIOLog ("? AUAConfigurationDictionary::createCached (%p, %d, 0x%x, 0x%x, 0x%x) - reusing %p", newConfigurationDescriptor, controlInterfaceNum, vendorID, productID, deviceRelease, configDictionary);
+		// The ranges are kept, but each has to be checked against this device's current value before it is used on its own.
+		configDictionary->uncheckCachedRanges ();
+		configDictionary->restoreParsedSampleRates ();
+		goto Exit;
+	}
+
+	FailIf (NULL == (configDictionary = create (newConfigurationDescriptor, controlInterfaceNum)), Exit);
+
+	// Failing to remember it only costs the next attach a parse.
+	if (NULL != (configDictionary->mCachedDescriptor = (UInt8 *)IOMalloc (length)))
+	{
+		memcpy (configDictionary->mCachedDescriptor, newConfigurationDescriptor, length);
+		configDictionary->mCachedDescriptorLength = length;
+		configDictionary->mCachedDescriptorHash = hash;
+		configDictionary->mCachedVendorID = vendorID;
+		configDictionary->mCachedProductID = productID;
+		configDictionary->mCachedDeviceRelease = deviceRelease;
+		configDictionary->mCachedControlInterfaceNum = controlInterfaceNum;
+
+		IOLockLock (sConfigurationCacheLock);
+		sConfigurationCacheMisses++;
+		if (NULL == sConfigurationCache)
+		{
+			sConfigurationCache = OSArray::withCapacity (kConfigurationCacheMaxEntries);
+		}
+		if (NULL != sConfigurationCache)
+		{
+			sConfigurationCache->setObject (configDictionary);
+			while (sConfigurationCache->getCount () > kConfigurationCacheMaxEntries)
+			{
+				sConfigurationCache->removeObject (0);
+			}
+		}
+		IOLockUnlock (sConfigurationCacheLock);
+	}
+
+Exit:
+	return configDictionary;
+}
+
+void AUAConfigurationDictionary::getCacheStatistics (UInt32 * hits, UInt32 * misses, UInt32 * entries)
+{
+	if (NULL != sConfigurationCacheLock)
+	{
+		IOLockLock (sConfigurationCacheLock);
+	}
+	* hits = sConfigurationCacheHits;
+	* misses = sConfigurationCacheMisses;
+	* entries = (NULL != sConfigurationCache) ? sConfigurationCache->getCount () : 0;
+	if (NULL != sConfigurationCacheLock)
+	{
+		IOLockUnlock (sConfigurationCacheLock);
+	}
+}
+
+void AUAConfigurationDictionary::flushCache (void)
+{
+	if (NULL != sConfigurationCache)
+	{
+		sConfigurationCache->release ();
+		sConfigurationCache = NULL;
+	}
+	if (NULL != sConfigurationCacheLock)
+	{
+		IOLockFree (sConfigurationCacheLock);
+		sConfigurationCacheLock = NULL;
+	}
+}
+
+// FNV-1a
+UInt32 AUAConfigurationDictionary::hashDescriptor (const UInt8 * descriptor, UInt16 length)
+{
+	UInt32		hash = 2166136261U;
+
+	for (UInt16 byteIndex = 0; byteIndex < length; byteIndex++)
+	{
+		hash ^= descriptor[byteIndex];
+		hash *= 16777619U;
+	}
+	return hash;
+}
+
+bool AUAConfigurationDictionary::matchesCacheKey (const UInt8 * descriptor, UInt16 length, UInt32 hash, UInt8 controlInterfaceNum, UInt16 vendorID, UInt16 productID, UInt16 deviceRelease)
+{
+	return	(		(NULL != mCachedDescriptor)
+				&&	(hash == mCachedDescriptorHash)
+				&&	(length == mCachedDescriptorLength)
+				&&	(vendorID == mCachedVendorID)
+				&&	(productID == mCachedProductID)
+				&&	(deviceRelease == mCachedDeviceRelease)
+				&&	(controlInterfaceNum == mCachedControlInterfaceNum)
+				&&	(0 == memcmp (descriptor, mCachedDescriptor, length)));
+}
+
 #if DEBUGLOGGING
 void AUAConfigurationDictionary::dumpConfigMemoryToIOLog (IOUSBConfigurationDescriptor * configurationDescriptor) 
 {
@@ -842,9 +1178,17 @@ Exit:
 IOReturn AUAConfigurationDictionary::getFormat (UInt16 * format, UInt8 interfaceNum, UInt8 altSettingID)
 {
 	AUAStreamDictionary * 		thisStream = NULL;
+	AUAInterfaceRecord *		thisRecord = NULL;
 	IOReturn					result = kIOReturnError;
 	
 	* format = TYPE_I_UNDEFINED;
+	if ( NULL != ( thisRecord = getStreamRecord ( interfaceNum, altSettingID ) ) )
+	{
+		FailIf ( 0 == ( kAUARecordHasFormat & thisRecord->validFields ), Exit );
+		* format = thisRecord->format;
+		result = kIOReturnSuccess;
+		goto Exit;
+	}
 	thisStream = getStreamDictionary (interfaceNum, altSettingID);
 	if (thisStream)
 	{
@@ -1055,6 +1399,20 @@ Exit:
 }
 
 
+IOReturn AUAConfigurationDictionary::getIsocEndpointTransactionsPerMicroframe (UInt8 * transactions, UInt8 interfaceNum, UInt8 altSettingID, UInt8 direction)
+{
+	AUAStreamDictionary * 		thisStream = NULL;
+	IOReturn					result = kIOReturnError;
+	
+	* transactions = 0;
+	FailIf ( NULL == ( thisStream = getStreamDictionary ( interfaceNum, altSettingID ) ), Exit );		
+	result = thisStream->getIsocEndpointTransactionsPerMicroframe (transactions, direction);
+
+Exit:
+	return result;	
+}
+
+
 IOReturn AUAConfigurationDictionary::getIsocEndpointSyncType (UInt8 * syncType, UInt8 interfaceNum, UInt8 altSettingID, UInt8 address) 
 {
 	AUAStreamDictionary * 		thisStream = NULL;
@@ -1289,6 +1647,21 @@ IOReturn AUAConfigurationDictionary::getNumAltSettings (UInt8 * numAltSettings,
 
     * numAltSettings = 0;
 	
+	if ( mIndexBuilt )
+	{
+		if ( kAUANoInterfaceRecord != mStreamIndex.firstRecord[interfaceNum] )
+		{
+			for	(	streamIndex = mStreamIndex.firstRecord[interfaceNum];
+					( streamIndex < mStreamIndex.numRecords ) && ( interfaceNum == mStreamIndex.records[streamIndex].interfaceNum );
+					streamIndex++ )
+			{
+				(* numAltSettings)++;
+			}
+		}
+		result = kIOReturnSuccess;
+		goto Exit;
+	}
+
 	FailIf (NULL == (dictionaryValue = getObject (kStreamDictionaries)), Exit);
 	FailIf (NULL == (streamDictionaries = OSDynamicCast (OSArray, dictionaryValue)), Exit);
 	
@@ -1311,9 +1684,17 @@ Exit:
 IOReturn AUAConfigurationDictionary::getNumChannels (UInt8 * numChannels, UInt8 interfaceNum, UInt8 altSettingID) 
 {
     AUAStreamDictionary * 		thisStream = NULL;
+	AUAInterfaceRecord *		thisRecord = NULL;
 	IOReturn					result = kIOReturnError;
 
     * numChannels = 0;
+	if ( NULL != ( thisRecord = getStreamRecord ( interfaceNum, altSettingID ) ) )
+	{
+		FailIf ( 0 == ( kAUARecordHasNumChannels & thisRecord->validFields ), Exit );
+		* numChannels = thisRecord->numChannels;
+		result = kIOReturnSuccess;
+		goto Exit;
+	}
     FailIf (NULL == (thisStream = getStreamDictionary (interfaceNum, altSettingID)), Exit);
     FailIf (kIOReturnSuccess != (result = thisStream->getNumChannels (numChannels)), Exit);
 
@@ -1511,11 +1892,43 @@ Exit:
     return sampleRates;
 }
 
+// Ranges the clock path added, as min, max pairs; NULL if there are none. They are not counted by getNumSampleRates (), and their bounds are
+// rates the device supports, but getSampleRateRange () has to be asked for the step between them.
+OSArray * AUAConfigurationDictionary::getSampleRateRanges (UInt8 interfaceNum, UInt8 altSettingID) 
+{
+    AUAStreamDictionary * 		thisStream = NULL;
+	OSArray *					sampleRateRanges = NULL;
+	
+    FailIf (NULL == (thisStream = getStreamDictionary (interfaceNum, altSettingID)), Exit);
+	sampleRateRanges = thisStream->getSampleRateRanges ();
+Exit:
+    return sampleRateRanges;
+}
+
+IOReturn AUAConfigurationDictionary::getSampleRateRange (UInt32 * minRate, UInt32 * maxRate, UInt32 * resolution, UInt8 interfaceNum, UInt8 altSettingID, UInt32 rangeIndex) 
+{
+    AUAStreamDictionary * 		thisStream = NULL;
+	IOReturn					result = kIOReturnError;
+	
+    FailIf (NULL == (thisStream = getStreamDictionary (interfaceNum, altSettingID)), Exit);
+	result = thisStream->getSampleRateRange (minRate, maxRate, resolution, rangeIndex);
+Exit:
+    return result;
+}
+
 IOReturn AUAConfigurationDictionary::getBitResolution (UInt8 * sampleSize, UInt8 interfaceNum, UInt8 altSettingID) {
     AUAStreamDictionary * 		thisStream = NULL;
+	AUAInterfaceRecord *		thisRecord = NULL;
 	IOReturn					result = kIOReturnError;
 
     * sampleSize = 0;
+	if ( NULL != ( thisRecord = getStreamRecord ( interfaceNum, altSettingID ) ) )
+	{
+		FailIf ( 0 == ( kAUARecordHasBitResolution & thisRecord->validFields ), Exit );
+		* sampleSize = thisRecord->bitResolution;
+		result = kIOReturnSuccess;
+		goto Exit;
+	}
     FailIf (NULL == (thisStream = getStreamDictionary (interfaceNum, altSettingID)), Exit);
 	FailIf (kIOReturnSuccess != (result = thisStream->getBitResolution (sampleSize)), Exit);
 
@@ -1580,9 +1993,17 @@ Exit:
 IOReturn AUAConfigurationDictionary::getSubframeSize (UInt8 * subframeSize, UInt8 interfaceNum, UInt8 altSettingID) 
 {
     AUAStreamDictionary * 		thisStream = NULL;
+	AUAInterfaceRecord *		thisRecord = NULL;
 	IOReturn					result = kIOReturnError;
 
     * subframeSize = 0;
+	if ( NULL != ( thisRecord = getStreamRecord ( interfaceNum, altSettingID ) ) )
+	{
+		FailIf ( 0 == ( kAUARecordHasSubframeSize & thisRecord->validFields ), Exit );
+		* subframeSize = thisRecord->subframeSize;
+		result = kIOReturnSuccess;
+		goto Exit;
+	}
     FailIf (NULL == (thisStream = getStreamDictionary (interfaceNum, altSettingID)), Exit);
 	FailIf (kIOReturnSuccess != (result = thisStream->getSubframeSize (subframeSize)), Exit);
 
@@ -1701,10 +2122,24 @@ bool AUAConfigurationDictionary::init (const IOUSBConfigurationDescriptor * newC
 {
 	IOUSBConfigurationDescriptor *	mutableDescriptor = NULL;
     bool							result = false;
+	#if DEBUGLOGGING
+	AbsoluteTime					parseStartTime;
+	AbsoluteTime					parseEndTime;
+	UInt64							parseNanos;
+	#endif
 	
 	debugIOLog ("+ AUAConfigurationDictionary[%p]::init (%p, %d)", this, newConfigurationDescriptor, controlInterfaceNum);
+	mIndexBuilt = false;
+	freeInterfaceIndex ( &mControlIndex );
+	freeInterfaceIndex ( &mStreamIndex );
 	FailIf (false == initDictionaryForUse (), Exit);
     FailIf (NULL == newConfigurationDescriptor, Exit);
+	if (NULL == mRangeCacheLock)
+	{
+		FailIf (NULL == (mRangeCacheLock = IOLockAlloc ()), Exit);
+	}
+	// The parser reads the configuration header's own fields before checking anything else against wTotalLength.
+	FailIf (USBToHostWord (newConfigurationDescriptor->wTotalLength) < sizeof (IOUSBConfigurationDescriptor), Exit);
 
 	FailIf (kIOReturnSuccess != setDictionaryValue (kControlInterfaceNumber, controlInterfaceNum), Exit);
 
@@ -1718,7 +2153,16 @@ bool AUAConfigurationDictionary::init (const IOUSBConfigurationDescriptor * newC
 	dumpConfigMemoryToIOLog (mutableDescriptor);
 	#endif
 
+	#if DEBUGLOGGING
+	clock_get_uptime (&parseStartTime);
+	#endif
     FailIf (kIOReturnSuccess != parseConfigurationDescriptor (mutableDescriptor), Exit);
+	#if DEBUGLOGGING
+	clock_get_uptime (&parseEndTime);
+	SUB_ABSOLUTETIME (&parseEndTime, &parseStartTime);
+	absolutetime_to_nanoseconds (parseEndTime, &parseNanos);
+	debugIOLog ("? AUAConfigurationDictionary[%p]::init () - parsed %d descriptor bytes in %llu ns", this, USBToHostWord (newConfigurationDescriptor->wTotalLength), parseNanos);
+	#endif
 	result = true;
 
 Exit:
@@ -1752,12 +2196,16 @@ bool AUAConfigurationDictionary::verifySampleRateIsSupported (UInt8 interfaceNum
 	OSNumber *						sampleRateNumberHigh = NULL;
 	UInt8							sampleRateIndex;
 	UInt8							numSampleRates;
+	UInt32							minRate;
+	UInt32							maxRate;
+	UInt32							resolution;
 
 	FailIf (kIOReturnSuccess != getNumSampleRates (&numSampleRates, interfaceNum, altSettingID), Exit);
-	FailIf (NULL == (sampleRates = getSampleRates (interfaceNum, altSettingID)), Exit);
+	sampleRates = getSampleRates (interfaceNum, altSettingID);
 	if (numSampleRates) 
 	{
 		// There are a discrete number of sample rates supported, so check for the desired sample rate.
+		FailIf (NULL == sampleRates, Exit);
 		for (sampleRateIndex = 0; sampleRateIndex < numSampleRates && result == false; sampleRateIndex++) 
 		{
 			FailIf (NULL == (arrayValue = sampleRates->getObject (sampleRateIndex)), Exit);
@@ -1768,7 +2216,7 @@ bool AUAConfigurationDictionary::verifySampleRateIsSupported (UInt8 interfaceNum
 			}
 		}
 	} 
-	else
+	else if (NULL != sampleRates)
 	{
 		// There is a range of sample rates supported, so check for the desired sample rate within that range.
 		FailIf (NULL == (arrayValue = sampleRates->getObject (0)), Exit);
@@ -1781,6 +2229,21 @@ bool AUAConfigurationDictionary::verifySampleRateIsSupported (UInt8 interfaceNum
 			result = true;
 		}
 	}
+
+	// Ranges from the clock path sit alongside any discrete rates, and hold only the rates on their step.
+	if ( ( false == result ) && ( NULL != ( sampleRates = getSampleRateRanges (interfaceNum, altSettingID) ) ) )
+	{
+		for (UInt32 rangeIndex = 0; 2 * rangeIndex + 1 < sampleRates->getCount () && result == false; rangeIndex++)
+		{
+			FailIf (kIOReturnSuccess != getSampleRateRange (&minRate, &maxRate, &resolution, interfaceNum, altSettingID, rangeIndex), Exit);
+			if	(		(minRate <= verifyRate)
+					&&	(maxRate >= verifyRate)
+					&&	(0 == (verifyRate - minRate) % resolution))
+			{
+				result = true;
+			}
+		}
+	}
 	
 Exit:
 	return result;
@@ -1800,6 +2263,238 @@ bool AUAConfigurationDictionary::hasAudioStreamingInterfaces (void)
 	return result;
 }
 
+// Looks up the bounds last read for a control. Returns false if they haven't been read for this configuration yet, or unless includeUnchecked
+// is set, if they haven't been checked against the control's current value since this attach began.
+bool AUAConfigurationDictionary::getCachedControlRange (UInt8 controlSelector, UInt8 unitID, UInt8 channelNum, SInt16 * min, SInt16 * max, UInt16 * resolution, bool includeUnchecked)
+{
+	AUACachedControlRange *		cachedRange;
+	bool						result = false;
+
+	FailIf (NULL == mRangeCacheLock, Exit);
+	IOLockLock (mRangeCacheLock);
+	if	(		(NULL != (cachedRange = findCachedControlRange (controlSelector, unitID, channelNum)))
+			&&	(includeUnchecked || cachedRange->checked))
+	{
+		if (NULL != min)
+		{
+			* min = cachedRange->min;
+		}
+		if (NULL != max)
+		{
+			* max = cachedRange->max;
+		}
+		if (NULL != resolution)
+		{
+			* resolution = cachedRange->resolution;
+		}
+		result = true;
+	}
+	IOLockUnlock (mRangeCacheLock);
+
+Exit:
+	return result;
+}
+
+// Remembers the bounds read for a control. Once the table is full further controls simply aren't cached.
+void AUAConfigurationDictionary::setCachedControlRange (UInt8 controlSelector, UInt8 unitID, UInt8 channelNum, SInt16 min, SInt16 max, UInt16 resolution)
+{
+	AUACachedControlRange *		cachedRange;
+
+	FailIf (NULL == mRangeCacheLock, Exit);
+	IOLockLock (mRangeCacheLock);
+	if (NULL == mCachedControlRanges)
+	{
+		mCachedControlRanges = (AUACachedControlRange *)IOMalloc (kAUAMaxCachedControlRanges * sizeof (AUACachedControlRange));
+		mNumCachedControlRanges = 0;
+	}
+	if (NULL != mCachedControlRanges)
+	{
+		cachedRange = findCachedControlRange (controlSelector, unitID, channelNum);
+		if ( (NULL == cachedRange) && (mNumCachedControlRanges < kAUAMaxCachedControlRanges) )
+		{
+			cachedRange = &mCachedControlRanges[mNumCachedControlRanges++];
+			cachedRange->controlSelector = controlSelector;
+			cachedRange->unitID = unitID;
+			cachedRange->channelNum = channelNum;
+		}
+		if (NULL != cachedRange)
+		{
+			cachedRange->min = min;
+			cachedRange->max = max;
+			cachedRange->resolution = resolution;
+			cachedRange->checked = true;
+		}
+	}
+	IOLockUnlock (mRangeCacheLock);
+
+Exit:
+	return;
+}
+
+void AUAConfigurationDictionary::setCachedControlRangeChecked (UInt8 controlSelector, UInt8 unitID, UInt8 channelNum)
+{
+	AUACachedControlRange *		cachedRange;
+
+	FailIf (NULL == mRangeCacheLock, Exit);
+	IOLockLock (mRangeCacheLock);
+	if (NULL != (cachedRange = findCachedControlRange (controlSelector, unitID, channelNum)))
+	{
+		cachedRange->checked = true;
+	}
+	IOLockUnlock (mRangeCacheLock);
+
+Exit:
+	return;
+}
+
+void AUAConfigurationDictionary::invalidateCachedControlRange (UInt8 controlSelector, UInt8 unitID, UInt8 channelNum)
+{
+	AUACachedControlRange *		cachedRange;
+
+	FailIf (NULL == mRangeCacheLock, Exit);
+	IOLockLock (mRangeCacheLock);
+	if (NULL != (cachedRange = findCachedControlRange (controlSelector, unitID, channelNum)))
+	{
+		debugIOLog ("? AUAConfigurationDictionary[%p]::invalidateCachedControlRange (%d, %d, %d)", this, controlSelector, unitID, channelNum);
+		* cachedRange = mCachedControlRanges[--mNumCachedControlRanges];
+	}
+	IOLockUnlock (mRangeCacheLock);
+
+Exit:
+	return;
+}
+
+// Adds the sample rate ranges last read for a clock source to sampleRateRanges. Returns kIOReturnNotFound if they haven't been read
+// for this configuration yet.
+IOReturn AUAConfigurationDictionary::getCachedClockSourceRanges (AUASampleRateRanges * sampleRateRanges, UInt8 clockSourceID)
+{
+	AUACachedClockSourceRanges *	cachedRanges;
+	UInt32							rangeIndex;
+	IOReturn						result = kIOReturnError;
+
+	FailIf (NULL == sampleRateRanges, Exit);
+	FailIf (NULL == mRangeCacheLock, Exit);
+	IOLockLock (mRangeCacheLock);
+	if (NULL == (cachedRanges = findCachedClockSourceRanges (clockSourceID)))
+	{
+		result = kIOReturnNotFound;
+	}
+	else
+	{
+		result = kIOReturnSuccess;
+		for (rangeIndex = 0; (kIOReturnSuccess == result) && (rangeIndex < cachedRanges->sampleRateRanges.numRanges); rangeIndex++)
+		{
+			result = AUASampleRateRangesAdd (sampleRateRanges,	cachedRanges->sampleRateRanges.ranges[rangeIndex].dMIN,
+																cachedRanges->sampleRateRanges.ranges[rangeIndex].dMAX,
+																cachedRanges->sampleRateRanges.ranges[rangeIndex].dRES);
+		}
+	}
+	IOLockUnlock (mRangeCacheLock);
+
+Exit:
+	return result;
+}
+
+// Remembers the sample rate ranges read for a clock source, replacing any kept before. Once the table is full further clock sources
+// simply aren't cached.
+void AUAConfigurationDictionary::setCachedClockSourceRanges (const AUASampleRateRanges * sampleRateRanges, UInt8 clockSourceID)
+{
+	AUACachedClockSourceRanges *	cachedRanges;
+	UInt32							rangeIndex;
+
+	FailIf (NULL == sampleRateRanges, Exit);
+	FailIf (NULL == mRangeCacheLock, Exit);
+	IOLockLock (mRangeCacheLock);
+	if (NULL == mCachedClockSourceRanges)
+	{
+		mCachedClockSourceRanges = (AUACachedClockSourceRanges *)IOMalloc (kAUAMaxCachedClockSources * sizeof (AUACachedClockSourceRanges));
+		mNumCachedClockSourceRanges = 0;
+	}
+	if (NULL != mCachedClockSourceRanges)
+	{
+		cachedRanges = findCachedClockSourceRanges (clockSourceID);
+		if ( (NULL == cachedRanges) && (mNumCachedClockSourceRanges < kAUAMaxCachedClockSources) )
+		{
+			cachedRanges = &mCachedClockSourceRanges[mNumCachedClockSourceRanges++];
+			cachedRanges->clockSourceID = clockSourceID;
+			bzero (&cachedRanges->sampleRateRanges, sizeof (AUASampleRateRanges));
+		}
+		if (NULL != cachedRanges)
+		{
+			cachedRanges->sampleRateRanges.numRanges = 0;
+			for (rangeIndex = 0; rangeIndex < sampleRateRanges->numRanges; rangeIndex++)
+			{
+				if (kIOReturnSuccess != AUASampleRateRangesAdd (&cachedRanges->sampleRateRanges,	sampleRateRanges->ranges[rangeIndex].dMIN,
+																									sampleRateRanges->ranges[rangeIndex].dMAX,
+																									sampleRateRanges->ranges[rangeIndex].dRES))
+				{
+					// Don't keep a partial copy.
+					AUASampleRateRangesFree (&cachedRanges->sampleRateRanges);
+					* cachedRanges = mCachedClockSourceRanges[--mNumCachedClockSourceRanges];
+					break;
+				}
+			}
+		}
+	}
+	IOLockUnlock (mRangeCacheLock);
+
+Exit:
+	return;
+}
+
+void AUAConfigurationDictionary::invalidateCachedClockSourceRanges (UInt8 clockSourceID)
+{
+	AUACachedClockSourceRanges *	cachedRanges;
+
+	FailIf (NULL == mRangeCacheLock, Exit);
+	IOLockLock (mRangeCacheLock);
+	if (NULL != (cachedRanges = findCachedClockSourceRanges (clockSourceID)))
+	{
+		debugIOLog ("? AUAConfigurationDictionary[%p]::invalidateCachedClockSourceRanges (%d)", this, clockSourceID);
+		AUASampleRateRangesFree (&cachedRanges->sampleRateRanges);
+		* cachedRanges = mCachedClockSourceRanges[--mNumCachedClockSourceRanges];
+	}
+	IOLockUnlock (mRangeCacheLock);
+
+Exit:
+	return;
+}
+
+// Takes the sample rates the clock path added back out of every stream dictionary.
+void AUAConfigurationDictionary::restoreParsedSampleRates (void)
+{
+	OSArray *					streamDictionaries;
+	AUAStreamDictionary *		thisStream;
+
+	FailIf (NULL == (streamDictionaries = getStreamDictionaries ()), Exit);
+	for (UInt32 streamIndex = 0; streamIndex < streamDictionaries->getCount (); streamIndex++)
+	{
+		if (NULL != (thisStream = OSDynamicCast (AUAStreamDictionary, streamDictionaries->getObject (streamIndex))))
+		{
+			thisStream->restoreParsedSampleRates ();
+		}
+	}
+
+Exit:
+	return;
+}
+
+// Keeps every control range but makes the next attach check each one before it is used on its own. Clock source ranges are checked
+// every time they are used, so they need nothing here.
+void AUAConfigurationDictionary::uncheckCachedRanges (void)
+{
+	FailIf (NULL == mRangeCacheLock, Exit);
+	IOLockLock (mRangeCacheLock);
+	for (UInt32 rangeIndex = 0; (NULL != mCachedControlRanges) && (rangeIndex < mNumCachedControlRanges); rangeIndex++)
+	{
+		mCachedControlRanges[rangeIndex].checked = false;
+	}
+	IOLockUnlock (mRangeCacheLock);
+
+Exit:
+	return;
+}
+
 // <rdar://problem/6021475> AppleUSBAudio: Status Interrupt Endpoint support
 IOReturn AUAConfigurationDictionary::getInterruptEndpointAddress ( UInt8 * address, UInt8 interfaceNum, UInt8 altSettingID ) 
 {
@@ -1841,11 +2536,226 @@ Exit:
 	return result;
 }
 
+void AUAConfigurationDictionary::free (void)
+{
+	if (NULL != mCachedControlRanges)
+	{
+		IOFree (mCachedControlRanges, kAUAMaxCachedControlRanges * sizeof (AUACachedControlRange));
+		mCachedControlRanges = NULL;
+	}
+	if (NULL != mCachedClockSourceRanges)
+	{
+		for (UInt32 clockIndex = 0; clockIndex < mNumCachedClockSourceRanges; clockIndex++)
+		{
+			AUASampleRateRangesFree (&mCachedClockSourceRanges[clockIndex].sampleRateRanges);
+		}
+		IOFree (mCachedClockSourceRanges, kAUAMaxCachedClockSources * sizeof (AUACachedClockSourceRanges));
+		mCachedClockSourceRanges = NULL;
+	}
+	if (NULL != mRangeCacheLock)
+	{
+		IOLockFree (mRangeCacheLock);
+		mRangeCacheLock = NULL;
+	}
+	if (NULL != mCachedDescriptor)
+	{
+		IOFree (mCachedDescriptor, mCachedDescriptorLength);
+		mCachedDescriptor = NULL;
+	}
+	mIndexBuilt = false;
+	freeInterfaceIndex ( &mControlIndex );
+	freeInterfaceIndex ( &mStreamIndex );
+	AppleUSBAudioDictionary::free ();
+}
+
 // Private methods
 
+// Builds the (interface, alternate setting) index for one of the interface dictionary arrays. Must only be called once parsing has
+// finished, since the records copy values out of the dictionaries and point at them without retaining them.
+IOReturn AUAConfigurationDictionary::buildInterfaceIndex (AUAInterfaceIndex * index, OSArray * dictionaries, bool isStream)
+{
+	AppleUSBAudioDictionary *		thisDictionary = NULL;
+	AUAStreamDictionary *			thisStream = NULL;
+	AUAControlDictionary *			thisControl = NULL;
+	AUAInterfaceRecord *			thisRecord = NULL;
+	AUAInterfaceRecord				insertRecord;
+	IOReturn						result = kIOReturnError;
+	UInt32							recordIndex;
+	UInt32							sortIndex;
+
+	FailIf ( NULL == index, Exit );
+	freeInterfaceIndex ( index );
+	if ( ( NULL == dictionaries ) || ( 0 == dictionaries->getCount () ) )
+	{
+		result = kIOReturnSuccess;
+		goto Exit;
+	}
+
+	FailIf ( NULL == ( index->records = ( AUAInterfaceRecord * ) IOMalloc ( dictionaries->getCount () * sizeof ( AUAInterfaceRecord ) ) ), Exit );
+	bzero ( index->records, dictionaries->getCount () * sizeof ( AUAInterfaceRecord ) );
+	index->numRecords = dictionaries->getCount ();
+
+	for ( recordIndex = 0; recordIndex < index->numRecords; recordIndex++ )
+	{
+		thisRecord = &index->records[recordIndex];
+		if ( isStream )
+		{
+			FailIf ( NULL == ( thisStream = OSDynamicCast ( AUAStreamDictionary, dictionaries->getObject ( recordIndex ) ) ), Exit );
+			thisDictionary = thisStream;
+			if ( kIOReturnSuccess == thisStream->getFormatTag ( &thisRecord->format ) )
+			{
+				thisRecord->validFields |= kAUARecordHasFormat;
+			}
+			if ( kIOReturnSuccess == thisStream->getNumChannels ( &thisRecord->numChannels ) )
+			{
+				thisRecord->validFields |= kAUARecordHasNumChannels;
+			}
+			if ( kIOReturnSuccess == thisStream->getBitResolution ( &thisRecord->bitResolution ) )
+			{
+				thisRecord->validFields |= kAUARecordHasBitResolution;
+			}
+			if ( kIOReturnSuccess == thisStream->getSubframeSize ( &thisRecord->subframeSize ) )
+			{
+				thisRecord->validFields |= kAUARecordHasSubframeSize;
+			}
+		}
+		else
+		{
+			FailIf ( NULL == ( thisControl = OSDynamicCast ( AUAControlDictionary, dictionaries->getObject ( recordIndex ) ) ), Exit );
+			FailIf ( kIOReturnSuccess != thisControl->buildUnitTable (), Exit );
+			thisDictionary = thisControl;
+		}
+		thisRecord->dictionary = thisDictionary;
+		FailIf ( kIOReturnSuccess != thisDictionary->getDictionaryValue ( kInterfaceNumber, &thisRecord->interfaceNum ), Exit );
+		FailIf ( kIOReturnSuccess != thisDictionary->getDictionaryValue ( kAlternateSetting, &thisRecord->altSettingID ), Exit );
+	}
+
+	// Stable insertion sort so that duplicate (interface, alternate setting) pairs resolve to the same dictionary the linear search found.
+	for ( recordIndex = 1; recordIndex < index->numRecords; recordIndex++ )
+	{
+		insertRecord = index->records[recordIndex];
+		for ( sortIndex = recordIndex; sortIndex > 0; sortIndex-- )
+		{
+			thisRecord = &index->records[sortIndex - 1];
+			if	(		( thisRecord->interfaceNum < insertRecord.interfaceNum )
+					||	(		( thisRecord->interfaceNum == insertRecord.interfaceNum )
+							&&	( thisRecord->altSettingID <= insertRecord.altSettingID ) ) )
+			{
+				break;
+			}
+			index->records[sortIndex] = * thisRecord;
+		}
+		index->records[sortIndex] = insertRecord;
+	}
+
+	for ( recordIndex = index->numRecords; recordIndex > 0; recordIndex-- )
+	{
+		index->firstRecord[index->records[recordIndex - 1].interfaceNum] = recordIndex - 1;
+	}
+	result = kIOReturnSuccess;
+
+Exit:
+	if ( ( kIOReturnSuccess != result ) && ( NULL != index ) )
+	{
+		freeInterfaceIndex ( index );
+	}
+	return result;
+}
+
+void AUAConfigurationDictionary::freeInterfaceIndex (AUAInterfaceIndex * index)
+{
+	if ( NULL != index->records )
+	{
+		IOFree ( index->records, index->numRecords * sizeof ( AUAInterfaceRecord ) );
+		index->records = NULL;
+	}
+	index->numRecords = 0;
+	for ( UInt32 interfaceNum = 0; interfaceNum < 256; interfaceNum++ )
+	{
+		index->firstRecord[interfaceNum] = kAUANoInterfaceRecord;
+	}
+}
+
+// Must be called with mRangeCacheLock held.
+AUACachedControlRange * AUAConfigurationDictionary::findCachedControlRange (UInt8 controlSelector, UInt8 unitID, UInt8 channelNum)
+{
+	AUACachedControlRange *		cachedRange = NULL;
+
+	for (UInt32 rangeIndex = 0; (NULL != mCachedControlRanges) && (rangeIndex < mNumCachedControlRanges); rangeIndex++)
+	{
+		if	(		(controlSelector == mCachedControlRanges[rangeIndex].controlSelector)
+				&&	(unitID == mCachedControlRanges[rangeIndex].unitID)
+				&&	(channelNum == mCachedControlRanges[rangeIndex].channelNum) )
+		{
+			cachedRange = &mCachedControlRanges[rangeIndex];
+			break;
+		}
+	}
+	return cachedRange;
+}
+
+// Must be called with mRangeCacheLock held.
+AUACachedClockSourceRanges * AUAConfigurationDictionary::findCachedClockSourceRanges (UInt8 clockSourceID)
+{
+	AUACachedClockSourceRanges *	cachedRanges = NULL;
+
+	for (UInt32 clockIndex = 0; (NULL != mCachedClockSourceRanges) && (clockIndex < mNumCachedClockSourceRanges); clockIndex++)
+	{
+		if (clockSourceID == mCachedClockSourceRanges[clockIndex].clockSourceID)
+		{
+			cachedRanges = &mCachedClockSourceRanges[clockIndex];
+			break;
+		}
+	}
+	return cachedRanges;
+}
+
+AUAInterfaceRecord * AUAConfigurationDictionary::getInterfaceRecord (AUAInterfaceIndex * index, UInt8 interfaceNum, UInt8 altSettingID)
+{
+	AUAInterfaceRecord *	thisRecord = NULL;
+	UInt32					recordIndex;
+
+	if ( ( ! mIndexBuilt ) || ( kAUANoInterfaceRecord == index->firstRecord[interfaceNum] ) )
+	{
+		goto Exit;
+	}
+
+	// Alternate settings are almost always numbered contiguously from zero, so the record is usually found directly.
+	recordIndex = index->firstRecord[interfaceNum] + altSettingID;
+	if	(		( recordIndex < index->numRecords )
+			&&	( interfaceNum == index->records[recordIndex].interfaceNum )
+			&&	( altSettingID == index->records[recordIndex].altSettingID )
+			&&	(		( index->firstRecord[interfaceNum] == recordIndex )
+					||	( altSettingID != index->records[recordIndex - 1].altSettingID ) ) )
+	{
+		thisRecord = &index->records[recordIndex];
+		goto Exit;
+	}
+
+	for	(	recordIndex = index->firstRecord[interfaceNum];
+			( recordIndex < index->numRecords ) && ( interfaceNum == index->records[recordIndex].interfaceNum );
+			recordIndex++ )
+	{
+		if ( altSettingID == index->records[recordIndex].altSettingID )
+		{
+			thisRecord = &index->records[recordIndex];
+			break;
+		}
+	}
+
+Exit:
+	return thisRecord;
+}
+
+AUAInterfaceRecord * AUAConfigurationDictionary::getStreamRecord (UInt8 interfaceNum, UInt8 altSettingID)
+{
+	return getInterfaceRecord ( &mStreamIndex, interfaceNum, altSettingID );
+}
+
 AUAStreamDictionary * AUAConfigurationDictionary::getStreamDictionary (UInt8 interfaceNum, UInt8 altSettingID) 
 {
     AUAStreamDictionary * 	thisStream = NULL;
+	AUAInterfaceRecord *	thisRecord = NULL;
 	OSObject *				dictionaryValue = NULL;
 	OSArray *				streamDictionaries = NULL;
     UInt8					streamIndex = 0;
@@ -1853,6 +2763,14 @@ AUAStreamDictionary * AUAConfigurationDictionary::getStreamDictionary (UInt8 int
 	UInt8					streamAltSettingID;
     bool					found = false;
 
+	if ( mIndexBuilt )
+	{
+		thisRecord = getInterfaceRecord ( &mStreamIndex, interfaceNum, altSettingID );
+		thisStream = ( NULL != thisRecord ) ? ( AUAStreamDictionary * ) thisRecord->dictionary : NULL;
+		found = ( NULL != thisStream );
+		goto Exit;
+	}
+
 	FailIf (NULL == (dictionaryValue = getObject (kStreamDictionaries)), Exit);
 	FailIf (NULL == (streamDictionaries = OSDynamicCast (OSArray, dictionaryValue)), Exit);
 	
@@ -1885,6 +2803,7 @@ Exit:
 AUAControlDictionary * AUAConfigurationDictionary::getControlDictionary (UInt8 interfaceNum, UInt8 altSettingID) 
 {
     AUAControlDictionary * 		thisControl = NULL;
+	AUAInterfaceRecord *		thisRecord = NULL;
 	OSObject *					dictionaryValue = NULL;
 	OSArray *					controlDictionaries = NULL;
     UInt8						controlIndex = 0;
@@ -1892,7 +2811,15 @@ AUAControlDictionary * AUAConfigurationDictionary::getControlDictionary (UInt8 i
 	UInt8						controlAltSettingID;
     bool						found = false;
 
-    
+
+	if ( mIndexBuilt )
+	{
+		thisRecord = getInterfaceRecord ( &mControlIndex, interfaceNum, altSettingID );
+		thisControl = ( NULL != thisRecord ) ? ( AUAControlDictionary * ) thisRecord->dictionary : NULL;
+		found = ( NULL != thisControl );
+		goto Exit;
+	}
+
 	FailIf (NULL == (dictionaryValue = getObject (kControlDictionaries)), Exit);
 	FailIf (NULL == (controlDictionaries = OSDynamicCast (OSArray, dictionaryValue)), Exit);
 
@@ -1917,6 +2844,46 @@ Exit:
     return thisControl;
 }
 
+// [rdar://5346021] The parsers track parsedLength, the offset at which the descriptor they are on ends, and step between descriptors only
+// through nextDescriptor (). It checks that the next descriptor's header lies inside the configuration before reading its bLength, and
+// that all of bLength does before returning it, so every descriptor a parser sees fits. Each parser still checks that bLength covers
+// the fields it reads from that type of descriptor. A parser that finds a descriptor which doesn't fit returns NULL with parsedLength
+// past totalLength, which is how parseConfigurationDescriptor () tells a bad descriptor from the end of the configuration.
+static USBInterfaceDescriptorPtr rejectDescriptor (UInt32 * parsedLength, UInt16 totalLength)
+{
+	* parsedLength = ( UInt32 ) totalLength + 1;
+	return NULL;
+}
+
+// nextDescriptorBytes is where the next descriptor starts; on entry * parsedLength is its offset. Returns NULL at the end of the
+// configuration, at a zero bLength (which has always ended the parse), or after rejecting a descriptor.
+static USBInterfaceDescriptorPtr nextDescriptor (UInt8 * nextDescriptorBytes, UInt32 * parsedLength, UInt16 totalLength)
+{
+	USBInterfaceDescriptorPtr		next = ( USBInterfaceDescriptorPtr ) nextDescriptorBytes;
+
+	if ( * parsedLength >= totalLength )
+	{
+		return ( * parsedLength == totalLength ) ? NULL : rejectDescriptor ( parsedLength, totalLength );
+	}
+	if ( * parsedLength + kMinDescriptorLength > totalLength )
+	{
+		return rejectDescriptor ( parsedLength, totalLength );
+	}
+	if ( 0 == next->bLength )
+	{
+		return NULL;
+	}
+	if ( ( next->bLength < kMinDescriptorLength ) || ( * parsedLength + next->bLength > totalLength ) )
+	{
+		return rejectDescriptor ( parsedLength, totalLength );
+	}
+	* parsedLength += next->bLength;
+	return next;
+}
+
+// Gives up on the descriptor theInterfacePtr points at if it is shorter than minLength.
+#define RejectIfShorterThan( minLength, handler )	FailWithAction ( theInterfacePtr->bLength < ( minLength ), theInterfacePtr = rejectDescriptor ( parsedLength, totalLength ), handler )
+
 IOReturn AUAConfigurationDictionary::parseConfigurationDescriptor (IOUSBConfigurationDescriptor * configurationDescriptor) 
 {
 	IOReturn								result = kIOReturnError;
@@ -1940,7 +2907,8 @@ IOReturn AUAConfigurationDictionary::parseConfigurationDescriptor (IOUSBConfigur
 	UInt8									streamInterfaceIndex;
 	// [rdar://5346021] Keep strack of the descriptor length to guard against malformed descriptors.
 	UInt16									totalLength;
-	UInt16									parsedLength;
+	UInt32									parsedLength;
+	UInt32									skipLength;
 	
 	bool									haveControlInterface;
 	bool									foundStreamInterface;
@@ -1951,11 +2919,12 @@ IOReturn AUAConfigurationDictionary::parseConfigurationDescriptor (IOUSBConfigur
     FailIf (CONFIGURATION != configurationDescriptor->bDescriptorType, Exit);
 	FailIf (kIOReturnSuccess != (result = getControlInterfaceNum (&controlInterfaceNum)), Exit);
 	FailIf ( 0 == ( totalLength = USBToHostWord ( configurationDescriptor->wTotalLength ) ), Exit );
+	FailIf ( configurationDescriptor->bLength > totalLength, Exit );
 	
-	theInterfacePtr = (USBInterfaceDescriptorPtr)((UInt8 *)configurationDescriptor + configurationDescriptor->bLength);
-	// [rdar://5346021] In keeping track of the parsed length, we add the length of the descriptor before actually parsing it. Then we check
-	// to ensure that the total length is not exceeded before attempting to parse.
-	parsedLength = ( theInterfacePtr ? ( configurationDescriptor->bLength + theInterfacePtr->bLength ) : 0 );
+	// [rdar://5346021] In keeping track of the parsed length, we add the length of the descriptor before actually parsing it. nextDescriptor ()
+	// checks that the total length is not exceeded before letting us parse it.
+	parsedLength = configurationDescriptor->bLength;
+	theInterfacePtr = nextDescriptor ((UInt8 *)configurationDescriptor + configurationDescriptor->bLength, &parsedLength, totalLength);
 	numParsedInterfaces = 0;
 	numStreamInterfaces = 0;
 	lastInterfaceNumber = 0;
@@ -1969,6 +2938,11 @@ IOReturn AUAConfigurationDictionary::parseConfigurationDescriptor (IOUSBConfigur
 		logDescriptor ((UInt8 *) theInterfacePtr, theInterfacePtr->bLength);
     	if (INTERFACE_ASSOCIATION == theInterfacePtr->bDescriptorType)
 		{
+			if ( theInterfacePtr->bLength < sizeof ( USBInterfaceAssociationDescriptor ) )
+			{
+				theInterfacePtr = rejectDescriptor ( &parsedLength, totalLength );
+				break;
+			}
 			debugIOLog ("? AUAConfigurationDictionary[%p]::parseConfigurationDescriptor () - @ INTERFACE_ASSOCIATION (4.6)", this);
 				
 			if ((((USBInterfaceAssociationDescriptorPtr)theInterfacePtr)->bFunctionClass == USBAUDIO_0200::AUDIO_FUNCTION) &&
@@ -1980,18 +2954,25 @@ IOReturn AUAConfigurationDictionary::parseConfigurationDescriptor (IOUSBConfigur
 				theInterfaceAssociationPtr = (USBInterfaceAssociationDescriptorPtr)theInterfacePtr;
 			}
 			
-			theInterfacePtr = (USBInterfaceDescriptorPtr)((UInt8 *)theInterfacePtr + theInterfacePtr->bLength);
-			parsedLength = ( theInterfacePtr ? ( parsedLength + theInterfacePtr->bLength) : totalLength );			
+			theInterfacePtr = nextDescriptor ((UInt8 *)theInterfacePtr + theInterfacePtr->bLength, &parsedLength, totalLength);
 		} // if (INTERFACE_ASSOCIATION == (theInterfacePtr)->bDescriptorType)
 	    else 
 		if (INTERFACE == ((ACInterfaceDescriptorPtr)theInterfacePtr)->bDescriptorType) 
 		{
 			debugIOLog ("? AUAConfigurationDictionary[%p]::parseConfigurationDescriptor () - @ INTERFACE (4.3.1/4.5.1)", this);
+			if ( theInterfacePtr->bLength < sizeof ( USBInterfaceDescriptor ) )
+			{
+				theInterfacePtr = rejectDescriptor ( &parsedLength, totalLength );
+				break;
+			}
 			thisInterfaceNumber = ((ACInterfaceDescriptorPtr)theInterfacePtr)->bInterfaceNumber;
 			if (AUDIO == ((ACInterfaceDescriptorPtr)theInterfacePtr)->bInterfaceClass) 
 			{
-				theInterfacePtr = parseInterfaceDescriptor (theInterfacePtr, &interfaceClass, &interfaceSubClass, &interfaceProtocol);
-				parsedLength = ( theInterfacePtr ? ( parsedLength + theInterfacePtr->bLength) : totalLength );
+				theInterfacePtr = parseInterfaceDescriptor (theInterfacePtr, &interfaceClass, &interfaceSubClass, &interfaceProtocol, &parsedLength, totalLength);
+				if (NULL == theInterfacePtr)
+				{
+					break;
+				}
 				debugIOLog ("? AUAConfigurationDictionary[%p]::parseConfigurationDescriptor () - controlInterfaceNum = %d, thisInterfaceNumber = %d", this, controlInterfaceNum, thisInterfaceNumber);
 				if	(		(AUDIOCONTROL == interfaceSubClass)
 						&&	(controlInterfaceNum == thisInterfaceNumber)) 
@@ -2006,7 +2987,7 @@ IOReturn AUAConfigurationDictionary::parseConfigurationDescriptor (IOUSBConfigur
 					if (INTERFACE_PROTOCOL_UNDEFINED == interfaceProtocol)
 					{
 						UInt8 numEndpoints;	// <rdar://problem/6021475>
-						theInterfacePtr = controlDictionary->parseACInterfaceDescriptor (theInterfacePtr, ((ACInterfaceDescriptorPtr)theInterfacePtr)->bInterfaceNumber, &parsedLength, totalLength);
+						theInterfacePtr = controlDictionary->parseACInterfaceDescriptor (theInterfacePtr, thisInterfaceNumber, &parsedLength, totalLength);
 						FailIf (kIOReturnSuccess != (result = getControlledStreamNumbers (&streamInterfaceNumbers, &numStreamInterfaces)), Exit);
 						haveControlInterface = true;
 
@@ -2014,10 +2995,10 @@ IOReturn AUAConfigurationDictionary::parseConfigurationDescriptor (IOUSBConfigur
 						debugIOLog ("? AUAConfigurationDictionary[%p]::parseConfigurationDescriptor () - Finished parsing AC Interface Descriptor", this);
 						if ( kIOReturnSuccess == controlDictionary->getNumEndpoints ( &numEndpoints ) )
 						{
-							if ( 1 == numEndpoints )
+							if ( ( 1 == numEndpoints ) && ( NULL != theInterfacePtr ) )
 							{
 								logDescriptor ( (UInt8 *) theInterfacePtr, theInterfacePtr->bLength );
-								theInterfacePtr = controlDictionary->parseACInterruptEndpointDescriptor ( theInterfacePtr );
+								theInterfacePtr = controlDictionary->parseACInterruptEndpointDescriptor ( theInterfacePtr, &parsedLength, totalLength );
 							}
 							else
 							{
@@ -2029,7 +3010,7 @@ IOReturn AUAConfigurationDictionary::parseConfigurationDescriptor (IOUSBConfigur
 					{
 						UInt8 numEndpoints;	// <rdar://problem/6021475>
 						// Parse USB-Audio 2.0 descriptors.
-						theInterfacePtr = controlDictionary->parseACInterfaceDescriptor_0200 (theInterfacePtr, ((ACInterfaceDescriptorPtr)theInterfacePtr)->bInterfaceNumber, &parsedLength, totalLength);
+						theInterfacePtr = controlDictionary->parseACInterfaceDescriptor_0200 (theInterfacePtr, thisInterfaceNumber, &parsedLength, totalLength);
 						// Parse the interface association descriptor to determine the interfaces used by this function.
 						controlDictionary->parseInterfaceAssociationDescriptor(theInterfaceAssociationPtr);
 						FailIf (kIOReturnSuccess != (result = getControlledStreamNumbers (&streamInterfaceNumbers, &numStreamInterfaces)), Exit);
@@ -2040,10 +3021,10 @@ IOReturn AUAConfigurationDictionary::parseConfigurationDescriptor (IOUSBConfigur
 						debugIOLog ("? AUAConfigurationDictionary[%p]::parseConfigurationDescriptor () - Finished parsing AC Interface Descriptor", this);
 						if ( kIOReturnSuccess == controlDictionary->getNumEndpoints ( &numEndpoints ) )
 						{
-							if ( 1 == numEndpoints )
+							if ( ( 1 == numEndpoints ) && ( NULL != theInterfacePtr ) )
 							{
 								logDescriptor ( (UInt8 *) theInterfacePtr, theInterfacePtr->bLength );
-								theInterfacePtr = controlDictionary->parseACInterruptEndpointDescriptor ( theInterfacePtr );
+								theInterfacePtr = controlDictionary->parseACInterruptEndpointDescriptor ( theInterfacePtr, &parsedLength, totalLength );
 							}
 							else
 							{
@@ -2076,11 +3057,11 @@ IOReturn AUAConfigurationDictionary::parseConfigurationDescriptor (IOUSBConfigur
 							FailIf (NULL == streamDictionary, Exit);
 							if (INTERFACE_PROTOCOL_UNDEFINED == interfaceProtocol)
 							{
-								theInterfacePtr = streamDictionary->parseASInterfaceDescriptor (theInterfacePtr, ((ACInterfaceDescriptorPtr)theInterfacePtr)->bInterfaceNumber, &parsedLength, totalLength);
+								theInterfacePtr = streamDictionary->parseASInterfaceDescriptor (theInterfacePtr, thisInterfaceNumber, &parsedLength, totalLength);
 							}
 							else if (IP_VERSION_02_00 == interfaceProtocol)
 							{
-								theInterfacePtr = streamDictionary->parseASInterfaceDescriptor_0200 (theInterfacePtr, ((ACInterfaceDescriptorPtr)theInterfacePtr)->bInterfaceNumber, &parsedLength, totalLength);
+								theInterfacePtr = streamDictionary->parseASInterfaceDescriptor_0200 (theInterfacePtr, thisInterfaceNumber, &parsedLength, totalLength);
 							}
 							foundStreamInterface = true;
 							break;			// Get out of for loop
@@ -2109,26 +3090,44 @@ IOReturn AUAConfigurationDictionary::parseConfigurationDescriptor (IOUSBConfigur
 							streamInterfaceNumbers->removeObject (streamInterfaceIndex);
 						}
 					}
-					theInterfacePtr = (USBInterfaceDescriptorPtr)((UInt8 *)theInterfacePtr + theInterfacePtr->bLength);
-					parsedLength = ( theInterfacePtr ? ( parsedLength + theInterfacePtr->bLength) : totalLength );
+					theInterfacePtr = nextDescriptor ((UInt8 *)theInterfacePtr + theInterfacePtr->bLength, &parsedLength, totalLength);
 				} 
 				else if (AUDIOCONTROL == interfaceSubClass) 
 				{
 					if (INTERFACE_PROTOCOL_UNDEFINED == interfaceProtocol)
 					{
-						debugIOLog ("? AUAConfigurationDictionary[%p]::parseConfigurationDescriptor () - Found a control interface that we don't care about. Skipping %d bytes ...", 
-									this, ((((ACInterfaceHeaderDescriptorPtr)theInterfacePtr)->wTotalLength[1] << 8) | (((ACInterfaceHeaderDescriptorPtr)theInterfacePtr)->wTotalLength[0])));
-						parsedLength = ( theInterfacePtr ? ( parsedLength - theInterfacePtr->bLength + ((((ACInterfaceHeaderDescriptorPtr)theInterfacePtr)->wTotalLength[1] << 8) | (((ACInterfaceHeaderDescriptorPtr)theInterfacePtr)->wTotalLength[0]))) : totalLength );
-						theInterfacePtr = (USBInterfaceDescriptorPtr)((UInt8 *)theInterfacePtr + ((((ACInterfaceHeaderDescriptorPtr)theInterfacePtr)->wTotalLength[1] << 8) | (((ACInterfaceHeaderDescriptorPtr)theInterfacePtr)->wTotalLength[0])));
-						parsedLength = ( theInterfacePtr ? ( parsedLength + theInterfacePtr->bLength) : totalLength );
+						// Skipping by the header's wTotalLength must move forward and stay inside the configuration.
+						if ( theInterfacePtr->bLength < kMinACHeaderLength_0100 )
+						{
+							theInterfacePtr = rejectDescriptor ( &parsedLength, totalLength );
+							break;
+						}
+						skipLength = ((((ACInterfaceHeaderDescriptorPtr)theInterfacePtr)->wTotalLength[1] << 8) | (((ACInterfaceHeaderDescriptorPtr)theInterfacePtr)->wTotalLength[0]));
+						if ( ( skipLength < theInterfacePtr->bLength ) || ( parsedLength - theInterfacePtr->bLength + skipLength > totalLength ) )
+						{
+							theInterfacePtr = rejectDescriptor ( &parsedLength, totalLength );
+							break;
+						}
+						debugIOLog ("? AUAConfigurationDictionary[%p]::parseConfigurationDescriptor () - Found a control interface that we don't care about. Skipping %d bytes ...", this, skipLength);
+						parsedLength = parsedLength - theInterfacePtr->bLength + skipLength;
+						theInterfacePtr = nextDescriptor ((UInt8 *)theInterfacePtr + skipLength, &parsedLength, totalLength);
 					}
 					else if (IP_VERSION_02_00 == interfaceProtocol)
 					{
-						debugIOLog ("? AUAConfigurationDictionary[%p]::parseConfigurationDescriptor () - Found a control interface that we don't care about. Skipping %d bytes ...", 
-									this, (USBToHostWord(((USBAUDIO_0200::ACInterfaceHeaderDescriptorPtr)theInterfacePtr)->wTotalLength)));
-						parsedLength = ( theInterfacePtr ? ( parsedLength - theInterfacePtr->bLength + (USBToHostWord(((USBAUDIO_0200::ACInterfaceHeaderDescriptorPtr)theInterfacePtr)->wTotalLength))) : totalLength );
-						theInterfacePtr = (USBInterfaceDescriptorPtr)((UInt8 *)theInterfacePtr + (USBToHostWord(((USBAUDIO_0200::ACInterfaceHeaderDescriptorPtr)theInterfacePtr)->wTotalLength)));
-						parsedLength = ( theInterfacePtr ? ( parsedLength + theInterfacePtr->bLength) : totalLength );
+						if ( theInterfacePtr->bLength < kMinACHeaderLength_0200 )
+						{
+							theInterfacePtr = rejectDescriptor ( &parsedLength, totalLength );
+							break;
+						}
+						skipLength = USBToHostWord(((USBAUDIO_0200::ACInterfaceHeaderDescriptorPtr)theInterfacePtr)->wTotalLength);
+						if ( ( skipLength < theInterfacePtr->bLength ) || ( parsedLength - theInterfacePtr->bLength + skipLength > totalLength ) )
+						{
+							theInterfacePtr = rejectDescriptor ( &parsedLength, totalLength );
+							break;
+						}
+						debugIOLog ("? AUAConfigurationDictionary[%p]::parseConfigurationDescriptor () - Found a control interface that we don't care about. Skipping %d bytes ...", this, skipLength);
+						parsedLength = parsedLength - theInterfacePtr->bLength + skipLength;
+						theInterfacePtr = nextDescriptor ((UInt8 *)theInterfacePtr + skipLength, &parsedLength, totalLength);
 					}
 					else
 					{
@@ -2139,22 +3138,19 @@ IOReturn AUAConfigurationDictionary::parseConfigurationDescriptor (IOUSBConfigur
 				else 
 				{
 					debugIOLog ("? AUAConfigurationDictionary[%p]::parseConfigurationDescriptor () - Unknown, skipping %d bytes", this, theInterfacePtr->bLength);
-					theInterfacePtr = (USBInterfaceDescriptorPtr)((UInt8 *)theInterfacePtr + theInterfacePtr->bLength);
-					parsedLength = ( theInterfacePtr ? ( parsedLength + theInterfacePtr->bLength) : totalLength );
+					theInterfacePtr = nextDescriptor ((UInt8 *)theInterfacePtr + theInterfacePtr->bLength, &parsedLength, totalLength);
 				}
 			} // if (AUDIO == ((ACInterfaceDescriptorPtr)theInterfacePtr)->bInterfaceClass)
 			else 
 			{
 				debugIOLog ("? AUAConfigurationDictionary[%p]::parseConfigurationDescriptor () - Not an audio interface, skipping %d bytes", this, theInterfacePtr->bLength);
-				theInterfacePtr = (USBInterfaceDescriptorPtr)((UInt8 *)theInterfacePtr + theInterfacePtr->bLength);
-				parsedLength = ( theInterfacePtr ? ( parsedLength + theInterfacePtr->bLength) : totalLength );
+				theInterfacePtr = nextDescriptor ((UInt8 *)theInterfacePtr + theInterfacePtr->bLength, &parsedLength, totalLength);
 			}
 		} // if (INTERFACE == ((ACInterfaceDescriptorPtr)theInterfacePtr)->bDescriptorType)
 		else 
 		{
 			debugIOLog ("? AUAConfigurationDictionary[%p]::parseConfigurationDescriptor () - Default, skipping %d bytes", this, theInterfacePtr->bLength);
-			theInterfacePtr = (USBInterfaceDescriptorPtr)((UInt8 *)theInterfacePtr + theInterfacePtr->bLength);
-			parsedLength = ( theInterfacePtr ? ( parsedLength + theInterfacePtr->bLength) : totalLength );
+			theInterfacePtr = nextDescriptor ((UInt8 *)theInterfacePtr + theInterfacePtr->bLength, &parsedLength, totalLength);
         }
     } //     while (theInterfacePtr && 0 != theInterfacePtr->bLength) 
 
@@ -2169,12 +3165,20 @@ IOReturn AUAConfigurationDictionary::parseConfigurationDescriptor (IOUSBConfigur
 		controlDictionaries->removeObject (controlDictionaries->getCount () - 1);
 	}
 
+	// The dictionaries don't change shape from here on, so index them once for every later query.
+	if	(		( kIOReturnSuccess == buildInterfaceIndex ( &mControlIndex, getControlDictionaries (), false ) )
+			&&	( kIOReturnSuccess == buildInterfaceIndex ( &mStreamIndex, getStreamDictionaries (), true ) ) )
+	{
+		mIndexBuilt = true;
+		debugIOLog ( "? AUAConfigurationDictionary[%p]::parseConfigurationDescriptor () - indexed %d control and %d stream interface(s)", this, mControlIndex.numRecords, mStreamIndex.numRecords );
+	}
+
 	result = kIOReturnSuccess;
 Exit:
     return result;
 }
 
-USBInterfaceDescriptorPtr AUAConfigurationDictionary::parseInterfaceDescriptor (USBInterfaceDescriptorPtr theInterfacePtr, UInt8 * interfaceClass, UInt8 * interfaceSubClass, UInt8 * interfaceProtocol) 
+USBInterfaceDescriptorPtr AUAConfigurationDictionary::parseInterfaceDescriptor (USBInterfaceDescriptorPtr theInterfacePtr, UInt8 * interfaceClass, UInt8 * interfaceSubClass, UInt8 * interfaceProtocol, UInt32 * parsedLength, UInt16 totalLength) 
 {
 	AUAControlDictionary *			controlDictionary = NULL;
 	AUAStreamDictionary *			streamDictionary = NULL;
@@ -2263,7 +3267,7 @@ USBInterfaceDescriptorPtr AUAConfigurationDictionary::parseInterfaceDescriptor (
 		streamDictionary = NULL;
 	}
 
-	theInterfacePtr = (USBInterfaceDescriptorPtr)((UInt8 *)theInterfacePtr + theInterfacePtr->bLength);
+	theInterfacePtr = nextDescriptor ((UInt8 *)theInterfacePtr + theInterfacePtr->bLength, parsedLength, totalLength);
 
 Exit:
 	debugIOLog("- AUAConfigurationDictionary[%p]::parseInterfaceDescriptor () = %p", this, theInterfacePtr);
@@ -2382,10 +3386,68 @@ Exit:
 	return result;
 }
 
+// Called once the control interface has been completely parsed. Units are added in the same order getUnitDictionary () searches them
+// so that the table gives the same answer the search would.
+IOReturn AUAControlDictionary::buildUnitTable (void)
+{
+	mUnitTableBuilt = false;
+	bzero ( mUnitTable, sizeof ( mUnitTable ) );
+	bzero ( mUnitTypeTable, sizeof ( mUnitTypeTable ) );
+
+	addUnitsToTable ( getInputTerminals (), kAUAUnitTypeInputTerminal, OSTypeID ( AUAInputTerminalDictionary ) );
+	addUnitsToTable ( getOutputTerminals (), kAUAUnitTypeOutputTerminal, OSTypeID ( AUAOutputTerminalDictionary ) );
+	addUnitsToTable ( getMixerUnits (), kAUAUnitTypeMixerUnit, OSTypeID ( AUAMixerUnitDictionary ) );
+	addUnitsToTable ( getSelectorUnits (), kAUAUnitTypeSelectorUnit, OSTypeID ( AUASelectorUnitDictionary ) );
+	addUnitsToTable ( getFeatureUnits (), kAUAUnitTypeFeatureUnit, OSTypeID ( AUAFeatureUnitDictionary ) );
+	addUnitsToTable ( getEffectUnits (), kAUAUnitTypeEffectUnit, OSTypeID ( AUAEffectUnitDictionary ) );
+	addUnitsToTable ( getProcessingUnits (), kAUAUnitTypeProcessingUnit, OSTypeID ( AUAProcessingUnitDictionary ) );
+	addUnitsToTable ( getExtensionUnits (), kAUAUnitTypeExtensionUnit, OSTypeID ( AUAExtensionUnitDictionary ) );
+	addUnitsToTable ( getClockSources (), kAUAUnitTypeClockSource, OSTypeID ( AUAClockSourceDictionary ) );
+	addUnitsToTable ( getClockSelectors (), kAUAUnitTypeClockSelector, OSTypeID ( AUAClockSelectorDictionary ) );
+	addUnitsToTable ( getClockMultipliers (), kAUAUnitTypeClockMultiplier, OSTypeID ( AUAClockMultiplierDictionary ) );
+
+	mUnitTableBuilt = true;
+	return kIOReturnSuccess;
+}
+
+void AUAControlDictionary::addUnitsToTable (OSArray * units, UInt8 unitType, const OSMetaClass * unitClass)
+{
+	AUAUnitDictionary *		thisUnit = NULL;
+	UInt8					thisUnitID;
+
+	if ( NULL == units )
+	{
+		return;
+	}
+
+	for ( UInt32 unitIndex = 0; unitIndex < units->getCount (); unitIndex++ )
+	{
+		thisUnit = ( AUAUnitDictionary * ) OSMetaClassBase::safeMetaCast ( units->getObject ( unitIndex ), unitClass );
+		if	(		( NULL != thisUnit )
+				&&	( kIOReturnSuccess == thisUnit->getUnitID ( &thisUnitID ) )
+				&&	( kAUAUnitTypeNone == mUnitTypeTable[thisUnitID] ) )
+		{
+			mUnitTable[thisUnitID] = thisUnit;
+			mUnitTypeTable[thisUnitID] = unitType;
+		}
+		#ifdef DEBUGLOGGING
+		else if ( NULL != thisUnit )
+		{
+			debugIOLog ( "! AUAControlDictionary[%p]::addUnitsToTable () - unit ID %d of type %d is already taken by type %d", this, thisUnitID, unitType, mUnitTypeTable[thisUnitID] );
+		}
+		#endif
+	}
+}
+
 AUAUnitDictionary * AUAControlDictionary::getUnitDictionary (UInt8 unitID) 
 {
     AUAUnitDictionary * 			unitDictionary = NULL;
 
+	if ( mUnitTableBuilt )
+	{
+		return mUnitTable[unitID];
+	}
+
 	unitDictionary = getInputTerminalDictionary (unitID);
 	if (!unitDictionary)
 	{
@@ -2707,6 +3769,13 @@ AUAFeatureUnitDictionary * AUAControlDictionary::getFeatureUnitDictionary (UInt8
 	UInt8								thisUnitID;
     bool								found = false;
 
+	if ( unitTableAnswers ( unitID, kAUAUnitTypeFeatureUnit ) )
+	{
+		featureUnitDictionary = ( AUAFeatureUnitDictionary * ) mUnitTable[unitID];
+		found = ( NULL != featureUnitDictionary );
+		goto Exit;
+	}
+
     featureUnitIndex = 0;   
 	if (NULL != (featureUnits = getFeatureUnits())) 
 	{
@@ -2740,6 +3809,13 @@ AUAInputTerminalDictionary * AUAControlDictionary::getInputTerminalDictionary (U
 	UInt8							thisUnitID;
     bool							found  = false;
 
+	if ( unitTableAnswers ( unitID, kAUAUnitTypeInputTerminal ) )
+	{
+		inputTerminalDictionary = ( AUAInputTerminalDictionary * ) mUnitTable[unitID];
+		found = ( NULL != inputTerminalDictionary );
+		goto Exit;
+	}
+
     inputTerminalIndex = 0;
 	if (NULL != (inputTerminals = getInputTerminals())) 
 	{
@@ -2771,6 +3847,13 @@ AUAOutputTerminalDictionary * AUAControlDictionary::getOutputTerminalDictionary
 	UInt8							thisUnitID;
     bool							found;
 
+	if ( unitTableAnswers ( unitID, kAUAUnitTypeOutputTerminal ) )
+	{
+		outputTerminalDictionary = ( AUAOutputTerminalDictionary * ) mUnitTable[unitID];
+		found = ( NULL != outputTerminalDictionary );
+		goto Exit;
+	}
+
     outputTerminalIndex = 0;
     found = false;
 	outputTerminalDictionary = NULL;
@@ -3141,6 +4224,13 @@ AUAEffectUnitDictionary * AUAControlDictionary::getEffectUnitDictionary (UInt8 u
 	UInt8								effectUnitID;
     bool								found = false;
 
+	if ( unitTableAnswers ( unitID, kAUAUnitTypeEffectUnit ) )
+	{
+		thisEffectUnit = ( AUAEffectUnitDictionary * ) mUnitTable[unitID];
+		found = ( NULL != thisEffectUnit );
+		goto Exit;
+	}
+
     effectUnitIndex = 0;
 	effectUnits = getEffectUnits();
 		
@@ -3172,6 +4262,13 @@ AUAProcessingUnitDictionary * AUAControlDictionary::getProcessingUnitDictionary
 	UInt8								processingUnitID;
     bool								found = false;
 
+	if ( unitTableAnswers ( unitID, kAUAUnitTypeProcessingUnit ) )
+	{
+		thisProcessingUnit = ( AUAProcessingUnitDictionary * ) mUnitTable[unitID];
+		found = ( NULL != thisProcessingUnit );
+		goto Exit;
+	}
+
     processingUnitIndex = 0;
 	processingUnits = getProcessingUnits();
 		
@@ -3203,6 +4300,13 @@ AUAMixerUnitDictionary * AUAControlDictionary::getMixerUnitDictionary (UInt8 uni
 	UInt8								mixerUnitID;
     bool								found = false;
 
+	if ( unitTableAnswers ( unitID, kAUAUnitTypeMixerUnit ) )
+	{
+		thisMixerUnit = ( AUAMixerUnitDictionary * ) mUnitTable[unitID];
+		found = ( NULL != thisMixerUnit );
+		goto Exit;
+	}
+
     mixerUnitIndex = 0;
 	mixerUnits = getMixerUnits ();
 	
@@ -3233,6 +4337,13 @@ AUAExtensionUnitDictionary * AUAControlDictionary::getExtensionUnitDictionary (U
 	UInt8								extensionUnitID;
     bool								found = false;
 
+	if ( unitTableAnswers ( unitID, kAUAUnitTypeExtensionUnit ) )
+	{
+		thisExtensionUnit = ( AUAExtensionUnitDictionary * ) mUnitTable[unitID];
+		found = ( NULL != thisExtensionUnit );
+		goto Exit;
+	}
+
     extensionUnitIndex = 0;
 	extensionUnits = getExtensionUnits ();
 	
@@ -3263,6 +4374,13 @@ AUASelectorUnitDictionary * AUAControlDictionary::getSelectorUnitDictionary (UIn
 	UInt8								selectorUnitID;
     bool								found = false;
 
+	if ( unitTableAnswers ( unitID, kAUAUnitTypeSelectorUnit ) )
+	{
+		thisSelectorUnit = ( AUASelectorUnitDictionary * ) mUnitTable[unitID];
+		found = ( NULL != thisSelectorUnit );
+		goto Exit;
+	}
+
     selectorUnitIndex = 0;
     
 	selectorUnits = getSelectorUnits ();
@@ -3293,6 +4411,13 @@ AUAClockSourceDictionary * AUAControlDictionary::getClockSourceDictionary (UInt8
 	UInt8								clockSourceID;
     bool								found = false;
 
+	if ( unitTableAnswers ( unitID, kAUAUnitTypeClockSource ) )
+	{
+		thisClockSource = ( AUAClockSourceDictionary * ) mUnitTable[unitID];
+		found = ( NULL != thisClockSource );
+		goto Exit;
+	}
+
     clockSourceIndex = 0;
 	clockSources = getClockSources();
 		
@@ -3324,6 +4449,13 @@ AUAClockSelectorDictionary * AUAControlDictionary::getClockSelectorDictionary (U
 	UInt8								clockSelectorID;
     bool								found = false;
 
+	if ( unitTableAnswers ( unitID, kAUAUnitTypeClockSelector ) )
+	{
+		thisClockSelector = ( AUAClockSelectorDictionary * ) mUnitTable[unitID];
+		found = ( NULL != thisClockSelector );
+		goto Exit;
+	}
+
     clockSelectorIndex = 0;
 	clockSelectors = getClockSelectors();
 		
@@ -3355,6 +4487,13 @@ AUAClockMultiplierDictionary * AUAControlDictionary::getClockMultiplierDictionar
 	UInt8								clockMultiplierID;
     bool								found = false;
 
+	if ( unitTableAnswers ( unitID, kAUAUnitTypeClockMultiplier ) )
+	{
+		thisClockMultiplier = ( AUAClockMultiplierDictionary * ) mUnitTable[unitID];
+		found = ( NULL != thisClockMultiplier );
+		goto Exit;
+	}
+
     clockMultiplierIndex = 0;
 	clockMultipliers = getClockMultipliers();
 		
@@ -3496,7 +4635,7 @@ Exit:
 	return result;
 }
 
-USBInterfaceDescriptorPtr AUAControlDictionary::parseACInterfaceDescriptor (USBInterfaceDescriptorPtr theInterfacePtr, UInt8 const currentInterface, UInt16 * parsedLength, UInt16 totalLength) 
+USBInterfaceDescriptorPtr AUAControlDictionary::parseACInterfaceDescriptor (USBInterfaceDescriptorPtr theInterfacePtr, UInt8 const currentInterface, UInt32 * parsedLength, UInt16 totalLength) 
 {
 	OSArray *						inputTerminals = NULL;
 	OSArray *						outputTerminals = NULL;
@@ -3525,15 +4664,19 @@ USBInterfaceDescriptorPtr AUAControlDictionary::parseACInterfaceDescriptor (USBI
     FailIf (0 == theInterfacePtr->bLength, Exit);
     FailIf (CS_INTERFACE != theInterfacePtr->bDescriptorType, Exit);
 
-    while	(		( theInterfacePtr->bLength > 0 )
+    while	(		( theInterfacePtr )
+				&&	( theInterfacePtr->bLength > 0 )
 				&&	( CS_INTERFACE == theInterfacePtr->bDescriptorType )
 				&&	( * parsedLength <= totalLength ) )
 	{
 		logDescriptor ((UInt8 *) theInterfacePtr, theInterfacePtr->bLength);
+		RejectIfShorterThan (kMinCSDescriptorLength, Exit);
         switch (theInterfacePtr->bDescriptorSubtype) 
 		{
             case HEADER:
                 debugIOLog ("? AUAControlDictionary[%p]::parseACInterfaceDescriptor () - @ HEADER (4.3.2)", this);
+                RejectIfShorterThan (kMinACHeaderCollectionLength_0100, Exit);
+                RejectIfShorterThan (kMinACHeaderCollectionLength_0100 + ((ACInterfaceHeaderDescriptorPtr)theInterfacePtr)->bInCollection, Exit);
 				adcVersion = USBToHostWord (* (UInt16 *) (&(((ACInterfaceHeaderDescriptorPtr)theInterfacePtr)->bcdADC[0])));
 				if (adcVersion != kAUAUSBSpec1_0)
 				{
@@ -3568,6 +4711,7 @@ USBInterfaceDescriptorPtr AUAControlDictionary::parseACInterfaceDescriptor (USBI
                 break;
             case INPUT_TERMINAL:
                 debugIOLog ("? AUAControlDictionary[%p]::parseACInterfaceDescriptor () - @ INPUT_TERMINAL (4.3.2.1)", this);
+                RejectIfShorterThan (kMinInputTerminalLength_0100, Exit);
 				FailIf (NULL == (inputTerminal = new AUAInputTerminalDictionary), Exit);
 				RELEASE_IF_FALSE (inputTerminal, inputTerminal->initDictionaryForUse());
 				FailIf (NULL == inputTerminal, Exit);
@@ -3598,6 +4742,7 @@ USBInterfaceDescriptorPtr AUAControlDictionary::parseACInterfaceDescriptor (USBI
                 break;
             case OUTPUT_TERMINAL:
                 debugIOLog ("? AUAControlDictionary[%p]::parseACInterfaceDescriptor () - @ OUTPUT_TERMINAL (4.3.2.2)", this);
+                RejectIfShorterThan (kMinOutputTerminalLength_0100, Exit);
 				FailIf (NULL == (outputTerminal = new AUAOutputTerminalDictionary), Exit);
 				RELEASE_IF_FALSE (outputTerminal, outputTerminal->initDictionaryForUse());
 				FailIf (NULL == outputTerminal, Exit);
@@ -3629,6 +4774,7 @@ USBInterfaceDescriptorPtr AUAControlDictionary::parseACInterfaceDescriptor (USBI
 					UInt8						numControls;
 
 					debugIOLog ("? AUAControlDictionary[%p]::parseACInterfaceDescriptor () - @ FEATURE_UNIT (4.3.2.5)", this);
+					RejectIfShorterThan (kMinFeatureUnitLength_0100, Exit);
 					FailIf (NULL == (featureUnit = new AUAFeatureUnitDictionary), Exit);
 					RELEASE_IF_FALSE (featureUnit, featureUnit->initDictionaryForUse());
 					FailIf (NULL == featureUnit, Exit);
@@ -3668,6 +4814,8 @@ USBInterfaceDescriptorPtr AUAControlDictionary::parseACInterfaceDescriptor (USBI
 
 					debugIOLog ("? AUAControlDictionary[%p]::parseACInterfaceDescriptor () - @ MIXER_UNIT (4.3.2.3)", this);
 					debugIOLog ("? AUAControlDictionary[%p]::parseACInterfaceDescriptor () - descriptor length = %d", this, theInterfacePtr->bLength);
+					RejectIfShorterThan (kMinMixerUnitLength_0100, Exit);
+					RejectIfShorterThan (kMinMixerUnitLength_0100 + ((ACMixerUnitDescriptorPtr)theInterfacePtr)->bNrInPins, Exit);
 					FailIf (NULL == (mixerUnit = new AUAMixerUnitDictionary), Exit);
 					RELEASE_IF_FALSE (mixerUnit, mixerUnit->initDictionaryForUse());
 					FailIf (NULL == mixerUnit, Exit);
@@ -3709,6 +4857,8 @@ USBInterfaceDescriptorPtr AUAControlDictionary::parseACInterfaceDescriptor (USBI
 				}
             case SELECTOR_UNIT:
                 debugIOLog ("? AUAControlDictionary[%p]::parseACInterfaceDescriptor () - @ SELECTOR_UNIT (4.3.2.4)", this);
+                RejectIfShorterThan (kMinSelectorUnitLength_0100, Exit);
+                RejectIfShorterThan (kMinSelectorUnitLength_0100 + ((ACSelectorUnitDescriptorPtr)theInterfacePtr)->bNrInPins, Exit);
 				FailIf (NULL == (selectorUnit = new AUASelectorUnitDictionary), Exit);
 				RELEASE_IF_FALSE (selectorUnit, selectorUnit->initDictionaryForUse());
 				FailIf (NULL == selectorUnit, Exit);
@@ -3742,6 +4892,9 @@ USBInterfaceDescriptorPtr AUAControlDictionary::parseACInterfaceDescriptor (USBI
 					UInt8						nrChannels;
 
 					debugIOLog ("? AUAControlDictionary[%p]::parseACInterfaceDescriptor () - @ PROCESSING_UNIT (4.3.2.6)", this);
+					RejectIfShorterThan (kMinProcessingUnitLength_0100, Exit);
+					RejectIfShorterThan (kMinProcessingUnitLength_0100 + ((ACProcessingUnitDescriptorPtr)theInterfacePtr)->bNrInPins, Exit);
+					RejectIfShorterThan (kMinProcessingUnitLength_0100 + ((ACProcessingUnitDescriptorPtr)theInterfacePtr)->bNrInPins + ((ACProcessingUnitDescriptorPtr)theInterfacePtr)->baSourceID[((ACProcessingUnitDescriptorPtr)theInterfacePtr)->bNrInPins + 4], Exit);
 					FailIf (NULL == (processingUnit = new AUAProcessingUnitDictionary), Exit);
 					RELEASE_IF_FALSE (processingUnit, processingUnit->initDictionaryForUse());
 					FailIf (NULL == processingUnit, Exit);
@@ -3784,6 +4937,8 @@ USBInterfaceDescriptorPtr AUAControlDictionary::parseACInterfaceDescriptor (USBI
 				}
             case EXTENSION_UNIT:
                 debugIOLog ("? AUAControlDictionary[%p]::parseACInterfaceDescriptor () - @ EXTENSION_UNIT (4.3.2.7)", this);
+                RejectIfShorterThan (kMinExtensionUnitLength_0100, Exit);
+                RejectIfShorterThan (kMinExtensionUnitLength_0100 + ((ACExtensionUnitDescriptorPtr)theInterfacePtr)->bNrInPins, Exit);
 				FailIf (NULL == (extensionUnit = new AUAExtensionUnitDictionary), Exit);
 				RELEASE_IF_FALSE (extensionUnit, extensionUnit->initDictionaryForUse());
 				FailIf (NULL == extensionUnit, Exit);
@@ -3813,16 +4968,23 @@ USBInterfaceDescriptorPtr AUAControlDictionary::parseACInterfaceDescriptor (USBI
             default:
                 debugIOLog ("? AUAControlDictionary[%p]::parseACInterfaceDescriptor () - @ default. Nothing to do here.", this);
         }
-		theInterfacePtr = (USBInterfaceDescriptorPtr)((UInt8 *)theInterfacePtr + theInterfacePtr->bLength);
-		* parsedLength = ( theInterfacePtr ? ( * parsedLength + theInterfacePtr->bLength ) : totalLength );
+		theInterfacePtr = nextDescriptor ((UInt8 *)theInterfacePtr + theInterfacePtr->bLength, parsedLength, totalLength);
     }
 
 Exit:
+	// Only set when a descriptor is given up on part way through.
+	RELEASE_IF_NOT_NULL (inputTerminal);
+	RELEASE_IF_NOT_NULL (outputTerminal);
+	RELEASE_IF_NOT_NULL (featureUnit);
+	RELEASE_IF_NOT_NULL (mixerUnit);
+	RELEASE_IF_NOT_NULL (selectorUnit);
+	RELEASE_IF_NOT_NULL (processingUnit);
+	RELEASE_IF_NOT_NULL (extensionUnit);
 	debugIOLog ("- AUAControlDictionary[%p]::parseACInterfaceDescriptor () = %p", this, theInterfacePtr);
     return theInterfacePtr;
 }
 
-USBInterfaceDescriptorPtr AUAControlDictionary::parseACInterfaceDescriptor_0200 (USBInterfaceDescriptorPtr theInterfacePtr, UInt8 const currentInterface, UInt16 * parsedLength, UInt16 totalLength) 
+USBInterfaceDescriptorPtr AUAControlDictionary::parseACInterfaceDescriptor_0200 (USBInterfaceDescriptorPtr theInterfacePtr, UInt8 const currentInterface, UInt32 * parsedLength, UInt16 totalLength) 
 {
 	OSArray *							inputTerminals = NULL;
 	OSArray *							outputTerminals = NULL;
@@ -3854,15 +5016,18 @@ USBInterfaceDescriptorPtr AUAControlDictionary::parseACInterfaceDescriptor_0200
     FailIf (0 == theInterfacePtr->bLength, Exit);
     FailIf (CS_INTERFACE != theInterfacePtr->bDescriptorType, Exit);
 
-    while	(		( theInterfacePtr->bLength > 0 )
+    while	(		( theInterfacePtr )
+				&&	( theInterfacePtr->bLength > 0 )
 				&&	( CS_INTERFACE == theInterfacePtr->bDescriptorType )
 				&&	( * parsedLength <= totalLength ) )
 	{
 		logDescriptor ((UInt8 *) theInterfacePtr, theInterfacePtr->bLength);
+		RejectIfShorterThan (kMinCSDescriptorLength, Exit);
         switch (theInterfacePtr->bDescriptorSubtype) 
 		{
             case USBAUDIO_0200::HEADER:
                 debugIOLog ("? AUAControlDictionary[%p]::parseACInterfaceDescriptor_0200 () - @ HEADER (4.7.2)", this);
+                RejectIfShorterThan (kMinACHeaderLength_0200, Exit);
 				adcVersion = USBToHostWord (* (UInt16 *) (&(((USBAUDIO_0200::ACInterfaceHeaderDescriptorPtr)theInterfacePtr)->bcdADC[0])));
 				if (adcVersion != kAUAUSBSpec2_0)
 				{
@@ -3874,6 +5039,7 @@ USBInterfaceDescriptorPtr AUAControlDictionary::parseACInterfaceDescriptor_0200
 				break;
             case USBAUDIO_0200::INPUT_TERMINAL:
                 debugIOLog ("? AUAControlDictionary[%p]::parseACInterfaceDescriptor_0200 () - @ INPUT_TERMINAL (4.7.2.4)", this);
+                RejectIfShorterThan (kMinInputTerminalLength_0200, Exit);
 				FailIf (NULL == (inputTerminal = new AUAInputTerminalDictionary), Exit);
 				RELEASE_IF_FALSE (inputTerminal, inputTerminal->initDictionaryForUse());
 				FailIf (NULL == inputTerminal, Exit);
@@ -3905,6 +5071,7 @@ USBInterfaceDescriptorPtr AUAControlDictionary::parseACInterfaceDescriptor_0200
                 break;
             case USBAUDIO_0200::OUTPUT_TERMINAL:
                 debugIOLog ("? AUAControlDictionary[%p]::parseACInterfaceDescriptor_0200 () - @ OUTPUT_TERMINAL (4.7.2.5)", this);
+                RejectIfShorterThan (kMinOutputTerminalLength_0200, Exit);
 				FailIf (NULL == (outputTerminal = new AUAOutputTerminalDictionary), Exit);
 				RELEASE_IF_FALSE (outputTerminal, outputTerminal->initDictionaryForUse());
 				FailIf (NULL == outputTerminal, Exit);
@@ -3937,6 +5104,7 @@ USBInterfaceDescriptorPtr AUAControlDictionary::parseACInterfaceDescriptor_0200
 					UInt8						numControls;
 
 					debugIOLog ("? AUAControlDictionary[%p]::parseACInterfaceDescriptor_0200 () - @ FEATURE_UNIT (4.7.2.8)", this);
+					RejectIfShorterThan (kMinFeatureUnitLength_0200, Exit);
 					FailIf (NULL == (featureUnit = new AUAFeatureUnitDictionary), Exit);
 					RELEASE_IF_FALSE (featureUnit, featureUnit->initDictionaryForUse());
 					FailIf (NULL == featureUnit, Exit);
@@ -3975,6 +5143,8 @@ USBInterfaceDescriptorPtr AUAControlDictionary::parseACInterfaceDescriptor_0200
 
 					debugIOLog ("? AUAControlDictionary[%p]::parseACInterfaceDescriptor_0200 () - @ MIXER_UNIT (4.7.2.6)", this);
 					debugIOLog ("? AUAControlDictionary[%p]::parseACInterfaceDescriptor_0200 () - descriptor length = %d", this, theInterfacePtr->bLength);
+					RejectIfShorterThan (kMinMixerUnitLength_0200, Exit);
+					RejectIfShorterThan (kMinMixerUnitLength_0200 + ((USBAUDIO_0200::ACMixerUnitDescriptorPtr)theInterfacePtr)->bNrInPins, Exit);
 					FailIf (NULL == (mixerUnit = new AUAMixerUnitDictionary), Exit);
 					RELEASE_IF_FALSE (mixerUnit, mixerUnit->initDictionaryForUse());
 					FailIf (NULL == mixerUnit, Exit);
@@ -4017,6 +5187,8 @@ USBInterfaceDescriptorPtr AUAControlDictionary::parseACInterfaceDescriptor_0200
 				}
             case USBAUDIO_0200::SELECTOR_UNIT:
                 debugIOLog ("? AUAControlDictionary[%p]::parseACInterfaceDescriptor_0200 () - @ SELECTOR_UNIT (4.7.2.7)", this);
+                RejectIfShorterThan (kMinSelectorUnitLength_0200, Exit);
+                RejectIfShorterThan (kMinSelectorUnitLength_0200 + ((USBAUDIO_0200::ACSelectorUnitDescriptorPtr)theInterfacePtr)->bNrInPins, Exit);
 				FailIf (NULL == (selectorUnit = new AUASelectorUnitDictionary), Exit);
 				RELEASE_IF_FALSE (selectorUnit, selectorUnit->initDictionaryForUse());
 				FailIf (NULL == selectorUnit, Exit);
@@ -4048,6 +5220,7 @@ USBInterfaceDescriptorPtr AUAControlDictionary::parseACInterfaceDescriptor_0200
 					UInt8						numControls;
 
 					debugIOLog ("? AUAControlDictionary[%p]::parseACInterfaceDescriptor_0200 () - @ EFFECT_UNIT (4.7.2.10)", this);
+					RejectIfShorterThan (kMinEffectUnitLength_0200, Exit);
 					FailIf (NULL == (effectUnit = new AUAEffectUnitDictionary), Exit);
 					RELEASE_IF_FALSE (effectUnit, effectUnit->initDictionaryForUse());
 					FailIf (NULL == effectUnit, Exit);
@@ -4086,6 +5259,8 @@ USBInterfaceDescriptorPtr AUAControlDictionary::parseACInterfaceDescriptor_0200
 					UInt8						nrChannels;
 
 					debugIOLog ("? AUAControlDictionary[%p]::parseACInterfaceDescriptor_0200 () - @ PROCESSING_UNIT (4.7.2.11)", this);
+					RejectIfShorterThan (kMinProcessingUnitLength_0200, Exit);
+					RejectIfShorterThan (kMinProcessingUnitLength_0200 + ((USBAUDIO_0200::ACProcessingUnitDescriptorPtr)theInterfacePtr)->bNrInPins, Exit);
 					FailIf (NULL == (processingUnit = new AUAProcessingUnitDictionary), Exit);
 					RELEASE_IF_FALSE (processingUnit, processingUnit->initDictionaryForUse());
 					FailIf (NULL == processingUnit, Exit);
@@ -4128,6 +5303,8 @@ USBInterfaceDescriptorPtr AUAControlDictionary::parseACInterfaceDescriptor_0200
 				}
             case USBAUDIO_0200::EXTENSION_UNIT:
                 debugIOLog ("? AUAControlDictionary[%p]::parseACInterfaceDescriptor_0200 () - @ EXTENSION_UNIT (4.7.2.12)", this);
+                RejectIfShorterThan (kMinExtensionUnitLength_0200, Exit);
+                RejectIfShorterThan (kMinExtensionUnitLength_0200 + ((USBAUDIO_0200::ACExtensionUnitDescriptorPtr)theInterfacePtr)->bNrInPins, Exit);
 				FailIf (NULL == (extensionUnit = new AUAExtensionUnitDictionary), Exit);
 				RELEASE_IF_FALSE (extensionUnit, extensionUnit->initDictionaryForUse());
 				FailIf (NULL == extensionUnit, Exit);
@@ -4156,6 +5333,7 @@ USBInterfaceDescriptorPtr AUAControlDictionary::parseACInterfaceDescriptor_0200
 				break;
 			case USBAUDIO_0200::CLOCK_SOURCE:
                 debugIOLog ("? AUAControlDictionary[%p]::parseACInterfaceDescriptor_0200 () - @ CLOCK_SOURCE (4.7.2.1)", this);
+                RejectIfShorterThan (kMinClockSourceLength_0200, Exit);
 				FailIf (NULL == (clockSource = new AUAClockSourceDictionary), Exit);
 				RELEASE_IF_FALSE (clockSource, clockSource->initDictionaryForUse());
 				FailIf (NULL == clockSource, Exit);
@@ -4184,6 +5362,8 @@ USBInterfaceDescriptorPtr AUAControlDictionary::parseACInterfaceDescriptor_0200
                 break;
 			case USBAUDIO_0200::CLOCK_SELECTOR:
                 debugIOLog ("? AUAControlDictionary[%p]::parseACInterfaceDescriptor_0200 () - @ CLOCK_SELECTOR (4.7.2.2)", this);
+                RejectIfShorterThan (kMinClockSelectorLength_0200, Exit);
+                RejectIfShorterThan (kMinClockSelectorLength_0200 + ((USBAUDIO_0200::ACClockSelectorDescriptorPtr)theInterfacePtr)->bNrInPins, Exit);
 				FailIf (NULL == (clockSelector = new AUAClockSelectorDictionary), Exit);
 				RELEASE_IF_FALSE (clockSelector, clockSelector->initDictionaryForUse());
 				FailIf (NULL == clockSelector, Exit);
@@ -4212,6 +5392,7 @@ USBInterfaceDescriptorPtr AUAControlDictionary::parseACInterfaceDescriptor_0200
                 break;
 			case USBAUDIO_0200::CLOCK_MULTIPLIER:
                 debugIOLog ("? AUAControlDictionary[%p]::parseACInterfaceDescriptor_0200 () - @ CLOCK_MULTIPLIER (4.7.2.3)", this);
+                RejectIfShorterThan (kMinClockMultiplierLength_0200, Exit);
 				FailIf (NULL == (clockMultiplier = new AUAClockMultiplierDictionary), Exit);
 				RELEASE_IF_FALSE (clockMultiplier, clockMultiplier->initDictionaryForUse());
 				FailIf (NULL == clockMultiplier, Exit);
@@ -4240,11 +5421,21 @@ USBInterfaceDescriptorPtr AUAControlDictionary::parseACInterfaceDescriptor_0200
             default:
                 debugIOLog ("? AUAControlDictionary[%p]::parseACInterfaceDescriptor_0200 () - @ default. Nothing to do here.", this);
         }
-		theInterfacePtr = (USBInterfaceDescriptorPtr)((UInt8 *)theInterfacePtr + theInterfacePtr->bLength);
-		* parsedLength = ( theInterfacePtr ? ( * parsedLength + theInterfacePtr->bLength ) : totalLength );
+		theInterfacePtr = nextDescriptor ((UInt8 *)theInterfacePtr + theInterfacePtr->bLength, parsedLength, totalLength);
     }
 
 Exit:
+	RELEASE_IF_NOT_NULL (inputTerminal);
+	RELEASE_IF_NOT_NULL (outputTerminal);
+	RELEASE_IF_NOT_NULL (featureUnit);
+	RELEASE_IF_NOT_NULL (mixerUnit);
+	RELEASE_IF_NOT_NULL (selectorUnit);
+	RELEASE_IF_NOT_NULL (effectUnit);
+	RELEASE_IF_NOT_NULL (processingUnit);
+	RELEASE_IF_NOT_NULL (extensionUnit);
+	RELEASE_IF_NOT_NULL (clockSource);
+	RELEASE_IF_NOT_NULL (clockSelector);
+	RELEASE_IF_NOT_NULL (clockMultiplier);
 	debugIOLog ("- AUAControlDictionary[%p]::parseACInterfaceDescriptor_0200 () = %p", this, theInterfacePtr);
     return theInterfacePtr;
 }
@@ -4296,7 +5487,7 @@ Exit:
 }
 
 // <rdar://problem/6021475> AppleUSBAudio: Status Interrupt Endpoint support
-USBInterfaceDescriptorPtr AUAControlDictionary::parseACInterruptEndpointDescriptor ( USBInterfaceDescriptorPtr theInterfacePtr ) 
+USBInterfaceDescriptorPtr AUAControlDictionary::parseACInterruptEndpointDescriptor ( USBInterfaceDescriptorPtr theInterfacePtr, UInt32 * parsedLength, UInt16 totalLength ) 
 {
     AUAEndpointDictionary *		thisEndpoint = NULL;
 	OSArray *					endpoints = 0;
@@ -4308,6 +5499,7 @@ USBInterfaceDescriptorPtr AUAControlDictionary::parseACInterruptEndpointDescript
 
 	if ( ENDPOINT == theInterfacePtr->bDescriptorType ) 
 	{
+		RejectIfShorterThan ( kMinEndpointLength, Exit );
 		if ( kInterruptType == (((USBEndpointDescriptorPtr)theInterfacePtr)->bmAttributes & kInterruptType) ) 
 		{
 			debugIOLog ("? AUAControlDictionary[%p]::parseACInterruptEndpointDescriptor () - @ ENDPOINT (4.6.1.1)", this);
@@ -4334,7 +5526,7 @@ USBInterfaceDescriptorPtr AUAControlDictionary::parseACInterruptEndpointDescript
 			thisEndpoint->release ();
 			thisEndpoint = NULL;
 			
-			theInterfacePtr = ( USBInterfaceDescriptorPtr )( ( UInt8 * )theInterfacePtr + theInterfacePtr->bLength );
+			theInterfacePtr = nextDescriptor ( ( UInt8 * )theInterfacePtr + theInterfacePtr->bLength, parsedLength, totalLength );
 		}
 	}
 
@@ -4473,6 +5665,88 @@ Exit:
     return streamDictionary;
 }
 
+void AUAStreamDictionary::free (void)
+{
+	if (NULL != mParsedSampleRates)
+	{
+		mParsedSampleRates->release ();
+		mParsedSampleRates = NULL;
+	}
+	AppleUSBAudioDictionary::free ();
+}
+
+static const char * const	sClockPathSampleRateKeys[] = { kSampleRates, kNumSampleRates, kSampleRateRanges, kSampleRateRangeResolutions };
+
+// Puts the sample rate keys back the way parsing left them.
+void AUAStreamDictionary::restoreParsedSampleRates (void)
+{
+	OSObject *		parsedValue;
+	OSArray *		parsedArray;
+	OSArray *		sampleRates;
+
+	FailIf (false == mParsedSampleRatesSaved, Exit);
+	FailIf (NULL == mParsedSampleRates, Exit);
+	for (UInt32 keyIndex = 0; keyIndex < sizeof (sClockPathSampleRateKeys) / sizeof (sClockPathSampleRateKeys[0]); keyIndex++)
+	{
+		if (NULL == (parsedValue = mParsedSampleRates->getObject (sClockPathSampleRateKeys[keyIndex])))
+		{
+			removeObject (sClockPathSampleRateKeys[keyIndex]);
+		}
+		else if (NULL != (parsedArray = OSDynamicCast (OSArray, parsedValue)))
+		{
+			// Hand out a copy so the saved rates stay as parsed when rates are added again.
+			FailIf (NULL == (sampleRates = OSArray::withArray (parsedArray)), Exit);
+			setObject (sClockPathSampleRateKeys[keyIndex], sampleRates);
+			sampleRates->release ();
+		}
+		else
+		{
+			setObject (sClockPathSampleRateKeys[keyIndex], parsedValue);
+		}
+	}
+
+Exit:
+	return;
+}
+
+void AUAStreamDictionary::saveParsedSampleRates (void)
+{
+	OSObject *		value;
+	OSArray *		sampleRates;
+
+	if (!mParsedSampleRatesSaved)
+	{
+		FailIf (NULL == (mParsedSampleRates = OSDictionary::withCapacity (4)), Exit);
+		for (UInt32 keyIndex = 0; keyIndex < sizeof (sClockPathSampleRateKeys) / sizeof (sClockPathSampleRateKeys[0]); keyIndex++)
+		{
+			if (NULL == (value = getObject (sClockPathSampleRateKeys[keyIndex])))
+			{
+				continue;
+			}
+			// The rate arrays are added to in place, so keep copies of them.
+			if (NULL != OSDynamicCast (OSArray, value))
+			{
+				FailIf (NULL == (sampleRates = OSArray::withArray ((OSArray *)value)), Exit);
+				mParsedSampleRates->setObject (sClockPathSampleRateKeys[keyIndex], sampleRates);
+				sampleRates->release ();
+			}
+			else
+			{
+				mParsedSampleRates->setObject (sClockPathSampleRateKeys[keyIndex], value);
+			}
+		}
+		mParsedSampleRatesSaved = true;
+	}
+
+Exit:
+	if ( ( !mParsedSampleRatesSaved ) && ( NULL != mParsedSampleRates ) )
+	{
+		mParsedSampleRates->release ();
+		mParsedSampleRates = NULL;
+	}
+	return;
+}
+
 AUAEndpointDictionary * AUAStreamDictionary::getIndexedEndpointDictionary (UInt8 index) 
 {
     AUAEndpointDictionary *		thisEndpoint = NULL;
@@ -4631,6 +5905,35 @@ Exit:
 	return result;
 }
 
+IOReturn AUAStreamDictionary::getIsocEndpointTransactionsPerMicroframe (UInt8 * transactions, UInt8 direction)
+{
+    AUAEndpointDictionary *		thisEndpoint = NULL;
+	OSArray *					endpoints = NULL;
+    IOReturn					result = kIOReturnError;
+	UInt8						endpointIndex;
+	UInt8						thisDirection;
+
+	FailIf ( NULL == transactions, Exit );
+	FailIf ( NULL == ( endpoints = getEndpoints () ), Exit );
+	endpointIndex = 0;
+	* transactions = 0;
+	
+	while ( ! ( * transactions ) && endpointIndex < endpoints->getCount ()) 
+	{
+		FailIf ( NULL == ( thisEndpoint = getIndexedEndpointDictionary ( endpointIndex ) ), Exit );
+		FailIf ( kIOReturnSuccess != ( result = thisEndpoint->getDirection (&thisDirection) ), Exit );
+		if ( direction == thisDirection ) 
+		{
+			// This is the isoc endpoint for which we are looking.
+			FailIf ( kIOReturnSuccess != ( result = thisEndpoint->getTransactionsPerMicroframe ( transactions ) ), Exit );
+		}
+		endpointIndex++;
+	}
+	
+Exit:
+	return result;
+}
+
 IOReturn AUAStreamDictionary::getIsocEndpointSyncType (UInt8 * syncType, UInt8 address) 
 {
     AUAEndpointDictionary *		thisEndpoint = NULL;
@@ -4651,7 +5954,7 @@ inline UInt32 ConvertSampleFreq (UInt8 *p)
 	return (bigEndianSampleFreq);
 }
 
-USBInterfaceDescriptorPtr AUAStreamDictionary::parseASInterfaceDescriptor (USBInterfaceDescriptorPtr theInterfacePtr, UInt8 const currentInterface, UInt16 * parsedLength, UInt16 totalLength) 
+USBInterfaceDescriptorPtr AUAStreamDictionary::parseASInterfaceDescriptor (USBInterfaceDescriptorPtr theInterfacePtr, UInt8 const currentInterface, UInt32 * parsedLength, UInt16 totalLength) 
 {
     AUAEndpointDictionary *		thisEndpoint = NULL;
 	AUAASEndpointDictionary *	asIsocEndpoint = NULL;
@@ -4679,10 +5982,12 @@ USBInterfaceDescriptorPtr AUAStreamDictionary::parseASInterfaceDescriptor (USBIn
         }
 		if (CS_INTERFACE == theInterfacePtr->bDescriptorType) 
 		{
+			RejectIfShorterThan (kMinCSDescriptorLength, Exit);
             switch (theInterfacePtr->bDescriptorSubtype) 
 			{
                 case AS_GENERAL:
                     debugIOLog ("? AUAStreamDictionary[%p]::parseASInterfaceDescriptor () - @ AS_GENERAL (4.5.2)", this);
+                    RejectIfShorterThan (kMinASGeneralLength_0100, Exit);
                     FailIf (kIOReturnSuccess != setDictionaryValue (kTerminalLink, ((ASInterfaceDescriptorPtr)theInterfacePtr)->bTerminalLink), Exit);
                     FailIf (kIOReturnSuccess != setDictionaryValue (kDelay, ((ASInterfaceDescriptorPtr)theInterfacePtr)->bDelay), Exit);
                     //formatTag = USBToHostWord ((((ASInterfaceDescriptorPtr)theInterfacePtr)->wFormatTag[1] << 8) | ((ASInterfaceDescriptorPtr)theInterfacePtr)->wFormatTag[0]);
@@ -4690,20 +5995,23 @@ USBInterfaceDescriptorPtr AUAStreamDictionary::parseASInterfaceDescriptor (USBIn
 					debugIOLog ( "? AUAStreamDictionary[%p]::parseASInterfaceDescriptor () - formatTag = 0x%x", this, formatTag );
 					FailIf (kIOReturnSuccess != setDictionaryValue (kFormatTag, formatTag), Exit);
 
-					theInterfacePtr = (USBInterfaceDescriptorPtr)((UInt8 *)theInterfacePtr + theInterfacePtr->bLength);
-					* parsedLength = ( theInterfacePtr ? ( * parsedLength + theInterfacePtr->bLength ) : totalLength );
+					theInterfacePtr = nextDescriptor ((UInt8 *)theInterfacePtr + theInterfacePtr->bLength, parsedLength, totalLength);
                     break;
                 case FORMAT_TYPE:
                     debugIOLog ("? AUAStreamDictionary[%p]::parseASInterfaceDescriptor () - @ FORMAT_TYPE", this);
+                    RejectIfShorterThan (kMinFormatTypeLength, Exit);
 					switch (((ASFormatTypeIDescriptorPtr)theInterfacePtr)->bFormatType) 
 					{
 						case FORMAT_TYPE_I:
 						case FORMAT_TYPE_III:
 							debugIOLog ("? AUAStreamDictionary[%p]::parseASInterfaceDescriptor () - @ FORMAT_TYPE_I/FORMAT_TYPE_III (Format 2.2.5/2.4.1)", this);
+							RejectIfShorterThan (kMinFormatTypeILength_0100, Exit);
+							numSampleFreqs = ((ASFormatTypeIDescriptorPtr)theInterfacePtr)->bSamFreqType;
+							// A continuous range is a lower and an upper bound.
+							RejectIfShorterThan (kMinFormatTypeILength_0100 + kBytesPerSampleFrequency * ((0 != numSampleFreqs) ? numSampleFreqs : 2), Exit);
 							FailIf (kIOReturnSuccess != (setDictionaryValue (kNumChannels, ((ASFormatTypeIDescriptorPtr)theInterfacePtr)->bNrChannels)), Exit);
 							FailIf (kIOReturnSuccess != (setDictionaryValue (kSubframeSize, ((ASFormatTypeIDescriptorPtr)theInterfacePtr)->bSubframeSize)), Exit);
 							FailIf (kIOReturnSuccess != (setDictionaryValue (kBitResolution, ((ASFormatTypeIDescriptorPtr)theInterfacePtr)->bBitResolution)), Exit);
-							numSampleFreqs = ((ASFormatTypeIDescriptorPtr)theInterfacePtr)->bSamFreqType;
 							FailIf (kIOReturnSuccess != setDictionaryValue (kNumSampleRates, numSampleFreqs), Exit);
 							
 							if (0 != numSampleFreqs) 
@@ -4730,11 +6038,13 @@ USBInterfaceDescriptorPtr AUAStreamDictionary::parseASInterfaceDescriptor (USBIn
 							UInt16		samplesPerFrame;
 							
 							debugIOLog ("? AUAStreamDictionary[%p]::parseASInterfaceDescriptor () - @ FORMAT_TYPE_II (Format 2.3.6)", this);
+							RejectIfShorterThan (kMinFormatTypeIILength_0100, Exit);
+							numSampleFreqs = ((ASFormatTypeIIDescriptorPtr)theInterfacePtr)->bSamFreqType;
+							RejectIfShorterThan (kMinFormatTypeIILength_0100 + kBytesPerSampleFrequency * ((0 != numSampleFreqs) ? numSampleFreqs : 2), Exit);
 							maxBitRate = USBToHostWord (((ASFormatTypeIIDescriptorPtr)theInterfacePtr)->wMaxBitRate);
 							FailIf (kIOReturnSuccess != setDictionaryValue (kMaxBitRate, maxBitRate), Exit);
 							samplesPerFrame = USBToHostWord (((ASFormatTypeIIDescriptorPtr)theInterfacePtr)->wSamplesPerFrame);
 							FailIf (kIOReturnSuccess != setDictionaryValue (kSamplesPerFrame, samplesPerFrame), Exit);
-							numSampleFreqs = ((ASFormatTypeIIDescriptorPtr)theInterfacePtr)->bSamFreqType;
 							FailIf (kIOReturnSuccess != setDictionaryValue (kNumSampleRates, numSampleFreqs), Exit);
 
 							if (0 != numSampleFreqs) 
@@ -4759,19 +6069,20 @@ USBInterfaceDescriptorPtr AUAStreamDictionary::parseASInterfaceDescriptor (USBIn
 						default:
 							debugIOLog ("! AUAStreamDictionary[%p]::parseASInterfaceDescriptor () - @ Unknown Format Type!", this);
 					}
-                    theInterfacePtr = (USBInterfaceDescriptorPtr)((UInt8 *)theInterfacePtr + theInterfacePtr->bLength);
-					* parsedLength = ( theInterfacePtr ? ( * parsedLength + theInterfacePtr->bLength ) : totalLength );
+                    theInterfacePtr = nextDescriptor ((UInt8 *)theInterfacePtr + theInterfacePtr->bLength, parsedLength, totalLength);
                     break;
 				case FORMAT_SPECIFIC:
 					UInt32		bmAC3BSID;
 					UInt16		bmMPEGCapabilities;
 					
                     debugIOLog ("? AUAStreamDictionary[%p]::parseASInterfaceDescriptor () - @ FORMAT_SPECIFIC", this);
+					RejectIfShorterThan (kMinFormatSpecificLength_0100, Exit);
 					formatTag = USBToHostWord (((ASFormatSpecificDescriptorHeaderPtr)theInterfacePtr)->wFormatTag[1] << 8 | ((ASFormatSpecificDescriptorHeaderPtr)theInterfacePtr)->wFormatTag[0]);
 					switch (formatTag) 
 					{
 						case MPEG:
 							debugIOLog ("? AUAStreamDictionary[%p]::parseASInterfaceDescriptor () - @ MPEG (2.3.8.1.1)", this);
+							RejectIfShorterThan (kMinMPEGFormatLength_0100, Exit);
 							bmMPEGCapabilities = USBToHostWord(
 												((ASMPEGFormatSpecificDescriptorPtr)theInterfacePtr)->bmMPEGCapabilities[1] << 8 |
 												((ASMPEGFormatSpecificDescriptorPtr)theInterfacePtr)->bmMPEGCapabilities[0]);
@@ -4780,6 +6091,7 @@ USBInterfaceDescriptorPtr AUAStreamDictionary::parseASInterfaceDescriptor (USBIn
 							break;
 						case AC3:
 							debugIOLog ("? AUAStreamDictionary[%p]::parseASInterfaceDescriptor () - @ AC3 (Format 2.3.8.2.1)", this);
+							RejectIfShorterThan (kMinAC3FormatLength_0100, Exit);
 							bmAC3BSID = USBToHostLong(
 										((ASAC3FormatSpecificDescriptorPtr)theInterfacePtr)->bmBSID[3] << 24 |
 										((ASAC3FormatSpecificDescriptorPtr)theInterfacePtr)->bmBSID[2] << 16 |
@@ -4792,13 +6104,11 @@ USBInterfaceDescriptorPtr AUAStreamDictionary::parseASInterfaceDescriptor (USBIn
 							debugIOLog ("! AUAStreamDictionary[%p]::parseASInterfaceDescriptor () - @ Unknown format type 0x%x", this, formatTag);
 							break;
 					}
-                    theInterfacePtr = (USBInterfaceDescriptorPtr)((UInt8 *)theInterfacePtr + theInterfacePtr->bLength);
-					* parsedLength = ( theInterfacePtr ? ( * parsedLength + theInterfacePtr->bLength ) : totalLength );
+                    theInterfacePtr = nextDescriptor ((UInt8 *)theInterfacePtr + theInterfacePtr->bLength, parsedLength, totalLength);
                     break;
                 default:
                     debugIOLog ("? AUAStreamDictionary[%p]::parseASInterfaceDescriptor () - @ Default", this);
-                    theInterfacePtr = (USBInterfaceDescriptorPtr)((UInt8 *)theInterfacePtr + theInterfacePtr->bLength);
-					* parsedLength = ( theInterfacePtr ? ( * parsedLength + theInterfacePtr->bLength ) : totalLength );
+                    theInterfacePtr = nextDescriptor ((UInt8 *)theInterfacePtr + theInterfacePtr->bLength, parsedLength, totalLength);
             }
         } 
 		else 
@@ -4813,13 +6123,23 @@ USBInterfaceDescriptorPtr AUAStreamDictionary::parseASInterfaceDescriptor (USBIn
                     break;
                 case ENDPOINT:
                     debugIOLog ("? AUAStreamDictionary[%p]::parseASInterfaceDescriptor () - @ ENDPOINT (4.6.1.1)", this);
+                    RejectIfShorterThan (kMinEndpointLength, Exit);
                     FailIf (NULL == (thisEndpoint = AUAEndpointDictionary::create ()), Exit);
 
 					thisEndpoint->setAddress (((USBEndpointDescriptorPtr)theInterfacePtr)->bEndpointAddress);
                     thisEndpoint->setAttributes (((USBEndpointDescriptorPtr)theInterfacePtr)->bmAttributes);
-                    thisEndpoint->setMaxPacketSize (USBToHostWord (((USBEndpointDescriptorPtr)theInterfacePtr)->wMaxPacketSize));
-					thisEndpoint->setRefreshInt (((USBEndpointDescriptorPtr)theInterfacePtr)->bRefresh);
-					thisEndpoint->setSynchAddress (((USBEndpointDescriptorPtr)theInterfacePtr)->bSynchAddress);
+                    thisEndpoint->setMaxPacketSizeFromDescriptor (USBToHostWord (((USBEndpointDescriptorPtr)theInterfacePtr)->wMaxPacketSize));
+					// Some devices report the 7 byte standard endpoint here instead of the 9 byte audio one.
+					if (theInterfacePtr->bLength >= kMinAudioEndpointLength_0100)
+					{
+						thisEndpoint->setRefreshInt (((USBEndpointDescriptorPtr)theInterfacePtr)->bRefresh);
+						thisEndpoint->setSynchAddress (((USBEndpointDescriptorPtr)theInterfacePtr)->bSynchAddress);
+					}
+					else
+					{
+						thisEndpoint->setRefreshInt (0);
+						thisEndpoint->setSynchAddress (0);
+					}
 
 					endpoints = getEndpoints ();
 					if (NULL == endpoints) 
@@ -4836,14 +6156,15 @@ USBInterfaceDescriptorPtr AUAStreamDictionary::parseASInterfaceDescriptor (USBIn
 					thisEndpoint->release ();
 					thisEndpoint = NULL;
 					
-                    theInterfacePtr = (USBInterfaceDescriptorPtr)((UInt8 *)theInterfacePtr + theInterfacePtr->bLength);
-					* parsedLength = ( theInterfacePtr ? ( * parsedLength + theInterfacePtr->bLength ) : totalLength );
+                    theInterfacePtr = nextDescriptor ((UInt8 *)theInterfacePtr + theInterfacePtr->bLength, parsedLength, totalLength);
                     break;
                 case CS_ENDPOINT:
                     debugIOLog ("? AUAStreamDictionary[%p]::parseASInterfaceDescriptor () - @ CS_ENDPOINT (4.6.1.2)", this);
+                    RejectIfShorterThan (kMinCSDescriptorLength, Exit);
                     if (EP_GENERAL == ((ASEndpointDescriptorPtr)theInterfacePtr)->bDescriptorSubtype) 
 					{
                         debugIOLog ("? AUAStreamDictionary[%p]::parseASInterfaceDescriptor () - @ EP_GENERAL", this);
+                        RejectIfShorterThan (kMinASEndpointLength_0100, Exit);
                         asIsocEndpoint = new AUAASEndpointDictionary (((ASEndpointDescriptorPtr)theInterfacePtr)->bmAttributes & (1 << sampleFreqControlBit),
                                                                             ((ASEndpointDescriptorPtr)theInterfacePtr)->bmAttributes & (1 << pitchControlBit),
                                                                             ((ASEndpointDescriptorPtr)theInterfacePtr)->bmAttributes & (1 << maxPacketsOnlyBit),
@@ -4853,23 +6174,23 @@ USBInterfaceDescriptorPtr AUAStreamDictionary::parseASInterfaceDescriptor (USBIn
 						FailIf (kIOReturnSuccess != setDictionaryObjectAndRelease (kASIsocEndpoint, asIsocEndpoint), Exit);
 						asIsocEndpoint = NULL;
                     }
-                    theInterfacePtr = (USBInterfaceDescriptorPtr)((UInt8 *)theInterfacePtr + theInterfacePtr->bLength);
-					* parsedLength = ( theInterfacePtr ? ( * parsedLength + theInterfacePtr->bLength ) : totalLength );
+                    theInterfacePtr = nextDescriptor ((UInt8 *)theInterfacePtr + theInterfacePtr->bLength, parsedLength, totalLength);
                     break;
                 default:
                     debugIOLog ("? AUAStreamDictionary[%p]::parseASInterfaceDescriptor () - @ Default (else)", this);
-                    theInterfacePtr = (USBInterfaceDescriptorPtr)((UInt8 *)theInterfacePtr + theInterfacePtr->bLength);
-					* parsedLength = ( theInterfacePtr ? ( * parsedLength + theInterfacePtr->bLength ) : totalLength );
+                    theInterfacePtr = nextDescriptor ((UInt8 *)theInterfacePtr + theInterfacePtr->bLength, parsedLength, totalLength);
             }
         }
     }
 
 Exit:
+	RELEASE_IF_NOT_NULL (thisEndpoint);
+	RELEASE_IF_NOT_NULL (asIsocEndpoint);
 	debugIOLog ("- AUAStreamDictionary[%p]::parseASInterfaceDescriptor () = 0x%x", this, theInterfacePtr);
     return theInterfacePtr;
 }
 
-USBInterfaceDescriptorPtr AUAStreamDictionary::parseASInterfaceDescriptor_0200 (USBInterfaceDescriptorPtr theInterfacePtr, UInt8 const currentInterface, UInt16 * parsedLength, UInt16 totalLength) 
+USBInterfaceDescriptorPtr AUAStreamDictionary::parseASInterfaceDescriptor_0200 (USBInterfaceDescriptorPtr theInterfacePtr, UInt8 const currentInterface, UInt32 * parsedLength, UInt16 totalLength) 
 {
     AUAEndpointDictionary *		thisEndpoint = NULL;
 	AUAASEndpointDictionary *	asIsocEndpoint = NULL;
@@ -4899,10 +6220,12 @@ USBInterfaceDescriptorPtr AUAStreamDictionary::parseASInterfaceDescriptor_0200 (
         }
 		if (CS_INTERFACE == theInterfacePtr->bDescriptorType) 
 		{
+			RejectIfShorterThan (kMinCSDescriptorLength, Exit);
             switch (theInterfacePtr->bDescriptorSubtype) 
 			{
                 case USBAUDIO_0200::AS_GENERAL:
                     debugIOLog ("? AUAStreamDictionary[%p]::parseASInterfaceDescriptor_0200 () - @ AS_GENERAL (4.9.2)", this);
+                    RejectIfShorterThan (kMinASGeneralLength_0200, Exit);
                     FailIf (kIOReturnSuccess != setDictionaryValue (kTerminalLink, ((USBAUDIO_0200::ASInterfaceDescriptorPtr)theInterfacePtr)->bTerminalLink), Exit);
 					formats = (((USBAUDIO_0200::ASInterfaceDescriptorPtr)theInterfacePtr)->bmFormats[3] << 24) | (((USBAUDIO_0200::ASInterfaceDescriptorPtr)theInterfacePtr)->bmFormats[2] << 16) | 
 							  (((USBAUDIO_0200::ASInterfaceDescriptorPtr)theInterfacePtr)->bmFormats[1] << 8) | ((USBAUDIO_0200::ASInterfaceDescriptorPtr)theInterfacePtr)->bmFormats[0];
@@ -4984,16 +6307,17 @@ USBInterfaceDescriptorPtr AUAStreamDictionary::parseASInterfaceDescriptor_0200 (
 					
 					FailIf (kIOReturnSuccess != (setDictionaryValue (kNumChannels, ((USBAUDIO_0200::ASInterfaceDescriptorPtr)theInterfacePtr)->bNrChannels)), Exit);
 
-					theInterfacePtr = (USBInterfaceDescriptorPtr)((UInt8 *)theInterfacePtr + theInterfacePtr->bLength);
-					* parsedLength = ( theInterfacePtr ? ( * parsedLength + theInterfacePtr->bLength ) : totalLength );
+					theInterfacePtr = nextDescriptor ((UInt8 *)theInterfacePtr + theInterfacePtr->bLength, parsedLength, totalLength);
                     break;
                 case USBAUDIO_0200::FORMAT_TYPE:
                     debugIOLog ("? AUAStreamDictionary[%p]::parseASInterfaceDescriptor_0200 () - @ FORMAT_TYPE", this);
+                    RejectIfShorterThan (kMinFormatTypeLength, Exit);
 					switch (((USBAUDIO_0200::ASFormatTypeIDescriptorPtr)theInterfacePtr)->bFormatType) 
 					{
 						case USBAUDIO_0200::FORMAT_TYPE_I:
 						case USBAUDIO_0200::FORMAT_TYPE_III:
 							debugIOLog ("? AUAStreamDictionary[%p]::parseASInterfaceDescriptor_0200 () - @ FORMAT_TYPE_I/FORMAT_TYPE_III (Format 2.3.1.6/2.3.3.1)", this);
+							RejectIfShorterThan (kMinFormatTypeILength_0200, Exit);
 							FailIf (kIOReturnSuccess != (setDictionaryValue (kSubframeSize, ((USBAUDIO_0200::ASFormatTypeIDescriptorPtr)theInterfacePtr)->bSubslotSize)), Exit);
 							FailIf (kIOReturnSuccess != (setDictionaryValue (kBitResolution, ((USBAUDIO_0200::ASFormatTypeIDescriptorPtr)theInterfacePtr)->bBitResolution)), Exit);
 							break;
@@ -5002,6 +6326,7 @@ USBInterfaceDescriptorPtr AUAStreamDictionary::parseASInterfaceDescriptor_0200 (
 							UInt16		samplesPerFrame;
 							
 							debugIOLog ("? AUAStreamDictionary[%p]::parseASInterfaceDescriptor_0200 () - @ FORMAT_TYPE_II (Format 2.3.2.6)", this);
+							RejectIfShorterThan (kMinFormatTypeIILength_0200, Exit);
 							maxBitRate = USBToHostWord (((USBAUDIO_0200::ASFormatTypeIIDescriptorPtr)theInterfacePtr)->wMaxBitRate);
 							FailIf (kIOReturnSuccess != setDictionaryValue (kMaxBitRate, maxBitRate), Exit);
 							samplesPerFrame = USBToHostWord (((USBAUDIO_0200::ASFormatTypeIIDescriptorPtr)theInterfacePtr)->wSlotsPerFrame);
@@ -5010,13 +6335,13 @@ USBInterfaceDescriptorPtr AUAStreamDictionary::parseASInterfaceDescriptor_0200 (
 						default:
 							debugIOLog ("! AUAStreamDictionary[%p]::parseASInterfaceDescriptor_0200 () - @ Unknown/Unsupported Format Type!", this);
 					}
-                    theInterfacePtr = (USBInterfaceDescriptorPtr)((UInt8 *)theInterfacePtr + theInterfacePtr->bLength);
-					* parsedLength = ( theInterfacePtr ? ( * parsedLength + theInterfacePtr->bLength ) : totalLength );
+                    theInterfacePtr = nextDescriptor ((UInt8 *)theInterfacePtr + theInterfacePtr->bLength, parsedLength, totalLength);
                     break;
 				case USBAUDIO_0200::ENCODER:					
 					UInt8		bEncoder;
 					
                     debugIOLog ("? AUAStreamDictionary[%p]::parseASInterfaceDescriptor_0200 () - @ ENCODER", this);
+                    RejectIfShorterThan (kMinCodecLength_0200, Exit);
 					bEncoder = ((USBAUDIO_0200::ASEncoderDescriptorPtr)theInterfacePtr)->bEncoder;
 					switch (bEncoder) 
 					{
@@ -5025,8 +6350,7 @@ USBInterfaceDescriptorPtr AUAStreamDictionary::parseASInterfaceDescriptor_0200 (
 							break;
 					}
 
-                    theInterfacePtr = (USBInterfaceDescriptorPtr)((UInt8 *)theInterfacePtr + theInterfacePtr->bLength);
-					* parsedLength = ( theInterfacePtr ? ( * parsedLength + theInterfacePtr->bLength ) : totalLength );
+                    theInterfacePtr = nextDescriptor ((UInt8 *)theInterfacePtr + theInterfacePtr->bLength, parsedLength, totalLength);
                     break;
 				case USBAUDIO_0200::DECODER:
 					UInt32		bmAC3BSID;
@@ -5034,11 +6358,13 @@ USBInterfaceDescriptorPtr AUAStreamDictionary::parseASInterfaceDescriptor_0200 (
 					UInt8		bDecoder;
 					
                     debugIOLog ("? AUAStreamDictionary[%p]::parseASInterfaceDescriptor_0200 () - @ DECODER", this);
+                    RejectIfShorterThan (kMinCodecLength_0200, Exit);
 					bDecoder = ((USBAUDIO_0200::ASDecoderDescriptorPtr)theInterfacePtr)->bDecoder;
 					switch (bDecoder) 
 					{
 						case USBAUDIO_0200::MPEG_DECODER:
 							debugIOLog ("? AUAStreamDictionary[%p]::parseASInterfaceDescriptor_0200 () - @ MPEG (4.9.5.1)", this);
+							RejectIfShorterThan (kMinMPEGDecoderLength_0200, Exit);
 							bmMPEGCapabilities = USBToHostWord(
 												((USBAUDIO_0200::ASMPEGDecoderDescriptorPtr)theInterfacePtr)->bmMPEGCapabilities[1] << 8 |
 												((USBAUDIO_0200::ASMPEGDecoderDescriptorPtr)theInterfacePtr)->bmMPEGCapabilities[0]);
@@ -5047,6 +6373,7 @@ USBInterfaceDescriptorPtr AUAStreamDictionary::parseASInterfaceDescriptor_0200 (
 							break;
 						case USBAUDIO_0200::AC3_DECODER:
 							debugIOLog ("? AUAStreamDictionary[%p]::parseASInterfaceDescriptor_0200 () - @ AC3 (4.9.5.2)", this);
+							RejectIfShorterThan (kMinAC3DecoderLength_0200, Exit);
 							bmAC3BSID = USBToHostLong(
 										((USBAUDIO_0200::ASAC3DecoderDescriptorPtr)theInterfacePtr)->bmBSID[3] << 24 |
 										((USBAUDIO_0200::ASAC3DecoderDescriptorPtr)theInterfacePtr)->bmBSID[2] << 16 |
@@ -5059,13 +6386,11 @@ USBInterfaceDescriptorPtr AUAStreamDictionary::parseASInterfaceDescriptor_0200 (
 							debugIOLog ("! AUAStreamDictionary[%p]::parseASInterfaceDescriptor_0200 () - @ Unknown/unsupported decoder type 0x%x", this, bDecoder);
 							break;
 					}
-                    theInterfacePtr = (USBInterfaceDescriptorPtr)((UInt8 *)theInterfacePtr + theInterfacePtr->bLength);
-					* parsedLength = ( theInterfacePtr ? ( * parsedLength + theInterfacePtr->bLength ) : totalLength );
+                    theInterfacePtr = nextDescriptor ((UInt8 *)theInterfacePtr + theInterfacePtr->bLength, parsedLength, totalLength);
                     break;
                 default:
                     debugIOLog ("? AUAStreamDictionary[%p]::parseASInterfaceDescriptor_0200 () - @ Default", this);
-                    theInterfacePtr = (USBInterfaceDescriptorPtr)((UInt8 *)theInterfacePtr + theInterfacePtr->bLength);
-					* parsedLength = ( theInterfacePtr ? ( * parsedLength + theInterfacePtr->bLength ) : totalLength );
+                    theInterfacePtr = nextDescriptor ((UInt8 *)theInterfacePtr + theInterfacePtr->bLength, parsedLength, totalLength);
             }
         } 
 		else 
@@ -5079,18 +6404,14 @@ USBInterfaceDescriptorPtr AUAStreamDictionary::parseASInterfaceDescriptor_0200 (
                     done = true;
                     break;
                 case ENDPOINT:
-					UInt16 maxPacketSize;	// <rdar://problem/6789044>
-					UInt16 numTransactions;	// <rdar://problem/6789044>
-					
                     debugIOLog ("? AUAStreamDictionary[%p]::parseASInterfaceDescriptor_0200 () - @ ENDPOINT (4.10.1.1)", this);
+                    RejectIfShorterThan (kMinEndpointLength, Exit);
                     FailIf (NULL == (thisEndpoint = AUAEndpointDictionary::create ()), Exit);
 
 					thisEndpoint->setAddress (((USBAUDIO_0200::USBEndpointDescriptorPtr)theInterfacePtr)->bEndpointAddress);
                     thisEndpoint->setAttributes (((USBAUDIO_0200::USBEndpointDescriptorPtr)theInterfacePtr)->bmAttributes);
-					// <rdar://problem/6789044>
-					maxPacketSize = ((USBAUDIO_0200::USBEndpointDescriptorPtr)theInterfacePtr)->wMaxPacketSize;
-					numTransactions = ((maxPacketSize & kTransactionsPerMicroframe_Mask) >> 11) + 1;
-                    thisEndpoint->setMaxPacketSize (USBToHostWord ((maxPacketSize & kMaxPacketSize_Mask) * numTransactions));	// (Bits 10..0 of wMaxPacketSize) * (number of transactions per microframe)
+					// <rdar://problem/6789044> (Bits 10..0 of wMaxPacketSize) * (number of transactions per microframe)
+					thisEndpoint->setMaxPacketSizeFromDescriptor (USBToHostWord (((USBAUDIO_0200::USBEndpointDescriptorPtr)theInterfacePtr)->wMaxPacketSize));
 					thisEndpoint->setInterval (((USBAUDIO_0200::USBEndpointDescriptorPtr)theInterfacePtr)->bInterval);
 					
 					endpoints = getEndpoints ();
@@ -5127,14 +6448,15 @@ USBInterfaceDescriptorPtr AUAStreamDictionary::parseASInterfaceDescriptor_0200 (
 					thisEndpoint->release ();
 					thisEndpoint = NULL;
 					
-                    theInterfacePtr = (USBInterfaceDescriptorPtr)((UInt8 *)theInterfacePtr + theInterfacePtr->bLength);
-					* parsedLength = ( theInterfacePtr ? ( * parsedLength + theInterfacePtr->bLength ) : totalLength );
+                    theInterfacePtr = nextDescriptor ((UInt8 *)theInterfacePtr + theInterfacePtr->bLength, parsedLength, totalLength);
                     break;
                 case CS_ENDPOINT:
                     debugIOLog ("? AUAStreamDictionary[%p]::parseASInterfaceDescriptor_0200 () - @ CS_ENDPOINT (4.10.1.2)", this);
+                    RejectIfShorterThan (kMinCSDescriptorLength, Exit);
                     if (EP_GENERAL == ((ASEndpointDescriptorPtr)theInterfacePtr)->bDescriptorSubtype) 
 					{
                         debugIOLog ("? AUAStreamDictionary[%p]::parseASInterfaceDescriptor_0200 () - @ EP_GENERAL", this);
+                        RejectIfShorterThan (kMinASEndpointLength_0200, Exit);
                         asIsocEndpoint = new AUAASEndpointDictionary (0,
 						                                              (((USBAUDIO_0200::ASEndpointDescriptorPtr)theInterfacePtr)->bmControls & 0x3) == 0x3,
                                                                       ((USBAUDIO_0200::ASEndpointDescriptorPtr)theInterfacePtr)->bmAttributes & (1 << maxPacketsOnlyBit),
@@ -5144,18 +6466,18 @@ USBInterfaceDescriptorPtr AUAStreamDictionary::parseASInterfaceDescriptor_0200 (
 						FailIf (kIOReturnSuccess != setDictionaryObjectAndRelease (kASIsocEndpoint, asIsocEndpoint), Exit);
 						asIsocEndpoint = NULL;
                     }
-                    theInterfacePtr = (USBInterfaceDescriptorPtr)((UInt8 *)theInterfacePtr + theInterfacePtr->bLength);
-					* parsedLength = ( theInterfacePtr ? ( * parsedLength + theInterfacePtr->bLength ) : totalLength );
+                    theInterfacePtr = nextDescriptor ((UInt8 *)theInterfacePtr + theInterfacePtr->bLength, parsedLength, totalLength);
                     break;
                 default:
                     debugIOLog ("? AUAStreamDictionary[%p]::parseASInterfaceDescriptor_0200 () - @ Default (else)", this);
-                    theInterfacePtr = (USBInterfaceDescriptorPtr)((UInt8 *)theInterfacePtr + theInterfacePtr->bLength);
-					* parsedLength = ( theInterfacePtr ? ( * parsedLength + theInterfacePtr->bLength ) : totalLength );
+                    theInterfacePtr = nextDescriptor ((UInt8 *)theInterfacePtr + theInterfacePtr->bLength, parsedLength, totalLength);
             }
         }
     }
 
 Exit:
+	RELEASE_IF_NOT_NULL (thisEndpoint);
+	RELEASE_IF_NOT_NULL (asIsocEndpoint);
 	debugIOLog ("- AUAStreamDictionary[%p]::parseASInterfaceDescriptor_0200 () = 0x%x", this, theInterfacePtr);
     return theInterfacePtr;
 }
@@ -5191,101 +6513,220 @@ Exit:
 	return result;
 }
 
-IOReturn AUAStreamDictionary::addSampleRatesToStreamDictionary ( OSArray * sampleRates )
+// Appends a range to kSampleRateRanges as a min, max pair, and its step to kSampleRateRangeResolutions.
+IOReturn AUAStreamDictionary::addSampleRateRange (UInt32 minRate, UInt32 maxRate, UInt32 resolution)
 {
+	OSArray *		sampleRateRanges = NULL;
+	OSArray *		resolutions = NULL;
+	OSNumber *		bounds[3] = { NULL, NULL, NULL };
 	IOReturn		result = kIOReturnError;
-	OSArray *		existingSampleRates = NULL;
-	OSNumber *		sampleRateNumber = NULL;
-	OSNumber *		existingSampleRateNumber = NULL;
-	UInt8			numSampleFreqs = 0;
-	bool			isDuplicate;
 	
-	FailIf ( NULL == sampleRates, Exit );
-	existingSampleRates = getSampleRates ();
+	FailIf (0 == resolution, Exit);
+	FailIf (NULL == (bounds[0] = OSNumber::withNumber (minRate, SIZEINBITS(UInt32))), Exit);
+	FailIf (NULL == (bounds[1] = OSNumber::withNumber (maxRate, SIZEINBITS(UInt32))), Exit);
+	FailIf (NULL == (bounds[2] = OSNumber::withNumber (resolution, SIZEINBITS(UInt32))), Exit);
+	resolutions = getDictionaryArray (kSampleRateRangeResolutions);
+	if (NULL == resolutions)
+	{
+		FailIf (NULL == (resolutions = OSArray::withObjects ((const OSObject **)&bounds[2], 1)), Exit);
+		FailIf (kIOReturnSuccess != (result = setDictionaryObjectAndRelease (kSampleRateRangeResolutions, resolutions)), Exit);
+		resolutions = NULL;
+	}
+	else
+	{
+		FailIf (false == resolutions->setObject (bounds[2]), Exit);
+	}
+	sampleRateRanges = getSampleRateRanges ();
+	if (NULL == sampleRateRanges)
+	{
+		FailIf (NULL == (sampleRateRanges = OSArray::withObjects ((const OSObject **)bounds, 2)), Exit);
+		FailIf (kIOReturnSuccess != (result = setDictionaryObjectAndRelease (kSampleRateRanges, sampleRateRanges)), Exit);
+		sampleRateRanges = NULL;
+	}
+	else
+	{
+		FailIf (false == sampleRateRanges->setObject (bounds[0]), Exit);
+		FailIf (false == sampleRateRanges->setObject (bounds[1]), Exit);
+	}
+	result = kIOReturnSuccess;
 	
-	for ( UInt16 sampleRateIndex = 0; sampleRateIndex < sampleRates->getCount (); sampleRateIndex++ )
+Exit:
+	for (UInt32 boundIndex = 0; boundIndex < 3; boundIndex++)
 	{
-		FailIf ( NULL == ( sampleRateNumber = OSDynamicCast ( OSNumber, sampleRates->getObject ( sampleRateIndex ) ) ), Exit );
+		if (NULL != bounds[boundIndex])
+		{
+			bounds[boundIndex]->release ();
+		}
+	}
+	return result;
+}
 
-		isDuplicate = false;
+// Reads the rangeIndex'th kSampleRateRanges pair and its step. Ranges added before the step was kept have none, and are continuous.
+IOReturn AUAStreamDictionary::getSampleRateRange (UInt32 * minRate, UInt32 * maxRate, UInt32 * resolution, UInt32 rangeIndex)
+{
+	OSArray *		sampleRateRanges = NULL;
+	OSArray *		resolutions = NULL;
+	OSNumber *		number = NULL;
+	IOReturn		result = kIOReturnError;
+	
+	FailIf (NULL == minRate || NULL == maxRate || NULL == resolution, Exit);
+	FailIf (NULL == (sampleRateRanges = getSampleRateRanges ()), Exit);
+	FailIf (2 * rangeIndex + 1 >= sampleRateRanges->getCount (), Exit);
+	FailIf (NULL == (number = OSDynamicCast (OSNumber, sampleRateRanges->getObject (2 * rangeIndex))), Exit);
+	*minRate = number->unsigned32BitValue ();
+	FailIf (NULL == (number = OSDynamicCast (OSNumber, sampleRateRanges->getObject (2 * rangeIndex + 1))), Exit);
+	*maxRate = number->unsigned32BitValue ();
+	*resolution = 1;
+	if	(		(NULL != (resolutions = getDictionaryArray (kSampleRateRangeResolutions)))
+			&&	(NULL != (number = OSDynamicCast (OSNumber, resolutions->getObject (rangeIndex))))
+			&&	(0 != number->unsigned32BitValue ()))
+	{
+		*resolution = number->unsigned32BitValue ();
+	}
+	result = kIOReturnSuccess;
+	
+Exit:
+	return result;
+}
+
+IOReturn AUAStreamDictionary::addSampleRatesToStreamDictionary ( const AUASampleRateRanges * sampleRateRanges )
+{
+	IOReturn						result = kIOReturnError;
+	OSArray *						existingSampleRates = NULL;
+	OSNumber *						existingSampleRateNumber = NULL;
+	AUASampleRateRanges				knownSampleRates = { 0, 0, NULL, NULL };
+	OSArray *						endpoints = NULL;
+	AUAEndpointDictionary *			endpoint = NULL;
+	const SubRange32 *				range;
+	UInt64							numSteps;
+	UInt64							maxCarriedRate;
+	UInt32							maxPacketRate = 0xFFFFFFFF;
+	UInt32							sampleRate;
+	UInt32							minRate;
+	UInt32							maxRate;
+	UInt32							resolution;
+	UInt32							bytesPerSampleFrame;
+	UInt16							maxPacketSize;
+	UInt8							interval;
+	UInt8							transactionsPerUSBFrame = 1;
+	UInt8							direction;
+	UInt8							numChannels;
+	UInt8							bitResolution;
+	UInt8							numSampleFreqs = 0;
+	bool							found = false;
+	
+	FailIf ( NULL == sampleRateRanges, Exit );
+	saveParsedSampleRates ();
+
+	// Rates and ranges already published, so that duplicates are caught with a binary search.
+	existingSampleRates = getSampleRates ();
+	if ( existingSampleRates )
+	{
+		for ( UInt32 rateIndex = 0; rateIndex < existingSampleRates->getCount (); rateIndex++ )
+		{
+			FailIf ( NULL == ( existingSampleRateNumber = OSDynamicCast ( OSNumber, existingSampleRates->getObject ( rateIndex ) ) ), Exit );
+			FailIf ( kIOReturnSuccess != AUASampleRateRangesAdd ( &knownSampleRates, existingSampleRateNumber->unsigned32BitValue (), existingSampleRateNumber->unsigned32BitValue (), 0 ), Exit );
+		}
+	}
+	existingSampleRates = getSampleRateRanges ();
+	if ( existingSampleRates )
+	{
+		for ( UInt32 rateIndex = 0; rateIndex + 1 < existingSampleRates->getCount (); rateIndex += 2 )
+		{
+			FailIf ( kIOReturnSuccess != getSampleRateRange ( &minRate, &maxRate, &resolution, rateIndex / 2 ), Exit );
+			FailIf ( kIOReturnSuccess != AUASampleRateRangesAdd ( &knownSampleRates, minRate, maxRate, resolution ), Exit );
+		}
+	}
 
-		if ( existingSampleRates )
+	if ( 0 != sampleRateRanges->numRanges )
+	{
+		//[rdar://4801012] Only add the sample rate if the average frame size doesn't exceed the max packet size
+		// We can cheat to get the isoc endpoint in UAC2.0
+		FailIf ( NULL == ( endpoints = getEndpoints() ), Exit );
+		for ( UInt8 endpointIndex = 0; endpointIndex < endpoints->getCount (); endpointIndex++ )
 		{
-			// Check to make sure we aren't adding a duplicate
-			for ( UInt16 rateIndex= 0; rateIndex < existingSampleRates->getCount (); rateIndex++ )
+			FailIf ( NULL == ( endpoint = OSDynamicCast ( AUAEndpointDictionary, endpoints->getObject ( endpointIndex ) ) ), Exit );
+			if ( endpoint->isIsocStreaming () )
 			{
-				FailIf ( NULL == ( existingSampleRateNumber = OSDynamicCast ( OSNumber, existingSampleRates->getObject ( rateIndex ) ) ), Exit );
-				if ( existingSampleRateNumber->isEqualTo ( sampleRateNumber ) )
-				{
-					isDuplicate = true;
-					break;
-				}
+				found = true;
+				FailIf ( kIOReturnSuccess != endpoint->getDirection ( &direction ), Exit );
+				break;
 			}
 		}
 		
-		if ( ! isDuplicate )
+		FailIf ( true != found, Exit );
+		FailIf ( kIOReturnSuccess != getIsocEndpointMaxPacketSize ( &maxPacketSize, direction ), Exit );
+		FailIf ( kIOReturnSuccess != getNumChannels( &numChannels ), Exit );
+		FailIf ( kIOReturnSuccess != getBitResolution( &bitResolution ), Exit );
+						
+		// Must determine the number of transfer opportunities per millisecond.
+		FailIf ( kIOReturnSuccess != getIsocEndpointInterval ( &interval, direction ), Exit );
+		if ( 0 == interval )
+		{
+			debugIOLog ( "! AUAStreamDictionary[%p]::addSampleRatesToStreamDictionary () - ERROR! Isoc endpoint has a refresh interval of 0! Treating as 4 ...", this );
+			transactionsPerUSBFrame = 1;
+		}
+		else
+		{
+			FailIf ( interval > 4, Exit );
+			transactionsPerUSBFrame = 8 >> ( interval - 1 );
+		}
+
+		// The highest rate whose average packet still fits in the endpoint's max packet size.
+		bytesPerSampleFrame = numChannels * ( bitResolution / 8 );
+		if ( 0 != bytesPerSampleFrame )
+		{
+			maxCarriedRate = ( (UInt64)( maxPacketSize / bytesPerSampleFrame ) + 1 ) * 1000 * transactionsPerUSBFrame - 1;
+			maxPacketRate = ( maxCarriedRate > 0xFFFFFFFFull ) ? 0xFFFFFFFF : (UInt32)maxCarriedRate;
+		}
+	}
+
+	for ( UInt32 rangeIndex = 0; rangeIndex < sampleRateRanges->numRanges; rangeIndex++ )
+	{
+		range = &sampleRateRanges->ranges[rangeIndex];
+		numSteps = ( 0 == range->dRES ) ? ( ( range->dMIN == range->dMAX ) ? 0 : 1 ) : ( ( range->dMAX - range->dMIN ) / range->dRES );
+		
+		if ( numSteps > kAUAMaxExpandedRangeSteps )
 		{
-			if ( sampleRateNumber->unsigned32BitValue () )
+			// Too many steps to publish rate by rate, so publish the part of the grid the endpoint can carry as one range. Only a
+			// step of 1 makes it continuous; any other range keeps its step so that rates between the steps are still refused.
+			minRate = ( 0 == range->dMIN ) ? range->dRES : range->dMIN;
+			maxRate = ( range->dMAX <= maxPacketRate ) ? range->dMAX : range->dMIN + ( ( maxPacketRate - range->dMIN ) / range->dRES ) * range->dRES;
+			if ( ( maxPacketRate < minRate ) || ( maxRate < minRate ) )
 			{
-				OSArray *						endpoints = NULL;
-				AUAEndpointDictionary *			endpoint = NULL;
-				UInt32							averageFrameSamples;
-				UInt16							averageFrameSize;
-				UInt16							maxPacketSize;
-				UInt8							interval;
-				UInt8							transactionsPerUSBFrame;
-				UInt8							direction;
-				UInt8							numChannels;
-				UInt8							bitResolution;
-				bool							found = false;
-
-				//[rdar://4801012] Only add the sample rate if the average frame size doesn't exceed the max packet size
-				// We can cheat to get the isoc endpoint in UAC2.0
-				FailIf ( NULL == ( endpoints = getEndpoints() ), Exit );
-				for ( UInt8 endpointIndex = 0; endpointIndex < endpoints->getCount (); endpointIndex++ )
-				{
-					FailIf ( NULL == ( endpoint = OSDynamicCast ( AUAEndpointDictionary, endpoints->getObject ( endpointIndex ) ) ), Exit );
-					if ( endpoint->isIsocStreaming () )
-					{
-						found = true;
-						FailIf ( kIOReturnSuccess != endpoint->getDirection ( &direction ), Exit );
-						break;
-					}
-				}
-				
-				FailIf ( true != found, Exit );
-				FailIf ( kIOReturnSuccess != getIsocEndpointMaxPacketSize ( &maxPacketSize, direction ), Exit );
-				FailIf ( kIOReturnSuccess != getNumChannels( &numChannels ), Exit );
-				FailIf ( kIOReturnSuccess != getBitResolution( &bitResolution ), Exit );
-								
-				// Must determine the number of transfer opportunities per millisecond.
-				FailIf ( kIOReturnSuccess != getIsocEndpointInterval ( &interval, direction ), Exit );
-				if ( 0 == interval )
-				{
-					debugIOLog ( "! AUAStreamDictionary[%p]::addSampleRatesToStreamDictionary () - ERROR! Isoc endpoint has a refresh interval of 0! Treating as 4 ...", this );
-					transactionsPerUSBFrame = 1;
-				}
-				else
-				{
-					FailIf ( interval > 4, Exit );
-					transactionsPerUSBFrame = 8 >> ( interval - 1 );
-				}
-				
-				averageFrameSamples = sampleRateNumber->unsigned32BitValue() / ( 1000 * transactionsPerUSBFrame );
-				averageFrameSize = ( averageFrameSamples * numChannels * ( bitResolution / 8 ) );
-				
-				// Continue the loop if this alternate setting can't add this sample rate
-				if ( averageFrameSize > maxPacketSize )
-				{
-					debugIOLog ( "! AUAStreamDictionary::addSampleRatesToStreamDictionary () - cannot add sample rate %lu due to packet size constraints!", sampleRateNumber->unsigned32BitValue () );
-					continue;
-				}
-				else
-				{
-					debugIOLog ( "? AUAStreamDictionary::addSampleRatesToStreamDictionary () - adding sample rate %lu", sampleRateNumber->unsigned32BitValue () );
-					FailIf ( kIOReturnSuccess != addSampleRate ( sampleRateNumber->unsigned32BitValue () ), Exit );
-				}
+				debugIOLog ( "! AUAStreamDictionary::addSampleRatesToStreamDictionary () - cannot add sample rates %lu to %lu due to packet size constraints!", range->dMIN, range->dMAX );
+				continue;
+			}
+			if	(		AUASampleRateRangesContain ( &knownSampleRates, minRate )
+					&&	AUASampleRateRangesContain ( &knownSampleRates, maxRate )
+					&&	AUASampleRateRangesContain ( &knownSampleRates, minRate + range->dRES ) )
+			{
+				continue;
+			}
+			debugIOLog ( "? AUAStreamDictionary::addSampleRatesToStreamDictionary () - adding sample rates %lu to %lu step %lu", minRate, maxRate, range->dRES );
+			FailIf ( kIOReturnSuccess != addSampleRateRange ( minRate, maxRate, range->dRES ), Exit );
+			FailIf ( kIOReturnSuccess != AUASampleRateRangesAdd ( &knownSampleRates, minRate, maxRate, range->dRES ), Exit );
+			continue;
+		}
+
+		// Coarse grids and discrete rates are published one rate at a time.
+		for ( UInt64 step = 0; step <= numSteps; step++ )
+		{
+			sampleRate = ( 0 == range->dRES ) ? ( ( 0 == step ) ? range->dMIN : range->dMAX ) : (UInt32)( range->dMIN + step * range->dRES );
+			if ( ( 0 == sampleRate ) || AUASampleRateRangesContain ( &knownSampleRates, sampleRate ) )
+			{
+				continue;
+			}
+			
+			// Continue the loop if this alternate setting can't add this sample rate
+			if ( sampleRate > maxPacketRate )
+			{
+				debugIOLog ( "! AUAStreamDictionary::addSampleRatesToStreamDictionary () - cannot add sample rate %lu due to packet size constraints!", sampleRate );
+				continue;
 			}
+			debugIOLog ( "? AUAStreamDictionary::addSampleRatesToStreamDictionary () - adding sample rate %lu", sampleRate );
+			FailIf ( kIOReturnSuccess != addSampleRate ( sampleRate ), Exit );
+			FailIf ( kIOReturnSuccess != AUASampleRateRangesAdd ( &knownSampleRates, sampleRate, sampleRate, 0 ), Exit );
 		}
 	}
 	
@@ -5296,11 +6737,13 @@ IOReturn AUAStreamDictionary::addSampleRatesToStreamDictionary ( OSArray * sampl
 		numSampleFreqs = existingSampleRates->getCount();	
 	}
 	
+	// Only the discrete rates are counted; the continuous ranges are under kSampleRateRanges.
 	FailIf (kIOReturnSuccess != setDictionaryValue (kNumSampleRates, numSampleFreqs), Exit);
 	
 	result = kIOReturnSuccess;
 
 Exit:
+	AUASampleRateRangesFree ( &knownSampleRates );
 	return result;
 }
 
@@ -5491,6 +6934,31 @@ Exit:
 	return result;
 }
 
+// wMaxPacketSize must already be in host byte order. Bits 10..0 are the payload of a single transaction and bits 12..11 the
+// number of additional transactions per microframe for a high-bandwidth endpoint, so the stored maximum packet size is the
+// total number of bytes the endpoint can move in one (micro)frame.
+IOReturn AUAEndpointDictionary::setMaxPacketSizeFromDescriptor (UInt16 wMaxPacketSize)
+{
+	IOReturn		result = kIOReturnError;
+	UInt16			payloadSize;
+	UInt8			transactions;
+
+	payloadSize = wMaxPacketSize & kMaxPacketSize_Mask;
+	transactions = ( ( wMaxPacketSize & kTransactionsPerMicroframe_Mask ) >> 11 ) + 1;
+	if ( transactions > 3 )
+	{
+		// 0b11 is reserved; don't trust the endpoint for more than one transaction.
+		debugIOLog ( "! AUAEndpointDictionary[%p]::setMaxPacketSizeFromDescriptor (0x%x) - reserved transaction count, treating as 1", this, wMaxPacketSize );
+		transactions = 1;
+	}
+
+	FailIf ( kIOReturnSuccess != ( result = setTransactionsPerMicroframe ( transactions ) ), Exit );
+	result = setMaxPacketSize ( payloadSize * transactions );
+
+Exit:
+	return result;
+}
+
 // For USB 2.0 Audio Class
 
 bool AUAEndpointDictionary::isIsocStreaming ()
@@ -557,12 +557,55 @@ enum {
 #define USB_AUDIO_IS_TERMINAL(subtype)			((subtype == INPUT_TERMINAL) || (subtype == OUTPUT_TERMINAL))
 #define	ERROR_IF_FALSE(condition)				((condition) ? kIOReturnSuccess : kIOReturnError)
 #define RELEASE_IF_FALSE(ptr, condition)		do {if (false == (condition)) {(ptr)->release(); (ptr) = NULL;}} while (0)
+#define RELEASE_IF_NOT_NULL(ptr)				do {if (NULL != (ptr)) {(ptr)->release(); (ptr) = NULL;}} while (0)
 
 #pragma mark Constants
 
 #define kAUAUSBSpec1_0				0x0100
 #define kAUAUSBSpec2_0				0x0200
 #define kBytesPerSampleFrequency	3
+// Smallest descriptors the configuration parser will read fields from. Descriptors with pins, controls or sample rates
+// must also be long enough for the counts they declare.
+#define kMinDescriptorLength				2			// through bDescriptorType
+#define kMinCSDescriptorLength				3			// through bDescriptorSubtype
+#define kMinEndpointLength					7			// through bInterval
+#define kMinAudioEndpointLength_0100		9			// through bSynchAddress
+#define kMinACHeaderLength_0100				7			// through wTotalLength
+#define kMinACHeaderLength_0200				8			// through wTotalLength
+#define kMinACHeaderCollectionLength_0100	8			// through bInCollection, then one byte per interface
+#define kMinInputTerminalLength_0100		12			// through iTerminal
+#define kMinOutputTerminalLength_0100		9			// through iTerminal
+#define kMinFeatureUnitLength_0100			7			// through bControlSize, and iFeature
+#define kMinMixerUnitLength_0100			10			// through iChannelNames and iMixer, plus bNrInPins
+#define kMinSelectorUnitLength_0100			5			// through bNrInPins, plus bNrInPins
+#define kMinProcessingUnitLength_0100		12			// through bControlSize, plus bNrInPins and bControlSize
+#define kMinExtensionUnitLength_0100		11			// through iChannelNames, plus bNrInPins
+#define kMinInputTerminalLength_0200		17			// through iTerminal
+#define kMinOutputTerminalLength_0200		12			// through iTerminal
+#define kMinFeatureUnitLength_0200			6			// through bSourceID, and iFeature
+#define kMinMixerUnitLength_0200			13			// through iChannelNames, bmControls and iMixer, plus bNrInPins
+#define kMinSelectorUnitLength_0200			5			// through bNrInPins, plus bNrInPins
+#define kMinEffectUnitLength_0200			8			// through bSourceID, and iEffects
+#define kMinProcessingUnitLength_0200		15			// through bmControls, plus bNrInPins
+#define kMinExtensionUnitLength_0200		14			// through bmControls, plus bNrInPins
+#define kMinClockSourceLength_0200			8			// through iClockSource
+#define kMinClockSelectorLength_0200		6			// through bmControls, plus bNrInPins
+#define kMinClockMultiplierLength_0200		7			// through iClockMultiplier
+#define kMinASGeneralLength_0100			7			// through wFormatTag
+#define kMinFormatTypeLength				4			// through bFormatType
+#define kMinFormatTypeILength_0100			8			// through bSamFreqType, plus the sample rates
+#define kMinFormatTypeIILength_0100			9			// through bSamFreqType, plus the sample rates
+#define kMinFormatSpecificLength_0100		5			// through wFormatTag
+#define kMinMPEGFormatLength_0100			8			// through bmMPEGFeatures
+#define kMinAC3FormatLength_0100			10			// through bmAC3Features
+#define kMinASEndpointLength_0100			7			// through wLockDelay
+#define kMinASGeneralLength_0200			11			// through bNrChannels
+#define kMinFormatTypeILength_0200			6			// through bBitResolution
+#define kMinFormatTypeIILength_0200			8			// through wSlotsPerFrame
+#define kMinCodecLength_0200				5			// through bEncoder or bDecoder
+#define kMinMPEGDecoderLength_0200			8			// through bmMPEGFeatures
+#define kMinAC3DecoderLength_0200			10			// through bmAC3Features
+#define kMinASEndpointLength_0200			8			// through wLockDelay
 
 #pragma mark DictionaryKeys
 
@@ -612,6 +655,7 @@ enum {
 #define	kSynchAddress				"SynchAddress"
 #define kSyncType					"SyncType"
 #define kRefreshInt					"RefreshInt"
+#define kTransactionsPerMicroframe	"TransactionsPerMicroframe"
 
 // AUAInputTerminalDictionary + AUAOutputTerminalDictionary
 #define kAssocTerminal				"AssocTerminal"
@@ -638,6 +682,8 @@ enum {
 #define	kSubframeSize				"SubframeSize"
 #define	kBitResolution				"BitResolution"
 #define kSampleRates				"SampleRates"
+#define kSampleRateRanges			"SampleRateRanges"			// ranges from the clock path, as min, max pairs
+#define kSampleRateRangeResolutions	"SampleRateRangeResolutions"	// step of each kSampleRateRanges pair; 1 is continuous
 #define	kMaxBitRate					"MaxBitRate"
 #define kSamplesPerFrame			"kSamplesPerFrame"
 #define kMPEGCapabilities			"MPEGCapabilities"
@@ -1280,6 +1326,23 @@ typedef struct SubRange32 {
 	UInt32									dRES;
 } SubRange32, *SubRange32Ptr;
 
+// Sample rates kept as the (dMIN, dMAX, dRES) ranges a clock source reports instead of one OSNumber per rate. Ranges are sorted by
+// dMIN; a dRES of 0 means the range holds dMIN and dMAX only. Zero-initialize before the first add and free after the last use.
+typedef struct AUASampleRateRanges {
+	UInt32									numRanges;
+	UInt32									capacity;
+	SubRange32 *							ranges;
+	UInt32 *								coverMax;				// coverMax[n] is the largest dMAX of ranges[0] through ranges[n]
+} AUASampleRateRanges;
+
+// A clock source range with more steps than this is kept as a range rather than one rate per step. Only a range with a step of 1 is
+// continuous; any other keeps its step, and only the rates on it are accepted.
+#define kAUAMaxExpandedRangeSteps				32
+
+IOReturn	AUASampleRateRangesAdd (AUASampleRateRanges * list, UInt32 minRate, UInt32 maxRate, UInt32 resolution);
+bool		AUASampleRateRangesContain (const AUASampleRateRanges * list, UInt32 sampleRate);
+void		AUASampleRateRangesFree (AUASampleRateRanges * list);
+
 //	<rdar://6430836>
 typedef struct AudioClusterDescriptor {
 	UInt8									bNrChannels;
@@ -1530,6 +1593,23 @@ public:
 
 class AUAEndpointDictionary;
 
+// Kind of unit recorded in AUAControlDictionary's unitID table.
+enum
+{
+	kAUAUnitTypeNone				= 0,
+	kAUAUnitTypeInputTerminal,
+	kAUAUnitTypeOutputTerminal,
+	kAUAUnitTypeMixerUnit,
+	kAUAUnitTypeSelectorUnit,
+	kAUAUnitTypeFeatureUnit,
+	kAUAUnitTypeEffectUnit,
+	kAUAUnitTypeProcessingUnit,
+	kAUAUnitTypeExtensionUnit,
+	kAUAUnitTypeClockSource,
+	kAUAUnitTypeClockSelector,
+	kAUAUnitTypeClockMultiplier
+};
+
 class AUAControlDictionary : public AppleUSBAudioDictionary 
 {
 	friend class AUAConfigurationDictionary;
@@ -1579,6 +1659,16 @@ private:
 	AUAClockMultiplierDictionary *		getIndexedClockMultiplierDictionary (UInt8 index);
 	AUAUnitDictionary *					getUnitDictionary (UInt8 unitID);
 
+	// Unit IDs are a dense UInt8 space, so once parsing has finished every unit is reachable by direct index. A unit ID claimed by more than
+	// one kind of unit (malformed descriptors) keeps the kind getUnitDictionary () prefers; the per-type getters then fall back to searching.
+	AUAUnitDictionary *					mUnitTable[256];
+	UInt8								mUnitTypeTable[256];
+	bool								mUnitTableBuilt;
+
+	IOReturn							buildUnitTable (void);
+	void								addUnitsToTable (OSArray * units, UInt8 unitType, const OSMetaClass * unitClass);
+	bool								unitTableAnswers (UInt8 unitID, UInt8 unitType) {return mUnitTableBuilt && ((kAUAUnitTypeNone == mUnitTypeTable[unitID]) || (unitType == mUnitTypeTable[unitID]));}
+
     IOReturn					setAlternateSetting (UInt8 alternateSetting) {return setDictionaryValue (kAlternateSetting, alternateSetting);}
     IOReturn					setInterfaceClass (UInt8 interfaceClass) {return setDictionaryValue (kInterfaceClass, interfaceClass);}
     IOReturn					setInterfaceNumber (UInt8 interfaceNumber) {return setDictionaryValue (kInterfaceNumber, interfaceNumber);}
@@ -1590,12 +1680,12 @@ public:
     static AUAControlDictionary *		create (void);
     
 	// [rdar://5346021] Keep strack of the descriptor length to guard against malformed descriptors.
-    USBInterfaceDescriptorPtr	parseACInterfaceDescriptor (USBInterfaceDescriptorPtr theInterfacePtr, UInt8 const currentInterface, UInt16 * parsedLength, UInt16 totalLength);
-    USBInterfaceDescriptorPtr	parseACInterfaceDescriptor_0200 (USBInterfaceDescriptorPtr theInterfacePtr, UInt8 const currentInterface, UInt16 * parsedLength, UInt16 totalLength);
+    USBInterfaceDescriptorPtr	parseACInterfaceDescriptor (USBInterfaceDescriptorPtr theInterfacePtr, UInt8 const currentInterface, UInt32 * parsedLength, UInt16 totalLength);
+    USBInterfaceDescriptorPtr	parseACInterfaceDescriptor_0200 (USBInterfaceDescriptorPtr theInterfacePtr, UInt8 const currentInterface, UInt32 * parsedLength, UInt16 totalLength);
 	void						parseInterfaceAssociationDescriptor (USBInterfaceAssociationDescriptorPtr theInterfaceAssociationPtr);
 
 	// <rdar://problem/6021475> AppleUSBAudio: Status Interrupt Endpoint support
-	USBInterfaceDescriptorPtr	parseACInterruptEndpointDescriptor ( USBInterfaceDescriptorPtr theInterfacePtr );
+	USBInterfaceDescriptorPtr	parseACInterruptEndpointDescriptor ( USBInterfaceDescriptorPtr theInterfacePtr, UInt32 * parsedLength, UInt16 totalLength );
 	IOReturn					getInterruptEndpointAddress ( UInt8 * address );
 	IOReturn					getInterruptEndpointInterval ( UInt8 * interval );
 	bool						hasInterruptEndpoint ( void );
@@ -1676,6 +1766,7 @@ public:
 	IOReturn					getSynchAddress (UInt8 * synchAddress) {return getDictionaryValue (kSynchAddress, synchAddress);}
 	IOReturn					getSyncType (UInt8 * syncType);
 	IOReturn					getRefreshInt (UInt8 * refreshInt) {return getDictionaryValue (kRefreshInt, refreshInt);}
+	IOReturn					getTransactionsPerMicroframe (UInt8 * transactions) {return getDictionaryValue (kTransactionsPerMicroframe, transactions);}
 	
 	bool						isIsocStreaming (void);
 	bool						isIsocFeedback (void);
@@ -1686,6 +1777,9 @@ public:
     IOReturn					setMaxPacketSize (UInt16 maxPacketSize) {return setDictionaryValue (kMaxPacketSize, maxPacketSize);}
     IOReturn					setSynchAddress (UInt8 synchAddress) {return setDictionaryValue (kSynchAddress, synchAddress);}
 	IOReturn					setRefreshInt (UInt8 refreshInt) {return setDictionaryValue (kRefreshInt, refreshInt);}
+	IOReturn					setTransactionsPerMicroframe (UInt8 transactions) {return setDictionaryValue (kTransactionsPerMicroframe, transactions);}
+
+	IOReturn					setMaxPacketSizeFromDescriptor (UInt16 wMaxPacketSize);
 };
 
 class AUAASEndpointDictionary : public AUAEndpointDictionary 
@@ -1745,6 +1839,13 @@ class AUAStreamDictionary : public AppleUSBAudioDictionary
     AUAASEndpointDictionary *		getASIsocEndpointDictionaryByAddress (UInt8 address);
 
 	IOReturn					addSampleRate (UInt32 sampleRate);
+	IOReturn					addSampleRateRange (UInt32 minRate, UInt32 maxRate, UInt32 resolution);
+	void						saveParsedSampleRates (void);
+
+	// What parsing left under kSampleRates, kNumSampleRates, kSampleRateRanges and kSampleRateRangeResolutions, saved before the clock path first adds rates so that
+	// restoreParsedSampleRates () can undo it when the configuration is handed to another device.
+	OSDictionary *				mParsedSampleRates;
+	bool						mParsedSampleRatesSaved;
 		
     IOReturn					setAlternateSetting (UInt8 alternateSetting) {return setDictionaryValue (kAlternateSetting, alternateSetting);}
     IOReturn					setInterfaceClass (UInt8 interfaceClass) {return setDictionaryValue (kInterfaceClass, interfaceClass);}
@@ -1757,10 +1858,11 @@ public:
     static AUAStreamDictionary *		create (void);
 	
 	// [rdar://5346021]	Keep strack of the descriptor length to guard against malformed descriptors.
-    USBInterfaceDescriptorPtr		parseASInterfaceDescriptor (USBInterfaceDescriptorPtr theInterfacePtr, UInt8 const currentInterface, UInt16 * parsedLength, UInt16 totalLength);
-    USBInterfaceDescriptorPtr		parseASInterfaceDescriptor_0200 (USBInterfaceDescriptorPtr theInterfacePtr, UInt8 const currentInterface, UInt16 * parsedLength, UInt16 totalLength);
+    USBInterfaceDescriptorPtr		parseASInterfaceDescriptor (USBInterfaceDescriptorPtr theInterfacePtr, UInt8 const currentInterface, UInt32 * parsedLength, UInt16 totalLength);
+    USBInterfaceDescriptorPtr		parseASInterfaceDescriptor_0200 (USBInterfaceDescriptorPtr theInterfacePtr, UInt8 const currentInterface, UInt32 * parsedLength, UInt16 totalLength);
 
-	IOReturn					addSampleRatesToStreamDictionary ( OSArray * sampleRates );		// [rdar://4867779]
+	IOReturn					addSampleRatesToStreamDictionary ( const AUASampleRateRanges * sampleRateRanges );		// [rdar://4867779]
+	void						restoreParsedSampleRates (void);
 	IOReturn					getAC3BSID (UInt32 * bmAC3BSID) {return getDictionaryValue (kAC3BSID, bmAC3BSID);}
     IOReturn					getAlternateSetting (UInt8 * alternateSetting) {return getDictionaryValue (kAlternateSetting, alternateSetting);}
 	AUAASEndpointDictionary *	getASEndpointDictionary (void);
@@ -1777,6 +1879,7 @@ public:
 	IOReturn					getIsocEndpointDirection (UInt8 * direction, UInt8 index);
 	IOReturn					getIsocEndpointInterval (UInt8 * interval, UInt8 direction);
 	IOReturn					getIsocEndpointMaxPacketSize (UInt16 * maxPacketSize, UInt8 direction);
+	IOReturn					getIsocEndpointTransactionsPerMicroframe (UInt8 * transactions, UInt8 direction);
 	IOReturn					getIsocEndpointSyncType (UInt8 * syncType, UInt8 address);
 	IOReturn					getMaxBitRate (UInt16 * maxBitRate) {return getDictionaryValue (kMaxBitRate, maxBitRate);}
     IOReturn					getNumChannels (UInt8 * numChannels) {return getDictionaryValue (kNumChannels, numChannels);}
@@ -1786,6 +1889,8 @@ public:
     IOReturn					getBitResolution (UInt8 * bitResolution) {return getDictionaryValue (kBitResolution, bitResolution);}
     IOReturn					getSubframeSize (UInt8 * subframeSize) {return getDictionaryValue (kSubframeSize, subframeSize);}
     OSArray *					getSampleRates (void) {return getDictionaryArray (kSampleRates);}
+    OSArray *					getSampleRateRanges (void) {return getDictionaryArray (kSampleRateRanges);}
+	IOReturn					getSampleRateRange (UInt32 * minRate, UInt32 * maxRate, UInt32 * resolution, UInt32 rangeIndex);
     IOReturn					getTerminalLink (UInt8 * terminalLink) {return getDictionaryValue (kTerminalLink, terminalLink);}
 
 	bool						asEndpointHasMaxPacketsOnly (void);
@@ -1793,8 +1898,68 @@ public:
 	IOReturn					asEndpointGetLockDelayUnits (UInt8 * lockDelayUnits);
 	bool						asEndpointHasPitchControl (void);
 	bool						asEndpointHasSampleFreqControl (void);
+
+	virtual void				free (void);
 };
 
+// Parse-once index of the interface dictionaries held by AUAConfigurationDictionary. Records are sorted by (interface, alternate setting) and
+// point at, but don't retain, dictionaries owned by the kControlDictionaries/kStreamDictionaries arrays. The stream format fields are copied
+// out so the hot format getters never touch the OSDictionary tree.
+#define kAUANoInterfaceRecord				0xFFFF
+
+enum
+{
+	kAUARecordHasFormat				= ( 1 << 0 ),
+	kAUARecordHasNumChannels		= ( 1 << 1 ),
+	kAUARecordHasBitResolution		= ( 1 << 2 ),
+	kAUARecordHasSubframeSize		= ( 1 << 3 )
+};
+
+typedef struct _AUAInterfaceRecord
+{
+	AppleUSBAudioDictionary *		dictionary;
+	UInt16							format;
+	UInt8							interfaceNum;
+	UInt8							altSettingID;
+	UInt8							numChannels;
+	UInt8							bitResolution;
+	UInt8							subframeSize;
+	UInt8							validFields;
+} AUAInterfaceRecord;
+
+typedef struct _AUAInterfaceIndex
+{
+	AUAInterfaceRecord *			records;
+	UInt32							numRecords;
+	UInt16							firstRecord[256];				// interface number -> index of its lowest alternate setting, or kAUANoInterfaceRecord
+} AUAInterfaceIndex;
+
+// Parsed configurations are kept for re-enumeration of identical devices (hot-plug, wake, reset recovery).
+#define kConfigurationCacheMaxEntries		8
+
+// Control bounds and clock source sample rate ranges read from the device are kept with its configuration, so they share its cache key
+// (vendor, product, release, descriptor hash and bytes) and outlast re-attach, reset on wake and device recovery. Each attach checks an
+// entry with one GET_CUR before trusting it, and drops it only if that check fails.
+#define kAUAMaxCachedControlRanges			128
+#define kAUAMaxCachedClockSources			8
+
+typedef struct _AUACachedControlRange
+{
+	UInt8							controlSelector;
+	UInt8							unitID;
+	UInt8							channelNum;
+	SInt16							min;
+	SInt16							max;
+	UInt16							resolution;
+	bool							checked;						// current value seen within the bounds since this attach began
+} AUACachedControlRange;
+
+typedef struct _AUACachedClockSourceRanges
+{
+	UInt8							clockSourceID;
+	AUASampleRateRanges				sampleRateRanges;
+} AUACachedClockSourceRanges;
+
 class AUAConfigurationDictionary : public AppleUSBAudioDictionary 
 {
     OSDeclareDefaultStructors (AUAConfigurationDictionary);
@@ -1807,9 +1972,12 @@ class AUAConfigurationDictionary : public AppleUSBAudioDictionary
 
 public:
     static AUAConfigurationDictionary *	create (const IOUSBConfigurationDescriptor * newConfigurationDescriptor, UInt8 controlInterfaceNum);
+    static AUAConfigurationDictionary *	createCached (const IOUSBConfigurationDescriptor * newConfigurationDescriptor, UInt8 controlInterfaceNum, UInt16 vendorID, UInt16 productID, UInt16 deviceRelease);
+	static void							getCacheStatistics (UInt32 * hits, UInt32 * misses, UInt32 * entries);
+	static void							flushCache (void);
     virtual bool						init (const IOUSBConfigurationDescriptor * newConfigurationDescriptor, UInt8 controlInterfaceNum);
 	
-	IOReturn					addSampleRatesToStreamDictionary ( OSArray * sampleRates, UInt8 streamInterface, UInt8 altSetting );	// [rdar://4867779]
+	IOReturn					addSampleRatesToStreamDictionary ( const AUASampleRateRanges * sampleRateRanges, UInt8 streamInterface, UInt8 altSetting );	// [rdar://4867779]
 	bool						alternateSettingZeroCanStream (UInt8 interfaceNum);
 	bool						asEndpointHasMaxPacketsOnly (UInt8 interfaceNum, UInt8 altSettingID);
 	IOReturn					asEndpointGetLockDelay (UInt8 * lockDelay, UInt8 interfaceNum, UInt8 altSettingID);
@@ -1837,6 +2005,7 @@ public:
 	IOReturn					getIsocEndpointAddress (UInt8 * address, UInt8 interfaceNum, UInt8 altSettingID, UInt8 direction);
 	IOReturn					getIsocEndpointDirection (UInt8 * direction, UInt8 interfaceNum, UInt8 altSettingID);
 	IOReturn					getIsocEndpointMaxPacketSize (UInt16 * maxPacketSize, UInt8 interfaceNum, UInt8 altSettingID, UInt8 direction);
+	IOReturn					getIsocEndpointTransactionsPerMicroframe (UInt8 * transactions, UInt8 interfaceNum, UInt8 altSettingID, UInt8 direction);
 	IOReturn					getIsocEndpointSyncType (UInt8 * syncType, UInt8 interfaceNum, UInt8 altSettingID, UInt8 address);
 	IOReturn					getIndexedFeatureUnitID (UInt8 * featureUnitID, UInt8 interfaceNum, UInt8 altSettingID, UInt8 featureUnitIndex);
 	IOReturn					getIndexedMixerUnitID (UInt8 * mixerUnitID, UInt8 interfaceNum, UInt8 altSettingID, UInt8 mixerUnitIndex);
@@ -1868,6 +2037,8 @@ public:
 	IOReturn					getOutputTerminalType (UInt16 * terminalType, UInt8 interfaceNum, UInt8 altSettingID, UInt8 terminalID);
 	IOReturn					getSamplesPerFrame (UInt16 * samplesPerFrame, UInt8 interfaceNum, UInt8 altSettingID);
     OSArray *					getSampleRates (UInt8 interfaceNum, UInt8 altSettingID);
+    OSArray *					getSampleRateRanges (UInt8 interfaceNum, UInt8 altSettingID);
+	IOReturn					getSampleRateRange (UInt32 * minRate, UInt32 * maxRate, UInt32 * resolution, UInt8 interfaceNum, UInt8 altSettingID, UInt32 rangeIndex);
     IOReturn					getBitResolution (UInt8 * sampleSize, UInt8 interfaceNum, UInt8 altSettingID);
 	IOReturn					getSelectorSources (OSArray ** selectorSources, UInt8 interfaceNum, UInt8 altSettingID, UInt8 unitID);
 	IOReturn					getClockSelectorSources (OSArray ** clockSelectorSources, UInt8 interfaceNum, UInt8 altSettingID, UInt8 unitID);
@@ -1894,14 +2065,59 @@ public:
 	bool						clockSourceHasValidityControl (UInt8 interfaceNum, UInt8 altSetting, UInt8 clockSourceID);								// [rdar://7446555]
 
 	bool						hasAudioStreamingInterfaces (void);
+
+	bool						getCachedControlRange (UInt8 controlSelector, UInt8 unitID, UInt8 channelNum, SInt16 * min, SInt16 * max, UInt16 * resolution, bool includeUnchecked = false);
+	void						setCachedControlRangeChecked (UInt8 controlSelector, UInt8 unitID, UInt8 channelNum);
+	void						setCachedControlRange (UInt8 controlSelector, UInt8 unitID, UInt8 channelNum, SInt16 min, SInt16 max, UInt16 resolution);
+	void						invalidateCachedControlRange (UInt8 controlSelector, UInt8 unitID, UInt8 channelNum);
+	IOReturn					getCachedClockSourceRanges (AUASampleRateRanges * sampleRateRanges, UInt8 clockSourceID);
+	void						setCachedClockSourceRanges (const AUASampleRateRanges * sampleRateRanges, UInt8 clockSourceID);
+	void						invalidateCachedClockSourceRanges (UInt8 clockSourceID);
+	void						uncheckCachedRanges (void);
+	void						restoreParsedSampleRates (void);
+
+	virtual void				free (void);
 	
 private:
+	AUAInterfaceIndex				mControlIndex;
+	AUAInterfaceIndex				mStreamIndex;
+	bool							mIndexBuilt;
+
+	// Cache key, only set on dictionaries made by createCached (). The raw descriptor is kept so a hash match is confirmed byte for byte.
+	UInt8 *							mCachedDescriptor;
+	UInt32							mCachedDescriptorHash;
+	UInt16							mCachedDescriptorLength;
+	UInt16							mCachedVendorID;
+	UInt16							mCachedProductID;
+	UInt16							mCachedDeviceRelease;
+	UInt8							mCachedControlInterfaceNum;
+
+	// Device ranges read from this device or an identical one before it; createCached () marks the control ranges unchecked before handing
+	// the dictionary out again. They are guarded by mRangeCacheLock since that device reads and writes them from its workloop, the status interrupt thread and the control
+	// flush thread.
+	IOLock *						mRangeCacheLock;
+	AUACachedControlRange *			mCachedControlRanges;
+	UInt32							mNumCachedControlRanges;
+	AUACachedClockSourceRanges *	mCachedClockSourceRanges;
+	UInt32							mNumCachedClockSourceRanges;
+
+	AUACachedControlRange *			findCachedControlRange (UInt8 controlSelector, UInt8 unitID, UInt8 channelNum);
+	AUACachedClockSourceRanges *	findCachedClockSourceRanges (UInt8 clockSourceID);
+
+	static UInt32					hashDescriptor (const UInt8 * descriptor, UInt16 length);
+	bool							matchesCacheKey (const UInt8 * descriptor, UInt16 length, UInt32 hash, UInt8 controlInterfaceNum, UInt16 vendorID, UInt16 productID, UInt16 deviceRelease);
+
+	IOReturn						buildInterfaceIndex (AUAInterfaceIndex * index, OSArray * dictionaries, bool isStream);
+	void							freeInterfaceIndex (AUAInterfaceIndex * index);
+	AUAInterfaceRecord *			getInterfaceRecord (AUAInterfaceIndex * index, UInt8 interfaceNum, UInt8 altSettingID);
+	AUAInterfaceRecord *			getStreamRecord (UInt8 interfaceNum, UInt8 altSettingID);
+
 	OSArray *						getControlDictionaries (void) {return getDictionaryArray (kControlDictionaries);}
 	AUAControlDictionary *			getControlDictionary (UInt8 interfaceNum, UInt8 altSettingID);
 	OSArray *						getStreamDictionaries (void) {return getDictionaryArray (kStreamDictionaries);}
     AUAStreamDictionary *			getStreamDictionary (UInt8 interfaceNum, UInt8 altSettingID);
     IOReturn						parseConfigurationDescriptor (IOUSBConfigurationDescriptor * configurationDescriptor);
-    USBInterfaceDescriptorPtr		parseInterfaceDescriptor (USBInterfaceDescriptorPtr theInterfacePtr, UInt8 * interfaceClass, UInt8 * interfaceSubClass, UInt8 * interfaceProtocol);
+    USBInterfaceDescriptorPtr		parseInterfaceDescriptor (USBInterfaceDescriptorPtr theInterfacePtr, UInt8 * interfaceClass, UInt8 * interfaceSubClass, UInt8 * interfaceProtocol, UInt32 * parsedLength, UInt16 totalLength);
 	void							dumpConfigMemoryToIOLog (IOUSBConfigurationDescriptor * configurationDescriptor);
 
 };
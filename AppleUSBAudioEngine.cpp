@@ -1679,11 +1679,17 @@ void AppleUSBAudioEngine::pluginSetConfigurationApp (const char * bundleID) {
 
 IOReturn AppleUSBAudioEngine::performAudioEngineStart () {
     IOReturn				resultCode;
+	IOReturn				interimResult;
 	UInt32					usbFramesToDelay = 0;
 	UInt32					lockDelayFrames = 0;
+	UInt32					startDelayFrames;
 	UInt64					currentUSBFrame = 0;
+	UInt64					startUSBFrame;
 	UInt32					streamIndex;
 	AppleUSBAudioStream *	audioStream;
+	#if LIGHTWEIGHTWAKE
+	UInt32					framesPerList;
+	#endif
 	
     debugIOLog ("+ AppleUSBAudioEngine[%p]::performAudioEngineStart ()", this);
 
@@ -1722,15 +1728,27 @@ IOReturn AppleUSBAudioEngine::performAudioEngineStart () {
 		#if DEBUGLATENCY
 			mHaveClipped = false;
 		#endif
+		// Prepare all of the streams at once. Each stream sets its own alternate setting, sampling frequency and pipe policy, so none of these
+		// requests depends on another stream's, and waiting on them one stream at a time only adds up their latencies.
 		for ( streamIndex = 0; streamIndex < mIOAudioStreamArray->getCount (); streamIndex++ )
 		{
-			resultCode = kIOReturnError;
-			
 			audioStream = OSDynamicCast (AppleUSBAudioStream, mIOAudioStreamArray->getObject (streamIndex) );
-			FailIf ( NULL == audioStream, Exit );
-			
-			resultCode = audioStream->prepareUSBStream ();
-			FailIf ( kIOReturnSuccess != resultCode, Exit );
+			if ( NULL != audioStream )
+			{
+				audioStream->beginPrepareUSBStream ();
+			}
+		}
+		
+		// Every stream that was started preparing has to be waited on, even after one has failed, before the streams can be stopped.
+		for ( streamIndex = 0; streamIndex < mIOAudioStreamArray->getCount (); streamIndex++ )
+		{
+			audioStream = OSDynamicCast (AppleUSBAudioStream, mIOAudioStreamArray->getObject (streamIndex) );
+			interimResult = ( NULL == audioStream ) ? kIOReturnError : audioStream->completePrepareUSBStream ();
+			if ( kIOReturnSuccess != interimResult )
+			{
+				resultCode = interimResult;
+				continue;
+			}
 			
 			lockDelayFrames = audioStream->getLockDelayFrames ();
 			if ( usbFramesToDelay < lockDelayFrames )
@@ -1738,10 +1756,33 @@ IOReturn AppleUSBAudioEngine::performAudioEngineStart () {
 				usbFramesToDelay = lockDelayFrames;
 			}
 		}
+		FailIf ( kIOReturnSuccess != resultCode, Exit );
 		
-		currentUSBFrame = mUSBAudioDevice->getUSBFrameNumber ();
-		// Added an offset to compensate for the time needed for some of the operation in AppleUSBAudioStream::startUSBStream();
-		currentUSBFrame += kStartDelayOffset; 
+		// All streams share one start frame. It has to be far enough out that the last stream is queued before it arrives, so once starts
+		// have been timed use a decaying maximum of what they took rather than the fixed kStartDelayOffset guess.
+		startDelayFrames = ( mStartDelayFrames < kStartDelayOffset ) ? kStartDelayOffset : mStartDelayFrames;
+		startUSBFrame = mUSBAudioDevice->getUSBFrameNumber ();
+		currentUSBFrame = startUSBFrame + startDelayFrames;
+		
+		#if LIGHTWEIGHTWAKE
+		if ( mVerifyStartAfterWake )
+		{
+			// A device resumed in place may take the alternate setting and then answer nothing, and output time stamps are taken at the
+			// buffer wrap whether packets got through or not. checkStartAfterWake () wants both by kWakeStartFrameLists frame lists in.
+			framesPerList = 0;
+			for ( streamIndex = 0; streamIndex < mIOAudioStreamArray->getCount (); streamIndex++ )
+			{
+				audioStream = OSDynamicCast (AppleUSBAudioStream, mIOAudioStreamArray->getObject (streamIndex) );
+				if ( ( NULL != audioStream ) && ( audioStream->mNumUSBFramesPerList > framesPerList ) )
+				{
+					framesPerList = audioStream->mNumUSBFramesPerList;
+				}
+			}
+			mWakeStartTimeStamped = false;
+			mWakeStartAnsweredPackets = countAnsweredPackets ();
+			mWakeStartDeadline = currentUSBFrame + usbFramesToDelay + kWakeStartFrameLists * framesPerList;
+		}
+		#endif
 		
 		for ( streamIndex = 0; streamIndex < mIOAudioStreamArray->getCount (); streamIndex++ )
 		{
@@ -1758,17 +1799,48 @@ IOReturn AppleUSBAudioEngine::performAudioEngineStart () {
 
 		if ( kIOReturnSuccess == resultCode )
 		{
+			// One slow start is worth remembering for a while, since missing the start frame costs a whole restart; one fast start isn't.
+			startDelayFrames = (UInt32)( mUSBAudioDevice->getUSBFrameNumber () - startUSBFrame ) + kStartDelayMargin;
+			if ( startDelayFrames < kStartDelayOffset )
+			{
+				startDelayFrames = kStartDelayOffset;
+			}
+			if ( startDelayFrames < mStartDelayFrames )
+			{
+				startDelayFrames = mStartDelayFrames - ( mStartDelayFrames - startDelayFrames + 3 ) / 4;
+			}
+			if ( startDelayFrames > kMaxStartDelayOffset )
+			{
+				startDelayFrames = kMaxStartDelayOffset;
+			}
+			mStartDelayFrames = startDelayFrames;
+			debugIOLog ("? AppleUSBAudioEngine[%p]::performAudioEngineStart () - Started at frame %llu, next start offset %lu frames", this, currentUSBFrame, mStartDelayFrames);
+			
+			#if !PRIMEISOCINPUT
 			if ( 0 != usbFramesToDelay )
 			{
 				// [rdar://5083342] Sleep for the amount of frames delayed.
 				IOSleep ( usbFramesToDelay );
 			}
+			#endif
+			// With PRIMEISOCINPUT, startUSBStream () has already dealt with the lock delay by priming the input pipes and queuing the first
+			// output transfers usbFramesToDelay frames in the future, so there is no need to hold up the caller for it.
 			
 			mUSBStreamRunning = TRUE;
 		}
     }
 	
 Exit:
+	#if LIGHTWEIGHTWAKE
+	if	(		( kIOReturnSuccess != resultCode )
+			&&	( mVerifyStartAfterWake )
+			&&	( NULL != mUSBAudioDevice ) )
+	{
+		mVerifyStartAfterWake = false;
+		mUSBAudioDevice->startFailedAfterWake ( this, resultCode );
+	}
+	#endif
+	
 	if (resultCode != kIOReturnSuccess) 
 	{
 		debugIOLog ("! AppleUSBAudioEngine[%p]::performAudioEngineStart () - NOT started, error = 0x%x", this, resultCode);
@@ -1833,6 +1905,10 @@ IOReturn AppleUSBAudioEngine::performAudioEngineStop() {
    }
 
  	mUSBStreamRunning = FALSE;
+	#if LIGHTWEIGHTWAKE
+	// A start stopped before it streamed proved nothing, so the next one is watched instead.
+	mWakeStartDeadline = 0;
+	#endif
 	
 	if ( NULL != mUSBAudioDevice )								// <rdar://problem/7779397>
 	{
@@ -1921,6 +1997,12 @@ void AppleUSBAudioEngine::takeTimeStamp (bool incrementLoopCount, AbsoluteTime *
 		debugIOLog ("? AppleUSBAudioEngine[%p]::takeTimeStamp (%d, %p) = %llu ns", this, timestamp, time_nanos);
 	}
 	#endif
+	#if LIGHTWEIGHTWAKE
+	if ( 0 != mWakeStartDeadline )
+	{
+		mWakeStartTimeStamped = true;
+	}
+	#endif
 	super::takeTimeStamp (incrementLoopCount, timestamp);
 }
 
@@ -1937,6 +2019,40 @@ bool AppleUSBAudioEngine::willTerminate (IOService * provider, IOOptionBits opti
 	return super::willTerminate (provider, options);
 }
 
+// The device indexes the default controls for status interrupts, so it has to hear about every change to them.
+IOReturn AppleUSBAudioEngine::addDefaultAudioControl ( IOAudioControl * defaultAudioControl )
+{
+	IOReturn	result;
+
+	result = super::addDefaultAudioControl ( defaultAudioControl );
+	if ( NULL != mUSBAudioDevice )
+	{
+		mUSBAudioDevice->audioControlsChanged ();
+	}
+	return result;
+}
+
+IOReturn AppleUSBAudioEngine::removeDefaultAudioControl ( IOAudioControl * defaultAudioControl )
+{
+	IOReturn	result;
+
+	result = super::removeDefaultAudioControl ( defaultAudioControl );
+	if ( NULL != mUSBAudioDevice )
+	{
+		mUSBAudioDevice->audioControlsChanged ();
+	}
+	return result;
+}
+
+void AppleUSBAudioEngine::removeAllDefaultAudioControls ( void )
+{
+	super::removeAllDefaultAudioControls ();
+	if ( NULL != mUSBAudioDevice )
+	{
+		mUSBAudioDevice->audioControlsChanged ();
+	}
+}
+
 // <rdar://problem/6021475> AppleUSBAudio: Status Interrupt Endpoint support
 OSSet * AppleUSBAudioEngine::copyDefaultAudioControls ( void )
 {
@@ -2148,9 +2264,22 @@ IOReturn AppleUSBAudioEngine::doClockSelectorSetup (UInt8 interfaceNum, UInt8 al
 	determineMacSyncMode ( mCurrentClockSourceID );
 	
 	#if POLLCLOCKSTATUS
+	#if EVENTDRIVENCLOCKSTATUS
+	// Poll if at least one of the clock sources is non-programmable. With an interrupt endpoint this is only a fallback for while the
+	// endpoint is failing; pollClockStatus () reads nothing as long as it works.
+	mShouldPollClockStatus = hasNonProgrammableClockSource;
+	mClockStatusPollBaseline = hasNonProgrammableClockSource && ( !configDictionary->hasInterruptEndpoint ( controlInterfaceNum, 0 ) );
+	mClockStatusPollInterval = kClockStatusPollMinInterval / kRefreshInterval;
+	mPollClockStatusCounter = mClockStatusPollInterval - 1;		// poll on the first tick, as before
+	mClockStatusPollTicks = 0;
+	mClockStatusTransfersIssued = 0;
+	mClockStatusPollTransfers = configDictionary->clockSourceHasValidityControl ( controlInterfaceNum, 0, mCurrentClockSourceID ) ? 2 : 1;
+	mLastClockStatusKnown = false;
+	#else
 	// Only poll if there isn't an interrupt endpoint, and at least one of the clock source is non-programmable.
 	mShouldPollClockStatus = hasNonProgrammableClockSource && ( !configDictionary->hasInterruptEndpoint ( controlInterfaceNum, 0 ) );
 	mPollClockStatusCounter = 0;
+	#endif // EVENTDRIVENCLOCKSTATUS
 	debugIOLog ("? AppleUSBAudioEngine[%p]::doClockSelectorSetup( 0x%x, 0x%x, %d ) - Should poll = %d", this, interfaceNum, altSettingNum, sampleRate, mShouldPollClockStatus);
 	#endif // POLLCLOCKSTATUS
 	
@@ -2445,6 +2574,15 @@ void AppleUSBAudioEngine::updateClockStatus ( UInt8 clockID )
 	{
 		if ( kIOReturnSuccess == mUSBAudioDevice->getCurClockSourceSamplingFrequency ( clockID, &clockRate, &clockValidity ) )
 		{
+			#if EVENTDRIVENCLOCKSTATUS
+			if ( !mLastClockStatusKnown || ( clockRate != mLastClockStatusRate ) || ( clockValidity != mLastClockStatusValidity ) )
+			{
+				mClockStatusChanged = true;
+			}
+			mLastClockStatusRate = clockRate;
+			mLastClockStatusValidity = clockValidity;
+			mLastClockStatusKnown = true;
+			#endif
 			if ( NULL != mClockSelectorControl )
 			{
 				if ( !clockValidity )
@@ -2557,6 +2695,142 @@ void AppleUSBAudioEngine::updateClockStatus ( UInt8 clockID )
 	return;
 }
 
+#if EVENTDRIVENCLOCKSTATUS
+// Called every kRefreshInterval ms while the clock status should be polled. Nothing is read while the device's status interrupt
+// endpoint is working. Otherwise the clock is polled, and every poll that finds it unchanged doubles the time
+// to the next one, up to kClockStatusPollMaxInterval.
+void AppleUSBAudioEngine::pollClockStatus ( void )
+{
+	mClockStatusPollTicks++;
+	if ( mUSBAudioDevice->clockStatusInterruptsConfirmed () )
+	{
+		// Poll promptly if the endpoint stops being trusted.
+		mClockStatusPollInterval = kClockStatusPollMinInterval / kRefreshInterval;
+		mPollClockStatusCounter = mClockStatusPollInterval - 1;
+	}
+	else if ( ++mPollClockStatusCounter >= mClockStatusPollInterval )
+	{
+		mPollClockStatusCounter = 0;
+		mClockStatusChanged = false;
+		updateClockStatus ( mCurrentClockSourceID );
+		mClockStatusTransfersIssued += mClockStatusPollTransfers;
+		if ( mClockStatusChanged )
+		{
+			mClockStatusPollInterval = kClockStatusPollMinInterval / kRefreshInterval;
+		}
+		else if ( mClockStatusPollInterval < ( kClockStatusPollMaxInterval / kRefreshInterval ) )
+		{
+			mClockStatusPollInterval *= 2;
+		}
+	}
+
+	if ( 0 == ( mClockStatusPollTicks % ( kStatisticsPublishInterval / kRefreshInterval ) ) )
+	{
+		publishClockStatusPolling ();
+	}
+}
+
+void AppleUSBAudioEngine::publishClockStatusPolling ( void )
+{
+	OSDictionary *		pollingDictionary = NULL;
+	OSNumber *			number = NULL;
+	UInt32				baselinePolls;
+	UInt32				baselineTransfers;
+
+	// Polling every kClockStatusPollMinInterval, starting on the first tick, is what this used to cost devices without a status
+	// interrupt endpoint. Devices with one were never polled, so nothing is saved on them.
+	baselinePolls = 0;
+	if ( mClockStatusPollBaseline )
+	{
+		baselinePolls = ( mClockStatusPollTicks + ( kClockStatusPollMinInterval / kRefreshInterval ) - 1 ) / ( kClockStatusPollMinInterval / kRefreshInterval );
+	}
+	baselineTransfers = baselinePolls * mClockStatusPollTransfers;
+
+	FailIf ( NULL == ( pollingDictionary = OSDictionary::withCapacity ( 2 ) ), Exit );
+	FailIf ( NULL == ( number = OSNumber::withNumber ( mClockStatusTransfersIssued, SIZEINBITS(UInt32) ) ), Exit );
+	pollingDictionary->setObject ( kClockStatusTransfersIssuedKey, number );
+	number->release ();
+	FailIf ( NULL == ( number = OSNumber::withNumber ( ( baselineTransfers > mClockStatusTransfersIssued ) ? baselineTransfers - mClockStatusTransfersIssued : 0, SIZEINBITS(UInt32) ) ), Exit );
+	pollingDictionary->setObject ( kClockStatusTransfersSavedKey, number );
+	number->release ();
+	setProperty ( kClockStatusPollingKey, pollingDictionary );
+
+Exit:
+	if ( NULL != pollingDictionary )
+	{
+		pollingDictionary->release ();
+	}
+}
+#endif // EVENTDRIVENCLOCKSTATUS
+
+#if ADAPTIVESAMPLEOFFSET
+// The input and output sample offsets belong to the engine, not to a stream, so with several streams in a direction the offset has to
+// cover the latest of them. Streams that haven't adapted yet count with their heuristic offset. Nothing is set until at least one stream
+// of the direction has adapted, which leaves the heuristic offset from updateSampleOffsetAndLatency () in place after a rate change.
+void AppleUSBAudioEngine::applyAdaptiveSampleOffsets () {
+	AppleUSBAudioStream *	audioStream;
+	UInt32					inputSampleOffset = 0;
+	UInt32					outputSampleOffset = 0;
+	UInt32					streamSampleOffset;
+	bool					inputAdapted = false;
+	bool					outputAdapted = false;
+	bool					adapted;
+
+	FailIf ( NULL == mIOAudioStreamArray, Exit );
+
+	for ( UInt32 streamIndex = 0; streamIndex < mIOAudioStreamArray->getCount (); streamIndex++ )
+	{
+		audioStream = OSDynamicCast ( AppleUSBAudioStream, mIOAudioStreamArray->getObject ( streamIndex ) );
+		if ( NULL == audioStream )
+		{
+			continue;
+		}
+		streamSampleOffset = audioStream->getAdaptiveSampleOffset ( &adapted );
+		if ( kIOAudioStreamDirectionInput == audioStream->getDirection () )
+		{
+			inputAdapted = inputAdapted || adapted;
+			if ( streamSampleOffset > inputSampleOffset )
+			{
+				inputSampleOffset = streamSampleOffset;
+			}
+		}
+		else
+		{
+			outputAdapted = outputAdapted || adapted;
+			if ( streamSampleOffset > outputSampleOffset )
+			{
+				outputSampleOffset = streamSampleOffset;
+			}
+		}
+	}
+
+	if ( !inputAdapted )
+	{
+		mAdaptiveInputSampleOffset = 0;
+	}
+	else if ( inputSampleOffset != mAdaptiveInputSampleOffset )
+	{
+		debugIOLog ( "? AppleUSBAudioEngine[%p]::applyAdaptiveSampleOffsets () - input sample offset %lu -> %lu", this, mAdaptiveInputSampleOffset, inputSampleOffset );
+		mAdaptiveInputSampleOffset = inputSampleOffset;
+		setInputSampleOffset ( mAdaptiveInputSampleOffset );
+	}
+
+	if ( !outputAdapted )
+	{
+		mAdaptiveOutputSampleOffset = 0;
+	}
+	else if ( outputSampleOffset != mAdaptiveOutputSampleOffset )
+	{
+		debugIOLog ( "? AppleUSBAudioEngine[%p]::applyAdaptiveSampleOffsets () - output sample offset %lu -> %lu", this, mAdaptiveOutputSampleOffset, outputSampleOffset );
+		mAdaptiveOutputSampleOffset = outputSampleOffset;
+		setOutputSampleOffset ( mAdaptiveOutputSampleOffset );
+	}
+
+Exit:
+	return;
+}
+#endif
+
 //	<rdar://5811247>
 void AppleUSBAudioEngine::runPolledTask () {
 
@@ -2580,6 +2854,9 @@ void AppleUSBAudioEngine::runPolledTask () {
 	//	<rdar://5811247>
 	else if ( mShouldPollClockStatus )
 	{
+		#if EVENTDRIVENCLOCKSTATUS
+		pollClockStatus ();
+		#else
 		if ( 0 == mPollClockStatusCounter )
 		{
 			updateClockStatus ( mCurrentClockSourceID );
@@ -2590,9 +2867,90 @@ void AppleUSBAudioEngine::runPolledTask () {
 		{
 			mPollClockStatusCounter = 0;
 		}
+		#endif // EVENTDRIVENCLOCKSTATUS
 	}
 	#endif // POLLCLOCKSTATUS
 	
+	if ( mUSBStreamRunning && ( NULL != mIOAudioStreamArray ) )
+	{
+		for ( UInt32 streamIndex = 0; streamIndex < mIOAudioStreamArray->getCount (); streamIndex++ )
+		{
+			AppleUSBAudioStream * audioStream = OSDynamicCast ( AppleUSBAudioStream, mIOAudioStreamArray->getObject ( streamIndex ) );
+			if ( NULL != audioStream )
+			{
+				#if ADAPTIVESAMPLEOFFSET
+				audioStream->updateAdaptiveSampleOffset ();
+				#endif
+				
+				if ( ++audioStream->mStatisticsPublishCounter >= ( kStatisticsPublishInterval / kRefreshInterval ) )
+				{
+					audioStream->publishStreamStatistics ();
+					#if STREAMTRACE
+					audioStream->publishStreamTrace ( true );
+					#endif
+					audioStream->mStatisticsPublishCounter = 0;
+				}
+			}
+		}
+		#if ADAPTIVESAMPLEOFFSET
+		applyAdaptiveSampleOffsets ();
+		#endif
+	}
+	
+	#if LIGHTWEIGHTWAKE
+	checkStartAfterWake ();
+	#endif
+	
 Exit:
 	return;
 }
+
+#if LIGHTWEIGHTWAKE
+// Runs from the device's timer, so that a start whose completions have stopped coming is still caught.
+void AppleUSBAudioEngine::checkStartAfterWake ( void )
+{
+	UInt64	currentUSBFrame;
+	
+	FailIf ( NULL == mUSBAudioDevice, Exit );
+	if ( mVerifyStartAfterWake && mUSBStreamRunning && ( 0 != mWakeStartDeadline ) )
+	{
+		currentUSBFrame = mUSBAudioDevice->getUSBFrameNumber ();
+		if ( mWakeStartTimeStamped && ( countAnsweredPackets () > mWakeStartAnsweredPackets ) )
+		{
+			debugIOLog ("? AppleUSBAudioEngine[%p]::checkStartAfterWake () - Streaming at frame %llu", this, currentUSBFrame);
+			mVerifyStartAfterWake = false;
+			mWakeStartDeadline = 0;
+		}
+		else if ( currentUSBFrame > mWakeStartDeadline )
+		{
+			debugIOLog ("! AppleUSBAudioEngine[%p]::checkStartAfterWake () - Nothing streamed by frame %llu (now %llu)", this, mWakeStartDeadline, currentUSBFrame);
+			mVerifyStartAfterWake = false;
+			mWakeStartDeadline = 0;
+			mUSBAudioDevice->startFailedAfterWake ( this, kIOReturnTimeout );
+		}
+	}
+	
+Exit:
+	return;
+}
+
+// Packets of all of the engine's streams that came back without an error, overruns included.
+UInt64 AppleUSBAudioEngine::countAnsweredPackets ( void )
+{
+	AppleUSBAudioStream *	audioStream;
+	UInt64					answeredPackets = 0;
+	
+	FailIf ( NULL == mIOAudioStreamArray, Exit );
+	for ( UInt32 streamIndex = 0; streamIndex < mIOAudioStreamArray->getCount (); streamIndex++ )
+	{
+		audioStream = OSDynamicCast ( AppleUSBAudioStream, mIOAudioStreamArray->getObject ( streamIndex ) );
+		if ( NULL != audioStream )
+		{
+			answeredPackets += audioStream->mStatistics.packets - audioStream->mStatistics.errorPackets;
+		}
+	}
+	
+Exit:
+	return answeredPackets;
+}
+#endif
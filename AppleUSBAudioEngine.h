@@ -106,9 +106,24 @@ class AppleUSBAudioDevice;
 
 #define kFormatChangeDelayInMs					667
 #define	kStartDelayOffset						5
+// Once starts have been timed, the start offset follows the slowest recent start plus kStartDelayMargin frames. A faster start only pulls it
+// down by a quarter of the difference, and it never goes below kStartDelayOffset or above kMaxStartDelayOffset.
+#define	kStartDelayMargin						2
+#define	kMaxStartDelayOffset					16
+// After a wake without a reset, each engine's first start has to take a time stamp and get packets back within kWakeStartFrameLists of its
+// longest frame lists (past the start frame and lock delay), or the device is reset.
+#define	kWakeStartFrameLists					16
 
 #define	kMaxTriesForStreamPropertiesReady		500	//  <rdar://problem/6686515> 500 x 10ms = 5 second timeout
 
+// Clock status polling starts at the old fixed rate and doubles, up to the maximum, for every poll that finds nothing changed.
+#define kClockStatusPollMinInterval				1024	// ms
+#define kClockStatusPollMaxInterval				8192	// ms
+
+#define kClockStatusPollingKey					"ClockStatusPolling"
+#define kClockStatusTransfersIssuedKey			"TransfersIssued"
+#define kClockStatusTransfersSavedKey			"TransfersSaved"			// against what the fixed-rate polling would have issued
+
 class AppleUSBAudioEngine;
 class AppleUSBAudioPlugin;
 class AppleUSBAudioStream;
@@ -162,6 +177,21 @@ public:
 	virtual IOAudioSampleRate getCurrentClockPathSampleRate ( void );															//	<rdar://6945472>
 	virtual void updateClockStatus ( UInt8 clockID );																			//	<rdar://5811247>
 	virtual void runPolledTask ( void );																						//	<rdar://5811247>
+	#if LIGHTWEIGHTWAKE
+	virtual void checkStartAfterWake ( void );
+	virtual UInt64 countAnsweredPackets ( void );
+	#endif
+	#if EVENTDRIVENCLOCKSTATUS
+	virtual void pollClockStatus ( void );
+	virtual void publishClockStatusPolling ( void );
+	#endif
+	#if ADAPTIVESAMPLEOFFSET
+	virtual void applyAdaptiveSampleOffsets ( void );
+	#endif
+
+	virtual IOReturn addDefaultAudioControl ( IOAudioControl * defaultAudioControl );
+	virtual IOReturn removeDefaultAudioControl ( IOAudioControl * defaultAudioControl );
+	virtual void removeAllDefaultAudioControls ( void );
 	
 protected:
 	bool								mSplitTransactions;
@@ -173,6 +203,7 @@ protected:
 	IOAudioSampleRate					mCurSampleRate;
 	UInt32								mLastClippedFrame;
 	UInt32								mAverageSampleRate;
+	UInt32								mStartDelayFrames;
 	Boolean								mUSBStreamRunning;
 	Boolean								mTerminatingDriver;
 	Boolean								mUHCISupport;
@@ -207,6 +238,27 @@ protected:
 	Boolean								mClockSourceValidity;				//	<rdar://5811247>
 	bool								mClockSourceValidityInitialized;	//	<rdar://5811247>
 	bool								mShouldRepublishFormat;				//	<rdar://5811247>
+	#if EVENTDRIVENCLOCKSTATUS
+	UInt32								mClockStatusPollInterval;			// in kRefreshInterval ticks
+	UInt32								mClockStatusPollTicks;				// ticks since polling was set up
+	UInt32								mClockStatusPollTransfers;			// control transfers per poll
+	UInt32								mClockStatusTransfersIssued;
+	bool								mClockStatusPollBaseline;			// the fixed-rate code would have polled this device
+	UInt32								mLastClockStatusRate;
+	bool								mLastClockStatusValidity;
+	bool								mLastClockStatusKnown;
+	bool								mClockStatusChanged;				// set by updateClockStatus ()
+	#endif
+	#if LIGHTWEIGHTWAKE
+	bool								mVerifyStartAfterWake;				// resumed without a reset and no start has streamed since
+	bool								mWakeStartTimeStamped;				// set by takeTimeStamp () while a start is watched
+	UInt64								mWakeStartDeadline;					// USB frame the watched start has to stream by, 0 if none
+	UInt64								mWakeStartAnsweredPackets;			// countAnsweredPackets () when the watched start began
+	#endif
+	#if ADAPTIVESAMPLEOFFSET
+	UInt32								mAdaptiveInputSampleOffset;			// last offsets set by applyAdaptiveSampleOffsets (), 0 if none
+	UInt32								mAdaptiveOutputSampleOffset;
+	#endif
 	
 	static inline IOFixed IOUFixedDivide(UInt32 a, UInt32 b)
 	{
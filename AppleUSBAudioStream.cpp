@@ -56,6 +56,27 @@ void AppleUSBAudioStream::free () {
 		mCoalescenceMutex = NULL;
 	}
 
+	if (NULL != mPrepareThread)
+	{
+		thread_call_cancel (mPrepareThread);
+		thread_call_free (mPrepareThread);
+		mPrepareThread = NULL;
+	}
+
+	if (NULL != mPrepareLock)
+	{
+		IOLockFree (mPrepareLock);
+		mPrepareLock = NULL;
+	}
+
+	#if STREAMTRACE
+	if (NULL != mTraceRing)
+	{
+		IOFree (mTraceRing, kStreamTraceRecords * sizeof (AUATraceRecord));
+		mTraceRing = NULL;
+	}
+	#endif
+
 	if (NULL != mFrameQueuedForList) 
 	{
 		delete [] mFrameQueuedForList;
@@ -196,6 +217,19 @@ bool AppleUSBAudioStream::initWithAudioEngine (AppleUSBAudioDevice * device, App
 	
 	mInitStampDifference = true;	// <rdar://problem/7378275>
 	
+	// Lets the engine prepare all of its streams at once. If either allocation fails the stream is simply prepared inline.
+	mPrepareLock = IOLockAlloc ();
+	mPrepareThread = thread_call_allocate ((thread_call_func_t)prepareUSBStreamThread, (thread_call_param_t)this);
+	
+	#if STREAMTRACE
+	// Tracing is simply off for this stream if the ring can't be had.
+	mTraceRing = (AUATraceRecord *) IOMalloc (kStreamTraceRecords * sizeof (AUATraceRecord));
+	if (NULL != mTraceRing)
+	{
+		bzero (mTraceRing, kStreamTraceRecords * sizeof (AUATraceRecord));
+	}
+	#endif
+	
 	result = TRUE;
         
 Exit:
@@ -337,6 +371,10 @@ void AppleUSBAudioStream::registerService(IOOptionBits options)
 
 #pragma mark -USB Audio driver-
 
+// Rates published from a clock range whose step is too coarse to publish as continuous.
+static const UInt32		sCommonSampleRates[] = { 8000, 11025, 16000, 22050, 24000, 32000, 44100, 48000, 64000, 88200, 96000, 176400, 192000, 352800, 384000 };
+#define kNumCommonSampleRates	( sizeof ( sCommonSampleRates ) / sizeof ( sCommonSampleRates[0] ) )
+
 IOReturn AppleUSBAudioStream::addAvailableFormats (AUAConfigurationDictionary * configDictionary)
 {
     IOAudioStreamFormat					streamFormat;
@@ -344,11 +382,14 @@ IOReturn AppleUSBAudioStream::addAvailableFormats (AUAConfigurationDictionary *
     IOAudioSampleRate					lowSampleRate;
     IOAudioSampleRate					highSampleRate;
 	OSArray *							sampleRates = NULL;
+	OSArray *							sampleRateRanges = NULL;
 	OSObject *							arrayObject = NULL;
 	OSNumber *							arrayNumber = NULL;
 	IOReturn							result = kIOReturnError;
 	UInt32								thisSampleRate;
 	UInt32								otherSampleRate;
+	UInt32								maxSampleRate;
+	UInt32								resolution;
 	UInt16								format;
     UInt8								numAltInterfaces;
     UInt8								numSampleRates;
@@ -393,11 +434,13 @@ IOReturn AppleUSBAudioStream::addAvailableFormats (AUAConfigurationDictionary *
 				continue;
 			}
 			sampleRates = configDictionary->getSampleRates (mInterfaceNumber, altSettingIndex);
+			sampleRateRanges = configDictionary->getSampleRateRanges (mInterfaceNumber, altSettingIndex);
 		}
 		else
 		{
 			numSampleRates = 0;
 			sampleRates = NULL;
+			sampleRateRanges = NULL;
 		}
 		
 		// [rdar://5284099] Check the format before deciding whether to retrieve the following values.
@@ -470,6 +513,9 @@ IOReturn AppleUSBAudioStream::addAvailableFormats (AUAConfigurationDictionary *
 				continue;	// skip this alternate interface
 		}
 
+		// Only publish the rates this alternate setting's isoc endpoint has the bandwidth for, counting every transaction it can make per microframe.
+		maxSampleRate = ( 0 != numChannels ) ? getMaxSampleRateForEndpoint ( configDictionary, altSettingIndex, numChannels * ( streamFormat.fBitWidth / 8 ) ) : 0;
+
 		debugIOLog ("? AppleUSBAudioStream[%p]::addAvailableFormats () - Interface %d, Alt %d has a ", this, mInterfaceNumber, altSettingIndex);
 		debugIOLog ("     %d bit interface, ", streamFormat.fBitDepth);
 		debugIOLog ("     %d channel(s), and ", streamFormat.fNumChannels);
@@ -483,6 +529,11 @@ IOReturn AppleUSBAudioStream::addAvailableFormats (AUAConfigurationDictionary *
 				FailIf (NULL == (arrayObject = sampleRates->getObject (rateIndex)), Exit);
 				FailIf (NULL == (arrayNumber = OSDynamicCast (OSNumber, arrayObject)), Exit);
 				thisSampleRate = arrayNumber->unsigned32BitValue();
+				if ( ( 0 != maxSampleRate ) && ( thisSampleRate > maxSampleRate ) )
+				{
+					debugIOLog ("          %d (not published, exceeds endpoint bandwidth)", thisSampleRate);
+					continue;
+				}
 				debugIOLog ("          %d", thisSampleRate);
 				lowSampleRate.whole = thisSampleRate;
 				lowSampleRate.fraction = 0;
@@ -504,17 +555,29 @@ IOReturn AppleUSBAudioStream::addAvailableFormats (AUAConfigurationDictionary *
 			FailIf (NULL == (arrayObject = sampleRates->getObject (1)), Exit);
 			FailIf (NULL == (arrayNumber = OSDynamicCast (OSNumber, arrayObject)), Exit);
 			otherSampleRate = arrayNumber->unsigned32BitValue();
-
-			debugIOLog ("          %d to %d", thisSampleRate, otherSampleRate);
-			lowSampleRate.whole = thisSampleRate;
-			lowSampleRate.fraction = 0;
-			highSampleRate.whole = otherSampleRate;
-			highSampleRate.fraction = 0;
-			this->addAvailableFormat (&streamFormat, &streamFormatExtension, &lowSampleRate, &highSampleRate);
-			if (kIOAudioStreamSampleFormatLinearPCM == streamFormat.fSampleFormat) 
+			if ( ( 0 != maxSampleRate ) && ( thisSampleRate > maxSampleRate ) )
 			{
-				streamFormat.fIsMixable = FALSE;
+				debugIOLog ("          %d to %d (not published, exceeds endpoint bandwidth)", thisSampleRate, otherSampleRate);
+			}
+			else
+			{
+				if ( ( 0 != maxSampleRate ) && ( otherSampleRate > maxSampleRate ) )
+				{
+					debugIOLog ("          (range limited to %d by endpoint bandwidth)", maxSampleRate);
+					otherSampleRate = maxSampleRate;
+				}
+
+				debugIOLog ("          %d to %d", thisSampleRate, otherSampleRate);
+				lowSampleRate.whole = thisSampleRate;
+				lowSampleRate.fraction = 0;
+				highSampleRate.whole = otherSampleRate;
+				highSampleRate.fraction = 0;
 				this->addAvailableFormat (&streamFormat, &streamFormatExtension, &lowSampleRate, &highSampleRate);
+				if (kIOAudioStreamSampleFormatLinearPCM == streamFormat.fSampleFormat) 
+				{
+					streamFormat.fIsMixable = FALSE;
+					this->addAvailableFormat (&streamFormat, &streamFormatExtension, &lowSampleRate, &highSampleRate);
+				}
 			}
 		}
 		else
@@ -536,6 +599,79 @@ IOReturn AppleUSBAudioStream::addAvailableFormats (AUAConfigurationDictionary *
 				}
 			}
 		}
+
+		// Ranges from the clock path are published alongside any discrete rates. A range with a step of 1 is published as continuous;
+		// IOAudio has no form for a coarser grid, so those publish their bounds and the common rates that fall on their step.
+		if (sampleRateRanges)
+		{
+			for (UInt32 rangeIndex = 0; 2 * rangeIndex + 1 < sampleRateRanges->getCount (); rangeIndex++)
+			{
+				FailIf (kIOReturnSuccess != configDictionary->getSampleRateRange (&thisSampleRate, &otherSampleRate, &resolution, mInterfaceNumber, altSettingIndex, rangeIndex), Exit);
+				if ( ( 0 != maxSampleRate ) && ( otherSampleRate > maxSampleRate ) )
+				{
+					if ( thisSampleRate > maxSampleRate )
+					{
+						debugIOLog ("          %d to %d (not published, exceeds endpoint bandwidth)", thisSampleRate, otherSampleRate);
+						continue;
+					}
+					debugIOLog ("          (range limited to %d by endpoint bandwidth)", maxSampleRate);
+					otherSampleRate = thisSampleRate + ( ( maxSampleRate - thisSampleRate ) / resolution ) * resolution;
+				}
+
+				if ( 1 == resolution )
+				{
+					debugIOLog ("          %d to %d", thisSampleRate, otherSampleRate);
+					lowSampleRate.whole = thisSampleRate;
+					lowSampleRate.fraction = 0;
+					highSampleRate.whole = otherSampleRate;
+					highSampleRate.fraction = 0;
+					this->addAvailableFormat (&streamFormat, &streamFormatExtension, &lowSampleRate, &highSampleRate);
+					if (kIOAudioStreamSampleFormatLinearPCM == streamFormat.fSampleFormat) 
+					{
+						streamFormat.fIsMixable = FALSE;
+						this->addAvailableFormat (&streamFormat, &streamFormatExtension, &lowSampleRate, &highSampleRate);
+						streamFormat.fIsMixable = TRUE;
+					}
+					continue;
+				}
+
+				debugIOLog ("          %d to %d step %d", thisSampleRate, otherSampleRate, resolution);
+				for (UInt32 commonIndex = 0; commonIndex <= kNumCommonSampleRates + 1; commonIndex++)
+				{
+					// The range's own bounds go first and last; common rates on the step go in between.
+					if ( 0 == commonIndex )
+					{
+						lowSampleRate.whole = thisSampleRate;
+					}
+					else if ( kNumCommonSampleRates + 1 == commonIndex )
+					{
+						if ( otherSampleRate == thisSampleRate )
+						{
+							break;
+						}
+						lowSampleRate.whole = otherSampleRate;
+					}
+					else
+					{
+						lowSampleRate.whole = sCommonSampleRates[commonIndex - 1];
+						if	(		( lowSampleRate.whole <= thisSampleRate )
+								||	( lowSampleRate.whole >= otherSampleRate )
+								||	( 0 != ( lowSampleRate.whole - thisSampleRate ) % resolution ) )
+						{
+							continue;
+						}
+					}
+					lowSampleRate.fraction = 0;
+					this->addAvailableFormat (&streamFormat, &streamFormatExtension, &lowSampleRate, &lowSampleRate);
+					if (kIOAudioStreamSampleFormatLinearPCM == streamFormat.fSampleFormat) 
+					{
+						streamFormat.fIsMixable = FALSE;
+						this->addAvailableFormat (&streamFormat, &streamFormatExtension, &lowSampleRate, &lowSampleRate);
+						streamFormat.fIsMixable = TRUE;
+					}
+				}
+			}
+		}
 	} // for altSettingIndex
 
 	/*
@@ -609,6 +745,68 @@ Exit:
 	return result;
 }
 
+// Returns the highest sample rate whose average packet still fits in the isoc endpoint's maximum packet size for this alternate setting, or 0 if
+// it can't be determined. This matches the [rdar://4801012] check made when the sample rates are parsed for USB Audio 2.0. The maximum packet
+// size already includes the additional transactions of a high-bandwidth endpoint.
+UInt32 AppleUSBAudioStream::getMaxSampleRateForEndpoint (AUAConfigurationDictionary * configDictionary, UInt8 altSettingID, UInt32 bytesPerSampleFrame)
+{
+	UInt32								maxSampleRate = 0;
+	UInt16								maxPacketSize = 0;
+	UInt8								interval;
+	UInt8								transactionsPerUSBFrame = 1;
+
+	FailIf ( NULL == configDictionary, Exit );
+	FailIf ( 0 == bytesPerSampleFrame, Exit );
+	FailIf ( kIOReturnSuccess != configDictionary->getIsocEndpointMaxPacketSize ( &maxPacketSize, mInterfaceNumber, altSettingID, mDirection ), Exit );
+	FailIf ( 0 == maxPacketSize, Exit );
+
+	// [rdar://4801012] Same transfer opportunities per millisecond as controlledFormatChange () will use for this alternate setting.
+	if	(		( IP_VERSION_02_00 == mStreamInterface->GetInterfaceProtocol () )
+			&&	( kUSBDeviceSpeedHigh == mUSBAudioDevice->getDeviceSpeed () ) )
+	{
+		FailIf ( kIOReturnSuccess != configDictionary->getIsocEndpointInterval ( &interval, mInterfaceNumber, altSettingID, mDirection ), Exit );
+		FailIf ( interval > 4, Exit );
+		if ( 0 != interval )
+		{
+			transactionsPerUSBFrame = 8 >> ( interval - 1 );
+		}
+	}
+
+	maxSampleRate = ( ( maxPacketSize / bytesPerSampleFrame ) + 1 ) * 1000 * transactionsPerUSBFrame - 1;
+
+Exit:
+	return maxSampleRate;
+}
+
+// The engine changes the rate of every one of its streams in turn. Streams that share a clock path only need the first of them to program it.
+bool AppleUSBAudioStream::clockPathSetByOtherStream (OSArray * clockPath, UInt32 sampleRate)
+{
+	AppleUSBAudioStream *				otherStream;
+	UInt32								streamIndex;
+	bool								result = false;
+
+	FailIf ( NULL == clockPath, Exit );
+	FailIf ( NULL == mUSBAudioEngine, Exit );
+	FailIf ( NULL == mUSBAudioEngine->mIOAudioStreamArray, Exit );
+
+	for ( streamIndex = 0; streamIndex < mUSBAudioEngine->mIOAudioStreamArray->getCount (); streamIndex++ )
+	{
+		otherStream = OSDynamicCast ( AppleUSBAudioStream, mUSBAudioEngine->mIOAudioStreamArray->getObject ( streamIndex ) );
+		if	(		( NULL != otherStream )
+				&&	( this != otherStream )
+				&&	( otherStream->mActiveClockPath == clockPath )
+				&&	( otherStream->mCurSampleRate.whole == sampleRate )
+				&&	( otherStream->mSampleRateOnlyChange ) )
+		{
+			result = true;
+			break;
+		}
+	}
+
+Exit:
+	return result;
+}
+
 // <rdar://7259238>
 IOReturn AppleUSBAudioStream::setFormat(const IOAudioStreamFormat *streamFormat, bool callDriver)
 {
@@ -645,9 +843,17 @@ IOReturn AppleUSBAudioStream::setFormat(const IOAudioStreamFormat *streamFormat,
 	
 	if ( kIOReturnSuccess == result )
 	{
-		debugIOLog ("? AppleUSBAudioStream[%p]::setFormat (%p, %p, %p, %d) - Delaying %u ms...", this, streamFormat, formatExtension, formatDict, callDriver, kFormatChangeDelayInMs );
-		// Wait a bit after format change so that the USB audio device has a chance to catch up.
-		IOSleep ( kFormatChangeDelayInMs );
+		if ( mSampleRateOnlyChange )
+		{
+			// Only the clock rate changed, and the clock has already said it is valid at the new rate, so there is nothing to wait for.
+			debugIOLog ("? AppleUSBAudioStream[%p]::setFormat (%p, %p, %p, %d) - Clock valid after rate change, not delaying", this, streamFormat, formatExtension, formatDict, callDriver );
+		}
+		else
+		{
+			debugIOLog ("? AppleUSBAudioStream[%p]::setFormat (%p, %p, %p, %d) - Delaying %u ms...", this, streamFormat, formatExtension, formatDict, callDriver, kFormatChangeDelayInMs );
+			// Wait a bit after format change so that the USB audio device has a chance to catch up.
+			IOSleep ( kFormatChangeDelayInMs );
+		}
 	}
 
 	// Send an engine change notification so that the HAL refreshes its settings.
@@ -940,6 +1146,7 @@ IOReturn AppleUSBAudioStream::CoalesceInputSamples (UInt32 numBytesToCoalesce, I
 	{
 		onCoreAudioThread = false;
 	}
+	trace ( kAUATraceCoalesce, mUSBFrameToQueue, numBytesToCoalesce, mBufferOffset, onCoreAudioThread );
 
 	if (NULL == pFrames) 
 	{
@@ -1141,6 +1348,8 @@ IOReturn AppleUSBAudioStream::CoalesceInputSamples (UInt32 numBytesToCoalesce, I
 			&&  ( NULL != mStreamInterface ) )
 	{
 		debugIOLog ("! AppleUSBAudioStream[%p]::CoalesceInputSamples () - Requested: %lu, Remaining: %lu on frame list %lu\n", this, numBytesToCoalesce, numBytesLeft, mCurrentFrameList);
+		mStatistics.coalesceStarvations++;
+		trace ( kAUATraceCoalesceStarved, mUSBFrameToQueue, numBytesToCoalesce, (UInt32)numBytesLeft, mCurrentFrameList );
 	}
 
 	#if DEBUGINPUT
@@ -1179,11 +1388,16 @@ IOReturn AppleUSBAudioStream::controlledFormatChange (const IOAudioStreamFormat
 	UInt32								remainder;								// <rdar://problem/6954295>
 	IOAudioSampleRate					sampleRate;								//<rdar://6945472>
 	bool								needToUpdateStampDifference = false;	// <rdar://problem/7378275>
+	bool								sampleRateOnlyChange;
+	Boolean								clockValidity = false;
+	UInt32								clockRate = 0;
+	vm_size_t							bufferLength;
 	
 
 	debugIOLog ("+ AppleUSBAudioStream[%p]::controlledFormatChange (%p, %p)", this, newFormat, newSampleRate);
 
 	result = kIOReturnError;
+	mSampleRateOnlyChange = false;
 
 	FailIf (NULL == mStreamInterface, Exit);
 	FailIf (NULL == mUSBAudioDevice, Exit);	
@@ -1241,6 +1455,15 @@ IOReturn AppleUSBAudioStream::controlledFormatChange (const IOAudioStreamFormat
 	FailIf (kIOReturnSuccess != configDictionary->getIsocEndpointDirection (&newDirection, mInterfaceNumber, newAlternateSettingID), Exit);
 	FailIf (newDirection != mDirection, Exit);
 
+	// A new rate on the alternate setting and sample format already in use only needs the clock reprogrammed and the buffers resized.
+	sampleRateOnlyChange =		( NULL != newSampleRate )
+							&&	( newAlternateSettingID == mAlternateSettingID )
+							&&	( newFormat->fNumChannels == this->format.fNumChannels )
+							&&	( newFormat->fBitDepth == this->format.fBitDepth )
+							&&	( newFormat->fBitWidth == this->format.fBitWidth )
+							&&	( NULL != mUSBIsocFrames )
+							&&	( NULL != mUSBBufferDescriptor );
+
 	// Set the sampling rate on the device [rdar://4867843], <rdar://6945472>
 	if (IP_VERSION_02_00 == mStreamInterface->GetInterfaceProtocol())
 	{
@@ -1261,7 +1484,23 @@ IOReturn AppleUSBAudioStream::controlledFormatChange (const IOAudioStreamFormat
 			pathArray = mUSBAudioDevice->getOptimalClockPath ( mUSBAudioEngine, mInterfaceNumber, newAlternateSettingID, sampleRate.whole, NULL );
 		}
 		FailIf ( NULL == pathArray, Exit );			
-		FailIf ( kIOReturnSuccess != mUSBAudioDevice->setClockPathCurSampleRate ( sampleRate.whole, pathArray, TRUE ), Exit );
+		if	(		( sampleRateOnlyChange )
+				&&	( clockPathSetByOtherStream ( pathArray, sampleRate.whole ) ) )
+		{
+			debugIOLog ("? AppleUSBAudioStream[%p]::controlledFormatChange () - Clock path already set to %d Hz by another stream", this, sampleRate.whole);
+			mSampleRateOnlyChange = true;
+		}
+		else
+		{
+			FailIf ( kIOReturnSuccess != mUSBAudioDevice->setClockPathCurSampleRate ( sampleRate.whole, pathArray, TRUE ), Exit );
+			
+			// If the clock is already valid at the new rate there is no need for setFormat () to give the device time to catch up.
+			if	(		( sampleRateOnlyChange )
+					&&	( kIOReturnSuccess == mUSBAudioDevice->getClockPathCurSampleRate ( &clockRate, &clockValidity, NULL, pathArray ) ) )
+			{
+				mSampleRateOnlyChange = ( clockValidity && ( clockRate == sampleRate.whole ) );
+			}
+		}
 
 		mActiveClockPath = pathArray;
  	}
@@ -1334,6 +1573,9 @@ IOReturn AppleUSBAudioStream::controlledFormatChange (const IOAudioStreamFormat
 	mSamplesPerPacket.whole = mCurSampleRate.whole / ( mTransactionsPerUSBFrame * 1000 );
 	remainder = mCurSampleRate.whole - ( mSamplesPerPacket.whole * mTransactionsPerUSBFrame * 1000 );	// same as (mCurSampleRate.whole % 1000) * mTransactionsPerUSBFrame
 	mSamplesPerPacket.fraction = ( remainder * 65536 ) / mTransactionsPerUSBFrame;
+	#if CONDITIONFEEDBACK
+	resetFeedbackConditioning ();
+	#endif
 	debugIOLog ( "? AppleUSBAudioStream[%p]::controlledFormatChange () - mSamplesPerPacket: %u(whole) %u(fraction)", this, mSamplesPerPacket.whole, mSamplesPerPacket.fraction );
 	
 	calculateSamplesPerPacket (mCurSampleRate.whole, &averageFrameSamples, &additionalSampleFrameFreq);
@@ -1348,6 +1590,19 @@ IOReturn AppleUSBAudioStream::controlledFormatChange (const IOAudioStreamFormat
 
 	mOverrunsThreshold = kOverrunsThreshold;	// <rdar://6411577> Threshold for overruns. 
 	
+	// The maximum packet size already accounts for every transaction a high-bandwidth endpoint can make per microframe.
+	FailIf ( kIOReturnSuccess != configDictionary->getIsocEndpointMaxPacketSize ( &maxPacketSize, mInterfaceNumber, mAlternateSettingID, mDirection ), Exit );
+	FailIf ( 0 == mSampleSize, Exit );
+	mMaxSamplesPerTransfer = maxPacketSize / mSampleSize;
+	#ifdef DEBUGLOGGING
+	{
+		UInt8	transactionsPerMicroframe = 1;
+		
+		configDictionary->getIsocEndpointTransactionsPerMicroframe ( &transactionsPerMicroframe, mInterfaceNumber, mAlternateSettingID, mDirection );
+		debugIOLog ( "? AppleUSBAudioStream[%p]::controlledFormatChange () - maxPacketSize = %d (%d transaction(s) per microframe), mMaxSamplesPerTransfer = %d", this, maxPacketSize, transactionsPerMicroframe, mMaxSamplesPerTransfer );
+	}
+	#endif
+	
 	// You have to make the read buffer the size of the alternate frame size because we have to ask for mAlternateFrameSize bytes
 	// with each read.  If you don't make the buffer big enough, you don't get all the data from the last frame...
 	// USB says that if the device is running at an even multiple of the bus clock (i.e. 48KHz) that it can send frames that 
@@ -1357,7 +1612,6 @@ IOReturn AppleUSBAudioStream::controlledFormatChange (const IOAudioStreamFormat
 	{
 		// mReadUSBFrameListSize = mAlternateFrameSize * mNumTransactionsPerList;
 		// [rdar://5355808] [rdar://5889101] Be a little more lenient than the spec dictates to accommodate ill-behaved devices if possible.
-		FailIf ( kIOReturnSuccess != configDictionary->getIsocEndpointMaxPacketSize ( &maxPacketSize, mInterfaceNumber, mAlternateSettingID, mDirection ), Exit );
 		mReadUSBFrameListSize = ( ( mAlternateFrameSize + 2 * mSampleSize ) < maxPacketSize ) ? ( mAlternateFrameSize + 2 * mSampleSize ) : maxPacketSize; 
 		mReadUSBFrameListSize *= mNumTransactionsPerList;
 	}
@@ -1401,14 +1655,24 @@ IOReturn AppleUSBAudioStream::controlledFormatChange (const IOAudioStreamFormat
 		}
 	}
 
+	// Existing buffers are kept whenever they are already big enough for the new format, which is the usual case for a rate change.
 	if (kUSBIn == mDirection) 
 	{
-		if (NULL != mReadBuffer) 
+		bufferLength = mNumUSBFrameLists * mReadUSBFrameListSize;
+		if	(		( NULL != mReadBuffer )
+				&&	( mUSBBufferDescriptor->getCapacity () >= bufferLength ) )
 		{
-			mUSBBufferDescriptor->release ();
+			mUSBBufferDescriptor->setLength (bufferLength);
+		}
+		else
+		{
+			if (NULL != mReadBuffer) 
+			{
+				mUSBBufferDescriptor->release ();
+			}
+			
+			mUSBBufferDescriptor = allocateBufferDescriptor (kIODirectionIn, bufferLength, PAGE_SIZE);
 		}
-		
-		mUSBBufferDescriptor = allocateBufferDescriptor (kIODirectionIn, mNumUSBFrameLists * mReadUSBFrameListSize, PAGE_SIZE);
 		
 		FailIf (NULL == mUSBBufferDescriptor, Exit);
 		mReadBuffer = mUSBBufferDescriptor->getBytesNoCopy ();
@@ -1421,32 +1685,46 @@ IOReturn AppleUSBAudioStream::controlledFormatChange (const IOAudioStreamFormat
 			FailIf (NULL == mSampleBufferDescriptors[i], Exit);
 		}
 
-		if (NULL != mSampleBufferMemoryDescriptor) 
+		if	(		( NULL != mSampleBufferMemoryDescriptor )
+				&&	( mSampleBufferMemoryDescriptor->getCapacity () >= mSampleBufferSize ) )
 		{
 			this->setSampleBuffer (NULL, 0);
-			mSampleBufferMemoryDescriptor->release ();
+			mSampleBufferMemoryDescriptor->setLength (mSampleBufferSize);
+		}
+		else
+		{
+			if (NULL != mSampleBufferMemoryDescriptor) 
+			{
+				this->setSampleBuffer (NULL, 0);
+				mSampleBufferMemoryDescriptor->release ();
+			}
+			
+			mSampleBufferMemoryDescriptor = IOBufferMemoryDescriptor::withOptions (kIODirectionInOut, mSampleBufferSize, PAGE_SIZE);
 		}
-		
-		mSampleBufferMemoryDescriptor = IOBufferMemoryDescriptor::withOptions (kIODirectionInOut, mSampleBufferSize, PAGE_SIZE);
 		FailIf (NULL == mSampleBufferMemoryDescriptor, Exit);
 		sampleBuffer = mSampleBufferMemoryDescriptor->getBytesNoCopy ();
 	} 
 	else 
 	{
 		// This is the output case.		
+		// With UHCI, allocate an additional alternate frame size (mSampleBufferSizeExtended total) as our scribble ahead for frames that would be wrapped in clipOutputSamples
+		bufferLength = mUHCISupport ? mSampleBufferSizeExtended : mSampleBufferSize;
 		if (NULL != mUSBBufferDescriptor) 
 		{
 			this->setSampleBuffer (NULL, 0);
-			mUSBBufferDescriptor->release ();
-		}
-		if (mUHCISupport)
-		{
-			// Allocate an additional alternate frame size (mSampleBufferSizeExtended total) as our scribble ahead for frames that would be wrapped in clipOutputSamples
-			mUSBBufferDescriptor = allocateBufferDescriptor (kIODirectionOut, mSampleBufferSizeExtended, PAGE_SIZE);
+			if (mUSBBufferDescriptor->getCapacity () >= bufferLength)
+			{
+				mUSBBufferDescriptor->setLength (bufferLength);
+			}
+			else
+			{
+				mUSBBufferDescriptor->release ();
+				mUSBBufferDescriptor = NULL;
+			}
 		}
-		else
+		if (NULL == mUSBBufferDescriptor)
 		{
-			mUSBBufferDescriptor = allocateBufferDescriptor (kIODirectionOut, mSampleBufferSize, PAGE_SIZE);
+			mUSBBufferDescriptor = allocateBufferDescriptor (kIODirectionOut, bufferLength, PAGE_SIZE);
 		}
 		FailIf (NULL == mUSBBufferDescriptor, Exit);
 
@@ -1499,6 +1777,12 @@ void AppleUSBAudioStream::updateSampleOffsetAndLatency ()
 	averageFrameSamples = mCurSampleRate.whole / 1000; // per ms
 	additionalSampleFrameFreq = mCurSampleRate.whole - ( averageFrameSamples * 1000 );
 
+	#if ADAPTIVESAMPLEOFFSET
+	// Lateness measured at the old sample rate doesn't translate into samples at the new one.
+	resetCompletionLateness ();
+	mSampleOffsetOverridden = false;
+	#endif
+
 	if (kUSBIn == mDirection) 
 	{
 		// Check to see if latency should be higher for EHCI (rdar://3959606 ) 
@@ -1540,12 +1824,21 @@ void AppleUSBAudioStream::updateSampleOffsetAndLatency ()
 			{				
 				debugIOLog ("? AppleUSBAudioEngine[%p]::updateSampleOffsetAndLatency () - override input sample offset (%lu) to %lu sample frames", this, newSampleOffset, sampleOffset->unsigned32BitValue ());
 				newSampleOffset = sampleOffset->unsigned32BitValue ();
+				#if ADAPTIVESAMPLEOFFSET
+				mSampleOffsetOverridden = true;
+				#endif
 			}
 		}
 
 		// Add an extra frame and a half of samples to the offset if going through a USB 2.0 hub.
 		newSampleOffset += (highSpeedCompensation ? (5 * minimumSafeSampleOffset / 3) : 0);
 		
+		#if ADAPTIVESAMPLEOFFSET
+		// Input data can't be converted until the USB frame carrying it has completed, so a full frame is the least we can ever use.
+		mAdaptiveBaseSampleOffset = minimumSafeSampleOffset;
+		mHeuristicSampleOffset = newSampleOffset;
+		#endif
+		
 		// Set the offset for input devices (microphones, etc.)
 		mUSBAudioEngine->setInputSampleOffset (newSampleOffset);
 		debugIOLog ("? AppleUSBAudioEngine[%p]::updateSampleOffsetAndLatency () - setting input sample offset to %lu sample frames", this, newSampleOffset);
@@ -1602,9 +1895,17 @@ void AppleUSBAudioStream::updateSampleOffsetAndLatency ()
 			{				
 				debugIOLog ("? AppleUSBAudioEngine[%p]::updateSampleOffsetAndLatency () - override output sample offset (%lu) to %lu sample frames", this, newSampleOffset, sampleOffset->unsigned32BitValue ());
 				newSampleOffset = sampleOffset->unsigned32BitValue ();
+				#if ADAPTIVESAMPLEOFFSET
+				mSampleOffsetOverridden = true;
+				#endif
 			}
 		}
 
+		#if ADAPTIVESAMPLEOFFSET
+		mAdaptiveBaseSampleOffset = cautiousSafeSampleOffset / 2;
+		mHeuristicSampleOffset = newSampleOffset;
+		#endif
+
 		// Set the offset for output devices (speakers, etc.) to 1 USB frame (+1 ms to latency). This is necessary to ensure that samples are not clipped 
 		// to a portion of the buffer whose DMA is in process.
 		mUSBAudioEngine->setOutputSampleOffset (newSampleOffset);
@@ -1633,6 +1934,304 @@ void AppleUSBAudioStream::updateSampleOffsetAndLatency ()
 	}
 }
 
+void AppleUSBAudioStream::setNumberInDictionary (OSDictionary * dictionary, const char * key, UInt64 value)
+{
+	OSNumber *		number;
+
+	FailIf (NULL == dictionary, Exit);
+	FailIf (NULL == (number = OSNumber::withNumber (value, SIZEINBITS(UInt64))), Exit);
+	dictionary->setObject (key, number);
+	number->release ();
+
+Exit:
+	return;
+}
+
+// Called from the read and write completion routines, so this only increments counters. Lateness is measured against the frame after the
+// last one in the completed frame list; queue depth is how far ahead of the bus mUSBFrameToQueue was when the completion ran.
+void AppleUSBAudioStream::recordCompletionStatistics (UInt32 frameListIndex, UInt64 currentUSBFrameNumber)
+{
+	if	(		( NULL != mFrameQueuedForList )
+			&&	( frameListIndex < mNumUSBFrameLists ) )
+	{
+		mStatistics.completionLatenessHistogram[statisticsBucket ( ( SInt64 ) ( currentUSBFrameNumber - ( mFrameQueuedForList[frameListIndex] + mNumUSBFramesPerList ) ) )]++;
+	}
+	mStatistics.queueDepthHistogram[statisticsBucket ( ( SInt64 ) ( mUSBFrameToQueue - currentUSBFrameNumber ) )]++;
+}
+
+// Counts the packets of a completed input frame list. The read handler calls this before deciding whether the list gets coalesced or
+// requeued, so lists it drops still show up in the counters.
+void AppleUSBAudioStream::recordInputPacketStatistics (IOUSBLowLatencyIsocFrame * pFrames)
+{
+	UInt32		minimumUSBFrameSize = mAverageFrameSize - 2 * mSampleSize;		// [rdar://5355808] [rdar://5889101]
+
+	for ( UInt32 frameIndex = 0; frameIndex < mNumTransactionsPerList && pFrames; frameIndex++ )
+	{
+		mStatistics.packets++;
+		mStatistics.bytes += pFrames[frameIndex].frActCount;
+		if ( kIOReturnOverrun == pFrames[frameIndex].frStatus )
+		{
+			mStatistics.overruns++;
+		}
+		else if ( ( kIOReturnSuccess != pFrames[frameIndex].frStatus ) && ( kIOReturnUnderrun != pFrames[frameIndex].frStatus ) )
+		{
+			mStatistics.errorPackets++;
+		}
+		if ( pFrames[frameIndex].frActCount < minimumUSBFrameSize )
+		{
+			mStatistics.shortPackets++;
+		}
+	}
+}
+
+// Publishes a snapshot of mStatistics as the StreamStatistics property. This allocates, so it must only be called from the workloop
+// (AppleUSBAudioEngine::runPolledTask () and stopUSBStream ()), never from a completion routine.
+void AppleUSBAudioStream::publishStreamStatistics ()
+{
+	OSDictionary *		statisticsDictionary = NULL;
+	OSArray *			latenessArray = NULL;
+	OSArray *			queueDepthArray = NULL;
+	OSNumber *			number;
+
+	FailIf ( NULL == ( statisticsDictionary = OSDictionary::withCapacity ( 11 ) ), Exit );
+	FailIf ( NULL == ( latenessArray = OSArray::withCapacity ( kStatisticsHistogramBuckets ) ), Exit );
+	FailIf ( NULL == ( queueDepthArray = OSArray::withCapacity ( kStatisticsHistogramBuckets ) ), Exit );
+
+	setNumberInDictionary ( statisticsDictionary, kStatisticsPacketsKey, mStatistics.packets );
+	setNumberInDictionary ( statisticsDictionary, kStatisticsBytesKey, mStatistics.bytes );
+	setNumberInDictionary ( statisticsDictionary, kStatisticsShortPacketsKey, mStatistics.shortPackets );
+	setNumberInDictionary ( statisticsDictionary, kStatisticsOverrunsKey, mStatistics.overruns );
+	setNumberInDictionary ( statisticsDictionary, kStatisticsErrorPacketsKey, mStatistics.errorPackets );
+	setNumberInDictionary ( statisticsDictionary, kStatisticsFrameSkipsKey, mStatistics.frameSkips );
+	setNumberInDictionary ( statisticsDictionary, kStatisticsFrameListsNotAdvancedKey, mStatistics.frameListsNotAdvanced );
+	setNumberInDictionary ( statisticsDictionary, kStatisticsCoalesceStarvationsKey, mStatistics.coalesceStarvations );
+	setNumberInDictionary ( statisticsDictionary, kStatisticsStreamStartsKey, mStatistics.streamStarts );
+
+	for ( UInt32 bucket = 0; bucket < kStatisticsHistogramBuckets; bucket++ )
+	{
+		if ( NULL != ( number = OSNumber::withNumber ( mStatistics.completionLatenessHistogram[bucket], SIZEINBITS(UInt32) ) ) )
+		{
+			latenessArray->setObject ( number );
+			number->release ();
+		}
+		if ( NULL != ( number = OSNumber::withNumber ( mStatistics.queueDepthHistogram[bucket], SIZEINBITS(UInt32) ) ) )
+		{
+			queueDepthArray->setObject ( number );
+			number->release ();
+		}
+	}
+	statisticsDictionary->setObject ( kStatisticsCompletionLatenessKey, latenessArray );
+	statisticsDictionary->setObject ( kStatisticsQueueDepthKey, queueDepthArray );
+
+	setProperty ( kStreamStatisticsKey, statisticsDictionary );
+
+Exit:
+	if ( NULL != queueDepthArray )
+	{
+		queueDepthArray->release ();
+	}
+	if ( NULL != latenessArray )
+	{
+		latenessArray->release ();
+	}
+	if ( NULL != statisticsDictionary )
+	{
+		statisticsDictionary->release ();
+	}
+	return;
+}
+
+#if STREAMTRACE
+// Publishes a copy of the trace ring as the StreamTrace property. Like publishStreamStatistics () this allocates and must only be called
+// from the workloop. With onlyAfterGlitch, the ring is copied only if a skip, error, overrun or starvation has been counted since last time.
+void AppleUSBAudioStream::publishStreamTrace (bool onlyAfterGlitch)
+{
+	OSData *			traceData = NULL;
+	AUATraceHeader		header;
+	AUATraceRecord		record;
+	volatile UInt32 *	sequence;
+	UInt64				nanos;
+	UInt32				glitches;
+	UInt32				sequenceBefore;
+	UInt32				recordIndex;
+
+	FailIf ( NULL == mTraceRing, Exit );
+	
+	glitches = mStatistics.frameSkips + mStatistics.errorPackets + mStatistics.overruns + mStatistics.coalesceStarvations;
+	if ( onlyAfterGlitch && ( glitches == mTraceGlitches ) )
+	{
+		goto Exit;
+	}
+	mTraceGlitches = glitches;
+
+	header.magic = kStreamTraceMagic;
+	header.version = kStreamTraceVersion;
+	header.recordSize = sizeof ( AUATraceRecord );
+	header.recordCount = kStreamTraceRecords;
+	header.direction = getDirection ();
+	header.absoluteScale = 1000000000ull;
+	absolutetime_to_nanoseconds ( header.absoluteScale, &nanos );
+	header.nanosecondScale = nanos;
+
+	FailIf ( NULL == ( traceData = OSData::withCapacity ( sizeof ( header ) + kStreamTraceRecords * sizeof ( AUATraceRecord ) ) ), Exit );
+	FailIf ( false == traceData->appendBytes ( &header, sizeof ( header ) ), Exit );
+	// Copy a record at a time so a record the completion routines rewrite underneath us can be marked torn rather than published as a mix
+	// of two events. The sequence number is zeroed before a slot is rewritten and stored last, so a record whose sequence number reads the
+	// same before and after the copy was not touched in between.
+	for ( recordIndex = 0; recordIndex < kStreamTraceRecords; recordIndex++ )
+	{
+		sequence = &mTraceRing[recordIndex].sequence;
+		sequenceBefore = *sequence;
+		OSMemoryBarrier ();
+		bcopy ( &mTraceRing[recordIndex], &record, sizeof ( record ) );
+		OSMemoryBarrier ();
+		if ( sequenceBefore != *sequence || sequenceBefore != record.sequence )
+		{
+			record.sequence = 0;
+		}
+		FailIf ( false == traceData->appendBytes ( &record, sizeof ( record ) ), Exit );
+	}
+
+	setProperty ( kStreamTraceKey, traceData );
+
+Exit:
+	if ( NULL != traceData )
+	{
+		traceData->release ();
+	}
+	return;
+}
+#endif
+
+#if ADAPTIVESAMPLEOFFSET
+void AppleUSBAudioStream::resetCompletionLateness ()
+{
+	for ( UInt32 binIndex = 0; binIndex < kLatenessHistogramBins; binIndex++ )
+	{
+		mLatenessHistogram[binIndex] = 0;
+	}
+	mLatenessCompletionCount = 0;
+	mAdaptiveSampleOffset = 0;
+	mLatenessPercentile_micros = 0;
+	mLastAdaptiveOffsetUpdate_nanos = 0ull;
+}
+
+// Called from the read and write completion routines. A frame list is due back at the start of the USB frame following its last frame, so
+// anything after that is time the completion spent waiting in the host controller driver or the USB workloop. This is only an increment
+// of a histogram bin; updateAdaptiveSampleOffset () does the rest from the workloop.
+void AppleUSBAudioStream::recordCompletionLateness (UInt32 frameListIndex)
+{
+	AbsoluteTime		expectedTime;
+	UInt64				expectedTime_nanos;
+	UInt64				now_nanos;
+	UInt64				usbCycleTime;
+	UInt32				binIndex;
+
+	if	(		( NULL != mFrameQueuedForList )
+			&&	( NULL != mUSBAudioDevice )
+			&&	( frameListIndex < mNumUSBFrameLists )
+			&&	( kIOReturnSuccess == copyAnchor ( mFrameQueuedForList[frameListIndex] + mNumUSBFramesPerList, &expectedTime, &usbCycleTime ) ) )
+	{
+		absolutetime_to_nanoseconds ( expectedTime, &expectedTime_nanos );
+		now_nanos = mUSBAudioDevice->getWallTimeInNanos ();
+		
+		// Completions that appear early are just anchor estimation error; count them as on time.
+		binIndex = ( now_nanos > expectedTime_nanos ) ? ( UInt32 ) ( ( now_nanos - expectedTime_nanos ) / ( 1000ull * kLatenessHistogramBinWidth ) ) : 0;
+		if ( binIndex >= kLatenessHistogramBins )
+		{
+			binIndex = kLatenessHistogramBins - 1;
+		}
+		mLatenessHistogram[binIndex]++;
+		mLatenessCompletionCount++;
+	}
+}
+
+// Called from the device's timer on the workloop while the stream is running. The offset is the structural minimum plus enough samples
+// to cover the kAdaptiveOffsetPercentile lateness and a margin. It changes at most once every kAdaptiveOffsetUpdateInterval ms, and the
+// histogram is halved after each evaluation so that it follows changes in host controller behaviour. The engine's sample offset is shared
+// by every stream of a direction, so this only records the stream's own figure; AppleUSBAudioEngine::applyAdaptiveSampleOffsets () sets
+// the engine from the largest of them.
+void AppleUSBAudioStream::updateAdaptiveSampleOffset ()
+{
+	OSDictionary *		adaptiveOffsetDictionary;
+	UInt64				now_nanos;
+	UInt32				completionCount;
+	UInt32				completionsBelow;
+	UInt32				percentileTarget;
+	UInt32				binIndex;
+	UInt32				newSampleOffset;
+	UInt32				hysteresis;
+
+	FailIf ( NULL == mUSBAudioDevice, Exit );
+	FailIf ( NULL == mUSBAudioEngine, Exit );
+
+	now_nanos = mUSBAudioDevice->getWallTimeInNanos ();
+	if	(		( mSampleOffsetOverridden )
+			||	( 0 == mAdaptiveBaseSampleOffset )
+			||	( mLatenessCompletionCount < kAdaptiveOffsetMinimumCompletions )
+			||	( now_nanos - mLastAdaptiveOffsetUpdate_nanos < kAdaptiveOffsetUpdateInterval * 1000000ull ) )
+	{
+		goto Exit;
+	}
+	mLastAdaptiveOffsetUpdate_nanos = now_nanos;
+
+	// Take a snapshot of the count; the completion routines may keep adding to the histogram while we walk it.
+	completionCount = mLatenessCompletionCount;
+	percentileTarget = ( UInt32 ) ( ( ( UInt64 ) completionCount * kAdaptiveOffsetPercentile ) / 1000 );
+	completionsBelow = 0;
+	for ( binIndex = 0; binIndex < kLatenessHistogramBins - 1; binIndex++ )
+	{
+		completionsBelow += mLatenessHistogram[binIndex];
+		if ( completionsBelow >= percentileTarget )
+		{
+			break;
+		}
+	}
+	mLatenessPercentile_micros = ( binIndex + 1 ) * kLatenessHistogramBinWidth;
+
+	newSampleOffset = mAdaptiveBaseSampleOffset + ( UInt32 ) ( ( ( UInt64 ) ( mLatenessPercentile_micros + kAdaptiveOffsetMarginMicroseconds ) * mCurSampleRate.whole ) / 1000000ull );
+
+	// Ignore changes smaller than a quarter of a millisecond so the offset doesn't dither between neighbouring bins.
+	hysteresis = mCurSampleRate.whole / 4000;
+	if	(		( 0 == mAdaptiveSampleOffset )
+			||	( newSampleOffset > mAdaptiveSampleOffset + hysteresis )
+			||	( newSampleOffset + hysteresis < mAdaptiveSampleOffset ) )
+	{
+		debugIOLog ( "? AppleUSBAudioStream[%p]::updateAdaptiveSampleOffset () - lateness %lu us at %lu/1000 of %lu completions, sample offset %lu -> %lu (heuristic %lu)", this, mLatenessPercentile_micros, kAdaptiveOffsetPercentile, completionCount, mAdaptiveSampleOffset, newSampleOffset, mHeuristicSampleOffset );
+		mAdaptiveSampleOffset = newSampleOffset;
+	}
+
+	// Decay the history.
+	for ( binIndex = 0; binIndex < kLatenessHistogramBins; binIndex++ )
+	{
+		mLatenessHistogram[binIndex] >>= 1;
+	}
+	mLatenessCompletionCount >>= 1;
+
+	adaptiveOffsetDictionary = OSDictionary::withCapacity ( 4 );
+	if ( NULL != adaptiveOffsetDictionary )
+	{
+		setNumberInDictionary ( adaptiveOffsetDictionary, kAdaptiveSampleOffsetKey, mAdaptiveSampleOffset );
+		setNumberInDictionary ( adaptiveOffsetDictionary, kHeuristicSampleOffsetKey, mHeuristicSampleOffset );
+		setNumberInDictionary ( adaptiveOffsetDictionary, kCompletionLatenessPercentileKey, mLatenessPercentile_micros );
+		setNumberInDictionary ( adaptiveOffsetDictionary, kCompletionsMeasuredKey, completionCount );
+		setProperty ( kAdaptiveSampleOffsetDictionaryKey, adaptiveOffsetDictionary );
+		adaptiveOffsetDictionary->release ();
+	}
+
+Exit:
+	return;
+}
+
+// The offset this stream needs from the engine: the adapted figure once there is one, otherwise whatever updateSampleOffsetAndLatency ()
+// set, which includes any vendor override. adapted says which of the two it is.
+UInt32 AppleUSBAudioStream::getAdaptiveSampleOffset (bool * adapted)
+{
+	* adapted = ( !mSampleOffsetOverridden && ( 0 != mAdaptiveSampleOffset ) );
+	return * adapted ? mAdaptiveSampleOffset : mHeuristicSampleOffset;
+}
+#endif
+
 // <rdar://problem/7378275> Improved timestamp generation accuracy
 IOReturn AppleUSBAudioStream::copyAnchor (UInt64 anchorFrame, AbsoluteTime * anchorTime, UInt64 * usbCycleTime)
 {
@@ -1857,6 +2456,7 @@ AbsoluteTime AppleUSBAudioStream::generateTimeStamp (SInt32 transactionIndex, UI
 		mLastFilteredStampDifference = filteredStampDifference;
 	}
 	mLastWrapFrame = thisFrameNum;
+	trace ( kAUATraceTimeStamp, thisFrameNum, (UInt32)transactionIndex, (UInt32)mLastFilteredStampDifference, preWrapBytes );
 	
 Exit:
 	
@@ -2233,6 +2833,18 @@ void AppleUSBAudioStream::closeStreamInterface () {
 	}
 }
 
+// All of the streaming code reads the bus frame number through here, and this goes to the device, so that the frame timeline the
+// completion routines see is the one the anchor is taken on.
+UInt64 AppleUSBAudioStream::getCurrentUSBFrameNumber () {
+	UInt64	frameNumber = 0ull;
+
+	FailIf (NULL == mUSBAudioDevice, Exit);
+	frameNumber = mUSBAudioDevice->getUSBFrameNumber ();
+
+Exit:
+	return frameNumber;
+}
+
 void AppleUSBAudioStream::queueInputFrames () {
 	UInt64	curUSBFrameNumber;
 	UInt64	framesLeftInQueue;
@@ -2240,7 +2852,7 @@ void AppleUSBAudioStream::queueInputFrames () {
 	#if 1	// enabled for [3091812]
 	if (0 == mShouldStop && TRUE != mInCompletion && NULL != mStreamInterface) 
 	{
-		curUSBFrameNumber = mStreamInterface->GetDevice()->GetBus()->GetFrameNumber ();
+		curUSBFrameNumber = getCurrentUSBFrameNumber ();
 		framesLeftInQueue = mUSBFrameToQueue - curUSBFrameNumber;
 
 		if ( framesLeftInQueue < ( mNumUSBFramesPerList * ( mNumUSBFrameListsToQueue / 2 )) / 2 ) 	// <rdar://problem/6327095>
@@ -2252,7 +2864,7 @@ void AppleUSBAudioStream::queueInputFrames () {
 				#endif
 				readHandler (this, mUSBCompletion[mCurrentFrameList].parameter, kIOReturnSuccess, &mUSBIsocFrames[mCurrentFrameList * mNumUSBFramesPerList]);
 
-				curUSBFrameNumber = mStreamInterface->GetDevice()->GetBus()->GetFrameNumber ();
+				curUSBFrameNumber = getCurrentUSBFrameNumber ();
 				framesLeftInQueue = mUSBFrameToQueue - curUSBFrameNumber;
 			}
 		}
@@ -2266,7 +2878,7 @@ void AppleUSBAudioStream::queueOutputFrames () {
 
 	if (0 == mShouldStop && TRUE != mInCompletion && NULL != mStreamInterface) 
 	{
-		curUSBFrameNumber = mStreamInterface->GetDevice()->GetBus()->GetFrameNumber ();
+		curUSBFrameNumber = getCurrentUSBFrameNumber ();
 		framesLeftInQueue = mUSBFrameToQueue - curUSBFrameNumber;
 		if ( framesLeftInQueue < ( mNumUSBFramesPerList * ( mNumUSBFrameListsToQueue / 2 )) / 2 )	// <rdar://problem/6327095>
 		{
@@ -2352,6 +2964,14 @@ IOReturn AppleUSBAudioStream::PrepareWriteFrameList (UInt32 arrayIndex) {
 			integerSamplesInFrame++;
 			mFractionalSamplesLeft -= kSampleFractionAccumulatorRollover;		// <rdar://problem/6954295>
 		}
+		// Never ask for more than the endpoint can carry in one (micro)frame. The host controller splits each request across the
+		// endpoint's transactions, so anything beyond that is deferred to a later transaction instead of being dropped.
+		if	(		( integerSamplesInFrame > mMaxSamplesPerTransfer )
+				&&	( averageSamplesInFrame < mMaxSamplesPerTransfer ) )
+		{
+			mFractionalSamplesLeft += ( integerSamplesInFrame - mMaxSamplesPerTransfer ) * kSampleFractionAccumulatorRollover;
+			integerSamplesInFrame = mMaxSamplesPerTransfer;
+		}
 		thisFrameSize = integerSamplesInFrame * mSampleSize;
 		#if DEBUGLATENCY
 			frameListByteCount += thisFrameSize;
@@ -2645,6 +3265,7 @@ void AppleUSBAudioStream::readHandler (void * object, void * parameter, IOReturn
 		
 		if ( flagOverrun )
 		{
+			self->recordInputPacketStatistics (pFrames);
 			// This is a fatal error. Notify the AppleUSBAudioDevice to sync the sample rates when possible if this device has two streaming interfaces.
 			self->mUSBAudioDevice->setShouldSyncSampleRates (self->mUSBAudioEngine);
 			goto Exit; // [rdar://5889101]
@@ -2652,10 +3273,23 @@ void AppleUSBAudioStream::readHandler (void * object, void * parameter, IOReturn
 	}
 	
 	FailIf (NULL == self->mStreamInterface, Exit);
-	currentUSBFrameNumber = self->mStreamInterface->GetDevice()->GetBus()->GetFrameNumber();
+	currentUSBFrameNumber = self->getCurrentUSBFrameNumber ();
+	self->trace ( kAUATraceReadComplete, currentUSBFrameNumber, self->mCurrentFrameList, result, (UInt32)( self->mUSBFrameToQueue - currentUSBFrameNumber ) );
 	
 	if (kIOReturnAborted != result)
 	{
+		#if ADAPTIVESAMPLEOFFSET
+		if (0 == self->mShouldStop)
+		{
+			self->recordCompletionLateness (self->mCurrentFrameList);
+		}
+		#endif
+		if (0 == self->mShouldStop)
+		{
+			self->recordCompletionStatistics (self->mCurrentFrameList, currentUSBFrameNumber);
+		}
+		self->recordInputPacketStatistics (pFrames);
+		
 		#if 1 // enabled for [3091812]
 		if (0 == self->mShouldStop && (SInt32)(self->mUSBFrameToQueue - currentUSBFrameNumber) > (SInt32)(self->mNumUSBFramesPerList * (self->mNumUSBFrameListsToQueue - 1))) 
 		{
@@ -2707,6 +3341,7 @@ void AppleUSBAudioStream::readHandler (void * object, void * parameter, IOReturn
 		// skip ahead and see if that helps
 		if (self->mUSBFrameToQueue <= currentUSBFrameNumber) 
 		{
+			self->mStatistics.frameSkips++;
 			self->mUSBFrameToQueue = currentUSBFrameNumber + kMinimumFrameOffset;
 		}
 	}
@@ -2851,9 +3486,15 @@ void AppleUSBAudioStream::sampleRateHandler (void * target, void * parameter, IO
 				newSamplesPerFrame.whole = 0;
 				newSamplesPerFrame.fraction = 0;
 		}
+		self->trace ( kAUATraceFeedback, self->mNextSyncReadFrame, result, USBToHostLong ( sampleRateBuffer ), pFrames->frActCount );
 		// <rdar://problem/6954295>
+#if CONDITIONFEEDBACK
+		// Every valid value has to reach the conditioning stage, even one equal to the current packet size, to keep the accumulated error exact.
+		if ( newSamplesPerFrame.whole != 0 )
+#else
 		if (  ( newSamplesPerFrame.whole != 0 ) && 
 			  ( newSamplesPerFrame.whole != oldSamplesPerFrame.whole || newSamplesPerFrame.fraction != oldSamplesPerFrame.fraction ) ) 
+#endif
 		{
 			// Need to make sure this sample rate isn't way out of the ballpark 
 			// i.e. each frame/microframe cannot vary by more than +/- one sample <rdar://problem/6954295>
@@ -2865,7 +3506,11 @@ void AppleUSBAudioStream::sampleRateHandler (void * target, void * parameter, IO
 			else
 			{
 				// The device has changed the sample rate that it needs, let's roll with the new sample rate <rdar://problem/6954295>
+#if CONDITIONFEEDBACK
+				self->mSamplesPerPacket = self->conditionFeedbackValue ( newSamplesPerFrame );
+#else
 				self->mSamplesPerPacket = newSamplesPerFrame;
+#endif
 #if DEBUGSAMPLERATEHANDLER
 				debugIOLog ("? AppleUSBAudioStream::sampleRateHandler () - Sample rate changed, requestedFrameRate: %u mSamplesPerPacket: %lu %lu\n", self->getRateFromSamplesPerPacket ( self->mSamplesPerPacket ), self->mSamplesPerPacket.whole, self->mSamplesPerPacket.fraction );
 #endif
@@ -2936,6 +3581,90 @@ void AppleUSBAudioStream::sampleRateHandler (void * target, void * parameter, IO
 	return;
 }
 
+#if CONDITIONFEEDBACK
+void AppleUSBAudioStream::resetFeedbackConditioning ( void )
+{
+	mFeedbackHistoryIndex = 0;
+	mFeedbackHistoryCount = 0;
+	mFeedbackSmoothedValue = 0ull;
+	mFeedbackAccumulatedError = 0ll;
+}
+
+/*
+	Noisy devices report feedback values that wander by a fraction of a sample from one refresh period to the next. Applying
+	each one directly makes the output packet sizes thrash, which in turn makes the device FIFO wander. This stage sits between
+	the feedback endpoint and mSamplesPerPacket:
+
+	1.	A median of the last kFeedbackMedianFilterSize values rejects isolated outliers.
+	2.	A proportional term moves the smoothed value 1/2^kFeedbackProportionalShift of the way toward that median.
+	3.	An integral term feeds back the accumulated difference between what the device requested and what was applied, so the
+		long-term average number of samples sent is exactly what the device asked for.
+
+	All arithmetic is done in 1/kSampleFractionAccumulatorRollover sample units, the same units PrepareWriteFrameList () accumulates.
+*/
+IOAudioSamplesPerFrame AppleUSBAudioStream::conditionFeedbackValue ( IOAudioSamplesPerFrame requestedSamplesPerPacket )
+{
+	UInt64							sortedHistory[kFeedbackMedianFilterSize];
+	UInt64							requestedValue;
+	UInt64							medianValue;
+	UInt64							insertValue;
+	SInt64							appliedValue;
+	IOAudioSamplesPerFrame			conditionedSamplesPerPacket;
+	UInt32							historyIndex;
+	UInt32							sortIndex;
+
+	requestedValue = ( ( UInt64 ) requestedSamplesPerPacket.whole * kSampleFractionAccumulatorRollover ) + requestedSamplesPerPacket.fraction;
+
+	// The history fills from index 0 after a reset, so the first mFeedbackHistoryCount entries are always valid.
+	mFeedbackHistory[mFeedbackHistoryIndex] = requestedValue;
+	mFeedbackHistoryIndex = ( mFeedbackHistoryIndex + 1 ) % kFeedbackMedianFilterSize;
+	if ( mFeedbackHistoryCount < kFeedbackMedianFilterSize )
+	{
+		mFeedbackHistoryCount++;
+	}
+
+	// Insertion sort is cheapest for a handful of entries and is safe to run from the completion routine.
+	for ( historyIndex = 0; historyIndex < mFeedbackHistoryCount; historyIndex++ )
+	{
+		insertValue = mFeedbackHistory[historyIndex];
+		for ( sortIndex = historyIndex; ( sortIndex > 0 ) && ( sortedHistory[sortIndex - 1] > insertValue ); sortIndex-- )
+		{
+			sortedHistory[sortIndex] = sortedHistory[sortIndex - 1];
+		}
+		sortedHistory[sortIndex] = insertValue;
+	}
+	medianValue = sortedHistory[mFeedbackHistoryCount / 2];
+
+	if ( 0ull == mFeedbackSmoothedValue )
+	{
+		mFeedbackSmoothedValue = medianValue;
+	}
+	else
+	{
+		mFeedbackSmoothedValue += ( ( SInt64 ) medianValue - ( SInt64 ) mFeedbackSmoothedValue ) / ( 1ll << kFeedbackProportionalShift );
+	}
+
+	appliedValue = ( SInt64 ) mFeedbackSmoothedValue + ( mFeedbackAccumulatedError / ( 1ll << kFeedbackIntegralShift ) );
+	if ( appliedValue < ( SInt64 ) kSampleFractionAccumulatorRollover )
+	{
+		appliedValue = kSampleFractionAccumulatorRollover;
+	}
+
+	// Accumulate what was actually applied, floor included, and don't clip the sum, so that nothing requested is forgotten. The loop
+	// bounds the error by itself: it settles at 2^kFeedbackIntegralShift times the gap between the requested and smoothed values.
+	mFeedbackAccumulatedError += ( SInt64 ) requestedValue - appliedValue;
+
+	conditionedSamplesPerPacket.whole = ( UInt32 ) ( appliedValue / kSampleFractionAccumulatorRollover );
+	conditionedSamplesPerPacket.fraction = ( UInt32 ) ( appliedValue % kSampleFractionAccumulatorRollover );
+
+#if DEBUGSAMPLERATEHANDLER
+	debugIOLog ( "? AppleUSBAudioStream[%p]::conditionFeedbackValue () - requested %llu median %llu smoothed %llu applied %lld accumulated error %lld", this, requestedValue, medianValue, mFeedbackSmoothedValue, appliedValue, mFeedbackAccumulatedError );
+#endif
+
+	return conditionedSamplesPerPacket;
+}
+#endif
+
 IOReturn AppleUSBAudioStream::setSampleRateControl (UInt8 address, UInt32 sampleRate) {
 	IOUSBDevRequest				devReq;
 	UInt32						theSampleRate;
@@ -3063,6 +3792,9 @@ IOReturn AppleUSBAudioStream::prepareUSBStream () {
 	mSamplesPerPacket.whole = mCurSampleRate.whole / ( mTransactionsPerUSBFrame * 1000 );
 	remainder = mCurSampleRate.whole - ( mSamplesPerPacket.whole * mTransactionsPerUSBFrame * 1000 );	// same as (mCurSampleRate.whole % 1000) * mTransactionsPerUSBFrame
 	mSamplesPerPacket.fraction = ( remainder * 65536 ) / mTransactionsPerUSBFrame;
+	#if CONDITIONFEEDBACK
+	resetFeedbackConditioning ();
+	#endif
 	debugIOLog ( "? AppleUSBAudioStream[%p]::prepareUSBStream () - mSamplesPerPacket: %u(whole) %u(fraction)", this, mSamplesPerPacket.whole, mSamplesPerPacket.fraction );
 	
     FailIf ((mNumUSBFrameLists < mNumUSBFrameListsToQueue), Exit);
@@ -3123,6 +3855,10 @@ IOReturn AppleUSBAudioStream::prepareUSBStream () {
 		{
 			maxFrameSize = ( averageFrameSamples + 1 ) * ( theFormat->fNumChannels * ( theFormat->fBitWidth / 8 ) );
 		}
+		
+		// The extra sample can push a wide format past what even a high-bandwidth endpoint carries per microframe. 
+		// PrepareWriteFrameList () defers that sample, so only reserve what the endpoint can actually use.
+		maxFrameSize = ( maxFrameSize > maxPacketSize ) ? maxPacketSize : maxFrameSize;
 	}
 
 	debugIOLog ("? AppleUSBAudioStream[%p]::prepareUSBStream () - calling SetPipePolicy (%d)", this, maxFrameSize);
@@ -3133,6 +3869,63 @@ Exit:
     return resultCode;
 }
 
+// Runs prepareUSBStream () on its own thread so that the SetAlternateInterface, sampling frequency and pipe policy requests of every stream on the
+// engine are in flight together rather than one stream after another. completePrepareUSBStream () must be called afterwards to collect the result.
+void AppleUSBAudioStream::beginPrepareUSBStream () {
+	mPrepareResult = kIOReturnError;
+	
+	if	(		( NULL != mPrepareThread )
+			&&	( NULL != mPrepareLock ) )
+	{
+		IOLockLock (mPrepareLock);
+		mPreparePending = true;
+		IOLockUnlock (mPrepareLock);
+		
+		retain ();
+		if (TRUE == thread_call_enter (mPrepareThread))
+		{
+			release ();
+		}
+	}
+	else
+	{
+		mPrepareResult = prepareUSBStream ();
+	}
+}
+
+IOReturn AppleUSBAudioStream::completePrepareUSBStream () {
+	if (NULL != mPrepareLock)
+	{
+		IOLockLock (mPrepareLock);
+		while (mPreparePending)
+		{
+			IOLockSleep (mPrepareLock, &mPreparePending, THREAD_UNINT);
+		}
+		IOLockUnlock (mPrepareLock);
+	}
+	
+	return mPrepareResult;
+}
+
+void AppleUSBAudioStream::prepareUSBStreamThread (AppleUSBAudioStream * usbAudioStreamObject) {
+	IOReturn							result;
+
+	FailIf (NULL == usbAudioStreamObject, Exit);
+	
+	result = usbAudioStreamObject->prepareUSBStream ();
+	
+	IOLockLock (usbAudioStreamObject->mPrepareLock);
+	usbAudioStreamObject->mPrepareResult = result;
+	usbAudioStreamObject->mPreparePending = false;
+	IOLockWakeup (usbAudioStreamObject->mPrepareLock, &usbAudioStreamObject->mPreparePending, true);
+	IOLockUnlock (usbAudioStreamObject->mPrepareLock);
+	
+	usbAudioStreamObject->release ();
+	
+Exit:
+	return;
+}
+
 IOReturn AppleUSBAudioStream::startUSBStream (UInt64 currentUSBFrame, UInt32 usbFramesToDelay) {
 	const IOAudioStreamFormat *			theFormat;
 	IOReturn							resultCode = kIOReturnError;
@@ -3160,6 +3953,7 @@ IOReturn AppleUSBAudioStream::startUSBStream (UInt64 currentUSBFrame, UInt32 usb
 	mLastRawTimeStamp_nanos = 0ull;			// <rdar://problem/7378275>
 	mLastFilteredTimeStamp_nanos = 0ull;	// <rdar://problem/7378275>
 	mLastWrapFrame = 0ull;
+	mStatistics.streamStarts++;
 
 	calculateSamplesPerPacket (mCurSampleRate.whole, &averageFrameSamples, &additionalSampleFrameFreq);
 	theFormat = this->getFormat ();
@@ -3208,6 +4002,7 @@ IOReturn AppleUSBAudioStream::startUSBStream (UInt64 currentUSBFrame, UInt32 usb
 
 	// Note that we haven't taken our first time stamp yet. This will help us determine when we should take it.
 	mHaveTakenFirstTimeStamp = false;
+	trace ( kAUATraceStreamStart, currentUSBFrame, (UInt32)mUSBFrameToQueue, usbFramesToDelay );
 	
 	if (getDirection () == kIOAudioStreamDirectionInput) 
 	{				
@@ -3352,6 +4147,13 @@ IOReturn AppleUSBAudioStream::stopUSBStream () {
 
 	mUSBStreamRunning = FALSE;
 
+	// Leave the final counts for this run in the registry.
+	publishStreamStatistics ();
+	#if STREAMTRACE
+	trace ( kAUATraceStreamStop, mUSBFrameToQueue );
+	publishStreamTrace ( false );
+	#endif
+
 	debugIOLog ("- AppleUSBAudioStream[%p]::stopUSBStream ()", this);
 	return kIOReturnSuccess;
 }
@@ -3460,10 +4262,11 @@ void AppleUSBAudioStream::writeHandler (void * object, void * parameter, IORetur
     self->mInCompletion = TRUE;
     FailIf (NULL == self->mStreamInterface, Exit);
 
-    curUSBFrameNumber = self->mStreamInterface->GetDevice()->GetBus()->GetFrameNumber ();
+    curUSBFrameNumber = self->getCurrentUSBFrameNumber ();
     frameDifference = (SInt64)(self->mUSBFrameToQueue - curUSBFrameNumber);
     expectedFrames = (SInt32)(self->mNumUSBFramesPerList * (self->mNumUSBFrameListsToQueue / 2)) + 1;
 	numberOfFramesToCheck = 0;
+	self->trace ( kAUATraceWriteComplete, curUSBFrameNumber, self->mCurrentFrameList, result, (UInt32)frameDifference );
 	
 	#if DEBUGUHCI
 	debugIOLog ("? AppleUSBAudioStream::writeHandler () - writeHandler: curUSBFrameNumber = %llu parameter = 0x%x mUSBFrameToQueue = %llu", curUSBFrameNumber, (UInt32)parameter, self->mUSBFrameToQueue);
@@ -3476,11 +4279,23 @@ void AppleUSBAudioStream::writeHandler (void * object, void * parameter, IORetur
               || (0 == parameter)))				// or this is a wrapping condition for a UHCI connection
     {
         debugIOLog ("? AppleUSBAudioStream::writeHandler () - Not advancing frame list");
+        self->mStatistics.frameListsNotAdvanced++;
+        self->trace ( kAUATraceFrameListNotAdvanced, curUSBFrameNumber, (UInt32)frameDifference, (UInt32)expectedFrames );
         goto Exit;
     }
     
     if (kIOReturnAborted != result) 
     {
+		#if ADAPTIVESAMPLEOFFSET
+		if (0 == self->mShouldStop)
+		{
+			self->recordCompletionLateness (self->mCurrentFrameList);
+		}
+		#endif
+		if (0 == self->mShouldStop)
+		{
+			self->recordCompletionStatistics (self->mCurrentFrameList, curUSBFrameNumber);
+		}
         
 		if (kIOReturnSuccess != result)
 		{
@@ -3488,6 +4303,19 @@ void AppleUSBAudioStream::writeHandler (void * object, void * parameter, IORetur
         }
 		
 		numberOfFramesToCheck = ((self->mUHCISupport && (UInt32) (uintptr_t) parameter) ? self->mNumFramesInFirstList : self->mNumTransactionsPerList);
+		for (UInt16 i = 0; i < numberOfFramesToCheck && pFrames; i++)
+		{
+			self->mStatistics.packets++;
+			self->mStatistics.bytes += pFrames[i].frActCount;
+			if (pFrames[i].frActCount != pFrames[i].frReqCount)
+			{
+				self->mStatistics.shortPackets++;
+			}
+			if ((kIOReturnSuccess != pFrames[i].frStatus) && (kIOReturnUnderrun != pFrames[i].frStatus))
+			{
+				self->mStatistics.errorPackets++;
+			}
+		}
 		if	(		self->mMasterMode 
 				&&	(!(self->mHaveTakenFirstTimeStamp))
 				&&	(0 == self->mBufferOffset))
@@ -3532,6 +4360,8 @@ void AppleUSBAudioStream::writeHandler (void * object, void * parameter, IORetur
         if (self->mUSBFrameToQueue <= curUSBFrameNumber) 
         {
 			debugIOLog ("! AppleUSBAudioStream::writeHandler - Fell behind! mUSBFrameToQueue = %llu, curUSBFrameNumber = %llu", self->mUSBFrameToQueue, curUSBFrameNumber);
+			self->mStatistics.frameSkips++;
+			self->trace ( kAUATraceFellBehind, curUSBFrameNumber, (UInt32)self->mUSBFrameToQueue );
             self->mUSBFrameToQueue = curUSBFrameNumber + kMinimumFrameOffset;
         }
     }
@@ -3615,10 +4445,11 @@ void AppleUSBAudioStream::writeHandlerForUHCI (void * object, void * parameter,
     self->mInCompletion = TRUE;
     FailIf (NULL == self->mStreamInterface, Exit);
 
-    curUSBFrameNumber = self->mStreamInterface->GetDevice()->GetBus()->GetFrameNumber ();
+    curUSBFrameNumber = self->getCurrentUSBFrameNumber ();
     frameDifference = (SInt64)(self->mUSBFrameToQueue - curUSBFrameNumber);
     expectedFrames = (SInt32)(self->mNumUSBFramesPerList * (self->mNumUSBFrameListsToQueue / 2)) + 1;
 	numberOfFramesToCheck = 0;
+	self->trace ( kAUATraceWriteComplete, curUSBFrameNumber, self->mCurrentFrameList, result, (UInt32)frameDifference );
 	
 	#if DEBUGUHCI
 	debugIOLog ("? AppleUSBAudioStream[%p]::writeHandlerForUHCI () - writeHandlerForUHCI: curUSBFrameNumber = %llu parameter = 0x%x mUSBFrameToQueue = %llu", curUSBFrameNumber, (UInt32)parameter, self->mUSBFrameToQueue);
@@ -3633,6 +4464,20 @@ void AppleUSBAudioStream::writeHandlerForUHCI (void * object, void * parameter,
 		{
 			debugIOLog ("! AppleUSBAudioStream::writeHandlerForUHCI () - Frame list %d (split for UHCI) write returned with error 0x%x", self->mCurrentFrameList, result);
         }
+		
+		for (UInt32 i = 0; i < (self->mNumTransactionsPerList - self->mNumFramesInFirstList) && pFrames; i++)
+		{
+			self->mStatistics.packets++;
+			self->mStatistics.bytes += pFrames[i].frActCount;
+			if (pFrames[i].frActCount != pFrames[i].frReqCount)
+			{
+				self->mStatistics.shortPackets++;
+			}
+			if ((kIOReturnSuccess != pFrames[i].frStatus) && (kIOReturnUnderrun != pFrames[i].frStatus))
+			{
+				self->mStatistics.errorPackets++;
+			}
+		}
 		#ifdef DEBUG
 		// Comb the isoc frame list for alarming statuses.
 		numberOfFramesToCheck = (self->mUHCISupport ? (self->mNumTransactionsPerList - self->mNumFramesInFirstList) : self->mNumTransactionsPerList);
@@ -3656,6 +4501,8 @@ void AppleUSBAudioStream::writeHandlerForUHCI (void * object, void * parameter,
         {
 			debugIOLog ("! AppleUSBAudioStream[%p]::writeHandlerForUHCI () - Fell behind! mUSBFrameToQueue = %llu, curUSBFrameNumber = %llu", self->mUSBFrameToQueue, curUSBFrameNumber);
 			debugIOLog ("! AppleUSBAudioStream[%p]::writeHandlerForUHCI () - Skipping ahead ...");
+			self->mStatistics.frameSkips++;
+			self->trace ( kAUATraceFellBehind, curUSBFrameNumber, (UInt32)self->mUSBFrameToQueue );
             self->mUSBFrameToQueue = curUSBFrameNumber + kMinimumFrameOffset;
         }
     }
@@ -35,6 +35,7 @@
 #define _APPLEUSBAUDIOSTREAM_H
 
 #include <libkern/OSByteOrder.h>
+#include <libkern/OSAtomic.h>
 #include <libkern/c++/OSCollectionIterator.h>
 #include <libkern/c++/OSMetaClass.h>
 
@@ -95,11 +96,30 @@ class AppleUSBAudioDevice;
 
 #define kMaxFeedbackPollingInterval				512
 
-#define kSampleFractionAccumulatorRollover		65536 * 1000	// <rdar://problem/6954295> Fractional part of mSamplesPerPacket stored x 1000
+#define kSampleFractionAccumulatorRollover		( 65536 * 1000 )	// <rdar://problem/6954295> Fractional part of mSamplesPerPacket stored x 1000
 
 #define kMaxFilterSize							33				// <rdar://problem/7378275>
 #define kFilterScale							1024			// <rdar://problem/7378275>
 
+// Asynchronous feedback conditioning. The median filter size must be odd; the gains are expressed as right shifts.
+#define kFeedbackMedianFilterSize				5
+#define kFeedbackProportionalShift				3				// Proportional gain of 1/8
+#define kFeedbackIntegralShift					5				// Integral gain of 1/32
+
+// Adaptive safety offset. Completion lateness is binned in kLatenessHistogramBinWidth microsecond bins; the last bin collects everything later.
+#define kLatenessHistogramBins					64
+#define kLatenessHistogramBinWidth				125				// microseconds, so the histogram spans 8 ms
+#define kAdaptiveOffsetPercentile				999				// parts per thousand
+#define kAdaptiveOffsetMarginMicroseconds		250
+#define kAdaptiveOffsetMinimumCompletions		256				// completions measured before the offset is first adapted
+#define kAdaptiveOffsetUpdateInterval			1024			// minimum ms between offset changes
+
+#define kAdaptiveSampleOffsetDictionaryKey		"AdaptiveSampleOffset"
+#define kAdaptiveSampleOffsetKey				"SampleOffset"
+#define kHeuristicSampleOffsetKey				"HeuristicSampleOffset"
+#define kCompletionLatenessPercentileKey		"CompletionLatenessPercentileMicroseconds"
+#define kCompletionsMeasuredKey					"CompletionsMeasured"
+
 // <rdar://problem/6954295>
 typedef struct _IOAudioSamplesPerFrame {
     UInt32	whole;
@@ -109,6 +129,80 @@ typedef struct _IOAudioSamplesPerFrame {
 // <rdar://6411577> Overruns threshold in packets (about 2ms at 48kHz, close to the safety offset value)
 #define kOverrunsThreshold						100
 
+// Streaming health counters. These are always collected and are published to the registry from the workloop, so reading them
+// never stops the engine. Histogram bucket 0 counts zero, bucket n counts values in [2^(n-1), 2^n), and the last bucket collects the rest.
+#define kStatisticsHistogramBuckets				16
+
+typedef struct _AUAStreamStatistics {
+	UInt64	packets;
+	UInt64	bytes;
+	UInt32	shortPackets;
+	UInt32	overruns;
+	UInt32	errorPackets;
+	UInt32	frameSkips;						// "Fell behind!" - mUSBFrameToQueue had to be moved ahead of the bus
+	UInt32	frameListsNotAdvanced;			// completions that arrived after IOUSBFamily fell behind
+	UInt32	coalesceStarvations;			// CoalesceInputSamples () requests that couldn't be completely satisfied
+	UInt32	streamStarts;
+	UInt32	completionLatenessHistogram[kStatisticsHistogramBuckets];	// USB frames after the frame list was due
+	UInt32	queueDepthHistogram[kStatisticsHistogramBuckets];			// USB frames between the bus and mUSBFrameToQueue at completion
+} AUAStreamStatistics;
+
+#define kStreamStatisticsKey					"StreamStatistics"
+#define kStatisticsPacketsKey					"Packets"
+#define kStatisticsBytesKey						"Bytes"
+#define kStatisticsShortPacketsKey				"ShortPackets"
+#define kStatisticsOverrunsKey					"Overruns"
+#define kStatisticsErrorPacketsKey				"ErrorPackets"
+#define kStatisticsFrameSkipsKey				"FrameSkips"
+#define kStatisticsFrameListsNotAdvancedKey		"FrameListsNotAdvanced"
+#define kStatisticsCoalesceStarvationsKey		"CoalesceStarvations"
+#define kStatisticsStreamStartsKey				"StreamStarts"
+#define kStatisticsCompletionLatenessKey		"CompletionLatenessFramesLog2"
+#define kStatisticsQueueDepthKey				"QueueDepthFramesLog2"
+
+// Streaming trace ring. Records are written from the completion routines without locking: each writer claims a slot with an atomic
+// increment, zeroes the slot's sequence number, fills it in and then stores the sequence number. publishStreamTrace () copies the ring a
+// record at a time and zeroes the sequence number of any record it saw change during the copy, so a reader can drop records that were
+// being written, and can order the rest by sequence number. The ring is published as raw bytes (an AUATraceHeader followed by
+// kStreamTraceRecords AUATraceRecords, host byte order) under kStreamTraceKey. Tools/auatrace.c turns that into a timeline. The layouts
+// here must be kept in step with it.
+#define kStreamTraceRecords						1024			// power of two
+#define kStreamTraceMagic						0x41554154		// 'AUAT'
+#define kStreamTraceVersion						1
+#define kStreamTraceKey							"StreamTrace"
+
+enum {
+	kAUATraceStreamStart						= 1,			// args: first frame to queue, lock delay frames
+	kAUATraceStreamStop							= 2,
+	kAUATraceReadComplete						= 3,			// args: frame list, result, frames queued ahead of the bus
+	kAUATraceWriteComplete						= 4,			// args: frame list, result, frames queued ahead of the bus
+	kAUATraceFrameListNotAdvanced				= 5,			// args: frames queued ahead of the bus, frames expected
+	kAUATraceFellBehind							= 6,			// args: frame that was to be queued
+	kAUATraceCoalesce							= 7,			// args: bytes requested, buffer offset, on the CoreAudio thread
+	kAUATraceCoalesceStarved					= 8,			// args: bytes requested, bytes missing, frame list
+	kAUATraceTimeStamp							= 9,			// args: transaction index, filtered stamp difference (ns), pre-wrap bytes
+	kAUATraceFeedback							= 10			// args: result, raw feedback value, feedback size in bytes (3 = 10.14, 4 = 16.16)
+};
+
+typedef struct _AUATraceHeader {
+	UInt32	magic;
+	UInt16	version;
+	UInt16	recordSize;
+	UInt32	recordCount;
+	UInt32	direction;						// kIOAudioStreamDirectionOutput or kIOAudioStreamDirectionInput
+	UInt64	absoluteScale;					// this many absolute time units...
+	UInt64	nanosecondScale;				// ...are this many nanoseconds
+} AUATraceHeader;
+
+typedef struct _AUATraceRecord {
+	UInt32	sequence;						// 1-based; 0 while the record is being written
+	UInt16	event;
+	UInt16	reserved;
+	UInt64	timeStamp;						// absolute time
+	UInt32	usbFrame;						// low 32 bits of the USB frame number
+	UInt32	arg[3];
+} AUATraceRecord;
+
 class AppleUSBAudioEngine;
 class AppleUSBAudioPlugin;
 
@@ -142,6 +236,10 @@ public:
 	
 	virtual UInt32 getRateFromSamplesPerPacket ( IOAudioSamplesPerFrame samplesPerPacket );	//  <rdar://problem/6954295>
 	static void sampleRateHandler (void * target, void * parameter, IOReturn result, IOUSBIsocFrame * pFrames);
+	#if CONDITIONFEEDBACK
+	virtual void resetFeedbackConditioning ( void );
+	virtual IOAudioSamplesPerFrame conditionFeedbackValue ( IOAudioSamplesPerFrame requestedSamplesPerPacket );
+	#endif
 	#if PRIMEISOCINPUT
 	static void primeInputPipeHandler (void * object, void * parameter, IOReturn result, IOUSBLowLatencyIsocFrame * pFrames);
 	#endif
@@ -199,6 +297,11 @@ protected:
 	thread_call_t						mPluginInitThread;
 	AppleUSBAudioPlugin *				mPlugin;
 
+	thread_call_t						mPrepareThread;
+	IOLock *							mPrepareLock;
+	IOReturn							mPrepareResult;
+	bool								mPreparePending;
+
 	// UHCI additions
 	
 	UInt32								mSampleBufferSizeExtended;			
@@ -220,6 +323,13 @@ protected:
 	UInt32								mBufferOffset;
 	
 	IOAudioSamplesPerFrame				mSamplesPerPacket;				// store this as a 16.16 value <rdar://problem/6954295>
+#if CONDITIONFEEDBACK
+	UInt64								mFeedbackHistory[kFeedbackMedianFilterSize];	// in 1/kSampleFractionAccumulatorRollover sample units
+	UInt32								mFeedbackHistoryIndex;
+	UInt32								mFeedbackHistoryCount;
+	UInt64								mFeedbackSmoothedValue;
+	SInt64								mFeedbackAccumulatedError;
+#endif
 	
 	UInt32								mNumUSBFrameLists;
 	UInt32								mNumUSBFramesPerList;
@@ -234,6 +344,7 @@ protected:
 	#endif
 	UInt16								mSampleSize;
 	UInt16								mSampleBitWidth;
+	UInt16								mMaxSamplesPerTransfer;		// what the isoc endpoint can carry in one (micro)frame across all of its transactions
 	UInt32								mNumChannels;
 	UInt16								mFramesUntilRefresh;
 	UInt8								mInterfaceNumber;
@@ -247,6 +358,7 @@ protected:
 	Boolean								mTerminatingDriver;
 	Boolean								mUHCISupport;
 	OSArray *							mActiveClockPath;
+	bool								mSampleRateOnlyChange;			// last controlledFormatChange () only changed the rate and the clock reported valid
 
 	Boolean								mNeedTimeStamps;
 	bool								mHaveTakenFirstTimeStamp;
@@ -254,6 +366,24 @@ protected:
 	bool								mGeneratesOverruns;
 	UInt32								mOverrunsCount;			// <rdar://6902105>
 	UInt32								mOverrunsThreshold;		// <rdar://6411577>
+	AUAStreamStatistics					mStatistics;
+	UInt32								mStatisticsPublishCounter;
+	#if STREAMTRACE
+	AUATraceRecord *					mTraceRing;
+	volatile SInt32						mTraceSequence;
+	UInt32								mTraceGlitches;					// glitch counters when the ring was last published
+	#endif
+
+#if ADAPTIVESAMPLEOFFSET
+	UInt32								mLatenessHistogram[kLatenessHistogramBins];
+	UInt32								mLatenessCompletionCount;
+	UInt32								mAdaptiveBaseSampleOffset;		// structural minimum, before any allowance for lateness
+	UInt32								mHeuristicSampleOffset;			// what updateSampleOffsetAndLatency () would have set
+	UInt32								mAdaptiveSampleOffset;
+	UInt32								mLatenessPercentile_micros;
+	UInt64								mLastAdaptiveOffsetUpdate_nanos;
+	bool								mSampleOffsetOverridden;		// the vendor specific kext supplied an offset, so don't adapt
+#endif
 		
 	UInt64								mNumSampleRateFeedbackChangesCounter;
 	UInt64								mNumSampleRateFeedbackEqualCounter;
@@ -275,12 +405,54 @@ protected:
 		return (UInt32)((((UInt64) a) * ((UInt64) b)) >> 16);
 	}
 
+	inline void trace(UInt16 event, UInt64 usbFrame, UInt32 arg0 = 0, UInt32 arg1 = 0, UInt32 arg2 = 0)
+	{
+		#if STREAMTRACE
+		AbsoluteTime		now;
+		AUATraceRecord *	record;
+		UInt32				sequence;
+
+		if ( NULL != mTraceRing )
+		{
+			sequence = (UInt32)OSIncrementAtomic ( &mTraceSequence ) + 1;
+			record = &mTraceRing[sequence & ( kStreamTraceRecords - 1 )];
+			// OSSynchronizeIO only orders device memory and is empty on x86, so the stores need a real barrier against publishStreamTrace.
+			record->sequence = 0;
+			OSMemoryBarrier ();
+			clock_get_uptime ( &now );
+			record->event = event;
+			record->timeStamp = AbsoluteTime_to_scalar ( &now );
+			record->usbFrame = (UInt32)usbFrame;
+			record->arg[0] = arg0;
+			record->arg[1] = arg1;
+			record->arg[2] = arg2;
+			OSMemoryBarrier ();
+			record->sequence = sequence;
+		}
+		#endif
+	}
+
+	static inline UInt32 statisticsBucket(SInt64 value)
+	{
+		UInt32	bucket = 0;
+
+		while ( ( value > 0 ) && ( bucket < kStatisticsHistogramBuckets - 1 ) )
+		{
+			value >>= 1;
+			bucket++;
+		}
+		return bucket;
+	}
+
 	IOReturn	PrepareWriteFrameList (UInt32 usbFrameListIndex);
 	IOReturn	PrepareAndReadFrameLists (UInt8 sampleSize, UInt8 numChannels, UInt32 usbFrameListIndex);
 	IOReturn	setSampleRateControl (UInt8 address, UInt32 sampleRate);
 	IOReturn	addAvailableFormats (AUAConfigurationDictionary * configDictionary);
+	UInt32		getMaxSampleRateForEndpoint (AUAConfigurationDictionary * configDictionary, UInt8 altSettingID, UInt32 bytesPerSampleFrame);
+	bool		clockPathSetByOtherStream (OSArray * clockPath, UInt32 sampleRate);
 	IOReturn	checkForFeedbackEndpoint (AUAConfigurationDictionary * configDictionary);
 	
+	virtual UInt64	getCurrentUSBFrameNumber (void);
 	void		queueInputFrames (void);
 	void		queueOutputFrames (void);
 	UInt16		getAlternateFrameSize (void);
@@ -300,6 +472,9 @@ protected:
     virtual IOReturn writeFrameList (UInt32 frameListNum);
 
 	virtual IOReturn prepareUSBStream (void);
+	void		beginPrepareUSBStream (void);
+	IOReturn	completePrepareUSBStream (void);
+	static void	prepareUSBStreamThread (AppleUSBAudioStream * usbAudioStreamObject);
     virtual IOReturn startUSBStream (UInt64 currentUSBFrame, UInt32 usbFramesToDelay);
     virtual IOReturn stopUSBStream ();
 
@@ -310,6 +485,19 @@ protected:
 	virtual	IOReturn controlledFormatChange (const IOAudioStreamFormat *newFormat, const IOAudioSampleRate *newSampleRate);
 	void calculateSamplesPerPacket (UInt32 sampleRate, UInt16 * averageFrameSize, UInt16 * additionalSampleFrameFreq);
 	void updateSampleOffsetAndLatency (void);
+	#if ADAPTIVESAMPLEOFFSET
+	void resetCompletionLateness (void);
+	void recordCompletionLateness (UInt32 frameListIndex);
+	void updateAdaptiveSampleOffset (void);
+	UInt32 getAdaptiveSampleOffset (bool * adapted);
+	#endif
+	static void setNumberInDictionary (OSDictionary * dictionary, const char * key, UInt64 value);
+	void		recordCompletionStatistics (UInt32 frameListIndex, UInt64 currentUSBFrameNumber);
+	void		recordInputPacketStatistics (IOUSBLowLatencyIsocFrame * pFrames);
+	#if STREAMTRACE
+	void		publishStreamTrace (bool onlyAfterGlitch);
+	#endif
+	void		publishStreamStatistics (void);
 	#if DEBUGLATENCY
 	virtual UInt64 getQueuedFrameForSample (UInt32 sampleFrame);
 	#endif
@@ -0,0 +1,275 @@
+/*
+ * Copyright (c) 1998-2010 Apple Computer, Inc. All rights reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this
+ * file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+//--------------------------------------------------------------------------------
+//
+//	File:		auatrace.c
+//
+//	Contains:	Decoder for the StreamTrace property published by AppleUSBAudioStream
+//
+//	Technology:	OS X
+//
+//	Build:		cc -o auatrace auatrace.c
+//
+//	Usage:		auatrace [file]
+//
+//				The input is either the raw property bytes or base64 text, such as the
+//				<data> payload of "ioreg -r -c AppleUSBAudioStream -k StreamTrace -a".
+//				Whitespace and anything outside the base64 alphabet is skipped, so the
+//				payload can be pasted as is. Reads standard input when no file is given.
+//
+//--------------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// These must match AUATraceHeader and AUATraceRecord in AppleUSBAudioStream.h.
+#define kStreamTraceMagic		0x41554154
+#define kStreamTraceVersion		1
+
+typedef struct {
+	uint32_t	magic;
+	uint16_t	version;
+	uint16_t	recordSize;
+	uint32_t	recordCount;
+	uint32_t	direction;
+	uint64_t	absoluteScale;
+	uint64_t	nanosecondScale;
+} AUATraceHeader;
+
+typedef struct {
+	uint32_t	sequence;
+	uint16_t	event;
+	uint16_t	reserved;
+	uint64_t	timeStamp;
+	uint32_t	usbFrame;
+	uint32_t	arg[3];
+} AUATraceRecord;
+
+static const char * sEventNames[] = {
+	"?",
+	"StreamStart",
+	"StreamStop",
+	"ReadComplete",
+	"WriteComplete",
+	"FrameListNotAdvanced",
+	"FellBehind",
+	"Coalesce",
+	"CoalesceStarved",
+	"TimeStamp",
+	"Feedback"
+};
+
+static int base64Value (int c)
+{
+	if (c >= 'A' && c <= 'Z') return c - 'A';
+	if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+	if (c >= '0' && c <= '9') return c - '0' + 52;
+	if (c == '+') return 62;
+	if (c == '/') return 63;
+	return -1;
+}
+
+// Decodes in place and returns the decoded length. Stops at the first '='.
+static size_t base64Decode (unsigned char * buffer, size_t length)
+{
+	size_t		out = 0;
+	uint32_t	accumulator = 0;
+	int			bits = 0;
+	int			value;
+
+	for (size_t i = 0; i < length && '=' != buffer[i]; i++)
+	{
+		value = base64Value (buffer[i]);
+		if (value < 0)
+		{
+			continue;
+		}
+		accumulator = (accumulator << 6) | (uint32_t)value;
+		bits += 6;
+		if (bits >= 8)
+		{
+			bits -= 8;
+			buffer[out++] = (unsigned char)(accumulator >> bits);
+		}
+	}
+	return out;
+}
+
+// ioreg -a wraps the payload in a plist; keep only what is between <data> and </data> if present.
+static size_t extractPlistData (unsigned char * buffer, size_t length)
+{
+	char *		start;
+	char *		end;
+	size_t		dataLength;
+
+	buffer[length] = 0;
+	start = strstr ((char *)buffer, "<data>");
+	if (NULL == start)
+	{
+		return length;
+	}
+	start += strlen ("<data>");
+	end = strstr (start, "</data>");
+	dataLength = (NULL == end) ? strlen (start) : (size_t)(end - start);
+	memmove (buffer, start, dataLength);
+	return dataLength;
+}
+
+static int compareSequence (const void * a, const void * b)
+{
+	uint32_t	sa = ((const AUATraceRecord *)a)->sequence;
+	uint32_t	sb = ((const AUATraceRecord *)b)->sequence;
+
+	// Sequence numbers are 32 bits; compare by signed distance so a wrap still sorts in order.
+	return (int32_t)(sa - sb) < 0 ? -1 : ((sa == sb) ? 0 : 1);
+}
+
+static void printArgs (const AUATraceRecord * record)
+{
+	switch (record->event)
+	{
+		case 1:		printf ("queue=%u delay=%u", record->arg[0], record->arg[1]); break;
+		case 3:
+		case 4:		printf ("list=%u result=0x%x ahead=%d", record->arg[0], record->arg[1], (int32_t)record->arg[2]); break;
+		case 5:		printf ("ahead=%d expected=%d", (int32_t)record->arg[0], (int32_t)record->arg[1]); break;
+		case 6:		printf ("queue=%u", record->arg[0]); break;
+		case 7:		printf ("bytes=%u offset=%u coreaudio=%u", record->arg[0], record->arg[1], record->arg[2]); break;
+		case 8:		printf ("bytes=%u missing=%d list=%u", record->arg[0], (int32_t)record->arg[1], record->arg[2]); break;
+		case 9:		printf ("transaction=%d stampDifference=%uns preWrap=%u", (int32_t)record->arg[0], record->arg[1], record->arg[2]); break;
+		case 10:	printf ("result=0x%x raw=0x%08x size=%u", record->arg[0], record->arg[1], record->arg[2]); break;
+		default:	break;
+	}
+}
+
+int main (int argc, char * argv[])
+{
+	FILE *				input = stdin;
+	unsigned char *		buffer = NULL;
+	size_t				length = 0;
+	size_t				capacity = 0;
+	size_t				bytesRead;
+	AUATraceHeader		header;
+	AUATraceRecord *	records;
+	uint32_t			count = 0;
+	uint64_t			firstNanos = 0;
+	uint64_t			lastNanos = 0;
+	uint64_t			nanos;
+
+	if (argc > 2)
+	{
+		fprintf (stderr, "usage: %s [file]\n", argv[0]);
+		return 1;
+	}
+	if (2 == argc && NULL == (input = fopen (argv[1], "rb")))
+	{
+		perror (argv[1]);
+		return 1;
+	}
+
+	do
+	{
+		if (capacity - length < 4096)
+		{
+			capacity = capacity ? capacity * 2 : 65536;
+			if (NULL == (buffer = realloc (buffer, capacity + 1)))
+			{
+				fprintf (stderr, "out of memory\n");
+				return 1;
+			}
+		}
+		bytesRead = fread (buffer + length, 1, capacity - length, input);
+		length += bytesRead;
+	} while (bytesRead > 0);
+
+	if (length < sizeof (header) || kStreamTraceMagic != *(uint32_t *)buffer)
+	{
+		length = base64Decode (buffer, extractPlistData (buffer, length));
+	}
+	if (length < sizeof (header))
+	{
+		fprintf (stderr, "input too short for a trace header\n");
+		return 1;
+	}
+
+	memcpy (&header, buffer, sizeof (header));
+	if (kStreamTraceMagic != header.magic || kStreamTraceVersion != header.version || sizeof (AUATraceRecord) != header.recordSize)
+	{
+		fprintf (stderr, "not a version %d StreamTrace (magic 0x%08x version %u record size %u)\n", kStreamTraceVersion, header.magic, header.version, header.recordSize);
+		return 1;
+	}
+	if (0 == header.absoluteScale)
+	{
+		header.absoluteScale = header.nanosecondScale = 1;
+	}
+	if (length < sizeof (header) + (size_t)header.recordCount * sizeof (AUATraceRecord))
+	{
+		header.recordCount = (uint32_t)((length - sizeof (header)) / sizeof (AUATraceRecord));
+	}
+
+	// Compact out slots that were never written or were being written when the ring was copied.
+	records = (AUATraceRecord *)(buffer + sizeof (header));
+	for (uint32_t i = 0; i < header.recordCount; i++)
+	{
+		AUATraceRecord	record;
+
+		memcpy (&record, &records[i], sizeof (record));
+		if (0 != record.sequence)
+		{
+			memcpy (&records[count++], &record, sizeof (record));
+		}
+	}
+	qsort (records, count, sizeof (AUATraceRecord), compareSequence);
+
+	printf ("# %s stream, %u of %u records\n", (1 == header.direction) ? "input" : "output", count, header.recordCount);
+	printf ("# %10s %12s %10s %10s  %-22s %s\n", "seq", "time(us)", "delta(us)", "usbFrame", "event", "args");
+
+	for (uint32_t i = 0; i < count; i++)
+	{
+		const AUATraceRecord *	record = &records[i];
+
+		nanos = (uint64_t)(((long double)record->timeStamp * header.nanosecondScale) / header.absoluteScale);
+		if (0 == i)
+		{
+			firstNanos = lastNanos = nanos;
+		}
+		if (i > 0 && record->sequence != records[i - 1].sequence + 1)
+		{
+			printf ("# %u records lost\n", record->sequence - records[i - 1].sequence - 1);
+		}
+		printf ("  %10u %12.3f %10.3f %10u  %-22s ", record->sequence, (int64_t)(nanos - firstNanos) / 1000.0, (int64_t)(nanos - lastNanos) / 1000.0, record->usbFrame,
+				(record->event < sizeof (sEventNames) / sizeof (sEventNames[0])) ? sEventNames[record->event] : sEventNames[0]);
+		printArgs (record);
+		printf ("\n");
+		lastNanos = nanos;
+	}
+
+	free (buffer);
+	if (stdin != input)
+	{
+		fclose (input);
+	}
+	return 0;
+}
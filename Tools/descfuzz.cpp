@@ -0,0 +1,832 @@
+/*
+ * Copyright (c) 1998-2010 Apple Computer, Inc. All rights reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this
+ * file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+//--------------------------------------------------------------------------------
+//
+//	File:		descfuzz.cpp
+//
+//	Contains:	Fuzz target, corpus and throughput benchmark for the configuration descriptor
+//				parser. The driver sources are built unchanged against the shim in kernshim/,
+//				whose IOMalloc () is malloc (), so built with AddressSanitizer a read past the
+//				parser's copy of the descriptor stops the run.
+//
+//				The seeds are built here: a USB Audio 1.0 device with one of every unit, an
+//				interrupt endpoint, discrete, continuous, MPEG and AC-3 alternate settings, a
+//				MIDI, a HID and a second audio control interface, and a USB Audio 2.0 device
+//				with an association descriptor, clocks, an effect unit and decoders. The seeds
+//				have to parse into what they describe. Then every seed is cut off at every
+//				length, the regression inputs (descriptors that are short for their type or
+//				that run past the configuration) and any corpus named on the command line are
+//				replayed, and the seeds are mutated for a while.
+//
+//				The corpus files named device-* hold configuration descriptors transcribed from real
+//				devices, a C-Media CM108 USB Audio 1.0 headset and an XMOS USB Audio 2.0 DAC.
+//				-w doesn't write them, and they have to parse.
+//
+//				-b times the parser on the seeds and on the device-* files named instead, and
+//				counts what each parse allocates with IOMalloc () and as OSObjects. -w writes
+//				the seeds and regression inputs out as a corpus, one file each, for this or for
+//				libFuzzer; built with -DDESCFUZZ_LIBFUZZER there's no main () and
+//				LLVMFuzzerTestOneInput () is the entry point.
+//
+//	Technology:	OS X
+//
+//	Build:		c++ -std=gnu++11 -fpermissive -w -fsanitize=address -g -I Tools/kernshim/include -I Tools/kernshim -I . -o descfuzz \
+//					Tools/descfuzz.cpp Tools/kernshim/*.cpp AppleUSBAudio*.cpp BigNum.cpp -lpthread
+//
+//				clang++ -std=gnu++11 -fpermissive -w -fsanitize=fuzzer,address -g -DDESCFUZZ_LIBFUZZER -I Tools/kernshim/include \
+//					-I Tools/kernshim -I . -o descfuzz Tools/descfuzz.cpp Tools/kernshim/*.cpp AppleUSBAudio*.cpp BigNum.cpp -lpthread
+//
+//				Drop -fsanitize for -b; the numbers are otherwise mostly the sanitizer's.
+//
+//	Usage:		descfuzz [-n mutations] [-s seed] [-b] [-t ms] [-w corpus dir] [-v] [corpus file or dir ...]
+//
+//				Exits non-zero if any check fails.
+//
+//--------------------------------------------------------------------------------
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "AppleUSBAudioDictionary.h"
+
+#pragma mark -Options-
+
+typedef struct {
+	UInt32						numMutations;
+	UInt32						seed;
+	bool						benchmark;
+	UInt32						benchmarkMS;
+	const char *				corpusDir;
+	bool						verbose;
+} FuzzOptions;
+
+static FuzzOptions				sOptions = { 200000, 1, false, 1000, NULL, false };
+
+typedef std::vector<UInt8>		FuzzInput;
+
+#pragma mark -Target-
+
+// Finds the first audio control interface the way the driver is handed it, without trusting anything about the bytes.
+static UInt8 fuzzControlInterfaceNum (const UInt8 * bytes, size_t length) {
+	size_t							offset = 0;
+
+	while (offset + sizeof (USBInterfaceDescriptor) <= length && 0 != bytes[offset])
+	{
+		if (INTERFACE == bytes[offset + 1] && AUDIO == bytes[offset + 5] && AUDIOCONTROL == bytes[offset + 6])
+		{
+			return bytes[offset + 2];
+		}
+		offset += bytes[offset];
+	}
+	return 0;
+}
+
+// Parses one configuration. wTotalLength is held to the bytes there are and the copy is exactly that big, so anything the parser
+// reads beyond what the device sent is out of bounds. Returns whether it came back with a dictionary.
+static bool fuzzParse (const UInt8 * data, size_t size) {
+	AUAConfigurationDictionary *	configDictionary;
+	UInt8 *							bytes;
+	UInt16							totalLength;
+
+	if (size < sizeof (IOUSBConfigurationDescriptor))
+	{
+		return false;
+	}
+	bytes = (UInt8 *) malloc (size);
+	memcpy (bytes, data, size);
+	totalLength = (UInt16) (bytes[2] | (bytes[3] << 8));
+	if (totalLength > size)
+	{
+		totalLength = (size > 0xFFFF) ? 0xFFFF : (UInt16) size;
+		bytes[2] = totalLength & 0xFF;
+		bytes[3] = (totalLength >> 8) & 0xFF;
+	}
+
+	configDictionary = AUAConfigurationDictionary::create ((const IOUSBConfigurationDescriptor *) bytes, fuzzControlInterfaceNum (bytes, totalLength));
+	if (NULL != configDictionary)
+	{
+		configDictionary->release ();
+	}
+	free (bytes);
+	return NULL != configDictionary;
+}
+
+#ifdef DESCFUZZ_LIBFUZZER
+
+extern "C" int LLVMFuzzerTestOneInput (const uint8_t * data, size_t size) {
+	fuzzParse (data, size);
+	return 0;
+}
+
+#else
+
+#pragma mark -Seeds-
+
+// USB Audio 1.0: speaker through every kind of unit, and a microphone. Interfaces 1 and 2 stream; 3 is MIDI, 4 is HID, 5 is a second
+// audio control interface the parser skips by its header's wTotalLength, and 6 streams for it.
+static const UInt8 sSeedAudio10[] = {
+	0x09, 0x02, 0x00, 0x00, 0x07, 0x01, 0x00, 0x80, 0x32,
+	// Audio control interface, with an interrupt endpoint
+	0x09, 0x04, 0x00, 0x00, 0x01, 0x01, 0x01, 0x00, 0x00,
+	0x0A, 0x24, 0x01, 0x00, 0x01, 0x74, 0x00, 0x02, 0x01, 0x02,
+	0x0C, 0x24, 0x02, 0x01, 0x01, 0x01, 0x00, 0x02, 0x03, 0x00, 0x00, 0x00,
+	0x0A, 0x24, 0x06, 0x02, 0x01, 0x01, 0x01, 0x02, 0x02, 0x00,
+	0x0D, 0x24, 0x04, 0x03, 0x02, 0x01, 0x02, 0x02, 0x03, 0x00, 0x00, 0xFF, 0x00,
+	0x08, 0x24, 0x05, 0x04, 0x02, 0x02, 0x03, 0x00,
+	0x12, 0x24, 0x07, 0x05, 0x01, 0x00, 0x01, 0x04, 0x02, 0x03, 0x00, 0x00, 0x01, 0x01, 0x00, 0x01, 0x03, 0x00,
+	0x0F, 0x24, 0x08, 0x06, 0x34, 0x12, 0x01, 0x05, 0x02, 0x03, 0x00, 0x00, 0x01, 0x01, 0x00,
+	0x09, 0x24, 0x03, 0x07, 0x01, 0x03, 0x00, 0x06, 0x00,
+	0x0C, 0x24, 0x02, 0x08, 0x01, 0x02, 0x00, 0x01, 0x01, 0x00, 0x00, 0x00,
+	0x09, 0x24, 0x03, 0x09, 0x01, 0x01, 0x00, 0x08, 0x00,
+	0x09, 0x05, 0x83, 0x03, 0x02, 0x00, 0x20, 0x00, 0x00,
+	// Output streaming interface: three discrete rates, then a continuous range on a 7 byte endpoint
+	0x09, 0x04, 0x01, 0x00, 0x00, 0x01, 0x02, 0x00, 0x00,
+	0x09, 0x04, 0x01, 0x01, 0x01, 0x01, 0x02, 0x00, 0x00,
+	0x07, 0x24, 0x01, 0x01, 0x01, 0x01, 0x00,
+	0x11, 0x24, 0x02, 0x01, 0x02, 0x02, 0x10, 0x03, 0x44, 0xAC, 0x00, 0x80, 0xBB, 0x00, 0x00, 0x77, 0x01,
+	0x09, 0x05, 0x01, 0x09, 0xC8, 0x00, 0x01, 0x00, 0x00,
+	0x07, 0x25, 0x01, 0x01, 0x00, 0x00, 0x00,
+	0x09, 0x04, 0x01, 0x02, 0x01, 0x01, 0x02, 0x00, 0x00,
+	0x07, 0x24, 0x01, 0x01, 0x01, 0x01, 0x00,
+	0x0E, 0x24, 0x02, 0x01, 0x02, 0x03, 0x18, 0x00, 0x44, 0xAC, 0x00, 0x00, 0x77, 0x01,
+	0x07, 0x05, 0x01, 0x09, 0x2C, 0x01, 0x01,
+	0x07, 0x25, 0x01, 0x01, 0x00, 0x00, 0x00,
+	// Input streaming interface: PCM, MPEG and AC-3
+	0x09, 0x04, 0x02, 0x00, 0x00, 0x01, 0x02, 0x00, 0x00,
+	0x09, 0x04, 0x02, 0x01, 0x01, 0x01, 0x02, 0x00, 0x00,
+	0x07, 0x24, 0x01, 0x09, 0x01, 0x01, 0x00,
+	0x0B, 0x24, 0x02, 0x01, 0x02, 0x02, 0x10, 0x01, 0x80, 0xBB, 0x00,
+	0x09, 0x05, 0x82, 0x05, 0xC8, 0x00, 0x01, 0x00, 0x00,
+	0x07, 0x25, 0x01, 0x01, 0x00, 0x00, 0x00,
+	0x09, 0x04, 0x02, 0x02, 0x01, 0x01, 0x02, 0x00, 0x00,
+	0x07, 0x24, 0x01, 0x09, 0x01, 0x01, 0x10,
+	0x0C, 0x24, 0x02, 0x02, 0x80, 0x01, 0x00, 0x04, 0x01, 0x80, 0xBB, 0x00,
+	0x08, 0x24, 0x03, 0x01, 0x10, 0x00, 0x00, 0x00,
+	0x09, 0x05, 0x82, 0x05, 0xC8, 0x00, 0x01, 0x00, 0x00,
+	0x07, 0x25, 0x01, 0x01, 0x00, 0x00, 0x00,
+	0x09, 0x04, 0x02, 0x03, 0x01, 0x01, 0x02, 0x00, 0x00,
+	0x07, 0x24, 0x01, 0x09, 0x01, 0x02, 0x10,
+	0x0C, 0x24, 0x02, 0x02, 0x80, 0x01, 0x00, 0x06, 0x01, 0x80, 0xBB, 0x00,
+	0x0A, 0x24, 0x03, 0x02, 0x10, 0xFF, 0xFF, 0xFF, 0xFF, 0x00,
+	0x09, 0x05, 0x82, 0x05, 0xC8, 0x00, 0x01, 0x00, 0x00,
+	0x07, 0x25, 0x01, 0x01, 0x00, 0x00, 0x00,
+	// MIDI streaming interface
+	0x09, 0x04, 0x03, 0x00, 0x00, 0x01, 0x03, 0x00, 0x00,
+	0x07, 0x24, 0x01, 0x00, 0x01, 0x07, 0x00,
+	// HID interface
+	0x09, 0x04, 0x04, 0x00, 0x01, 0x03, 0x00, 0x00, 0x00,
+	0x09, 0x21, 0x11, 0x01, 0x00, 0x01, 0x22, 0x20, 0x00,
+	0x07, 0x05, 0x84, 0x03, 0x08, 0x00, 0x0A,
+	// Another audio function's control and streaming interfaces
+	0x09, 0x04, 0x05, 0x00, 0x00, 0x01, 0x01, 0x00, 0x00,
+	0x09, 0x24, 0x01, 0x00, 0x01, 0x1E, 0x00, 0x01, 0x06,
+	0x0C, 0x24, 0x02, 0x01, 0x01, 0x01, 0x00, 0x02, 0x03, 0x00, 0x00, 0x00,
+	0x09, 0x24, 0x03, 0x02, 0x01, 0x03, 0x00, 0x01, 0x00,
+	0x09, 0x04, 0x06, 0x00, 0x00, 0x01, 0x02, 0x00, 0x00,
+};
+
+// USB Audio 2.0: two clock sources behind a selector and a multiplier, a speaker through every kind of unit, and a microphone.
+// Interface 2 also has an MPEG and an AC-3 decoder setting.
+static const UInt8 sSeedAudio20[] = {
+	0x09, 0x02, 0x00, 0x00, 0x03, 0x01, 0x00, 0x80, 0x32,
+	0x08, 0x0B, 0x00, 0x03, 0x01, 0x00, 0x20, 0x00,
+	// Audio control interface, with an interrupt endpoint
+	0x09, 0x04, 0x00, 0x00, 0x01, 0x01, 0x01, 0x20, 0x00,
+	0x09, 0x24, 0x01, 0x00, 0x02, 0x08, 0xC2, 0x00, 0x00,
+	0x08, 0x24, 0x0A, 0x28, 0x03, 0x07, 0x00, 0x00,
+	0x08, 0x24, 0x0A, 0x29, 0x01, 0x01, 0x00, 0x00,
+	0x09, 0x24, 0x0B, 0x2A, 0x02, 0x28, 0x29, 0x03, 0x00,
+	0x07, 0x24, 0x0C, 0x2B, 0x2A, 0x00, 0x00,
+	0x11, 0x24, 0x02, 0x01, 0x01, 0x01, 0x00, 0x2B, 0x02, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x12, 0x24, 0x06, 0x02, 0x01, 0x0F, 0x00, 0x00, 0x00, 0x0F, 0x00, 0x00, 0x00, 0x0F, 0x00, 0x00, 0x00, 0x00,
+	0x0F, 0x24, 0x04, 0x03, 0x01, 0x02, 0x02, 0x03, 0x00, 0x00, 0x00, 0x00, 0xFF, 0x00, 0x00,
+	0x08, 0x24, 0x05, 0x04, 0x01, 0x03, 0x00, 0x00,
+	0x10, 0x24, 0x07, 0x05, 0x01, 0x00, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x16, 0x24, 0x08, 0x06, 0x01, 0x00, 0x01, 0x05, 0x02, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x03, 0x00, 0x00, 0x00,
+	0x10, 0x24, 0x09, 0x07, 0x34, 0x12, 0x01, 0x06, 0x02, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x0C, 0x24, 0x03, 0x08, 0x01, 0x03, 0x00, 0x07, 0x2B, 0x00, 0x00, 0x00,
+	0x11, 0x24, 0x02, 0x09, 0x01, 0x02, 0x00, 0x28, 0x02, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x0C, 0x24, 0x03, 0x0A, 0x01, 0x01, 0x00, 0x09, 0x28, 0x00, 0x00, 0x00,
+	0x07, 0x05, 0x83, 0x03, 0x06, 0x00, 0x04,
+	// Output streaming interface, asynchronous with a feedback endpoint
+	0x09, 0x04, 0x01, 0x00, 0x00, 0x01, 0x02, 0x20, 0x00,
+	0x09, 0x04, 0x01, 0x01, 0x02, 0x01, 0x02, 0x20, 0x00,
+	0x10, 0x24, 0x01, 0x01, 0x00, 0x01, 0x01, 0x00, 0x00, 0x00, 0x02, 0x03, 0x00, 0x00, 0x00, 0x00,
+	0x06, 0x24, 0x02, 0x01, 0x02, 0x10,
+	0x07, 0x05, 0x01, 0x05, 0xC8, 0x00, 0x01,
+	0x08, 0x25, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x07, 0x05, 0x81, 0x11, 0x04, 0x00, 0x04,
+	// Input streaming interface: PCM, then MPEG and AC-3 decoders
+	0x09, 0x04, 0x02, 0x00, 0x00, 0x01, 0x02, 0x20, 0x00,
+	0x09, 0x04, 0x02, 0x01, 0x01, 0x01, 0x02, 0x20, 0x00,
+	0x10, 0x24, 0x01, 0x0A, 0x00, 0x01, 0x01, 0x00, 0x00, 0x00, 0x02, 0x03, 0x00, 0x00, 0x00, 0x00,
+	0x06, 0x24, 0x02, 0x01, 0x02, 0x10,
+	0x07, 0x05, 0x82, 0x05, 0xC8, 0x00, 0x01,
+	0x08, 0x25, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x09, 0x04, 0x02, 0x02, 0x01, 0x01, 0x02, 0x20, 0x00,
+	0x10, 0x24, 0x01, 0x0A, 0x00, 0x02, 0x03, 0x00, 0x00, 0x00, 0x02, 0x03, 0x00, 0x00, 0x00, 0x00,
+	0x08, 0x24, 0x02, 0x02, 0x80, 0x01, 0x00, 0x04,
+	0x0A, 0x24, 0x04, 0x01, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x0C, 0x24, 0x04, 0x02, 0x03, 0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x00,
+	0x07, 0x05, 0x82, 0x05, 0xC8, 0x00, 0x01,
+	0x08, 0x25, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00,
+};
+
+typedef struct {
+	const char *				name;
+	const UInt8 *				bytes;
+	size_t						length;
+} FuzzSeed;
+
+static const FuzzSeed			sSeeds[] = {
+	{ "seed-audio10",	sSeedAudio10,	sizeof (sSeedAudio10) },
+	{ "seed-audio20",	sSeedAudio20,	sizeof (sSeedAudio20) },
+};
+
+#define kFuzzNumSeeds			(sizeof (sSeeds) / sizeof (sSeeds[0]))
+
+// Returns a seed with its wTotalLength filled in.
+static FuzzInput fuzzSeedInput (UInt32 seedIndex) {
+	FuzzInput						input (sSeeds[seedIndex].bytes, sSeeds[seedIndex].bytes + sSeeds[seedIndex].length);
+
+	input[2] = input.size () & 0xFF;
+	input[3] = (input.size () >> 8) & 0xFF;
+	return input;
+}
+
+// Returns the offset of the first descriptor in a seed with this type and, for class specific ones, subtype, inside an interface of this
+// subclass; the audio control and streaming subtypes overlap. The IAD comes before any interface, so its subclass is 0.
+static size_t fuzzFindDescriptor (const FuzzInput & input, UInt8 interfaceSubClass, UInt8 descriptorType, UInt8 descriptorSubtype) {
+	size_t							offset = 0;
+	UInt8							currentSubClass = 0;
+
+	while (offset + 2 < input.size () && 0 != input[offset])
+	{
+		if (INTERFACE == input[offset + 1])
+		{
+			currentSubClass = input[offset + 6];
+		}
+		if (interfaceSubClass == currentSubClass && descriptorType == input[offset + 1] && (CS_INTERFACE != descriptorType || descriptorSubtype == input[offset + 2]))
+		{
+			return offset;
+		}
+		offset += input[offset];
+	}
+	fprintf (stderr, "descfuzz: no descriptor 0x%02x/0x%02x in a seed\n", descriptorType, descriptorSubtype);
+	exit (2);
+}
+
+#pragma mark -Regressions-
+
+// Descriptors that are short for what they claim to be, or that run off the end of the configuration. Each sets one byte of a seed.
+// Most leave a configuration with what was parsed before the bad descriptor; without a control header there is nothing worth
+// having, and the parse fails.
+typedef struct {
+	const char *				name;
+	UInt32						seedIndex;
+	UInt8						interfaceSubClass;
+	UInt8						descriptorType;
+	UInt8						descriptorSubtype;
+	UInt32						byteOffset;
+	UInt8						value;
+	bool						parses;
+} FuzzRegression;
+
+static const FuzzRegression		sRegressions[] = {
+	{ "short-header",					0,	AUDIOCONTROL,	CS_INTERFACE,	HEADER,				0,	0x06,	false },
+	{ "short-header-collection",		0,	AUDIOCONTROL,	CS_INTERFACE,	HEADER,				7,	0x40,	false },	// bInCollection past bLength
+	{ "header-total-length-past-end",	0,	AUDIOCONTROL,	CS_INTERFACE,	HEADER,				5,	0xFF,	true },		// not used to skip the interface being parsed
+	{ "short-input-terminal",			0,	AUDIOCONTROL,	CS_INTERFACE,	INPUT_TERMINAL,		0,	0x03,	true },
+	{ "short-feature-unit",				0,	AUDIOCONTROL,	CS_INTERFACE,	FEATURE_UNIT,		0,	0x05,	true },
+	{ "short-mixer-unit",				0,	AUDIOCONTROL,	CS_INTERFACE,	MIXER_UNIT,			4,	0x20,	true },		// bNrInPins past bLength
+	{ "short-selector-unit",			0,	AUDIOCONTROL,	CS_INTERFACE,	SELECTOR_UNIT,		4,	0xFF,	true },
+	{ "short-processing-unit",			0,	AUDIOCONTROL,	CS_INTERFACE,	PROCESSING_UNIT,	12,	0x40,	true },		// bControlSize past bLength
+	{ "short-extension-unit",			0,	AUDIOCONTROL,	CS_INTERFACE,	EXTENSION_UNIT,		6,	0x30,	true },
+	{ "short-interrupt-endpoint",		0,	AUDIOCONTROL,	ENDPOINT,		0,					0,	0x03,	true },
+	{ "short-control-interface",		0,	AUDIOCONTROL,	INTERFACE,		0,					0,	0x05,	true },
+	{ "zero-length-descriptor",			0,	AUDIOCONTROL,	CS_INTERFACE,	FEATURE_UNIT,		0,	0x00,	true },
+	{ "one-byte-descriptor",			0,	AUDIOCONTROL,	CS_INTERFACE,	FEATURE_UNIT,		0,	0x01,	true },
+	{ "short-as-general",				0,	AUDIOSTREAMING,	CS_INTERFACE,	AS_GENERAL,			0,	0x03,	true },
+	{ "short-format-type",				0,	AUDIOSTREAMING,	CS_INTERFACE,	FORMAT_TYPE,		0,	0x04,	true },
+	{ "short-format-type-rates",		0,	AUDIOSTREAMING,	CS_INTERFACE,	FORMAT_TYPE,		7,	0x50,	true },		// bSamFreqType past bLength
+	{ "short-format-specific",			0,	AUDIOSTREAMING,	CS_INTERFACE,	FORMAT_SPECIFIC,	0,	0x06,	true },
+	{ "short-streaming-endpoint",		0,	AUDIOSTREAMING,	ENDPOINT,		0,					0,	0x05,	true },
+	{ "short-cs-endpoint",				0,	AUDIOSTREAMING,	CS_ENDPOINT,	0,					0,	0x04,	true },
+	{ "short-iad",						1,	0,				INTERFACE_ASSOCIATION,	0,			0,	0x04,	true },
+	{ "short-clock-source",				1,	AUDIOCONTROL,	CS_INTERFACE,	USBAUDIO_0200::CLOCK_SOURCE,	0,	0x05,	true },
+	{ "short-clock-selector",			1,	AUDIOCONTROL,	CS_INTERFACE,	USBAUDIO_0200::CLOCK_SELECTOR,	4,	0x30,	true },
+	{ "short-effect-unit",				1,	AUDIOCONTROL,	CS_INTERFACE,	USBAUDIO_0200::EFFECT_UNIT,		0,	0x05,	true },
+	{ "short-as-general-20",			1,	AUDIOSTREAMING,	CS_INTERFACE,	USBAUDIO_0200::AS_GENERAL,		0,	0x0A,	true },
+	{ "short-decoder-20",				1,	AUDIOSTREAMING,	CS_INTERFACE,	USBAUDIO_0200::DECODER,			0,	0x07,	true },
+	{ "short-cs-endpoint-20",			1,	AUDIOSTREAMING,	CS_ENDPOINT,	0,					0,	0x07,	true },
+};
+
+#define kFuzzNumRegressions		(sizeof (sRegressions) / sizeof (sRegressions[0]))
+
+static FuzzInput fuzzRegressionInput (UInt32 regressionIndex) {
+	const FuzzRegression *			regression = &sRegressions[regressionIndex];
+	FuzzInput						input = fuzzSeedInput (regression->seedIndex);
+
+	input[fuzzFindDescriptor (input, regression->interfaceSubClass, regression->descriptorType, regression->descriptorSubtype) + regression->byteOffset] = regression->value;
+	return input;
+}
+
+// The last descriptor of a seed claiming one byte more than the configuration has: the read past the end that used to get through.
+static FuzzInput fuzzOverrunInput (UInt32 seedIndex) {
+	FuzzInput						input = fuzzSeedInput (seedIndex);
+	size_t							offset = 0;
+
+	while (offset + input[offset] < input.size ())
+	{
+		offset += input[offset];
+	}
+	input[offset]++;
+	return input;
+}
+
+// The second audio control interface's header skipping past the end of the configuration.
+static FuzzInput fuzzSkipOverrunInput (void) {
+	FuzzInput						input = fuzzSeedInput (0);
+	size_t							offset = 0;
+	UInt32							headers = 0;
+
+	while (offset < input.size ())
+	{
+		if (CS_INTERFACE == input[offset + 1] && HEADER == input[offset + 2] && 2 == ++headers)
+		{
+			break;
+		}
+		offset += input[offset];
+	}
+	input[offset + 5] = 0xFF;
+	return input;
+}
+
+#pragma mark -Mutation-
+
+static const UInt8				sInterestingBytes[] = { 0x00, 0x01, 0x02, 0x03, 0x06, 0x07, 0x08, 0x09, 0x0B, 0x24, 0x25, 0x7F, 0x80, 0xFE, 0xFF };
+
+static UInt32 fuzzRandom (UInt32 limit) {
+	return (0 == limit) ? 0 : (UInt32) (random () % limit);
+}
+
+// Returns the offset of a randomly chosen descriptor header, walking the lengths as they now stand.
+static size_t fuzzRandomDescriptor (const FuzzInput & input) {
+	std::vector<size_t>				offsets;
+	size_t							offset = 0;
+
+	while (offset + 1 < input.size () && 0 != input[offset])
+	{
+		offsets.push_back (offset);
+		offset += input[offset];
+	}
+	return offsets.empty () ? 0 : offsets[fuzzRandom ((UInt32) offsets.size ())];
+}
+
+static void fuzzMutate (FuzzInput & input) {
+	UInt32							numMutations = 1 + fuzzRandom (4);
+	size_t							offset;
+	size_t							length;
+
+	for (UInt32 mutation = 0; mutation < numMutations && input.size () > sizeof (IOUSBConfigurationDescriptor); mutation++)
+	{
+		switch (fuzzRandom (7))
+		{
+			case 0:
+				input[fuzzRandom ((UInt32) input.size ())] = (UInt8) fuzzRandom (256);
+				break;
+			case 1:
+				input[fuzzRandom ((UInt32) input.size ())] = sInterestingBytes[fuzzRandom (sizeof (sInterestingBytes))];
+				break;
+			case 2:
+				// A descriptor's length, a little off or badly off.
+				offset = fuzzRandomDescriptor (input);
+				input[offset] = (0 == fuzzRandom (2)) ? (UInt8) (input[offset] + fuzzRandom (9) - 4) : sInterestingBytes[fuzzRandom (sizeof (sInterestingBytes))];
+				break;
+			case 3:
+				// A count or a size field inside a descriptor.
+				offset = fuzzRandomDescriptor (input);
+				length = (offset + input[offset] <= input.size ()) ? input[offset] : input.size () - offset;
+				if (length > 3)
+				{
+					input[offset + 3 + fuzzRandom ((UInt32) length - 3)] = sInterestingBytes[fuzzRandom (sizeof (sInterestingBytes))];
+				}
+				break;
+			case 4:
+				input.resize (sizeof (IOUSBConfigurationDescriptor) + fuzzRandom ((UInt32) (input.size () - sizeof (IOUSBConfigurationDescriptor))));
+				break;
+			case 5:
+				// Drop a descriptor.
+				offset = fuzzRandomDescriptor (input);
+				length = (offset + input[offset] <= input.size ()) ? input[offset] : 0;
+				if (0 != offset)
+				{
+					input.erase (input.begin () + offset, input.begin () + offset + length);
+				}
+				break;
+			case 6:
+				// Repeat a descriptor.
+				offset = fuzzRandomDescriptor (input);
+				length = (offset + input[offset] <= input.size ()) ? input[offset] : 0;
+				if (0 != offset && input.size () + length < 0xFFFF)
+				{
+					FuzzInput			descriptor (input.begin () + offset, input.begin () + offset + length);
+
+					input.insert (input.begin () + offset, descriptor.begin (), descriptor.end ());
+				}
+				break;
+		}
+	}
+	// Usually keep wTotalLength honest, so the parser gets past the configuration header and into the descriptors.
+	if (0 != fuzzRandom (4) && input.size () >= sizeof (IOUSBConfigurationDescriptor))
+	{
+		input[2] = input.size () & 0xFF;
+		input[3] = (input.size () >> 8) & 0xFF;
+	}
+}
+
+#pragma mark -Corpus-
+
+static bool fuzzReadFile (const char * path, FuzzInput & input) {
+	FILE *							file;
+	UInt8							buffer[4096];
+	size_t							count;
+
+	if (NULL == (file = fopen (path, "rb")))
+	{
+		return false;
+	}
+	input.clear ();
+	while (0 != (count = fread (buffer, 1, sizeof (buffer), file)))
+	{
+		input.insert (input.end (), buffer, buffer + count);
+	}
+	fclose (file);
+	return true;
+}
+
+static bool fuzzWriteFile (const char * dir, const char * name, const FuzzInput & input) {
+	std::string						path = std::string (dir) + "/" + name + ".bin";
+	FILE *							file;
+	bool							written;
+
+	if (NULL == (file = fopen (path.c_str (), "wb")))
+	{
+		return false;
+	}
+	written = (input.size () == fwrite (&input[0], 1, input.size (), file));
+	return (0 == fclose (file)) && written;
+}
+
+// Adds the files named, and the files in the directories named, in name order.
+static void fuzzCollectCorpus (const char * path, std::vector<std::string> & paths) {
+	struct stat						status;
+	struct dirent **				entries;
+	int								numEntries;
+
+	if (0 != stat (path, &status))
+	{
+		fprintf (stderr, "descfuzz: can't read %s\n", path);
+		exit (2);
+	}
+	if (!S_ISDIR (status.st_mode))
+	{
+		paths.push_back (path);
+		return;
+	}
+	numEntries = scandir (path, &entries, NULL, alphasort);
+	for (int index = 0; index < numEntries; index++)
+	{
+		if ('.' != entries[index]->d_name[0])
+		{
+			paths.push_back (std::string (path) + "/" + entries[index]->d_name);
+		}
+		free (entries[index]);
+	}
+	free (entries);
+}
+
+// Descriptors read from real devices are named device-*; unlike the rest of the corpus, they all have to parse.
+static bool fuzzIsDeviceCapture (const std::string & path) {
+	size_t							nameStart = path.rfind ('/');
+
+	nameStart = (std::string::npos == nameStart) ? 0 : nameStart + 1;
+	return 0 == path.compare (nameStart, 7, "device-");
+}
+
+#pragma mark -Checks-
+
+static UInt32					sFailures = 0;
+
+static void fuzzCheck (bool passed, const char * format, ...) {
+	va_list							arguments;
+
+	printf ("%s ", passed ? "  ok  " : "  FAIL");
+	va_start (arguments, format);
+	vprintf (format, arguments);
+	va_end (arguments);
+	printf ("\n");
+	if (!passed)
+	{
+		sFailures++;
+	}
+}
+
+static UInt32 fuzzArrayCount (OSArray * array) {
+	return (NULL != array) ? array->getCount () : 0;
+}
+
+// The seeds have to come out as the devices they describe, or the fuzzing starts from inputs the parser gives up on early.
+static void fuzzCheckSeeds (void) {
+	AUAConfigurationDictionary *	configDictionary;
+	AUASampleRateRanges				ranges;
+	FuzzInput						input;
+	IOReturn						result;
+	UInt16							format;
+	UInt8							count;
+	UInt8							address;
+
+	input = fuzzSeedInput (0);
+	configDictionary = AUAConfigurationDictionary::create ((const IOUSBConfigurationDescriptor *) &input[0], 0);
+	fuzzCheck (NULL != configDictionary, "%s parses", sSeeds[0].name);
+	if (NULL != configDictionary)
+	{
+		result = configDictionary->getNumAltSettings (&count, 1);
+		fuzzCheck (kIOReturnSuccess == result && 3 == count, "%s output interface has 3 alternate settings (%d)", sSeeds[0].name, count);
+		result = configDictionary->getNumAltSettings (&count, 2);
+		fuzzCheck (kIOReturnSuccess == result && 4 == count, "%s input interface has 4 alternate settings (%d)", sSeeds[0].name, count);
+		fuzzCheck (3 == fuzzArrayCount (configDictionary->getSampleRates (1, 1)), "%s discrete setting has 3 sample rates", sSeeds[0].name);
+		fuzzCheck (2 == fuzzArrayCount (configDictionary->getSampleRates (1, 2)), "%s continuous setting has both ends of its range", sSeeds[0].name);
+		result = configDictionary->getIsocEndpointAddress (&address, 1, 2, kUSBOut);
+		fuzzCheck (kIOReturnSuccess == result && 0x01 == address, "%s 7 byte endpoint is kept", sSeeds[0].name);
+		result = configDictionary->getFormat (&format, 2, 2);
+		fuzzCheck (kIOReturnSuccess == result && MPEG == format, "%s MPEG setting is MPEG (0x%x)", sSeeds[0].name, format);
+		result = configDictionary->getFormat (&format, 2, 3);
+		fuzzCheck (kIOReturnSuccess == result && AC3 == format, "%s AC-3 setting is AC-3 (0x%x)", sSeeds[0].name, format);
+		fuzzCheck (configDictionary->hasInterruptEndpoint (0, 0), "%s control interface has its interrupt endpoint", sSeeds[0].name);
+		result = configDictionary->getNumSources (&count, 0, 0, 5);
+		fuzzCheck (kIOReturnSuccess == result && 1 == count, "%s processing unit is parsed", sSeeds[0].name);
+		result = configDictionary->getNumInputTerminals (&count, 0, 0);
+		fuzzCheck (kIOReturnSuccess == result && 2 == count, "%s other function's control interface is skipped (%d input terminals)", sSeeds[0].name, count);
+		configDictionary->release ();
+	}
+
+	input = fuzzSeedInput (1);
+	configDictionary = AUAConfigurationDictionary::create ((const IOUSBConfigurationDescriptor *) &input[0], 0);
+	fuzzCheck (NULL != configDictionary, "%s parses", sSeeds[1].name);
+	if (NULL != configDictionary)
+	{
+		result = configDictionary->getNumClockSources (&count, 0, 0);
+		fuzzCheck (kIOReturnSuccess == result && 2 == count, "%s has 2 clock sources (%d)", sSeeds[1].name, count);
+		result = configDictionary->getNumClockSelectors (&count, 0, 0);
+		fuzzCheck (kIOReturnSuccess == result && 1 == count, "%s has a clock selector", sSeeds[1].name);
+		result = configDictionary->getNumClockMultipliers (&count, 0, 0);
+		fuzzCheck (kIOReturnSuccess == result && 1 == count, "%s has a clock multiplier", sSeeds[1].name);
+		result = configDictionary->getNumAltSettings (&count, 2);
+		fuzzCheck (kIOReturnSuccess == result && 3 == count, "%s input interface has 3 alternate settings (%d)", sSeeds[1].name, count);
+		result = configDictionary->getIsocEndpointAddress (&address, 1, 1, kUSBOut);
+		fuzzCheck (kIOReturnSuccess == result && 0x01 == address, "%s output endpoint is parsed", sSeeds[1].name);
+		fuzzCheck (configDictionary->hasInterruptEndpoint (0, 0), "%s control interface has its interrupt endpoint", sSeeds[1].name);
+		result = configDictionary->getNumSources (&count, 0, 0, 6);
+		fuzzCheck (kIOReturnSuccess == result && 1 == count, "%s processing unit is parsed", sSeeds[1].name);
+
+		// Clock ranges with too many steps to expand keep their step; only a step of 1 is continuous.
+		ranges.numRanges = 0;
+		ranges.capacity = 0;
+		ranges.ranges = NULL;
+		ranges.coverMax = NULL;
+		AUASampleRateRangesAdd (&ranges, 8000, 192000, 4000);
+		AUASampleRateRangesAdd (&ranges, 50001, 50200, 1);
+		result = configDictionary->addSampleRatesToStreamDictionary (&ranges, 1, 1);
+		AUASampleRateRangesFree (&ranges);
+		fuzzCheck (kIOReturnSuccess == result, "%s takes clock ranges", sSeeds[1].name);
+		fuzzCheck (configDictionary->verifySampleRateIsSupported (1, 1, 48000), "%s accepts 48000 on a 4000 step", sSeeds[1].name);
+		fuzzCheck (!configDictionary->verifySampleRateIsSupported (1, 1, 44100), "%s refuses 44100 on a 4000 step", sSeeds[1].name);
+		fuzzCheck (configDictionary->verifySampleRateIsSupported (1, 1, 50101), "%s accepts 50101 on a 1 step", sSeeds[1].name);
+		fuzzCheck (!configDictionary->verifySampleRateIsSupported (1, 1, 46000), "%s refuses 46000 outside both ranges", sSeeds[1].name);
+		configDictionary->release ();
+	}
+}
+
+#pragma mark -Benchmark-
+
+static UInt64 fuzzNanoseconds (void) {
+	struct timespec					now;
+
+	clock_gettime (CLOCK_MONOTONIC, &now);
+	return (UInt64) now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+// fuzzParse () copies the input with malloc (), so the counts are the parser's own allocations.
+static void fuzzBenchmarkInput (const char * name, const FuzzInput & input) {
+	KernShimAllocationCounts		startCounts;
+	KernShimAllocationCounts		endCounts;
+	UInt64							startTime;
+	UInt64							elapsed;
+	UInt32							numParses;
+	bool							parsed;
+
+	numParses = 0;
+	parsed = true;
+	KernShimGetAllocationCounts (&startCounts);
+	startTime = fuzzNanoseconds ();
+	do
+	{
+		// A batch between clock reads, so reading the clock doesn't show up in the numbers.
+		for (UInt32 batch = 0; batch < 64; batch++)
+		{
+			parsed = fuzzParse (&input[0], input.size ()) && parsed;
+		}
+		numParses += 64;
+		elapsed = fuzzNanoseconds () - startTime;
+	} while (elapsed < (UInt64) sOptions.benchmarkMS * 1000000ULL);
+	KernShimGetAllocationCounts (&endCounts);
+
+	printf ("%s: %lu bytes, %u parses in %llu ms: %.0f configurations/s, %.2f MB/s, %.2f us each\n", name, (unsigned long) input.size (), numParses,
+			elapsed / 1000000ULL, numParses * 1e9 / elapsed, (double) numParses * input.size () * 1e3 / elapsed, elapsed / 1e3 / numParses);
+	printf ("%s: %.1f IOMallocs (%.0f bytes) and %.1f objects (%.0f bytes) per parse\n", name,
+			(double) (endCounts.ioMallocs - startCounts.ioMallocs) / numParses, (double) (endCounts.ioMallocBytes - startCounts.ioMallocBytes) / numParses,
+			(double) (endCounts.objects - startCounts.objects) / numParses, (double) (endCounts.objectBytes - startCounts.objectBytes) / numParses);
+	fuzzCheck (parsed, "%s parsed every time", name);
+}
+
+static void fuzzBenchmark (const std::vector<std::string> & corpusPaths) {
+	FuzzInput						input;
+
+	for (UInt32 seedIndex = 0; seedIndex < kFuzzNumSeeds; seedIndex++)
+	{
+		fuzzBenchmarkInput (sSeeds[seedIndex].name, fuzzSeedInput (seedIndex));
+	}
+	for (size_t pathIndex = 0; pathIndex < corpusPaths.size (); pathIndex++)
+	{
+		if (fuzzIsDeviceCapture (corpusPaths[pathIndex]) && fuzzReadFile (corpusPaths[pathIndex].c_str (), input) && !input.empty ())
+		{
+			fuzzBenchmarkInput (corpusPaths[pathIndex].c_str (), input);
+		}
+	}
+}
+
+#pragma mark -Main-
+
+static void fuzzUsage (void) {
+	fprintf (stderr, "usage: descfuzz [-n mutations] [-s seed] [-b] [-t ms] [-w corpus dir] [-v] [corpus file or dir ...]\n");
+	exit (2);
+}
+
+int main (int argc, char ** argv) {
+	std::vector<std::string>		corpusPaths;
+	FuzzInput						input;
+	UInt32							numInputs;
+	UInt32							numParsed;
+	bool							parsed;
+	int								option;
+
+	while (-1 != (option = getopt (argc, argv, "n:s:bt:w:v")))
+	{
+		switch (option)
+		{
+			case 'n':	sOptions.numMutations = atoi (optarg);			break;
+			case 's':	sOptions.seed = atoi (optarg);					break;
+			case 'b':	sOptions.benchmark = true;						break;
+			case 't':	sOptions.benchmarkMS = atoi (optarg);			break;
+			case 'w':	sOptions.corpusDir = optarg;					break;
+			case 'v':	sOptions.verbose = true;						break;
+			default:	fuzzUsage ();
+		}
+	}
+	if (0 == sOptions.benchmarkMS)
+	{
+		fuzzUsage ();
+	}
+	for (int argIndex = optind; argIndex < argc; argIndex++)
+	{
+		fuzzCollectCorpus (argv[argIndex], corpusPaths);
+	}
+	srandom (sOptions.seed);
+
+	if (NULL != sOptions.corpusDir)
+	{
+		bool						written = true;
+
+		mkdir (sOptions.corpusDir, 0755);
+		for (UInt32 seedIndex = 0; seedIndex < kFuzzNumSeeds; seedIndex++)
+		{
+			written = fuzzWriteFile (sOptions.corpusDir, sSeeds[seedIndex].name, fuzzSeedInput (seedIndex)) && written;
+		}
+		for (UInt32 regressionIndex = 0; regressionIndex < kFuzzNumRegressions; regressionIndex++)
+		{
+			written = fuzzWriteFile (sOptions.corpusDir, sRegressions[regressionIndex].name, fuzzRegressionInput (regressionIndex)) && written;
+		}
+		written = fuzzWriteFile (sOptions.corpusDir, "overrun-last-descriptor-audio10", fuzzOverrunInput (0)) && written;
+		written = fuzzWriteFile (sOptions.corpusDir, "overrun-last-descriptor-audio20", fuzzOverrunInput (1)) && written;
+		written = fuzzWriteFile (sOptions.corpusDir, "control-skip-overrun", fuzzSkipOverrunInput ()) && written;
+		fuzzCheck (written, "corpus written to %s", sOptions.corpusDir);
+		printf ("%s\n", (0 == sFailures) ? "PASS" : "FAIL");
+		return (0 == sFailures) ? 0 : 1;
+	}
+
+	fuzzCheckSeeds ();
+
+	if (sOptions.benchmark)
+	{
+		fuzzBenchmark (corpusPaths);
+		printf ("%s\n", (0 == sFailures) ? "PASS" : "FAIL");
+		return (0 == sFailures) ? 0 : 1;
+	}
+
+	// Every seed cut off at every length. The parse may fail; it just mustn't read what isn't there.
+	numInputs = 0;
+	numParsed = 0;
+	for (UInt32 seedIndex = 0; seedIndex < kFuzzNumSeeds; seedIndex++)
+	{
+		input = fuzzSeedInput (seedIndex);
+		for (size_t length = sizeof (IOUSBConfigurationDescriptor); length < input.size (); length++)
+		{
+			FuzzInput				truncated (input.begin (), input.begin () + length);
+
+			truncated[2] = length & 0xFF;
+			truncated[3] = (length >> 8) & 0xFF;
+			numParsed += fuzzParse (&truncated[0], truncated.size ()) ? 1 : 0;
+			numInputs++;
+		}
+	}
+	fuzzCheck (numInputs == numParsed, "%u truncated seeds parse (%u)", numInputs, numParsed);
+
+	// The inputs the corpus is made from, so the checks don't depend on it having been written.
+	for (UInt32 regressionIndex = 0; regressionIndex < kFuzzNumRegressions; regressionIndex++)
+	{
+		input = fuzzRegressionInput (regressionIndex);
+		fuzzCheck (sRegressions[regressionIndex].parses == fuzzParse (&input[0], input.size ()), "%s %s", sRegressions[regressionIndex].name,
+				   sRegressions[regressionIndex].parses ? "parses" : "is refused");
+	}
+	input = fuzzOverrunInput (0);
+	fuzzCheck (fuzzParse (&input[0], input.size ()), "overrun of the last USB Audio 1.0 descriptor parses");
+	input = fuzzOverrunInput (1);
+	fuzzCheck (fuzzParse (&input[0], input.size ()), "overrun of the last USB Audio 2.0 descriptor parses");
+	input = fuzzSkipOverrunInput ();
+	fuzzCheck (fuzzParse (&input[0], input.size ()), "control interface skip past the end parses");
+
+	numParsed = 0;
+	for (size_t pathIndex = 0; pathIndex < corpusPaths.size (); pathIndex++)
+	{
+		fuzzCheck (fuzzReadFile (corpusPaths[pathIndex].c_str (), input), "%s read", corpusPaths[pathIndex].c_str ());
+		if (sOptions.verbose)
+		{
+			printf ("  %s: %lu bytes\n", corpusPaths[pathIndex].c_str (), (unsigned long) input.size ());
+		}
+		parsed = !input.empty () && fuzzParse (&input[0], input.size ());
+		numParsed += parsed ? 1 : 0;
+		if (fuzzIsDeviceCapture (corpusPaths[pathIndex]))
+		{
+			fuzzCheck (parsed, "%s parses", corpusPaths[pathIndex].c_str ());
+		}
+	}
+	if (!corpusPaths.empty ())
+	{
+		printf ("%u of %lu corpus inputs parsed\n", numParsed, (unsigned long) corpusPaths.size ());
+	}
+
+	numParsed = 0;
+	for (UInt32 mutationIndex = 0; mutationIndex < sOptions.numMutations; mutationIndex++)
+	{
+		input = fuzzSeedInput (fuzzRandom (kFuzzNumSeeds));
+		fuzzMutate (input);
+		if (sOptions.verbose && 0 == mutationIndex % 10000)
+		{
+			printf ("  mutation %u: %lu bytes\n", mutationIndex, (unsigned long) input.size ());
+		}
+		numParsed += fuzzParse (&input[0], input.size ()) ? 1 : 0;
+	}
+	printf ("%u of %u mutated inputs parsed\n", numParsed, sOptions.numMutations);
+
+	printf ("%s\n", (0 == sFailures) ? "PASS" : "FAIL");
+	return (0 == sFailures) ? 0 : 1;
+}
+
+#endif
@@ -0,0 +1,346 @@
+/*
+ * Copyright (c) 1998-2010 Apple Computer, Inc. All rights reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this
+ * file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+//--------------------------------------------------------------------------------
+//
+//	File:		feedbacksim.cpp
+//
+//	Contains:	Host simulation of an asynchronous output stream's feedback loop. The
+//				driver sources are built unchanged against the shim in kernshim/.
+//
+//				A device with its own clock consumes samples from a FIFO and reports its
+//				rate on the feedback endpoint every 2^refresh ms, with measurement noise
+//				and the odd outlier, in 10.14 or 16.16. Each report goes through the real
+//				sampleRateHandler () and so through conditionFeedbackValue (); the packets
+//				are sized from mSamplesPerPacket the way PrepareWriteFrameList () does.
+//				Part way through, the device's clock steps.
+//
+//				The same reports are also applied unconditioned, which is what the driver
+//				does without CONDITIONFEEDBACK, for comparison. The checks are that the
+//				conditioned stream's accumulated error is exactly what was requested and not
+//				sent, that it stays bounded, that the FIFO doesn't drift, that packet sizes
+//				wander less than unconditioned, and that the step is followed.
+//
+//	Technology:	OS X
+//
+//	Build:		c++ -std=gnu++11 -fpermissive -w -I Tools/kernshim/include -I Tools/kernshim -I . -o feedbacksim \
+//					Tools/feedbacksim.cpp Tools/kernshim/*.cpp AppleUSBAudio*.cpp BigNum.cpp -lpthread
+//
+//	Usage:		feedbacksim [-t ms] [-s seed] [-r refresh] [-p device ppm] [-S step ppm] [-n noise 1/1000 sample]
+//						    [-o outlier %] [-f 10.14|16.16] [-v]
+//
+//				Exits non-zero if any check fails.
+//
+//--------------------------------------------------------------------------------
+
+#include <math.h>
+#include <unistd.h>
+
+#include "AppleUSBAudioStream.h"
+
+#if !CONDITIONFEEDBACK
+#error feedbacksim exercises conditionFeedbackValue (), which CONDITIONFEEDBACK compiles out.
+#endif
+
+#define kSimNominalSamplesPerMS		44.1
+#define kSimFractionUnits			((double) kSampleFractionAccumulatorRollover)
+#define kSimFIFOSteeringMS			500				// how long the device gives itself to bring the FIFO back to half full
+
+#pragma mark -Options-
+
+typedef struct {
+	UInt32						durationMS;
+	UInt32						seed;
+	UInt32						refresh;
+	SInt32						devicePPM;
+	SInt32						stepPPM;
+	UInt32						noiseMilliSamples;
+	UInt32						outlierPercent;
+	bool						format16_16;
+	bool						verbose;
+} SimOptions;
+
+static SimOptions				sOptions = { 0, 1, 3, 150, 400, 20, 2, false, false };
+
+static double simUniform (void) {
+	return (double) random () / (double) RAND_MAX;
+}
+
+#pragma mark -Stream-
+
+// Opens up the members the feedback path reads and writes; nothing else about the stream is set up or needed.
+class SimStream : public AppleUSBAudioStream {
+public:
+	IOAudioSamplesPerFrame		getSamplesPerPacket () { return mSamplesPerPacket; }
+	SInt64						getAccumulatedError () { return mFeedbackAccumulatedError; }
+
+	void						setUp (UInt32 * feedbackBuffer, IOAudioSamplesPerFrame samplesPerPacket) {
+		mAverageSampleRateBuffer = feedbackBuffer;
+		mSamplesPerPacket = samplesPerPacket;
+		mShouldStop = 1;							// so the handler doesn't try to queue the next feedback read
+		resetFeedbackConditioning ();
+	}
+};
+
+// The unconditioned driver, and the starting packet size for both.
+static IOAudioSamplesPerFrame simSamplesPerPacket (UInt32 report) {
+	IOAudioSamplesPerFrame			samplesPerPacket;
+
+	if (!sOptions.format16_16)
+	{
+		report <<= 2;
+	}
+	samplesPerPacket.whole = report >> 16;
+	samplesPerPacket.fraction = (report & 0x0000FFFF) * 1000;
+	return samplesPerPacket;
+}
+
+static UInt64 simFractionalValue (IOAudioSamplesPerFrame samplesPerPacket) {
+	return ((UInt64) samplesPerPacket.whole * kSampleFractionAccumulatorRollover) + samplesPerPacket.fraction;
+}
+
+#pragma mark -Host-
+
+// PrepareWriteFrameList ()'s packet sizing.
+typedef struct {
+	UInt64						fractionalSamplesLeft;
+	double						samplesSent;
+} SimHost;
+
+static void simNextPacket (SimHost * host, IOAudioSamplesPerFrame samplesPerPacket) {
+	UInt32							samples = samplesPerPacket.whole;
+
+	host->fractionalSamplesLeft += samplesPerPacket.fraction;
+	if (host->fractionalSamplesLeft >= kSampleFractionAccumulatorRollover)
+	{
+		samples++;
+		host->fractionalSamplesLeft -= kSampleFractionAccumulatorRollover;
+	}
+	host->samplesSent += samples;
+}
+
+#pragma mark -Checks-
+
+static UInt32					sFailures = 0;
+
+static void simCheck (bool passed, const char * format, ...) {
+	va_list							arguments;
+
+	printf ("%s ", passed ? "  ok  " : "  FAIL");
+	va_start (arguments, format);
+	vprintf (format, arguments);
+	va_end (arguments);
+	printf ("\n");
+	if (!passed)
+	{
+		sFailures++;
+	}
+}
+
+// What one run of the loop did, measured from the end of the warm-up.
+typedef struct {
+	double						maxFifoExcursion;
+	double						sumSquaredPacketError;
+	UInt32						numReports;
+	double						finalPacketError;
+	UInt32						numFinalReports;
+} SimResult;
+
+#pragma mark -Main-
+
+static void simUsage (void) {
+	fprintf (stderr, "usage: feedbacksim [-t ms] [-s seed] [-r refresh] [-p device ppm] [-S step ppm] [-n noise 1/1000 sample]\n");
+	fprintf (stderr, "                   [-o outlier %%] [-f 10.14|16.16] [-v]\n");
+	exit (2);
+}
+
+int main (int argc, char ** argv) {
+	SimStream *						stream;
+	IOUSBIsocFrame					feedbackFrame;
+	UInt32							feedbackBuffer;
+	UInt32							reports[2];
+	IOAudioSamplesPerFrame			rawSamplesPerPacket;
+	IOAudioSamplesPerFrame			previousSamplesPerPacket;
+	SimHost							hosts[2];
+	SimResult						results[2];
+	double							fifo[2];
+	double							deviceRate;
+	double							measurementError;
+	double							lagAllowance;
+	double							consumed = 0.0;
+	SInt64							requestedLessApplied = 0;
+	UInt32							droppedReports = 0;
+	SInt64							maxAccumulatedError = 0;
+	UInt32							warmUpMS;
+	UInt32							stepMS;
+	UInt32							refreshMS;
+	int								option;
+
+	while (-1 != (option = getopt (argc, argv, "t:s:r:p:S:n:o:f:v")))
+	{
+		switch (option)
+		{
+			case 't':	sOptions.durationMS = atoi (optarg);			break;
+			case 's':	sOptions.seed = atoi (optarg);					break;
+			case 'r':	sOptions.refresh = atoi (optarg);				break;
+			case 'p':	sOptions.devicePPM = atoi (optarg);				break;
+			case 'S':	sOptions.stepPPM = atoi (optarg);				break;
+			case 'n':	sOptions.noiseMilliSamples = atoi (optarg);		break;
+			case 'o':	sOptions.outlierPercent = atoi (optarg);		break;
+			case 'f':	sOptions.format16_16 = (0 == strcmp (optarg, "16.16"));	break;
+			case 'v':	sOptions.verbose = true;						break;
+			default:	simUsage ();
+		}
+	}
+	if (sOptions.refresh < 1 || sOptions.refresh > 9 || (0 != sOptions.durationMS && sOptions.durationMS < 10000))
+	{
+		simUsage ();
+	}
+	if (0 == sOptions.durationMS)
+	{
+		// Long enough for a thousand reports, or a minute, so that the averages at the end aren't down to a handful of them.
+		sOptions.durationMS = ((1000u << sOptions.refresh) > 60000) ? (1000u << sOptions.refresh) : 60000;
+	}
+	srandom (sOptions.seed);
+
+	refreshMS = 1 << sOptions.refresh;
+	warmUpMS = sOptions.durationMS / 10;
+	stepMS = sOptions.durationMS / 2;
+	deviceRate = kSimNominalSamplesPerMS * (1.0 + (double) sOptions.devicePPM / 1e6);
+	reports[0] = (UInt32) ((kSimNominalSamplesPerMS * (sOptions.format16_16 ? 65536.0 : 16384.0)) + 0.5);
+	rawSamplesPerPacket = simSamplesPerPacket (reports[0]);
+
+	stream = new SimStream;
+	stream->setUp (&feedbackBuffer, rawSamplesPerPacket);
+	bzero (&feedbackFrame, sizeof (feedbackFrame));
+	feedbackFrame.frActCount = sOptions.format16_16 ? kFixedPoint16_16ByteSize : kFixedPoint10_14ByteSize;
+	bzero (hosts, sizeof (hosts));
+	bzero (results, sizeof (results));
+	fifo[0] = fifo[1] = 0.0;
+
+	// 0 is the conditioned stream, 1 the unconditioned one. Each has its own FIFO, so its own device, but the devices share a clock and
+	// make the same measurement errors.
+	for (UInt32 ms = 0; ms < sOptions.durationMS; ms++)
+	{
+		if (stepMS == ms)
+		{
+			deviceRate *= 1.0 + (double) sOptions.stepPPM / 1e6;
+		}
+
+		if (0 == ms % refreshMS && 0 != ms)
+		{
+			measurementError = ((simUniform () * 2.0) - 1.0) * (double) sOptions.noiseMilliSamples / 1000.0;
+			if (simUniform () * 100.0 < (double) sOptions.outlierPercent)
+			{
+				// Wild, but not so wild that sampleRateHandler () throws it out before conditioning.
+				measurementError += ((simUniform () * 2.0) - 1.0) * 0.9;
+			}
+			for (UInt32 run = 0; run < 2; run++)
+			{
+				// Like most asynchronous devices, these ask for a little more or less than their clock to keep the FIFO half full.
+				double					requestedRate = deviceRate + measurementError - fifo[run] / (double) ((refreshMS * 4 > kSimFIFOSteeringMS) ? refreshMS * 4 : kSimFIFOSteeringMS);
+
+				reports[run] = (UInt32) ((requestedRate * (sOptions.format16_16 ? 65536.0 : 16384.0)) + 0.5);
+			}
+
+			// sampleRateHandler () drops a report more than a whole sample off the current packet size without conditioning it.
+			previousSamplesPerPacket = stream->getSamplesPerPacket ();
+			feedbackBuffer = HostToUSBLong (reports[0]);
+			AppleUSBAudioStream::sampleRateHandler (stream, NULL, kIOReturnSuccess, &feedbackFrame);
+			if (simSamplesPerPacket (reports[0]).whole + 1 < previousSamplesPerPacket.whole || simSamplesPerPacket (reports[0]).whole > previousSamplesPerPacket.whole + 1)
+			{
+				droppedReports++;
+			}
+			else
+			{
+				requestedLessApplied += (SInt64) simFractionalValue (simSamplesPerPacket (reports[0])) - (SInt64) simFractionalValue (stream->getSamplesPerPacket ());
+			}
+			rawSamplesPerPacket = simSamplesPerPacket (reports[1]);
+
+			if (ms >= warmUpMS)
+			{
+				maxAccumulatedError = (llabs (stream->getAccumulatedError ()) > maxAccumulatedError) ? llabs (stream->getAccumulatedError ()) : maxAccumulatedError;
+				for (UInt32 run = 0; run < 2; run++)
+				{
+					double				packetError = (double) simFractionalValue ((0 == run) ? stream->getSamplesPerPacket () : rawSamplesPerPacket) / kSimFractionUnits - deviceRate;
+
+					results[run].sumSquaredPacketError += packetError * packetError;
+					results[run].numReports++;
+					if (ms >= sOptions.durationMS - warmUpMS)
+					{
+						results[run].finalPacketError += packetError;
+						results[run].numFinalReports++;
+					}
+				}
+			}
+			if (sOptions.verbose)
+			{
+				printf ("  %6u ms: device %.5f requested %.5f conditioned %.5f accumulated error %+.5f FIFO %+.2f\n", ms, deviceRate,
+						(double) simFractionalValue (simSamplesPerPacket (reports[0])) / kSimFractionUnits, (double) simFractionalValue (stream->getSamplesPerPacket ()) / kSimFractionUnits,
+						(double) stream->getAccumulatedError () / kSimFractionUnits, fifo[0]);
+			}
+		}
+
+		consumed += deviceRate;
+		simNextPacket (&hosts[0], stream->getSamplesPerPacket ());
+		simNextPacket (&hosts[1], rawSamplesPerPacket);
+		for (UInt32 run = 0; run < 2; run++)
+		{
+			fifo[run] = hosts[run].samplesSent - consumed;
+			if (ms >= warmUpMS)
+			{
+				results[run].maxFifoExcursion = (fabs (fifo[run]) > results[run].maxFifoExcursion) ? fabs (fifo[run]) : results[run].maxFifoExcursion;
+			}
+		}
+	}
+	for (UInt32 run = 0; run < 2; run++)
+	{
+		results[run].finalPacketError /= results[run].numFinalReports;
+	}
+
+	for (UInt32 run = 0; run < 2; run++)
+	{
+		printf ("%s: packet size off the device's clock by %.5f samples rms, %+.5f on average at the end; FIFO within %.2f samples\n",
+				(0 == run) ? "conditioned  " : "unconditioned", sqrt (results[run].sumSquaredPacketError / results[run].numReports), results[run].finalPacketError,
+				results[run].maxFifoExcursion);
+	}
+
+	printf ("%u reports out of bounds\n", droppedReports);
+
+	// The accumulated error is the integral term's whole state; if it is ever clipped or skips a value, this stops matching.
+	simCheck (requestedLessApplied == stream->getAccumulatedError (), "accumulated error %.6f samples is everything requested and not applied (%.6f)",
+			  (double) stream->getAccumulatedError () / kSimFractionUnits, (double) requestedLessApplied / kSimFractionUnits);
+	simCheck ((double) maxAccumulatedError / kSimFractionUnits < (double) (1 << kFeedbackIntegralShift), "accumulated error stays within %.3f samples",
+			  (double) maxAccumulatedError / kSimFractionUnits);
+	// The proportional term takes about 2^kFeedbackProportionalShift reports to follow a step; the FIFO pays for that lag.
+	lagAllowance = fabs ((double) sOptions.stepPPM / 1e6) * kSimNominalSamplesPerMS * refreshMS * (1 << kFeedbackProportionalShift);
+	simCheck (results[0].maxFifoExcursion <= results[1].maxFifoExcursion + lagAllowance || results[0].maxFifoExcursion < 4.0,
+			  "conditioned FIFO stays within %.2f samples of half full (unconditioned %.2f, plus %.2f for the filter's lag)",
+			  results[0].maxFifoExcursion, results[1].maxFifoExcursion, lagAllowance);
+	simCheck (results[0].sumSquaredPacketError <= results[1].sumSquaredPacketError || results[0].sumSquaredPacketError < 1e-6 * results[0].numReports,
+			  "conditioned packet sizes wander no more than unconditioned ones");
+	simCheck (fabs (results[0].finalPacketError) < 0.005, "conditioned packet size follows the clock step to within %.5f samples", results[0].finalPacketError);
+
+	printf ("%s\n", (0 == sFailures) ? "PASS" : "FAIL");
+	return (0 == sFailures) ? 0 : 1;
+}
@@ -0,0 +1,2348 @@
+/*
+ * Copyright (c) 1998-2010 Apple Computer, Inc. All rights reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this
+ * file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+//--------------------------------------------------------------------------------
+//
+//	File:		KernShim.cpp
+//
+//	Contains:	Kernel services, libkern containers, the registry, work loops and
+//				memory descriptors for the host shim.
+//
+//	Technology:	OS X
+//
+//--------------------------------------------------------------------------------
+
+#include "KernShim.h"
+
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+#pragma mark -Kernel services-
+
+static KernShimClock			sClock = NULL;
+static KernShimIdle				sIdle = NULL;
+static int						sQuiet = -1;
+static KernShimAllocationCounts	sAllocationCounts = { 0, 0, 0, 0 };
+
+static bool shimQuiet (void) {
+	if (-1 == sQuiet)
+	{
+		sQuiet = (NULL == getenv ("KERNSHIM_LOG")) ? 1 : 0;
+	}
+	return 1 == sQuiet;
+}
+
+void IOLog (const char * format, ...) {
+	va_list							args;
+
+	if (shimQuiet ()) return;
+	va_start (args, format);
+	vfprintf (stderr, format, args);
+	va_end (args);
+}
+
+void kprintf (const char * format, ...) {
+	va_list							args;
+
+	if (shimQuiet ()) return;
+	va_start (args, format);
+	vfprintf (stderr, format, args);
+	va_end (args);
+}
+
+void panic (const char * format, ...) {
+	va_list							args;
+
+	va_start (args, format);
+	fprintf (stderr, "panic: ");
+	vfprintf (stderr, format, args);
+	fprintf (stderr, "\n");
+	va_end (args);
+	abort ();
+}
+
+void IOSleep (unsigned milliseconds) {
+	usleep (milliseconds * 1000);
+}
+
+void IODelay (unsigned microseconds) {
+	usleep (microseconds);
+}
+
+void IOPause (unsigned nanoseconds) {
+	usleep ((nanoseconds + 999) / 1000);
+}
+
+void KernShimGetAllocationCounts (KernShimAllocationCounts * counts) {
+	counts->ioMallocs = __sync_fetch_and_add (&sAllocationCounts.ioMallocs, 0);
+	counts->ioMallocBytes = __sync_fetch_and_add (&sAllocationCounts.ioMallocBytes, 0);
+	counts->objects = __sync_fetch_and_add (&sAllocationCounts.objects, 0);
+	counts->objectBytes = __sync_fetch_and_add (&sAllocationCounts.objectBytes, 0);
+}
+
+void * IOMalloc (vm_size_t size) {
+	__sync_fetch_and_add (&sAllocationCounts.ioMallocs, 1);
+	__sync_fetch_and_add (&sAllocationCounts.ioMallocBytes, size);
+	return malloc (size);
+}
+
+void IOFree (void * address, vm_size_t size) {
+	free (address);
+}
+
+void * IOMallocAligned (vm_size_t size, vm_size_t alignment) {
+	void *							address = NULL;
+
+	__sync_fetch_and_add (&sAllocationCounts.ioMallocs, 1);
+	__sync_fetch_and_add (&sAllocationCounts.ioMallocBytes, size);
+	if (alignment < sizeof (void *))
+	{
+		alignment = sizeof (void *);
+	}
+	if (0 != posix_memalign (&address, alignment, size))
+	{
+		address = NULL;
+	}
+	return address;
+}
+
+void IOFreeAligned (void * address, vm_size_t size) {
+	free (address);
+}
+
+void * IOMallocContiguous (vm_size_t size, vm_size_t alignment, IOPhysicalAddress * physicalAddress) {
+	void *							address;
+
+	address = IOMallocAligned (size, alignment);
+	if (NULL != physicalAddress)
+	{
+		*physicalAddress = (IOPhysicalAddress)(uintptr_t) address;
+	}
+	return address;
+}
+
+void IOFreeContiguous (void * address, vm_size_t size) {
+	free (address);
+}
+
+void KernShimSetClock (KernShimClock clock) {
+	sClock = clock;
+}
+
+void KernShimSetIdle (KernShimIdle idle) {
+	sIdle = idle;
+}
+
+// Absolute time is nanoseconds on the host, so the conversions are identities.
+void clock_get_uptime (AbsoluteTime * result) {
+	struct timespec					now;
+
+	if (NULL != sClock)
+	{
+		*result = sClock ();
+	}
+	else
+	{
+		clock_gettime (CLOCK_MONOTONIC, &now);
+		*result = (UInt64) now.tv_sec * NSEC_PER_SEC + now.tv_nsec;
+	}
+}
+
+void absolutetime_to_nanoseconds (AbsoluteTime absoluteTime, UInt64 * result) {
+	*result = absoluteTime;
+}
+
+void nanoseconds_to_absolutetime (UInt64 nanoseconds, AbsoluteTime * result) {
+	*result = nanoseconds;
+}
+
+void clock_interval_to_absolutetime_interval (UInt32 interval, UInt32 scaleFactor, UInt64 * result) {
+	*result = (UInt64) interval * scaleFactor;
+}
+
+void clock_interval_to_deadline (UInt32 interval, UInt32 scaleFactor, UInt64 * result) {
+	UInt64							now;
+
+	clock_get_uptime (&now);
+	*result = now + (UInt64) interval * scaleFactor;
+}
+
+void clock_get_system_microtime (UInt32 * secs, UInt32 * microsecs) {
+	struct timeval					now;
+
+	gettimeofday (&now, NULL);
+	*secs = (UInt32) now.tv_sec;
+	*microsecs = (UInt32) now.tv_usec;
+}
+
+void microuptime (struct timeval * tv) {
+	UInt64							now;
+
+	clock_get_uptime (&now);
+	tv->tv_sec = now / NSEC_PER_SEC;
+	tv->tv_usec = (now % NSEC_PER_SEC) / NSEC_PER_USEC;
+}
+
+#pragma mark -Locks-
+
+struct _IOLock {
+	pthread_mutex_t					mutex;
+	pthread_cond_t					condition;
+};
+
+struct _IORecursiveLock {
+	pthread_mutex_t					mutex;
+	pthread_t						owner;
+	UInt32							count;
+};
+
+struct _IOSimpleLock {
+	pthread_mutex_t					mutex;
+};
+
+IOLock * IOLockAlloc (void) {
+	IOLock *						lock;
+
+	lock = (IOLock *) calloc (1, sizeof (IOLock));
+	pthread_mutex_init (&lock->mutex, NULL);
+	pthread_cond_init (&lock->condition, NULL);
+	return lock;
+}
+
+void IOLockFree (IOLock * lock) {
+	pthread_cond_destroy (&lock->condition);
+	pthread_mutex_destroy (&lock->mutex);
+	free (lock);
+}
+
+void IOLockLock (IOLock * lock) {
+	pthread_mutex_lock (&lock->mutex);
+}
+
+bool IOLockTryLock (IOLock * lock) {
+	return 0 == pthread_mutex_trylock (&lock->mutex);
+}
+
+void IOLockUnlock (IOLock * lock) {
+	pthread_mutex_unlock (&lock->mutex);
+}
+
+// Every lock has one condition, so a wakeup for any event wakes every sleeper on the lock. Kernel callers
+// already loop on their condition, which makes the extra wakeups harmless.
+int IOLockSleep (IOLock * lock, void * event, UInt32 interType) {
+	bool							idled = false;
+
+	if (NULL != sIdle)
+	{
+		pthread_mutex_unlock (&lock->mutex);
+		idled = sIdle ();
+		pthread_mutex_lock (&lock->mutex);
+	}
+	if (!idled)
+	{
+		pthread_cond_wait (&lock->condition, &lock->mutex);
+	}
+	return THREAD_AWAKENED;
+}
+
+int IOLockSleepDeadline (IOLock * lock, void * event, AbsoluteTime deadline, UInt32 interType) {
+	struct timespec					until;
+	UInt64							now;
+	int								result;
+
+	clock_get_uptime (&now);
+	if (deadline <= now)
+	{
+		return THREAD_TIMED_OUT;
+	}
+	clock_gettime (CLOCK_REALTIME, &until);
+	until.tv_sec += (deadline - now) / NSEC_PER_SEC;
+	until.tv_nsec += (deadline - now) % NSEC_PER_SEC;
+	if (until.tv_nsec >= (long) NSEC_PER_SEC)
+	{
+		until.tv_sec++;
+		until.tv_nsec -= NSEC_PER_SEC;
+	}
+	result = pthread_cond_timedwait (&lock->condition, &lock->mutex, &until);
+	return (0 == result) ? THREAD_AWAKENED : THREAD_TIMED_OUT;
+}
+
+void IOLockWakeup (IOLock * lock, void * event, bool oneThread) {
+	pthread_cond_broadcast (&lock->condition);
+}
+
+IORecursiveLock * IORecursiveLockAlloc (void) {
+	IORecursiveLock *				lock;
+	pthread_mutexattr_t				attributes;
+
+	lock = (IORecursiveLock *) calloc (1, sizeof (IORecursiveLock));
+	pthread_mutexattr_init (&attributes);
+	pthread_mutexattr_settype (&attributes, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init (&lock->mutex, &attributes);
+	pthread_mutexattr_destroy (&attributes);
+	return lock;
+}
+
+void IORecursiveLockFree (IORecursiveLock * lock) {
+	pthread_mutex_destroy (&lock->mutex);
+	free (lock);
+}
+
+void IORecursiveLockLock (IORecursiveLock * lock) {
+	pthread_mutex_lock (&lock->mutex);
+	lock->owner = pthread_self ();
+	lock->count++;
+}
+
+bool IORecursiveLockTryLock (IORecursiveLock * lock) {
+	if (0 != pthread_mutex_trylock (&lock->mutex))
+	{
+		return false;
+	}
+	lock->owner = pthread_self ();
+	lock->count++;
+	return true;
+}
+
+void IORecursiveLockUnlock (IORecursiveLock * lock) {
+	if (0 == --lock->count)
+	{
+		lock->owner = 0;
+	}
+	pthread_mutex_unlock (&lock->mutex);
+}
+
+bool IORecursiveLockHaveLock (const IORecursiveLock * lock) {
+	return 0 != lock->count && pthread_equal (lock->owner, pthread_self ());
+}
+
+IOSimpleLock * IOSimpleLockAlloc (void) {
+	IOSimpleLock *					lock;
+
+	lock = (IOSimpleLock *) calloc (1, sizeof (IOSimpleLock));
+	pthread_mutex_init (&lock->mutex, NULL);
+	return lock;
+}
+
+void IOSimpleLockFree (IOSimpleLock * lock) {
+	pthread_mutex_destroy (&lock->mutex);
+	free (lock);
+}
+
+void IOSimpleLockLock (IOSimpleLock * lock) {
+	pthread_mutex_lock (&lock->mutex);
+}
+
+void IOSimpleLockUnlock (IOSimpleLock * lock) {
+	pthread_mutex_unlock (&lock->mutex);
+}
+
+IOInterruptState IOSimpleLockLockDisableInterrupt (IOSimpleLock * lock) {
+	pthread_mutex_lock (&lock->mutex);
+	return 0;
+}
+
+void IOSimpleLockUnlockEnableInterrupt (IOSimpleLock * lock, IOInterruptState state) {
+	pthread_mutex_unlock (&lock->mutex);
+}
+
+#pragma mark -Thread calls-
+
+// One mutex and condition cover every thread call. A call is pending from thread_call_enter* until its
+// thread picks it up; entering a pending call only updates its parameter, as in the kernel.
+struct _thread_call {
+	thread_call_func_t				func;
+	thread_call_param_t				param0;
+	thread_call_param_t				param1;
+	UInt64							deadline;
+	UInt32							generation;
+	bool							pending;
+	bool							delayed;
+	UInt32							running;
+	bool							freed;
+};
+
+typedef struct {
+	thread_call_t					call;
+	UInt32							generation;
+	bool							delayed;
+} ThreadCallStart;
+
+static pthread_mutex_t			sCallMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t			sCallCondition = PTHREAD_COND_INITIALIZER;
+static UInt32					sImmediateCallsActive = 0;
+static bool						sSynchronousCalls = false;
+
+void KernShimSetSynchronousThreadCalls (bool synchronous) {
+	sSynchronousCalls = synchronous;
+}
+
+static void * threadCallMain (void * argument) {
+	ThreadCallStart *				start = (ThreadCallStart *) argument;
+	thread_call_t					call = start->call;
+	UInt32							generation = start->generation;
+	bool							delayed = start->delayed;
+	thread_call_param_t				param1;
+	UInt64							now;
+
+	free (start);
+	pthread_mutex_lock (&sCallMutex);
+	for (;;)
+	{
+		if (!call->pending || generation != call->generation)
+		{
+			// Cancelled, or entered again after a cancel; the newer thread owns the call.
+			goto Done;
+		}
+		clock_get_uptime (&now);
+		if (now >= call->deadline)
+		{
+			break;
+		}
+		// Poll rather than wait on the host clock, since a harness may be driving time itself.
+		pthread_mutex_unlock (&sCallMutex);
+		usleep (100);
+		pthread_mutex_lock (&sCallMutex);
+	}
+	call->pending = false;
+	call->running++;
+	param1 = call->param1;
+	pthread_mutex_unlock (&sCallMutex);
+
+	call->func (call->param0, param1);
+
+	pthread_mutex_lock (&sCallMutex);
+	call->running--;
+Done:
+	if (!delayed)
+	{
+		sImmediateCallsActive--;
+	}
+	if (call->freed && !call->pending && 0 == call->running)
+	{
+		free (call);
+	}
+	pthread_cond_broadcast (&sCallCondition);
+	pthread_mutex_unlock (&sCallMutex);
+	return NULL;
+}
+
+static bool threadCallEnter (thread_call_t call, bool setParam1, thread_call_param_t param1, bool delayed, UInt64 deadline) {
+	ThreadCallStart *				start;
+	pthread_t						thread;
+	bool							wasPending;
+
+	if (sSynchronousCalls)
+	{
+		call->func (call->param0, setParam1 ? param1 : call->param1);
+		return false;
+	}
+
+	pthread_mutex_lock (&sCallMutex);
+	wasPending = call->pending;
+	if (setParam1)
+	{
+		call->param1 = param1;
+	}
+	if (!wasPending || delayed != call->delayed || deadline != call->deadline)
+	{
+		// Any thread already waiting on the call gives it up when it sees the new generation.
+		call->pending = true;
+		call->delayed = delayed;
+		call->deadline = deadline;
+		call->generation++;
+		if (!delayed)
+		{
+			sImmediateCallsActive++;
+		}
+		start = (ThreadCallStart *) malloc (sizeof (ThreadCallStart));
+		start->call = call;
+		start->generation = call->generation;
+		start->delayed = delayed;
+		pthread_create (&thread, NULL, threadCallMain, start);
+		pthread_detach (thread);
+	}
+	pthread_mutex_unlock (&sCallMutex);
+	return wasPending;
+}
+
+thread_call_t thread_call_allocate (thread_call_func_t func, thread_call_param_t param0) {
+	thread_call_t					call;
+
+	call = (thread_call_t) calloc (1, sizeof (struct _thread_call));
+	call->func = func;
+	call->param0 = param0;
+	return call;
+}
+
+bool thread_call_free (thread_call_t call) {
+	pthread_mutex_lock (&sCallMutex);
+	if (call->pending)
+	{
+		pthread_mutex_unlock (&sCallMutex);
+		return false;
+	}
+	if (0 == call->running)
+	{
+		free (call);
+	}
+	else
+	{
+		call->freed = true;
+	}
+	pthread_mutex_unlock (&sCallMutex);
+	return true;
+}
+
+bool thread_call_enter (thread_call_t call) {
+	return threadCallEnter (call, false, NULL, false, 0);
+}
+
+bool thread_call_enter1 (thread_call_t call, thread_call_param_t param1) {
+	return threadCallEnter (call, true, param1, false, 0);
+}
+
+bool thread_call_enter_delayed (thread_call_t call, UInt64 deadline) {
+	return threadCallEnter (call, false, NULL, true, deadline);
+}
+
+bool thread_call_enter1_delayed (thread_call_t call, thread_call_param_t param1, UInt64 deadline) {
+	return threadCallEnter (call, true, param1, true, deadline);
+}
+
+bool thread_call_cancel (thread_call_t call) {
+	bool							wasPending;
+
+	pthread_mutex_lock (&sCallMutex);
+	wasPending = call->pending;
+	call->pending = false;
+	pthread_mutex_unlock (&sCallMutex);
+	return wasPending;
+}
+
+void KernShimDrainThreadCalls (void) {
+	pthread_mutex_lock (&sCallMutex);
+	while (0 != sImmediateCallsActive)
+	{
+		pthread_cond_wait (&sCallCondition, &sCallMutex);
+	}
+	pthread_mutex_unlock (&sCallMutex);
+}
+
+#pragma mark -OSMetaClass-
+
+typedef struct MetaClassLink {
+	const OSMetaClass *				metaClass;
+	struct MetaClassLink *			next;
+} MetaClassLink;
+
+static MetaClassLink *			sMetaClasses = NULL;
+
+OSMetaClass::OSMetaClass (const char * className, const OSMetaClass * superClass, AllocFunction allocFunction) {
+	MetaClassLink *					link;
+
+	mClassName = className;
+	mSuperClass = superClass;
+	mAllocFunction = allocFunction;
+	mInstanceCount = 0;
+
+	link = (MetaClassLink *) malloc (sizeof (MetaClassLink));
+	link->metaClass = this;
+	link->next = sMetaClasses;
+	sMetaClasses = link;
+}
+
+bool OSMetaClass::isDerivedFrom (const OSMetaClass * other) const {
+	for (const OSMetaClass * meta = this; NULL != meta; meta = meta->mSuperClass)
+	{
+		if (meta == other)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+OSObject * OSMetaClass::allocClassWithName (const char * name) {
+	for (MetaClassLink * link = sMetaClasses; NULL != link; link = link->next)
+	{
+		if (0 == strcmp (link->metaClass->getClassName (), name))
+		{
+			return link->metaClass->alloc ();
+		}
+	}
+	return NULL;
+}
+
+const OSMetaClass OSMetaClassBase::gMetaClass ("OSMetaClassBase", NULL, NULL);
+
+OSMetaClassBase * OSMetaClassBase::metaCast (const OSMetaClass * toMeta) const {
+	return getMetaClass ()->isDerivedFrom (toMeta) ? (OSMetaClassBase *) this : NULL;
+}
+
+OSMetaClassBase * OSMetaClassBase::safeMetaCast (const OSMetaClassBase * anObject, const OSMetaClass * toMeta) {
+	return (NULL != anObject) ? anObject->metaCast (toMeta) : NULL;
+}
+
+bool OSMetaClassBase::checkTypeInst (const OSMetaClassBase * inst, const OSMetaClassBase * typeinst) {
+	return NULL != inst && NULL != typeinst && inst->getMetaClass ()->isDerivedFrom (typeinst->getMetaClass ());
+}
+
+#pragma mark -OSObject-
+
+OSDefineMetaClassWithAlloc (OSObject, OSMetaClassBase, NULL)
+
+OSObject::OSObject () {
+	mRetainCount = 1;
+	gMetaClass.instanceConstructed ();
+}
+
+OSObject::~OSObject () {
+	gMetaClass.instanceDestructed ();
+}
+
+// Zeroed like kernel allocations, which the driver's constructors rely on.
+void * OSObject::operator new (size_t size) {
+	__sync_fetch_and_add (&sAllocationCounts.objects, 1);
+	__sync_fetch_and_add (&sAllocationCounts.objectBytes, size);
+	return calloc (1, size);
+}
+
+void OSObject::operator delete (void * memory, size_t size) {
+	::free (memory);
+}
+
+bool OSObject::init () {
+	return true;
+}
+
+void OSObject::free () {
+	delete this;
+}
+
+void OSObject::retain () const {
+	__sync_fetch_and_add (&mRetainCount, 1);
+}
+
+void OSObject::release () const {
+	if (1 == __sync_fetch_and_sub (&mRetainCount, 1))
+	{
+		const_cast<OSObject *> (this)->free ();
+	}
+}
+
+int OSObject::getRetainCount () const {
+	return mRetainCount;
+}
+
+#pragma mark -OSCollection-
+
+OSDefineMetaClassAndAbstractStructors (OSCollection, OSObject)
+OSDefineMetaClassAndAbstractStructors (OSIterator, OSObject)
+
+#pragma mark -OSArray-
+
+OSDefineMetaClassAndStructors (OSArray, OSCollection)
+
+OSArray * OSArray::withCapacity (unsigned int capacity) {
+	OSArray *						array = new OSArray;
+
+	if (NULL != array && !array->initWithCapacity (capacity))
+	{
+		array->release ();
+		array = NULL;
+	}
+	return array;
+}
+
+OSArray * OSArray::withObjects (const OSObject * objects[], unsigned int count, unsigned int capacity) {
+	OSArray *						array = new OSArray;
+
+	if (NULL != array && !array->initWithObjects (objects, count, capacity))
+	{
+		array->release ();
+		array = NULL;
+	}
+	return array;
+}
+
+OSArray * OSArray::withArray (const OSArray * array, unsigned int capacity) {
+	OSArray *						newArray = new OSArray;
+
+	if (NULL != newArray && !newArray->initWithArray (array, capacity))
+	{
+		newArray->release ();
+		newArray = NULL;
+	}
+	return newArray;
+}
+
+bool OSArray::initWithCapacity (unsigned int capacity) {
+	if (!OSCollection::init ())
+	{
+		return false;
+	}
+	mCount = 0;
+	mCapacity = 0;
+	mArray = NULL;
+	ensureCapacity ((0 == capacity) ? 1 : capacity);
+	return true;
+}
+
+bool OSArray::initWithObjects (const OSObject * objects[], unsigned int count, unsigned int capacity) {
+	if (NULL == objects || !initWithCapacity ((capacity > count) ? capacity : count))
+	{
+		return false;
+	}
+	for (unsigned int index = 0; index < count; index++)
+	{
+		if (NULL == objects[index])
+		{
+			return false;
+		}
+		setObject (objects[index]);
+	}
+	return true;
+}
+
+bool OSArray::initWithArray (const OSArray * array, unsigned int capacity) {
+	if (NULL == array || !initWithCapacity ((capacity > array->mCount) ? capacity : array->mCount))
+	{
+		return false;
+	}
+	for (unsigned int index = 0; index < array->mCount; index++)
+	{
+		setObject (array->mArray[index]);
+	}
+	return true;
+}
+
+void OSArray::free () {
+	flushCollection ();
+	::free (mArray);
+	mArray = NULL;
+	OSCollection::free ();
+}
+
+unsigned int OSArray::ensureCapacity (unsigned int newCapacity) {
+	const OSMetaClassBase **		newArray;
+
+	if (newCapacity > mCapacity)
+	{
+		newArray = (const OSMetaClassBase **) realloc (mArray, newCapacity * sizeof (*mArray));
+		if (NULL != newArray)
+		{
+			mArray = newArray;
+			mCapacity = newCapacity;
+		}
+	}
+	return mCapacity;
+}
+
+void OSArray::flushCollection () {
+	for (unsigned int index = 0; index < mCount; index++)
+	{
+		mArray[index]->release ();
+	}
+	mCount = 0;
+}
+
+bool OSArray::getNextObjectForIterator (unsigned int * index, OSObject ** object) const {
+	if (*index >= mCount)
+	{
+		return false;
+	}
+	*object = (OSObject *) mArray[(*index)++];
+	return true;
+}
+
+bool OSArray::setObject (const OSMetaClassBase * anObject) {
+	return setObject (mCount, anObject);
+}
+
+bool OSArray::setObject (unsigned int index, const OSMetaClassBase * anObject) {
+	if (NULL == anObject || index > mCount)
+	{
+		return false;
+	}
+	if (mCount == mCapacity && ensureCapacity (mCapacity * 2 + 1) == mCount)
+	{
+		return false;
+	}
+	memmove (&mArray[index + 1], &mArray[index], (mCount - index) * sizeof (*mArray));
+	anObject->retain ();
+	mArray[index] = anObject;
+	mCount++;
+	return true;
+}
+
+bool OSArray::merge (const OSArray * otherArray) {
+	if (NULL == otherArray)
+	{
+		return false;
+	}
+	for (unsigned int index = 0; index < otherArray->mCount; index++)
+	{
+		setObject (otherArray->mArray[index]);
+	}
+	return true;
+}
+
+void OSArray::replaceObject (unsigned int index, const OSMetaClassBase * anObject) {
+	if (NULL == anObject || index >= mCount)
+	{
+		return;
+	}
+	anObject->retain ();
+	mArray[index]->release ();
+	mArray[index] = anObject;
+}
+
+void OSArray::removeObject (unsigned int index) {
+	const OSMetaClassBase *			object;
+
+	if (index >= mCount)
+	{
+		return;
+	}
+	object = mArray[index];
+	mCount--;
+	memmove (&mArray[index], &mArray[index + 1], (mCount - index) * sizeof (*mArray));
+	object->release ();
+}
+
+bool OSArray::isEqualTo (const OSArray * anArray) const {
+	if (NULL == anArray || anArray->mCount != mCount)
+	{
+		return false;
+	}
+	for (unsigned int index = 0; index < mCount; index++)
+	{
+		if (!mArray[index]->isEqualTo (anArray->mArray[index]))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool OSArray::isEqualTo (const OSMetaClassBase * anObject) const {
+	return isEqualTo (OSDynamicCast (OSArray, anObject));
+}
+
+OSObject * OSArray::getObject (unsigned int index) const {
+	return (index < mCount) ? (OSObject *) mArray[index] : NULL;
+}
+
+OSObject * OSArray::getLastObject () const {
+	return (0 != mCount) ? (OSObject *) mArray[mCount - 1] : NULL;
+}
+
+unsigned int OSArray::getNextIndexOfObject (const OSMetaClassBase * anObject, unsigned int index) const {
+	for (; index < mCount; index++)
+	{
+		if (mArray[index] == anObject)
+		{
+			return index;
+		}
+	}
+	return (unsigned int) -1;
+}
+
+OSArray * OSArray::copyCollection (OSDictionary * cycleDict) {
+	OSArray *						copy;
+	OSCollection *					collection;
+	OSObject *						object;
+
+	copy = withCapacity (mCount);
+	for (unsigned int index = 0; NULL != copy && index < mCount; index++)
+	{
+		collection = OSDynamicCast (OSCollection, mArray[index]);
+		if (NULL != OSDynamicCast (OSArray, collection))
+		{
+			object = ((OSArray *) collection)->copyCollection ();
+		}
+		else if (NULL != OSDynamicCast (OSDictionary, collection))
+		{
+			object = ((OSDictionary *) collection)->copyCollection ();
+		}
+		else
+		{
+			object = (OSObject *) mArray[index];
+			object->retain ();
+		}
+		copy->setObject (object);
+		object->release ();
+	}
+	return copy;
+}
+
+#pragma mark -OSDictionary-
+
+OSDefineMetaClassAndStructors (OSDictionary, OSCollection)
+
+OSDictionary * OSDictionary::withCapacity (unsigned int capacity) {
+	OSDictionary *					dictionary = new OSDictionary;
+
+	if (NULL != dictionary && !dictionary->initWithCapacity (capacity))
+	{
+		dictionary->release ();
+		dictionary = NULL;
+	}
+	return dictionary;
+}
+
+OSDictionary * OSDictionary::withDictionary (const OSDictionary * dictionary, unsigned int capacity) {
+	OSDictionary *					newDictionary = new OSDictionary;
+
+	if (NULL != newDictionary && !newDictionary->initWithDictionary (dictionary, capacity))
+	{
+		newDictionary->release ();
+		newDictionary = NULL;
+	}
+	return newDictionary;
+}
+
+bool OSDictionary::initWithCapacity (unsigned int capacity) {
+	if (!OSCollection::init ())
+	{
+		return false;
+	}
+	mCount = 0;
+	mCapacity = 0;
+	mDictionary = NULL;
+	ensureCapacity ((0 == capacity) ? 1 : capacity);
+	return true;
+}
+
+bool OSDictionary::initWithDictionary (const OSDictionary * dictionary, unsigned int capacity) {
+	if (NULL == dictionary || !initWithCapacity ((capacity > dictionary->mCount) ? capacity : dictionary->mCount))
+	{
+		return false;
+	}
+	for (unsigned int index = 0; index < dictionary->mCount; index++)
+	{
+		setObject (dictionary->mDictionary[index].key, dictionary->mDictionary[index].value);
+	}
+	return true;
+}
+
+void OSDictionary::free () {
+	flushCollection ();
+	::free (mDictionary);
+	mDictionary = NULL;
+	OSCollection::free ();
+}
+
+unsigned int OSDictionary::ensureCapacity (unsigned int newCapacity) {
+	dictEntry *						newDictionary;
+
+	if (newCapacity > mCapacity)
+	{
+		newDictionary = (dictEntry *) realloc (mDictionary, newCapacity * sizeof (dictEntry));
+		if (NULL != newDictionary)
+		{
+			mDictionary = newDictionary;
+			mCapacity = newCapacity;
+		}
+	}
+	return mCapacity;
+}
+
+void OSDictionary::flushCollection () {
+	for (unsigned int index = 0; index < mCount; index++)
+	{
+		mDictionary[index].key->release ();
+		mDictionary[index].value->release ();
+	}
+	mCount = 0;
+}
+
+// Iteration yields the keys, as OSCollectionIterator does for a dictionary in the kernel.
+bool OSDictionary::getNextObjectForIterator (unsigned int * index, OSObject ** object) const {
+	if (*index >= mCount)
+	{
+		return false;
+	}
+	*object = (OSObject *) mDictionary[(*index)++].key;
+	return true;
+}
+
+int OSDictionary::findKey (const char * key) const {
+	for (unsigned int index = 0; index < mCount; index++)
+	{
+		if (0 == strcmp (mDictionary[index].key->getCStringNoCopy (), key))
+		{
+			return (int) index;
+		}
+	}
+	return -1;
+}
+
+bool OSDictionary::setObject (const OSSymbol * aKey, const OSMetaClassBase * anObject) {
+	return (NULL != aKey) ? setObject (aKey->getCStringNoCopy (), anObject) : false;
+}
+
+bool OSDictionary::setObject (const OSString * aKey, const OSMetaClassBase * anObject) {
+	return (NULL != aKey) ? setObject (aKey->getCStringNoCopy (), anObject) : false;
+}
+
+bool OSDictionary::setObject (const char * aKey, const OSMetaClassBase * anObject) {
+	int								index;
+
+	if (NULL == aKey || NULL == anObject)
+	{
+		return false;
+	}
+	index = findKey (aKey);
+	anObject->retain ();
+	if (index >= 0)
+	{
+		mDictionary[index].value->release ();
+		mDictionary[index].value = anObject;
+		return true;
+	}
+	if (mCount == mCapacity && ensureCapacity (mCapacity * 2 + 1) == mCount)
+	{
+		anObject->release ();
+		return false;
+	}
+	mDictionary[mCount].key = OSSymbol::withCString (aKey);
+	mDictionary[mCount].value = anObject;
+	mCount++;
+	return true;
+}
+
+void OSDictionary::removeObject (const OSSymbol * aKey) {
+	if (NULL != aKey)
+	{
+		removeObject (aKey->getCStringNoCopy ());
+	}
+}
+
+void OSDictionary::removeObject (const OSString * aKey) {
+	if (NULL != aKey)
+	{
+		removeObject (aKey->getCStringNoCopy ());
+	}
+}
+
+void OSDictionary::removeObject (const char * aKey) {
+	int								index;
+	dictEntry						entry;
+
+	index = (NULL != aKey) ? findKey (aKey) : -1;
+	if (index < 0)
+	{
+		return;
+	}
+	entry = mDictionary[index];
+	mCount--;
+	memmove (&mDictionary[index], &mDictionary[index + 1], (mCount - index) * sizeof (dictEntry));
+	entry.key->release ();
+	entry.value->release ();
+}
+
+bool OSDictionary::merge (const OSDictionary * otherDictionary) {
+	if (NULL == otherDictionary)
+	{
+		return false;
+	}
+	for (unsigned int index = 0; index < otherDictionary->mCount; index++)
+	{
+		setObject (otherDictionary->mDictionary[index].key, otherDictionary->mDictionary[index].value);
+	}
+	return true;
+}
+
+OSObject * OSDictionary::getObject (const OSSymbol * aKey) const {
+	return (NULL != aKey) ? getObject (aKey->getCStringNoCopy ()) : NULL;
+}
+
+OSObject * OSDictionary::getObject (const OSString * aKey) const {
+	return (NULL != aKey) ? getObject (aKey->getCStringNoCopy ()) : NULL;
+}
+
+OSObject * OSDictionary::getObject (const char * aKey) const {
+	int								index;
+
+	index = (NULL != aKey) ? findKey (aKey) : -1;
+	return (index >= 0) ? (OSObject *) mDictionary[index].value : NULL;
+}
+
+bool OSDictionary::isEqualTo (const OSDictionary * aDictionary) const {
+	OSObject *						value;
+
+	if (NULL == aDictionary || aDictionary->mCount != mCount)
+	{
+		return false;
+	}
+	for (unsigned int index = 0; index < mCount; index++)
+	{
+		value = aDictionary->getObject (mDictionary[index].key);
+		if (NULL == value || !mDictionary[index].value->isEqualTo (value))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool OSDictionary::isEqualTo (const OSMetaClassBase * anObject) const {
+	return isEqualTo (OSDynamicCast (OSDictionary, anObject));
+}
+
+OSDictionary * OSDictionary::copyCollection (OSDictionary * cycleDict) {
+	OSDictionary *					copy;
+	const OSMetaClassBase *			value;
+	OSObject *						object;
+
+	copy = withCapacity (mCount);
+	for (unsigned int index = 0; NULL != copy && index < mCount; index++)
+	{
+		value = mDictionary[index].value;
+		if (NULL != OSDynamicCast (OSArray, value))
+		{
+			object = ((OSArray *) value)->copyCollection ();
+		}
+		else if (NULL != OSDynamicCast (OSDictionary, value))
+		{
+			object = ((OSDictionary *) value)->copyCollection ();
+		}
+		else
+		{
+			object = (OSObject *) value;
+			object->retain ();
+		}
+		copy->setObject (mDictionary[index].key, object);
+		object->release ();
+	}
+	return copy;
+}
+
+#pragma mark -OSSet-
+
+OSDefineMetaClassAndStructors (OSSet, OSCollection)
+
+OSSet * OSSet::withCapacity (unsigned int capacity) {
+	OSSet *							set = new OSSet;
+
+	if (NULL != set && !set->initWithCapacity (capacity))
+	{
+		set->release ();
+		set = NULL;
+	}
+	return set;
+}
+
+OSSet * OSSet::withSet (const OSSet * set, unsigned int capacity) {
+	OSSet *							newSet;
+
+	if (NULL == set)
+	{
+		return NULL;
+	}
+	newSet = withCapacity ((capacity > set->getCount ()) ? capacity : set->getCount ());
+	if (NULL != newSet)
+	{
+		newSet->mMembers->merge (set->mMembers);
+	}
+	return newSet;
+}
+
+bool OSSet::initWithCapacity (unsigned int capacity) {
+	if (!OSCollection::init ())
+	{
+		return false;
+	}
+	mMembers = OSArray::withCapacity (capacity);
+	return NULL != mMembers;
+}
+
+void OSSet::free () {
+	if (NULL != mMembers)
+	{
+		mMembers->release ();
+		mMembers = NULL;
+	}
+	OSCollection::free ();
+}
+
+bool OSSet::setObject (const OSMetaClassBase * anObject) {
+	if (NULL == anObject || containsObject (anObject))
+	{
+		return false;
+	}
+	return mMembers->setObject (anObject);
+}
+
+void OSSet::removeObject (const OSMetaClassBase * anObject) {
+	unsigned int					index;
+
+	index = mMembers->getNextIndexOfObject (anObject, 0);
+	if ((unsigned int) -1 != index)
+	{
+		mMembers->removeObject (index);
+	}
+}
+
+bool OSSet::containsObject (const OSMetaClassBase * anObject) const {
+	return (unsigned int) -1 != mMembers->getNextIndexOfObject (anObject, 0);
+}
+
+#pragma mark -OSCollectionIterator-
+
+OSDefineMetaClassAndStructors (OSCollectionIterator, OSIterator)
+
+OSCollectionIterator * OSCollectionIterator::withCollection (const OSCollection * inColl) {
+	OSCollectionIterator *			iterator = new OSCollectionIterator;
+
+	if (NULL != iterator && !iterator->initWithCollection (inColl))
+	{
+		iterator->release ();
+		iterator = NULL;
+	}
+	return iterator;
+}
+
+bool OSCollectionIterator::initWithCollection (const OSCollection * inColl) {
+	if (NULL == inColl || !OSIterator::init ())
+	{
+		return false;
+	}
+	inColl->retain ();
+	mCollection = inColl;
+	mIndex = 0;
+	return true;
+}
+
+void OSCollectionIterator::free () {
+	if (NULL != mCollection)
+	{
+		mCollection->release ();
+		mCollection = NULL;
+	}
+	OSIterator::free ();
+}
+
+OSObject * OSCollectionIterator::getNextObject () {
+	OSObject *						object = NULL;
+
+	if (!mCollection->getNextObjectForIterator (&mIndex, &object))
+	{
+		object = NULL;
+	}
+	return object;
+}
+
+#pragma mark -Scalars-
+
+OSDefineMetaClassAndStructors (OSNumber, OSObject)
+
+OSNumber * OSNumber::withNumber (unsigned long long value, unsigned int numberOfBits) {
+	OSNumber *						number = new OSNumber;
+
+	if (NULL != number && !number->init (value, numberOfBits))
+	{
+		number->release ();
+		number = NULL;
+	}
+	return number;
+}
+
+OSNumber * OSNumber::withNumber (const char * valueString, unsigned int numberOfBits) {
+	return withNumber (strtoull (valueString, NULL, 0), numberOfBits);
+}
+
+bool OSNumber::init (unsigned long long value, unsigned int numberOfBits) {
+	if (!OSObject::init () || 0 == numberOfBits || numberOfBits > 64)
+	{
+		return false;
+	}
+	mSize = numberOfBits;
+	setValue (value);
+	return true;
+}
+
+void OSNumber::addValue (signed long long value) {
+	setValue (mValue + value);
+}
+
+void OSNumber::setValue (unsigned long long value) {
+	mValue = (64 == mSize) ? value : (value & ((1ULL << mSize) - 1));
+}
+
+bool OSNumber::isEqualTo (const OSNumber * aNumber) const {
+	return NULL != aNumber && aNumber->mValue == mValue;
+}
+
+bool OSNumber::isEqualTo (const OSMetaClassBase * anObject) const {
+	return isEqualTo (OSDynamicCast (OSNumber, anObject));
+}
+
+OSDefineMetaClassAndStructors (OSString, OSObject)
+
+OSString * OSString::withCString (const char * cString) {
+	OSString *						string = new OSString;
+
+	if (NULL != string && !string->initWithCString (cString))
+	{
+		string->release ();
+		string = NULL;
+	}
+	return string;
+}
+
+OSString * OSString::withString (const OSString * aString) {
+	return (NULL != aString) ? withCString (aString->getCStringNoCopy ()) : NULL;
+}
+
+bool OSString::initWithCString (const char * cString) {
+	if (NULL == cString || !OSObject::init ())
+	{
+		return false;
+	}
+	mString = strdup (cString);
+	return NULL != mString;
+}
+
+void OSString::free () {
+	::free (mString);
+	mString = NULL;
+	OSObject::free ();
+}
+
+bool OSString::isEqualTo (const OSString * aString) const {
+	return NULL != aString && 0 == strcmp (mString, aString->mString);
+}
+
+bool OSString::isEqualTo (const char * cString) const {
+	return NULL != cString && 0 == strcmp (mString, cString);
+}
+
+bool OSString::isEqualTo (const OSMetaClassBase * anObject) const {
+	return isEqualTo (OSDynamicCast (OSString, anObject));
+}
+
+// Symbols are not uniqued; OSDictionary compares keys by content.
+OSDefineMetaClassAndStructors (OSSymbol, OSString)
+
+const OSSymbol * OSSymbol::withCString (const char * cString) {
+	OSSymbol *						symbol = new OSSymbol;
+
+	if (NULL != symbol && !symbol->initWithCString (cString))
+	{
+		symbol->release ();
+		symbol = NULL;
+	}
+	return symbol;
+}
+
+OSDefineMetaClassAndStructors (OSBoolean, OSObject)
+
+static OSBoolean * newBoolean (bool value) {
+	OSBoolean *						boolean = new OSBoolean;
+
+	boolean->mValue = value;
+	return boolean;
+}
+
+static OSBoolean *				sBooleanTrue = newBoolean (true);
+static OSBoolean *				sBooleanFalse = newBoolean (false);
+OSBoolean * const &				kOSBooleanTrue = sBooleanTrue;
+OSBoolean * const &				kOSBooleanFalse = sBooleanFalse;
+
+OSBoolean * OSBoolean::withBoolean (bool value) {
+	return value ? kOSBooleanTrue : kOSBooleanFalse;
+}
+
+OSDefineMetaClassAndStructors (OSData, OSObject)
+
+OSData * OSData::withCapacity (unsigned int capacity) {
+	OSData *						data = new OSData;
+
+	if (NULL != data && !data->initWithCapacity (capacity))
+	{
+		data->release ();
+		data = NULL;
+	}
+	return data;
+}
+
+OSData * OSData::withBytes (const void * bytes, unsigned int numBytes) {
+	OSData *						data;
+
+	data = withCapacity (numBytes);
+	if (NULL != data && !data->appendBytes (bytes, numBytes))
+	{
+		data->release ();
+		data = NULL;
+	}
+	return data;
+}
+
+OSData * OSData::withData (const OSData * inData) {
+	return (NULL != inData) ? withBytes (inData->mData, inData->mLength) : NULL;
+}
+
+bool OSData::initWithCapacity (unsigned int capacity) {
+	if (!OSObject::init ())
+	{
+		return false;
+	}
+	mLength = 0;
+	mCapacity = capacity;
+	mData = (UInt8 *) malloc ((0 == capacity) ? 1 : capacity);
+	return NULL != mData;
+}
+
+void OSData::free () {
+	::free (mData);
+	mData = NULL;
+	OSObject::free ();
+}
+
+const void * OSData::getBytesNoCopy (unsigned int start, unsigned int numBytes) const {
+	if (0 == numBytes || start > mLength || numBytes > mLength - start)
+	{
+		return NULL;
+	}
+	return mData + start;
+}
+
+bool OSData::appendBytes (const void * bytes, unsigned int numBytes) {
+	UInt8 *							newData;
+
+	if (mLength + numBytes > mCapacity)
+	{
+		newData = (UInt8 *) realloc (mData, mLength + numBytes);
+		if (NULL == newData)
+		{
+			return false;
+		}
+		mData = newData;
+		mCapacity = mLength + numBytes;
+	}
+	if (NULL != bytes)
+	{
+		memcpy (mData + mLength, bytes, numBytes);
+	}
+	else
+	{
+		memset (mData + mLength, 0, numBytes);
+	}
+	mLength += numBytes;
+	return true;
+}
+
+bool OSData::isEqualTo (const OSData * aDataObj) const {
+	return NULL != aDataObj && aDataObj->mLength == mLength && 0 == memcmp (aDataObj->mData, mData, mLength);
+}
+
+bool OSData::isEqualTo (const OSMetaClassBase * anObject) const {
+	return isEqualTo (OSDynamicCast (OSData, anObject));
+}
+
+OSDefineMetaClassAndStructors (OSSerialize, OSObject)
+
+#pragma mark -IORegistryEntry-
+
+OSDefineMetaClassAndStructors (IORegistryEntry, OSObject)
+OSDefineMetaClassAndStructors (IORegistryIterator, OSIterator)
+
+bool IORegistryEntry::init (OSDictionary * dictionary) {
+	if (!OSObject::init ())
+	{
+		return false;
+	}
+	if (NULL == mProperties)
+	{
+		mProperties = (NULL != dictionary) ? OSDictionary::withDictionary (dictionary) : OSDictionary::withCapacity (16);
+	}
+	return NULL != mProperties;
+}
+
+void IORegistryEntry::free () {
+	if (NULL != mProperties)
+	{
+		mProperties->release ();
+		mProperties = NULL;
+	}
+	OSObject::free ();
+}
+
+bool IORegistryEntry::setProperty (const OSSymbol * aKey, OSObject * anObject) {
+	return (NULL != aKey) ? setProperty (aKey->getCStringNoCopy (), anObject) : false;
+}
+
+bool IORegistryEntry::setProperty (const OSString * aKey, OSObject * anObject) {
+	return (NULL != aKey) ? setProperty (aKey->getCStringNoCopy (), anObject) : false;
+}
+
+bool IORegistryEntry::setProperty (const char * aKey, OSObject * anObject) {
+	if (NULL == mProperties)
+	{
+		mProperties = OSDictionary::withCapacity (16);
+	}
+	return mProperties->setObject (aKey, anObject);
+}
+
+bool IORegistryEntry::setProperty (const char * aKey, const char * aString) {
+	OSString *						string;
+	bool							result = false;
+
+	string = OSString::withCString (aString);
+	if (NULL != string)
+	{
+		result = setProperty (aKey, string);
+		string->release ();
+	}
+	return result;
+}
+
+bool IORegistryEntry::setProperty (const char * aKey, bool aBoolean) {
+	return setProperty (aKey, (OSObject *) OSBoolean::withBoolean (aBoolean));
+}
+
+bool IORegistryEntry::setProperty (const char * aKey, unsigned long long aValue, unsigned int aNumberOfBits) {
+	OSNumber *						number;
+	bool							result = false;
+
+	number = OSNumber::withNumber (aValue, aNumberOfBits);
+	if (NULL != number)
+	{
+		result = setProperty (aKey, number);
+		number->release ();
+	}
+	return result;
+}
+
+bool IORegistryEntry::setProperty (const char * aKey, void * bytes, unsigned int length) {
+	OSData *						data;
+	bool							result = false;
+
+	data = OSData::withBytes (bytes, length);
+	if (NULL != data)
+	{
+		result = setProperty (aKey, data);
+		data->release ();
+	}
+	return result;
+}
+
+void IORegistryEntry::removeProperty (const OSSymbol * aKey) {
+	if (NULL != aKey)
+	{
+		removeProperty (aKey->getCStringNoCopy ());
+	}
+}
+
+void IORegistryEntry::removeProperty (const OSString * aKey) {
+	if (NULL != aKey)
+	{
+		removeProperty (aKey->getCStringNoCopy ());
+	}
+}
+
+void IORegistryEntry::removeProperty (const char * aKey) {
+	if (NULL != mProperties)
+	{
+		mProperties->removeObject (aKey);
+	}
+}
+
+OSObject * IORegistryEntry::getProperty (const OSSymbol * aKey) const {
+	return (NULL != aKey) ? getProperty (aKey->getCStringNoCopy ()) : NULL;
+}
+
+OSObject * IORegistryEntry::getProperty (const OSString * aKey) const {
+	return (NULL != aKey) ? getProperty (aKey->getCStringNoCopy ()) : NULL;
+}
+
+OSObject * IORegistryEntry::getProperty (const char * aKey) const {
+	return (NULL != mProperties) ? mProperties->getObject (aKey) : NULL;
+}
+
+// Only parents are searched; the shim has no child links.
+OSObject * IORegistryEntry::getProperty (const char * aKey, const IORegistryPlane * plane, IOOptionBits options) const {
+	OSObject *						object;
+
+	object = getProperty (aKey);
+	if (NULL == object && (options & kIORegistryIterateParents))
+	{
+		for (const IORegistryEntry * entry = getParentEntry (plane); NULL == object && NULL != entry; entry = (options & kIORegistryIterateRecursively) ? entry->getParentEntry (plane) : NULL)
+		{
+			object = entry->getProperty (aKey);
+		}
+	}
+	return object;
+}
+
+OSObject * IORegistryEntry::copyProperty (const char * aKey) const {
+	OSObject *						object;
+
+	object = getProperty (aKey);
+	if (NULL != object)
+	{
+		object->retain ();
+	}
+	return object;
+}
+
+OSObject * IORegistryEntry::copyProperty (const char * aKey, const IORegistryPlane * plane, IOOptionBits options) const {
+	OSObject *						object;
+
+	object = getProperty (aKey, plane, options);
+	if (NULL != object)
+	{
+		object->retain ();
+	}
+	return object;
+}
+
+OSDictionary * IORegistryEntry::dictionaryWithProperties () const {
+	return (NULL != mProperties) ? OSDictionary::withDictionary (mProperties) : OSDictionary::withCapacity (1);
+}
+
+void IORegistryEntry::setName (const char * name, const IORegistryPlane * plane) {
+	strlcpy (mName, name, sizeof (mName));
+}
+
+void IORegistryEntry::setLocation (const char * location, const IORegistryPlane * plane) {
+	strlcpy (mLocation, location, sizeof (mLocation));
+}
+
+bool IORegistryEntry::attachToParent (IORegistryEntry * parent, const IORegistryPlane * plane) {
+	mParent = parent;
+	return true;
+}
+
+void IORegistryEntry::detachFromParent (IORegistryEntry * parent, const IORegistryPlane * plane) {
+	if (parent == mParent)
+	{
+		mParent = NULL;
+	}
+}
+
+OSIterator * IORegistryEntry::getChildIterator (const IORegistryPlane * plane) const {
+	OSArray *						children;
+	OSIterator *					iterator;
+
+	children = OSArray::withCapacity (1);
+	iterator = OSCollectionIterator::withCollection (children);
+	children->release ();
+	return iterator;
+}
+
+OSIterator * IORegistryEntry::getParentIterator (const IORegistryPlane * plane) const {
+	OSArray *						parents;
+	OSIterator *					iterator;
+
+	parents = OSArray::withCapacity (1);
+	if (NULL != mParent)
+	{
+		parents->setObject (mParent);
+	}
+	iterator = OSCollectionIterator::withCollection (parents);
+	parents->release ();
+	return iterator;
+}
+
+#pragma mark -IOService-
+
+OSDefineMetaClassAndStructors (IONotifier, OSObject)
+OSDefineMetaClassAndStructors (IOService, IORegistryEntry)
+
+bool IOService::init (OSDictionary * dictionary) {
+	return IORegistryEntry::init (dictionary);
+}
+
+void IOService::free () {
+	IORegistryEntry::free ();
+}
+
+bool IOService::start (IOService * provider) {
+	return true;
+}
+
+void IOService::stop (IOService * provider) {
+}
+
+bool IOService::open (IOService * forClient, IOOptionBits options, void * arg) {
+	if (!handleOpen (forClient, options, arg))
+	{
+		return false;
+	}
+	mOpenCount++;
+	return true;
+}
+
+void IOService::close (IOService * forClient, IOOptionBits options) {
+	if (0 != mOpenCount)
+	{
+		handleClose (forClient, options);
+		mOpenCount--;
+	}
+}
+
+bool IOService::isOpen (const IOService * forClient) const {
+	return 0 != mOpenCount;
+}
+
+bool IOService::terminate (IOOptionBits options) {
+	mInactive = true;
+	return true;
+}
+
+bool IOService::compareProperty (OSDictionary * matching, const char * key) {
+	OSObject *						value;
+	OSObject *						property;
+
+	value = (NULL != matching) ? matching->getObject (key) : NULL;
+	if (NULL == value)
+	{
+		return true;
+	}
+	property = getProperty (key);
+	return NULL != property && value->isEqualTo (property);
+}
+
+OSIterator * IOService::getClientIterator () const {
+	return getChildIterator (gIOServicePlane);
+}
+
+IOWorkLoop * IOService::getWorkLoop () const {
+	return (NULL != mProvider) ? mProvider->getWorkLoop () : NULL;
+}
+
+bool IOService::attach (IOService * provider) {
+	mProvider = provider;
+	return attachToParent (provider, gIOServicePlane);
+}
+
+void IOService::detach (IOService * provider) {
+	detachFromParent (provider, gIOServicePlane);
+	if (provider == mProvider)
+	{
+		mProvider = NULL;
+	}
+}
+
+IONotifier * IOService::registerInterest (const OSSymbol * typeOfInterest, IOServiceInterestHandler handler, void * target, void * ref) {
+	return new IONotifier;
+}
+
+OSDictionary * IOService::serviceMatching (const char * className, OSDictionary * table) {
+	OSDictionary *					matching;
+
+	matching = (NULL != table) ? table : OSDictionary::withCapacity (2);
+	if (NULL != matching)
+	{
+		OSString *					string = OSString::withCString (className);
+
+		matching->setObject (kIOProviderClassKey, string);
+		string->release ();
+		if (NULL != table)
+		{
+			table->retain ();
+		}
+	}
+	return matching;
+}
+
+OSDictionary * IOService::nameMatching (const char * name, OSDictionary * table) {
+	OSDictionary *					matching;
+
+	matching = (NULL != table) ? table : OSDictionary::withCapacity (2);
+	if (NULL != matching)
+	{
+		OSString *					string = OSString::withCString (name);
+
+		matching->setObject (kIONameMatchKey, string);
+		string->release ();
+		if (NULL != table)
+		{
+			table->retain ();
+		}
+	}
+	return matching;
+}
+
+// Nothing else is registered on the host.
+IOService * IOService::waitForService (OSDictionary * matching, UInt64 * timeout) {
+	if (NULL != matching)
+	{
+		matching->release ();
+	}
+	return NULL;
+}
+
+OSIterator * IOService::getMatchingServices (OSDictionary * matching) {
+	return NULL;
+}
+
+IONotifier * IOService::addNotification (const OSSymbol * type, OSDictionary * matching, IOServiceNotificationHandler handler, void * target, void * ref, SInt32 priority) {
+	if (NULL != matching)
+	{
+		matching->release ();
+	}
+	return new IONotifier;
+}
+
+IONotifier * IOService::addMatchingNotification (const OSSymbol * type, OSDictionary * matching, IOServiceMatchingNotificationHandler handler, void * target, void * ref, SInt32 priority) {
+	return new IONotifier;
+}
+
+#pragma mark -Work loops-
+
+OSDefineMetaClassAndAbstractStructors (IOEventSource, OSObject)
+OSDefineMetaClassAndStructors (IOWorkLoop, OSObject)
+OSDefineMetaClassAndStructors (IOCommandGate, IOEventSource)
+OSDefineMetaClassAndStructors (IOTimerEventSource, IOEventSource)
+OSDefineMetaClassAndStructors (IOInterruptEventSource, IOEventSource)
+
+bool IOEventSource::init (OSObject * inOwner, Action inAction) {
+	if (!OSObject::init ())
+	{
+		return false;
+	}
+	owner = inOwner;
+	action = inAction;
+	mEnabled = true;
+	return true;
+}
+
+IOWorkLoop * IOWorkLoop::workLoop () {
+	IOWorkLoop *					loop = new IOWorkLoop;
+
+	if (NULL != loop && !loop->init ())
+	{
+		loop->release ();
+		loop = NULL;
+	}
+	return loop;
+}
+
+bool IOWorkLoop::init () {
+	if (!OSObject::init ())
+	{
+		return false;
+	}
+	mGateLock = IORecursiveLockAlloc ();
+	return NULL != mGateLock;
+}
+
+void IOWorkLoop::free () {
+	if (NULL != mGateLock)
+	{
+		IORecursiveLockFree (mGateLock);
+		mGateLock = NULL;
+	}
+	OSObject::free ();
+}
+
+IOReturn IOWorkLoop::addEventSource (IOEventSource * newEvent) {
+	newEvent->setWorkLoop (this);
+	return kIOReturnSuccess;
+}
+
+IOReturn IOWorkLoop::removeEventSource (IOEventSource * toRemove) {
+	toRemove->setWorkLoop (NULL);
+	return kIOReturnSuccess;
+}
+
+IOReturn IOWorkLoop::runAction (Action inAction, OSObject * target, void * arg0, void * arg1, void * arg2, void * arg3) {
+	IOReturn						result;
+
+	closeGate ();
+	result = inAction (target, arg0, arg1, arg2, arg3);
+	openGate ();
+	return result;
+}
+
+IOCommandGate * IOCommandGate::commandGate (OSObject * inOwner, Action inAction) {
+	IOCommandGate *					gate = new IOCommandGate;
+
+	if (NULL != gate && !gate->init (inOwner, (IOEventSource::Action) inAction))
+	{
+		gate->release ();
+		gate = NULL;
+	}
+	return gate;
+}
+
+IOReturn IOCommandGate::runCommand (void * arg0, void * arg1, void * arg2, void * arg3) {
+	return runAction ((Action) action, arg0, arg1, arg2, arg3);
+}
+
+IOReturn IOCommandGate::runAction (Action inAction, void * arg0, void * arg1, void * arg2, void * arg3) {
+	IOReturn						result;
+
+	if (NULL == inAction)
+	{
+		return kIOReturnBadArgument;
+	}
+	if (NULL != mWorkLoop)
+	{
+		mWorkLoop->closeGate ();
+	}
+	result = inAction (owner, arg0, arg1, arg2, arg3);
+	if (NULL != mWorkLoop)
+	{
+		mWorkLoop->openGate ();
+	}
+	return result;
+}
+
+// Nothing on the host wakes a gated sleeper from another thread, so a sleep with a deadline simply times out
+// and an untimed one returns at once. Callers in the driver re-check their condition.
+IOReturn IOCommandGate::commandSleep (void * event, UInt32 interruptible) {
+	return kIOReturnSuccess;
+}
+
+IOReturn IOCommandGate::commandSleep (void * event, AbsoluteTime deadline, UInt32 interruptible) {
+	return kIOReturnTimeout;
+}
+
+void IOCommandGate::commandWakeup (void * event, bool oneThread) {
+}
+
+IOTimerEventSource * IOTimerEventSource::timerEventSource (OSObject * inOwner, Action inAction) {
+	IOTimerEventSource *			timer = new IOTimerEventSource;
+
+	if (NULL != timer && !timer->init (inOwner, inAction))
+	{
+		timer->release ();
+		timer = NULL;
+	}
+	return timer;
+}
+
+// Every live timer, so that fireExpired () can find them.
+static IOTimerEventSource *		sTimers = NULL;
+static pthread_mutex_t			sTimerMutex = PTHREAD_MUTEX_INITIALIZER;
+
+bool IOTimerEventSource::init (OSObject * inOwner, Action inAction) {
+	mTimerAction = inAction;
+	pthread_mutex_lock (&sTimerMutex);
+	mNextTimer = sTimers;
+	sTimers = this;
+	pthread_mutex_unlock (&sTimerMutex);
+	return IOEventSource::init (inOwner, NULL);
+}
+
+void IOTimerEventSource::free () {
+	IOTimerEventSource **			link;
+
+	cancelTimeout ();
+	pthread_mutex_lock (&sTimerMutex);
+	for (link = &sTimers; NULL != *link; link = &(*link)->mNextTimer)
+	{
+		if (this == *link)
+		{
+			*link = mNextTimer;
+			break;
+		}
+	}
+	pthread_mutex_unlock (&sTimerMutex);
+	IOEventSource::free ();
+}
+
+void IOTimerEventSource::fireExpired () {
+	IOTimerEventSource *			timer;
+	IOTimerEventSource *			earliest;
+	AbsoluteTime					now;
+
+	do
+	{
+		clock_get_uptime (&now);
+		earliest = NULL;
+		pthread_mutex_lock (&sTimerMutex);
+		for (timer = sTimers; NULL != timer; timer = timer->mNextTimer)
+		{
+			if (timer->mPending && timer->mDeadline <= now && (NULL == earliest || timer->mDeadline < earliest->mDeadline))
+			{
+				earliest = timer;
+			}
+		}
+		if (NULL != earliest)
+		{
+			earliest->retain ();
+		}
+		pthread_mutex_unlock (&sTimerMutex);
+		if (NULL != earliest)
+		{
+			earliest->fire ();
+			earliest->release ();
+		}
+	} while (NULL != earliest);
+}
+
+IOReturn IOTimerEventSource::setTimeoutMS (UInt32 milliseconds) {
+	return setTimeout ((AbsoluteTime) (milliseconds * NSEC_PER_MSEC));
+}
+
+IOReturn IOTimerEventSource::setTimeoutUS (UInt32 microseconds) {
+	return setTimeout ((AbsoluteTime) (microseconds * NSEC_PER_USEC));
+}
+
+IOReturn IOTimerEventSource::setTimeout (UInt32 interval, UInt32 scaleFactor) {
+	return setTimeout ((AbsoluteTime) interval * scaleFactor);
+}
+
+IOReturn IOTimerEventSource::setTimeout (AbsoluteTime interval) {
+	UInt64							now;
+
+	clock_get_uptime (&now);
+	mDeadline = now + interval;
+	mPending = true;
+	return kIOReturnSuccess;
+}
+
+void IOTimerEventSource::cancelTimeout () {
+	mPending = false;
+}
+
+void IOTimerEventSource::fire () {
+	mPending = false;
+	if (mEnabled && NULL != mTimerAction)
+	{
+		if (NULL != mWorkLoop)
+		{
+			mWorkLoop->closeGate ();
+		}
+		mTimerAction (owner, this);
+		if (NULL != mWorkLoop)
+		{
+			mWorkLoop->openGate ();
+		}
+	}
+}
+
+#pragma mark -Memory descriptors-
+
+OSDefineMetaClassAndAbstractStructors (IOMemoryDescriptor, OSObject)
+OSDefineMetaClassAndStructors (IOMemoryMap, OSObject)
+OSDefineMetaClassAndStructors (IOGeneralMemoryDescriptor, IOMemoryDescriptor)
+OSDefineMetaClassAndStructors (IOBufferMemoryDescriptor, IOGeneralMemoryDescriptor)
+OSDefineMetaClassAndStructors (IOSubMemoryDescriptor, IOMemoryDescriptor)
+OSDefineMetaClassAndStructors (IOMultiMemoryDescriptor, IOMemoryDescriptor)
+OSDefineMetaClassAndStructors (IODMACommand, OSObject)
+OSDefineMetaClassAndStructors (IOMemoryCursor, OSObject)
+
+IOMemoryDescriptor * IOMemoryDescriptor::withAddress (void * address, IOByteCount withLength, IODirection withDirection) {
+	IOGeneralMemoryDescriptor *		descriptor = new IOGeneralMemoryDescriptor;
+
+	if (NULL != descriptor)
+	{
+		descriptor->mAddress = address;
+		descriptor->mLength = withLength;
+		descriptor->mDirection = withDirection;
+	}
+	return descriptor;
+}
+
+IOMemoryDescriptor * IOMemoryDescriptor::withAddressRange (mach_vm_address_t address, mach_vm_size_t length, IOOptionBits options, task_t task) {
+	return withAddress ((void *)(uintptr_t) address, length, options & kIODirectionOutIn);
+}
+
+IOByteCount IOMemoryDescriptor::readBytes (IOByteCount offset, void * bytes, IOByteCount withLength) {
+	if (offset >= mLength)
+	{
+		return 0;
+	}
+	if (withLength > mLength - offset)
+	{
+		withLength = mLength - offset;
+	}
+	memcpy (bytes, hostAddress (offset), withLength);
+	return withLength;
+}
+
+IOByteCount IOMemoryDescriptor::writeBytes (IOByteCount offset, const void * bytes, IOByteCount withLength) {
+	if (offset >= mLength)
+	{
+		return 0;
+	}
+	if (withLength > mLength - offset)
+	{
+		withLength = mLength - offset;
+	}
+	memcpy (hostAddress (offset), bytes, withLength);
+	return withLength;
+}
+
+IOPhysicalAddress IOMemoryDescriptor::getPhysicalSegment (IOByteCount offset, IOByteCount * length, IOOptionBits options) {
+	if (offset >= mLength)
+	{
+		if (NULL != length)
+		{
+			*length = 0;
+		}
+		return 0;
+	}
+	if (NULL != length)
+	{
+		*length = mLength - offset;
+	}
+	return (IOPhysicalAddress)(uintptr_t) hostAddress (offset);
+}
+
+void * IOMemoryDescriptor::getVirtualSegment (IOByteCount offset, IOByteCount * length) {
+	return (void *)(uintptr_t) getPhysicalSegment (offset, length);
+}
+
+IOMemoryMap * IOMemoryDescriptor::map (IOOptionBits options) {
+	IOMemoryMap *					memoryMap = new IOMemoryMap;
+
+	if (NULL != memoryMap)
+	{
+		retain ();
+		memoryMap->mDescriptor = this;
+	}
+	return memoryMap;
+}
+
+IOMemoryMap * IOMemoryDescriptor::createMappingInTask (task_t intoTask, mach_vm_address_t atAddress, IOOptionBits options, mach_vm_size_t offset, mach_vm_size_t length) {
+	return map (options);
+}
+
+void IOMemoryMap::free () {
+	if (NULL != mDescriptor)
+	{
+		mDescriptor->release ();
+		mDescriptor = NULL;
+	}
+	OSObject::free ();
+}
+
+IOBufferMemoryDescriptor * IOBufferMemoryDescriptor::withCapacity (vm_size_t capacity, IODirection withDirection, bool withContiguousMemory) {
+	return withOptions (withDirection | (withContiguousMemory ? kIOMemoryPhysicallyContiguous : 0), capacity, 1);
+}
+
+IOBufferMemoryDescriptor * IOBufferMemoryDescriptor::withOptions (IOOptionBits options, vm_size_t capacity, vm_offset_t alignment) {
+	IOBufferMemoryDescriptor *		descriptor = new IOBufferMemoryDescriptor;
+
+	if (NULL != descriptor && !descriptor->initWithOptions (options, capacity, alignment))
+	{
+		descriptor->release ();
+		descriptor = NULL;
+	}
+	return descriptor;
+}
+
+IOBufferMemoryDescriptor * IOBufferMemoryDescriptor::inTaskWithOptions (task_t inTask, IOOptionBits options, vm_size_t capacity, vm_offset_t alignment) {
+	return withOptions (options, capacity, alignment);
+}
+
+IOBufferMemoryDescriptor * IOBufferMemoryDescriptor::inTaskWithPhysicalMask (task_t inTask, IOOptionBits options, mach_vm_size_t capacity, mach_vm_address_t physicalMask) {
+	return withOptions (options, capacity, PAGE_SIZE);
+}
+
+IOBufferMemoryDescriptor * IOBufferMemoryDescriptor::withBytes (const void * bytes, vm_size_t withLength, IODirection withDirection, bool withContiguousMemory) {
+	IOBufferMemoryDescriptor *		descriptor;
+
+	descriptor = withCapacity (withLength, withDirection, withContiguousMemory);
+	if (NULL != descriptor)
+	{
+		memcpy (descriptor->mAddress, bytes, withLength);
+	}
+	return descriptor;
+}
+
+bool IOBufferMemoryDescriptor::initWithOptions (IOOptionBits options, vm_size_t capacity, vm_offset_t alignment) {
+	if (!IOGeneralMemoryDescriptor::init ())
+	{
+		return false;
+	}
+	mAddress = IOMallocAligned ((0 == capacity) ? 1 : capacity, (alignment < 16) ? 16 : alignment);
+	if (NULL == mAddress)
+	{
+		return false;
+	}
+	memset (mAddress, 0, (0 == capacity) ? 1 : capacity);
+	mCapacity = capacity;
+	mLength = capacity;
+	mDirection = options & kIODirectionOutIn;
+	return true;
+}
+
+void IOBufferMemoryDescriptor::free () {
+	if (NULL != mAddress)
+	{
+		IOFreeAligned (mAddress, mCapacity);
+		mAddress = NULL;
+	}
+	IOGeneralMemoryDescriptor::free ();
+}
+
+bool IOBufferMemoryDescriptor::appendBytes (const void * bytes, vm_size_t withLength) {
+	if (withLength > mCapacity - mLength)
+	{
+		withLength = mCapacity - mLength;
+	}
+	memcpy ((UInt8 *) mAddress + mLength, bytes, withLength);
+	mLength += withLength;
+	return true;
+}
+
+IOSubMemoryDescriptor * IOSubMemoryDescriptor::withSubRange (IOMemoryDescriptor * of, IOByteCount offset, IOByteCount length, IOOptionBits options) {
+	IOSubMemoryDescriptor *			descriptor = new IOSubMemoryDescriptor;
+
+	if (NULL != descriptor && !descriptor->initSubRange (of, offset, length, options & kIODirectionOutIn))
+	{
+		descriptor->release ();
+		descriptor = NULL;
+	}
+	return descriptor;
+}
+
+bool IOSubMemoryDescriptor::initSubRange (IOMemoryDescriptor * parent, IOByteCount offset, IOByteCount length, IODirection withDirection) {
+	if (NULL == parent || offset + length > parent->getLength () || !IOMemoryDescriptor::init ())
+	{
+		return false;
+	}
+	parent->retain ();
+	mParent = parent;
+	mStart = offset;
+	mLength = length;
+	mDirection = withDirection;
+	return true;
+}
+
+void IOSubMemoryDescriptor::free () {
+	if (NULL != mParent)
+	{
+		mParent->release ();
+		mParent = NULL;
+	}
+	IOMemoryDescriptor::free ();
+}
+
+IOMultiMemoryDescriptor * IOMultiMemoryDescriptor::withDescriptors (IOMemoryDescriptor ** descriptors, UInt32 withCount, IODirection withDirection, bool asReference) {
+	IOMultiMemoryDescriptor *		descriptor = new IOMultiMemoryDescriptor;
+
+	if (NULL != descriptor && !descriptor->initWithDescriptors (descriptors, withCount, withDirection, asReference))
+	{
+		descriptor->release ();
+		descriptor = NULL;
+	}
+	return descriptor;
+}
+
+bool IOMultiMemoryDescriptor::initWithDescriptors (IOMemoryDescriptor ** descriptors, UInt32 withCount, IODirection withDirection, bool asReference) {
+	if (NULL == descriptors || 0 == withCount || !IOMemoryDescriptor::init ())
+	{
+		return false;
+	}
+	mDescriptors = (IOMemoryDescriptor **) calloc (withCount, sizeof (IOMemoryDescriptor *));
+	mCount = withCount;
+	mLength = 0;
+	for (UInt32 index = 0; index < withCount; index++)
+	{
+		descriptors[index]->retain ();
+		mDescriptors[index] = descriptors[index];
+		mLength += descriptors[index]->getLength ();
+	}
+	mDirection = withDirection;
+	return true;
+}
+
+void IOMultiMemoryDescriptor::free () {
+	for (UInt32 index = 0; index < mCount; index++)
+	{
+		mDescriptors[index]->release ();
+	}
+	::free (mDescriptors);
+	mDescriptors = NULL;
+	mCount = 0;
+	IOMemoryDescriptor::free ();
+}
+
+IOMemoryDescriptor * IOMultiMemoryDescriptor::descriptorForOffset (IOByteCount * offset) {
+	for (UInt32 index = 0; index < mCount; index++)
+	{
+		if (*offset < mDescriptors[index]->getLength ())
+		{
+			return mDescriptors[index];
+		}
+		*offset -= mDescriptors[index]->getLength ();
+	}
+	return NULL;
+}
+
+void * IOMultiMemoryDescriptor::hostAddress (IOByteCount offset) {
+	IOMemoryDescriptor *			descriptor;
+
+	descriptor = descriptorForOffset (&offset);
+	return (NULL != descriptor) ? descriptor->hostAddress (offset) : NULL;
+}
+
+IOByteCount IOMultiMemoryDescriptor::readBytes (IOByteCount offset, void * bytes, IOByteCount withLength) {
+	IOMemoryDescriptor *			descriptor;
+	IOByteCount						localOffset;
+	IOByteCount						done = 0;
+	IOByteCount						chunk;
+
+	while (done < withLength)
+	{
+		localOffset = offset + done;
+		descriptor = descriptorForOffset (&localOffset);
+		if (NULL == descriptor)
+		{
+			break;
+		}
+		chunk = descriptor->readBytes (localOffset, (UInt8 *) bytes + done, withLength - done);
+		if (0 == chunk)
+		{
+			break;
+		}
+		done += chunk;
+	}
+	return done;
+}
+
+IOByteCount IOMultiMemoryDescriptor::writeBytes (IOByteCount offset, const void * bytes, IOByteCount withLength) {
+	IOMemoryDescriptor *			descriptor;
+	IOByteCount						localOffset;
+	IOByteCount						done = 0;
+	IOByteCount						chunk;
+
+	while (done < withLength)
+	{
+		localOffset = offset + done;
+		descriptor = descriptorForOffset (&localOffset);
+		if (NULL == descriptor)
+		{
+			break;
+		}
+		chunk = descriptor->writeBytes (localOffset, (const UInt8 *) bytes + done, withLength - done);
+		if (0 == chunk)
+		{
+			break;
+		}
+		done += chunk;
+	}
+	return done;
+}
@@ -0,0 +1,1192 @@
+/*
+ * Copyright (c) 1998-2010 Apple Computer, Inc. All rights reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this
+ * file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+//--------------------------------------------------------------------------------
+//
+//	File:		KernShim.h
+//
+//	Contains:	A user space stand-in for the parts of libkern, IOKit, IOUSBFamily and
+//				IOAudioFamily that AppleUSBAudio uses, so that the driver sources can be
+//				compiled and exercised on a host. The headers under include/ mirror the SDK
+//				header names and all forward here.
+//
+//				Only what the driver touches is declared. Containers, properties, locks,
+//				thread calls and memory descriptors behave like their kernel counterparts;
+//				hardware facing calls are virtual so a harness can subclass them, and
+//				otherwise do nothing and succeed.
+//
+//	Technology:	OS X
+//
+//--------------------------------------------------------------------------------
+
+#ifndef _KERNSHIM_H
+#define _KERNSHIM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <pthread.h>
+
+#pragma mark -Types-
+
+typedef uint8_t					UInt8;
+typedef int8_t					SInt8;
+typedef uint16_t				UInt16;
+typedef int16_t					SInt16;
+typedef uint32_t				UInt32;
+typedef int32_t					SInt32;
+typedef uint64_t				UInt64;
+typedef int64_t					SInt64;
+typedef unsigned char			Boolean;
+typedef float					Float32;
+typedef double					Float64;
+typedef int						IOReturn;
+typedef UInt32					IOOptionBits;
+typedef UInt32					IOItemCount;
+typedef UInt64					IOByteCount;
+typedef UInt64					IOPhysicalAddress;
+typedef UInt64					IOPhysicalLength;
+typedef UInt64					IOVirtualAddress;
+typedef UInt64					addr64_t;
+typedef UInt64					mach_vm_address_t;
+typedef UInt64					mach_vm_size_t;
+typedef UInt64					vm_offset_t;
+typedef UInt64					vm_size_t;
+typedef UInt64					vm_address_t;
+typedef UInt64					AbsoluteTime;
+typedef UInt64					uint64_t_shim;
+typedef SInt32					IOFixed;
+typedef UInt32					IODirection;
+typedef UInt32					IOPMPowerFlags;
+typedef unsigned int			natural_t;
+typedef int						kern_return_t;
+typedef void *					task_t;
+typedef UInt32					UInt32_t;
+typedef char					io_name_t[128];
+typedef UInt32					OSReturn;
+
+#ifndef TRUE
+#define TRUE					1
+#endif
+#ifndef FALSE
+#define FALSE					0
+#endif
+
+#define PAGE_SIZE				4096
+#define kernel_task				((task_t)0)
+#define KERN_SUCCESS			0
+typedef struct kmod_info			kmod_info_t;
+#define THREAD_UNINT			0
+#define THREAD_INTERRUPTIBLE	1
+#define THREAD_AWAKENED			0
+#define THREAD_TIMED_OUT		1
+#define kNanosecondScale		1
+#define kMicrosecondScale		1000
+#define kMillisecondScale		1000000
+#define kSecondScale			1000000000
+#define NSEC_PER_SEC			1000000000ull
+#define NSEC_PER_MSEC			1000000ull
+#define NSEC_PER_USEC			1000ull
+
+#define AbsoluteTime_to_scalar(x)	(*(UInt64 *)(x))
+#define ADD_ABSOLUTETIME(t1, t2)	(AbsoluteTime_to_scalar(t1) += AbsoluteTime_to_scalar(t2))
+#define SUB_ABSOLUTETIME(t1, t2)	(AbsoluteTime_to_scalar(t1) -= AbsoluteTime_to_scalar(t2))
+#define CMP_ABSOLUTETIME(t1, t2)	((AbsoluteTime_to_scalar(t1) > AbsoluteTime_to_scalar(t2)) ? 1 : ((AbsoluteTime_to_scalar(t1) < AbsoluteTime_to_scalar(t2)) ? -1 : 0))
+#define AbsoluteTime_to_scalar_shim
+
+#define MAC_OS_X_VERSION_MIN_REQUIRED	1060
+#define MAC_OS_X_VERSION_10_5			1050
+#define MAC_OS_X_VERSION_10_6			1060
+#define AVAILABLE_MAC_OS_X_VERSION_10_5_AND_LATER
+#define AVAILABLE_MAC_OS_X_VERSION_10_6_AND_LATER
+#define DEPRECATED_ATTRIBUTE
+#define __private_extern__
+
+#pragma mark -IOReturn-
+
+#define sys_iokit					0xe0000000
+#define sub_iokit_common			0
+#define sub_iokit_usb				0x1C000
+#define iokit_common_err(r)			((IOReturn)(sys_iokit | sub_iokit_common | (r)))
+#define iokit_usb_err(r)			((IOReturn)(sys_iokit | sub_iokit_usb | (r)))
+
+#define kIOReturnSuccess			0
+#define kIOReturnError				iokit_common_err(0x2bc)
+#define kIOReturnNoMemory			iokit_common_err(0x2bd)
+#define kIOReturnNoResources		iokit_common_err(0x2be)
+#define kIOReturnIPCError			iokit_common_err(0x2bf)
+#define kIOReturnNoDevice			iokit_common_err(0x2c0)
+#define kIOReturnNotPrivileged		iokit_common_err(0x2c1)
+#define kIOReturnBadArgument		iokit_common_err(0x2c2)
+#define kIOReturnLockedRead			iokit_common_err(0x2c3)
+#define kIOReturnExclusiveAccess	iokit_common_err(0x2c5)
+#define kIOReturnUnsupported		iokit_common_err(0x2c7)
+#define kIOReturnInternalError		iokit_common_err(0x2c9)
+#define kIOReturnIOError			iokit_common_err(0x2ca)
+#define kIOReturnNotOpen			iokit_common_err(0x2cd)
+#define kIOReturnNotReadable		iokit_common_err(0x2ce)
+#define kIOReturnNotWritable		iokit_common_err(0x2cf)
+#define kIOReturnNotAligned			iokit_common_err(0x2d0)
+#define kIOReturnBadMedia			iokit_common_err(0x2d1)
+#define kIOReturnStillOpen			iokit_common_err(0x2d2)
+#define kIOReturnBusy				iokit_common_err(0x2d5)
+#define kIOReturnTimeout			iokit_common_err(0x2d6)
+#define kIOReturnOffline			iokit_common_err(0x2d7)
+#define kIOReturnNotReady			iokit_common_err(0x2d8)
+#define kIOReturnNotAttached		iokit_common_err(0x2d9)
+#define kIOReturnNoChannels			iokit_common_err(0x2da)
+#define kIOReturnNoSpace			iokit_common_err(0x2db)
+#define kIOReturnPortExists			iokit_common_err(0x2dd)
+#define kIOReturnCannotWire			iokit_common_err(0x2de)
+#define kIOReturnNoInterrupt		iokit_common_err(0x2df)
+#define kIOReturnNoFrames			iokit_common_err(0x2e0)
+#define kIOReturnMessageTooLarge	iokit_common_err(0x2e1)
+#define kIOReturnNotPermitted		iokit_common_err(0x2e2)
+#define kIOReturnNoPower			iokit_common_err(0x2e3)
+#define kIOReturnNoMedia			iokit_common_err(0x2e4)
+#define kIOReturnUnformattedMedia	iokit_common_err(0x2e5)
+#define kIOReturnUnsupportedMode	iokit_common_err(0x2e6)
+#define kIOReturnUnderrun			iokit_common_err(0x2e7)
+#define kIOReturnOverrun			iokit_common_err(0x2e8)
+#define kIOReturnDeviceError		iokit_common_err(0x2e9)
+#define kIOReturnNoCompletion		iokit_common_err(0x2ea)
+#define kIOReturnAborted			iokit_common_err(0x2eb)
+#define kIOReturnNoBandwidth		iokit_common_err(0x2ec)
+#define kIOReturnNotResponding		iokit_common_err(0x2ed)
+#define kIOReturnIsoTooOld			iokit_common_err(0x2ee)
+#define kIOReturnIsoTooNew			iokit_common_err(0x2ef)
+#define kIOReturnNotFound			iokit_common_err(0x2f0)
+#define kIOReturnInvalid			iokit_common_err(0x1)
+
+#pragma mark -libkern-
+
+#define OSSwapInt16(x)				__builtin_bswap16(x)
+#define OSSwapInt32(x)				__builtin_bswap32(x)
+#define OSSwapInt64(x)				__builtin_bswap64(x)
+#define OSSwapLittleToHostInt16(x)	((UInt16)(x))
+#define OSSwapLittleToHostInt32(x)	((UInt32)(x))
+#define OSSwapLittleToHostInt64(x)	((UInt64)(x))
+#define OSSwapHostToLittleInt16(x)	((UInt16)(x))
+#define OSSwapHostToLittleInt32(x)	((UInt32)(x))
+#define OSSwapHostToLittleInt64(x)	((UInt64)(x))
+#define OSSwapBigToHostInt16(x)		OSSwapInt16(x)
+#define OSSwapBigToHostInt32(x)		OSSwapInt32(x)
+#define OSSwapHostToBigInt16(x)		OSSwapInt16(x)
+#define OSSwapHostToBigInt32(x)		OSSwapInt32(x)
+#define OSReadLittleInt16(base, off)	(*(UInt16 *)((UInt8 *)(base) + (off)))
+#define OSReadLittleInt32(base, off)	(*(UInt32 *)((UInt8 *)(base) + (off)))
+
+#define USBToHostWord(x)			OSSwapLittleToHostInt16(x)
+#define USBToHostLong(x)			OSSwapLittleToHostInt32(x)
+#define HostToUSBWord(x)			OSSwapHostToLittleInt16(x)
+#define HostToUSBLong(x)			OSSwapHostToLittleInt32(x)
+
+static inline SInt32 OSIncrementAtomic (volatile SInt32 * address) { return __sync_fetch_and_add (address, 1); }
+static inline SInt32 OSDecrementAtomic (volatile SInt32 * address) { return __sync_fetch_and_sub (address, 1); }
+static inline SInt32 OSAddAtomic (SInt32 amount, volatile SInt32 * address) { return __sync_fetch_and_add (address, amount); }
+static inline SInt64 OSAddAtomic64 (SInt64 amount, volatile SInt64 * address) { return __sync_fetch_and_add (address, amount); }
+static inline UInt32 OSBitOrAtomic (UInt32 mask, volatile UInt32 * address) { return __sync_fetch_and_or (address, mask); }
+static inline UInt32 OSBitAndAtomic (UInt32 mask, volatile UInt32 * address) { return __sync_fetch_and_and (address, mask); }
+static inline bool OSCompareAndSwap (UInt32 oldValue, UInt32 newValue, volatile UInt32 * address) { return __sync_bool_compare_and_swap (address, oldValue, newValue); }
+static inline bool OSCompareAndSwapPtr (void * oldValue, void * newValue, void * volatile * address) { return __sync_bool_compare_and_swap (address, oldValue, newValue); }
+static inline void OSMemoryBarrier (void) { __sync_synchronize (); }
+// Orders device memory only, and like the x86 kernel's is empty, so it cannot stand in for a barrier between threads.
+static inline void OSSynchronizeIO (void) { }
+
+static inline size_t strlcpy (char * dst, const char * src, size_t size)
+{
+	size_t	length = strlen (src);
+
+	if (0 != size)
+	{
+		size_t	copy = (length >= size) ? size - 1 : length;
+
+		memcpy (dst, src, copy);
+		dst[copy] = 0;
+	}
+	return length;
+}
+
+static inline size_t strlcat (char * dst, const char * src, size_t size)
+{
+	size_t	length = strlen (dst);
+
+	return length + strlcpy (dst + length, src, (length < size) ? size - length : 0);
+}
+
+#pragma mark -Kernel services-
+
+void						IOLog (const char * format, ...) __attribute__ ((format (printf, 1, 2)));
+void						kprintf (const char * format, ...) __attribute__ ((format (printf, 1, 2)));
+void						IOSleep (unsigned milliseconds);
+void						IODelay (unsigned microseconds);
+void						IOPause (unsigned nanoseconds);
+void *						IOMalloc (vm_size_t size);
+void						IOFree (void * address, vm_size_t size);
+void *						IOMallocAligned (vm_size_t size, vm_size_t alignment);
+void						IOFreeAligned (void * address, vm_size_t size);
+void *						IOMallocContiguous (vm_size_t size, vm_size_t alignment, IOPhysicalAddress * physicalAddress);
+void						IOFreeContiguous (void * address, vm_size_t size);
+
+// Every IOMalloc () variant and every OSObject allocated is counted, so harnesses can report what an operation allocates.
+typedef struct {
+	UInt64						ioMallocs;
+	UInt64						ioMallocBytes;
+	UInt64						objects;
+	UInt64						objectBytes;
+} KernShimAllocationCounts;
+
+void						KernShimGetAllocationCounts (KernShimAllocationCounts * counts);
+void						panic (const char * format, ...) __attribute__ ((noreturn));
+
+void						clock_get_uptime (AbsoluteTime * result);
+void						clock_get_uptime (UInt64 * result);
+void						absolutetime_to_nanoseconds (AbsoluteTime absoluteTime, UInt64 * result);
+void						nanoseconds_to_absolutetime (UInt64 nanoseconds, AbsoluteTime * result);
+void						clock_interval_to_deadline (UInt32 interval, UInt32 scaleFactor, UInt64 * result);
+void						clock_interval_to_absolutetime_interval (UInt32 interval, UInt32 scaleFactor, UInt64 * result);
+void						clock_get_system_microtime (UInt32 * secs, UInt32 * microsecs);
+void						microuptime (struct timeval * tv);
+
+// Harnesses can drive time themselves; when a clock is installed, clock_get_uptime () returns its value in nanoseconds.
+typedef UInt64				(*KernShimClock) (void);
+void						KernShimSetClock (KernShimClock clock);
+
+// A single threaded harness that holds completions back can hand them over when the driver goes to sleep waiting for them. The
+// hook returns whether it did anything; if it did, IOLockSleep () returns at once so that the caller checks its condition again.
+typedef bool				(*KernShimIdle) (void);
+void						KernShimSetIdle (KernShimIdle idle);
+
+typedef struct _IOLock		IOLock;
+typedef struct _IORecursiveLock	IORecursiveLock;
+typedef struct _IOSimpleLock	IOSimpleLock;
+typedef struct _IORWLock	IORWLock;
+typedef UInt32				IOInterruptState;
+typedef IOLock *			lck_mtx_t_ptr;
+
+IOLock *					IOLockAlloc (void);
+void						IOLockFree (IOLock * lock);
+void						IOLockLock (IOLock * lock);
+bool						IOLockTryLock (IOLock * lock);
+void						IOLockUnlock (IOLock * lock);
+int							IOLockSleep (IOLock * lock, void * event, UInt32 interType);
+int							IOLockSleepDeadline (IOLock * lock, void * event, AbsoluteTime deadline, UInt32 interType);
+void						IOLockWakeup (IOLock * lock, void * event, bool oneThread);
+IORecursiveLock *			IORecursiveLockAlloc (void);
+void						IORecursiveLockFree (IORecursiveLock * lock);
+void						IORecursiveLockLock (IORecursiveLock * lock);
+bool						IORecursiveLockTryLock (IORecursiveLock * lock);
+void						IORecursiveLockUnlock (IORecursiveLock * lock);
+bool						IORecursiveLockHaveLock (const IORecursiveLock * lock);
+IOSimpleLock *				IOSimpleLockAlloc (void);
+void						IOSimpleLockFree (IOSimpleLock * lock);
+void						IOSimpleLockLock (IOSimpleLock * lock);
+void						IOSimpleLockUnlock (IOSimpleLock * lock);
+IOInterruptState			IOSimpleLockLockDisableInterrupt (IOSimpleLock * lock);
+void						IOSimpleLockUnlockEnableInterrupt (IOSimpleLock * lock, IOInterruptState state);
+
+typedef struct _thread_call *	thread_call_t;
+typedef void *				thread_call_param_t;
+typedef void				(*thread_call_func_t) (thread_call_param_t param0, thread_call_param_t param1);
+
+thread_call_t				thread_call_allocate (thread_call_func_t func, thread_call_param_t param0);
+bool						thread_call_free (thread_call_t call);
+bool						thread_call_enter (thread_call_t call);
+bool						thread_call_enter1 (thread_call_t call, thread_call_param_t param1);
+bool						thread_call_enter_delayed (thread_call_t call, UInt64 deadline);
+bool						thread_call_enter1_delayed (thread_call_t call, thread_call_param_t param1, UInt64 deadline);
+bool						thread_call_cancel (thread_call_t call);
+
+// Thread calls run on their own threads by default. A harness that wants determinism can make them run inline
+// instead, in which case delayed calls run at once whatever their deadline.
+void						KernShimSetSynchronousThreadCalls (bool synchronous);
+// Waits until every thread call entered without a deadline has finished.
+void						KernShimDrainThreadCalls (void);
+
+#pragma mark -OSMetaClass-
+
+class OSMetaClass;
+class OSObject;
+class OSMetaClassBase;
+class OSString;
+class OSSymbol;
+class OSDictionary;
+class OSSerialize;
+
+class OSMetaClass {
+public:
+	typedef OSObject *		(*AllocFunction) (void);
+
+	OSMetaClass (const char * className, const OSMetaClass * superClass, AllocFunction allocFunction);
+
+	const char *			getClassName () const { return mClassName; }
+	const OSMetaClass *		getSuperClass () const { return mSuperClass; }
+	OSObject *				alloc () const { return (NULL != mAllocFunction) ? mAllocFunction () : NULL; }
+	bool					isDerivedFrom (const OSMetaClass * other) const;
+	UInt32					getInstanceCount () const { return mInstanceCount; }
+	void					instanceConstructed () const { __sync_fetch_and_add (&mInstanceCount, 1); }
+	void					instanceDestructed () const { __sync_fetch_and_sub (&mInstanceCount, 1); }
+
+	static OSObject *		allocClassWithName (const char * name);
+
+private:
+	const char *			mClassName;
+	const OSMetaClass *		mSuperClass;
+	AllocFunction			mAllocFunction;
+	mutable UInt32			mInstanceCount;
+};
+
+#define OSTypeID(type)				(&type::gMetaClass)
+#define OSTypeIDInst(typeinst)		((typeinst)->getMetaClass ())
+#define OSTypeAlloc(type)			((type *) ((type::gMetaClass).alloc ()))
+#define OSDynamicCast(type, inst)	((type *) OSMetaClassBase::safeMetaCast ((inst), OSTypeID (type)))
+#define OSCheckTypeInst(typeinst, inst)	OSMetaClassBase::checkTypeInst (inst, typeinst)
+
+#define OSDeclareCommonStructors(className)										\
+	public:																		\
+		static const OSMetaClass gMetaClass;									\
+		static const OSMetaClass * const metaClass;								\
+		virtual const OSMetaClass * getMetaClass () const { return &gMetaClass; }
+
+#define OSDeclareDefaultStructors(className)									\
+	OSDeclareCommonStructors (className)										\
+	public:																		\
+		className ();															\
+	protected:																	\
+		virtual ~className ();
+
+#define OSDeclareAbstractStructors(className)									\
+	OSDeclareDefaultStructors (className)
+
+#define OSDefineMetaClassWithAlloc(className, superClassName, allocFunction)	\
+	const OSMetaClass className::gMetaClass (#className, &superClassName::gMetaClass, allocFunction);	\
+	const OSMetaClass * const className::metaClass = &className::gMetaClass;
+
+#define OSDefineMetaClassAndStructors(className, superClassName)				\
+	static OSObject * className##_shimAlloc (void) { return (OSObject *) new className; }	\
+	OSDefineMetaClassWithAlloc (className, superClassName, className##_shimAlloc)	\
+	className::className () { gMetaClass.instanceConstructed (); }				\
+	className::~className () { gMetaClass.instanceDestructed (); }
+
+#define OSDefineMetaClassAndAbstractStructors(className, superClassName)		\
+	OSDefineMetaClassWithAlloc (className, superClassName, NULL)				\
+	className::className () { gMetaClass.instanceConstructed (); }				\
+	className::~className () { gMetaClass.instanceDestructed (); }
+
+#define OSMetaClassDeclareReservedUnused(className, index)
+#define OSMetaClassDeclareReservedUsed(className, index)
+#define OSMetaClassDefineReservedUnused(className, index)
+#define OSMetaClassDefineReservedUsed(className, index)
+
+class OSMetaClassBase {
+public:
+	static const OSMetaClass	gMetaClass;
+	virtual const OSMetaClass *	getMetaClass () const { return &gMetaClass; }
+
+	virtual void				retain () const = 0;
+	virtual void				release () const = 0;
+	virtual int					getRetainCount () const = 0;
+	virtual bool				isEqualTo (const OSMetaClassBase * other) const { return this == other; }
+	virtual bool				serialize (OSSerialize * serializer) const { return false; }
+	void						taggedRetain (const void * tag = 0) const { retain (); }
+	void						taggedRelease (const void * tag = 0) const { release (); }
+
+	OSMetaClassBase *			metaCast (const OSMetaClass * toMeta) const;
+	static OSMetaClassBase *	safeMetaCast (const OSMetaClassBase * anObject, const OSMetaClass * toMeta);
+	static bool					checkTypeInst (const OSMetaClassBase * inst, const OSMetaClassBase * typeinst);
+
+protected:
+	virtual						~OSMetaClassBase () {}
+};
+
+class OSObject : public OSMetaClassBase {
+	OSDeclareDefaultStructors (OSObject)
+
+public:
+	static void *				operator new (size_t size);
+	static void					operator delete (void * memory, size_t size);
+
+	virtual bool				init ();
+	virtual void				free ();
+	virtual void				retain () const;
+	virtual void				release () const;
+	virtual void				release (int when) const { release (); }
+	virtual int					getRetainCount () const;
+
+private:
+	mutable volatile SInt32		mRetainCount;
+};
+
+#pragma mark -Collections-
+
+class OSCollection : public OSObject {
+	OSDeclareAbstractStructors (OSCollection)
+
+public:
+	virtual unsigned int		getCount () const = 0;
+	virtual unsigned int		getCapacity () const = 0;
+	virtual unsigned int		ensureCapacity (unsigned int newCapacity) = 0;
+	virtual void				flushCollection () = 0;
+	// Iteration support for OSCollectionIterator. The iterator is an opaque index.
+	virtual bool				getNextObjectForIterator (unsigned int * index, OSObject ** object) const = 0;
+};
+
+class OSArray : public OSCollection {
+	OSDeclareDefaultStructors (OSArray)
+
+public:
+	static OSArray *			withCapacity (unsigned int capacity);
+	static OSArray *			withObjects (const OSObject * objects[], unsigned int count, unsigned int capacity = 0);
+	static OSArray *			withArray (const OSArray * array, unsigned int capacity = 0);
+
+	virtual bool				initWithCapacity (unsigned int capacity);
+	virtual bool				initWithObjects (const OSObject * objects[], unsigned int count, unsigned int capacity = 0);
+	virtual bool				initWithArray (const OSArray * array, unsigned int capacity = 0);
+	virtual void				free ();
+
+	virtual unsigned int		getCount () const { return mCount; }
+	virtual unsigned int		getCapacity () const { return mCapacity; }
+	virtual unsigned int		ensureCapacity (unsigned int newCapacity);
+	virtual void				flushCollection ();
+	virtual bool				getNextObjectForIterator (unsigned int * index, OSObject ** object) const;
+
+	virtual bool				setObject (const OSMetaClassBase * anObject);
+	virtual bool				setObject (unsigned int index, const OSMetaClassBase * anObject);
+	virtual bool				merge (const OSArray * otherArray);
+	virtual void				replaceObject (unsigned int index, const OSMetaClassBase * anObject);
+	virtual void				removeObject (unsigned int index);
+	virtual bool				isEqualTo (const OSArray * anArray) const;
+	virtual bool				isEqualTo (const OSMetaClassBase * anObject) const;
+	virtual OSObject *			getObject (unsigned int index) const;
+	virtual OSObject *			getLastObject () const;
+	virtual unsigned int		getNextIndexOfObject (const OSMetaClassBase * anObject, unsigned int index) const;
+	virtual OSArray *			copyCollection (OSDictionary * cycleDict = 0);
+
+private:
+	const OSMetaClassBase **	mArray;
+	unsigned int				mCount;
+	unsigned int				mCapacity;
+};
+
+class OSDictionary : public OSCollection {
+	OSDeclareDefaultStructors (OSDictionary)
+
+public:
+	static OSDictionary *		withCapacity (unsigned int capacity);
+	static OSDictionary *		withDictionary (const OSDictionary * dictionary, unsigned int capacity = 0);
+
+	virtual bool				initWithCapacity (unsigned int capacity);
+	virtual bool				initWithDictionary (const OSDictionary * dictionary, unsigned int capacity = 0);
+	virtual void				free ();
+
+	virtual unsigned int		getCount () const { return mCount; }
+	virtual unsigned int		getCapacity () const { return mCapacity; }
+	virtual unsigned int		ensureCapacity (unsigned int newCapacity);
+	virtual void				flushCollection ();
+	virtual bool				getNextObjectForIterator (unsigned int * index, OSObject ** object) const;
+
+	virtual bool				setObject (const OSSymbol * aKey, const OSMetaClassBase * anObject);
+	virtual bool				setObject (const OSString * aKey, const OSMetaClassBase * anObject);
+	virtual bool				setObject (const char * aKey, const OSMetaClassBase * anObject);
+	virtual void				removeObject (const OSSymbol * aKey);
+	virtual void				removeObject (const OSString * aKey);
+	virtual void				removeObject (const char * aKey);
+	virtual bool				merge (const OSDictionary * otherDictionary);
+	virtual OSObject *			getObject (const OSSymbol * aKey) const;
+	virtual OSObject *			getObject (const OSString * aKey) const;
+	virtual OSObject *			getObject (const char * aKey) const;
+	virtual bool				isEqualTo (const OSDictionary * aDictionary) const;
+	virtual bool				isEqualTo (const OSMetaClassBase * anObject) const;
+	virtual OSDictionary *		copyCollection (OSDictionary * cycleDict = 0);
+
+private:
+	typedef struct {
+		const OSSymbol *		key;
+		const OSMetaClassBase *	value;
+	} dictEntry;
+
+	int							findKey (const char * key) const;
+
+	dictEntry *					mDictionary;
+	unsigned int				mCount;
+	unsigned int				mCapacity;
+};
+
+class OSSet : public OSCollection {
+	OSDeclareDefaultStructors (OSSet)
+
+public:
+	static OSSet *				withCapacity (unsigned int capacity);
+	static OSSet *				withSet (const OSSet * set, unsigned int capacity = 0);
+	virtual bool				initWithCapacity (unsigned int capacity);
+	virtual void				free ();
+
+	virtual unsigned int		getCount () const { return (NULL != mMembers) ? mMembers->getCount () : 0; }
+	virtual unsigned int		getCapacity () const { return (NULL != mMembers) ? mMembers->getCapacity () : 0; }
+	virtual unsigned int		ensureCapacity (unsigned int newCapacity) { return mMembers->ensureCapacity (newCapacity); }
+	virtual void				flushCollection () { mMembers->flushCollection (); }
+	virtual bool				getNextObjectForIterator (unsigned int * index, OSObject ** object) const { return mMembers->getNextObjectForIterator (index, object); }
+
+	virtual bool				setObject (const OSMetaClassBase * anObject);
+	virtual void				removeObject (const OSMetaClassBase * anObject);
+	virtual bool				containsObject (const OSMetaClassBase * anObject) const;
+	virtual bool				member (const OSMetaClassBase * anObject) const { return containsObject (anObject); }
+	virtual OSObject *			getAnyObject () const { return mMembers->getObject (0); }
+
+private:
+	OSArray *					mMembers;
+};
+
+typedef OSSet					OSOrderedSet;
+
+class OSIterator : public OSObject {
+	OSDeclareAbstractStructors (OSIterator)
+
+public:
+	virtual void				reset () = 0;
+	virtual bool				isValid () = 0;
+	virtual OSObject *			getNextObject () = 0;
+};
+
+class OSCollectionIterator : public OSIterator {
+	OSDeclareDefaultStructors (OSCollectionIterator)
+
+public:
+	static OSCollectionIterator *	withCollection (const OSCollection * inColl);
+	virtual bool				initWithCollection (const OSCollection * inColl);
+	virtual void				free ();
+
+	virtual void				reset () { mIndex = 0; }
+	virtual bool				isValid () { return true; }
+	virtual OSObject *			getNextObject ();
+
+private:
+	const OSCollection *		mCollection;
+	unsigned int				mIndex;
+};
+
+#pragma mark -Scalars-
+
+class OSNumber : public OSObject {
+	OSDeclareDefaultStructors (OSNumber)
+
+public:
+	static OSNumber *			withNumber (unsigned long long value, unsigned int numberOfBits);
+	static OSNumber *			withNumber (const char * valueString, unsigned int numberOfBits);
+	virtual bool				init (unsigned long long value, unsigned int numberOfBits);
+
+	virtual unsigned int		numberOfBits () const { return mSize; }
+	virtual unsigned int		numberOfBytes () const { return (mSize + 7) / 8; }
+	virtual unsigned char		unsigned8BitValue () const { return (unsigned char) mValue; }
+	virtual unsigned short		unsigned16BitValue () const { return (unsigned short) mValue; }
+	virtual unsigned int		unsigned32BitValue () const { return (unsigned int) mValue; }
+	virtual unsigned long long	unsigned64BitValue () const { return mValue; }
+	virtual void				addValue (signed long long value);
+	virtual void				setValue (unsigned long long value);
+	virtual bool				isEqualTo (const OSNumber * aNumber) const;
+	virtual bool				isEqualTo (const OSMetaClassBase * anObject) const;
+
+private:
+	unsigned long long			mValue;
+	unsigned int				mSize;
+};
+
+class OSString : public OSObject {
+	OSDeclareDefaultStructors (OSString)
+
+public:
+	static OSString *			withCString (const char * cString);
+	static OSString *			withCStringNoCopy (const char * cString) { return withCString (cString); }
+	static OSString *			withString (const OSString * aString);
+	virtual bool				initWithCString (const char * cString);
+	virtual void				free ();
+
+	virtual unsigned int		getLength () const { return (unsigned int) strlen (mString); }
+	virtual const char *		getCStringNoCopy () const { return mString; }
+	virtual char				getChar (unsigned int index) const { return (index < getLength ()) ? mString[index] : 0; }
+	virtual bool				isEqualTo (const OSString * aString) const;
+	virtual bool				isEqualTo (const char * cString) const;
+	virtual bool				isEqualTo (const OSMetaClassBase * anObject) const;
+
+protected:
+	char *						mString;
+};
+
+class OSSymbol : public OSString {
+	OSDeclareDefaultStructors (OSSymbol)
+
+public:
+	static const OSSymbol *		withCString (const char * cString);
+	static const OSSymbol *		withCStringNoCopy (const char * cString) { return withCString (cString); }
+	static const OSSymbol *		withString (const OSString * aString) { return withCString (aString->getCStringNoCopy ()); }
+};
+
+class OSBoolean : public OSObject {
+	OSDeclareDefaultStructors (OSBoolean)
+
+public:
+	static OSBoolean *			withBoolean (bool value);
+	virtual void				free () {}
+	virtual void				retain () const {}
+	virtual void				release () const {}
+	virtual bool				isTrue () const { return mValue; }
+	virtual bool				isFalse () const { return !mValue; }
+	virtual bool				getValue () const { return mValue; }
+	virtual bool				isEqualTo (const OSBoolean * aBoolean) const { return aBoolean == this; }
+
+	bool						mValue;
+};
+
+extern OSBoolean * const &		kOSBooleanTrue;
+extern OSBoolean * const &		kOSBooleanFalse;
+
+class OSData : public OSObject {
+	OSDeclareDefaultStructors (OSData)
+
+public:
+	static OSData *				withCapacity (unsigned int capacity);
+	static OSData *				withBytes (const void * bytes, unsigned int numBytes);
+	static OSData *				withBytesNoCopy (void * bytes, unsigned int numBytes) { return withBytes (bytes, numBytes); }
+	static OSData *				withData (const OSData * inData);
+	virtual bool				initWithCapacity (unsigned int capacity);
+	virtual void				free ();
+
+	virtual unsigned int		getLength () const { return mLength; }
+	virtual unsigned int		getCapacity () const { return mCapacity; }
+	virtual const void *		getBytesNoCopy () const { return (0 != mLength) ? mData : NULL; }
+	virtual const void *		getBytesNoCopy (unsigned int start, unsigned int numBytes) const;
+	virtual bool				appendBytes (const void * bytes, unsigned int numBytes);
+	virtual bool				appendBytes (const OSData * aDataObj) { return appendBytes (aDataObj->getBytesNoCopy (), aDataObj->getLength ()); }
+	virtual bool				isEqualTo (const OSData * aDataObj) const;
+	virtual bool				isEqualTo (const OSMetaClassBase * anObject) const;
+
+private:
+	UInt8 *						mData;
+	unsigned int				mLength;
+	unsigned int				mCapacity;
+};
+
+class OSSerialize : public OSObject {
+	OSDeclareDefaultStructors (OSSerialize)
+};
+
+#pragma mark -Registry-
+
+class IORegistryPlane;
+class IOService;
+class IOWorkLoop;
+class IOCommandGate;
+class IOEventSource;
+class IONotifier;
+
+#define gIOServicePlane					((const IORegistryPlane *) 1)
+#define kIOServicePlane					"IOService"
+#define kIODeviceTreePlane				"IODeviceTree"
+#define kIOPropertyMatchKey				"IOPropertyMatch"
+#define kIOProviderClassKey				"IOProviderClass"
+#define kIONameMatchKey					"IONameMatch"
+#define kIOClassKey						"IOClass"
+#define kIOMatchCategoryKey				"IOMatchCategory"
+#define kIOBundleIdentifierKey			"CFBundleIdentifier"
+#define kIORegistryEntryIDKey			"IORegistryEntryID"
+#define kIOUserClientClassKey			"IOUserClientClass"
+#define kIOServiceTerminate				0x00000004
+#define kIOServiceRequired				0x00000001
+#define kIOServiceSynchronous			0x00000002
+#define kIOServiceAsynchronous			0x00000008
+#define kIORegistryIterateRecursively	0x00000001
+#define kIORegistryIterateParents		0x00000002
+
+class IORegistryEntry : public OSObject {
+	OSDeclareDefaultStructors (IORegistryEntry)
+
+public:
+	virtual bool				init (OSDictionary * dictionary = 0);
+	virtual void				free ();
+
+	virtual bool				setProperty (const OSSymbol * aKey, OSObject * anObject);
+	virtual bool				setProperty (const OSString * aKey, OSObject * anObject);
+	virtual bool				setProperty (const char * aKey, OSObject * anObject);
+	virtual bool				setProperty (const char * aKey, const char * aString);
+	virtual bool				setProperty (const char * aKey, bool aBoolean);
+	virtual bool				setProperty (const char * aKey, unsigned long long aValue, unsigned int aNumberOfBits);
+	virtual bool				setProperty (const char * aKey, void * bytes, unsigned int length);
+	virtual void				removeProperty (const OSSymbol * aKey);
+	virtual void				removeProperty (const OSString * aKey);
+	virtual void				removeProperty (const char * aKey);
+	virtual OSObject *			getProperty (const OSSymbol * aKey) const;
+	virtual OSObject *			getProperty (const OSString * aKey) const;
+	virtual OSObject *			getProperty (const char * aKey) const;
+	virtual OSObject *			getProperty (const char * aKey, const IORegistryPlane * plane, IOOptionBits options = kIORegistryIterateRecursively | kIORegistryIterateParents) const;
+	virtual OSObject *			copyProperty (const char * aKey) const;
+	virtual OSObject *			copyProperty (const char * aKey, const IORegistryPlane * plane, IOOptionBits options = kIORegistryIterateRecursively | kIORegistryIterateParents) const;
+	virtual OSDictionary *		dictionaryWithProperties () const;
+	virtual OSDictionary *		getPropertyTable () const { return mProperties; }
+	virtual IOReturn			setProperties (OSObject * properties) { return kIOReturnUnsupported; }
+
+	virtual const char *		getName (const IORegistryPlane * plane = 0) const { return mName; }
+	virtual void				setName (const char * name, const IORegistryPlane * plane = 0);
+	virtual const char *		getLocation (const IORegistryPlane * plane = 0) const { return mLocation; }
+	virtual void				setLocation (const char * location, const IORegistryPlane * plane = 0);
+	virtual UInt64				getRegistryEntryID () const { return (UInt64)(uintptr_t) this; }
+
+	virtual bool				attachToParent (IORegistryEntry * parent, const IORegistryPlane * plane);
+	virtual void				detachFromParent (IORegistryEntry * parent, const IORegistryPlane * plane);
+	virtual bool				attachToChild (IORegistryEntry * child, const IORegistryPlane * plane) { return true; }
+	virtual void				detachFromChild (IORegistryEntry * child, const IORegistryPlane * plane) {}
+	virtual IORegistryEntry *	getParentEntry (const IORegistryPlane * plane) const { return mParent; }
+	virtual IORegistryEntry *	getChildEntry (const IORegistryPlane * plane) const { return NULL; }
+	virtual OSIterator *		getChildIterator (const IORegistryPlane * plane) const;
+	virtual OSIterator *		getParentIterator (const IORegistryPlane * plane) const;
+	virtual bool				inPlane (const IORegistryPlane * plane = 0) const { return true; }
+
+	static const IORegistryPlane *	getPlane (const char * name) { return gIOServicePlane; }
+	static IORegistryEntry *	fromPath (const char * path, const IORegistryPlane * plane = 0, char * residualPath = 0, int * residualLength = 0, IORegistryEntry * fromEntry = 0) { return NULL; }
+
+protected:
+	OSDictionary *				mProperties;
+	IORegistryEntry *			mParent;
+	char						mName[128];
+	char						mLocation[128];
+};
+
+// There is no device tree on the host, so registry iteration always comes up empty.
+class IORegistryIterator : public OSIterator {
+	OSDeclareDefaultStructors (IORegistryIterator)
+
+public:
+	static IORegistryIterator *	iterateOver (const IORegistryPlane * plane, IOOptionBits options = 0) { return NULL; }
+	static IORegistryIterator *	iterateOver (IORegistryEntry * start, const IORegistryPlane * plane, IOOptionBits options = 0) { return NULL; }
+	virtual void				reset () {}
+	virtual bool				isValid () { return true; }
+	virtual IORegistryEntry *	getNextObject () { return NULL; }
+};
+
+#pragma mark -IOService-
+
+enum {
+	kIOPMPowerOff				= 0,
+	kIOPMDeviceUsable			= 0x00008000,
+	kIOPMMaxPerformance			= 0x00004000,
+	kIOPMContextRetained		= 0x00010000,
+	kIOPMConfigRetained			= 0x00020000,
+	kIOPMSleepCapability		= 0x00040000,
+	kIOPMRestartCapability		= 0x00080000,
+	kIOPMSleep					= 0x00000001,
+	kIOPMRestart				= 0x00000080,
+	kIOPMPowerOn				= 0x00000002,
+	kIOPMPreventIdleSleep		= 0x00000040,
+	kIOPMPowerState1			= 0,
+	kIOPMAckImplied				= 0,
+	kIOPMDoze					= 0x00000400,
+	kIOPMClockNormal			= 0x0004,
+	kIOPMPowerStateVersion1		= 1
+};
+
+typedef struct {
+	unsigned long				version;
+	IOPMPowerFlags				capabilityFlags;
+	IOPMPowerFlags				outputPowerCharacter;
+	IOPMPowerFlags				inputPowerRequirement;
+	unsigned long				staticPower;
+	unsigned long				unbudgetedPower;
+	unsigned long				powerToAttain;
+	unsigned long				timeToAttain;
+	unsigned long				settleUpTime;
+	unsigned long				timeToLower;
+	unsigned long				settleDownTime;
+	unsigned long				powerDomainBudget;
+} IOPMPowerState;
+
+#define kIOPMAcknowledgeTimeout			1000000
+
+#define kIOMessageServiceIsTerminated		iokit_common_msg(0x010)
+#define kIOMessageServiceIsSuspended		iokit_common_msg(0x020)
+#define kIOMessageServiceIsResumed			iokit_common_msg(0x030)
+#define kIOMessageServiceIsRequestingClose	iokit_common_msg(0x100)
+#define kIOMessageServiceIsAttemptingOpen	iokit_common_msg(0x101)
+#define kIOMessageServiceWasClosed			iokit_common_msg(0x110)
+#define kIOMessageServiceBusyStateChange	iokit_common_msg(0x120)
+#define kIOMessageCanDevicePowerOff			iokit_common_msg(0x200)
+#define kIOMessageDeviceWillPowerOff		iokit_common_msg(0x210)
+#define kIOMessageDeviceWillNotPowerOff		iokit_common_msg(0x220)
+#define kIOMessageDeviceHasPoweredOn		iokit_common_msg(0x230)
+#define kIOMessageCanSystemPowerOff			iokit_common_msg(0x240)
+#define kIOMessageSystemWillPowerOff		iokit_common_msg(0x250)
+#define kIOMessageSystemWillNotPowerOff		iokit_common_msg(0x260)
+#define kIOMessageCanSystemSleep			iokit_common_msg(0x270)
+#define kIOMessageSystemWillSleep			iokit_common_msg(0x280)
+#define kIOMessageSystemWillNotSleep		iokit_common_msg(0x290)
+#define kIOMessageSystemHasPoweredOn		iokit_common_msg(0x300)
+#define kIOMessageSystemWillRestart			iokit_common_msg(0x310)
+#define kIOMessageSystemWillPowerOn			iokit_common_msg(0x320)
+#define iokit_common_msg(message)			((UInt32)(sys_iokit | sub_iokit_common | (message)))
+#define iokit_family_msg(sub, message)		((UInt32)(sys_iokit | (sub) | (message)))
+
+typedef bool						(*IOServiceNotificationHandler) (void * target, void * refCon, IOService * newService);
+typedef bool						(*IOServiceMatchingNotificationHandler) (void * target, void * refCon, IOService * newService, IONotifier * notifier);
+typedef IOReturn					(*IOServiceInterestHandler) (void * target, void * refCon, UInt32 messageType, IOService * provider, void * messageArgument, vm_size_t argSize);
+
+#define gIOPublishNotification			((const OSSymbol *) 0)
+#define gIOFirstPublishNotification		((const OSSymbol *) 0)
+#define gIOMatchedNotification			((const OSSymbol *) 0)
+#define gIOFirstMatchNotification		((const OSSymbol *) 0)
+#define gIOTerminatedNotification		((const OSSymbol *) 0)
+#define gIOGeneralInterest				((const OSSymbol *) 0)
+
+class IONotifier : public OSObject {
+	OSDeclareDefaultStructors (IONotifier)
+
+public:
+	virtual void				remove () { release (); }
+	virtual bool				disable () { return true; }
+	virtual void				enable (bool was) {}
+};
+
+class IOService : public IORegistryEntry {
+	OSDeclareDefaultStructors (IOService)
+
+public:
+	virtual bool				init (OSDictionary * dictionary = 0);
+	virtual void				free ();
+
+	virtual IOService *			probe (IOService * provider, SInt32 * score) { return this; }
+	virtual bool				start (IOService * provider);
+	virtual void				stop (IOService * provider);
+	virtual bool				open (IOService * forClient, IOOptionBits options = 0, void * arg = 0);
+	virtual void				close (IOService * forClient, IOOptionBits options = 0);
+	virtual bool				isOpen (const IOService * forClient = 0) const;
+	virtual bool				handleOpen (IOService * forClient, IOOptionBits options, void * arg) { return true; }
+	virtual void				handleClose (IOService * forClient, IOOptionBits options) {}
+	virtual bool				handleIsOpen (const IOService * forClient) const { return false; }
+	virtual bool				terminate (IOOptionBits options = 0);
+	virtual bool				requestTerminate (IOService * provider, IOOptionBits options) { return true; }
+	virtual bool				willTerminate (IOService * provider, IOOptionBits options) { return true; }
+	virtual bool				didTerminate (IOService * provider, IOOptionBits options, bool * defer) { return true; }
+	virtual bool				finalize (IOOptionBits options) { return true; }
+	virtual bool				isInactive () const { return mInactive; }
+	virtual void				registerService (IOOptionBits options = 0) {}
+	virtual bool				matchPropertyTable (OSDictionary * table, SInt32 * score) { return true; }
+	virtual bool				matchPropertyTable (OSDictionary * table) { return true; }
+	virtual bool				compareProperty (OSDictionary * matching, const char * key);
+	static void					publishResource (const char * key, OSObject * value = 0) {}
+	virtual IOReturn			message (UInt32 type, IOService * provider, void * argument = 0) { return kIOReturnUnsupported; }
+	virtual IOReturn			messageClients (UInt32 type, void * argument = 0, vm_size_t argSize = 0) { return kIOReturnSuccess; }
+	virtual IOReturn			newUserClient (task_t owningTask, void * securityID, UInt32 type, void * handler) { return kIOReturnUnsupported; }
+	virtual IOService *			getProvider () const { return mProvider; }
+	virtual IOService *			getClient () const { return NULL; }
+	virtual OSIterator *		getClientIterator () const;
+	virtual OSIterator *		getOpenClientIterator () const { return getClientIterator (); }
+	virtual IOWorkLoop *		getWorkLoop () const;
+	virtual bool				attach (IOService * provider);
+	virtual void				detach (IOService * provider);
+	virtual IOReturn			waitQuiet (UInt64 timeout = ~0ull) { return kIOReturnSuccess; }
+	virtual UInt32				getBusyState () { return 0; }
+	virtual void				adjustBusy (SInt32 delta) {}
+	virtual IOReturn			callPlatformFunction (const OSSymbol * functionName, bool waitForFunction, void * param1, void * param2, void * param3, void * param4) { return kIOReturnUnsupported; }
+	virtual IOReturn			callPlatformFunction (const char * functionName, bool waitForFunction, void * param1, void * param2, void * param3, void * param4) { return kIOReturnUnsupported; }
+	virtual IONotifier *		registerInterest (const OSSymbol * typeOfInterest, IOServiceInterestHandler handler, void * target, void * ref = 0);
+
+	// Power management
+	virtual void				PMinit () {}
+	virtual void				PMstop () {}
+	virtual void				joinPMtree (IOService * driver) {}
+	virtual IOReturn			registerPowerDriver (IOService * controllingDriver, IOPMPowerState * powerStates, unsigned long numberOfStates) { return kIOReturnSuccess; }
+	virtual IOReturn			setPowerState (unsigned long powerStateOrdinal, IOService * whatDevice) { return kIOPMAckImplied; }
+	virtual IOReturn			powerStateWillChangeTo (IOPMPowerFlags capabilities, unsigned long stateNumber, IOService * whatDevice) { return kIOPMAckImplied; }
+	virtual IOReturn			powerStateDidChangeTo (IOPMPowerFlags capabilities, unsigned long stateNumber, IOService * whatDevice) { return kIOPMAckImplied; }
+	virtual IOReturn			changePowerStateTo (unsigned long ordinal) { return kIOReturnSuccess; }
+	virtual IOReturn			changePowerStateToPriv (unsigned long ordinal) { return kIOReturnSuccess; }
+	virtual IOReturn			makeUsable () { return kIOReturnSuccess; }
+	virtual void				acknowledgePowerChange (IOService * whichDriver) {}
+	virtual void				acknowledgeSetPowerState () {}
+	virtual unsigned long		maxCapabilityForDomainState (IOPMPowerFlags domainState) { return 0; }
+	virtual unsigned long		initialPowerStateForDomainState (IOPMPowerFlags domainState) { return 0; }
+	virtual unsigned long		powerStateForDomainState (IOPMPowerFlags domainState) { return 0; }
+	virtual IOReturn			registerPowerDriver (IOService * controllingDriver, IOPMPowerState * powerStates, UInt32 numberOfStates) { return kIOReturnSuccess; }
+
+	static OSDictionary *		serviceMatching (const char * className, OSDictionary * table = 0);
+	static OSDictionary *		nameMatching (const char * name, OSDictionary * table = 0);
+	static IOService *			waitForService (OSDictionary * matching, UInt64 * timeout = 0);
+	static OSIterator *			getMatchingServices (OSDictionary * matching);
+	static IONotifier *			addNotification (const OSSymbol * type, OSDictionary * matching, IOServiceNotificationHandler handler, void * target, void * ref = 0, SInt32 priority = 0);
+	static IONotifier *			addMatchingNotification (const OSSymbol * type, OSDictionary * matching, IOServiceMatchingNotificationHandler handler, void * target, void * ref = 0, SInt32 priority = 0);
+	static IOService *			getResourceService () { return NULL; }
+	static IOService *			getPlatform () { return NULL; }
+	static IOService *			getPMRootDomain () { return NULL; }
+
+	// Harnesses set these directly in place of matching.
+	void						setProvider (IOService * provider) { mProvider = provider; }
+
+protected:
+	IOService *					mProvider;
+	UInt32						mOpenCount;
+	bool						mInactive;
+	IOWorkLoop *				mWorkLoop;
+};
+
+#pragma mark -Work loops-
+
+class IOEventSource : public OSObject {
+	OSDeclareAbstractStructors (IOEventSource)
+
+public:
+	typedef void				(*Action) (OSObject * owner, ...);
+
+	virtual bool				init (OSObject * owner, Action action = 0);
+	virtual void				enable () { mEnabled = true; }
+	virtual void				disable () { mEnabled = false; }
+	virtual bool				isEnabled () const { return mEnabled; }
+	virtual void				setWorkLoop (IOWorkLoop * workLoop) { mWorkLoop = workLoop; }
+	virtual IOWorkLoop *		getWorkLoop () const { return mWorkLoop; }
+	virtual bool				onThread () const { return true; }
+
+protected:
+	OSObject *					owner;
+	Action						action;
+	bool						mEnabled;
+	IOWorkLoop *				mWorkLoop;
+};
+
+class IOWorkLoop : public OSObject {
+	OSDeclareDefaultStructors (IOWorkLoop)
+
+public:
+	typedef IOReturn			(*Action) (OSObject * target, void * arg0, void * arg1, void * arg2, void * arg3);
+
+	static IOWorkLoop *			workLoop ();
+	virtual bool				init ();
+	virtual void				free ();
+	virtual IOReturn			addEventSource (IOEventSource * newEvent);
+	virtual IOReturn			removeEventSource (IOEventSource * toRemove);
+	virtual IOReturn			runAction (Action action, OSObject * target, void * arg0 = 0, void * arg1 = 0, void * arg2 = 0, void * arg3 = 0);
+	virtual bool				onThread () const { return IORecursiveLockHaveLock (mGateLock); }
+	virtual bool				inGate () const { return IORecursiveLockHaveLock (mGateLock); }
+	virtual void				closeGate () { IORecursiveLockLock (mGateLock); }
+	virtual void				openGate () { IORecursiveLockUnlock (mGateLock); }
+
+private:
+	IORecursiveLock *			mGateLock;
+};
+
+class IOCommandGate : public IOEventSource {
+	OSDeclareDefaultStructors (IOCommandGate)
+
+public:
+	typedef IOReturn			(*Action) (OSObject * owner, void * arg0, void * arg1, void * arg2, void * arg3);
+
+	static IOCommandGate *		commandGate (OSObject * owner, Action action = 0);
+	virtual IOReturn			runCommand (void * arg0 = 0, void * arg1 = 0, void * arg2 = 0, void * arg3 = 0);
+	virtual IOReturn			runAction (Action action, void * arg0 = 0, void * arg1 = 0, void * arg2 = 0, void * arg3 = 0);
+	virtual IOReturn			commandSleep (void * event, UInt32 interruptible = THREAD_UNINT);
+	virtual IOReturn			commandSleep (void * event, AbsoluteTime deadline, UInt32 interruptible);
+	virtual void				commandWakeup (void * event, bool oneThread = false);
+};
+
+class IOTimerEventSource : public IOEventSource {
+	OSDeclareDefaultStructors (IOTimerEventSource)
+
+public:
+	typedef void				(*Action) (OSObject * owner, IOTimerEventSource * sender);
+
+	static IOTimerEventSource *	timerEventSource (OSObject * owner, Action action = 0);
+	virtual bool				init (OSObject * owner, Action action = 0);
+	virtual void				free ();
+	virtual IOReturn			setTimeoutMS (UInt32 milliseconds);
+	virtual IOReturn			setTimeoutUS (UInt32 microseconds);
+	virtual IOReturn			setTimeout (UInt32 interval, UInt32 scaleFactor = kNanosecondScale);
+	virtual IOReturn			setTimeout (AbsoluteTime interval);
+	virtual IOReturn			wakeAtTimeMS (UInt32 milliseconds) { return setTimeoutMS (milliseconds); }
+	virtual void				cancelTimeout ();
+
+	// Harnesses fire timers by hand; a timer is pending from setTimeout* until it fires or is cancelled.
+	bool						isPending () const { return mPending; }
+	UInt64						getDeadline () const { return mDeadline; }
+	void						fire ();
+
+	// Fires every pending timer whose deadline has passed, in deadline order, until none are left.
+	static void					fireExpired ();
+
+private:
+	Action						mTimerAction;
+	bool						mPending;
+	UInt64						mDeadline;
+	IOTimerEventSource *		mNextTimer;
+};
+
+class IOInterruptEventSource : public IOEventSource {
+	OSDeclareDefaultStructors (IOInterruptEventSource)
+};
+
+#pragma mark -Memory descriptors-
+
+enum {
+	kIODirectionNone			= 0x0,
+	kIODirectionIn				= 0x1,
+	kIODirectionOut				= 0x2,
+	kIODirectionOutIn			= kIODirectionOut | kIODirectionIn,
+	kIODirectionInOut			= kIODirectionIn | kIODirectionOut
+};
+
+enum {
+	kIOMemoryPhysicallyContiguous	= 0x00000010,
+	kIOMemoryPageable				= 0x00000020,
+	kIOMemoryPurgeable				= 0x00000040,
+	kIOMemorySharingTypeMask		= 0x000f0000,
+	kIOMemoryUnshared				= 0x00000000,
+	kIOMemoryKernelUserShared		= 0x00010000,
+	kIOMapAnywhere					= 0x00000001,
+	kIOMapDefaultCache				= 0x00000000,
+	kIOMapInhibitCache				= 0x00000100,
+	kIOMapReadOnly					= 0x00001000,
+	kIOMapReference					= 0x00004000,
+	kIOMapUnique					= 0x00010000
+};
+
+class IOMemoryMap;
+
+class IOMemoryDescriptor : public OSObject {
+	OSDeclareAbstractStructors (IOMemoryDescriptor)
+
+public:
+	static IOMemoryDescriptor *	withAddress (void * address, IOByteCount withLength, IODirection withDirection);
+	static IOMemoryDescriptor *	withAddressRange (mach_vm_address_t address, mach_vm_size_t length, IOOptionBits options, task_t task);
+
+	virtual IOByteCount			getLength () const { return mLength; }
+	virtual IODirection			getDirection () const { return mDirection; }
+	virtual void				setDirection (IODirection direction) { mDirection = direction; }
+	virtual IOOptionBits		getTag () { return 0; }
+	virtual IOReturn			prepare (IODirection forDirection = kIODirectionNone) { return kIOReturnSuccess; }
+	virtual IOReturn			complete (IODirection forDirection = kIODirectionNone) { return kIOReturnSuccess; }
+	virtual IOByteCount			readBytes (IOByteCount offset, void * bytes, IOByteCount withLength);
+	virtual IOByteCount			writeBytes (IOByteCount offset, const void * bytes, IOByteCount withLength);
+	virtual IOPhysicalAddress	getPhysicalSegment (IOByteCount offset, IOByteCount * length, IOOptionBits options = 0);
+	virtual void *				getVirtualSegment (IOByteCount offset, IOByteCount * length);
+	virtual IOMemoryMap *		map (IOOptionBits options = 0);
+	virtual IOMemoryMap *		createMappingInTask (task_t intoTask, mach_vm_address_t atAddress, IOOptionBits options, mach_vm_size_t offset = 0, mach_vm_size_t length = 0);
+	virtual IOReturn			setPurgeable (IOOptionBits newState, IOOptionBits * oldState) { return kIOReturnSuccess; }
+
+	// The host address that backs offset 0, for harnesses and the sub/multi descriptors.
+	virtual void *				hostAddress (IOByteCount offset) = 0;
+
+protected:
+	IOByteCount					mLength;
+	IODirection					mDirection;
+};
+
+class IOMemoryMap : public OSObject {
+	OSDeclareDefaultStructors (IOMemoryMap)
+
+public:
+	virtual IOVirtualAddress	getVirtualAddress () { return (IOVirtualAddress)(uintptr_t) mDescriptor->hostAddress (0); }
+	virtual mach_vm_address_t	getAddress () { return getVirtualAddress (); }
+	virtual IOByteCount			getLength () { return mDescriptor->getLength (); }
+	virtual IOMemoryDescriptor *	getMemoryDescriptor () { return mDescriptor; }
+	virtual void				free ();
+
+	IOMemoryDescriptor *		mDescriptor;
+};
+
+class IOGeneralMemoryDescriptor : public IOMemoryDescriptor {
+	OSDeclareDefaultStructors (IOGeneralMemoryDescriptor)
+
+public:
+	virtual void *				hostAddress (IOByteCount offset) { return (UInt8 *) mAddress + offset; }
+
+	void *						mAddress;
+};
+
+class IOBufferMemoryDescriptor : public IOGeneralMemoryDescriptor {
+	OSDeclareDefaultStructors (IOBufferMemoryDescriptor)
+
+public:
+	static IOBufferMemoryDescriptor *	withCapacity (vm_size_t capacity, IODirection withDirection, bool withContiguousMemory = false);
+	static IOBufferMemoryDescriptor *	withOptions (IOOptionBits options, vm_size_t capacity, vm_offset_t alignment = 1);
+	static IOBufferMemoryDescriptor *	inTaskWithOptions (task_t inTask, IOOptionBits options, vm_size_t capacity, vm_offset_t alignment = 1);
+	static IOBufferMemoryDescriptor *	inTaskWithPhysicalMask (task_t inTask, IOOptionBits options, mach_vm_size_t capacity, mach_vm_address_t physicalMask);
+	static IOBufferMemoryDescriptor *	withBytes (const void * bytes, vm_size_t withLength, IODirection withDirection, bool withContiguousMemory = false);
+	virtual bool				initWithOptions (IOOptionBits options, vm_size_t capacity, vm_offset_t alignment);
+	virtual void				free ();
+
+	virtual void *				getBytesNoCopy () { return mAddress; }
+	virtual void *				getBytesNoCopy (vm_size_t start, vm_size_t withLength) { return (UInt8 *) mAddress + start; }
+	virtual vm_size_t			getCapacity () const { return mCapacity; }
+	virtual void				setLength (vm_size_t length) { mLength = length; }
+	virtual bool				appendBytes (const void * bytes, vm_size_t withLength);
+
+private:
+	vm_size_t					mCapacity;
+};
+
+class IOSubMemoryDescriptor : public IOMemoryDescriptor {
+	OSDeclareDefaultStructors (IOSubMemoryDescriptor)
+
+public:
+	static IOSubMemoryDescriptor *	withSubRange (IOMemoryDescriptor * of, IOByteCount offset, IOByteCount length, IOOptionBits options);
+	virtual bool				initSubRange (IOMemoryDescriptor * parent, IOByteCount offset, IOByteCount length, IODirection withDirection);
+	virtual void				free ();
+	virtual void *				hostAddress (IOByteCount offset) { return mParent->hostAddress (mStart + offset); }
+
+private:
+	IOMemoryDescriptor *		mParent;
+	IOByteCount					mStart;
+};
+
+class IOMultiMemoryDescriptor : public IOMemoryDescriptor {
+	OSDeclareDefaultStructors (IOMultiMemoryDescriptor)
+
+public:
+	static IOMultiMemoryDescriptor *	withDescriptors (IOMemoryDescriptor ** descriptors, UInt32 withCount, IODirection withDirection, bool asReference = false);
+	virtual bool				initWithDescriptors (IOMemoryDescriptor ** descriptors, UInt32 withCount, IODirection withDirection, bool asReference = false);
+	virtual void				free ();
+	virtual IOByteCount			readBytes (IOByteCount offset, void * bytes, IOByteCount withLength);
+	virtual IOByteCount			writeBytes (IOByteCount offset, const void * bytes, IOByteCount withLength);
+	virtual void *				hostAddress (IOByteCount offset);
+
+	IOMemoryDescriptor *		descriptorForOffset (IOByteCount * offset);
+
+private:
+	IOMemoryDescriptor **		mDescriptors;
+	UInt32						mCount;
+};
+
+class IODMACommand : public OSObject {
+	OSDeclareDefaultStructors (IODMACommand)
+};
+
+class IOMemoryCursor : public OSObject {
+	OSDeclareDefaultStructors (IOMemoryCursor)
+};
+
+#pragma mark -Misc-
+
+#define kIOKitBuildVersionKey			"IOKitBuildVersion"
+#define kIOKitDiagnosticsKey			"IOKitDiagnostics"
+
+static inline IOFixed IOFixedMultiply (IOFixed a, IOFixed b) { return (IOFixed)(((SInt64) a * (SInt64) b) >> 16); }
+static inline IOFixed IOFixedDivide (IOFixed a, IOFixed b) { return (IOFixed)((((SInt64) a) << 16) / b); }
+
+#endif /* _KERNSHIM_H */
@@ -0,0 +1,864 @@
+/*
+ * Copyright (c) 1998-2010 Apple Computer, Inc. All rights reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this
+ * file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+//--------------------------------------------------------------------------------
+//
+//	File:		KernShimAudio.cpp
+//
+//	Contains:	Default behaviour of the IOAudioFamily classes in the host shim.
+//
+//	Technology:	OS X
+//
+//--------------------------------------------------------------------------------
+
+#include "KernShimAudio.h"
+
+#pragma mark -Controls-
+
+OSDefineMetaClassAndStructors (IOAudioControl, IOService)
+OSDefineMetaClassAndStructors (IOAudioLevelControl, IOAudioControl)
+OSDefineMetaClassAndStructors (IOAudioToggleControl, IOAudioControl)
+OSDefineMetaClassAndStructors (IOAudioSelectorControl, IOAudioControl)
+OSDefineMetaClassAndStructors (IOAudioPort, IOService)
+
+bool IOAudioControl::init (UInt32 type, OSObject * initialValue, UInt32 channelID, const char * channelName, UInt32 cntrlID, UInt32 subType, UInt32 usage, OSDictionary * properties) {
+	if (NULL == initialValue || !IOService::init (properties))
+	{
+		return false;
+	}
+	mType = type;
+	mSubType = subType;
+	mUsage = usage;
+	mChannelID = channelID;
+	mControlID = cntrlID;
+	initialValue->retain ();
+	mValue = initialValue;
+	if (NULL != channelName)
+	{
+		setChannelName (channelName);
+	}
+	return true;
+}
+
+void IOAudioControl::free () {
+	setValueChangeTarget (NULL);
+	if (NULL != mValue)
+	{
+		mValue->release ();
+		mValue = NULL;
+	}
+	IOService::free ();
+}
+
+void IOAudioControl::setValueChangeHandler (IntValueChangeHandler intValueChangeHandler, OSObject * target) {
+	mIntHandler = intValueChangeHandler;
+	setValueChangeTarget (target);
+}
+
+void IOAudioControl::setValueChangeHandler (DataValueChangeHandler dataValueChangeHandler, OSObject * target) {
+	setValueChangeTarget (target);
+}
+
+void IOAudioControl::setValueChangeHandler (ObjectValueChangeHandler objectValueChangeHandler, OSObject * target) {
+	setValueChangeTarget (target);
+}
+
+// The control keeps its target retained, as IOAudioFamily does.
+void IOAudioControl::setValueChangeTarget (OSObject * target) {
+	if (NULL != target)
+	{
+		target->retain ();
+	}
+	if (NULL != mTarget)
+	{
+		mTarget->release ();
+	}
+	mTarget = target;
+}
+
+IOReturn IOAudioControl::setValue (OSObject * newValue) {
+	IOReturn						result;
+
+	if (NULL == newValue)
+	{
+		return kIOReturnBadArgument;
+	}
+	if (NULL != mValue && mValue->isEqualTo (newValue))
+	{
+		return kIOReturnSuccess;
+	}
+	result = performValueChange (newValue);
+	if (kIOReturnSuccess == result)
+	{
+		hardwareValueChanged (newValue);
+	}
+	return result;
+}
+
+IOReturn IOAudioControl::setValue (SInt32 intValue) {
+	OSNumber *						number;
+	IOReturn						result;
+
+	number = OSNumber::withNumber ((unsigned long long)(SInt64) intValue, 32);
+	result = setValue (number);
+	number->release ();
+	return result;
+}
+
+IOReturn IOAudioControl::hardwareValueChanged (OSObject * newValue) {
+	if (NULL == newValue)
+	{
+		return kIOReturnBadArgument;
+	}
+	newValue->retain ();
+	if (NULL != mValue)
+	{
+		mValue->release ();
+	}
+	mValue = newValue;
+	setProperty (kIOAudioControlValueKey, newValue);
+	return kIOReturnSuccess;
+}
+
+IOReturn IOAudioControl::flushValue () {
+	return (NULL != mValue) ? performValueChange (mValue) : kIOReturnSuccess;
+}
+
+SInt32 IOAudioControl::getIntValue () {
+	OSNumber *						number;
+
+	number = OSDynamicCast (OSNumber, mValue);
+	return (NULL != number) ? (SInt32) number->unsigned32BitValue () : 0;
+}
+
+void IOAudioControl::setChannelName (const char * channelName) {
+	setProperty ("IOAudioControlChannelName", channelName);
+}
+
+IOReturn IOAudioControl::performValueChange (OSObject * newValue) {
+	OSNumber *						oldNumber;
+	OSNumber *						newNumber;
+
+	oldNumber = OSDynamicCast (OSNumber, mValue);
+	newNumber = OSDynamicCast (OSNumber, newValue);
+	if (NULL == mIntHandler || NULL == newNumber)
+	{
+		return kIOReturnSuccess;
+	}
+	return mIntHandler (mTarget, this, (NULL != oldNumber) ? (SInt32) oldNumber->unsigned32BitValue () : 0, (SInt32) newNumber->unsigned32BitValue ());
+}
+
+IOAudioLevelControl * IOAudioLevelControl::create (SInt32 initialValue, SInt32 minValue, SInt32 maxValue, IOFixed minDB, IOFixed maxDB, UInt32 channelID, const char * channelName, UInt32 cntrlID, UInt32 subType, UInt32 usage) {
+	IOAudioLevelControl *			control = new IOAudioLevelControl;
+	OSNumber *						number;
+
+	number = OSNumber::withNumber ((unsigned long long)(SInt64) initialValue, 32);
+	if (!control->init (kIOAudioControlTypeLevel, number, channelID, channelName, cntrlID, subType, usage))
+	{
+		control->release ();
+		control = NULL;
+	}
+	else
+	{
+		control->setMinValue (minValue);
+		control->setMaxValue (maxValue);
+		control->setMinDB (minDB);
+		control->setMaxDB (maxDB);
+	}
+	number->release ();
+	return control;
+}
+
+IOAudioLevelControl * IOAudioLevelControl::createVolumeControl (SInt32 initialValue, SInt32 minValue, SInt32 maxValue, IOFixed minDB, IOFixed maxDB, UInt32 channelID, const char * channelName, UInt32 cntrlID, UInt32 usage) {
+	return create (initialValue, minValue, maxValue, minDB, maxDB, channelID, channelName, cntrlID, kIOAudioLevelControlSubTypeVolume, usage);
+}
+
+IOAudioToggleControl * IOAudioToggleControl::create (bool initialValue, UInt32 channelID, const char * channelName, UInt32 cntrlID, UInt32 subType, UInt32 usage) {
+	IOAudioToggleControl *			control = new IOAudioToggleControl;
+	OSNumber *						number;
+
+	number = OSNumber::withNumber (initialValue ? 1 : 0, 8);
+	if (!control->init (kIOAudioControlTypeToggle, number, channelID, channelName, cntrlID, subType, usage))
+	{
+		control->release ();
+		control = NULL;
+	}
+	number->release ();
+	return control;
+}
+
+IOAudioToggleControl * IOAudioToggleControl::createMuteControl (bool initialValue, UInt32 channelID, const char * channelName, UInt32 cntrlID, UInt32 usage) {
+	return create (initialValue, channelID, channelName, cntrlID, kIOAudioToggleControlSubTypeMute, usage);
+}
+
+IOAudioSelectorControl * IOAudioSelectorControl::create (SInt32 initialValue, UInt32 channelID, const char * channelName, UInt32 cntrlID, UInt32 subType, UInt32 usage) {
+	IOAudioSelectorControl *		control = new IOAudioSelectorControl;
+	OSNumber *						number;
+
+	number = OSNumber::withNumber ((unsigned long long)(SInt64) initialValue, 32);
+	if (!control->init (kIOAudioControlTypeSelector, number, channelID, channelName, cntrlID, subType, usage))
+	{
+		control->release ();
+		control = NULL;
+	}
+	else
+	{
+		control->mSelections = OSArray::withCapacity (2);
+	}
+	number->release ();
+	return control;
+}
+
+IOAudioSelectorControl * IOAudioSelectorControl::createInputSelector (SInt32 initialValue, UInt32 channelID, const char * channelName, UInt32 cntrlID) {
+	return create (initialValue, channelID, channelName, cntrlID, kIOAudioSelectorControlSubTypeInput, kIOAudioControlUsageInput);
+}
+
+IOAudioSelectorControl * IOAudioSelectorControl::createOutputSelector (SInt32 initialValue, UInt32 channelID, const char * channelName, UInt32 cntrlID) {
+	return create (initialValue, channelID, channelName, cntrlID, kIOAudioSelectorControlSubTypeOutput, kIOAudioControlUsageOutput);
+}
+
+void IOAudioSelectorControl::free () {
+	if (NULL != mSelections)
+	{
+		mSelections->release ();
+		mSelections = NULL;
+	}
+	IOAudioControl::free ();
+}
+
+IOReturn IOAudioSelectorControl::addAvailableSelection (SInt32 selectionValue, const char * selectionDescription) {
+	OSString *						description;
+	IOReturn						result;
+
+	description = OSString::withCString ((NULL != selectionDescription) ? selectionDescription : "");
+	result = addAvailableSelection (selectionValue, description);
+	description->release ();
+	return result;
+}
+
+IOReturn IOAudioSelectorControl::addAvailableSelection (SInt32 selectionValue, OSString * selectionDescription) {
+	OSDictionary *					selection;
+	OSNumber *						number;
+
+	if (NULL == selectionDescription || valueExists (selectionValue))
+	{
+		return kIOReturnBadArgument;
+	}
+	selection = OSDictionary::withCapacity (2);
+	number = OSNumber::withNumber ((unsigned long long)(SInt64) selectionValue, 32);
+	selection->setObject (kIOAudioSelectorControlSelectionValueKey, number);
+	selection->setObject (kIOAudioSelectorControlSelectionDescriptionKey, selectionDescription);
+	mSelections->setObject (selection);
+	number->release ();
+	selection->release ();
+	setProperty (kIOAudioSelectorControlAvailableSelectionsKey, mSelections);
+	return kIOReturnSuccess;
+}
+
+static int selectionIndex (OSArray * selections, SInt32 selectionValue) {
+	OSDictionary *					selection;
+	OSNumber *						number;
+
+	for (unsigned int index = 0; NULL != selections && index < selections->getCount (); index++)
+	{
+		selection = OSDynamicCast (OSDictionary, selections->getObject (index));
+		number = (NULL != selection) ? OSDynamicCast (OSNumber, selection->getObject (kIOAudioSelectorControlSelectionValueKey)) : NULL;
+		if (NULL != number && (SInt32) number->unsigned32BitValue () == selectionValue)
+		{
+			return (int) index;
+		}
+	}
+	return -1;
+}
+
+IOReturn IOAudioSelectorControl::removeAvailableSelection (SInt32 selectionValue) {
+	int								index;
+
+	index = selectionIndex (mSelections, selectionValue);
+	if (index < 0)
+	{
+		return kIOReturnNotFound;
+	}
+	mSelections->removeObject (index);
+	return kIOReturnSuccess;
+}
+
+IOReturn IOAudioSelectorControl::replaceAvailableSelection (SInt32 selectionValue, const char * selectionDescription) {
+	OSString *						description;
+	IOReturn						result;
+
+	description = OSString::withCString ((NULL != selectionDescription) ? selectionDescription : "");
+	result = replaceAvailableSelection (selectionValue, description);
+	description->release ();
+	return result;
+}
+
+IOReturn IOAudioSelectorControl::replaceAvailableSelection (SInt32 selectionValue, OSString * selectionDescription) {
+	OSDictionary *					selection;
+	int								index;
+
+	index = selectionIndex (mSelections, selectionValue);
+	if (index < 0 || NULL == selectionDescription)
+	{
+		return kIOReturnNotFound;
+	}
+	selection = (OSDictionary *) mSelections->getObject (index);
+	selection->setObject (kIOAudioSelectorControlSelectionDescriptionKey, selectionDescription);
+	return kIOReturnSuccess;
+}
+
+void IOAudioSelectorControl::removeAllAvailableSelections () {
+	if (NULL != mSelections)
+	{
+		mSelections->flushCollection ();
+	}
+}
+
+bool IOAudioSelectorControl::valueExists (SInt32 selectionValue) {
+	return selectionIndex (mSelections, selectionValue) >= 0;
+}
+
+#pragma mark -Streams-
+
+OSDefineMetaClassAndStructors (IOAudioStream, IOService)
+
+bool IOAudioStream::initWithAudioEngine (IOAudioEngine * engine, IOAudioStreamDirection dir, UInt32 startChannelID, const char * streamDescription, OSDictionary * properties) {
+	if (NULL == engine || !IOService::init (properties))
+	{
+		return false;
+	}
+	audioEngine = engine;
+	direction = dir;
+	startingChannelID = startChannelID;
+	mAvailableFormats = OSArray::withCapacity (4);
+	setProperty (kIOAudioStreamDirectionKey, dir, 8);
+	return NULL != mAvailableFormats;
+}
+
+void IOAudioStream::free () {
+	if (NULL != mAvailableFormats)
+	{
+		mAvailableFormats->release ();
+		mAvailableFormats = NULL;
+	}
+	IOService::free ();
+}
+
+void IOAudioStream::stop (IOService * provider) {
+	IOService::stop (provider);
+}
+
+bool IOAudioStream::terminate (IOOptionBits options) {
+	return IOService::terminate (options);
+}
+
+IOReturn IOAudioStream::setFormat (const IOAudioStreamFormat * streamFormat, bool callDriver) {
+	return setFormat (streamFormat, NULL, NULL, callDriver);
+}
+
+IOReturn IOAudioStream::setFormat (const IOAudioStreamFormat * streamFormat, const IOAudioStreamFormatExtension * formatExtensionIn, OSDictionary * formatDict, bool callDriver) {
+	IOReturn						result = kIOReturnSuccess;
+
+	if (NULL == streamFormat)
+	{
+		return kIOReturnBadArgument;
+	}
+	if (callDriver && NULL != audioEngine)
+	{
+		result = audioEngine->performFormatChange (this, streamFormat, audioEngine->getSampleRate ());
+	}
+	if (kIOReturnSuccess == result)
+	{
+		format = *streamFormat;
+		if (NULL != formatExtensionIn)
+		{
+			formatExtension = *formatExtensionIn;
+		}
+		if (format.fNumChannels > maxNumChannels)
+		{
+			maxNumChannels = format.fNumChannels;
+		}
+	}
+	return result;
+}
+
+IOReturn IOAudioStream::hardwareFormatChanged (const IOAudioStreamFormat * streamFormat) {
+	return setFormat (streamFormat, false);
+}
+
+void IOAudioStream::addAvailableFormat (const IOAudioStreamFormat * streamFormat, const IOAudioStreamFormatExtension * formatExtensionIn, const IOAudioSampleRate * minRate, const IOAudioSampleRate * maxRate, const AudioIOFunction * ioFunctionList, UInt32 numFunctions) {
+	struct {
+		IOAudioStreamFormat				format;
+		IOAudioSampleRate				minRate;
+		IOAudioSampleRate				maxRate;
+	}								entry;
+	OSData *						data;
+
+	memset (&entry, 0, sizeof (entry));
+	entry.format = *streamFormat;
+	entry.minRate = *minRate;
+	entry.maxRate = *maxRate;
+	data = OSData::withBytes (&entry, sizeof (entry));
+	mAvailableFormats->setObject (data);
+	data->release ();
+	if (streamFormat->fNumChannels > maxNumChannels)
+	{
+		maxNumChannels = streamFormat->fNumChannels;
+	}
+}
+
+void IOAudioStream::addAvailableFormat (const IOAudioStreamFormat * streamFormat, const IOAudioSampleRate * minRate, const IOAudioSampleRate * maxRate, const AudioIOFunction * ioFunctionList, UInt32 numFunctions) {
+	addAvailableFormat (streamFormat, NULL, minRate, maxRate, ioFunctionList, numFunctions);
+}
+
+void IOAudioStream::clearAvailableFormats () {
+	mAvailableFormats->flushCollection ();
+}
+
+void IOAudioStream::setSampleBuffer (void * buffer, UInt32 size) {
+	sampleBuffer = buffer;
+	sampleBufferSize = size;
+}
+
+#pragma mark -Engines-
+
+OSDefineMetaClassAndStructors (IOAudioEngine, IOService)
+
+bool IOAudioEngine::init (OSDictionary * properties) {
+	if (!IOService::init (properties))
+	{
+		return false;
+	}
+	status = (IOAudioEngineStatus *) IOMalloc (sizeof (IOAudioEngineStatus));
+	audioStreams = OSSet::withCapacity (2);
+	defaultAudioControls = OSSet::withCapacity (2);
+	if (NULL == status || NULL == audioStreams || NULL == defaultAudioControls)
+	{
+		return false;
+	}
+	memset (status, 0, sizeof (IOAudioEngineStatus));
+	state = kIOAudioEngineStopped;
+	return true;
+}
+
+void IOAudioEngine::free () {
+	if (NULL != status)
+	{
+		IOFree (status, sizeof (IOAudioEngineStatus));
+		status = NULL;
+	}
+	if (NULL != audioStreams)
+	{
+		audioStreams->release ();
+		audioStreams = NULL;
+	}
+	if (NULL != defaultAudioControls)
+	{
+		defaultAudioControls->release ();
+		defaultAudioControls = NULL;
+	}
+	if (NULL != commandGate)
+	{
+		commandGate->release ();
+		commandGate = NULL;
+	}
+	if (NULL != workLoop)
+	{
+		workLoop->release ();
+		workLoop = NULL;
+	}
+	IOService::free ();
+}
+
+bool IOAudioEngine::start (IOService * provider) {
+	return start (provider, OSDynamicCast (IOAudioDevice, provider));
+}
+
+bool IOAudioEngine::start (IOService * provider, IOAudioDevice * device) {
+	if (!IOService::start (provider))
+	{
+		return false;
+	}
+	audioDevice = device;
+	if (NULL != device && NULL == workLoop)
+	{
+		workLoop = device->getWorkLoop ();
+		if (NULL != workLoop)
+		{
+			workLoop->retain ();
+			commandGate = IOCommandGate::commandGate (this);
+			workLoop->addEventSource (commandGate);
+		}
+	}
+	return initHardware (provider);
+}
+
+void IOAudioEngine::stop (IOService * provider) {
+	if (kIOAudioEngineRunning == state)
+	{
+		stopAudioEngine ();
+	}
+	IOService::stop (provider);
+}
+
+bool IOAudioEngine::terminate (IOOptionBits options) {
+	return IOService::terminate (options);
+}
+
+IOReturn IOAudioEngine::startAudioEngine () {
+	IOReturn						result = kIOReturnSuccess;
+
+	if (kIOAudioEngineRunning != state)
+	{
+		result = performAudioEngineStart ();
+		if (kIOReturnSuccess == result)
+		{
+			setState (kIOAudioEngineRunning);
+		}
+	}
+	return result;
+}
+
+IOReturn IOAudioEngine::stopAudioEngine () {
+	IOReturn						result = kIOReturnSuccess;
+
+	if (kIOAudioEngineRunning == state || kIOAudioEngineResumed == state)
+	{
+		result = performAudioEngineStop ();
+		setState (kIOAudioEngineStopped);
+	}
+	return result;
+}
+
+IOReturn IOAudioEngine::pauseAudioEngine () {
+	if (kIOAudioEngineRunning == state || kIOAudioEngineResumed == state)
+	{
+		performAudioEngineStop ();
+		setState (kIOAudioEnginePaused);
+	}
+	return kIOReturnSuccess;
+}
+
+IOReturn IOAudioEngine::resumeAudioEngine () {
+	IOReturn						result = kIOReturnSuccess;
+
+	if (kIOAudioEnginePaused == state)
+	{
+		result = performAudioEngineStart ();
+		setState (kIOAudioEngineResumed);
+	}
+	return result;
+}
+
+void IOAudioEngine::takeTimeStamp (bool incrementLoopCount, AbsoluteTime * timestamp) {
+	AbsoluteTime					now;
+
+	if (NULL == timestamp)
+	{
+		clock_get_uptime (&now);
+		timestamp = &now;
+	}
+	if (incrementLoopCount)
+	{
+		status->fCurrentLoopCount++;
+	}
+	status->fLastLoopTime = *timestamp;
+}
+
+IOReturn IOAudioEngine::getLoopCountAndTimeStamp (UInt32 * loopCount, AbsoluteTime * timestamp) {
+	*loopCount = status->fCurrentLoopCount;
+	*timestamp = status->fLastLoopTime;
+	return kIOReturnSuccess;
+}
+
+IOReturn IOAudioEngine::eraseOutputSamples (const void * mixBuf, void * sampleBuf, UInt32 firstSampleFrame, UInt32 numSampleFrames, const IOAudioStreamFormat * streamFormat, IOAudioStream * audioStream) {
+	UInt32							bytesPerFrame;
+
+	bytesPerFrame = streamFormat->fNumChannels * (streamFormat->fBitWidth / 8);
+	if (NULL != sampleBuf)
+	{
+		memset ((UInt8 *) sampleBuf + firstSampleFrame * bytesPerFrame, 0, numSampleFrames * bytesPerFrame);
+	}
+	if (NULL != mixBuf)
+	{
+		memset ((float *) mixBuf + firstSampleFrame * streamFormat->fNumChannels, 0, numSampleFrames * streamFormat->fNumChannels * sizeof (float));
+	}
+	return kIOReturnSuccess;
+}
+
+IOReturn IOAudioEngine::addAudioStream (IOAudioStream * stream) {
+	if (NULL == stream)
+	{
+		return kIOReturnBadArgument;
+	}
+	stream->attach (this);
+	audioStreams->setObject (stream);
+	return kIOReturnSuccess;
+}
+
+IOAudioStream * IOAudioEngine::getAudioStream (IOAudioStreamDirection direction, UInt32 channelID) {
+	OSCollectionIterator *			iterator;
+	IOAudioStream *					stream;
+	IOAudioStream *					found = NULL;
+
+	iterator = OSCollectionIterator::withCollection (audioStreams);
+	while (NULL == found && NULL != (stream = (IOAudioStream *) iterator->getNextObject ()))
+	{
+		if (stream->getDirection () == direction && channelID >= stream->getStartingChannelID () && channelID < stream->getStartingChannelID () + ((0 == stream->getMaxNumChannels ()) ? 1 : stream->getMaxNumChannels ()))
+		{
+			found = stream;
+		}
+	}
+	iterator->release ();
+	return found;
+}
+
+IOReturn IOAudioEngine::addDefaultAudioControl (IOAudioControl * defaultAudioControl) {
+	if (NULL == defaultAudioControl)
+	{
+		return kIOReturnBadArgument;
+	}
+	defaultAudioControls->setObject (defaultAudioControl);
+	return kIOReturnSuccess;
+}
+
+IOReturn IOAudioEngine::removeDefaultAudioControl (IOAudioControl * defaultAudioControl) {
+	if (NULL == defaultAudioControl || !defaultAudioControls->containsObject (defaultAudioControl))
+	{
+		return kIOReturnNotFound;
+	}
+	defaultAudioControls->removeObject (defaultAudioControl);
+	return kIOReturnSuccess;
+}
+
+void IOAudioEngine::removeAllDefaultAudioControls () {
+	defaultAudioControls->flushCollection ();
+}
+
+void IOAudioEngine::setOutputSampleLatency (UInt32 numSamples) {
+	mOutputSampleLatency = numSamples;
+	setProperty (kIOAudioEngineOutputSampleLatencyKey, numSamples, 32);
+}
+
+void IOAudioEngine::setInputSampleLatency (UInt32 numSamples) {
+	mInputSampleLatency = numSamples;
+	setProperty (kIOAudioEngineInputSampleLatencyKey, numSamples, 32);
+}
+
+void IOAudioEngine::setSampleOffset (UInt32 numSamples) {
+	setOutputSampleOffset (numSamples);
+}
+
+void IOAudioEngine::setOutputSampleOffset (UInt32 numSamples) {
+	mOutputSampleOffset = numSamples;
+	setProperty (kIOAudioEngineSampleOffsetKey, numSamples, 32);
+}
+
+void IOAudioEngine::setInputSampleOffset (UInt32 numSamples) {
+	mInputSampleOffset = numSamples;
+	setProperty (kIOAudioEngineInputSampleOffsetKey, numSamples, 32);
+}
+
+void IOAudioEngine::setDescription (const char * description) {
+	setProperty (kIOAudioEngineDescriptionKey, description);
+}
+
+OSString * IOAudioEngine::getGlobalUniqueID () {
+	char							uniqueID[64];
+
+	snprintf (uniqueID, sizeof (uniqueID), "KernShimEngine:%p", this);
+	return OSString::withCString (uniqueID);
+}
+
+OSString * IOAudioEngine::getLocalUniqueID () {
+	return getGlobalUniqueID ();
+}
+
+IOWorkLoop * IOAudioEngine::getWorkLoop () const {
+	return workLoop;
+}
+
+IOReturn IOAudioEngine::hardwareSampleRateChanged (const IOAudioSampleRate * newSampleRate) {
+	if (NULL == newSampleRate)
+	{
+		return kIOReturnBadArgument;
+	}
+	setSampleRate (newSampleRate);
+	return kIOReturnSuccess;
+}
+
+#pragma mark -Devices-
+
+OSDefineMetaClassAndStructors (IOAudioDevice, IOService)
+
+bool IOAudioDevice::init (OSDictionary * properties) {
+	if (!IOService::init (properties))
+	{
+		return false;
+	}
+	audioEngines = OSArray::withCapacity (2);
+	workLoop = IOWorkLoop::workLoop ();
+	if (NULL == audioEngines || NULL == workLoop)
+	{
+		return false;
+	}
+	commandGate = IOCommandGate::commandGate (this);
+	workLoop->addEventSource (commandGate);
+	mPowerState = kIOAudioDeviceActive;
+	return true;
+}
+
+void IOAudioDevice::free () {
+	if (NULL != audioEngines)
+	{
+		audioEngines->release ();
+		audioEngines = NULL;
+	}
+	if (NULL != commandGate)
+	{
+		commandGate->release ();
+		commandGate = NULL;
+	}
+	if (NULL != workLoop)
+	{
+		workLoop->release ();
+		workLoop = NULL;
+	}
+	IOService::free ();
+}
+
+bool IOAudioDevice::start (IOService * provider) {
+	bool							result;
+
+	if (!IOService::start (provider))
+	{
+		return false;
+	}
+	duringStartup = true;
+	result = initHardware (provider);
+	duringStartup = false;
+	return result;
+}
+
+void IOAudioDevice::stop (IOService * provider) {
+	removeAllTimerEvents ();
+	deactivateAllAudioEngines ();
+	IOService::stop (provider);
+}
+
+bool IOAudioDevice::willTerminate (IOService * provider, IOOptionBits options) {
+	return IOService::willTerminate (provider, options);
+}
+
+IOReturn IOAudioDevice::activateAudioEngine (IOAudioEngine * audioEngine) {
+	return activateAudioEngine (audioEngine, true);
+}
+
+IOReturn IOAudioDevice::activateAudioEngine (IOAudioEngine * audioEngine, bool shouldStartAudioEngine) {
+	if (NULL == audioEngine || !audioEngine->attach (this))
+	{
+		return kIOReturnBadArgument;
+	}
+	if (shouldStartAudioEngine && !audioEngine->start (this))
+	{
+		audioEngine->detach (this);
+		return kIOReturnError;
+	}
+	audioEngines->setObject (audioEngine);
+	audioEngine->registerService ();
+	return kIOReturnSuccess;
+}
+
+void IOAudioDevice::deactivateAllAudioEngines () {
+	IOAudioEngine *					audioEngine;
+
+	while (0 != audioEngines->getCount ())
+	{
+		audioEngine = (IOAudioEngine *) audioEngines->getObject (0);
+		audioEngine->retain ();
+		audioEngines->removeObject (0);
+		audioEngine->stopAudioEngine ();
+		audioEngine->terminate ();
+		audioEngine->stop (this);
+		audioEngine->detach (this);
+		audioEngine->release ();
+	}
+}
+
+void IOAudioDevice::setDeviceName (const char * deviceName) {
+	setProperty (kIOAudioDeviceNameKey, deviceName);
+}
+
+void IOAudioDevice::setDeviceShortName (const char * shortName) {
+	setProperty (kIOAudioDeviceShortNameKey, shortName);
+}
+
+void IOAudioDevice::setManufacturerName (const char * manufacturerName) {
+	setProperty (kIOAudioDeviceManufacturerNameKey, manufacturerName);
+}
+
+void IOAudioDevice::setDeviceModelName (const char * modelName) {
+	setProperty (kIOAudioDeviceModelIDKey, modelName);
+}
+
+void IOAudioDevice::setConfigurationApplicationBundle (const char * bundleID) {
+	setProperty ("IOAudioDeviceConfigurationApplication", bundleID);
+}
+
+// A single timer event per device is enough for AppleUSBAudio; the harness fires it with fireTimerEvents ().
+IOReturn IOAudioDevice::addTimerEvent (OSObject * target, TimerEvent event, AbsoluteTime interval) {
+	if (NULL == target || NULL == event)
+	{
+		return kIOReturnBadArgument;
+	}
+	mTimerTarget = target;
+	mTimerEvent = event;
+	mTimerInterval = interval;
+	return kIOReturnSuccess;
+}
+
+void IOAudioDevice::removeTimerEvent (OSObject * target) {
+	if (target == mTimerTarget)
+	{
+		mTimerTarget = NULL;
+		mTimerEvent = NULL;
+	}
+}
+
+void IOAudioDevice::removeAllTimerEvents () {
+	mTimerTarget = NULL;
+	mTimerEvent = NULL;
+}
+
+IOWorkLoop * IOAudioDevice::getWorkLoop () const {
+	return workLoop;
+}
+
+void IOAudioDevice::fireTimerEvents () {
+	if (NULL != mTimerEvent)
+	{
+		workLoop->closeGate ();
+		mTimerEvent (mTimerTarget, this);
+		workLoop->openGate ();
+	}
+}
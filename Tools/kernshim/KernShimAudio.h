@@ -0,0 +1,525 @@
+/*
+ * Copyright (c) 1998-2010 Apple Computer, Inc. All rights reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this
+ * file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+//--------------------------------------------------------------------------------
+//
+//	File:		KernShimAudio.h
+//
+//	Contains:	The IOAudioFamily part of the host shim. Engines, streams, devices and
+//				controls keep their state so the driver's overrides can be driven, but
+//				nothing is mixed, clipped or delivered to a user client.
+//
+//	Technology:	OS X
+//
+//--------------------------------------------------------------------------------
+
+#ifndef _KERNSHIMAUDIO_H
+#define _KERNSHIMAUDIO_H
+
+#include "KernShim.h"
+
+#pragma mark -Types-
+
+typedef struct _IOAudioSampleRate {
+	UInt32						whole;
+	UInt32						fraction;
+} IOAudioSampleRate;
+
+typedef struct _IOAudioStreamFormat {
+	UInt32						fNumChannels;
+	UInt32						fSampleFormat;
+	UInt32						fNumericRepresentation;
+	UInt8						fBitDepth;
+	UInt8						fBitWidth;
+	UInt8						fAlignment;
+	UInt8						fByteOrder;
+	UInt8						fIsMixable;
+	UInt32						fDriverTag;
+} IOAudioStreamFormat;
+
+typedef struct _IOAudioStreamFormatExtension {
+	UInt32						fVersion;
+	UInt32						fFlags;
+	UInt32						fFramesPerPacket;
+	UInt32						fBytesPerPacket;
+} IOAudioStreamFormatExtension;
+
+typedef struct _IOAudioEngineStatus {
+	UInt32						fVersion;
+	volatile UInt32				fCurrentLoopCount;
+	volatile AbsoluteTime		fLastLoopTime;
+	volatile UInt32				fEraseHeadSampleFrame;
+} IOAudioEngineStatus;
+
+typedef UInt32					IOAudioStreamDirection;
+typedef UInt32					IOAudioEngineState;
+typedef UInt32					IOAudioDevicePowerState;
+
+enum {
+	kIOAudioStreamDirectionOutput	= 0,
+	kIOAudioStreamDirectionInput	= 1
+};
+
+enum {
+	kIOAudioEngineStopped		= 0,
+	kIOAudioEngineRunning		= 1,
+	kIOAudioEnginePaused		= 2,
+	kIOAudioEngineResumed		= 3
+};
+
+enum {
+	kIOAudioDeviceSleep			= 0,
+	kIOAudioDeviceIdle			= 1,
+	kIOAudioDeviceActive		= 2
+};
+
+enum {
+	INPUT_UNDEFINED							= 0x0200,
+	INPUT_MICROPHONE						= 0x0201,
+	INPUT_DESKTOP_MICROPHONE				= 0x0202,
+	INPUT_PERSONAL_MICROPHONE				= 0x0203,
+	INPUT_OMNIDIRECTIONAL_MICROPHONE		= 0x0204,
+	INPUT_MICROPHONE_ARRAY					= 0x0205,
+	INPUT_PROCESSING_MICROPHONE_ARRAY		= 0x0206,
+	INPUT_MODEM_AUDIO						= 0x0207,
+	OUTPUT_UNDEFINED						= 0x0300,
+	OUTPUT_SPEAKER							= 0x0301,
+	OUTPUT_HEADPHONES						= 0x0302,
+	OUTPUT_HEAD_MOUNTED_DISPLAY_AUDIO		= 0x0303,
+	OUTPUT_DESKTOP_SPEAKER					= 0x0304,
+	OUTPUT_ROOM_SPEAKER						= 0x0305,
+	OUTPUT_COMMUNICATION_SPEAKER			= 0x0306,
+	OUTPUT_LOW_FREQUENCY_EFFECTS_SPEAKER	= 0x0307,
+	BIDIRECTIONAL_UNDEFINED					= 0x0400,
+	BIDIRECTIONAL_HANDSET					= 0x0401,
+	BIDIRECTIONAL_HEADSET					= 0x0402,
+	BIDIRECTIONAL_SPEAKERPHONE_NO_ECHO_REDX	= 0x0403,
+	BIDIRECTIONAL_ECHO_SUPPRESSING_SPEAKERPHONE	= 0x0404,
+	BIDIRECTIONAL_ECHO_CANCELING_SPEAKERPHONE	= 0x0405,
+	TELEPHONY_UNDEFINED						= 0x0500,
+	TELEPHONY_PHONE_LINE					= 0x0501,
+	TELEPHONY_TELEPHONE						= 0x0502,
+	TELEPHONY_DOWN_LINE_PHONE				= 0x0503,
+	EXTERNAL_UNDEFINED						= 0x0600,
+	EXTERNAL_ANALOG_CONNECTOR				= 0x0601,
+	EXTERNAL_DIGITAL_AUDIO_INTERFACE		= 0x0602,
+	EXTERNAL_LINE_CONNECTOR					= 0x0603,
+	EXTERNAL_LEGACY_AUDIO_CONNECTOR			= 0x0604,
+	EXTERNAL_SPDIF_INTERFACE				= 0x0605,
+	EXTERNAL_1394_DA_STREAM					= 0x0606,
+	EXTERNAL_1394_DV_STREAM_SOUNDTRACK		= 0x0607,
+	EMBEDDED_UNDEFINED						= 0x0700,
+	EMBEDDED_LEVEL_CALIBRATION_NOISE_SOURCE	= 0x0701,
+	EMBEDDED_EQUALIZATION_NOISE				= 0x0702,
+	EMBEDDED_CD_PLAYER						= 0x0703,
+	EMBEDDED_DAT							= 0x0704,
+	EMBEDDED_DCC							= 0x0705,
+	EMBEDDED_MINIDISK						= 0x0706,
+	EMBEDDED_ANALOG_TAPE					= 0x0707,
+	EMBEDDED_PHONOGRAPH						= 0x0708,
+	EMBEDDED_VCR_AUDIO						= 0x0709,
+	EMBEDDED_VIDEO_DISC_AUDIO				= 0x070A,
+	EMBEDDED_DVD_AUDIO						= 0x070B,
+	EMBEDDED_TV_TUNER_AUDIO					= 0x070C,
+	EMBEDDED_SATELLITE_RECEIVER_AUDIO		= 0x070D,
+	EMBEDDED_CABLE_TUNER_AUDIO				= 0x070E,
+	EMBEDDED_DSS_AUDIO						= 0x070F,
+	EMBEDDED_RADIO_RECEIVER					= 0x0710,
+	EMBEDDED_RADIO_TRANSMITTER				= 0x0711,
+	EMBEDDED_MULTITRACK_RECORDER			= 0x0712,
+	EMBEDDED_SYNTHESIZER					= 0x0713
+};
+
+#define kIOAudioStreamSampleFormatLinearPCM				'lpcm'
+#define kIOAudioStreamSampleFormatIEEEFloat				'ieee'
+#define kIOAudioStreamSampleFormatALaw					'alaw'
+#define kIOAudioStreamSampleFormatMuLaw					'ulaw'
+#define kIOAudioStreamSampleFormatMPEG					'mpeg'
+#define kIOAudioStreamSampleFormatAC3					'ac-3'
+#define kIOAudioStreamSampleFormat1937AC3				'cac3'
+#define kIOAudioStreamSampleFormat1937MPEG1				'mpg1'
+#define kIOAudioStreamSampleFormat1937MPEG2				'mpg2'
+#define kIOAudioStreamNumericRepresentationSignedInt	'sint'
+#define kIOAudioStreamNumericRepresentationUnsignedInt	'uint'
+#define kIOAudioStreamNumericRepresentationIEEE754Float	'flot'
+#define kIOAudioStreamAlignmentLowByte					0
+#define kIOAudioStreamAlignmentHighByte					1
+#define kIOAudioStreamByteOrderBigEndian				0
+#define kIOAudioStreamByteOrderLittleEndian				1
+#define kFormatExtensionCurrentVersion					1
+#define kIOAudioStreamSampleFormatByteOrderBigEndian	kIOAudioStreamByteOrderBigEndian
+
+#define kIOAudioControlTypeLevel						'levl'
+#define kIOAudioControlTypeToggle						'togl'
+#define kIOAudioControlTypeSelector						'slct'
+#define kIOAudioLevelControlSubTypeVolume				'vlme'
+#define kIOAudioLevelControlSubTypeLFEVolume			'subv'
+#define kIOAudioLevelControlSubTypePRAMVolume			'pram'
+#define kIOAudioToggleControlSubTypeMute				'mute'
+#define kIOAudioToggleControlSubTypeSolo				'solo'
+#define kIOAudioSelectorControlSubTypeOutput			'outp'
+#define kIOAudioSelectorControlSubTypeInput				'inpt'
+#define kIOAudioSelectorControlSubTypeClockSource		'clck'
+#define kIOAudioSelectorControlSubTypeDestination		'dest'
+#define kIOAudioControlUsageOutput						'outp'
+#define kIOAudioControlUsageInput						'inpt'
+#define kIOAudioControlUsagePassThru					'pass'
+#define kIOAudioControlUsageCoreAudioProperty			'prop'
+#define kIOAudioControlChannelIDAll						0
+#define kIOAudioControlChannelIDDefaultLeft				1
+#define kIOAudioControlChannelIDDefaultRight			2
+#define kIOAudioControlChannelNameAll					"All Channels"
+#define kIOAudioControlChannelNameLeft					"Left"
+#define kIOAudioControlChannelNameRight					"Right"
+#define kIOAudioNewClockDomain							0xFFFFFFFF
+
+#define kIOAudioDeviceTransportTypeUSB					"USB"
+#define kIOAudioDeviceNameKey							"IOAudioDeviceName"
+#define kIOAudioDeviceShortNameKey						"IOAudioDeviceShortName"
+#define kIOAudioDeviceManufacturerNameKey				"IOAudioDeviceManufacturerName"
+#define kIOAudioDeviceLocalizedBundleKey				"IOAudioDeviceLocalizedBundle"
+#define kIOAudioDeviceTransportTypeKey					"IOAudioDeviceTransportType"
+#define kIOAudioDeviceModelIDKey						"IOAudioDeviceModelID"
+#define kIOAudioEngineCoreAudioPlugInKey				"IOAudioEngineCoreAudioPlugIn"
+#define kIOAudioEngineFullChannelNamesKey				"IOAudioEngineFullChannelNames"
+#define kIOAudioEngineFullChannelNameKeyInputFormat		"IOAudioEngineChannelNameKeyInputFormat"
+#define kIOAudioEngineFullChannelNameKeyOutputFormat	"IOAudioEngineChannelNameKeyOutputFormat"
+#define kIOAudioEngineInputSampleLatencyKey				"IOAudioEngineInputSampleLatency"
+#define kIOAudioEngineOutputSampleLatencyKey			"IOAudioEngineOutputSampleLatency"
+#define kIOAudioEngineInputSampleOffsetKey				"IOAudioEngineInputSampleOffset"
+#define kIOAudioEngineSampleOffsetKey					"IOAudioEngineSampleOffset"
+#define kIOAudioEngineGlobalUniqueIDKey					"IOAudioEngineGlobalUniqueID"
+#define kIOAudioEngineDescriptionKey					"IOAudioEngineDescription"
+#define kIOAudioEngineClockDomainKey					"IOAudioEngineClockDomain"
+#define kIOAudioEngineClockIsStableKey					"IOAudioEngineClockIsStable"
+#define kIOAudioStreamDirectionKey						"IOAudioStreamDirection"
+#define kIOAudioSelectorControlAvailableSelectionsKey	"IOAudioSelectorControlAvailableSelections"
+#define kIOAudioSelectorControlSelectionValueKey		"IOAudioSelectorControlSelectionValue"
+#define kIOAudioSelectorControlSelectionDescriptionKey	"IOAudioSelectorControlSelectionDescription"
+#define kIOAudioControlValueKey							"IOAudioControlValue"
+
+class IOAudioDevice;
+class IOAudioEngine;
+class IOAudioStream;
+class IOAudioControl;
+class IOAudioPort;
+
+#pragma mark -Controls-
+
+class IOAudioControl : public IOService {
+	OSDeclareDefaultStructors (IOAudioControl)
+
+public:
+	typedef IOReturn			(*IntValueChangeHandler) (OSObject * target, IOAudioControl * audioControl, SInt32 oldValue, SInt32 newValue);
+	typedef IOReturn			(*DataValueChangeHandler) (OSObject * target, IOAudioControl * audioControl, const void * oldData, UInt32 oldDataSize, const void * newData, UInt32 newDataSize);
+	typedef IOReturn			(*ObjectValueChangeHandler) (OSObject * target, IOAudioControl * audioControl, OSObject * oldValue, OSObject * newValue);
+
+	virtual bool				init (UInt32 type, OSObject * initialValue, UInt32 channelID, const char * channelName = 0, UInt32 cntrlID = 0, UInt32 subType = 0, UInt32 usage = 0, OSDictionary * properties = 0);
+	virtual void				free ();
+
+	virtual void				setValueChangeHandler (IntValueChangeHandler intValueChangeHandler, OSObject * target = 0);
+	virtual void				setValueChangeHandler (DataValueChangeHandler dataValueChangeHandler, OSObject * target = 0);
+	virtual void				setValueChangeHandler (ObjectValueChangeHandler objectValueChangeHandler, OSObject * target = 0);
+	virtual void				setValueChangeTarget (OSObject * target);
+
+	virtual IOReturn			setValue (OSObject * newValue);
+	virtual IOReturn			setValue (SInt32 intValue);
+	virtual IOReturn			hardwareValueChanged (OSObject * newValue);
+	virtual IOReturn			flushValue ();
+	virtual void				setReadOnlyFlag () { mReadOnly = true; }
+	virtual OSObject *			getValue () { return mValue; }
+	virtual SInt32				getIntValue ();
+	virtual UInt32				getType () { return mType; }
+	virtual UInt32				getSubType () { return mSubType; }
+	virtual UInt32				getUsage () { return mUsage; }
+	virtual UInt32				getChannelID () { return mChannelID; }
+	virtual UInt32				getControlID () { return mControlID; }
+	virtual void				setChannelName (const char * channelName);
+	virtual void				setChannelNumber (SInt32 channelNumber) {}
+	virtual void				setCoreAudioPropertyID (UInt32 propertyID) {}
+	virtual IOReturn			performValueChange (OSObject * newValue);
+	virtual bool				attachAndStart (IOService * provider) { return true; }
+
+protected:
+	UInt32						mType;
+	UInt32						mSubType;
+	UInt32						mUsage;
+	UInt32						mChannelID;
+	UInt32						mControlID;
+	bool						mReadOnly;
+	OSObject *					mValue;
+	IntValueChangeHandler		mIntHandler;
+	OSObject *					mTarget;
+};
+
+class IOAudioLevelControl : public IOAudioControl {
+	OSDeclareDefaultStructors (IOAudioLevelControl)
+
+public:
+	static IOAudioLevelControl *	create (SInt32 initialValue, SInt32 minValue, SInt32 maxValue, IOFixed minDB, IOFixed maxDB, UInt32 channelID, const char * channelName = 0, UInt32 cntrlID = 0, UInt32 subType = 0, UInt32 usage = 0);
+	static IOAudioLevelControl *	createVolumeControl (SInt32 initialValue, SInt32 minValue, SInt32 maxValue, IOFixed minDB, IOFixed maxDB, UInt32 channelID, const char * channelName = 0, UInt32 cntrlID = 0, UInt32 usage = 0);
+
+	virtual void				setMinValue (SInt32 minValue) { mMinValue = minValue; }
+	virtual SInt32				getMinValue () { return mMinValue; }
+	virtual void				setMaxValue (SInt32 maxValue) { mMaxValue = maxValue; }
+	virtual SInt32				getMaxValue () { return mMaxValue; }
+	virtual void				setMinDB (IOFixed minDB) { mMinDB = minDB; }
+	virtual IOFixed				getMinDB () { return mMinDB; }
+	virtual void				setMaxDB (IOFixed maxDB) { mMaxDB = maxDB; }
+	virtual IOFixed				getMaxDB () { return mMaxDB; }
+	virtual void				setLinearScale (bool useLinearScale) {}
+
+private:
+	SInt32						mMinValue;
+	SInt32						mMaxValue;
+	IOFixed						mMinDB;
+	IOFixed						mMaxDB;
+};
+
+class IOAudioToggleControl : public IOAudioControl {
+	OSDeclareDefaultStructors (IOAudioToggleControl)
+
+public:
+	static IOAudioToggleControl *	create (bool initialValue, UInt32 channelID, const char * channelName = 0, UInt32 cntrlID = 0, UInt32 subType = 0, UInt32 usage = 0);
+	static IOAudioToggleControl *	createMuteControl (bool initialValue, UInt32 channelID, const char * channelName = 0, UInt32 cntrlID = 0, UInt32 usage = 0);
+};
+
+class IOAudioSelectorControl : public IOAudioControl {
+	OSDeclareDefaultStructors (IOAudioSelectorControl)
+
+public:
+	static IOAudioSelectorControl *	create (SInt32 initialValue, UInt32 channelID, const char * channelName = 0, UInt32 cntrlID = 0, UInt32 subType = 0, UInt32 usage = 0);
+	static IOAudioSelectorControl *	createInputSelector (SInt32 initialValue, UInt32 channelID, const char * channelName = 0, UInt32 cntrlID = 0);
+	static IOAudioSelectorControl *	createOutputSelector (SInt32 initialValue, UInt32 channelID, const char * channelName = 0, UInt32 cntrlID = 0);
+
+	virtual void				free ();
+	virtual IOReturn			addAvailableSelection (SInt32 selectionValue, const char * selectionDescription);
+	virtual IOReturn			addAvailableSelection (SInt32 selectionValue, OSString * selectionDescription);
+	virtual IOReturn			addAvailableSelection (SInt32 selectionValue, OSString * selectionDescription, const char * tagName, OSObject * tag) { return addAvailableSelection (selectionValue, selectionDescription); }
+	virtual IOReturn			removeAvailableSelection (SInt32 selectionValue);
+	virtual IOReturn			replaceAvailableSelection (SInt32 selectionValue, const char * selectionDescription);
+	virtual IOReturn			replaceAvailableSelection (SInt32 selectionValue, OSString * selectionDescription);
+	virtual void				removeAllAvailableSelections ();
+	virtual bool				valueExists (SInt32 selectionValue);
+	virtual IOReturn			validateValue (OSObject * newValue) { return kIOReturnSuccess; }
+
+private:
+	OSArray *					mSelections;
+};
+
+class IOAudioPort : public IOService {
+	OSDeclareDefaultStructors (IOAudioPort)
+};
+
+#pragma mark -Streams-
+
+typedef IOReturn (*AudioIOFunction) (const void * mixBuf, void * sampleBuf, UInt32 firstSampleFrame, UInt32 numSampleFrames, const IOAudioStreamFormat * streamFormat, IOAudioStream * audioStream);
+
+class IOAudioStream : public IOService {
+	OSDeclareDefaultStructors (IOAudioStream)
+
+public:
+	virtual bool				initWithAudioEngine (IOAudioEngine * engine, IOAudioStreamDirection dir, UInt32 startChannelID, const char * streamDescription = NULL, OSDictionary * properties = 0);
+	virtual void				free ();
+	virtual void				stop (IOService * provider);
+	virtual bool				terminate (IOOptionBits options = 0);
+
+	virtual IOReturn			setFormat (const IOAudioStreamFormat * streamFormat, bool callDriver = true);
+	virtual IOReturn			setFormat (const IOAudioStreamFormat * streamFormat, const IOAudioStreamFormatExtension * formatExtension, OSDictionary * formatDict, bool callDriver = true);
+	virtual IOReturn			hardwareFormatChanged (const IOAudioStreamFormat * streamFormat);
+	virtual void				addAvailableFormat (const IOAudioStreamFormat * streamFormat, const IOAudioStreamFormatExtension * formatExtension, const IOAudioSampleRate * minRate, const IOAudioSampleRate * maxRate, const AudioIOFunction * ioFunctionList = NULL, UInt32 numFunctions = 0);
+	virtual void				addAvailableFormat (const IOAudioStreamFormat * streamFormat, const IOAudioSampleRate * minRate, const IOAudioSampleRate * maxRate, const AudioIOFunction * ioFunctionList = NULL, UInt32 numFunctions = 0);
+	virtual void				clearAvailableFormats ();
+	virtual bool				validateFormat (IOAudioStreamFormat * streamFormat, IOAudioStreamFormatExtension * formatExtension, OSDictionary * formatDict) { return true; }
+	virtual const IOAudioStreamFormat *	getFormat () { return &format; }
+	virtual const IOAudioStreamFormatExtension *	getFormatExtension () { return &formatExtension; }
+	virtual IOAudioStreamDirection	getDirection () { return direction; }
+	virtual UInt32				getStartingChannelID () { return startingChannelID; }
+	virtual UInt32				getMaxNumChannels () { return maxNumChannels; }
+	virtual void				setSampleBuffer (void * buffer, UInt32 size);
+	virtual void *				getSampleBuffer () { return sampleBuffer; }
+	virtual UInt32				getSampleBufferSize () { return sampleBufferSize; }
+	virtual void				setSampleLatency (UInt32 numSamples) {}
+	virtual void				setTerminalType (const UInt32 terminalType) {}
+	virtual void				setStreamAvailable (bool available) {}
+	virtual bool				getStreamAvailable () { return true; }
+	virtual void				setIOFunction (AudioIOFunction ioFunction) {}
+	virtual void				setIOFunctionList (const AudioIOFunction * ioFunctionList, UInt32 numFunctions) {}
+	virtual UInt32				getNumClients () { return 0; }
+	virtual void				lockStreamForIO () {}
+	virtual void				unlockStreamForIO () {}
+
+	IOAudioEngine *				audioEngine;
+	IOAudioStreamFormat			format;
+	IOAudioStreamFormatExtension	formatExtension;
+	IOAudioStreamDirection		direction;
+	UInt32						startingChannelID;
+	UInt32						maxNumChannels;
+	void *						sampleBuffer;
+	UInt32						sampleBufferSize;
+	OSArray *					mAvailableFormats;
+	IOWorkLoop *				workLoop;
+};
+
+#pragma mark -Engines-
+
+class IOAudioEngine : public IOService {
+	OSDeclareDefaultStructors (IOAudioEngine)
+
+public:
+	virtual bool				init (OSDictionary * properties);
+	virtual void				free ();
+	virtual bool				start (IOService * provider);
+	virtual bool				start (IOService * provider, IOAudioDevice * device);
+	virtual void				stop (IOService * provider);
+	virtual bool				initHardware (IOService * provider) { return true; }
+	virtual bool				terminate (IOOptionBits options = 0);
+
+	virtual IOReturn			performAudioEngineStart () { return kIOReturnSuccess; }
+	virtual IOReturn			performAudioEngineStop () { return kIOReturnSuccess; }
+	virtual IOReturn			startAudioEngine ();
+	virtual IOReturn			stopAudioEngine ();
+	virtual IOReturn			pauseAudioEngine ();
+	virtual IOReturn			resumeAudioEngine ();
+	virtual IOReturn			performFormatChange (IOAudioStream * audioStream, const IOAudioStreamFormat * newFormat, const IOAudioSampleRate * newSampleRate) { return kIOReturnSuccess; }
+	virtual UInt32				getCurrentSampleFrame () { return 0; }
+	virtual void				takeTimeStamp (bool incrementLoopCount = true, AbsoluteTime * timestamp = NULL);
+	virtual IOReturn			getLoopCountAndTimeStamp (UInt32 * loopCount, AbsoluteTime * timestamp);
+	virtual IOReturn			clipOutputSamples (const void * mixBuf, void * sampleBuf, UInt32 firstSampleFrame, UInt32 numSampleFrames, const IOAudioStreamFormat * streamFormat, IOAudioStream * audioStream) { return kIOReturnSuccess; }
+	virtual IOReturn			convertInputSamples (const void * sampleBuf, void * destBuf, UInt32 firstSampleFrame, UInt32 numSampleFrames, const IOAudioStreamFormat * streamFormat, IOAudioStream * audioStream) { return kIOReturnSuccess; }
+	virtual IOReturn			eraseOutputSamples (const void * mixBuf, void * sampleBuf, UInt32 firstSampleFrame, UInt32 numSampleFrames, const IOAudioStreamFormat * streamFormat, IOAudioStream * audioStream);
+	virtual void				resetClipPosition (IOAudioStream * audioStream, UInt32 clipSampleFrame) {}
+
+	virtual IOReturn			addAudioStream (IOAudioStream * stream);
+	virtual IOAudioStream *		getAudioStream (IOAudioStreamDirection direction, UInt32 channelID);
+	virtual IOReturn			addDefaultAudioControl (IOAudioControl * defaultAudioControl);
+	virtual IOReturn			removeDefaultAudioControl (IOAudioControl * defaultAudioControl);
+	virtual void				removeAllDefaultAudioControls ();
+	virtual void				beginConfigurationChange () {}
+	virtual void				completeConfigurationChange () {}
+	virtual void				cancelConfigurationChange () {}
+
+	virtual void				setSampleRate (const IOAudioSampleRate * newSampleRate) { sampleRate = *newSampleRate; }
+	virtual const IOAudioSampleRate *	getSampleRate () { return &sampleRate; }
+	virtual void				setNumSampleFramesPerBuffer (UInt32 numSampleFrames) { numSampleFramesPerBuffer = numSampleFrames; }
+	virtual UInt32				getNumSampleFramesPerBuffer () { return numSampleFramesPerBuffer; }
+	virtual void				setSampleLatency (UInt32 numSamples) { setOutputSampleLatency (numSamples); setInputSampleLatency (numSamples); }
+	virtual void				setOutputSampleLatency (UInt32 numSamples);
+	virtual void				setInputSampleLatency (UInt32 numSamples);
+	virtual void				setSampleOffset (UInt32 numSamples);
+	virtual void				setOutputSampleOffset (UInt32 numSamples);
+	virtual void				setInputSampleOffset (UInt32 numSamples);
+	virtual void				setRunEraseHead (bool runEraseHead) {}
+	virtual bool				getRunEraseHead () { return false; }
+	virtual void				setMixClipOverhead (UInt32 percent) {}
+	virtual void				setClockDomain (UInt32 clockDomain = kIOAudioNewClockDomain) {}
+	virtual void				setClockIsStable (bool clockIsStable) {}
+	virtual void				setDescription (const char * description);
+	virtual void				setState (IOAudioEngineState newState) { state = newState; }
+	virtual IOAudioEngineState	getState () { return state; }
+	virtual IOAudioDevice *		getAudioDevice () { return audioDevice; }
+	virtual OSString *			getGlobalUniqueID ();
+	virtual OSString *			getLocalUniqueID ();
+	virtual void				setWorkLoopOnAllAudioControls (IOWorkLoop * wl) {}
+	virtual IOWorkLoop *		getWorkLoop () const;
+	virtual IOCommandGate *		getCommandGate () const { return commandGate; }
+	virtual void				updateChannelNumbers () {}
+	virtual void				lockAllStreams () {}
+	virtual void				unlockAllStreams () {}
+	virtual IOReturn			hardwareSampleRateChanged (const IOAudioSampleRate * sampleRate);
+
+	IOAudioDevice *				audioDevice;
+	IOAudioEngineStatus *		status;
+	IOAudioSampleRate			sampleRate;
+	UInt32						numSampleFramesPerBuffer;
+	IOAudioEngineState			state;
+	OSSet *						audioStreams;
+	OSSet *						defaultAudioControls;
+	IOWorkLoop *				workLoop;
+	IOCommandGate *				commandGate;
+	UInt32						numActiveUserClients;
+	UInt32						numErasesPerBuffer;
+	bool						isRegistered;
+	UInt32						mOutputSampleLatency;
+	UInt32						mInputSampleLatency;
+	UInt32						mOutputSampleOffset;
+	UInt32						mInputSampleOffset;
+};
+
+#pragma mark -Devices-
+
+class IOAudioDevice : public IOService {
+	OSDeclareDefaultStructors (IOAudioDevice)
+
+public:
+	typedef void				(*TimerEvent) (OSObject * target, IOAudioDevice * audioDevice);
+
+	virtual bool				init (OSDictionary * properties);
+	virtual void				free ();
+	virtual bool				start (IOService * provider);
+	virtual void				stop (IOService * provider);
+	virtual bool				willTerminate (IOService * provider, IOOptionBits options);
+	virtual bool				initHardware (IOService * provider) { return true; }
+
+	virtual IOReturn			activateAudioEngine (IOAudioEngine * audioEngine);
+	virtual IOReturn			activateAudioEngine (IOAudioEngine * audioEngine, bool shouldStartAudioEngine);
+	virtual void				deactivateAllAudioEngines ();
+	virtual IOReturn			flushAudioControls () { return kIOReturnSuccess; }
+	virtual IOReturn			performPowerStateChange (IOAudioDevicePowerState oldPowerState, IOAudioDevicePowerState newPowerState, UInt32 * microsecondsUntilComplete) { return kIOReturnSuccess; }
+	virtual IOAudioDevicePowerState	getPowerState () { return mPowerState; }
+	virtual IOAudioDevicePowerState	getPendingPowerState () { return mPowerState; }
+	virtual void				setFamilyManagePower (bool manage) {}
+	virtual IOReturn			setAggressiveness (unsigned long type, unsigned long newLevel) { return kIOReturnSuccess; }
+	virtual void				setIdleAudioSleepTime (unsigned long long sleepDelay) {}
+
+	virtual void				setDeviceName (const char * deviceName);
+	virtual void				setDeviceShortName (const char * shortName);
+	virtual void				setManufacturerName (const char * manufacturerName);
+	virtual void				setDeviceModelName (const char * modelName);
+	virtual void				setDeviceTransportType (const UInt32 transportType) {}
+	virtual void				setDeviceTransportType (const char * transportType) {}
+	virtual void				setDeviceCanBeDefault (UInt32 defaultsFlags) {}
+	virtual void				setConfigurationApplicationBundle (const char * bundleID);
+	virtual void				setDeviceInactive (bool inactive) {}
+
+	virtual IOReturn			addTimerEvent (OSObject * target, TimerEvent event, AbsoluteTime interval);
+	virtual void				removeTimerEvent (OSObject * target);
+	virtual void				removeAllTimerEvents ();
+	virtual IOWorkLoop *		getWorkLoop () const;
+	virtual IOCommandGate *		getCommandGate () const { return commandGate; }
+
+	// Harnesses fire the device timer by hand, every getTimerInterval () of their clock.
+	void						fireTimerEvents ();
+	AbsoluteTime				getTimerInterval () const { return mTimerInterval; }
+
+	OSArray *					audioEngines;
+	IOWorkLoop *				workLoop;
+	IOCommandGate *				commandGate;
+	IOAudioDevicePowerState		mPowerState;
+	bool						duringStartup;
+	OSObject *					mTimerTarget;
+	TimerEvent					mTimerEvent;
+	AbsoluteTime				mTimerInterval;
+};
+
+#endif /* _KERNSHIMAUDIO_H */
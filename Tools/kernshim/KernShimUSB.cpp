@@ -0,0 +1,239 @@
+/*
+ * Copyright (c) 1998-2010 Apple Computer, Inc. All rights reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this
+ * file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+//--------------------------------------------------------------------------------
+//
+//	File:		KernShimUSB.cpp
+//
+//	Contains:	Default behaviour of the IOUSBFamily classes in the host shim.
+//
+//	Technology:	OS X
+//
+//--------------------------------------------------------------------------------
+
+#include "KernShimUSB.h"
+
+#pragma mark -Bus-
+
+OSDefineMetaClassAndStructors (IOUSBController, IOService)
+OSDefineMetaClassAndStructors (IOUSBControllerV2, IOUSBController)
+
+UInt64 IOUSBController::GetFrameNumber () {
+	UInt64							now;
+
+	clock_get_uptime (&now);
+	return now / NSEC_PER_MSEC;
+}
+
+IOReturn IOUSBControllerV2::GetLowLatencyOptionsAndPhysicalMask (IOOptionBits * optionBits, mach_vm_address_t * physicalMask) {
+	*optionBits = 0;
+	*physicalMask = 0xFFFFFFFFULL;
+	return kIOReturnSuccess;
+}
+
+#pragma mark -Pipes-
+
+OSDefineMetaClassAndStructors (IOUSBPipe, OSObject)
+
+// A pipe with nothing behind it accepts every transfer and never completes it.
+IOReturn IOUSBPipe::Read (IOMemoryDescriptor * buffer, UInt32 noDataTimeout, UInt32 completionTimeout, IOByteCount reqCount, IOUSBCompletion * completion, IOByteCount * bytesRead) {
+	return kIOReturnSuccess;
+}
+
+IOReturn IOUSBPipe::Read (IOMemoryDescriptor * buffer, UInt64 frameStart, UInt32 numFrames, IOUSBIsocFrame * pFrames, IOUSBIsocCompletion * completion) {
+	return kIOReturnSuccess;
+}
+
+IOReturn IOUSBPipe::Read (IOMemoryDescriptor * buffer, UInt64 frameStart, UInt32 numFrames, IOUSBLowLatencyIsocFrame * pFrames, IOUSBLowLatencyIsocCompletion * completion, UInt32 updateFrequency) {
+	return kIOReturnSuccess;
+}
+
+IOReturn IOUSBPipe::Write (IOMemoryDescriptor * buffer, UInt32 noDataTimeout, UInt32 completionTimeout, IOByteCount reqCount, IOUSBCompletion * completion) {
+	return kIOReturnSuccess;
+}
+
+IOReturn IOUSBPipe::Write (IOMemoryDescriptor * buffer, UInt64 frameStart, UInt32 numFrames, IOUSBIsocFrame * pFrames, IOUSBIsocCompletion * completion) {
+	return kIOReturnSuccess;
+}
+
+IOReturn IOUSBPipe::Write (IOMemoryDescriptor * buffer, UInt64 frameStart, UInt32 numFrames, IOUSBLowLatencyIsocFrame * pFrames, IOUSBLowLatencyIsocCompletion * completion, UInt32 updateFrequency) {
+	return kIOReturnSuccess;
+}
+
+IOReturn IOUSBPipe::Abort () {
+	return kIOReturnSuccess;
+}
+
+IOReturn IOUSBPipe::SetPipePolicy (UInt16 maxPacketSize, UInt8 maxInterval) {
+	mEndpoint.wMaxPacketSize = maxPacketSize;
+	return kIOReturnSuccess;
+}
+
+#pragma mark -Nubs-
+
+OSDefineMetaClassAndStructors (IOUSBNub, IOService)
+OSDefineMetaClassAndStructors (IOUSBDevice, IOUSBNub)
+OSDefineMetaClassAndStructors (IOUSBRootHubDevice, IOUSBDevice)
+OSDefineMetaClassAndStructors (IOUSBInterface, IOUSBNub)
+
+IOReturn IOUSBDevice::GetConfiguration (UInt8 * configNumber) {
+	*configNumber = (NULL != mConfigurationDescriptor) ? mConfigurationDescriptor->bConfigurationValue : 0;
+	return kIOReturnSuccess;
+}
+
+const IOUSBConfigurationDescriptor * IOUSBDevice::GetFullConfigurationDescriptor (UInt8 configIndex) {
+	return (0 == configIndex) ? mConfigurationDescriptor : NULL;
+}
+
+IOReturn IOUSBDevice::GetStringDescriptor (UInt8 index, char * buf, int maxLen, UInt16 lang) {
+	if (0 == index || maxLen <= 0)
+	{
+		return kIOReturnBadArgument;
+	}
+	snprintf (buf, maxLen, "String %u", index);
+	return kIOReturnSuccess;
+}
+
+IOReturn IOUSBDevice::ResetDevice () {
+	mResetCount++;
+	return kIOReturnSuccess;
+}
+
+// Requests succeed; reads return zeros.
+IOReturn IOUSBDevice::DeviceRequest (IOUSBDevRequest * request, IOUSBCompletion * completion) {
+	if ((request->bmRequestType & 0x80) && NULL != request->pData)
+	{
+		memset (request->pData, 0, request->wLength);
+	}
+	request->wLenDone = request->wLength;
+	if (NULL != completion && NULL != completion->action)
+	{
+		completion->action (completion->target, completion->parameter, kIOReturnSuccess, 0);
+	}
+	return kIOReturnSuccess;
+}
+
+IOReturn IOUSBDevice::DeviceRequest (IOUSBDevRequestDesc * request, IOUSBCompletion * completion) {
+	UInt8							zeros[256];
+
+	if ((request->bmRequestType & 0x80) && NULL != request->pData)
+	{
+		memset (zeros, 0, sizeof (zeros));
+		for (IOByteCount offset = 0; offset < request->wLength; offset += sizeof (zeros))
+		{
+			request->pData->writeBytes (offset, zeros, (request->wLength - offset < sizeof (zeros)) ? request->wLength - offset : sizeof (zeros));
+		}
+	}
+	request->wLenDone = request->wLength;
+	if (NULL != completion && NULL != completion->action)
+	{
+		completion->action (completion->target, completion->parameter, kIOReturnSuccess, 0);
+	}
+	return kIOReturnSuccess;
+}
+
+OSIterator * IOUSBDevice::getChildIterator (const IORegistryPlane * plane) const {
+	return (NULL != mInterfaces) ? OSCollectionIterator::withCollection (mInterfaces) : IOUSBNub::getChildIterator (plane);
+}
+
+void IOUSBDevice::addInterface (IOUSBInterface * interface) {
+	if (NULL == mInterfaces)
+	{
+		mInterfaces = OSArray::withCapacity (2);
+	}
+	mInterfaces->setObject (interface);
+	interface->mDevice = this;
+}
+
+IOReturn IOUSBInterface::SetAlternateInterface (IOService * forClient, UInt16 alternateSetting) {
+	mAlternateSetting = (UInt8) alternateSetting;
+	return kIOReturnSuccess;
+}
+
+IOUSBPipe * IOUSBInterface::FindNextPipe (IOUSBPipe * current, IOUSBFindEndpointRequest * request) {
+	IOUSBPipe *						pipe;
+	unsigned int					index = 0;
+
+	if (NULL == mPipes)
+	{
+		return NULL;
+	}
+	if (NULL != current)
+	{
+		index = mPipes->getNextIndexOfObject (current, 0);
+		if ((unsigned int) -1 == index)
+		{
+			return NULL;
+		}
+		index++;
+	}
+	for (; index < mPipes->getCount (); index++)
+	{
+		pipe = (IOUSBPipe *) mPipes->getObject (index);
+		if ((NULL == request || (request->type == pipe->GetType () && (kUSBAnyDirn == request->direction || request->direction == pipe->GetDirection ()))))
+		{
+			if (NULL != request)
+			{
+				request->maxPacketSize = pipe->GetMaxPacketSize ();
+				request->interval = pipe->GetInterval ();
+			}
+			return pipe;
+		}
+	}
+	return NULL;
+}
+
+IOReturn IOUSBInterface::DeviceRequest (IOUSBDevRequest * request, IOUSBCompletion * completion) {
+	return (NULL != mDevice) ? mDevice->DeviceRequest (request, completion) : kIOReturnNoDevice;
+}
+
+IOReturn IOUSBInterface::DeviceRequest (IOUSBDevRequestDesc * request, IOUSBCompletion * completion) {
+	return (NULL != mDevice) ? mDevice->DeviceRequest (request, completion) : kIOReturnNoDevice;
+}
+
+bool IOUSBInterface::open (IOService * forClient, IOOptionBits options, void * arg) {
+	mOpenCount++;
+	return true;
+}
+
+void IOUSBInterface::close (IOService * forClient, IOOptionBits options) {
+	if (0 != mOpenCount)
+	{
+		mOpenCount--;
+	}
+}
+
+void IOUSBInterface::addPipe (IOUSBPipe * pipe) {
+	if (NULL == mPipes)
+	{
+		mPipes = OSArray::withCapacity (2);
+	}
+	mPipes->setObject (pipe);
+}
+
+void IOUSBInterface::removePipes () {
+	if (NULL != mPipes)
+	{
+		mPipes->flushCollection ();
+	}
+}
@@ -0,0 +1,402 @@
+/*
+ * Copyright (c) 1998-2010 Apple Computer, Inc. All rights reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this
+ * file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+//--------------------------------------------------------------------------------
+//
+//	File:		KernShimUSB.h
+//
+//	Contains:	The IOUSBFamily part of the host shim. Devices, interfaces and pipes
+//				answer from fields a harness fills in; every transfer entry point is
+//				virtual so that a harness can subclass IOUSBPipe or IOUSBController and
+//				complete transfers itself.
+//
+//	Technology:	OS X
+//
+//--------------------------------------------------------------------------------
+
+#ifndef _KERNSHIMUSB_H
+#define _KERNSHIMUSB_H
+
+#include "KernShim.h"
+
+#pragma mark -Descriptors and requests-
+
+enum {
+	kUSBOut						= 0,
+	kUSBIn						= 1,
+	kUSBNone					= 2,
+	kUSBAnyDirn					= 3
+};
+
+enum {
+	kUSBStandard				= 0,
+	kUSBClass					= 1,
+	kUSBVendor					= 2
+};
+
+enum {
+	kUSBDevice					= 0,
+	kUSBInterface				= 1,
+	kUSBEndpoint				= 2,
+	kUSBOther					= 3
+};
+
+enum {
+	kUSBControl					= 0,
+	kUSBIsoc					= 1,
+	kUSBBulk					= 2,
+	kUSBInterrupt				= 3,
+	kUSBAnyType					= 0xFF
+};
+
+enum {
+	kUSBRqGetStatus				= 0,
+	kUSBRqClearFeature			= 1,
+	kUSBRqSetFeature			= 3,
+	kUSBRqSetAddress			= 5,
+	kUSBRqGetDescriptor			= 6,
+	kUSBRqSetDescriptor			= 7,
+	kUSBRqGetConfig				= 8,
+	kUSBRqSetConfig				= 9,
+	kUSBRqGetInterface			= 10,
+	kUSBRqSetInterface			= 11,
+	kUSBRqSyncFrame				= 12
+};
+
+enum {
+	kUSBDeviceDesc				= 1,
+	kUSBConfDesc				= 2,
+	kUSBStringDesc				= 3,
+	kUSBInterfaceDesc			= 4,
+	kUSBEndpointDesc			= 5,
+	kUSBInterfaceAssociationDesc	= 0x0B
+};
+
+enum {
+	kUSBAudioClass				= 1,
+	kUSBAudioControlSubClass	= 1,
+	kUSBAudioStreamingSubClass	= 2,
+	kUSBMIDIStreamingSubClass	= 3
+};
+
+enum {
+	kUSBDeviceSpeedLow			= 0,
+	kUSBDeviceSpeedFull			= 1,
+	kUSBDeviceSpeedHigh			= 2
+};
+
+#define USBmakebmRequestType(direction, type, recipient)	\
+	((((direction) & 1) << 7) | (((type) & 3) << 5) | ((recipient) & 0x1F))
+
+#define sub_iokit_usb_msg				0x1C000
+#define iokit_usb_msg(message)			((UInt32)(sys_iokit | sub_iokit_usb | (message)))
+
+#define kIOUSBUnknownPipeErr			iokit_usb_err(0x61)
+#define kIOUSBTooManyPipesErr			iokit_usb_err(0x60)
+#define kIOUSBNoAsyncPortErr			iokit_usb_err(0x5f)
+#define kIOUSBNotEnoughPipesErr			iokit_usb_err(0x5e)
+#define kIOUSBNotEnoughPowerErr			iokit_usb_err(0x5d)
+#define kIOUSBEndpointNotFound			iokit_usb_err(0x57)
+#define kIOUSBConfigNotFound			iokit_usb_err(0x56)
+#define kIOUSBTransactionTimeout		iokit_usb_err(0x51)
+#define kIOUSBTransactionReturned		iokit_usb_err(0x50)
+#define kIOUSBPipeStalled				iokit_usb_err(0x4f)
+#define kIOUSBInterfaceNotFound			iokit_usb_err(0x4e)
+#define kIOUSBLowLatencyBufferNotPreviouslyAllocated	iokit_usb_err(0x4d)
+#define kIOUSBLowLatencyFrameListNotPreviouslyAllocated	iokit_usb_err(0x4c)
+#define kIOUSBHighSpeedSplitError		iokit_usb_err(0x4b)
+#define kIOUSBSyncRequestOnWLThread		iokit_usb_err(0x4a)
+#define kIOUSBDeviceNotHighSpeed		iokit_usb_err(0x49)
+#define kIOUSBLinkErr					iokit_usb_err(0x10)
+#define kIOUSBNotSent2Err				iokit_usb_err(0x0f)
+#define kIOUSBNotSent1Err				iokit_usb_err(0x0e)
+#define kIOUSBBufferUnderrunErr			iokit_usb_err(0x0d)
+#define kIOUSBBufferOverrunErr			iokit_usb_err(0x0c)
+#define kIOUSBReserved2Err				iokit_usb_err(0x0b)
+#define kIOUSBReserved1Err				iokit_usb_err(0x0a)
+#define kIOUSBWrongPIDErr				iokit_usb_err(0x07)
+#define kIOUSBPIDCheckErr				iokit_usb_err(0x06)
+#define kIOUSBDataToggleErr				iokit_usb_err(0x03)
+#define kIOUSBBitstufErr				iokit_usb_err(0x02)
+#define kIOUSBCRCErr					iokit_usb_err(0x01)
+
+#define kIOUSBMessageHubResetPort			iokit_usb_msg(0x01)
+#define kIOUSBMessageHubSuspendPort			iokit_usb_msg(0x02)
+#define kIOUSBMessageHubResumePort			iokit_usb_msg(0x03)
+#define kIOUSBMessageHubIsDeviceConnected	iokit_usb_msg(0x04)
+#define kIOUSBMessageHubIsPortEnabled		iokit_usb_msg(0x05)
+#define kIOUSBMessageHubReEnumeratePort		iokit_usb_msg(0x06)
+#define kIOUSBMessagePortHasBeenReset		iokit_usb_msg(0x0a)
+#define kIOUSBMessagePortHasBeenResumed		iokit_usb_msg(0x0b)
+#define kIOUSBMessagePortHasBeenSuspended	iokit_usb_msg(0x0d)
+
+#define kIOUSBVendorIDAppleComputer		0x05AC
+#define kUSBVendorID					"idVendor"
+#define kUSBProductID					"idProduct"
+#define kUSBDevicePropertyLocationID	"locationID"
+#define kUSBDevicePropertySpeed			"Device Speed"
+#define kIOUSBPlane						"IOUSB"
+
+#define kUSBDefaultControlNoDataTimeoutMS			5000
+#define kUSBDefaultControlCompletionTimeoutMS		0
+
+typedef struct IOUSBDescriptorHeader {
+	UInt8						bLength;
+	UInt8						bDescriptorType;
+} __attribute__ ((packed)) IOUSBDescriptorHeader;
+
+typedef struct IOUSBConfigurationDescriptor {
+	UInt8						bLength;
+	UInt8						bDescriptorType;
+	UInt16						wTotalLength;
+	UInt8						bNumInterfaces;
+	UInt8						bConfigurationValue;
+	UInt8						iConfiguration;
+	UInt8						bmAttributes;
+	UInt8						MaxPower;
+} __attribute__ ((packed)) IOUSBConfigurationDescriptor;
+
+typedef IOUSBConfigurationDescriptor *	IOUSBConfigurationDescriptorPtr;
+
+typedef struct IOUSBInterfaceDescriptor {
+	UInt8						bLength;
+	UInt8						bDescriptorType;
+	UInt8						bInterfaceNumber;
+	UInt8						bAlternateSetting;
+	UInt8						bNumEndpoints;
+	UInt8						bInterfaceClass;
+	UInt8						bInterfaceSubClass;
+	UInt8						bInterfaceProtocol;
+	UInt8						iInterface;
+} __attribute__ ((packed)) IOUSBInterfaceDescriptor;
+
+typedef struct IOUSBEndpointDescriptor {
+	UInt8						bLength;
+	UInt8						bDescriptorType;
+	UInt8						bEndpointAddress;
+	UInt8						bmAttributes;
+	UInt16						wMaxPacketSize;
+	UInt8						bInterval;
+} __attribute__ ((packed)) IOUSBEndpointDescriptor;
+
+typedef struct {
+	UInt8						bmRequestType;
+	UInt8						bRequest;
+	UInt16						wValue;
+	UInt16						wIndex;
+	UInt16						wLength;
+	void *						pData;
+	UInt32						wLenDone;
+} IOUSBDevRequest;
+
+typedef struct {
+	UInt8						bmRequestType;
+	UInt8						bRequest;
+	UInt16						wValue;
+	UInt16						wIndex;
+	UInt16						wLength;
+	IOMemoryDescriptor *		pData;
+	UInt32						wLenDone;
+} IOUSBDevRequestDesc;
+
+typedef struct {
+	UInt8						type;
+	UInt8						direction;
+	UInt16						maxPacketSize;
+	UInt8						interval;
+} IOUSBFindEndpointRequest;
+
+typedef struct {
+	UInt16						bInterfaceClass;
+	UInt16						bInterfaceSubClass;
+	UInt16						bInterfaceProtocol;
+	UInt16						bAlternateSetting;
+} IOUSBFindInterfaceRequest;
+
+typedef struct {
+	IOReturn					frStatus;
+	UInt16						frReqCount;
+	UInt16						frActCount;
+} IOUSBIsocFrame;
+
+typedef struct {
+	IOReturn					frStatus;
+	UInt16						frReqCount;
+	UInt16						frActCount;
+	AbsoluteTime				frTimeStamp;
+} IOUSBLowLatencyIsocFrame;
+
+// frStatus of a low latency frame that the controller hasn't processed yet.
+#define kUSBLowLatencyIsochTransferKey	'llit'
+
+typedef void	(*IOUSBCompletionAction) (void * target, void * parameter, IOReturn status, UInt32 bufferSizeRemaining);
+typedef void	(*IOUSBIsocCompletionAction) (void * target, void * parameter, IOReturn status, IOUSBIsocFrame * pFrames);
+typedef void	(*IOUSBLowLatencyIsocCompletionAction) (void * target, void * parameter, IOReturn status, IOUSBLowLatencyIsocFrame * pFrames);
+
+typedef struct {
+	void *						target;
+	IOUSBCompletionAction		action;
+	void *						parameter;
+} IOUSBCompletion;
+
+typedef struct {
+	void *						target;
+	IOUSBIsocCompletionAction	action;
+	void *						parameter;
+} IOUSBIsocCompletion;
+
+typedef struct {
+	void *						target;
+	IOUSBLowLatencyIsocCompletionAction	action;
+	void *						parameter;
+} IOUSBLowLatencyIsocCompletion;
+
+#pragma mark -Bus-
+
+class IOUSBController : public IOService {
+	OSDeclareDefaultStructors (IOUSBController)
+
+public:
+	// Frames advance with clock_get_uptime () by default: one per millisecond since the shim started.
+	virtual UInt64				GetFrameNumber ();
+};
+
+class IOUSBControllerV2 : public IOUSBController {
+	OSDeclareDefaultStructors (IOUSBControllerV2)
+
+public:
+	virtual IOReturn			GetLowLatencyOptionsAndPhysicalMask (IOOptionBits * optionBits, mach_vm_address_t * physicalMask);
+};
+
+typedef IOUSBController			IOUSBBus;
+
+#pragma mark -Pipes-
+
+class IOUSBPipe : public OSObject {
+	OSDeclareDefaultStructors (IOUSBPipe)
+
+public:
+	virtual IOReturn			Read (IOMemoryDescriptor * buffer, UInt32 noDataTimeout, UInt32 completionTimeout, IOByteCount reqCount, IOUSBCompletion * completion = 0, IOByteCount * bytesRead = 0);
+	virtual IOReturn			Read (IOMemoryDescriptor * buffer, UInt64 frameStart, UInt32 numFrames, IOUSBIsocFrame * pFrames, IOUSBIsocCompletion * completion = 0);
+	virtual IOReturn			Read (IOMemoryDescriptor * buffer, UInt64 frameStart, UInt32 numFrames, IOUSBLowLatencyIsocFrame * pFrames, IOUSBLowLatencyIsocCompletion * completion = 0, UInt32 updateFrequency = 0);
+	virtual IOReturn			Write (IOMemoryDescriptor * buffer, UInt32 noDataTimeout, UInt32 completionTimeout, IOByteCount reqCount, IOUSBCompletion * completion = 0);
+	virtual IOReturn			Write (IOMemoryDescriptor * buffer, UInt64 frameStart, UInt32 numFrames, IOUSBIsocFrame * pFrames, IOUSBIsocCompletion * completion = 0);
+	virtual IOReturn			Write (IOMemoryDescriptor * buffer, UInt64 frameStart, UInt32 numFrames, IOUSBLowLatencyIsocFrame * pFrames, IOUSBLowLatencyIsocCompletion * completion = 0, UInt32 updateFrequency = 0);
+	virtual IOReturn			Abort ();
+	virtual IOReturn			Reset () { return kIOReturnSuccess; }
+	virtual IOReturn			ClearStall () { return kIOReturnSuccess; }
+	virtual IOReturn			ClearPipeStall (bool withDeviceRequest) { return kIOReturnSuccess; }
+	virtual IOReturn			SetPipePolicy (UInt16 maxPacketSize, UInt8 maxInterval);
+	virtual const IOUSBEndpointDescriptor *	GetEndpointDescriptor () { return &mEndpoint; }
+	virtual UInt8				GetDirection () { return (mEndpoint.bEndpointAddress & 0x80) ? kUSBIn : kUSBOut; }
+	virtual UInt8				GetType () { return mEndpoint.bmAttributes & 0x03; }
+	virtual UInt8				GetEndpointNumber () { return mEndpoint.bEndpointAddress & 0x0F; }
+	virtual UInt16				GetMaxPacketSize () { return mEndpoint.wMaxPacketSize; }
+	virtual UInt8				GetInterval () { return mEndpoint.bInterval; }
+
+	IOUSBEndpointDescriptor		mEndpoint;
+};
+
+#pragma mark -Nubs-
+
+class IOUSBInterface;
+
+class IOUSBNub : public IOService {
+	OSDeclareDefaultStructors (IOUSBNub)
+};
+
+class IOUSBDevice : public IOUSBNub {
+	OSDeclareDefaultStructors (IOUSBDevice)
+
+public:
+	virtual IOUSBController *	GetBus () { return mBus; }
+	virtual UInt16				GetVendorID () { return mVendorID; }
+	virtual UInt16				GetProductID () { return mProductID; }
+	virtual UInt16				GetDeviceRelease () { return mDeviceRelease; }
+	virtual UInt8				GetSpeed () { return mSpeed; }
+	virtual UInt8				GetNumConfigurations () { return (NULL != mConfigurationDescriptor) ? 1 : 0; }
+	virtual UInt8				GetManufacturerStringIndex () { return 0; }
+	virtual UInt8				GetProductStringIndex () { return 0; }
+	virtual UInt8				GetSerialNumberStringIndex () { return 0; }
+	virtual IOReturn			GetConfiguration (UInt8 * configNumber);
+	virtual const IOUSBConfigurationDescriptor *	GetFullConfigurationDescriptor (UInt8 configIndex);
+	virtual IOReturn			GetStringDescriptor (UInt8 index, char * buf, int maxLen, UInt16 lang = 0x409);
+	virtual IOReturn			ResetDevice ();
+	virtual IOReturn			DeviceRequest (IOUSBDevRequest * request, IOUSBCompletion * completion = 0);
+	virtual IOReturn			DeviceRequest (IOUSBDevRequestDesc * request, IOUSBCompletion * completion = 0);
+	virtual IOReturn			DeviceRequest (IOUSBDevRequest * request, UInt32 noDataTimeout, UInt32 completionTimeout, IOUSBCompletion * completion = 0) { return DeviceRequest (request, completion); }
+	virtual IOReturn			DeviceRequest (IOUSBDevRequestDesc * request, UInt32 noDataTimeout, UInt32 completionTimeout, IOUSBCompletion * completion = 0) { return DeviceRequest (request, completion); }
+
+	// The interfaces are the device's children in the service plane.
+	virtual OSIterator *		getChildIterator (const IORegistryPlane * plane) const;
+	// A harness adds the interfaces of the current configuration.
+	void						addInterface (IOUSBInterface * interface);
+
+	IOUSBController *			mBus;
+	const IOUSBConfigurationDescriptor *	mConfigurationDescriptor;
+	UInt16						mVendorID;
+	UInt16						mProductID;
+	UInt16						mDeviceRelease;
+	UInt8						mSpeed;
+	UInt32						mResetCount;
+	OSArray *					mInterfaces;
+};
+
+class IOUSBRootHubDevice : public IOUSBDevice {
+	OSDeclareDefaultStructors (IOUSBRootHubDevice)
+};
+
+class IOUSBInterface : public IOUSBNub {
+	OSDeclareDefaultStructors (IOUSBInterface)
+
+public:
+	virtual IOUSBDevice *		GetDevice () { return mDevice; }
+	virtual UInt8				GetInterfaceNumber () { return mInterfaceNumber; }
+	virtual UInt8				GetAlternateSetting () { return mAlternateSetting; }
+	virtual UInt8				GetInterfaceClass () { return kUSBAudioClass; }
+	virtual UInt8				GetInterfaceSubClass () { return mInterfaceSubClass; }
+	virtual UInt8				GetInterfaceProtocol () { return mInterfaceProtocol; }
+	virtual UInt8				GetInterfaceStringIndex () { return 0; }
+	virtual UInt8				GetConfigValue () { return 1; }
+	virtual IOReturn			SetAlternateInterface (IOService * forClient, UInt16 alternateSetting);
+	virtual IOUSBPipe *			FindNextPipe (IOUSBPipe * current, IOUSBFindEndpointRequest * request);
+	virtual IOUSBPipe *			FindNextPipe (IOUSBPipe * current, IOUSBFindEndpointRequest * request, bool withRetain) { return FindNextPipe (current, request); }
+	virtual IOReturn			DeviceRequest (IOUSBDevRequest * request, IOUSBCompletion * completion = 0);
+	virtual IOReturn			DeviceRequest (IOUSBDevRequestDesc * request, IOUSBCompletion * completion = 0);
+	virtual bool				open (IOService * forClient, IOOptionBits options = 0, void * arg = 0);
+	virtual void				close (IOService * forClient, IOOptionBits options = 0);
+	virtual bool				isOpen (const IOService * forClient = 0) const { return 0 != mOpenCount; }
+
+	// A harness adds the pipes the interface's current alternate setting exposes.
+	void						addPipe (IOUSBPipe * pipe);
+	void						removePipes ();
+
+	IOUSBDevice *				mDevice;
+	UInt8						mInterfaceNumber;
+	UInt8						mAlternateSetting;
+	UInt8						mInterfaceSubClass;
+	UInt8						mInterfaceProtocol;
+	OSArray *					mPipes;
+};
+
+#endif /* _KERNSHIMUSB_H */
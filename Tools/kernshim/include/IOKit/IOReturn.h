@@ -0,0 +1 @@
+#include "KernShim.h"
@@ -0,0 +1 @@
+#include "KernShimAudio.h"
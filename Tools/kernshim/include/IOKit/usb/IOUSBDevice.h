@@ -0,0 +1 @@
+#include "KernShimUSB.h"
@@ -0,0 +1,523 @@
+/*
+ * Copyright (c) 1998-2010 Apple Computer, Inc. All rights reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this
+ * file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+//--------------------------------------------------------------------------------
+//
+//	File:		unitbench.cpp
+//
+//	Contains:	Startup benchmark for the audio control interface on configurations far
+//				bigger than real devices have. The driver sources are built unchanged
+//				against the shim in kernshim/.
+//
+//				A USB Audio 1.0 configuration is generated with an input terminal, a chain
+//				of alternating feature and selector units and an output terminal, up to the
+//				255 unit IDs there are. Each size is parsed, which builds the control
+//				interface's unit table, and then every unit is looked up the way attach does:
+//				by subtype, source, and through the feature and selector getters. Every
+//				lookup has to find the unit it was generated as.
+//
+//				-g times the unit graph instead: buildUnitGraph (), enumerateUnitGraphPaths ()
+//				and createPathArrayFromUnitGraph () one at a time, then BuildConnectionGraph ()
+//				as a whole. The graphs are the 255 unit chain and layered selectors, where
+//				every unit of a layer selects between every unit of the layer before, so the
+//				paths multiply with each layer. -w and -l pick one layered graph. Each has to
+//				come out with the number and length of paths it was generated with.
+//
+//	Technology:	OS X
+//
+//	Build:		c++ -std=gnu++11 -fpermissive -w -O2 -I Tools/kernshim/include -I Tools/kernshim -I . -o unitbench \
+//					Tools/unitbench.cpp Tools/kernshim/*.cpp AppleUSBAudio*.cpp BigNum.cpp -lpthread
+//
+//	Usage:		unitbench [-n units] [-g [-w width -l layers]] [-t ms]
+//
+//				Without -n, 16, 64 and 255 units are run; without -w, 255 deep, 16 wide by 1,
+//				8 wide by 2 and 4 wide by 6 layers. Exits non-zero if any check fails.
+//
+//--------------------------------------------------------------------------------
+
+#include <time.h>
+#include <unistd.h>
+
+#include <vector>
+
+#include "AppleUSBAudioDevice.h"
+#include "AppleUSBAudioDictionary.h"
+
+#pragma mark -Options-
+
+typedef struct {
+	UInt32						numUnits;
+	bool						graph;
+	UInt32						width;
+	UInt32						layers;
+	UInt32						benchmarkMS;
+} BenchOptions;
+
+static BenchOptions				sOptions = { 0, false, 0, 0, 500 };
+static UInt32					sFailures = 0;
+
+typedef std::vector<UInt8>		BenchInput;
+
+static void benchCheck (bool passed, const char * format, ...) {
+	va_list							arguments;
+
+	printf ("%s ", passed ? "  ok  " : "  FAIL");
+	va_start (arguments, format);
+	vprintf (format, arguments);
+	va_end (arguments);
+	printf ("\n");
+	if (!passed)
+	{
+		sFailures++;
+	}
+}
+
+static UInt64 benchNanoseconds (void) {
+	struct timespec					now;
+
+	clock_gettime (CLOCK_MONOTONIC, &now);
+	return (UInt64) now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+#pragma mark -Configuration-
+
+// Chain unit IDs run from 1: the USB streaming input terminal that interface 1 plays into, then feature units at even and selector
+// units at odd IDs, then the output terminal.
+static UInt8 benchUnitSubType (UInt32 unitID, UInt32 numUnits) {
+	if (1 == unitID)
+	{
+		return INPUT_TERMINAL;
+	}
+	if (numUnits == unitID)
+	{
+		return OUTPUT_TERMINAL;
+	}
+	return (0 == (unitID & 1)) ? FEATURE_UNIT : SELECTOR_UNIT;
+}
+
+static void benchAppend (BenchInput & input, const UInt8 * bytes, size_t length) {
+	input.insert (input.end (), bytes, bytes + length);
+}
+
+static void benchAppendInputTerminal (BenchInput & units, UInt8 unitID) {
+	const UInt8						unit[] = { 0x0C, 0x24, INPUT_TERMINAL, unitID, 0x01, 0x01, 0x00, 0x02, 0x03, 0x00, 0x00, 0x00 };
+
+	benchAppend (units, unit, sizeof (unit));
+}
+
+static void benchAppendOutputTerminal (BenchInput & units, UInt8 unitID, UInt8 sourceID) {
+	const UInt8						unit[] = { 0x09, 0x24, OUTPUT_TERMINAL, unitID, 0x01, 0x03, 0x00, sourceID, 0x00 };
+
+	benchAppend (units, unit, sizeof (unit));
+}
+
+static void benchAppendSelector (BenchInput & units, UInt8 unitID, UInt8 firstSourceID, UInt8 numSources) {
+	units.push_back ((UInt8) (6 + numSources));
+	units.push_back (0x24);
+	units.push_back (SELECTOR_UNIT);
+	units.push_back (unitID);
+	units.push_back (numSources);
+	for (UInt8 sourceIndex = 0; sourceIndex < numSources; sourceIndex++)
+	{
+		units.push_back ((UInt8) (firstSourceID + sourceIndex));
+	}
+	units.push_back (0x00);
+}
+
+// Wraps the units in an audio control interface and adds the streaming interface that plays into unit 1.
+static BenchInput benchConfiguration (const BenchInput & units) {
+	BenchInput						input;
+	size_t							headerOffset;
+	UInt16							controlLength;
+	static const UInt8				configuration[] = { 0x09, 0x02, 0x00, 0x00, 0x02, 0x01, 0x00, 0x80, 0x32 };
+	static const UInt8				controlInterface[] = { 0x09, 0x04, 0x00, 0x00, 0x00, 0x01, 0x01, 0x00, 0x00 };
+	static const UInt8				header[] = { 0x09, 0x24, 0x01, 0x00, 0x01, 0x00, 0x00, 0x01, 0x01 };
+	static const UInt8				streamInterface[] = {
+		0x09, 0x04, 0x01, 0x00, 0x00, 0x01, 0x02, 0x00, 0x00,
+		0x09, 0x04, 0x01, 0x01, 0x01, 0x01, 0x02, 0x00, 0x00,
+		0x07, 0x24, 0x01, 0x01, 0x01, 0x01, 0x00,
+		0x0B, 0x24, 0x02, 0x01, 0x02, 0x02, 0x10, 0x01, 0x80, 0xBB, 0x00,
+		0x09, 0x05, 0x01, 0x09, 0xC8, 0x00, 0x01, 0x00, 0x00,
+		0x07, 0x25, 0x01, 0x01, 0x00, 0x00, 0x00,
+	};
+
+	benchAppend (input, configuration, sizeof (configuration));
+	benchAppend (input, controlInterface, sizeof (controlInterface));
+	headerOffset = input.size ();
+	benchAppend (input, header, sizeof (header));
+	benchAppend (input, &units[0], units.size ());
+	controlLength = (UInt16) (input.size () - headerOffset);
+	input[headerOffset + 5] = controlLength & 0xFF;
+	input[headerOffset + 6] = (controlLength >> 8) & 0xFF;
+	benchAppend (input, streamInterface, sizeof (streamInterface));
+	input[2] = input.size () & 0xFF;
+	input[3] = (input.size () >> 8) & 0xFF;
+	return input;
+}
+
+static BenchInput benchChainConfiguration (UInt32 numUnits) {
+	BenchInput						units;
+
+	for (UInt32 unitID = 1; unitID <= numUnits; unitID++)
+	{
+		UInt8						sourceID = (UInt8) (unitID - 1);
+
+		switch (benchUnitSubType (unitID, numUnits))
+		{
+			case INPUT_TERMINAL:
+				benchAppendInputTerminal (units, (UInt8) unitID);
+				break;
+			case OUTPUT_TERMINAL:
+				benchAppendOutputTerminal (units, (UInt8) unitID, sourceID);
+				break;
+			case FEATURE_UNIT:
+			{
+				const UInt8			unit[] = { 0x0A, 0x24, FEATURE_UNIT, (UInt8) unitID, sourceID, 0x01, 0x01, 0x02, 0x02, 0x00 };
+				benchAppend (units, unit, sizeof (unit));
+				break;
+			}
+			default:
+				benchAppendSelector (units, (UInt8) unitID, sourceID, 1);
+				break;
+		}
+	}
+	return benchConfiguration (units);
+}
+
+// width input terminals, then layers of width selectors that each select between every unit of the layer before, then one selector
+// over the last layer and the output terminal. Every choice is a path, so there are width ^ (layers + 1) of them.
+static BenchInput benchLayeredConfiguration (UInt32 width, UInt32 layers, UInt8 * outputTerminalID) {
+	BenchInput						units;
+	UInt32							unitID = 1;
+
+	for (UInt32 terminalIndex = 0; terminalIndex < width; terminalIndex++)
+	{
+		benchAppendInputTerminal (units, (UInt8) unitID++);
+	}
+	for (UInt32 layer = 0; layer < layers; layer++)
+	{
+		for (UInt32 selectorIndex = 0; selectorIndex < width; selectorIndex++)
+		{
+			benchAppendSelector (units, (UInt8) unitID++, (UInt8) (1 + layer * width), (UInt8) width);
+		}
+	}
+	benchAppendSelector (units, (UInt8) unitID, (UInt8) (1 + layers * width), (UInt8) width);
+	*outputTerminalID = (UInt8) (unitID + 1);
+	benchAppendOutputTerminal (units, *outputTerminalID, (UInt8) unitID);
+	return benchConfiguration (units);
+}
+
+static AUAConfigurationDictionary * benchParse (const BenchInput & input) {
+	return AUAConfigurationDictionary::create ((const IOUSBConfigurationDescriptor *) &input[0], 0);
+}
+
+#pragma mark -Lookups-
+
+// Looks every unit up once through the getters attach uses. Returns the number of lookups that found what was generated.
+static UInt32 benchLookUpUnits (AUAConfigurationDictionary * configDictionary, UInt32 numUnits, UInt32 * numLookups) {
+	UInt32							numFound = 0;
+	UInt8							subType;
+	UInt8							sourceID;
+	UInt8							numSources;
+
+	*numLookups = 0;
+	for (UInt32 unitID = 1; unitID <= numUnits; unitID++)
+	{
+		subType = benchUnitSubType (unitID, numUnits);
+		if (kIOReturnSuccess == configDictionary->getSubType (&sourceID, 0, 0, unitID) && subType == sourceID)
+		{
+			numFound++;
+		}
+		(*numLookups)++;
+		switch (subType)
+		{
+			case FEATURE_UNIT:
+				if (kIOReturnSuccess == configDictionary->getSourceID (&sourceID, 0, 0, unitID) && unitID - 1 == sourceID)
+				{
+					numFound++;
+				}
+				numFound += configDictionary->channelHasVolumeControl (0, 0, unitID, 1) ? 1 : 0;
+				numFound += configDictionary->channelHasMuteControl (0, 0, unitID, 0) ? 1 : 0;
+				(*numLookups) += 3;
+				break;
+			case SELECTOR_UNIT:
+				if (kIOReturnSuccess == configDictionary->getNumSources (&numSources, 0, 0, unitID) && 1 == numSources)
+				{
+					numFound++;
+				}
+				(*numLookups)++;
+				break;
+			case OUTPUT_TERMINAL:
+				if (kIOReturnSuccess == configDictionary->getSourceID (&sourceID, 0, 0, unitID) && unitID - 1 == sourceID)
+				{
+					numFound++;
+				}
+				(*numLookups)++;
+				break;
+		}
+	}
+	return numFound;
+}
+
+static void benchUnits (UInt32 numUnits) {
+	AUAConfigurationDictionary *	configDictionary;
+	BenchInput						input;
+	UInt64							startTime;
+	UInt64							elapsed;
+	UInt32							numParses;
+	UInt32							numPasses;
+	UInt32							numLookups = 0;
+	UInt32							numFound = 0;
+	UInt8							count;
+	bool							parsed;
+
+	input = benchChainConfiguration (numUnits);
+	configDictionary = benchParse (input);
+	benchCheck (NULL != configDictionary, "%u units parse", numUnits);
+	if (NULL == configDictionary)
+	{
+		return;
+	}
+	benchCheck (kIOReturnSuccess == configDictionary->getNumOutputTerminals (&count, 0, 0) && 1 == count, "%u units have an output terminal", numUnits);
+
+	// Parsing, which includes building the unit table, as attach does it once.
+	numParses = 0;
+	parsed = true;
+	startTime = benchNanoseconds ();
+	do
+	{
+		AUAConfigurationDictionary *	thisDictionary = benchParse (input);
+
+		parsed = (NULL != thisDictionary) && parsed;
+		if (NULL != thisDictionary)
+		{
+			thisDictionary->release ();
+		}
+		numParses++;
+		elapsed = benchNanoseconds () - startTime;
+	} while (elapsed < (UInt64) sOptions.benchmarkMS * 1000000ULL);
+	printf ("%3u units: %lu bytes, parse %.2f us\n", numUnits, (unsigned long) input.size (), elapsed / 1e3 / numParses);
+	benchCheck (parsed, "%u units parsed every time", numUnits);
+
+	// Looking every unit up, a pass at a time between clock reads.
+	numPasses = 0;
+	startTime = benchNanoseconds ();
+	do
+	{
+		numFound = benchLookUpUnits (configDictionary, numUnits, &numLookups);
+		numPasses++;
+		elapsed = benchNanoseconds () - startTime;
+	} while (elapsed < (UInt64) sOptions.benchmarkMS * 1000000ULL);
+	printf ("%3u units: %u lookups a pass, %.2f us a pass, %.1f ns a lookup\n", numUnits, numLookups, elapsed / 1e3 / numPasses,
+			(double) elapsed / numPasses / numLookups);
+	benchCheck (numLookups == numFound, "%u units: every lookup finds its unit (%u of %u)", numUnits, numFound, numLookups);
+
+	configDictionary->release ();
+}
+
+#pragma mark -Graph-
+
+// Lets the benchmark hand the device a configuration without attaching it to anything.
+class BenchDevice : public AppleUSBAudioDevice
+{
+public:
+	void	setConfigDictionary (AUAConfigurationDictionary * configDictionary) {mConfigDictionary = configDictionary;}
+};
+
+// Checks the paths from the output terminal: how many there are, and that each runs the whole depth of the graph.
+static bool benchCheckPaths (OSArray * paths, UInt32 expectedPaths, UInt32 pathLength) {
+	OSArray *						thisPath;
+
+	if (NULL == paths || expectedPaths != paths->getCount ())
+	{
+		return false;
+	}
+	for (UInt32 pathIndex = 0; pathIndex < paths->getCount (); pathIndex++)
+	{
+		if (NULL == (thisPath = OSDynamicCast (OSArray, paths->getObject (pathIndex))) || pathLength != thisPath->getCount ())
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+static void benchGraph (const char * name, const BenchInput & input, UInt8 outputTerminalID, UInt32 expectedPaths, UInt32 pathLength) {
+	AUAConfigurationDictionary *	configDictionary;
+	BenchDevice *					audioDevice;
+	AUAUnitGraph *					graph;
+	OSArray *						paths;
+	UInt64							phaseTime[4] = { 0, 0, 0, 0 };
+	UInt64							startTime;
+	UInt64							elapsed;
+	UInt32							numPasses;
+	bool							built = true;
+	bool							pathsMatch = true;
+
+	FailIf (NULL == (configDictionary = benchParse (input)), Exit);
+	audioDevice = new BenchDevice;
+	audioDevice->init (NULL);
+	audioDevice->setConfigDictionary (configDictionary);
+	graph = (AUAUnitGraph *) IOMalloc (sizeof (AUAUnitGraph));
+
+	// The phases BuildConnectionGraph () goes through for one output terminal, timed one at a time.
+	numPasses = 0;
+	startTime = benchNanoseconds ();
+	do
+	{
+		UInt64						phaseStart[5];
+
+		bzero (graph, sizeof (AUAUnitGraph));
+		phaseStart[0] = benchNanoseconds ();
+		built = (kIOReturnSuccess == audioDevice->buildUnitGraph (graph, 0)) && built;
+		phaseStart[1] = benchNanoseconds ();
+		built = (kIOReturnSuccess == audioDevice->enumerateUnitGraphPaths (graph, outputTerminalID)) && built;
+		phaseStart[2] = benchNanoseconds ();
+		paths = audioDevice->createPathArrayFromUnitGraph (graph);
+		phaseStart[3] = benchNanoseconds ();
+		if (0 == numPasses)
+		{
+			pathsMatch = benchCheckPaths (paths, expectedPaths, pathLength);
+		}
+		if (NULL != paths)
+		{
+			paths->release ();
+		}
+		audioDevice->freeUnitGraph (graph);
+		phaseStart[4] = benchNanoseconds ();
+		for (UInt32 phase = 0; phase < 4; phase++)
+		{
+			phaseTime[phase] += phaseStart[phase + 1] - phaseStart[phase];
+		}
+		numPasses++;
+		elapsed = benchNanoseconds () - startTime;
+	} while (elapsed < (UInt64) sOptions.benchmarkMS * 1000000ULL);
+	printf ("%s: %u paths of %u units: buildUnitGraph %.2f us, enumerateUnitGraphPaths %.2f us, createPathArrayFromUnitGraph %.2f us, free %.2f us\n",
+			name, expectedPaths, pathLength, phaseTime[0] / 1e3 / numPasses, phaseTime[1] / 1e3 / numPasses, phaseTime[2] / 1e3 / numPasses,
+			phaseTime[3] / 1e3 / numPasses);
+	benchCheck (built, "%s: unit graph built and enumerated", name);
+	benchCheck (pathsMatch, "%s: %u paths of %u units", name, expectedPaths, pathLength);
+
+	// And the whole of it, which is what attach pays.
+	numPasses = 0;
+	startTime = benchNanoseconds ();
+	do
+	{
+		paths = audioDevice->BuildConnectionGraph (0);
+		if (NULL != paths)
+		{
+			paths->release ();
+		}
+		numPasses++;
+		elapsed = benchNanoseconds () - startTime;
+	} while (elapsed < (UInt64) sOptions.benchmarkMS * 1000000ULL);
+	printf ("%s: BuildConnectionGraph %.2f us\n", name, elapsed / 1e3 / numPasses);
+
+	IOFree (graph, sizeof (AUAUnitGraph));
+	audioDevice->setConfigDictionary (NULL);
+	configDictionary->release ();
+	return;
+
+Exit:
+	benchCheck (false, "%s parses", name);
+}
+
+static void benchLayeredGraph (UInt32 width, UInt32 layers) {
+	char							name[32];
+	UInt32							expectedPaths = 1;
+	UInt8							outputTerminalID;
+	BenchInput						input;
+
+	for (UInt32 layer = 0; layer <= layers; layer++)
+	{
+		expectedPaths *= width;
+	}
+	snprintf (name, sizeof (name), "%u wide, %u layers", width, layers);
+	input = benchLayeredConfiguration (width, layers, &outputTerminalID);
+	benchGraph (name, input, outputTerminalID, expectedPaths, layers + 3);
+}
+
+#pragma mark -Main-
+
+static void benchUsage (void) {
+	fprintf (stderr, "usage: unitbench [-n units] [-g [-w width -l layers]] [-t ms]\n");
+	exit (2);
+}
+
+int main (int argc, char ** argv) {
+	static const UInt32				defaultSizes[] = { 16, 64, 255 };
+	BenchInput						input;
+	int								option;
+
+	while (-1 != (option = getopt (argc, argv, "n:gw:l:t:")))
+	{
+		switch (option)
+		{
+			case 'n':	sOptions.numUnits = atoi (optarg);				break;
+			case 'g':	sOptions.graph = true;							break;
+			case 'w':	sOptions.width = atoi (optarg);					break;
+			case 'l':	sOptions.layers = atoi (optarg);				break;
+			case 't':	sOptions.benchmarkMS = atoi (optarg);			break;
+			default:	benchUsage ();
+		}
+	}
+	if (0 == sOptions.benchmarkMS || 1 == sOptions.numUnits || 255 < sOptions.numUnits)
+	{
+		benchUsage ();
+	}
+	// Unit IDs are a byte, and the paths are counted in 32 bits.
+	if ((0 != sOptions.width || 0 != sOptions.layers) && (1 > sOptions.width || (sOptions.layers + 1) * sOptions.width + 2 > 255 || 31 < (sOptions.layers + 1) * (32 - __builtin_clz (sOptions.width))))
+	{
+		benchUsage ();
+	}
+
+	if (sOptions.graph)
+	{
+		if (0 != sOptions.width)
+		{
+			benchLayeredGraph (sOptions.width, sOptions.layers);
+		}
+		else
+		{
+			input = benchChainConfiguration (255);
+			benchGraph ("255 deep", input, 255, 1, 255);
+			benchLayeredGraph (16, 1);
+			benchLayeredGraph (8, 2);
+			benchLayeredGraph (4, 6);
+		}
+	}
+	else if (0 != sOptions.numUnits)
+	{
+		benchUnits (sOptions.numUnits);
+	}
+	else
+	{
+		for (UInt32 sizeIndex = 0; sizeIndex < sizeof (defaultSizes) / sizeof (defaultSizes[0]); sizeIndex++)
+		{
+			benchUnits (defaultSizes[sizeIndex]);
+		}
+	}
+
+	printf ("%s\n", (0 == sFailures) ? "PASS" : "FAIL");
+	return (0 == sFailures) ? 0 : 1;
+}
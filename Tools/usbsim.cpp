@@ -0,0 +1,1180 @@
+/*
+ * Copyright (c) 1998-2010 Apple Computer, Inc. All rights reserved.
+ *
+ * @APPLE_LICENSE_HEADER_START@
+ *
+ * This file contains Original Code and/or Modifications of Original Code
+ * as defined in and that are subject to the Apple Public Source License
+ * Version 2.0 (the 'License'). You may not use this file except in
+ * compliance with the License. Please obtain a copy of the License at
+ * http://www.opensource.apple.com/apsl/ and read it before using this
+ * file.
+ *
+ * The Original Code and all software distributed under the License are
+ * distributed on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER
+ * EXPRESS OR IMPLIED, AND APPLE HEREBY DISCLAIMS ALL SUCH WARRANTIES,
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT.
+ * Please see the License for the specific language governing rights and
+ * limitations under the License.
+ *
+ * @APPLE_LICENSE_HEADER_END@
+ */
+
+//--------------------------------------------------------------------------------
+//
+//	File:		usbsim.cpp
+//
+//	Contains:	Host simulation of a full speed USB audio 1.0 device streaming through
+//				the driver. The driver sources are built unchanged against the shim in
+//				kernshim/; this file supplies the bus and the isochronous pipes.
+//
+//				The bus counts 1 ms frames on a virtual clock that runs at a configurable
+//				offset from host time. Each frame, the pipes process the frame of every
+//				transfer queued for it: input packets carry the device's sample clock with
+//				packet-size jitter, short packets and overruns mixed in, and output packets
+//				are consumed as queued. Frames not yet processed keep the 'llit' status the
+//				low latency API gives them, and completions are delivered on time or a few
+//				frames late, in queue order on each pipe. So readHandler, writeHandler,
+//				CoalesceInputSamples, PrepareWriteFrameList and generateTimeStamp all run
+//				for real.
+//
+//				At the end, the engine's time stamps are checked against the sample clock
+//				they should follow (over the longest stretch the driver didn't restart the
+//				engine in), the input sample buffer is checked for gaps the device didn't
+//				cause, and the stream statistics are checked against what was injected.
+//				-v prints the time stamps, the statistics and each gap.
+//
+//				-w puts the device to sleep and wakes it before the engine starts. With -w ok
+//				the device is expected to be resumed in place and never reset; with -w dead it
+//				answers no packet after the wake, and the driver is expected to notice from the
+//				completions, reset it and remember that it needs the reset on wake.
+//
+//				While the driver attaches, control requests take bus time: each goes in the
+//				first frame after it was sent that still has room (-q transfers a frame, 4 by
+//				default), and completes at the end of that frame. The count of requests and
+//				the time the last one completed are printed, so that attach costs can be
+//				compared across revisions.
+//
+//	Technology:	OS X
+//
+//	Build:		c++ -std=gnu++11 -fpermissive -w -I Tools/kernshim/include -I Tools/kernshim -I . -o usbsim \
+//					Tools/usbsim.cpp Tools/kernshim/*.cpp AppleUSBAudio*.cpp BigNum.cpp -lpthread
+//
+//	Usage:		usbsim [-c duplex|input|output] [-t ms] [-s seed] [-b bus ppm] [-p device ppm]
+//					   [-j jitter %] [-x short %] [-o overrun %] [-l late %] [-L max late frames]
+//					   [-w ok|dead] [-q control transfers per frame] [-v]
+//
+//				Exits non-zero if any check fails.
+//
+//--------------------------------------------------------------------------------
+
+#include <unistd.h>
+#include <set>
+#include <vector>
+
+#include "AppleUSBAudioDevice.h"
+#include "AppleUSBAudioEngine.h"
+#include "AppleUSBAudioStream.h"
+
+#pragma mark -Clock-
+
+// Every read of the clock costs this much virtual time, so that code spinning on the clock or the frame number still gets somewhere.
+#define kSimClockReadCost		100ull
+#define kSimStartTime			(1000ull * NSEC_PER_MSEC)
+
+static UInt64					sNow = kSimStartTime;
+static UInt64					sFrameLength = NSEC_PER_MSEC;
+static pthread_mutex_t			sClockMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static UInt64 simClock (void) {
+	UInt64							now;
+
+	pthread_mutex_lock (&sClockMutex);
+	sNow += kSimClockReadCost;
+	now = sNow;
+	pthread_mutex_unlock (&sClockMutex);
+	return now;
+}
+
+static void simAdvanceTo (UInt64 time) {
+	pthread_mutex_lock (&sClockMutex);
+	if (time > sNow)
+	{
+		sNow = time;
+	}
+	pthread_mutex_unlock (&sClockMutex);
+}
+
+// A bus that is n ppm slow of host time has frames n ns longer than a millisecond.
+static UInt64 simFrameStartTime (UInt64 frame) {
+	return frame * sFrameLength;
+}
+
+static UInt64 simFrameAt (UInt64 time) {
+	return time / sFrameLength;
+}
+
+#pragma mark -Options-
+
+enum {
+	kSimWakeNone				= 0,
+	kSimWakeOK,
+	kSimWakeDead
+};
+
+typedef struct {
+	UInt32						durationMS;
+	UInt32						seed;
+	SInt32						busPPM;
+	SInt32						devicePPM;
+	UInt32						jitterPercent;
+	UInt32						shortPercent;
+	UInt32						overrunPercent;
+	UInt32						latePercent;
+	UInt32						maxLateFrames;
+	bool						hasInput;
+	bool						hasOutput;
+	bool						verbose;
+	UInt32						wake;
+	UInt32						controlTransfersPerFrame;
+} SimOptions;
+
+static SimOptions				sOptions = { 3000, 1, 0, 0, 10, 1, 1, 10, 3, true, true, false, kSimWakeNone, 4 };
+
+// Set once a -w dead device has been woken; from then on every packet it is asked for goes unanswered.
+static bool						sDeviceDead = false;
+
+static UInt32 simRandom (UInt32 range) {
+	return (0 == range) ? 0 : (UInt32) (random () % range);
+}
+
+static bool simChance (UInt32 percent) {
+	return simRandom (100) < percent;
+}
+
+#pragma mark -Bus-
+
+class SimBus : public IOUSBControllerV2 {
+	OSDeclareDefaultStructors (SimBus)
+
+public:
+	virtual UInt64				GetFrameNumber ();
+};
+
+OSDefineMetaClassAndStructors (SimBus, IOUSBControllerV2)
+
+UInt64 SimBus::GetFrameNumber () {
+	AbsoluteTime					now;
+
+	clock_get_uptime (&now);
+	return simFrameAt (now);
+}
+
+#pragma mark -Pipes-
+
+typedef struct {
+	UInt32						transfers;
+	UInt32						completions;
+	UInt32						lateCompletions;
+	UInt32						tooOld;
+	UInt64						packets;
+	UInt64						bytes;
+	UInt32						shortPackets;
+	UInt32						jitteredPackets;
+	UInt32						overruns;
+	UInt32						aborted;
+	UInt64						samplesLost;
+	// Input sample frames the device's clock produced, and the ones that made it into packets.
+	UInt64						samplesClocked;
+	UInt64						samplesKept;
+	// What reached the driver in transfers that weren't aborted, which is all its statistics see.
+	UInt64						deliveredPackets;
+	UInt32						deliveredOverruns;
+} SimPipeCounts;
+
+class SimPipe;
+
+typedef struct {
+	SimPipe *					pipe;
+	IOMemoryDescriptor *		buffer;
+	UInt64						frameStart;
+	UInt32						numFrames;
+	IOUSBLowLatencyIsocFrame *	lowLatencyFrames;
+	IOUSBIsocFrame *			frames;
+	IOUSBLowLatencyIsocCompletion	lowLatencyCompletion;
+	IOUSBIsocCompletion			completion;
+	UInt32						framesDone;
+	UInt32						overruns;
+	UInt64						completeAtFrame;
+	IOReturn					status;
+	bool						isRead;
+} SimTransfer;
+
+static std::vector<SimTransfer *>	sTransfers;
+
+class SimPipe : public IOUSBPipe {
+	OSDeclareDefaultStructors (SimPipe)
+
+public:
+	static SimPipe *			withEndpoint (UInt8 address, UInt8 attributes, UInt16 maxPacketSize, UInt8 interval);
+
+	virtual IOReturn			Read (IOMemoryDescriptor * buffer, UInt64 frameStart, UInt32 numFrames, IOUSBIsocFrame * pFrames, IOUSBIsocCompletion * completion = 0);
+	virtual IOReturn			Read (IOMemoryDescriptor * buffer, UInt64 frameStart, UInt32 numFrames, IOUSBLowLatencyIsocFrame * pFrames, IOUSBLowLatencyIsocCompletion * completion = 0, UInt32 updateFrequency = 0);
+	virtual IOReturn			Write (IOMemoryDescriptor * buffer, UInt64 frameStart, UInt32 numFrames, IOUSBIsocFrame * pFrames, IOUSBIsocCompletion * completion = 0);
+	virtual IOReturn			Write (IOMemoryDescriptor * buffer, UInt64 frameStart, UInt32 numFrames, IOUSBLowLatencyIsocFrame * pFrames, IOUSBLowLatencyIsocCompletion * completion = 0, UInt32 updateFrequency = 0);
+	virtual IOReturn			Abort ();
+
+	IOReturn					queue (IOMemoryDescriptor * buffer, UInt64 frameStart, UInt32 numFrames, IOUSBIsocFrame * frames, IOUSBLowLatencyIsocFrame * lowLatencyFrames, IOUSBIsocCompletion * completion, IOUSBLowLatencyIsocCompletion * lowLatencyCompletion, bool isRead);
+	void						processFrame (SimTransfer * transfer, UInt64 frame, AbsoluteTime frameTime);
+
+	SimPipeCounts				mCounts;
+	// The device's sample clock: fractional samples owed to the next packet, and the index of the next sample it sends.
+	double						mSampleDebt;
+	SInt32						mJitterCarry;
+	UInt32						mNextSample;
+	UInt32						mBytesPerSampleFrame;
+	UInt32						mSampleRate;
+};
+
+OSDefineMetaClassAndStructors (SimPipe, IOUSBPipe)
+
+SimPipe * SimPipe::withEndpoint (UInt8 address, UInt8 attributes, UInt16 maxPacketSize, UInt8 interval) {
+	SimPipe *						pipe = new SimPipe;
+
+	pipe->mEndpoint.bLength = sizeof (IOUSBEndpointDescriptor);
+	pipe->mEndpoint.bDescriptorType = kUSBEndpointDesc;
+	pipe->mEndpoint.bEndpointAddress = address;
+	pipe->mEndpoint.bmAttributes = attributes;
+	pipe->mEndpoint.wMaxPacketSize = maxPacketSize;
+	pipe->mEndpoint.bInterval = interval;
+	pipe->mBytesPerSampleFrame = 4;
+	pipe->mSampleRate = 48000;
+	return pipe;
+}
+
+IOReturn SimPipe::queue (IOMemoryDescriptor * buffer, UInt64 frameStart, UInt32 numFrames, IOUSBIsocFrame * frames, IOUSBLowLatencyIsocFrame * lowLatencyFrames, IOUSBIsocCompletion * completion, IOUSBLowLatencyIsocCompletion * lowLatencyCompletion, bool isRead) {
+	SimTransfer *					transfer;
+	UInt64							currentFrame;
+
+	currentFrame = simFrameAt (simClock ());
+	if (frameStart + numFrames <= currentFrame)
+	{
+		mCounts.tooOld++;
+		return kIOReturnIsoTooOld;
+	}
+
+	transfer = new SimTransfer;
+	memset (transfer, 0, sizeof (SimTransfer));
+	transfer->pipe = this;
+	transfer->buffer = buffer;
+	transfer->frameStart = frameStart;
+	transfer->numFrames = numFrames;
+	transfer->frames = frames;
+	transfer->lowLatencyFrames = lowLatencyFrames;
+	transfer->isRead = isRead;
+	transfer->status = kIOReturnSuccess;
+	transfer->completeAtFrame = ~0ull;
+	if (NULL != completion)
+	{
+		transfer->completion = *completion;
+	}
+	if (NULL != lowLatencyCompletion)
+	{
+		transfer->lowLatencyCompletion = *lowLatencyCompletion;
+	}
+	// Frames the controller hasn't got to yet say so.
+	for (UInt32 frameIndex = 0; frameIndex < numFrames && NULL != lowLatencyFrames; frameIndex++)
+	{
+		lowLatencyFrames[frameIndex].frStatus = kUSBLowLatencyIsochTransferKey;
+		lowLatencyFrames[frameIndex].frActCount = 0;
+	}
+	// Frames whose time has already gone by when the transfer is queued are never sent.
+	for (; transfer->framesDone < numFrames && frameStart + transfer->framesDone < currentFrame; transfer->framesDone++)
+	{
+		if (NULL != lowLatencyFrames)
+		{
+			lowLatencyFrames[transfer->framesDone].frStatus = kIOUSBNotSent1Err;
+		}
+		else
+		{
+			frames[transfer->framesDone].frStatus = kIOUSBNotSent1Err;
+			frames[transfer->framesDone].frActCount = 0;
+		}
+		transfer->status = kIOUSBNotSent1Err;
+	}
+	mCounts.transfers++;
+	sTransfers.push_back (transfer);
+	return kIOReturnSuccess;
+}
+
+IOReturn SimPipe::Read (IOMemoryDescriptor * buffer, UInt64 frameStart, UInt32 numFrames, IOUSBIsocFrame * pFrames, IOUSBIsocCompletion * completion) {
+	return queue (buffer, frameStart, numFrames, pFrames, NULL, completion, NULL, true);
+}
+
+IOReturn SimPipe::Read (IOMemoryDescriptor * buffer, UInt64 frameStart, UInt32 numFrames, IOUSBLowLatencyIsocFrame * pFrames, IOUSBLowLatencyIsocCompletion * completion, UInt32 updateFrequency) {
+	return queue (buffer, frameStart, numFrames, NULL, pFrames, NULL, completion, true);
+}
+
+IOReturn SimPipe::Write (IOMemoryDescriptor * buffer, UInt64 frameStart, UInt32 numFrames, IOUSBIsocFrame * pFrames, IOUSBIsocCompletion * completion) {
+	return queue (buffer, frameStart, numFrames, pFrames, NULL, completion, NULL, false);
+}
+
+IOReturn SimPipe::Write (IOMemoryDescriptor * buffer, UInt64 frameStart, UInt32 numFrames, IOUSBLowLatencyIsocFrame * pFrames, IOUSBLowLatencyIsocCompletion * completion, UInt32 updateFrequency) {
+	return queue (buffer, frameStart, numFrames, NULL, pFrames, NULL, completion, false);
+}
+
+static void simComplete (SimTransfer * transfer);
+
+// Like IOUSBFamily, the transfers come back aborted before Abort () returns.
+IOReturn SimPipe::Abort () {
+	std::vector<SimTransfer *>		aborted;
+
+	for (std::vector<SimTransfer *>::iterator it = sTransfers.begin (); it != sTransfers.end ();)
+	{
+		if (this == (*it)->pipe)
+		{
+			aborted.push_back (*it);
+			it = sTransfers.erase (it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+	for (size_t index = 0; index < aborted.size (); index++)
+	{
+		mCounts.aborted++;
+		aborted[index]->status = kIOReturnAborted;
+		simComplete (aborted[index]);
+	}
+	return kIOReturnSuccess;
+}
+
+// Each sample frame carries its index on the device's clock, so that gaps in the input sample buffer can be told apart.
+static void simFillSamples (UInt8 * bytes, UInt32 firstSample, UInt32 numSamples) {
+	for (UInt32 sample = 0; sample < numSamples; sample++)
+	{
+		UInt32						index = firstSample + sample;
+
+		bytes[sample * 4 + 0] = index & 0xFF;
+		bytes[sample * 4 + 1] = (index >> 8) & 0xFF;
+		bytes[sample * 4 + 2] = (index >> 16) & 0xFF;
+		bytes[sample * 4 + 3] = (index >> 24) & 0xFF;
+	}
+}
+
+void SimPipe::processFrame (SimTransfer * transfer, UInt64 frame, AbsoluteTime frameTime) {
+	UInt32							frameIndex = transfer->framesDone;
+	UInt16							reqCount;
+	UInt32							actCount;
+	UInt32							offset = 0;
+	UInt32							numSamples;
+	IOReturn						status = kIOReturnSuccess;
+	UInt8							packet[1024];
+
+	reqCount = (NULL != transfer->lowLatencyFrames) ? transfer->lowLatencyFrames[frameIndex].frReqCount : transfer->frames[frameIndex].frReqCount;
+	for (UInt32 previous = 0; previous < frameIndex; previous++)
+	{
+		offset += (NULL != transfer->lowLatencyFrames) ? transfer->lowLatencyFrames[previous].frReqCount : transfer->frames[previous].frReqCount;
+	}
+
+	if (sDeviceDead)
+	{
+		status = kIOReturnNotResponding;
+		actCount = 0;
+	}
+	else if (transfer->isRead && NULL != transfer->lowLatencyFrames)
+	{
+		// The device's clock runs at its own offset from host time, and packets can jitter by a sample as long as the average holds.
+		mSampleDebt += ((double) mSampleRate / 1000.0) * (1.0 + (double) sOptions.devicePPM / 1e6) * (1.0 + (double) sOptions.busPPM / 1e6);
+		numSamples = (UInt32) mSampleDebt;
+		mSampleDebt -= numSamples;
+		mCounts.samplesClocked += numSamples;
+		if (0 != mJitterCarry)
+		{
+			numSamples += mJitterCarry;
+			mJitterCarry = 0;
+		}
+		else if (simChance (sOptions.jitterPercent))
+		{
+			mJitterCarry = simChance (50) ? 1 : -1;
+			numSamples -= mJitterCarry;
+			mCounts.jitteredPackets++;
+		}
+		actCount = numSamples * mBytesPerSampleFrame;
+
+		if (simChance (sOptions.overrunPercent))
+		{
+			// The device sends more than the host asked for; the controller keeps what fits and the rest of the packet is lost.
+			actCount = reqCount + mBytesPerSampleFrame * (1 + simRandom (4));
+		}
+		if (actCount > reqCount)
+		{
+			status = kIOReturnOverrun;
+			mCounts.overruns++;
+			transfer->overruns++;
+			mCounts.samplesLost += (actCount - reqCount) / mBytesPerSampleFrame;
+			simFillSamples (packet, mNextSample, reqCount / mBytesPerSampleFrame);
+			mNextSample += actCount / mBytesPerSampleFrame;
+			actCount = reqCount;
+		}
+		else if (simChance (sOptions.shortPercent))
+		{
+			// A damaged packet: the tail of it never arrives.
+			UInt32					keptSamples = simRandom (numSamples);
+
+			mCounts.shortPackets++;
+			mCounts.samplesLost += numSamples - keptSamples;
+			simFillSamples (packet, mNextSample, keptSamples);
+			mNextSample += numSamples;
+			actCount = keptSamples * mBytesPerSampleFrame;
+		}
+		else
+		{
+			simFillSamples (packet, mNextSample, numSamples);
+			mNextSample += numSamples;
+		}
+		if (actCount < reqCount && kIOReturnSuccess == status)
+		{
+			status = kIOReturnUnderrun;
+		}
+		mCounts.samplesKept += actCount / mBytesPerSampleFrame;
+		if (0 != actCount)
+		{
+			transfer->buffer->writeBytes (offset, packet, actCount);
+		}
+	}
+	else
+	{
+		actCount = reqCount;
+	}
+
+	mCounts.packets++;
+	mCounts.bytes += actCount;
+	if (kIOReturnSuccess != status && kIOReturnUnderrun != status)
+	{
+		transfer->status = status;
+	}
+	else if (kIOReturnUnderrun == status && kIOReturnSuccess == transfer->status)
+	{
+		transfer->status = status;
+	}
+	if (NULL != transfer->lowLatencyFrames)
+	{
+		transfer->lowLatencyFrames[frameIndex].frActCount = actCount;
+		transfer->lowLatencyFrames[frameIndex].frTimeStamp = frameTime;
+		// The status goes last, the driver reads it to tell whether the frame is done.
+		OSMemoryBarrier ();
+		transfer->lowLatencyFrames[frameIndex].frStatus = status;
+	}
+	else
+	{
+		transfer->frames[frameIndex].frActCount = actCount;
+		transfer->frames[frameIndex].frStatus = status;
+	}
+	transfer->framesDone++;
+
+	if (transfer->framesDone == transfer->numFrames)
+	{
+		transfer->completeAtFrame = frame;
+		if (simChance (sOptions.latePercent))
+		{
+			transfer->completeAtFrame += 1 + simRandom (sOptions.maxLateFrames);
+			mCounts.lateCompletions++;
+		}
+	}
+}
+
+static void simComplete (SimTransfer * transfer) {
+	transfer->pipe->mCounts.completions++;
+	// Priming reads only hold the input pipe's place until the stream's own frame lists start; the driver throws their data away.
+	if (kIOReturnAborted != transfer->status && AppleUSBAudioStream::primeInputPipeHandler != transfer->lowLatencyCompletion.action)
+	{
+		transfer->pipe->mCounts.deliveredPackets += transfer->numFrames;
+		transfer->pipe->mCounts.deliveredOverruns += transfer->overruns;
+	}
+	if (NULL != transfer->lowLatencyFrames)
+	{
+		if (NULL != transfer->lowLatencyCompletion.action)
+		{
+			transfer->lowLatencyCompletion.action (transfer->lowLatencyCompletion.target, transfer->lowLatencyCompletion.parameter, transfer->status, transfer->lowLatencyFrames);
+		}
+	}
+	else if (NULL != transfer->completion.action)
+	{
+		transfer->completion.action (transfer->completion.target, transfer->completion.parameter, transfer->status, transfer->frames);
+	}
+	delete transfer;
+}
+
+// Runs the end of one bus frame: every transfer with a packet in it gets that packet, then whatever is due is completed in queue order.
+static void simEndFrame (UInt64 frame) {
+	std::vector<SimTransfer *>		due;
+	std::set<SimPipe *>				blocked;
+	AbsoluteTime					frameTime = simFrameStartTime (frame + 1);
+
+	for (size_t index = 0; index < sTransfers.size (); index++)
+	{
+		SimTransfer *				transfer = sTransfers[index];
+
+		if (transfer->framesDone < transfer->numFrames && transfer->frameStart + transfer->framesDone == frame)
+		{
+			transfer->pipe->processFrame (transfer, frame, frameTime);
+		}
+		else if (transfer->framesDone < transfer->numFrames && transfer->frameStart + transfer->framesDone < frame)
+		{
+			// Queued too late for the frame it named.
+			while (transfer->framesDone < transfer->numFrames && transfer->frameStart + transfer->framesDone <= frame)
+			{
+				transfer->pipe->processFrame (transfer, frame, frameTime);
+			}
+		}
+	}
+	// A pipe completes its transfers in the order they were queued, so one that is running late holds up the ones behind it.
+	for (std::vector<SimTransfer *>::iterator it = sTransfers.begin (); it != sTransfers.end ();)
+	{
+		if ((*it)->completeAtFrame > frame)
+		{
+			blocked.insert ((*it)->pipe);
+		}
+		if ((*it)->completeAtFrame <= frame && 0 == blocked.count ((*it)->pipe))
+		{
+			due.push_back (*it);
+			it = sTransfers.erase (it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+	// Completions may queue more transfers, which go on the end of sTransfers.
+	for (size_t index = 0; index < due.size (); index++)
+	{
+		simComplete (due[index]);
+	}
+}
+
+#pragma mark -Control requests-
+
+// Control transfers share the bus: each goes in the first frame after it was submitted that has room left behind the transfers
+// already queued, and completes at the end of that frame. A synchronous request holds the caller until then; the completions of
+// asynchronous ones are held until the driver sleeps waiting for them.
+typedef struct {
+	IOUSBCompletion				completion;
+	UInt64						time;
+} SimControlCompletion;
+
+static UInt64					sControlFrame = 0;
+static UInt32					sControlFrameTransfers = 0;
+static std::vector<SimControlCompletion>	sControlCompletions;
+
+// Only the attach is timed this way; later requests complete at once so that they don't move the clock under the pipes.
+typedef struct {
+	bool						timed;
+	UInt32						synchronous;
+	UInt32						asynchronous;
+	UInt64						lastDoneTime;
+} SimControlCounts;
+
+static SimControlCounts			sControlCounts = { false, 0, 0, 0 };
+
+static UInt64 simScheduleControlTransfer (void) {
+	UInt64							frame = simFrameAt (simClock ()) + 1;
+	UInt64							doneTime;
+
+	if (frame <= sControlFrame)
+	{
+		frame = (sControlFrameTransfers < sOptions.controlTransfersPerFrame) ? sControlFrame : sControlFrame + 1;
+	}
+	if (frame != sControlFrame)
+	{
+		sControlFrame = frame;
+		sControlFrameTransfers = 0;
+	}
+	sControlFrameTransfers++;
+	doneTime = simFrameStartTime (frame + 1);
+	if (doneTime > sControlCounts.lastDoneTime)
+	{
+		sControlCounts.lastDoneTime = doneTime;
+	}
+	return doneTime;
+}
+
+// Hands over the held completions, each at the end of the frame its transfer went in.
+static bool simDeliverControlCompletions (void) {
+	std::vector<SimControlCompletion>	due;
+
+	if (sControlCompletions.empty ())
+	{
+		return false;
+	}
+	due.swap (sControlCompletions);
+	for (size_t index = 0; index < due.size (); index++)
+	{
+		simAdvanceTo (due[index].time);
+		due[index].completion.action (due[index].completion.target, due[index].completion.parameter, kIOReturnSuccess, 0);
+	}
+	return true;
+}
+
+// The feature units' answers: volume from -32 dB to 0 dB in 0.5 dB steps, at -16 dB, and unmuted. Anything else reads as zeros.
+static void simAnswerControlRequest (UInt8 requestType, UInt8 request, UInt16 value, UInt16 index, UInt8 * data, UInt16 length) {
+	SInt16							answer = 0;
+
+	memset (data, 0, length);
+	if (0xA1 != requestType || 2 > length || (5 != (index >> 8) && 6 != (index >> 8)) || VOLUME_CONTROL != (value >> 8))
+	{
+		return;
+	}
+	switch (request)
+	{
+		case GET_CUR:	answer = -0x1000;	break;
+		case GET_MIN:	answer = -0x2000;	break;
+		case GET_MAX:	answer = 0;			break;
+		case GET_RES:	answer = 0x0080;	break;
+	}
+	data[0] = answer & 0xFF;
+	data[1] = (answer >> 8) & 0xFF;
+}
+
+#pragma mark -Device-
+
+// The device stays on its hub port, which is all the driver asks before resetting it.
+class SimDevice : public IOUSBDevice {
+	OSDeclareDefaultStructors (SimDevice)
+
+public:
+	virtual IOReturn			message (UInt32 type, IOService * provider, void * argument = 0);
+	virtual IOReturn			DeviceRequest (IOUSBDevRequest * request, IOUSBCompletion * completion = 0);
+	virtual IOReturn			DeviceRequest (IOUSBDevRequestDesc * request, IOUSBCompletion * completion = 0);
+
+	IOReturn					controlTransfer (UInt32 * lengthDone, UInt16 length, IOUSBCompletion * completion);
+};
+
+OSDefineMetaClassAndStructors (SimDevice, IOUSBDevice)
+
+IOReturn SimDevice::message (UInt32 type, IOService * provider, void * argument) {
+	return (kIOUSBMessageHubIsDeviceConnected == type) ? kIOReturnSuccess : IOUSBDevice::message (type, provider, argument);
+}
+
+IOReturn SimDevice::DeviceRequest (IOUSBDevRequest * request, IOUSBCompletion * completion) {
+	if ((request->bmRequestType & 0x80) && NULL != request->pData)
+	{
+		simAnswerControlRequest (request->bmRequestType, request->bRequest, request->wValue, request->wIndex, (UInt8 *) request->pData, request->wLength);
+	}
+	return controlTransfer (&request->wLenDone, request->wLength, completion);
+}
+
+IOReturn SimDevice::DeviceRequest (IOUSBDevRequestDesc * request, IOUSBCompletion * completion) {
+	UInt8							data[256];
+
+	if ((request->bmRequestType & 0x80) && NULL != request->pData)
+	{
+		for (IOByteCount offset = 0; offset < request->wLength; offset += sizeof (data))
+		{
+			UInt16					length = (request->wLength - offset < sizeof (data)) ? request->wLength - offset : sizeof (data);
+
+			memset (data, 0, sizeof (data));
+			if (0 == offset)
+			{
+				simAnswerControlRequest (request->bmRequestType, request->bRequest, request->wValue, request->wIndex, data, length);
+			}
+			request->pData->writeBytes (offset, data, length);
+		}
+	}
+	return controlTransfer (&request->wLenDone, request->wLength, completion);
+}
+
+IOReturn SimDevice::controlTransfer (UInt32 * lengthDone, UInt16 length, IOUSBCompletion * completion) {
+	SimControlCompletion			held;
+
+	*lengthDone = length;
+	if (!sControlCounts.timed)
+	{
+		if (NULL != completion && NULL != completion->action)
+		{
+			completion->action (completion->target, completion->parameter, kIOReturnSuccess, 0);
+		}
+		return kIOReturnSuccess;
+	}
+	held.time = simScheduleControlTransfer ();
+	if (NULL == completion || NULL == completion->action)
+	{
+		sControlCounts.synchronous++;
+		simAdvanceTo (held.time);
+	}
+	else
+	{
+		sControlCounts.asynchronous++;
+		held.completion = *completion;
+		sControlCompletions.push_back (held);
+	}
+	return kIOReturnSuccess;
+}
+
+#pragma mark -Interfaces-
+
+// Bumped each time the driver selects a streaming alternate setting, so a restart of the engine shows up between two time stamps.
+static UInt32					sStreamStarts = 0;
+
+class SimInterface : public IOUSBInterface {
+	OSDeclareDefaultStructors (SimInterface)
+
+public:
+	virtual IOReturn			SetAlternateInterface (IOService * forClient, UInt16 alternateSetting);
+
+	// The pipe the streaming alternate setting opens.
+	SimPipe *					mStreamPipe;
+};
+
+OSDefineMetaClassAndStructors (SimInterface, IOUSBInterface)
+
+IOReturn SimInterface::SetAlternateInterface (IOService * forClient, UInt16 alternateSetting) {
+	removePipes ();
+	if (0 != alternateSetting && NULL != mStreamPipe)
+	{
+		addPipe (mStreamPipe);
+		sStreamStarts++;
+	}
+	return IOUSBInterface::SetAlternateInterface (forClient, alternateSetting);
+}
+
+#pragma mark -Descriptors-
+
+// A stereo 16 bit speaker and microphone at 48 kHz: adaptive output on endpoint 1, asynchronous input on endpoint 0x82. Each goes
+// through a feature unit with a master mute and a volume on each channel.
+static const UInt8 sConfiguration[] = {
+	0x09, 0x02, 0xC2, 0x00, 0x03, 0x01, 0x00, 0x80, 0x32,
+	// Audio control interface
+	0x09, 0x04, 0x00, 0x00, 0x00, 0x01, 0x01, 0x00, 0x00,
+	0x0A, 0x24, 0x01, 0x00, 0x01, 0x48, 0x00, 0x02, 0x01, 0x02,
+	0x0C, 0x24, 0x02, 0x01, 0x01, 0x01, 0x00, 0x02, 0x03, 0x00, 0x00, 0x00,
+	0x0A, 0x24, 0x06, 0x05, 0x01, 0x01, 0x01, 0x02, 0x02, 0x00,
+	0x09, 0x24, 0x03, 0x02, 0x01, 0x03, 0x00, 0x05, 0x00,
+	0x0C, 0x24, 0x02, 0x03, 0x01, 0x02, 0x00, 0x02, 0x03, 0x00, 0x00, 0x00,
+	0x0A, 0x24, 0x06, 0x06, 0x03, 0x01, 0x01, 0x02, 0x02, 0x00,
+	0x09, 0x24, 0x03, 0x04, 0x01, 0x01, 0x00, 0x06, 0x00,
+	// Output streaming interface
+	0x09, 0x04, 0x01, 0x00, 0x00, 0x01, 0x02, 0x00, 0x00,
+	0x09, 0x04, 0x01, 0x01, 0x01, 0x01, 0x02, 0x00, 0x00,
+	0x07, 0x24, 0x01, 0x01, 0x01, 0x01, 0x00,
+	0x0B, 0x24, 0x02, 0x01, 0x02, 0x02, 0x10, 0x01, 0x80, 0xBB, 0x00,
+	0x09, 0x05, 0x01, 0x09, 0xC8, 0x00, 0x01, 0x00, 0x00,
+	0x07, 0x25, 0x01, 0x01, 0x00, 0x00, 0x00,
+	// Input streaming interface
+	0x09, 0x04, 0x02, 0x00, 0x00, 0x01, 0x02, 0x00, 0x00,
+	0x09, 0x04, 0x02, 0x01, 0x01, 0x01, 0x02, 0x00, 0x00,
+	0x07, 0x24, 0x01, 0x04, 0x01, 0x01, 0x00,
+	0x0B, 0x24, 0x02, 0x01, 0x02, 0x02, 0x10, 0x01, 0x80, 0xBB, 0x00,
+	0x09, 0x05, 0x82, 0x05, 0xC8, 0x00, 0x01, 0x00, 0x00,
+	0x07, 0x25, 0x01, 0x01, 0x00, 0x00, 0x00,
+};
+
+#define kSimOutputInterface		1
+#define kSimInputInterface		2
+#define kSimMaxPacketSize		200
+
+// Copies the configuration, leaving out the streaming interfaces not asked for.
+static UInt8 * simBuildConfiguration (void) {
+	UInt8 *							configuration = (UInt8 *) malloc (sizeof (sConfiguration));
+	UInt32							length = 0;
+	UInt32							offset = 0;
+	UInt8							currentInterface = 0;
+	UInt8							numInterfaces = 1;
+	bool							keep = true;
+
+	while (offset < sizeof (sConfiguration))
+	{
+		if (kUSBInterfaceDesc == sConfiguration[offset + 1])
+		{
+			currentInterface = sConfiguration[offset + 2];
+			keep = (kSimOutputInterface == currentInterface) ? sOptions.hasOutput : (kSimInputInterface == currentInterface) ? sOptions.hasInput : true;
+			if (keep && 0 != currentInterface && 0 == sConfiguration[offset + 3])
+			{
+				numInterfaces++;
+			}
+		}
+		if (keep)
+		{
+			memcpy (configuration + length, sConfiguration + offset, sConfiguration[offset]);
+			length += sConfiguration[offset];
+		}
+		offset += sConfiguration[offset];
+	}
+	configuration[2] = length & 0xFF;
+	configuration[3] = (length >> 8) & 0xFF;
+	configuration[4] = numInterfaces;
+	return configuration;
+}
+
+#pragma mark -Checks-
+
+typedef struct {
+	UInt32						loopCount;
+	AbsoluteTime				time;
+	UInt32						streamStarts;
+	UInt64						samplesClocked;
+	UInt64						samplesKept;
+} SimTimeStamp;
+
+static UInt32					sFailures = 0;
+
+static void simCheck (bool passed, const char * format, ...) {
+	va_list							arguments;
+
+	printf ("%s ", passed ? "  ok  " : "  FAIL");
+	va_start (arguments, format);
+	vprintf (format, arguments);
+	va_end (arguments);
+	printf ("\n");
+	if (!passed)
+	{
+		sFailures++;
+	}
+}
+
+static UInt64 simStatistic (IOService * stream, const char * key) {
+	OSDictionary *					statistics = OSDynamicCast (OSDictionary, stream->getProperty (kStreamStatisticsKey));
+	OSNumber *						number = (NULL != statistics) ? OSDynamicCast (OSNumber, statistics->getObject (key)) : NULL;
+
+	return (NULL != number) ? number->unsigned64BitValue () : 0;
+}
+
+static void simPrintStatistics (const char * name, IOService * stream) {
+	OSDictionary *					statistics = OSDynamicCast (OSDictionary, stream->getProperty (kStreamStatisticsKey));
+	OSCollectionIterator *			iterator;
+	OSSymbol *						key;
+
+	if (NULL == statistics || NULL == (iterator = OSCollectionIterator::withCollection (statistics)))
+	{
+		return;
+	}
+	while (NULL != (key = OSDynamicCast (OSSymbol, iterator->getNextObject ())))
+	{
+		OSNumber *					number = OSDynamicCast (OSNumber, statistics->getObject (key));
+
+		if (NULL != number)
+		{
+			printf ("  %s %s = %llu\n", name, key->getCStringNoCopy (), number->unsigned64BitValue ());
+		}
+	}
+	iterator->release ();
+}
+
+// Counts places where consecutive sample frames in the input buffer aren't consecutive on the device's clock. Each lost stretch of
+// samples accounts for one, and the write head for another.
+static UInt32 simCountInputGaps (IOAudioStream * stream, UInt32 * oldest, UInt32 * newest) {
+	const UInt8 *					buffer = (const UInt8 *) stream->getSampleBuffer ();
+	UInt32							numFrames = stream->getSampleBufferSize () / 4;
+	UInt32							gaps = 0;
+	UInt32							previous;
+	UInt32							value;
+
+	*oldest = ~0u;
+	*newest = 0;
+	if (NULL == buffer || 0 == numFrames)
+	{
+		return 0;
+	}
+	for (UInt32 frame = 0; frame < numFrames; frame++)
+	{
+		value = buffer[frame * 4] | (buffer[frame * 4 + 1] << 8) | (buffer[frame * 4 + 2] << 16) | ((UInt32) buffer[frame * 4 + 3] << 24);
+		if (0 != frame && value != previous + 1)
+		{
+			if (sOptions.verbose)
+			{
+				printf ("  input gap at buffer frame %u: %u follows %u\n", frame, value, previous);
+			}
+			gaps++;
+		}
+		*oldest = (value < *oldest) ? value : *oldest;
+		*newest = (value > *newest) ? value : *newest;
+		previous = value;
+	}
+	return gaps;
+}
+
+#pragma mark -Main-
+
+static void simUsage (void) {
+	fprintf (stderr, "usage: usbsim [-c duplex|input|output] [-t ms] [-s seed] [-b bus ppm] [-p device ppm]\n");
+	fprintf (stderr, "              [-j jitter %%] [-x short %%] [-o overrun %%] [-l late %%] [-L max late frames]\n");
+	fprintf (stderr, "              [-w ok|dead] [-q control transfers per frame] [-v]\n");
+	exit (2);
+}
+
+int main (int argc, char ** argv) {
+	SimBus *						bus;
+	SimDevice *						device;
+	SimInterface *					controlInterface;
+	SimInterface *					streamInterfaces[2] = { NULL, NULL };
+	SimPipe *						pipes[2] = { NULL, NULL };
+	AppleUSBAudioDevice *			audioDevice;
+	AppleUSBAudioEngine *			engine = NULL;
+	IOAudioStream *					inputStream = NULL;
+	IOAudioStream *					outputStream = NULL;
+	OSCollectionIterator *			iterator;
+	OSObject *						object;
+	std::vector<SimTimeStamp>		timeStamps;
+	SimTimeStamp					timeStamp;
+	UInt64							firstFrame;
+	UInt64							frame;
+	UInt64							nextTimerEvent;
+	UInt64							nanos;
+	double							measuredRate;
+	double							expectedRate;
+	double							maxDeviationNanos = 0.0;
+	double							rateTolerance = 100e-6;
+	double							deviationTolerance = 1000000.0;
+	size_t							first = 0;
+	size_t							last = 0;
+	UInt32							lastLoopCount = 0;
+	UInt32							oldestSample;
+	UInt32							newestSample;
+	UInt32							gaps;
+	UInt32							microSecsUntilComplete = 0;
+	UInt64							attachTime;
+	int								option;
+
+	while (-1 != (option = getopt (argc, argv, "c:t:s:b:p:j:x:o:l:L:w:q:v")))
+	{
+		switch (option)
+		{
+			case 'c':
+				sOptions.hasInput = (0 != strcmp (optarg, "output"));
+				sOptions.hasOutput = (0 != strcmp (optarg, "input"));
+				break;
+			case 't':	sOptions.durationMS = atoi (optarg);		break;
+			case 's':	sOptions.seed = atoi (optarg);				break;
+			case 'b':	sOptions.busPPM = atoi (optarg);			break;
+			case 'p':	sOptions.devicePPM = atoi (optarg);			break;
+			case 'j':	sOptions.jitterPercent = atoi (optarg);		break;
+			case 'v':	sOptions.verbose = true;					break;
+			case 'x':	sOptions.shortPercent = atoi (optarg);		break;
+			case 'o':	sOptions.overrunPercent = atoi (optarg);	break;
+			case 'l':	sOptions.latePercent = atoi (optarg);		break;
+			case 'L':	sOptions.maxLateFrames = atoi (optarg);		break;
+			case 'q':	sOptions.controlTransfersPerFrame = atoi (optarg);	break;
+			case 'w':
+				sOptions.wake = (0 == strcmp (optarg, "dead")) ? kSimWakeDead : (0 == strcmp (optarg, "ok")) ? kSimWakeOK : kSimWakeNone;
+				if (kSimWakeNone == sOptions.wake)
+				{
+					simUsage ();
+				}
+				break;
+			default:	simUsage ();
+		}
+	}
+	srandom (sOptions.seed);
+	sFrameLength = NSEC_PER_MSEC + sOptions.busPPM;
+	KernShimSetClock (simClock);
+	KernShimSetSynchronousThreadCalls (true);
+	KernShimSetIdle (simDeliverControlCompletions);
+	if (0 == sOptions.controlTransfersPerFrame)
+	{
+		simUsage ();
+	}
+
+	bus = new SimBus;
+	device = new SimDevice;
+	device->init ();
+	device->mBus = bus;
+	device->mConfigurationDescriptor = (const IOUSBConfigurationDescriptor *) simBuildConfiguration ();
+	device->mVendorID = 0x1234;
+	device->mProductID = 0x5678;
+	device->mSpeed = kUSBDeviceSpeedFull;
+	device->setProperty ("USB Product Name", "Simulated USB Audio");
+	device->setProperty ("USB Vendor Name", "usbsim");
+
+	controlInterface = new SimInterface;
+	controlInterface->init ();
+	controlInterface->mInterfaceNumber = 0;
+	controlInterface->mInterfaceSubClass = kUSBAudioControlSubClass;
+	device->addInterface (controlInterface);
+	for (UInt32 index = 0; index < 2; index++)
+	{
+		if ((0 == index && !sOptions.hasOutput) || (1 == index && !sOptions.hasInput))
+		{
+			continue;
+		}
+		streamInterfaces[index] = new SimInterface;
+		streamInterfaces[index]->init ();
+		streamInterfaces[index]->mInterfaceNumber = (0 == index) ? kSimOutputInterface : kSimInputInterface;
+		streamInterfaces[index]->mInterfaceSubClass = kUSBAudioStreamingSubClass;
+		pipes[index] = SimPipe::withEndpoint ((0 == index) ? 0x01 : 0x82, (0 == index) ? 0x09 : 0x05, kSimMaxPacketSize, 1);
+		streamInterfaces[index]->mStreamPipe = pipes[index];
+		device->addInterface (streamInterfaces[index]);
+	}
+
+	audioDevice = new AppleUSBAudioDevice;
+	audioDevice->init (NULL);
+	attachTime = simClock ();
+	sControlCounts.timed = true;
+	simCheck (audioDevice->start (controlInterface), "device started");
+	simDeliverControlCompletions ();
+	sControlCounts.timed = false;
+	printf ("attach: %u control requests (%u synchronous, %u asynchronous), last done after %.1f ms, start returned after %.1f ms\n",
+			(unsigned) (sControlCounts.synchronous + sControlCounts.asynchronous), (unsigned) sControlCounts.synchronous, (unsigned) sControlCounts.asynchronous,
+			(sControlCounts.lastDoneTime > attachTime) ? (sControlCounts.lastDoneTime - attachTime) / 1e6 : 0.0, (simClock () - attachTime) / 1e6);
+	simCheck (NULL != audioDevice->audioEngines && 1 == audioDevice->audioEngines->getCount (), "one engine created");
+	if (0 != sFailures)
+	{
+		return 1;
+	}
+
+	engine = OSDynamicCast (AppleUSBAudioEngine, audioDevice->audioEngines->getObject (0));
+	iterator = OSCollectionIterator::withCollection (engine->audioStreams);
+	while (NULL != (object = iterator->getNextObject ()))
+	{
+		IOAudioStream *				stream = OSDynamicCast (IOAudioStream, object);
+
+		if (kIOAudioStreamDirectionInput == stream->getDirection ())
+		{
+			inputStream = stream;
+		}
+		else
+		{
+			outputStream = stream;
+		}
+	}
+	iterator->release ();
+
+	if (kSimWakeNone != sOptions.wake)
+	{
+		audioDevice->performPowerStateChange (kIOAudioDeviceActive, kIOAudioDeviceSleep, &microSecsUntilComplete);
+		audioDevice->performPowerStateChange (kIOAudioDeviceSleep, kIOAudioDeviceActive, &microSecsUntilComplete);
+		simCheck (0 == device->mResetCount, "device resumed without a reset");
+		sDeviceDead = (kSimWakeDead == sOptions.wake);
+	}
+
+	simCheck (kIOReturnSuccess == engine->startAudioEngine (), "engine started");
+	firstFrame = simFrameAt (simClock ());
+	nextTimerEvent = sNow + audioDevice->getTimerInterval ();
+
+	for (frame = firstFrame; frame < firstFrame + sOptions.durationMS && 0 == sFailures; frame++)
+	{
+		// Host scheduling noise: the frame's work happens a little after the frame ends.
+		simAdvanceTo (simFrameStartTime (frame + 1) + simRandom (50000));
+		simEndFrame (frame);
+		IOTimerEventSource::fireExpired ();
+		if (0 != audioDevice->getTimerInterval () && sNow >= nextTimerEvent)
+		{
+			audioDevice->fireTimerEvents ();
+			nextTimerEvent += audioDevice->getTimerInterval ();
+		}
+		if (engine->status->fCurrentLoopCount != lastLoopCount)
+		{
+			lastLoopCount = engine->status->fCurrentLoopCount;
+			timeStamp.loopCount = lastLoopCount;
+			timeStamp.time = engine->status->fLastLoopTime;
+			timeStamp.streamStarts = sStreamStarts;
+			timeStamp.samplesClocked = (NULL != pipes[1]) ? pipes[1]->mCounts.samplesClocked : 0;
+			timeStamp.samplesKept = (NULL != pipes[1]) ? pipes[1]->mCounts.samplesKept : 0;
+			timeStamps.push_back (timeStamp);
+		}
+	}
+	engine->stopAudioEngine ();
+
+	printf ("buffer %u sample frames, %zu time stamps, %u stream starts\n", engine->getNumSampleFramesPerBuffer (), timeStamps.size (), sStreamStarts);
+	if (kSimWakeNone != sOptions.wake)
+	{
+		OSBoolean *					resetOnWake = OSDynamicCast (OSBoolean, device->getProperty (kResetOnWakeKey));
+
+		if (kSimWakeDead == sOptions.wake)
+		{
+			// Nothing the driver streams means anything any more, so the reset is all there is to check.
+			simCheck (1 == device->mResetCount, "dead device reset %u times after the wake, expected once", device->mResetCount);
+			simCheck (NULL != resetOnWake && resetOnWake->isTrue (), "device marked to be reset on wake");
+			printf ("%s\n", (0 == sFailures) ? "PASS" : "FAIL");
+			return (0 == sFailures) ? 0 : 1;
+		}
+		simCheck (0 == device->mResetCount, "streaming device never reset after the wake (%u resets)", device->mResetCount);
+		simCheck (NULL == resetOnWake, "device not marked to be reset on wake");
+	}
+	for (size_t index = 0; sOptions.verbose && index < timeStamps.size (); index++)
+	{
+		printf ("  loop %u at %llu ns\n", timeStamps[index].loopCount, (unsigned long long) timeStamps[index].time);
+	}
+
+	// The driver may restart the engine on its own (every packet of a frame list overrunning does it), and the time line starts over
+	// then. Judge the longest stretch of time stamps taken without a restart, less the first one of it, which only sets the phase.
+	for (size_t index = 0, runStart = 0; index < timeStamps.size (); index++)
+	{
+		if (timeStamps[index].streamStarts != timeStamps[runStart].streamStarts)
+		{
+			runStart = index;
+		}
+		if (index - runStart > last - first)
+		{
+			first = runStart;
+			last = index;
+		}
+	}
+	first++;
+	simCheck (last > first, "engine took time stamps");
+	if (last > first)
+	{
+		// Streams carrying output are timed by the bus. An engine with only input is timed by the samples the device got to it, which is
+		// its clock less whatever short packets dropped, plus whatever overruns squeezed in. Those arrive in bursts the time stamp filter
+		// smooths over, so with losses in the window the time stamps only have to land within the loss of that rate, and each one within a
+		// loop's share of the lost time of the straight line.
+		if (sOptions.hasOutput)
+		{
+			expectedRate = 48000.0 / (1.0 + (double) sOptions.busPPM / 1e6);
+		}
+		else
+		{
+			double					keptRatio = (double) (timeStamps[last].samplesKept - timeStamps[first].samplesKept) / (double) (timeStamps[last].samplesClocked - timeStamps[first].samplesClocked);
+
+			expectedRate = 48000.0 * (1.0 + (double) sOptions.devicePPM / 1e6) * keptRatio;
+			rateTolerance += (keptRatio > 1.0) ? keptRatio - 1.0 : 1.0 - keptRatio;
+			deviationTolerance += (rateTolerance - 100e-6) * (double) engine->getNumSampleFramesPerBuffer () / 48000.0 * 1e9;
+		}
+		nanos = timeStamps[last].time - timeStamps[first].time;
+		measuredRate = (double) engine->getNumSampleFramesPerBuffer () * (timeStamps[last].loopCount - timeStamps[first].loopCount) * 1e9 / (double) nanos;
+		for (size_t index = first + 1; index < last; index++)
+		{
+			double					ideal = (double) timeStamps[first].time + (double) (index - first) * (double) nanos / (double) (last - first);
+			double					deviation = (double) timeStamps[index].time - ideal;
+
+			maxDeviationNanos = (deviation < 0 ? -deviation : deviation) > maxDeviationNanos ? (deviation < 0 ? -deviation : deviation) : maxDeviationNanos;
+		}
+		simCheck ((measuredRate - expectedRate) / expectedRate < rateTolerance && (expectedRate - measuredRate) / expectedRate < rateTolerance,
+				  "time stamps run at %.2f Hz, expected %.2f Hz (%+.1f ppm, %.0f allowed)", measuredRate, expectedRate, (measuredRate - expectedRate) / expectedRate * 1e6, rateTolerance * 1e6);
+		simCheck (maxDeviationNanos < deviationTolerance, "time stamps within %.0f us of a straight line (%.0f allowed)", maxDeviationNanos / 1000.0, deviationTolerance / 1000.0);
+	}
+
+	if (NULL != outputStream)
+	{
+		SimPipeCounts *				counts = &pipes[0]->mCounts;
+		double						samplesPerFrame = (double) counts->bytes / 4.0 / (double) counts->packets;
+
+		if (sOptions.verbose)
+		{
+			simPrintStatistics ("output", outputStream);
+		}
+		printf ("output: %u transfers, %llu packets, %u completed late, %u too old, %u aborted\n", counts->transfers, counts->packets, counts->lateCompletions, counts->tooOld, counts->aborted);
+		simCheck (samplesPerFrame > 47.9 && samplesPerFrame < 48.1, "output sends %.3f sample frames per bus frame", samplesPerFrame);
+		simCheck (counts->deliveredPackets == simStatistic (outputStream, kStatisticsPacketsKey), "output statistics count %llu of %llu packets", simStatistic (outputStream, kStatisticsPacketsKey), counts->deliveredPackets);
+	}
+	if (NULL != inputStream)
+	{
+		SimPipeCounts *				counts = &pipes[1]->mCounts;
+
+		if (sOptions.verbose)
+		{
+			simPrintStatistics ("input", inputStream);
+		}
+		printf ("input: %u transfers, %llu packets, %u jittered, %u short, %u overruns, %u completed late, %u too old, %u aborted\n",
+				counts->transfers, counts->packets, counts->jitteredPackets, counts->shortPackets, counts->overruns, counts->lateCompletions, counts->tooOld, counts->aborted);
+		simCheck (counts->deliveredPackets == simStatistic (inputStream, kStatisticsPacketsKey), "input statistics count %llu of %llu packets", simStatistic (inputStream, kStatisticsPacketsKey), counts->deliveredPackets);
+		simCheck (counts->deliveredOverruns == simStatistic (inputStream, kStatisticsOverrunsKey), "input statistics count %llu of %u overruns", simStatistic (inputStream, kStatisticsOverrunsKey), counts->deliveredOverruns);
+		simCheck (simStatistic (inputStream, kStatisticsShortPacketsKey) <= counts->shortPackets + counts->jitteredPackets, "input statistics count %llu short packets", simStatistic (inputStream, kStatisticsShortPacketsKey));
+		gaps = simCountInputGaps (inputStream, &oldestSample, &newestSample);
+		simCheck (gaps <= counts->shortPackets + counts->overruns + 1, "input buffer has %u gaps for %u lost stretches", gaps, counts->shortPackets + counts->overruns);
+	}
+
+	printf ("%s\n", (0 == sFailures) ? "PASS" : "FAIL");
+	return (0 == sFailures) ? 0 : 1;
+}